@@ -34,6 +34,9 @@ void apx_client_delete(apx_client_t *self);
 void apx_client_vdelete(void *arg);
 
 int8_t apx_client_connect_tcp(apx_client_t *self, const char *address, uint16_t port);
+#ifndef _MSC_VER
+int8_t apx_client_connect_unix(apx_client_t *self, const char *socketPath);
+#endif
 void apx_client_attachLocalNode(apx_client_t *self, apx_nodeData_t *nodeData);
 
 #endif //APX_CLIENT_H
@@ -9,6 +9,7 @@
 #include "adt_bytearray.h"
 #include "apx_fileManager.h"
 #include "apx_nodeManager.h"
+#include "apx_frameAccumulator.h"
 #include "msocket.h"
 
 //////////////////////////////////////////////////////////////////////////////
@@ -26,8 +27,12 @@ typedef struct apx_clientConnection_tag
    msocket_t *msocket;
    bool isAcknowledgeSeen;
    adt_bytearray_t sendBuffer;
-   uint8_t maxMsgHeaderSize;
+   apx_frameAccumulator_t frameAccumulator; //outgoing messages are coalesced here before being written to the socket
+   uint8_t maxMsgHeaderSize; //4, or 2 after the server has accepted RMF_NUMHEADER_FORMAT_16
    struct apx_client_tag *client;
+#if APX_SHM_TRANSPORT_ENABLE
+   apx_shmTransport_t *shmTransport; //offered to the server in the greeting, deleted again if the server does not attach to it
+#endif
 }apx_clientConnection_t;
 
 //////////////////////////////////////////////////////////////////////////////
@@ -44,6 +49,10 @@ apx_clientConnection_t *apx_clientConnection_new(msocket_t *msocket, struct apx_
 void apx_clientConnection_delete(apx_clientConnection_t *self);
 void apx_clientConnection_vdelete(void *arg);
 void apx_clientConnection_start(apx_clientConnection_t *self);
+void apx_clientConnection_getSendStats(apx_clientConnection_t *self, apx_frameAccumulatorStats_t *stats);
+#if APX_SHM_TRANSPORT_ENABLE
+int8_t apx_clientConnection_enableSharedMemory(apx_clientConnection_t *self);
+#endif
 int8_t apx_clientConnection_dataReceived(apx_clientConnection_t *self, const uint8_t *dataBuf, uint32_t dataLen, uint32_t *parseLen);
 
 
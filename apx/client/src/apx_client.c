@@ -23,6 +23,7 @@
 //////////////////////////////////////////////////////////////////////////////
 static int8_t tcp_client_data(void *arg, const uint8_t *dataBuf, uint32_t dataLen, uint32_t *parseLen);
 static void tcp_client_disconnected(void *arg);
+static int8_t apx_client_connect(apx_client_t *self, uint8_t addressFamily, const char *address, uint16_t port);
 void tcp_client_connected(void *arg,const char *addr,uint16_t port);
 
 //////////////////////////////////////////////////////////////////////////////
@@ -92,14 +93,55 @@ void apx_client_vdelete(void *arg)
 }
 
 int8_t apx_client_connect_tcp(apx_client_t *self, const char *address, uint16_t port)
+{
+   return apx_client_connect(self, AF_INET, address, port);
+}
+
+#ifndef _MSC_VER
+/**
+ * connects to an APX server on the same host using the unix domain socket given by its --socket option.
+ * Port data is exchanged through shared memory when the server was started with --shm, otherwise it goes through the socket.
+ */
+int8_t apx_client_connect_unix(apx_client_t *self, const char *socketPath)
+{
+   return apx_client_connect(self, AF_LOCAL, socketPath, 0);
+}
+#endif
+
+/**
+ * attached the nodeData to the local nodeManager in the client
+ */
+void apx_client_attachLocalNode(apx_client_t *self, apx_nodeData_t *nodeData)
+{
+   if ( (self != 0) && (nodeData != 0) )
+   {
+      apx_nodeManager_attachLocalNode(&self->nodeManager, nodeData); //client1 is the proxy
+   }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+/**
+ * address is a host name or IP address for AF_INET and a socket file path for AF_LOCAL (port is then ignored)
+ */
+static int8_t apx_client_connect(apx_client_t *self, uint8_t addressFamily, const char *address, uint16_t port)
 {
    int8_t retval = 0;
-   msocket_t *msocket = msocket_new(AF_INET);
+   msocket_t *msocket = msocket_new(addressFamily);
    if (msocket != 0)
    {
       msocket_handler_t handlerTable;
       self->connection = apx_clientConnection_new(msocket,self);
       assert(self->connection != 0);
+#if APX_SHM_TRANSPORT_ENABLE
+      if (addressFamily == AF_LOCAL)
+      {
+         //on failure all messages go through the socket, the same as when the server has no shared memory support
+         (void) apx_clientConnection_enableSharedMemory(self->connection);
+      }
+#endif
       memset(&handlerTable,0,sizeof(handlerTable));
       handlerTable.tcp_connected=tcp_client_connected;
       handlerTable.tcp_data=tcp_client_data;
@@ -118,21 +160,6 @@ int8_t apx_client_connect_tcp(apx_client_t *self, const char *address, uint16_t
    return retval;
 }
 
-/**
- * attached the nodeData to the local nodeManager in the client
- */
-void apx_client_attachLocalNode(apx_client_t *self, apx_nodeData_t *nodeData)
-{
-   if ( (self != 0) && (nodeData != 0) )
-   {
-      apx_nodeManager_attachLocalNode(&self->nodeManager, nodeData); //client1 is the proxy
-   }
-}
-
-
-//////////////////////////////////////////////////////////////////////////////
-// LOCAL FUNCTIONS
-//////////////////////////////////////////////////////////////////////////////
 static int8_t tcp_client_data(void *arg, const uint8_t *dataBuf, uint32_t dataLen, uint32_t *parseLen)
 {
    apx_clientConnection_t *clientConnection = (apx_clientConnection_t*) arg;
@@ -6,9 +6,14 @@
 #include <string.h>
 #include <assert.h>
 #include <stdio.h>
+#ifndef _MSC_VER
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
 #include "apx_clientConnection.h"
 #include "apx_client.h"
 #include "headerutil.h"
+#include "rmf.h"
 #ifdef MEM_LEAK_CHECK
 #include "CMemLeak.h"
 #endif
@@ -20,6 +25,9 @@
 //////////////////////////////////////////////////////////////////////////////
 #define MAX_HEADER_LEN 128
 #define SEND_BUFFER_GROW_SIZE 4096 //4KB
+#if !defined(_MSC_VER) && !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0 //platforms without it are expected to ignore SIGPIPE
+#endif
 
 //////////////////////////////////////////////////////////////////////////////
 // LOCAL FUNCTION PROTOTYPES
@@ -27,6 +35,10 @@
 static int8_t apx_clientConnection_parseMessage(apx_clientConnection_t *self, const uint8_t *dataBuf, uint32_t dataLen, uint32_t *parseLen);
 static uint8_t *apx_clientConnection_getSendBuffer(void *arg, int32_t msgLen);
 static int32_t apx_clientConnection_send(void *arg, int32_t offset, int32_t msgLen);
+static int32_t apx_clientConnection_sendGather(void *arg, const uint8_t *header, int32_t headerLen, const uint8_t *payload, int32_t payloadLen);
+static int32_t apx_clientConnection_getSendAvail(void *arg);
+static int32_t apx_clientConnection_flush(void *arg);
+static int32_t apx_clientConnection_transmit(void *arg, const apx_frameBuffer_t *buffers, int32_t numBuffers);
 static void apx_clientConnection_sendGreeting(apx_clientConnection_t *self);
 
 
@@ -52,6 +64,10 @@ int8_t apx_clientConnection_create(apx_clientConnection_t *self, msocket_t *msoc
       self->maxMsgHeaderSize = (uint8_t) sizeof(uint32_t);
       apx_fileManager_create(&self->fileManager, APX_FILEMANAGER_CLIENT_MODE);
       adt_bytearray_create(&self->sendBuffer, SEND_BUFFER_GROW_SIZE);
+      apx_frameAccumulator_create(&self->frameAccumulator, APX_FRAME_ACCUMULATOR_MAX_LEN, APX_FRAME_ACCUMULATOR_MAX_DELAY_MS, apx_clientConnection_transmit, (void*) self);
+#if APX_SHM_TRANSPORT_ENABLE
+      self->shmTransport = (apx_shmTransport_t*) 0;
+#endif
       return 0;
    }
    errno=EINVAL;
@@ -67,8 +83,13 @@ void apx_clientConnection_destroy(apx_clientConnection_t *self)
          msocket_delete(self->msocket);
       }
 
+      //stops the shared memory receive thread before the transport is deleted
       apx_fileManager_destroy(&self->fileManager);
+#if APX_SHM_TRANSPORT_ENABLE
+      apx_shmTransport_delete(self->shmTransport);
+#endif
       adt_bytearray_destroy(&self->sendBuffer);
+      apx_frameAccumulator_destroy(&self->frameAccumulator);
    }
 }
 
@@ -118,8 +139,11 @@ void apx_clientConnection_start(apx_clientConnection_t *self)
       //register transmit handler with our fileManager
       serverTransmitHandler.arg = self;
       serverTransmitHandler.send = apx_clientConnection_send;
-      serverTransmitHandler.getSendAvail = 0;
+      serverTransmitHandler.getSendAvail = apx_clientConnection_getSendAvail;
       serverTransmitHandler.getSendBuffer = apx_clientConnection_getSendBuffer;
+      serverTransmitHandler.flush = apx_clientConnection_flush;
+      serverTransmitHandler.sendGather = apx_clientConnection_sendGather;
+      serverTransmitHandler.trySendGather = 0; //routed writes are only dispatched directly by the server
       apx_fileManager_setTransmitHandler(&self->fileManager, &serverTransmitHandler);
       //register connection with the server nodeManager
       apx_nodeManager_attachFileManager(&self->client->nodeManager, &self->fileManager);
@@ -129,6 +153,30 @@ void apx_clientConnection_start(apx_clientConnection_t *self)
 }
 
 
+#if APX_SHM_TRANSPORT_ENABLE
+/**
+ * Creates a shared memory region which is offered to the server in the greeting. Must be called before apx_clientConnection_start.
+ * Only used for connections to a server on the same host, the server attaches to the memory of this process using its process id.
+ */
+int8_t apx_clientConnection_enableSharedMemory(apx_clientConnection_t *self)
+{
+   if (self != 0)
+   {
+      if (self->shmTransport == 0)
+      {
+         self->shmTransport = apx_shmTransport_new();
+         if (self->shmTransport == 0)
+         {
+            return -1;
+         }
+      }
+      return 0;
+   }
+   errno = EINVAL;
+   return -1;
+}
+#endif
+
 /**
  * called from apx_client when data has been received on the msocket
  */
@@ -163,6 +211,17 @@ int8_t apx_clientConnection_dataReceived(apx_clientConnection_t *self, const uin
    return -1;
 }
 
+/**
+ * returns counters describing how well outgoing messages were coalesced into socket writes
+ */
+void apx_clientConnection_getSendStats(apx_clientConnection_t *self, apx_frameAccumulatorStats_t *stats)
+{
+   if ( (self != 0) && (stats != 0) )
+   {
+      apx_frameAccumulator_getStats(&self->frameAccumulator, stats);
+   }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // LOCAL FUNCTIONS
 //////////////////////////////////////////////////////////////////////////////
@@ -173,6 +232,21 @@ void apx_clientConnection_sendGreeting(apx_clientConnection_t *self)
    uint32_t greetingLen;
    char greeting[RMF_GREETING_MAX_LEN];
    strcpy(greeting, RMF_GREETING_START);
+   //the server answers with an empty RMF_CMD_MULTI_WRITE message after the acknowledge if it accepts them too
+   strcat(greeting, RMF_MULTI_WRITE " 1\n");
+   //a server that accepts this sends RMF_CMD_NUMHEADER_FORMAT before the acknowledge, old servers keep using 32-bit headers
+   sprintf(&greeting[strlen(greeting)], "%s %u\n", RMF_NUMHEADER_FORMAT, RMF_NUMHEADER_FORMAT_16);
+#if APX_SHM_TRANSPORT_ENABLE
+   if (self->shmTransport != 0)
+   {
+      int32_t lineLen = (int32_t) strlen(greeting);
+      if (apx_shmTransport_getGreetingLine(self->shmTransport, &greeting[lineLen], RMF_GREETING_MAX_LEN-lineLen-1) < 0)
+      {
+         apx_shmTransport_delete(self->shmTransport);
+         self->shmTransport = (apx_shmTransport_t*) 0;
+      }
+   }
+#endif
    //headers end with an additional newline
    strcat(greeting, "\n");
    greetingLen = (uint32_t) strlen(greeting);
@@ -181,6 +255,7 @@ void apx_clientConnection_sendGreeting(apx_clientConnection_t *self)
    {
       memcpy(sendBuffer, greeting, greetingLen);
       apx_clientConnection_send((void*) self, 0, greetingLen);
+      apx_clientConnection_flush((void*) self);
    }
    else
    {
@@ -189,7 +264,7 @@ void apx_clientConnection_sendGreeting(apx_clientConnection_t *self)
 }
 
 /**
- * a message consists of a message length (first 1 or 4 bytes) packed as binary integer (big endian).
+ * a message consists of a message length (first 1 or 4 bytes, 1 or 2 bytes with RMF_NUMHEADER_FORMAT_16) packed as binary integer (big endian).
  * Then follows the message data followed by a new message length header etc.
  * Returns 0 on parse success, -1 on parse failure.
  */
@@ -197,14 +272,23 @@ static int8_t apx_clientConnection_parseMessage(apx_clientConnection_t *self, co
 {
    uint32_t msgLen;
    const uint8_t *pBegin = dataBuf;
-   const uint8_t *pResult;
    const uint8_t *pEnd = dataBuf+dataLen;
    const uint8_t *pNext = pBegin;
-   pResult = headerutil_numDecode32(pNext, pEnd, &msgLen);
-   if (pResult>pNext)
+   int32_t result;
+   if (apx_fileManager_isParsingMessage(&self->fileManager) == true)
+   {
+      result = apx_fileManager_parseMessageContinue(&self->fileManager, dataBuf, (int32_t) dataLen);
+      if ( (result > 0) && (parseLen != 0) )
+      {
+         *parseLen = (uint32_t) result;
+      }
+      return 0;
+   }
+   result = rmf_unpackNumHeader(pNext, (int32_t) dataLen, &msgLen, self->maxMsgHeaderSize);
+   if (result > 0)
    {
-      uint32_t headerLen = (uint32_t) (pResult-pNext);
-      pNext = pResult;
+      uint32_t headerLen = (uint32_t) result;
+      pNext += headerLen;
       //TODO: implement sanity check for too long messages? (by checking value of msgLen here)
       if (pNext+msgLen<=pEnd)
       {
@@ -226,15 +310,48 @@ static int8_t apx_clientConnection_parseMessage(apx_clientConnection_t *self, co
                     (pNext[7] == 0x00) )
                {
                   self->isAcknowledgeSeen = true;
+#if APX_SHM_TRANSPORT_ENABLE
+                  if (self->shmTransport != 0)
+                  {
+                     //the server attaches before it acknowledges, a server without shared memory support ignores the offer
+                     if ( (apx_shmTransport_isAttached(self->shmTransport) == false) ||
+                          (apx_fileManager_setSharedMemoryTransport(&self->fileManager, self->shmTransport) != 0) )
+                     {
+                        apx_shmTransport_delete(self->shmTransport);
+                        self->shmTransport = (apx_shmTransport_t*) 0;
+                     }
+                  }
+#endif
                   apx_fileManager_onConnected(&self->fileManager);
                }
             }
+            else
+            {
+               rmf_msg_t msg;
+               uint32_t numHeaderFormat;
+               if ( (rmf_unpackMsg(pNext, (int32_t) msgLen, &msg) > 0) && (msg.address == RMF_CMD_START_ADDR) &&
+                    (rmf_deserialize_cmdNumHeaderFormat(msg.data, msg.dataLen, &numHeaderFormat) > 0) &&
+                    (numHeaderFormat == RMF_NUMHEADER_FORMAT_16) )
+               {
+                  //the worker thread has nothing to send before the acknowledge has been seen
+                  self->maxMsgHeaderSize = (uint8_t) sizeof(uint16_t);
+               }
+            }
          }
          else
          {
             apx_fileManager_parseMessage(&self->fileManager, pNext, msgLen);
          }
       }
+      else if ( (self->isAcknowledgeSeen == true) && (msgLen >= APX_FILEMANAGER_STREAM_MIN_LEN) )
+      {
+         //write what has been received so far, this keeps large messages from piling up in the receive buffer
+         result = apx_fileManager_parseMessageBegin(&self->fileManager, pNext, (int32_t) (pEnd-pNext), (int32_t) msgLen);
+         if ( (result > 0) && (parseLen != 0) )
+         {
+            *parseLen = headerLen+(uint32_t) result;
+         }
+      }
       else
       {
          //we have to wait until entire message is in the buffer
@@ -289,31 +406,17 @@ static int32_t apx_clientConnection_send(void *arg, int32_t offset, int32_t msgL
       if ((sendBuffer != 0) && (msgLen+self->maxMsgHeaderSize<=sendBufferLen) )
       {
          uint8_t header[sizeof(uint32_t)];
-         uint8_t headerLen;
-         uint8_t *headerEnd;
+         int32_t headerLen = rmf_packNumHeader(header, (int32_t) sizeof(header), (uint32_t) msgLen, self->maxMsgHeaderSize);
          uint8_t *pBegin;
-         if (self->maxMsgHeaderSize == (uint8_t) sizeof(uint32_t))
-         {
-            headerEnd = headerutil_numEncode32(header, (uint32_t) sizeof(header), msgLen);
-            if (headerEnd>header)
-            {
-               headerLen=headerEnd-header;
-            }
-            else
-            {
-               assert(0);
-               return -1; //header buffer too small
-            }
-         }
-         else
+         if (headerLen <= 0)
          {
-            return -1; //not yet implemented
+            fprintf(stderr, "Message of %d bytes is too long for the header format\n", (int) msgLen);
+            return -1;
          }
          //place header just before user data begin
          pBegin = sendBuffer+(self->maxMsgHeaderSize+offset-headerLen); //the part in the parenthesis is where the user data begins
-         memcpy(pBegin, header, headerLen);         
-         msocket_send(self->msocket, pBegin, msgLen+headerLen);
-         return 0;
+         memcpy(pBegin, header, headerLen);
+         return apx_frameAccumulator_append(&self->frameAccumulator, pBegin, (uint32_t) (msgLen+headerLen));
       }
       else
       {
@@ -322,3 +425,114 @@ static int32_t apx_clientConnection_send(void *arg, int32_t offset, int32_t msgL
    }
    return -1;
 }
+
+/**
+ * callback for fileManager when it wants to send an RMF header followed by data that is stored elsewhere (e.g. in a shared payload).
+ * The data is copied straight into the outgoing frame, there is no intermediate copy in sendBuffer.
+ */
+static int32_t apx_clientConnection_sendGather(void *arg, const uint8_t *header, int32_t headerLen, const uint8_t *payload, int32_t payloadLen)
+{
+   apx_clientConnection_t *self = (apx_clientConnection_t*) arg;
+   if ( (self != 0) && (header != 0) && (headerLen > 0) && (headerLen <= (int32_t) RMF_MAX_HEADER_SIZE) && (payloadLen >= 0) )
+   {
+      uint8_t frameHeader[sizeof(uint32_t)+RMF_MAX_HEADER_SIZE];
+      uint8_t *numHeaderEnd;
+      int32_t numHeaderLen = rmf_packNumHeader(frameHeader, (int32_t) sizeof(uint32_t), (uint32_t) (headerLen+payloadLen), self->maxMsgHeaderSize);
+      if (numHeaderLen <= 0)
+      {
+         fprintf(stderr, "Message of %d bytes is too long for the header format\n", (int) (headerLen+payloadLen));
+         return -1;
+      }
+      numHeaderEnd = &frameHeader[numHeaderLen];
+      memcpy(numHeaderEnd, header, headerLen);
+      return apx_frameAccumulator_appendGather(&self->frameAccumulator, frameHeader, (uint32_t) ((numHeaderEnd-frameHeader)+headerLen), payload, (uint32_t) payloadLen);
+   }
+   return -1;
+}
+
+/**
+ * callback for fileManager, returns the length of the largest message the header format can describe
+ */
+static int32_t apx_clientConnection_getSendAvail(void *arg)
+{
+   apx_clientConnection_t *self = (apx_clientConnection_t*) arg;
+   if (self != 0)
+   {
+      return rmf_getNumHeaderMaxMsgLen(self->maxMsgHeaderSize);
+   }
+   return -1;
+}
+
+/**
+ * callback for fileManager when it has no more messages to send for the moment
+ */
+static int32_t apx_clientConnection_flush(void *arg)
+{
+   apx_clientConnection_t *self = (apx_clientConnection_t*) arg;
+   if (self != 0)
+   {
+      return apx_frameAccumulator_flush(&self->frameAccumulator);
+   }
+   return -1;
+}
+
+/**
+ * writes one or more framed messages to the socket
+ */
+static int32_t apx_clientConnection_transmit(void *arg, const apx_frameBuffer_t *buffers, int32_t numBuffers)
+{
+   apx_clientConnection_t *self = (apx_clientConnection_t*) arg;
+   if ( (self != 0) && (self->msocket != 0) && (buffers != 0) )
+   {
+      int32_t i;
+#ifdef _MSC_VER
+      //Winsock has no sendmsg, the buffers are written one at a time
+      for (i = 0; i < numBuffers; i++)
+      {
+         if (msocket_send(self->msocket, buffers[i].data, buffers[i].dataLen) != 0)
+         {
+            return -1;
+         }
+      }
+#else
+      struct iovec iov[APX_FRAME_ACCUMULATOR_MAX_BUFFERS];
+      struct msghdr msg;
+      int numIov = 0;
+      for (i = 0; (i < numBuffers) && (i < APX_FRAME_ACCUMULATOR_MAX_BUFFERS); i++)
+      {
+         iov[i].iov_base = (void*) buffers[i].data;
+         iov[i].iov_len = (size_t) buffers[i].dataLen;
+         numIov++;
+      }
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = &iov[0];
+      msg.msg_iovlen = (size_t) numIov;
+      //all buffers go out in one system call, the loop only repeats after a partial write
+      while (msg.msg_iovlen > 0)
+      {
+         ssize_t result = sendmsg(self->msocket->tcpsockfd, &msg, MSG_NOSIGNAL);
+         if (result < 0)
+         {
+            if (errno == EINTR)
+            {
+               continue;
+            }
+            return -1;
+         }
+         while ( (msg.msg_iovlen > 0) && ((size_t) result >= msg.msg_iov[0].iov_len) )
+         {
+            result -= (ssize_t) msg.msg_iov[0].iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+         }
+         if (msg.msg_iovlen > 0)
+         {
+            msg.msg_iov[0].iov_base = (void*) ( ((uint8_t*) msg.msg_iov[0].iov_base) + result );
+            msg.msg_iov[0].iov_len -= (size_t) result;
+         }
+      }
+#endif
+      return 0;
+   }
+   return -1;
+}
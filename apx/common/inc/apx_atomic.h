@@ -0,0 +1,33 @@
+#ifndef APX_ATOMIC_H
+#define APX_ATOMIC_H
+
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+#ifdef _MSC_VER
+#include <Windows.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+
+//atomic operations on 32-bit integers, all operations are full barriers unless stated otherwise
+#ifdef _MSC_VER
+#define APX_ATOMIC_INCREMENT(x) InterlockedIncrement((volatile LONG*) &(x)) //returns new value
+#define APX_ATOMIC_DECREMENT(x) InterlockedDecrement((volatile LONG*) &(x)) //returns new value
+#define APX_ATOMIC_FETCH_ADD(x, v) InterlockedExchangeAdd((volatile LONG*) &(x), (LONG) (v)) //returns previous value
+#define APX_ATOMIC_CAS(x, expected, desired) (InterlockedCompareExchange((volatile LONG*) &(x), (LONG) (desired), (LONG) (expected)) == (LONG) (expected))
+#define APX_ATOMIC_LOAD_ACQUIRE(x) (x) //volatile access has acquire semantics with /volatile:ms (the default on x86/x64)
+#define APX_ATOMIC_STORE_RELEASE(x, v) ((x) = (v)) //volatile access has release semantics with /volatile:ms (the default on x86/x64)
+#else
+#define APX_ATOMIC_INCREMENT(x) __atomic_add_fetch(&(x), 1, __ATOMIC_SEQ_CST)
+#define APX_ATOMIC_DECREMENT(x) __atomic_sub_fetch(&(x), 1, __ATOMIC_SEQ_CST)
+#define APX_ATOMIC_FETCH_ADD(x, v) __atomic_fetch_add(&(x), (v), __ATOMIC_SEQ_CST)
+#define APX_ATOMIC_CAS(x, expected, desired) __sync_bool_compare_and_swap(&(x), (expected), (desired))
+#define APX_ATOMIC_LOAD_ACQUIRE(x) __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define APX_ATOMIC_STORE_RELEASE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#endif
+
+#endif //APX_ATOMIC_H
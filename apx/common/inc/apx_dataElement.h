@@ -39,6 +39,7 @@ typedef struct apx_dataElement_tag
 apx_dataElement_t *apx_dataElement_new(int8_t baseType, const char *name);
 void apx_dataElement_delete(apx_dataElement_t *self);
 void apx_dataElement_vdelete(void *arg);
+apx_dataElement_t *apx_dataElement_clone(const apx_dataElement_t *other);
 int8_t apx_dataElement_create(apx_dataElement_t *self, int8_t baseType, const char *name);
 void apx_dataElement_destroy(apx_dataElement_t *self);
 void apx_dataElement_initRecordType(apx_dataElement_t *self);
@@ -20,6 +20,7 @@ void apx_dataSignature_delete(apx_dataSignature_t *self);
 void apx_dataSignature_vdelete(void *arg);
 int8_t apx_dataSignature_create(apx_dataSignature_t *self, const char *dsg);
 void apx_dataSignature_destroy(apx_dataSignature_t *self);
+int8_t apx_dataSignature_createCopy(apx_dataSignature_t *self, const apx_dataSignature_t *other);
 uint32_t apx_dataSignature_packLen(apx_dataSignature_t *self);
 int8_t apx_dataSignature_update(apx_dataSignature_t *self,const char *dsg);
 
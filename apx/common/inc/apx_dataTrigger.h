@@ -22,6 +22,7 @@ typedef struct apx_dataWriteInfo_tag
 {
    struct apx_nodeInfo_tag *requesterNodeInfo;
    uint32_t destOffset;       //byte offset into inDataBuffer of requesterNodeInfo
+   bool isQueued;             //true if the require port is a queued port, every value written to it must be delivered
 } apx_dataWriteInfo_t;
 
 typedef struct apx_dataTriggerFunction_tag
@@ -29,14 +30,31 @@ typedef struct apx_dataTriggerFunction_tag
    uint32_t srcOffset;        //offset in bytes to where the signal data actually starts (this is only used if partial signal update is supported)
    uint32_t dataLength;       //expected length of data (this is just for error checking)
    adt_ary_t writeInfoList;   //array of apx_dataWriteInfo_t
+   apx_dataWriteInfo_t *writeInfoBuf; //when not NULL, the elements of writeInfoList are stored here and writeInfoList is a weak reference list
 }apx_dataTriggerFunction_t;
 
+/**
+ * immutable set of trigger functions, readers use it without locking.
+ * A snapshot and its trigger functions are never modified once published, changes are made in a copy which replaces it (read-copy-update).
+ */
+typedef struct apx_dataTriggerSnapshot_tag
+{
+   apx_dataTriggerFunction_t  **triggerIndex;    //array of apx_dataTriggerFunction_t*, sorted by srcOffset. Stored directly after this struct
+   int32_t                    numTriggers;       //number of valid entries in triggerIndex
+}apx_dataTriggerSnapshot_t;
+
+/**
+ * maps byte ranges of a node's outPortData to trigger functions.
+ * Only provide ports that have a trigger function occupy an entry, memory use is proportional to the number of provide ports rather than to the size of outPortData.
+ */
 typedef struct apx_dataTriggerTable_tag
 {
-   //Note: the lookupTable contains duplicate pointer objects, we cannot delete its items like we normally do using virtual destructor.
-
-   apx_dataTriggerFunction_t  **lookupTable;     //array of apx_dataTriggerFunction_t*,
-   uint32_t                   lookupTableLen;    //should be identical to number of bytes in the outPortMap (from corresponding NodeInfo)
+   apx_dataTriggerSnapshot_t  *volatile snapshot; //published snapshot, NULL until the first trigger function is created
+   apx_dataTriggerSnapshot_t  *pending;          //writer's copy while an update is in progress, NULL otherwise
+   int32_t                    updateDepth;       //nesting level of apx_dataTriggerTable_beginUpdate
+   int32_t                    maxNumTriggers;    //capacity of triggerIndex, identical to number of provide ports (from corresponding NodeInfo)
+   adt_ary_t                  replaced;          //weak references to trigger functions replaced in pending, retired when pending is published
+   uint32_t                   outDataLen;        //should be identical to number of bytes in the outPortMap (from corresponding NodeInfo)
    dataTriggerWriteHook_fn    *writeHookFunc;
    void                       *writeHookUserArg;
    struct apx_nodeInfo_tag    *nodeInfo;         //The nodeInfo where this triggertable is attached to
@@ -57,8 +75,17 @@ void apx_dataTriggerTable_destroy(apx_dataTriggerTable_t *self);
 apx_dataTriggerTable_t *apx_dataTriggerTable_new(struct apx_nodeInfo_tag *nodeInfo, dataTriggerWriteHook_fn *writeHookFunc, void *writeHookUserArg);
 void apx_dataTriggerTable_delete(apx_dataTriggerTable_t *self);
 void apx_dataTriggerTable_vdelete(void *arg);
+void apx_dataTriggerTable_beginUpdate(apx_dataTriggerTable_t *self);
+void apx_dataTriggerTable_commitUpdate(apx_dataTriggerTable_t *self);
 void apx_dataTriggerTable_updateTrigger(apx_dataTriggerTable_t *self, apx_port_t *port);
+const apx_dataTriggerSnapshot_t *apx_dataTriggerTable_getSnapshot(const apx_dataTriggerTable_t *self);
 apx_dataTriggerFunction_t *apx_dataTriggerTable_get(const apx_dataTriggerTable_t *self, int32_t offset);
+apx_dataTriggerFunction_t *apx_dataTriggerTable_getNext(const apx_dataTriggerTable_t *self, int32_t offset);
+int32_t apx_dataTriggerTable_getNumTriggers(const apx_dataTriggerTable_t *self);
+uint32_t apx_dataTriggerTable_getMemoryUsage(const apx_dataTriggerTable_t *self);
+
+//dataTriggerSnapshot
+apx_dataTriggerFunction_t *apx_dataTriggerSnapshot_getNext(const apx_dataTriggerSnapshot_t *self, int32_t offset);
 
 //apx_dataTriggerFunction
 void apx_dataTriggerFunction_create(apx_dataTriggerFunction_t *self, uint32_t srcOffset, uint32_t dataLength);
@@ -68,9 +95,9 @@ void apx_dataTriggerFunction_delete(apx_dataTriggerFunction_t *self);
 void apx_dataTriggerFunction_vdelete(void *arg);
 
 //dataWriteInfo
-void apx_dataWriteInfo_create(apx_dataWriteInfo_t *self,struct apx_nodeInfo_tag *nodeInfo, uint32_t destOffset);
+void apx_dataWriteInfo_create(apx_dataWriteInfo_t *self,struct apx_nodeInfo_tag *nodeInfo, uint32_t destOffset, bool isQueued);
 void apx_dataWriteInfo_destroy(apx_dataWriteInfo_t *self);
-apx_dataWriteInfo_t *apx_dataWriteInfo_new(struct apx_nodeInfo_tag *nodeInfo, uint32_t destOffset);
+apx_dataWriteInfo_t *apx_dataWriteInfo_new(struct apx_nodeInfo_tag *nodeInfo, uint32_t destOffset, bool isQueued);
 void apx_dataWriteInfo_delete(apx_dataWriteInfo_t *self);
 void apx_dataWriteInfo_vdelete(void *arg);
 
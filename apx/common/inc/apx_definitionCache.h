@@ -0,0 +1,86 @@
+#ifndef APX_DEFINITION_CACHE_H
+#define APX_DEFINITION_CACHE_H
+
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+#if defined(_MSC_PLATFORM_TOOLSET) && (_MSC_PLATFORM_TOOLSET<=110)
+#include "msc_bool.h"
+#else
+#include <stdbool.h>
+#endif
+#ifdef _MSC_VER
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "osmacro.h"
+#include "adt_ary.h"
+#include "adt_hash.h"
+#include "sha256.h"
+#include "apx_node.h"
+#include "apx_nodeTemplate.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#define APX_DEFINITION_DIGEST_SIZE SHA256_DIGEST_SIZE
+
+#ifndef APX_DEFINITION_CACHE_DEFAULT_CAPACITY
+#define APX_DEFINITION_CACHE_DEFAULT_CAPACITY 64
+#endif
+
+/**
+ * one cached definition. The entry is immutable once it has been inserted into the cache
+ */
+typedef struct apx_definitionCacheEntry_tag
+{
+   uint8_t digest[APX_DEFINITION_DIGEST_SIZE];
+   uint8_t *definitionBuf; //strong reference (malloc)
+   int32_t definitionLen;
+   adt_ary_t nodes; //strong references to apx_node_t sharing the ports of a node template, in the order the nodes appear in the definition
+   int32_t refCount; //one reference held by the cache plus one for each apx_definitionCache_acquire
+   struct apx_definitionCacheEntry_tag *prev; //towards the most recently used entry
+   struct apx_definitionCacheEntry_tag *next; //towards the least recently used entry
+}apx_definitionCacheEntry_t;
+
+/**
+ * LRU cache of parsed definitions keyed by the SHA-256 digest of the definition text
+ */
+typedef struct apx_definitionCache_tag
+{
+   adt_hash_t entryMap; //key is the digest in hex, weak references to apx_definitionCacheEntry_t
+   apx_definitionCacheEntry_t *head; //most recently used
+   apx_definitionCacheEntry_t *tail; //least recently used, evicted first
+   int32_t numEntries;
+   int32_t capacity;
+   uint32_t numHits;
+   uint32_t numMisses;
+   MUTEX_T lock;
+}apx_definitionCache_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+apx_definitionCacheEntry_t *apx_definitionCacheEntry_new(const uint8_t *digest, const uint8_t *definitionBuf, int32_t definitionLen);
+void apx_definitionCacheEntry_delete(apx_definitionCacheEntry_t *self);
+int8_t apx_definitionCacheEntry_addNode(apx_definitionCacheEntry_t *self, const apx_node_t *node);
+int32_t apx_definitionCacheEntry_getNumNodes(const apx_definitionCacheEntry_t *self);
+const apx_node_t *apx_definitionCacheEntry_getNode(const apx_definitionCacheEntry_t *self, int32_t index);
+
+void apx_definitionCache_create(apx_definitionCache_t *self, int32_t capacity);
+void apx_definitionCache_destroy(apx_definitionCache_t *self);
+void apx_definitionCache_insert(apx_definitionCache_t *self, apx_definitionCacheEntry_t *entry);
+apx_definitionCacheEntry_t *apx_definitionCache_acquire(apx_definitionCache_t *self, const uint8_t *digest);
+void apx_definitionCache_release(apx_definitionCache_t *self, apx_definitionCacheEntry_t *entry);
+int32_t apx_definitionCache_length(apx_definitionCache_t *self);
+uint32_t apx_definitionCache_getNumHits(apx_definitionCache_t *self);
+uint32_t apx_definitionCache_getNumMisses(apx_definitionCache_t *self);
+
+#endif //APX_DEFINITION_CACHE_H
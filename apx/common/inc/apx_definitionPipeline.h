@@ -0,0 +1,106 @@
+#ifndef APX_DEFINITION_PIPELINE_H
+#define APX_DEFINITION_PIPELINE_H
+
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+#if defined(_MSC_PLATFORM_TOOLSET) && (_MSC_PLATFORM_TOOLSET<=110)
+#include "msc_bool.h"
+#else
+#include <stdbool.h>
+#endif
+#ifdef _MSC_VER
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <semaphore.h>
+#endif
+#include "osmacro.h"
+#include "adt_ary.h"
+#include "apx_nodeInfo.h"
+#include "apx_definitionCache.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#define APX_DEFINITION_PIPELINE_MAX_WORKERS 16
+
+/**
+ * a node that has been parsed, finalized and given its port data maps and init data, but is not yet linked
+ */
+typedef struct apx_preparedNode_tag
+{
+   apx_nodeInfo_t *nodeInfo; //strong reference, nodeInfo owns its node. Set to NULL by the link function when it takes ownership
+   uint8_t *inPortInitData; //strong reference (malloc), initial value of the inPortData buffer. NULL when node has no require ports
+   int32_t inPortDataLen;
+}apx_preparedNode_t;
+
+typedef struct apx_definitionJob_tag
+{
+   const uint8_t *definitionBuf; //weak reference, must stay valid until the job has been linked or cancelled
+   int32_t definitionLen;
+   void *owner; //weak reference to the object the definition came from (the fileManager), used by apx_definitionPipeline_cancel
+   bool hasDigest; //true when digest holds the SHA-256 digest the sender published for definitionBuf
+   uint8_t digest[APX_DEFINITION_DIGEST_SIZE];
+   apx_definitionCacheEntry_t *cacheEntry; //acquired cache entry the nodes are created from instead of parsing definitionBuf, or NULL
+   adt_ary_t preparedNodes; //strong references to apx_preparedNode_t, filled in by the worker
+   struct apx_definitionJob_tag *next;
+}apx_definitionJob_t;
+
+typedef void (apx_definitionPipeline_link_fn)(void *arg, apx_definitionJob_t *job);
+
+/**
+ * Processes APX definitions in stages: parse, finalize (port data maps), init data and link.
+ * The first three stages only touch data owned by the job and run on a pool of worker threads. The only lock they take is
+ * the node template table's, parsed nodes with the same ports share one node template (see apx_nodeTemplate.h).
+ * The link stage changes shared state (node maps, router) and is serialized, one job at a time, through linkFunc.
+ * Without workers (the default) all stages run in the thread calling apx_definitionPipeline_post.
+ * With a cache, parsed definitions are stored by digest and later definitions with the same digest skip the first three stages.
+ */
+typedef struct apx_definitionPipeline_tag
+{
+   apx_definitionPipeline_link_fn *linkFunc;
+   void *linkArg;
+   apx_definitionCache_t *cache; //weak reference, NULL when caching is disabled
+   THREAD_T workerThreads[APX_DEFINITION_PIPELINE_MAX_WORKERS];
+   void *activeOwners[APX_DEFINITION_PIPELINE_MAX_WORKERS]; //owner of the job each worker is processing, NULL when idle
+   int32_t numWorkers;
+   bool isRunning; //when false it's time to shut down
+   apx_definitionJob_t *queueHead; //jobs waiting for a worker, oldest first
+   apx_definitionJob_t *queueTail;
+   int32_t numPendingJobs; //queued jobs plus jobs being processed
+#ifdef _MSC_VER
+   CRITICAL_SECTION lock; //protects the queue, activeOwners, numPendingJobs and isRunning
+   CONDITION_VARIABLE jobDone; //broadcast each time a job has been linked or dropped
+#else
+   MUTEX_T lock; //protects the queue, activeOwners, numPendingJobs and isRunning
+   pthread_cond_t jobDone; //broadcast each time a job has been linked or dropped
+#endif
+   MUTEX_T linkLock; //serializes the link stage
+   SEMAPHORE_T semaphore; //posted once for each queued job and once for each worker on shutdown
+#ifdef _MSC_VER
+   unsigned int threadIds[APX_DEFINITION_PIPELINE_MAX_WORKERS];
+#endif
+}apx_definitionPipeline_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+void apx_definitionPipeline_create(apx_definitionPipeline_t *self, apx_definitionPipeline_link_fn *linkFunc, void *linkArg);
+void apx_definitionPipeline_destroy(apx_definitionPipeline_t *self);
+int8_t apx_definitionPipeline_start(apx_definitionPipeline_t *self, int32_t numWorkers);
+void apx_definitionPipeline_stop(apx_definitionPipeline_t *self);
+void apx_definitionPipeline_setCache(apx_definitionPipeline_t *self, apx_definitionCache_t *cache);
+int8_t apx_definitionPipeline_post(apx_definitionPipeline_t *self, const uint8_t *definitionBuf, int32_t definitionLen, const uint8_t *digest, void *owner);
+int8_t apx_definitionPipeline_postCached(apx_definitionPipeline_t *self, apx_definitionCacheEntry_t *cacheEntry, void *owner);
+void apx_definitionPipeline_cancel(apx_definitionPipeline_t *self, void *owner);
+void apx_definitionPipeline_flush(apx_definitionPipeline_t *self);
+int32_t apx_definitionPipeline_getNumWorkers(const apx_definitionPipeline_t *self);
+
+#endif //APX_DEFINITION_PIPELINE_H
@@ -29,6 +29,11 @@
 #define APX_INDATA_FILE_EXT       ".in"
 #define APX_DEFINITION_FILE_EXT   ".apx"
 
+#ifndef APX_EMBEDDED
+//forward declaration
+struct apx_sharedPayload_tag;
+#endif
+
 typedef struct apx_file_tag
 {
    bool isRemoteFile; //true or false
@@ -36,6 +41,14 @@ typedef struct apx_file_tag
    rmf_fileInfo_t fileInfo;
    uint16_t fileType;
    bool isOpen;
+   uint32_t fragmentStartOffset; //remote files only: offset of the first received message in a sequence sent with more_bit
+   uint32_t fragmentEndOffset; //remote files only: offset where the next message in the sequence is expected
+   bool isFragmentPending; //remote files only: true from a message sent with more_bit until the last message of its sequence
+#ifndef APX_EMBEDDED
+   struct apx_sharedPayload_tag *transferPayload; //local files only: copy of the data of a transfer that is sent in fragments, 0 when no transfer is pending
+   uint32_t transferOffset; //local files only: offset of the first byte in transferPayload
+   uint32_t transferNextOffset; //local files only: offset of the next fragment to send
+#endif
 } apx_file_t;
 
 //////////////////////////////////////////////////////////////////////////////
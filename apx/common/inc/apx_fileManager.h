@@ -20,14 +20,16 @@
 #include <semaphore.h>
 #endif
 #include "osmacro.h"
-#include "ringbuf.h"
 #include "apx_allocator.h"
 #include "apx_msg.h"
+#include "apx_msgQueue.h"
 #include "apx_types.h"
 #include "apx_nodeData.h"
 #include "apx_fileMap.h"
 #include "adt_bytearray.h"
 #include "apx_transmitHandler.h"
+#include "apx_sharedPayload.h"
+#include "apx_shmTransport.h"
 
 //////////////////////////////////////////////////////////////////////////////
 // CONSTANTS AND DATA TYPES
@@ -40,7 +42,8 @@ struct apx_nodeManager_tag;
 #define APX_FILEMANAGER_CLIENT_MODE 0
 #define APX_FILEMANAGER_SERVER_MODE 1
 
-
+//called when messages have been queued for a fileManager that has no worker thread of its own
+typedef apx_msgQueue_wakeup_fn apx_fileManager_wakeup_fn;
 
 
 typedef struct apx_fileManager_tag
@@ -48,14 +51,11 @@ typedef struct apx_fileManager_tag
    //OS interaction variables
    THREAD_T workerThread; //local worker thread
    SPINLOCK_T lock;  //variable lock
-   SEMAPHORE_T semaphore; //thread semaphore
+   apx_msgQueue_t messageQueue; //pending messages, lock-free (does not need the lock variable)
 
    //data object, all read/write accesses to these must be protected by the lock variable above
-   rbfs_t ringbuffer; //pending messages
    bool workerThreadValid;
    void *debugInfo;
-   uint8_t *ringbufferData; //strong pointer to raw data used by our ringbuffer
-   uint32_t ringbufferLen; //number of items in ringbuffer
    apx_allocator_t allocator;
 
    apx_fileMap_t localFileMap;
@@ -66,9 +66,28 @@ typedef struct apx_fileManager_tag
    uint32_t curFileStartAddress; //cached start address of last accessed file
    uint32_t curFileEndAddress; //cached end address of of last accessed file
    apx_file_t *curFile; //weak pointer to last accessed file
+   uint32_t streamAddress; //address where the next part of a data message that is received in parts is written
+   uint32_t streamRemain; //data bytes of that message not yet received, 0 when no message is received in parts
+   bool streamMoreBit; //more_bit of that message
+   bool isStreamDiscarded; //that message writes outside of the remote files, its data is skipped
 
    struct apx_nodeManager_tag *nodeManager; //weak pointer to attached nodeManager
+   volatile int32_t numRefs; //references taken by other connections with apx_fileManager_tryRef
+   volatile int32_t isRefClosed; //set by apx_fileManager_closeRefs, no new references are handed out after that
+   volatile int32_t numTransfers; //local files with a fragmented transfer in progress, see apx_fileManager_directWriteCmd
    bool isConnected;
+   bool isConflationEnabled; //when true, writes to non-queued ports only keep the latest value while waiting to be sent
+   bool isDirectDispatchEnabled; //when true, routed writes are sent by the thread that received them while the message queue is empty
+   bool isMultiWriteEnabled; //when true, the remote side accepts RMF_CMD_MULTI_WRITE messages
+   //small port writes waiting to be sent as one RMF_CMD_MULTI_WRITE message. Only accessed by the thread processing the message queue
+   uint8_t multiWriteBuf[APX_FILEMANAGER_MULTI_WRITE_MAX_LEN];
+   int32_t multiWriteLen; //0 when nothing is batched
+   int32_t multiWriteNumRecords;
+   apx_file_t *multiWriteFile; //weak pointer, all records in multiWriteBuf are written into this file
+#if APX_SHM_TRANSPORT_ENABLE
+   apx_shmTransport_t *shmTransport; //weak pointer, port data is exchanged through shared memory when set. Accessed using APX_ATOMIC_LOAD_ACQUIRE
+   MUTEX_T parseLock; //the socket thread and the shared memory receive thread both parse incoming data
+#endif
 #ifdef _WIN32
    unsigned int threadId;
 #endif
@@ -90,21 +109,42 @@ void apx_fileManager_vdelete(void *arg);
 
 void apx_fileManager_start(apx_fileManager_t *self);
 void apx_fileManager_stop(apx_fileManager_t *self);
+void apx_fileManager_startExternal(apx_fileManager_t *self, apx_fileManager_wakeup_fn *wakeupFunc, void *wakeupArg);
+int32_t apx_fileManager_processMessages(apx_fileManager_t *self);
 
 void apx_fileManager_setNodeManager(apx_fileManager_t *self, struct apx_nodeManager_tag *nodeManager); //used to create remote nodes
 void apx_fileManager_setTransmitHandler(apx_fileManager_t *self, apx_transmitHandler_t *handler);
 int32_t apx_fileManager_parseMessage(apx_fileManager_t *self, const uint8_t *msgBuf, int32_t msgLen);
+int32_t apx_fileManager_parseMessageBegin(apx_fileManager_t *self, const uint8_t *msgBuf, int32_t bufLen, int32_t msgLen);
+int32_t apx_fileManager_parseMessageContinue(apx_fileManager_t *self, const uint8_t *dataBuf, int32_t dataLen);
+bool apx_fileManager_isParsingMessage(apx_fileManager_t *self);
 void apx_fileManager_sendFileOpen(apx_fileManager_t *self, uint32_t remoteAddress);
 apx_file_t *apx_fileManager_findRemoteFile(apx_fileManager_t *self, const char *name);
 void apx_fileManager_attachLocalDefinitionFile(apx_fileManager_t *self, apx_file_t *localFile);
 void apx_fileManager_attachLocalPortDataFile(apx_fileManager_t *self, apx_file_t *localFile);
 const char *apx_fileManager_modeString(apx_fileManager_t *self);
 void apx_fileManager_setDebugInfo(apx_fileManager_t *self, void *debugInfo);
+void apx_fileManager_getQueueStats(apx_fileManager_t *self, apx_msgQueueStats_t *stats);
+void apx_fileManager_setConflation(apx_fileManager_t *self, bool enable);
+bool apx_fileManager_isConflationEnabled(apx_fileManager_t *self);
+void apx_fileManager_setDirectDispatch(apx_fileManager_t *self, bool enable);
+bool apx_fileManager_isDirectDispatchEnabled(apx_fileManager_t *self);
+void apx_fileManager_setMultiWrite(apx_fileManager_t *self, bool enable);
+bool apx_fileManager_isMultiWriteEnabled(apx_fileManager_t *self);
+bool apx_fileManager_tryRef(apx_fileManager_t *self);
+void apx_fileManager_unref(apx_fileManager_t *self);
+void apx_fileManager_closeRefs(apx_fileManager_t *self);
+int8_t apx_fileManager_directWriteCmd(apx_fileManager_t *self, apx_file_t *file, const uint8_t *data, apx_offset_t offset, apx_size_t length);
+#if APX_SHM_TRANSPORT_ENABLE
+int8_t apx_fileManager_setSharedMemoryTransport(apx_fileManager_t *self, apx_shmTransport_t *shmTransport);
+#endif
 
 //these messages can be sent to the fileManager to be processed by its internal worker thread
 void apx_fileManager_onConnected(apx_fileManager_t *self);
 void apx_fileManager_onDisconnected(apx_fileManager_t *self);
 void apx_fileManager_triggerFileUpdatedEvent(apx_fileManager_t *self, apx_file_t *file, uint32_t offset, uint32_t length);
 void apx_fileManager_triggerFileWriteCmdEvent(apx_fileManager_t *self, apx_file_t *file, const uint8_t *data, apx_offset_t offset, apx_size_t length);
+void apx_fileManager_triggerSharedWriteCmdEvent(apx_fileManager_t *self, apx_file_t *file, apx_sharedPayload_t *payload, apx_offset_t offset, bool isQueued);
+void apx_fileManager_triggerLatestWriteCmdEvent(apx_fileManager_t *self, apx_file_t *file, const uint8_t *data, apx_offset_t offset, apx_size_t length);
 
 #endif //APX_FILE_MANAGER_H
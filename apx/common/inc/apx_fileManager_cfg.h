@@ -16,7 +16,31 @@
 // CONSTANTS AND DATA TYPES
 //////////////////////////////////////////////////////////////////////////////
 #ifndef APX_CONTEXT_NUM_MESSAGES
-#define APX_CONTEXT_NUM_MESSAGES 1000 //0-65535
+#define APX_CONTEXT_NUM_MESSAGES 1000 //0-65535, messages that fit in the lock-free part of the queue
+#endif
+
+#ifndef APX_CONTEXT_QUEUE_MAX_BYTES
+#define APX_CONTEXT_QUEUE_MAX_BYTES (4u*1024u*1024u) //byte budget for messages (and their data) beyond APX_CONTEXT_NUM_MESSAGES, 0 means unlimited
+#endif
+
+#ifndef APX_CONTEXT_QUEUE_POLICY
+#define APX_CONTEXT_QUEUE_POLICY APX_MSG_QUEUE_POLICY_CONFLATE //what to do when APX_CONTEXT_QUEUE_MAX_BYTES is reached
+#endif
+
+#ifndef APX_FILEMANAGER_MULTI_WRITE_MAX_LEN
+#define APX_FILEMANAGER_MULTI_WRITE_MAX_LEN 1024 //largest RMF_CMD_MULTI_WRITE message, small port writes are batched until it is full
+#endif
+
+#ifndef APX_FILEMANAGER_MAX_FRAGMENT_LEN
+#define APX_FILEMANAGER_MAX_FRAGMENT_LEN 4096 //larger file transfers are sent in fragments of this size, other writes are sent in between
+#endif
+
+#ifndef APX_FILEMANAGER_DIRECT_WRITE_MAX_LEN
+#define APX_FILEMANAGER_DIRECT_WRITE_MAX_LEN 1024 //larger routed writes are always queued, see apx_fileManager_directWriteCmd
+#endif
+
+#ifndef APX_FILEMANAGER_STREAM_MIN_LEN
+#define APX_FILEMANAGER_STREAM_MIN_LEN 4096 //received data messages of at least this length are written to the file as they arrive instead of being buffered whole
 #endif
 
 //////////////////////////////////////////////////////////////////////////////
@@ -5,7 +5,8 @@
 // INCLUDES
 //////////////////////////////////////////////////////////////////////////////
 #include <stdint.h>
-#include "adt_list.h"
+#include "adt_ary.h"
+#include "adt_hash.h"
 #include "apx_file.h"
 
 
@@ -14,7 +15,8 @@
 //////////////////////////////////////////////////////////////////////////////
 typedef struct apx_fileMap_tag
 {
-   adt_list_t fileList; //list of apx_file_t automatically sorted by address
+   adt_ary_t fileList; //strong references to apx_file_t, sorted by address
+   adt_hash_t fileNameMap; //weak references to apx_file_t, the file with the lowest address when names are not unique
 }apx_fileMap_t;
 
 
@@ -30,6 +32,8 @@ int8_t apx_fileMap_insertFile(apx_fileMap_t *self, apx_file_t *pFile);
 int8_t apx_fileMap_removeFile(apx_fileMap_t *self, apx_file_t *pFile);
 apx_file_t *apx_fileMap_findByAddress(apx_fileMap_t *self, uint32_t address);
 apx_file_t *apx_fileMap_findByName(apx_fileMap_t *self, const char *name);
+int32_t apx_fileMap_length(const apx_fileMap_t *self);
+apx_file_t *apx_fileMap_get(const apx_fileMap_t *self, int32_t index);
 
 
 
@@ -0,0 +1,96 @@
+#ifndef APX_FRAME_ACCUMULATOR_H
+#define APX_FRAME_ACCUMULATOR_H
+
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+#if defined(_MSC_PLATFORM_TOOLSET) && (_MSC_PLATFORM_TOOLSET<=110)
+#include "msc_bool.h"
+#else
+#include <stdbool.h>
+#endif
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "osmacro.h"
+#include "adt_bytearray.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#ifndef APX_FRAME_ACCUMULATOR_MAX_LEN
+#define APX_FRAME_ACCUMULATOR_MAX_LEN 16384 //flush when this many bytes are pending (0 disables coalescing)
+#endif
+
+#ifndef APX_FRAME_ACCUMULATOR_MAX_DELAY_MS
+#define APX_FRAME_ACCUMULATOR_MAX_DELAY_MS 10 //flush when the oldest pending frame is this old (0 disables the time threshold)
+#endif
+
+#define APX_FRAME_ACCUMULATOR_MAX_BUFFERS 3 //pending data, frame header and frame payload
+
+/**
+ * one part of the data given to the transmit function
+ */
+typedef struct apx_frameBuffer_tag
+{
+   const uint8_t *data;
+   uint32_t dataLen;
+}apx_frameBuffer_t;
+
+//writes all buffers in order, preferably using a single gather write (writev/sendmsg). Returns 0 on success, -1 on error
+typedef int32_t (apx_frameAccumulator_transmit_fn)(void *arg, const apx_frameBuffer_t *buffers, int32_t numBuffers);
+//called (while holding the accumulator mutex) when the first frame is added to empty pending data and when apx_frameAccumulator_flushExpired
+//finds the pending data is not yet due. apx_frameAccumulator_flushExpired should be called delayMs milliseconds later
+typedef void (apx_frameAccumulator_deadline_fn)(void *arg, uint32_t delayMs);
+
+typedef struct apx_frameAccumulatorStats_tag
+{
+   uint32_t numFrames; //number of frames given to apx_frameAccumulator_append or apx_frameAccumulator_appendGather
+   uint32_t numFlushes; //number of calls made to the transmit function
+   uint32_t numDrainFlushes; //flushes requested by apx_frameAccumulator_flush (sender had nothing more to send)
+   uint32_t numSizeFlushes; //flushes triggered by the byte threshold
+   uint32_t numTimeFlushes; //flushes triggered by the time threshold
+   uint32_t maxFlushLen; //largest number of bytes transmitted in a single flush
+}apx_frameAccumulatorStats_t;
+
+/**
+ * collects already framed messages and transmits them in a single call to the transmit function
+ */
+typedef struct apx_frameAccumulator_tag
+{
+   MUTEX_T mutex; //the transmit function is called while holding the mutex to keep frames in order
+   adt_bytearray_t pending; //framed messages not yet transmitted
+   uint32_t pendingLen; //number of valid bytes in pending
+   uint32_t maxPendingLen;
+   uint32_t maxDelayMs;
+   uint32_t firstFrameTime; //timestamp (ms) of the oldest pending frame
+   apx_frameAccumulatorStats_t stats;
+   apx_frameAccumulator_transmit_fn *transmitFunc;
+   void *transmitArg;
+   apx_frameAccumulator_deadline_fn *deadlineFunc; //optional, without it pending data is only flushed by the next append or flush
+   void *deadlineArg;
+}apx_frameAccumulator_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+void apx_frameAccumulator_create(apx_frameAccumulator_t *self, uint32_t maxPendingLen, uint32_t maxDelayMs, apx_frameAccumulator_transmit_fn *transmitFunc, void *transmitArg);
+void apx_frameAccumulator_destroy(apx_frameAccumulator_t *self);
+int32_t apx_frameAccumulator_append(apx_frameAccumulator_t *self, const uint8_t *frame, uint32_t frameLen);
+int32_t apx_frameAccumulator_appendGather(apx_frameAccumulator_t *self, const uint8_t *header, uint32_t headerLen, const uint8_t *payload, uint32_t payloadLen);
+int32_t apx_frameAccumulator_tryAppendGather(apx_frameAccumulator_t *self, const uint8_t *header, uint32_t headerLen, const uint8_t *payload, uint32_t payloadLen);
+int32_t apx_frameAccumulator_flush(apx_frameAccumulator_t *self);
+void apx_frameAccumulator_setDeadlineHandler(apx_frameAccumulator_t *self, apx_frameAccumulator_deadline_fn *deadlineFunc, void *deadlineArg);
+int32_t apx_frameAccumulator_flushExpired(apx_frameAccumulator_t *self);
+uint32_t apx_frameAccumulator_getPendingLen(apx_frameAccumulator_t *self);
+void apx_frameAccumulator_getStats(apx_frameAccumulator_t *self, apx_frameAccumulatorStats_t *stats);
+
+#endif //APX_FRAME_ACCUMULATOR_H
@@ -32,6 +32,11 @@ typedef struct apx_msg_tag
 #define RMF_MSG_WRITE_NOTIFY          6 //msgData1=offset, msgData2=length, msgData3=apx_file_t *file
 #define RMF_MSG_FILE_WRITE            7 //msgData1=writeAddress, msgData2=length, msgData3=apx_file_t *file, msgData4=data
 #define RMF_MSG_FILE_SEND             8 //msgData3=apx_file_t *file
+#define RMF_MSG_SHARED_WRITE          9 //msgData1=writeAddress, msgData2=length, msgData3=apx_file_t *file, msgData4=apx_sharedPayload_t *payload
+#define RMF_MSG_LATEST_WRITE         10 //msgData1=offset, msgData2=length, msgData3=apx_file_t *file (data is read from the file when sent)
+#define RMF_MSG_WRITE_CONTINUE       11 //msgData3=apx_file_t *file (next fragment of the transfer pending in file)
+#define RMF_MSG_QUEUED_WRITE         12 //same as RMF_MSG_SHARED_WRITE but the destination is a queued port, it's never dropped or conflated
+#define RMF_MSG_FLUSH                13 //no data, wakes up the worker to transmit what apx_fileManager_directWriteCmd appended
 
 
 
@@ -0,0 +1,146 @@
+#ifndef APX_MSG_QUEUE_H
+#define APX_MSG_QUEUE_H
+
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+#if defined(_MSC_PLATFORM_TOOLSET) && (_MSC_PLATFORM_TOOLSET<=110)
+#include "msc_bool.h"
+#else
+#include <stdbool.h>
+#endif
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <semaphore.h>
+#endif
+#include "osmacro.h"
+#include "apx_msg.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#ifndef APX_MSG_QUEUE_USE_FUTEX
+# ifdef __linux__
+#  define APX_MSG_QUEUE_USE_FUTEX 1
+# else
+#  define APX_MSG_QUEUE_USE_FUTEX 0
+# endif
+#endif
+
+#define APX_MSG_QUEUE_CACHE_LINE_SIZE 64
+
+#ifndef APX_MSG_QUEUE_GROW_LEN
+#define APX_MSG_QUEUE_GROW_LEN 256 //number of messages added to the overflow storage each time it grows
+#endif
+
+#ifndef APX_MSG_QUEUE_BACKPRESSURE_TIMEOUT_MS
+#define APX_MSG_QUEUE_BACKPRESSURE_TIMEOUT_MS 100 //longest time a producer waits for room before its message is refused
+#endif
+
+//overflow policies, applied when the overflow storage has reached its byte budget
+#define APX_MSG_QUEUE_POLICY_DROP_OLDEST  0 //discard the oldest droppable message to make room for the new one
+#define APX_MSG_QUEUE_POLICY_CONFLATE     1 //replace a queued message for the same destination, otherwise drop oldest
+#define APX_MSG_QUEUE_POLICY_BACKPRESSURE 2 //make the producer wait for the consumer, refuse the message on timeout
+
+//called when the queue goes from empty to non-empty
+typedef void (apx_msgQueue_wakeup_fn)(void *arg);
+//returns true if the queue is allowed to discard msg
+typedef bool (apx_msgQueue_isDroppable_fn)(void *arg, const apx_msg_t *msg);
+//returns true if newMsg makes queuedMsg obsolete
+typedef bool (apx_msgQueue_isConflatable_fn)(void *arg, const apx_msg_t *queuedMsg, const apx_msg_t *newMsg);
+//returns number of bytes owned by msg outside of the queue (counted against the byte budget)
+typedef uint32_t (apx_msgQueue_getSize_fn)(void *arg, const apx_msg_t *msg);
+//releases resources owned by a message which the queue has discarded
+typedef void (apx_msgQueue_release_fn)(void *arg, const apx_msg_t *msg);
+
+typedef struct apx_msgQueueHandler_tag
+{
+   void *arg;
+   apx_msgQueue_isDroppable_fn *isDroppable; //optional, when not set all messages are droppable
+   apx_msgQueue_isConflatable_fn *isConflatable; //optional, without it APX_MSG_QUEUE_POLICY_CONFLATE behaves as drop oldest
+   apx_msgQueue_getSize_fn *getSize; //optional
+   apx_msgQueue_release_fn *release; //optional
+}apx_msgQueueHandler_t;
+
+typedef struct apx_msgQueueStats_tag
+{
+   uint32_t highWaterMark; //largest number of pending messages seen
+   uint32_t numOverflowed; //messages that did not fit in the ring and were placed in the overflow storage
+   uint32_t numDropped; //messages discarded by the queue or refused by apx_msgQueue_post
+   uint32_t numConflated; //queued messages replaced by a newer message
+   uint32_t numBackpressureWaits; //number of posts that had to wait for the consumer
+   uint32_t overflowBytes; //bytes currently held by the overflow storage
+   uint32_t maxOverflowBytes; //largest value seen of overflowBytes
+}apx_msgQueueStats_t;
+
+typedef struct apx_msgQueueCell_tag
+{
+   volatile uint32_t sequence; //tells producers and consumer whether the cell is free or holds a message
+   apx_msg_t msg;
+}apx_msgQueueCell_t;
+
+/**
+ * Lock-free multi-producer/single-consumer message queue.
+ * Producers never block each other while there is room in the ring. The consumer is only woken up when the queue goes from empty to non-empty.
+ * When the ring is full, messages are placed in an overflow storage that grows in chunks of APX_MSG_QUEUE_GROW_LEN messages
+ * up to a byte budget. Beyond the budget the overflow policy decides what happens.
+ */
+typedef struct apx_msgQueue_tag
+{
+   apx_msgQueueCell_t *cells;
+   uint32_t mask; //number of cells minus one (number of cells is a power of two)
+   apx_msgQueue_wakeup_fn *wakeupFunc; //when set, called instead of waking up a thread blocked in apx_msgQueue_wait
+   void *wakeupArg;
+#if (APX_MSG_QUEUE_USE_FUTEX == 0)
+   SEMAPHORE_T semaphore;
+   SEMAPHORE_T roomSemaphore; //posted by the consumer for each producer waiting for room
+#endif
+   MUTEX_T overflowLock; //protects the overflow variables and stats below
+   apx_msg_t *overflowMsgs; //circular array, only used when the ring is full
+   uint32_t overflowCapacity;
+   uint32_t overflowHead; //index of the oldest message in overflowMsgs
+   uint32_t overflowLen;
+   uint32_t maxBytes; //byte budget of the overflow storage (0 means unlimited)
+   uint8_t policy;
+   apx_msgQueueHandler_t handler;
+   apx_msgQueueStats_t stats;
+   volatile int32_t overflowActive; //non-zero while overflowMsgs holds messages, producers then bypass the ring to keep messages in order
+   volatile int32_t highWaterMark;
+   uint8_t pad0[APX_MSG_QUEUE_CACHE_LINE_SIZE];
+   volatile uint32_t enqueuePos; //written by producers
+   uint8_t pad1[APX_MSG_QUEUE_CACHE_LINE_SIZE];
+   volatile int32_t numPending; //messages posted but not yet consumed. Also used as futex word
+   uint8_t pad2[APX_MSG_QUEUE_CACHE_LINE_SIZE];
+   volatile int32_t numRoomWaiters; //producers waiting for room under APX_MSG_QUEUE_POLICY_BACKPRESSURE
+   volatile int32_t roomSequence; //increased by the consumer when it makes room while producers wait. Also used as futex word
+   uint32_t dequeuePos; //only used by the consumer
+}apx_msgQueue_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+int8_t apx_msgQueue_create(apx_msgQueue_t *self, uint32_t minNumMessages);
+void apx_msgQueue_destroy(apx_msgQueue_t *self);
+void apx_msgQueue_setWakeup(apx_msgQueue_t *self, apx_msgQueue_wakeup_fn *wakeupFunc, void *wakeupArg);
+uint32_t apx_msgQueue_getCapacity(const apx_msgQueue_t *self);
+void apx_msgQueue_setOverflowPolicy(apx_msgQueue_t *self, uint8_t policy, uint32_t maxBytes, const apx_msgQueueHandler_t *handler);
+void apx_msgQueue_getStats(apx_msgQueue_t *self, apx_msgQueueStats_t *stats);
+
+//producer API (any thread)
+int8_t apx_msgQueue_post(apx_msgQueue_t *self, const apx_msg_t *msg);
+int32_t apx_msgQueue_getNumPending(apx_msgQueue_t *self);
+
+//consumer API (one thread at a time)
+void apx_msgQueue_wait(apx_msgQueue_t *self);
+bool apx_msgQueue_remove(apx_msgQueue_t *self, apx_msg_t *msg);
+int32_t apx_msgQueue_consumed(apx_msgQueue_t *self, int32_t numMessages);
+
+#endif //APX_MSG_QUEUE_H
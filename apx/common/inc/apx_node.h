@@ -14,6 +14,7 @@
 
 struct apx_node_t;
 struct apx_nodeInfo_tag;
+struct apx_nodeTemplate_tag;
 
 typedef struct apx_node_t{
    adt_ary_t datatypeList;
@@ -24,6 +25,7 @@ typedef struct apx_node_t{
    int16_t lastPortType;
    char *name;
    struct apx_nodeInfo_tag *nodeInfo;
+   struct apx_nodeTemplate_tag *nodeTemplate; //strong reference when the ports belong to a shared template (see apx_nodeTemplate_createNode), otherwise NULL
    bool isFinalized;
    apx_attributeParser_t attributeParser;
 } apx_node_t;
@@ -37,6 +39,7 @@ void apx_node_delete(apx_node_t *self);
 void apx_node_vdelete(void *arg);
 void apx_node_create(apx_node_t *self,const char *name);
 void apx_node_destroy(apx_node_t *self);
+apx_node_t *apx_node_clone(const apx_node_t *other);
 
 //node functions
 void apx_node_setName(apx_node_t *self, const char *name);
@@ -80,6 +80,14 @@ typedef struct apx_nodeData_tag
    struct apx_file_tag *outPortDataFile;
    struct apx_file_tag *inPortDataFile;
    struct apx_nodeInfo_tag *nodeInfo;
+#ifndef APX_EMBEDDED
+   bool isStale; //true while a remote node waits for its client to resume a lost connection, see apx_nodeManager_setGracePeriod
+   uint32_t staleSinceMs; //time when the node became stale
+   uint8_t *inPortResumeFlags; //strong reference, one flag per byte of inPortData written while the client could not receive it
+   uint8_t *outPortResumeData; //strong reference, outPortData from before the client resumed. NULL when no session is being resumed
+   uint8_t *outPortResumeFlags; //strong reference, one flag per byte of outPortData the resumed client has not sent again yet
+   uint32_t outPortResumeRemain; //number of flags still set in outPortResumeFlags
+#endif
 } apx_nodeData_t;
 
 
@@ -109,6 +117,8 @@ void apx_nodeData_unlockInPortData(apx_nodeData_t *self);
 void apx_nodeData_outPortDataNotify(apx_nodeData_t *self, uint32_t offset, uint32_t len);
 int8_t apx_nodeData_writeInPortData(apx_nodeData_t *self, const uint8_t *src, uint32_t offset, uint32_t len);
 int8_t apx_nodeData_writeOutPortData(apx_nodeData_t *self, const uint8_t *src, uint32_t offset, uint32_t len);
+int8_t apx_nodeData_writeInPortDataPending(apx_nodeData_t *self, const uint8_t *src, uint32_t offset, uint32_t len);
+void apx_nodeData_clearInPortDataPending(apx_nodeData_t *self, uint32_t offset);
 int8_t apx_nodeData_writeDefinitionData(apx_nodeData_t *self, const uint8_t *src, uint32_t offset, uint32_t len);
 void apx_nodeData_triggerInPortDataWritten(apx_nodeData_t *self, uint32_t offset, uint32_t len);
 void apx_nodeData_setInPortDataFile(apx_nodeData_t *self, struct apx_file_tag *file);
@@ -118,5 +128,10 @@ void apx_nodeData_setFileManager(apx_nodeData_t *self, struct apx_es_fileManager
 #else
 void apx_nodeData_setFileManager(apx_nodeData_t *self, struct apx_fileManager_tag *fileManager);
 void apx_nodeData_setNodeInfo(apx_nodeData_t *self, struct apx_nodeInfo_tag *nodeInfo);
+int8_t apx_nodeData_writeInPortDataResume(apx_nodeData_t *self, const uint8_t *src, uint32_t offset, uint32_t len);
+uint8_t *apx_nodeData_takeInPortResumeFlags(apx_nodeData_t *self);
+int8_t apx_nodeData_beginOutPortResume(apx_nodeData_t *self);
+bool apx_nodeData_isOutPortResumeUnchanged(apx_nodeData_t *self, uint32_t offset, uint32_t len);
+void apx_nodeData_clearOutPortResume(apx_nodeData_t *self, uint32_t offset, uint32_t len);
 #endif
 #endif //APX_NODE_DATA_H
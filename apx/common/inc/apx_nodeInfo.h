@@ -7,6 +7,7 @@
 #include "apx_node.h"
 #include "apx_port.h"
 #include "apx_portref.h"
+#include "apx_portrefSet.h"
 #include "apx_portDataBuffer.h"
 #include "adt_ary.h"
 #include "apx_portDataMap.h"
@@ -25,15 +26,18 @@ typedef struct apx_nodeInfo_tag
    apx_node_t *node; //weak/strong pointer to associated node
    bool isWeakRef_node; //selects the weak/strong property of node
    adt_ary_t requireConnectors; //array of strong references to apx_portref_t elements
-   adt_ary_t provideConnectors; //array of strong references to adt_ary_t elements, where each element in turn is an array of apx_portref_t elements
-   apx_portDataMap_t inDataMap; //describes the length and offset of each of the input/require ports
-   apx_portDataMap_t outDataMap; //describes the length and offset of each of the output/provide ports
+   adt_ary_t provideConnectors; //array of strong references to apx_portrefSet_t elements, where each element in turn is a set of apx_portref_t elements
+   apx_portDataMap_t *inDataMap; //describes the length and offset of each of the input/require ports
+   apx_portDataMap_t *outDataMap; //describes the length and offset of each of the output/provide ports
+   bool isWeakRef_dataMaps; //true when the data maps belong to the node template, false when nodeInfo owns them
    int32_t inPortDataLen; //number of bytes needed to create nodeData->inPortDataBuf
    int32_t outPortDataLen; //number of bytes needed to create nodeData->outPortDataBuf
    uint8_t *requirePortFlags; //internal flags for require ports (used for dirty flags when ports are connected/disconnected) (one byte per port)
    uint8_t *providePortFlags; //internal flags for provide ports (used for dirty flags when port are connected/disconnected) (one byte per port)
    uint32_t pendingRequirePortFlags; //number of modified requirePortFlags since last check (this is an optimization to reduce some linear search time)
    uint32_t pendingProvidePortFlags; //number of modified providePortFlags since last check (this is an optimization to reduce some linear search time)
+   adt_ary_t *dirtyList; //weak pointer to a list owned by apx_router_t, this nodeInfo is added to it when a port flag is set
+   bool isDirty; //true while this nodeInfo is in dirtyList
    apx_dataTriggerTable_t outDataTriggerTable; //trigger table routines
    struct apx_nodeData_tag *nodeData; //weak pointer to associated nodeData
 } apx_nodeInfo_t;
@@ -73,6 +77,8 @@ int32_t apx_nodeInfo_getOutPortDataOffset(apx_nodeInfo_t *self, int32_t provideP
 int32_t apx_nodeInfo_getInPortDataLen(apx_nodeInfo_t *self);
 int32_t apx_nodeInfo_getOutPortDataLen(apx_nodeInfo_t *self);
 apx_dataTriggerFunction_t *apx_nodeInfo_getTriggerFunction(const apx_nodeInfo_t *self, int32_t offset);
+apx_dataTriggerFunction_t *apx_nodeInfo_getNextTriggerFunction(const apx_nodeInfo_t *self, int32_t offset);
 void apx_nodeInfo_copyInitDataFromProvideConnectors(apx_nodeInfo_t *self);
 void apx_nodeInfo_setNodeData(apx_nodeInfo_t *self, apx_nodeData_t *nodeData);
+void apx_nodeInfo_setDirtyList(apx_nodeInfo_t *self, adt_ary_t *dirtyList);
 #endif //APX_NODE_INFO_H
@@ -11,6 +11,7 @@
 #include "apx_nodeInfo.h"
 #include "apx_stream.h"
 #include "apx_file.h"
+#include "apx_definitionPipeline.h"
 #ifdef _WIN32
 #include <Windows.h>
 #else
@@ -23,22 +24,35 @@
 // CONSTANTS AND DATA TYPES
 //////////////////////////////////////////////////////////////////////////////
 
+#define APX_NODE_MANAGER_NUM_SHARDS 16 //must be a power of 2
+
 //forward declarations
 struct apx_fileManager_tag;
 struct apx_file_tag;
 struct apx_router_tag;
 
-typedef struct apx_nodeManager_tag
+/**
+ * remote nodes whose names hash to the same shard. Connections creating nodes with different names rarely share a shard lock.
+ */
+typedef struct apx_nodeManagerShard_tag
 {
-   apx_parser_t parser;
    adt_hash_t nodeInfoMap; //hash of strong references to apx_nodeInfo_t
-   apx_istream_t apx_istream; //helper structure for parser
-   struct apx_router_tag *router;
    adt_hash_t remoteNodeDataMap; //hash containing strong references to apx_nodeData_t remotely connected nodes, only used in server mode
+   MUTEX_T lock; //protects the maps in this shard
+}apx_nodeManagerShard_t;
+
+typedef struct apx_nodeManager_tag
+{
+   apx_nodeManagerShard_t shards[APX_NODE_MANAGER_NUM_SHARDS]; //remote nodes, sharded by hash of node name
+   struct apx_router_tag *router;
    adt_hash_t localNodeDataMap; //hash containing weak references to apx_nodeData_t for locally connected nodes. only used in client mode
    adt_list_t fileManagerList; //linked list of attached file managers (so far there is a one-to-one relationship between connection and fileManager)
    int8_t debugMode;
-   MUTEX_T lock; //locking mechanism
+   uint32_t gracePeriodMs; //time a node is kept after its connection is lost, 0 deletes it immediately
+   MUTEX_T lock; //protects localNodeDataMap and fileManagerList
+   MUTEX_T routerLock; //serializes linking of nodes in the router, the only step of node creation that is shared by all connections
+   apx_definitionPipeline_t definitionPipeline; //turns received definitions into nodes, processes them inline unless workers are started
+   apx_definitionCache_t definitionCache; //parsed definitions by digest, lets clients with a known definition skip its transfer
 }apx_nodeManager_t;
 
 //////////////////////////////////////////////////////////////////////////////
@@ -59,5 +73,9 @@ void apx_nodeManager_attachLocalNode(apx_nodeManager_t *self, apx_nodeData_t *no
 void apx_nodeManager_attachFileManager(apx_nodeManager_t *self, struct apx_fileManager_tag *fileManager);
 void apx_nodeManager_detachFileManager(apx_nodeManager_t *self, struct apx_fileManager_tag *fileManager);
 void apx_nodeManager_setDebugMode(apx_nodeManager_t *self, int8_t debugMode);
+void apx_nodeManager_setGracePeriod(apx_nodeManager_t *self, uint32_t gracePeriodMs);
+int32_t apx_nodeManager_expireStaleNodes(apx_nodeManager_t *self);
+int8_t apx_nodeManager_startDefinitionWorkers(apx_nodeManager_t *self, int32_t numWorkers);
+void apx_nodeManager_stopDefinitionWorkers(apx_nodeManager_t *self);
 
 #endif //APX_NODE_MANAGER_H
@@ -0,0 +1,50 @@
+#ifndef APX_NODE_TEMPLATE_H
+#define APX_NODE_TEMPLATE_H
+
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+#include "apx_node.h"
+#include "apx_portDataMap.h"
+#include "sha256.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#define APX_NODE_TEMPLATE_DIGEST_SIZE SHA256_DIGEST_SIZE
+
+/**
+ * The immutable part of a node: ports, signatures, data maps and init data.
+ * Nodes with the same data types and ports (in the same order) share one template, only the node name may differ.
+ * Templates are kept in a process wide table and are deleted when the last reference is released.
+ * Nothing in a template may be changed once apx_nodeTemplate_intern has returned it.
+ */
+typedef struct apx_nodeTemplate_tag
+{
+   apx_node_t *node; //strong reference, finalized. Owns the ports that all nodes created from this template point to
+   apx_portDataMap_t inDataMap; //offset and length of each require port
+   apx_portDataMap_t outDataMap; //offset and length of each provide port
+   int32_t inPortDataLen;
+   int32_t outPortDataLen;
+   uint8_t *inPortInitData; //strong reference (malloc), initial value of the inPortData buffer. NULL when node has no require ports
+   uint8_t digest[APX_NODE_TEMPLATE_DIGEST_SIZE]; //digest of the data types and ports, key in the template table
+   int32_t refCount; //protected by the template table lock
+}apx_nodeTemplate_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+apx_nodeTemplate_t *apx_nodeTemplate_intern(apx_node_t *node);
+apx_node_t *apx_nodeTemplate_shareNode(apx_node_t *node);
+apx_node_t *apx_nodeTemplate_createNode(apx_nodeTemplate_t *self, const char *name);
+void apx_nodeTemplate_acquire(apx_nodeTemplate_t *self);
+void apx_nodeTemplate_release(apx_nodeTemplate_t *self);
+int32_t apx_nodeTemplate_getNumTemplates(void);
+
+#endif //APX_NODE_TEMPLATE_H
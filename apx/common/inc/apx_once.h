@@ -0,0 +1,41 @@
+#ifndef APX_ONCE_H
+#define APX_ONCE_H
+
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+ * one-time initialization of module state, e.g. static tables created on first use.
+ * Declare the flag as: static apx_once_t m_initOnce = APX_ONCE_INIT;
+ */
+#ifdef _WIN32
+typedef INIT_ONCE apx_once_t;
+#define APX_ONCE_INIT INIT_ONCE_STATIC_INIT
+#else
+typedef pthread_once_t apx_once_t;
+#define APX_ONCE_INIT PTHREAD_ONCE_INIT
+#endif
+
+typedef void (apx_once_fn)(void);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+void apx_once(apx_once_t *once, apx_once_fn *initFunc);
+
+#endif //APX_ONCE_H
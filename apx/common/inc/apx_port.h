@@ -3,6 +3,7 @@
 //simple port - data port with one data element
 #include "apx_dataSignature.h"
 #include "apx_portAttributes.h"
+#include "apx_portSignatureTable.h"
 
 #define APX_REQUIRE_PORT 0
 #define APX_PROVIDE_PORT 1
@@ -12,7 +13,8 @@ typedef struct apx_port_tag{
 	char *dataSignature; //underived data signature, this string usually contains just a type reference, e.g. "T[0]"
 	apx_dataSignature_t derivedDsg; //this is the true data signature, e.g. "C(0.7)"
 	apx_portAttributes_t *portAttributes; //port attributes object, includes the raw attributes string
-	char *portSignature; //full port signature, excluding the initial 'R' or 'P'
+	char *portSignature; //full port signature, excluding the initial 'R' or 'P'. Points into apx_portSignatureTable once interned
+	int32_t portSignatureId; //dense id from apx_portSignatureTable, APX_PORT_SIGNATURE_ID_INVALID until the signature is interned
 	uint8_t portType; //APX_REQUIRE_PORT or APX_PROVIDE_PORT
 	int32_t portIndex; //index of the port 0..len(ports) where it resides on its parent node
 }apx_port_t;
@@ -25,10 +27,13 @@ apx_port_t* apx_providePort_new(const char *name, const char* dataSignature, con
 apx_port_t* apx_requirePort_new(const char *name, const char* dataSignature, const char *attributes);
 void apx_port_delete(apx_port_t *self);
 void apx_port_vdelete(void *arg);
+apx_port_t* apx_port_clone(const apx_port_t *other);
 
 void apx_port_setDerivedDataSignature(apx_port_t *self, const char *dataSignature);
 const char *apx_port_derivePortSignature(apx_port_t *self);
 const char *apx_port_getPortSignature(apx_port_t *self);
+int32_t apx_port_internPortSignature(apx_port_t *self);
+int32_t apx_port_getPortSignatureId(apx_port_t *self);
 int32_t apx_port_getPackLen(apx_port_t *self);
 void apx_port_setPortIndex(apx_port_t *self, int32_t portIndex);
 int32_t  apx_port_getPortIndex(apx_port_t *self);
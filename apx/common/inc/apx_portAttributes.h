@@ -32,6 +32,7 @@ void apx_portAttributes_destroy(apx_portAttributes_t *self);
 apx_portAttributes_t* apx_portAttributes_new(const char *attr);
 void apx_portAttributes_delete(apx_portAttributes_t *self);
 void apx_portAttributes_vdelete(void *arg);
+apx_portAttributes_t* apx_portAttributes_clone(const apx_portAttributes_t *other);
 void apx_portAttributes_clearInitValue(apx_portAttributes_t *self);
 
 //////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,34 @@
+#ifndef APX_PORT_SIGNATURE_TABLE_H
+#define APX_PORT_SIGNATURE_TABLE_H
+
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#define APX_PORT_SIGNATURE_ID_INVALID -1
+
+/**
+ * Process wide symbol table of port signatures.
+ * Each unique port signature string is stored once and given a dense integer id (0, 1, 2, ...).
+ * Every call to apx_portSignatureTable_intern takes a reference which is given back with apx_portSignatureTable_release.
+ * The string is freed when its last reference is released, its id is then given to the next new signature.
+ */
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+int32_t apx_portSignatureTable_intern(const char *portSignature, const char **internedSignature);
+void apx_portSignatureTable_release(int32_t id);
+const char *apx_portSignatureTable_getSignature(int32_t id);
+int32_t apx_portSignatureTable_length(void);
+
+#endif //APX_PORT_SIGNATURE_TABLE_H
@@ -15,6 +15,7 @@ typedef struct apx_portref_tag
 {
    apx_node_t *node;
    apx_port_t *port;
+   int32_t listIndex; //position in the list of the apx_portrefSet_t holding this portref
 }apx_portref_t;
 
 //////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,56 @@
+#ifndef APX_PORTREF_SET_H
+#define APX_PORTREF_SET_H
+
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+#if defined(_MSC_PLATFORM_TOOLSET) && (_MSC_PLATFORM_TOOLSET<=110)
+#include "msc_bool.h"
+#else
+#include <stdbool.h>
+#endif
+#include "adt_ary.h"
+#include "apx_portref.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+ * set of unique apx_portref_t elements which remembers insertion order.
+ * index is a hash table used for insert, remove and membership tests in O(1) (amortized).
+ * A removed element leaves an empty slot in list, the slots are compacted the next time the list is read by index
+ * or when more than half of the list is empty.
+ */
+typedef struct apx_portrefSet_tag
+{
+   adt_ary_t list; //strong references to apx_portref_t in insertion order, NULL for removed elements until compacted
+   apx_portref_t **index; //weak references to the elements of list, open addressing by node and port address
+   int32_t indexAllocLen; //0 or a power of 2
+   int32_t numElements;
+   int32_t numRemoved; //number of NULL slots in list
+}apx_portrefSet_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+void apx_portrefSet_create(apx_portrefSet_t *self);
+void apx_portrefSet_destroy(apx_portrefSet_t *self);
+apx_portrefSet_t *apx_portrefSet_new(void);
+void apx_portrefSet_delete(apx_portrefSet_t *self);
+void apx_portrefSet_vdelete(void *arg);
+
+int8_t apx_portrefSet_insert(apx_portrefSet_t *self, apx_node_t *node, apx_port_t *port);
+bool apx_portrefSet_remove(apx_portrefSet_t *self, apx_node_t *node, apx_port_t *port);
+bool apx_portrefSet_contains(const apx_portrefSet_t *self, apx_node_t *node, apx_port_t *port);
+int32_t apx_portrefSet_length(const apx_portrefSet_t *self);
+apx_portref_t *apx_portrefSet_get(apx_portrefSet_t *self, int32_t index);
+adt_ary_t *apx_portrefSet_getList(apx_portrefSet_t *self);
+
+#endif //APX_PORTREF_SET_H
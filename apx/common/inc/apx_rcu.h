@@ -0,0 +1,40 @@
+#ifndef APX_RCU_H
+#define APX_RCU_H
+
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Process wide read-copy-update support for the routing tables.
+ *
+ * Readers (the data path) enclose their use of published routing data in apx_rcu_readLock/apx_rcu_readUnlock, this never blocks.
+ * Writers (topology changes) never modify published data. They build a replacement, publish it with an atomic pointer store and
+ * hand the replaced object to apx_rcu_retire. Retired objects are freed by apx_rcu_synchronize once every reader that
+ * could still see them has left its read-side section (the grace period).
+ *
+ * apx_rcu_synchronize blocks the calling writer. It must not be called from inside a read-side section.
+ */
+
+typedef void (apx_rcu_free_fn)(void *arg);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+int32_t apx_rcu_readLock(void);
+void apx_rcu_readUnlock(int32_t readIndex);
+void apx_rcu_retire(void *arg, apx_rcu_free_fn *freeFunc);
+void apx_rcu_synchronize(void);
+int32_t apx_rcu_getNumRetired(void);
+
+#endif //APX_RCU_H
@@ -7,6 +7,7 @@
 #include "apx_node.h"
 #include "adt_ary.h"
 #include "apx_portref.h"
+#include "apx_portrefSet.h"
 
 
 //////////////////////////////////////////////////////////////////////////////
@@ -14,8 +15,8 @@
 //////////////////////////////////////////////////////////////////////////////
 typedef struct portMapEntry_tag
 {
-   adt_ary_t requirePorts; //list of apx_portref_t (all require ports that maps to this signal)
-   adt_ary_t providePorts; //list of apx_portref_t (all provide ports that maps to this signal)
+   apx_portrefSet_t requirePorts; //set of apx_portref_t (all require ports that maps to this signal)
+   apx_portrefSet_t providePorts; //set of apx_portref_t (all provide ports that maps to this signal), in the order they were attached
 }apx_routerPortMapEntry_t;
 
 //////////////////////////////////////////////////////////////////////////////
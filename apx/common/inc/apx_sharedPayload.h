@@ -0,0 +1,37 @@
+#ifndef APX_SHARED_PAYLOAD_H
+#define APX_SHARED_PAYLOAD_H
+
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+ * reference counted data buffer. Used when the same port data is written to many destinations,
+ * each destination holds a reference instead of a private copy of the data.
+ */
+typedef struct apx_sharedPayload_tag
+{
+   volatile int32_t refCount;
+   uint32_t dataLen;
+   uint8_t *data; //points to memory allocated directly after the struct
+}apx_sharedPayload_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+apx_sharedPayload_t *apx_sharedPayload_new(uint32_t dataLen);
+void apx_sharedPayload_ref(apx_sharedPayload_t *self);
+void apx_sharedPayload_unref(apx_sharedPayload_t *self);
+int32_t apx_sharedPayload_getRefCount(apx_sharedPayload_t *self);
+
+#endif //APX_SHARED_PAYLOAD_H
@@ -0,0 +1,100 @@
+#ifndef APX_SHM_TRANSPORT_H
+#define APX_SHM_TRANSPORT_H
+
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+#include <stddef.h>
+#if defined(_MSC_PLATFORM_TOOLSET) && (_MSC_PLATFORM_TOOLSET<=110)
+#include "msc_bool.h"
+#else
+#include <stdbool.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#ifndef APX_SHM_TRANSPORT_ENABLE
+#ifdef __linux__
+#define APX_SHM_TRANSPORT_ENABLE 1 //memfd, eventfd and pidfd_getfd are only available on Linux
+#else
+#define APX_SHM_TRANSPORT_ENABLE 0
+#endif
+#endif
+
+#if APX_SHM_TRANSPORT_ENABLE
+#include <pthread.h>
+#include <sys/types.h>
+#include "osmacro.h"
+
+#ifndef APX_SHM_NUM_NOTIFICATIONS
+#define APX_SHM_NUM_NOTIFICATIONS 1024 //number of notifications in each direction, must be a power of 2
+#endif
+
+#ifndef APX_SHM_DATA_SIZE
+#define APX_SHM_DATA_SIZE 65536 //bytes of port data in each direction. Larger writes are sent over the socket
+#endif
+
+#ifndef APX_SHM_SEND_TIMEOUT_MS
+#define APX_SHM_SEND_TIMEOUT_MS 100 //longest time a sender waits for the receiver to make room
+#endif
+
+#define APX_SHM_GREETING_HEADER "Shm-Transport" //greeting header line offered by clients: "Shm-Transport: <pid> <memfd> <eventfd> <eventfd>"
+
+#define APX_SHM_CHANNEL_CLIENT_TO_SERVER 0
+#define APX_SHM_CHANNEL_SERVER_TO_CLIENT 1
+#define APX_SHM_NUM_CHANNELS             2
+
+//called by the receive thread for each write found in the shared memory, data points into the mapping
+typedef void (apx_shmTransport_received_fn)(void *arg, uint32_t address, const uint8_t *data, uint32_t dataLen);
+
+struct apx_shmRegion_tag;
+
+/**
+ * Shared memory transport for port data between a client and a server on the same host.
+ * The client creates a memfd mapping which the server duplicates using pidfd_getfd. The mapping holds one channel per direction.
+ * Each channel is a single-producer, single-consumer ring of (offset, length) notifications pointing into a data area,
+ * a sleeping receiver is woken up using the eventfd of the channel. RMF commands still go through the socket.
+ */
+typedef struct apx_shmTransport_tag
+{
+   struct apx_shmRegion_tag *region; //the shared mapping
+   size_t regionSize;
+   int memFd;
+   int eventFd[APX_SHM_NUM_CHANNELS];
+   uint8_t txChannel;
+   uint8_t rxChannel;
+   bool isCreator; //true on the client side
+   MUTEX_T txLock; //serializes writers, the channel itself only supports a single producer
+   THREAD_T receiveThread;
+   bool receiveThreadValid;
+   volatile int32_t isRunning;
+   apx_shmTransport_received_fn *receivedFunc;
+   void *receivedArg;
+}apx_shmTransport_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+int8_t apx_shmTransport_create(apx_shmTransport_t *self);
+int8_t apx_shmTransport_attach(apx_shmTransport_t *self, pid_t pid, int memFd, int eventFd0, int eventFd1);
+void apx_shmTransport_destroy(apx_shmTransport_t *self);
+apx_shmTransport_t *apx_shmTransport_new(void);
+apx_shmTransport_t *apx_shmTransport_newFromGreeting(const char *headerValue, pid_t peerPid);
+void apx_shmTransport_delete(apx_shmTransport_t *self);
+
+int32_t apx_shmTransport_getGreetingLine(apx_shmTransport_t *self, char *buf, int32_t bufLen);
+bool apx_shmTransport_isAttached(apx_shmTransport_t *self);
+int8_t apx_shmTransport_startReceiver(apx_shmTransport_t *self, apx_shmTransport_received_fn *receivedFunc, void *receivedArg);
+void apx_shmTransport_stopReceiver(apx_shmTransport_t *self);
+int32_t apx_shmTransport_processReceived(apx_shmTransport_t *self);
+int8_t apx_shmTransport_write(apx_shmTransport_t *self, uint32_t address, const uint8_t *data, uint32_t dataLen);
+
+#endif //APX_SHM_TRANSPORT_ENABLE
+#endif //APX_SHM_TRANSPORT_H
@@ -20,6 +20,9 @@ typedef struct apx_transmitHandler_tag
    int32_t (*getSendAvail)(void *arg); //this is used to query the transmitHandler how many bytes that can be provided by getSendBuffer
    uint8_t* (*getSendBuffer)(void *arg, int32_t msgLen); //transmitHandler shall attempt to allocate a buffer of appropriate length
    int32_t (*send)(void *arg, int32_t offset, int32_t msgLen); //buffer is provided by transmit handler
+   int32_t (*flush)(void *arg); //optional, transmits messages that send has held back for coalescing (can be NULL)
+   int32_t (*sendGather)(void *arg, const uint8_t *header, int32_t headerLen, const uint8_t *payload, int32_t payloadLen); //optional, sends header followed by payload without first copying them into a send buffer (can be NULL)
+   int32_t (*trySendGather)(void *arg, const uint8_t *header, int32_t headerLen, const uint8_t *payload, int32_t payloadLen); //optional, same as sendGather but never blocks, returns -1 with errno set to EAGAIN instead (can be NULL)
 } apx_transmitHandler_t;
 //////////////////////////////////////////////////////////////////////////////
 // GLOBAL VARIABLES
@@ -158,19 +158,55 @@ uint8_t *apx_allocator_alloc(apx_allocator_t *self, size_t size)
    return data;
 }
 
+/**
+ * When the worker thread is running the actual free is deferred to the garbage collector thread.
+ * Without a worker thread (see apx_fileManager_startExternal) the memory is released immediately in the calling thread.
+ */
 void apx_allocator_free(apx_allocator_t *self, uint8_t *ptr, uint32_t size)
 {
-   if (self != 0)
+   if ( (self != 0) && (self->workerThreadValid == false) )
+   {
+      if (ptr != 0)
+      {
+         if (size<=SMALL_OBJECT_MAX_SIZE)
+         {
+            SPINLOCK_ENTER(self->lock);
+            soa_free(&self->soa,ptr,size);
+            SPINLOCK_LEAVE(self->lock);
+         }
+         else
+         {
+            free(ptr);
+         }
+      }
+   }
+   else if (self != 0)
    {
+      uint8_t result;
       rbf_data_t data;
       data.ptr=ptr;
       data.size=size;
       //1. enqueue message
       SPINLOCK_ENTER(self->lock);
-      rbfs_insert(&self->messages,(const uint8_t*) &data);
+      result = rbfs_insert(&self->messages,(const uint8_t*) &data);
+      if ( (result != E_BUF_OK) && (ptr != 0) )
+      {
+         //the worker thread is behind, free the memory here instead of losing it
+         if (size<=SMALL_OBJECT_MAX_SIZE)
+         {
+            soa_free(&self->soa,ptr,size);
+         }
+         else
+         {
+            free(ptr);
+         }
+      }
       SPINLOCK_LEAVE(self->lock);
-      //2. wake worker thread
-      SEMAPHORE_POST(self->semaphore);
+      //2. wake worker thread (only when there is something for it to remove)
+      if (result == E_BUF_OK)
+      {
+         SEMAPHORE_POST(self->semaphore);
+      }
    }
 }
 
@@ -229,7 +265,9 @@ static THREAD_PROTO(threadTask,arg)
             {
                if (data.size<=SMALL_OBJECT_MAX_SIZE)
                {
+                  SPINLOCK_ENTER(self->lock);
                   soa_free(&self->soa,data.ptr,data.size);
+                  SPINLOCK_LEAVE(self->lock);
                }
                else
                {
@@ -57,6 +57,42 @@ void apx_dataElement_vdelete(void *arg)
    apx_dataElement_delete((apx_dataElement_t*) arg);
 }
 
+/**
+ * returns a deep copy of other, including its child elements
+ */
+apx_dataElement_t *apx_dataElement_clone(const apx_dataElement_t *other)
+{
+   if (other != 0)
+   {
+      apx_dataElement_t *self = apx_dataElement_new(other->baseType, other->name);
+      if (self != 0)
+      {
+         self->arrayLen = other->arrayLen;
+         self->packLen = other->packLen;
+         self->min = other->min;
+         self->max = other->max;
+         if (other->childElements != 0)
+         {
+            int32_t i;
+            int32_t numChildren = adt_ary_length(other->childElements);
+            for (i=0; i<numChildren; i++)
+            {
+               apx_dataElement_t *child = apx_dataElement_clone((const apx_dataElement_t*) adt_ary_value(other->childElements, i));
+               if (child == 0)
+               {
+                  apx_dataElement_delete(self);
+                  return (apx_dataElement_t*) 0;
+               }
+               adt_ary_push(self->childElements, child);
+            }
+         }
+      }
+      return self;
+   }
+   errno = EINVAL;
+   return (apx_dataElement_t*) 0;
+}
+
 int8_t apx_dataElement_create(apx_dataElement_t *self, int8_t baseType, const char *name)
 {
    if (self != 0)
@@ -115,6 +115,41 @@ void apx_dataSignature_destroy(apx_dataSignature_t *self)
    }
 }
 
+/**
+ * creates self as a deep copy of other without parsing the signature string again.
+ * returns 0 on sucess, -1 on failure (also sets errno)
+ */
+int8_t apx_dataSignature_createCopy(apx_dataSignature_t *self, const apx_dataSignature_t *other)
+{
+   if ( (self != 0) && (other != 0) )
+   {
+      self->str = 0;
+      self->dataElement = 0;
+      self->dsgType = other->dsgType;
+      if (other->str != 0)
+      {
+         self->str=STRDUP(other->str);
+         if (self->str == 0)
+         {
+            errno = ENOMEM;
+            return -1;
+         }
+      }
+      if (other->dataElement != 0)
+      {
+         self->dataElement = apx_dataElement_clone(other->dataElement);
+         if (self->dataElement == 0)
+         {
+            apx_dataSignature_destroy(self);
+            return -1;
+         }
+      }
+      return 0;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
 uint32_t apx_dataSignature_packLen(apx_dataSignature_t *self)
 {
    if (self != 0)
@@ -11,6 +11,8 @@
 #include "apx_dataTrigger.h"
 #include "apx_nodeInfo.h"
 #include "apx_logging.h"
+#include "apx_atomic.h"
+#include "apx_rcu.h"
 #ifdef MEM_LEAK_CHECK
 #include "CMemLeak.h"
 #endif
@@ -25,6 +27,9 @@
 // LOCAL FUNCTION PROTOTYPES
 //////////////////////////////////////////////////////////////////////////////
 //static void apx_dataTriggerTable_build(apx_dataTriggerTable_t *self);
+static apx_dataTriggerSnapshot_t *apx_dataTriggerSnapshot_new(int32_t maxNumTriggers);
+static void apx_dataTriggerSnapshot_vdelete(void *arg);
+static int32_t apx_dataTriggerSnapshot_lowerBound(const apx_dataTriggerSnapshot_t *self, uint32_t offset);
 
 //////////////////////////////////////////////////////////////////////////////
 // GLOBAL VARIABLES
@@ -45,7 +50,11 @@ int8_t apx_dataTriggerTable_create(apx_dataTriggerTable_t *self, apx_nodeInfo_t
    if ( (self != 0) && (nodeInfo != 0) )
    {
       int32_t numProvidePorts;
-      self->lookupTable = 0;
+      self->snapshot = (apx_dataTriggerSnapshot_t*) 0;
+      self->pending = (apx_dataTriggerSnapshot_t*) 0;
+      self->updateDepth = 0;
+      self->maxNumTriggers = 0;
+      self->outDataLen = 0;
       self->nodeInfo=nodeInfo;
       self->writeHookFunc=writeHookFunc;
       self->writeHookUserArg=writeHookUserArg;
@@ -55,24 +64,13 @@ int8_t apx_dataTriggerTable_create(apx_dataTriggerTable_t *self, apx_nodeInfo_t
          apx_portDataMap_t *outDataMap = apx_nodeInfo_getOutDataMap(nodeInfo);
          if (outDataMap != 0)
          {
-            size_t dataSize;
-            self->lookupTableLen = (uint32_t) outDataMap->totalLen; //lookupTableLen = number of bytes in the outDataMap
-            dataSize=sizeof(apx_dataTriggerFunction_t*) * self->lookupTableLen;
-            //allocate lookupTableLen*sizeof(pointer), i.e. one pointer for each byte in the outDataMap.
-            //This is where we trade memory for speed. We get constant lookup time, O(1) by using a little extra RAM.
-            self->lookupTable = (apx_dataTriggerFunction_t**) malloc(dataSize);
-            if (self->lookupTable == 0)
-            {
-               APX_LOG_ERROR("[APX_DATA_TRIGGER] apx_dataTriggerTable_create: malloc failed");
-               errno=ENOMEM;
-               return -1;
-            }
-            else
-            {
-               memset(self->lookupTable,0,dataSize);
-            }
+            self->outDataLen = (uint32_t) outDataMap->totalLen;
+            //each provide port has at most one trigger function, snapshots hold one pointer per provide port.
+            //Lookups are done using binary search on srcOffset, O(log n) where n is number of provide ports.
+            self->maxNumTriggers = numProvidePorts;
          }
       }
+      adt_ary_create(&self->replaced, (void(*)(void*)) 0);
       return 0;
    }
    errno=EINVAL;
@@ -83,23 +81,34 @@ void apx_dataTriggerTable_destroy(apx_dataTriggerTable_t *self)
 {
    if (self != 0)
    {
-      if (self->lookupTable != 0)
+      //there must not be any readers left, everything is deleted immediately
+      apx_dataTriggerSnapshot_t *current = (self->pending != 0)? self->pending : self->snapshot;
+      int32_t i;
+      int32_t end;
+      if (current != 0)
       {
-         apx_dataTriggerFunction_t **pBegin;
-         apx_dataTriggerFunction_t **pNext;
-         apx_dataTriggerFunction_t **pEnd;
-
-         pBegin = self->lookupTable;
-         pEnd = pBegin + self->lookupTableLen;
-         for (pNext=pBegin;pNext<pEnd;pNext++)
+         for (i=0;i<current->numTriggers;i++)
          {
-            if (*pNext != 0)
-            {
-               apx_dataTriggerFunction_delete(*pNext);
-            }
+            apx_dataTriggerFunction_delete(current->triggerIndex[i]);
          }
-         free(self->lookupTable);
       }
+      end = adt_ary_length(&self->replaced);
+      for (i=0;i<end;i++)
+      {
+         apx_dataTriggerFunction_delete((apx_dataTriggerFunction_t*) adt_ary_value(&self->replaced, i));
+      }
+      adt_ary_destroy(&self->replaced);
+      if (self->pending != 0)
+      {
+         free(self->pending);
+         self->pending = (apx_dataTriggerSnapshot_t*) 0;
+      }
+      if (self->snapshot != 0)
+      {
+         free(self->snapshot);
+         self->snapshot = (apx_dataTriggerSnapshot_t*) 0;
+      }
+      self->updateDepth = 0;
    }
 }
 
@@ -138,6 +147,66 @@ void apx_dataTriggerTable_vdelete(void *arg)
    apx_dataTriggerTable_delete( (apx_dataTriggerTable_t*) arg);
 }
 
+/**
+ * starts a batch of trigger updates. Readers keep using the published snapshot until the outermost apx_dataTriggerTable_commitUpdate.
+ * Calls can be nested. Only one writer at a time may update a table.
+ */
+void apx_dataTriggerTable_beginUpdate(apx_dataTriggerTable_t *self)
+{
+   if (self != 0)
+   {
+      if ( (self->updateDepth++) == 0 )
+      {
+         apx_dataTriggerSnapshot_t *current = self->snapshot;
+         assert(self->pending == 0);
+         self->pending = apx_dataTriggerSnapshot_new(self->maxNumTriggers);
+         if (self->pending == 0)
+         {
+            APX_LOG_ERROR("[APX_DATA_TRIGGER] %s", "apx_dataTriggerTable_beginUpdate: malloc failed");
+         }
+         else if (current != 0)
+         {
+            memcpy(self->pending->triggerIndex, current->triggerIndex, sizeof(apx_dataTriggerFunction_t*) * current->numTriggers);
+            self->pending->numTriggers = current->numTriggers;
+         }
+      }
+   }
+}
+
+/**
+ * publishes the changes made since the outermost apx_dataTriggerTable_beginUpdate.
+ * The replaced snapshot and trigger functions are handed to apx_rcu_retire, they are freed after the next grace period.
+ */
+void apx_dataTriggerTable_commitUpdate(apx_dataTriggerTable_t *self)
+{
+   if ( (self != 0) && (self->updateDepth > 0) )
+   {
+      if ( ((--self->updateDepth) == 0) && (self->pending != 0) )
+      {
+         int32_t i;
+         int32_t end;
+         apx_dataTriggerSnapshot_t *old = self->snapshot;
+         APX_ATOMIC_STORE_RELEASE(self->snapshot, self->pending);
+         self->pending = (apx_dataTriggerSnapshot_t*) 0;
+         //new readers can no longer reach the old objects, retire them only now so they can't be freed while still published
+         if (old != 0)
+         {
+            apx_rcu_retire(old, apx_dataTriggerSnapshot_vdelete);
+         }
+         end = adt_ary_length(&self->replaced);
+         for (i=0;i<end;i++)
+         {
+            apx_rcu_retire(adt_ary_value(&self->replaced, i), apx_dataTriggerFunction_vdelete);
+         }
+         adt_ary_clear(&self->replaced);
+      }
+   }
+}
+
+/**
+ * replaces the trigger function of port. Published trigger functions are never modified since readers may be executing them.
+ * Unless called between apx_dataTriggerTable_beginUpdate and apx_dataTriggerTable_commitUpdate the change is published immediately.
+ */
 void apx_dataTriggerTable_updateTrigger(apx_dataTriggerTable_t *self, apx_port_t *port)
 {
    if ( (self != 0) && (port != 0) )
@@ -152,68 +221,173 @@ void apx_dataTriggerTable_updateTrigger(apx_dataTriggerTable_t *self, apx_port_t
       {
          apx_portDataMapEntry_t *dataMapEntry;
          apx_dataTriggerFunction_t *triggerFunction;
+         apx_dataTriggerSnapshot_t *snapshot;
+         int32_t index;
          adt_ary_t *connectorList = apx_nodeInfo_getProvidePortConnectorList(nodeInfo, port->portIndex);
 
-         dataMapEntry = apx_portDataMap_getEntry(&nodeInfo->outDataMap, port->portIndex);
+         dataMapEntry = apx_portDataMap_getEntry(nodeInfo->outDataMap, port->portIndex);
          assert(dataMapEntry != 0);
-         assert(dataMapEntry->offset < (int32_t)self->lookupTableLen);
-         triggerFunction = self->lookupTable[dataMapEntry->offset];
+         assert(dataMapEntry->offset < (int32_t)self->outDataLen);
+         triggerFunction = apx_dataTriggerFunction_new(dataMapEntry->offset, dataMapEntry->length);
          if (triggerFunction == 0)
          {
-            triggerFunction = apx_dataTriggerFunction_new(dataMapEntry->offset, dataMapEntry->length);
-            if (triggerFunction != 0)
-            {
-               self->lookupTable[dataMapEntry->offset] = triggerFunction;
-            }
-            else
-            {
-               APX_LOG_ERROR("[APX_DATA_TRIGGER] apx_dataTriggerFunction_new returned NULL");
-            }
+            APX_LOG_ERROR("[APX_DATA_TRIGGER] apx_dataTriggerFunction_new returned NULL");
+            return;
          }
-         assert(triggerFunction != 0);
-         adt_ary_clear(&triggerFunction->writeInfoList);
-         if (connectorList != 0)
+         if ( (connectorList != 0) && (adt_ary_length(connectorList) > 0) )
          {
             int32_t i;
             int32_t numConnectors = adt_ary_length(connectorList);
+            //the function is rebuilt on every topology change, store all its writeInfo elements in a single allocation
+            triggerFunction->writeInfoBuf = (apx_dataWriteInfo_t*) malloc(sizeof(apx_dataWriteInfo_t) * numConnectors);
+            if (triggerFunction->writeInfoBuf == 0)
+            {
+               APX_LOG_ERROR("[APX_DATA_TRIGGER] %s", "apx_dataTriggerTable_updateTrigger: malloc failed");
+               apx_dataTriggerFunction_delete(triggerFunction);
+               return;
+            }
+            adt_ary_destructorEnable(&triggerFunction->writeInfoList, 0);
+            adt_ary_resize(&triggerFunction->writeInfoList, numConnectors);
             for (i=0;i<numConnectors;i++)
             {
                apx_nodeInfo_t *requesterNodeInfo;
                int32_t requesterPortIndex;
-               apx_dataWriteInfo_t *writeInfo;
+               apx_dataWriteInfo_t *writeInfo = &triggerFunction->writeInfoBuf[i];
                apx_portDataMapEntry_t *requesterDataMapEntry;
+               bool isQueued;
                apx_portref_t *portref = (apx_portref_t*) *adt_ary_get(connectorList, i);
                requesterNodeInfo = portref->node->nodeInfo;
                requesterPortIndex =portref->port->portIndex;
-               requesterDataMapEntry = apx_portDataMap_getEntry(&requesterNodeInfo->inDataMap, requesterPortIndex);
-               writeInfo = apx_dataWriteInfo_new(requesterNodeInfo, requesterDataMapEntry->offset);
-               if (writeInfo != 0)
-               {
-                  adt_ary_push(&triggerFunction->writeInfoList,writeInfo);
-               }
+               requesterDataMapEntry = apx_portDataMap_getEntry(requesterNodeInfo->inDataMap, requesterPortIndex);
+               isQueued = ( (portref->port->portAttributes != 0) && (portref->port->portAttributes->isQueued == true) );
+               apx_dataWriteInfo_create(writeInfo, requesterNodeInfo, requesterDataMapEntry->offset, isQueued);
+               adt_ary_set(&triggerFunction->writeInfoList, i, writeInfo);
             }
          }
+         apx_dataTriggerTable_beginUpdate(self);
+         snapshot = self->pending;
+         if (snapshot == 0)
+         {
+            apx_dataTriggerFunction_delete(triggerFunction);
+         }
+         else
+         {
+            index = apx_dataTriggerSnapshot_lowerBound(snapshot, (uint32_t) dataMapEntry->offset);
+            if ( (index < snapshot->numTriggers) && (snapshot->triggerIndex[index]->srcOffset == (uint32_t) dataMapEntry->offset) )
+            {
+               adt_ary_push(&self->replaced, snapshot->triggerIndex[index]);
+            }
+            else
+            {
+               //keep triggerIndex sorted, this only happens the first time a provide port gets connected
+               assert(snapshot->numTriggers < self->maxNumTriggers);
+               memmove(&snapshot->triggerIndex[index+1], &snapshot->triggerIndex[index], sizeof(apx_dataTriggerFunction_t*) * (snapshot->numTriggers-index));
+               snapshot->numTriggers++;
+            }
+            snapshot->triggerIndex[index] = triggerFunction;
+         }
+         apx_dataTriggerTable_commitUpdate(self);
       }
    }
 }
 
+/**
+ * returns the published snapshot (NULL if there are no trigger functions).
+ * The snapshot and its trigger functions stay valid until the caller leaves its read-side section (see apx_rcu.h).
+ */
+const apx_dataTriggerSnapshot_t *apx_dataTriggerTable_getSnapshot(const apx_dataTriggerTable_t *self)
+{
+   if (self != 0)
+   {
+      return (const apx_dataTriggerSnapshot_t*) APX_ATOMIC_LOAD_ACQUIRE(self->snapshot);
+   }
+   return (const apx_dataTriggerSnapshot_t*) 0;
+}
+
+/**
+ * returns the trigger function of the port that starts at offset, or NULL if there is none
+ */
 apx_dataTriggerFunction_t *apx_dataTriggerTable_get(const apx_dataTriggerTable_t *self, int32_t offset)
 {
-   if ( (self != 0) && (offset>=0) && ( ((uint32_t)offset) < (self->lookupTableLen) ) )
+   if ( (self != 0) && (offset>=0) && ( ((uint32_t)offset) < (self->outDataLen) ) )
    {
-      return self->lookupTable[offset];
+      const apx_dataTriggerSnapshot_t *snapshot = apx_dataTriggerTable_getSnapshot(self);
+      if (snapshot != 0)
+      {
+         int32_t index = apx_dataTriggerSnapshot_lowerBound(snapshot, (uint32_t) offset);
+         if ( (index < snapshot->numTriggers) && (snapshot->triggerIndex[index]->srcOffset == (uint32_t) offset) )
+         {
+            return snapshot->triggerIndex[index];
+         }
+      }
+      return (apx_dataTriggerFunction_t*) 0;
    }
    errno=EINVAL;
    return (apx_dataTriggerFunction_t*) 0;
 }
 
+/**
+ * returns the first trigger function whose port starts at or after offset, or NULL if there is none.
+ * Use this to skip over byte ranges that have no trigger function in a single step.
+ */
+apx_dataTriggerFunction_t *apx_dataTriggerTable_getNext(const apx_dataTriggerTable_t *self, int32_t offset)
+{
+   if (self != 0)
+   {
+      return apx_dataTriggerSnapshot_getNext(apx_dataTriggerTable_getSnapshot(self), offset);
+   }
+   errno=EINVAL;
+   return (apx_dataTriggerFunction_t*) 0;
+}
+
+int32_t apx_dataTriggerTable_getNumTriggers(const apx_dataTriggerTable_t *self)
+{
+   if (self != 0)
+   {
+      const apx_dataTriggerSnapshot_t *snapshot = apx_dataTriggerTable_getSnapshot(self);
+      return (snapshot != 0)? snapshot->numTriggers : 0;
+   }
+   errno=EINVAL;
+   return -1;
+}
+
+/**
+ * returns number of bytes allocated for the trigger index (trigger functions themselves not included)
+ */
+uint32_t apx_dataTriggerTable_getMemoryUsage(const apx_dataTriggerTable_t *self)
+{
+   if (self != 0)
+   {
+      return (uint32_t) (sizeof(apx_dataTriggerFunction_t*) * self->maxNumTriggers);
+   }
+   return 0;
+}
+
+//dataTriggerSnapshot
+/**
+ * same as apx_dataTriggerTable_getNext but on a snapshot the caller already holds, self can be NULL (no trigger functions)
+ */
+apx_dataTriggerFunction_t *apx_dataTriggerSnapshot_getNext(const apx_dataTriggerSnapshot_t *self, int32_t offset)
+{
+   if ( (self != 0) && (offset>=0) )
+   {
+      int32_t index = apx_dataTriggerSnapshot_lowerBound(self, (uint32_t) offset);
+      if (index < self->numTriggers)
+      {
+         return self->triggerIndex[index];
+      }
+   }
+   return (apx_dataTriggerFunction_t*) 0;
+}
+
 //dataWriteInfo
-void apx_dataWriteInfo_create(apx_dataWriteInfo_t *self,apx_nodeInfo_t *nodeInfo, uint32_t destOffset)
+void apx_dataWriteInfo_create(apx_dataWriteInfo_t *self,apx_nodeInfo_t *nodeInfo, uint32_t destOffset, bool isQueued)
 {
    if ( (self != 0) && (nodeInfo != 0) )
    {
       self->requesterNodeInfo=nodeInfo;
       self->destOffset = destOffset;
+      self->isQueued = isQueued;
    }
 }
 
@@ -222,13 +396,13 @@ void apx_dataWriteInfo_destroy(apx_dataWriteInfo_t *self)
    //nothing to do
 }
 
-apx_dataWriteInfo_t *apx_dataWriteInfo_new(apx_nodeInfo_t *nodeInfo, uint32_t destOffset)
+apx_dataWriteInfo_t *apx_dataWriteInfo_new(apx_nodeInfo_t *nodeInfo, uint32_t destOffset, bool isQueued)
 {
    if (nodeInfo != 0 )
    {
       apx_dataWriteInfo_t *self = (apx_dataWriteInfo_t*) malloc(sizeof(apx_dataWriteInfo_t));
       if(self != 0){
-         apx_dataWriteInfo_create(self,nodeInfo, destOffset);
+         apx_dataWriteInfo_create(self,nodeInfo, destOffset, isQueued);
       }
       else{
          errno = ENOMEM;
@@ -260,6 +434,7 @@ void apx_dataTriggerFunction_create(apx_dataTriggerFunction_t *self, uint32_t sr
       self->srcOffset=srcOffset;
       self->dataLength=dataLength;
       adt_ary_create(&self->writeInfoList,apx_dataWriteInfo_vdelete);
+      self->writeInfoBuf = (apx_dataWriteInfo_t*) 0;
    }
 }
 
@@ -268,6 +443,11 @@ void apx_dataTriggerFunction_destroy(apx_dataTriggerFunction_t *self)
    if (self != 0)
    {
       adt_ary_destroy(&self->writeInfoList);
+      if (self->writeInfoBuf != 0)
+      {
+         free(self->writeInfoBuf);
+         self->writeInfoBuf = (apx_dataWriteInfo_t*) 0;
+      }
    }
 }
 
@@ -305,3 +485,50 @@ void apx_dataTriggerFunction_vdelete(void *arg)
 // LOCAL FUNCTIONS
 //////////////////////////////////////////////////////////////////////////////
 
+/**
+ * allocates an empty snapshot with room for maxNumTriggers, triggerIndex is placed in the same memory block
+ */
+static apx_dataTriggerSnapshot_t *apx_dataTriggerSnapshot_new(int32_t maxNumTriggers)
+{
+   apx_dataTriggerSnapshot_t *self = (apx_dataTriggerSnapshot_t*) malloc(sizeof(apx_dataTriggerSnapshot_t) + sizeof(apx_dataTriggerFunction_t*) * maxNumTriggers);
+   if (self != 0)
+   {
+      self->triggerIndex = (apx_dataTriggerFunction_t**) (self+1);
+      self->numTriggers = 0;
+   }
+   else
+   {
+      errno = ENOMEM;
+   }
+   return self;
+}
+
+/**
+ * frees the snapshot only, its trigger functions are owned by the table
+ */
+static void apx_dataTriggerSnapshot_vdelete(void *arg)
+{
+   free(arg);
+}
+
+/**
+ * returns index of the first entry in triggerIndex with srcOffset >= offset (numTriggers if there is no such entry)
+ */
+static int32_t apx_dataTriggerSnapshot_lowerBound(const apx_dataTriggerSnapshot_t *self, uint32_t offset)
+{
+   int32_t low = 0;
+   int32_t high = self->numTriggers;
+   while (low < high)
+   {
+      int32_t mid = low + ((high-low) >> 1);
+      if (self->triggerIndex[mid]->srcOffset < offset)
+      {
+         low = mid+1;
+      }
+      else
+      {
+         high = mid;
+      }
+   }
+   return low;
+}
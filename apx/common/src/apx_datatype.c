@@ -83,6 +83,9 @@ int8_t apx_datatype_create(apx_datatype_t *self, const char *name, const char *d
       }
       pNext=self->pAlloc;
       pEnd=self->pAlloc+self->allocLen;
+      self->name=0;
+      self->dsg=0;
+      self->attr=0;
       if (nameLen > 0)
       {
          self->name=pNext;
@@ -0,0 +1,370 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <errno.h>
+#include <malloc.h>
+#include <assert.h>
+#include <string.h>
+#include "apx_definitionCache.h"
+#include "apx_logging.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#define APX_DEFINITION_CACHE_KEY_LEN (APX_DEFINITION_DIGEST_SIZE*2)
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static void apx_definitionCache_makeKey(const uint8_t *digest, char *key);
+static void apx_definitionCache_unlink(apx_definitionCache_t *self, apx_definitionCacheEntry_t *entry);
+static void apx_definitionCache_pushFront(apx_definitionCache_t *self, apx_definitionCacheEntry_t *entry);
+static bool apx_definitionCache_unref(apx_definitionCacheEntry_t *entry);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+/**
+ * creates a new entry holding a copy of definitionBuf. Nodes are added with apx_definitionCacheEntry_addNode
+ */
+apx_definitionCacheEntry_t *apx_definitionCacheEntry_new(const uint8_t *digest, const uint8_t *definitionBuf, int32_t definitionLen)
+{
+   apx_definitionCacheEntry_t *self;
+   if ( (digest == 0) || (definitionBuf == 0) || (definitionLen <= 0) )
+   {
+      errno = EINVAL;
+      return (apx_definitionCacheEntry_t*) 0;
+   }
+   self = (apx_definitionCacheEntry_t*) malloc(sizeof(apx_definitionCacheEntry_t));
+   if (self == 0)
+   {
+      errno = ENOMEM;
+      return (apx_definitionCacheEntry_t*) 0;
+   }
+   self->definitionBuf = (uint8_t*) malloc(definitionLen);
+   if (self->definitionBuf == 0)
+   {
+      free(self);
+      errno = ENOMEM;
+      return (apx_definitionCacheEntry_t*) 0;
+   }
+   memcpy(self->digest, digest, APX_DEFINITION_DIGEST_SIZE);
+   memcpy(self->definitionBuf, definitionBuf, definitionLen);
+   self->definitionLen = definitionLen;
+   adt_ary_create(&self->nodes, apx_node_vdelete);
+   self->refCount = 1;
+   self->prev = (apx_definitionCacheEntry_t*) 0;
+   self->next = (apx_definitionCacheEntry_t*) 0;
+   return self;
+}
+
+void apx_definitionCacheEntry_delete(apx_definitionCacheEntry_t *self)
+{
+   if (self != 0)
+   {
+      adt_ary_destroy(&self->nodes);
+      free(self->definitionBuf);
+      free(self);
+   }
+}
+
+/**
+ * adds a node with the name and node template of node to the entry, node must have been created from a node template.
+ * Returns 0 on success, -1 on failure
+ */
+int8_t apx_definitionCacheEntry_addNode(apx_definitionCacheEntry_t *self, const apx_node_t *node)
+{
+   if ( (self != 0) && (node != 0) && (node->nodeTemplate != 0) )
+   {
+      apx_node_t *cachedNode = apx_nodeTemplate_createNode(node->nodeTemplate, node->name);
+      if (cachedNode == 0)
+      {
+         return -1;
+      }
+      adt_ary_push(&self->nodes, cachedNode);
+      return 0;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+int32_t apx_definitionCacheEntry_getNumNodes(const apx_definitionCacheEntry_t *self)
+{
+   if (self != 0)
+   {
+      return adt_ary_length(&self->nodes);
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+const apx_node_t *apx_definitionCacheEntry_getNode(const apx_definitionCacheEntry_t *self, int32_t index)
+{
+   if ( (self != 0) && (index >= 0) && (index < adt_ary_length(&self->nodes)) )
+   {
+      return (const apx_node_t*) adt_ary_value(&self->nodes, index);
+   }
+   return (const apx_node_t*) 0;
+}
+
+void apx_definitionCache_create(apx_definitionCache_t *self, int32_t capacity)
+{
+   if (self != 0)
+   {
+      adt_hash_create(&self->entryMap, (void(*)(void*)) 0);
+      self->head = (apx_definitionCacheEntry_t*) 0;
+      self->tail = (apx_definitionCacheEntry_t*) 0;
+      self->numEntries = 0;
+      self->capacity = capacity;
+      self->numHits = 0;
+      self->numMisses = 0;
+      MUTEX_INIT(self->lock);
+   }
+}
+
+/**
+ * deletes all entries. Every acquired entry must have been released before this is called
+ */
+void apx_definitionCache_destroy(apx_definitionCache_t *self)
+{
+   if (self != 0)
+   {
+      apx_definitionCacheEntry_t *entry = self->head;
+      while (entry != 0)
+      {
+         apx_definitionCacheEntry_t *next = entry->next;
+         entry->prev = (apx_definitionCacheEntry_t*) 0;
+         entry->next = (apx_definitionCacheEntry_t*) 0;
+         if (apx_definitionCache_unref(entry) == true)
+         {
+            apx_definitionCacheEntry_delete(entry);
+         }
+         entry = next;
+      }
+      adt_hash_destroy(&self->entryMap);
+      MUTEX_DESTROY(self->lock);
+   }
+}
+
+/**
+ * moves ownership of entry to the cache, evicting the least recently used entries when the cache is full.
+ * entry is deleted when an entry with the same digest is already cached or the capacity is 0
+ */
+void apx_definitionCache_insert(apx_definitionCache_t *self, apx_definitionCacheEntry_t *entry)
+{
+   if ( (self != 0) && (entry != 0) )
+   {
+      char key[APX_DEFINITION_CACHE_KEY_LEN+1];
+      apx_definitionCacheEntry_t *evicted = (apx_definitionCacheEntry_t*) 0;
+      bool isInserted = false;
+      apx_definitionCache_makeKey(entry->digest, key);
+      MUTEX_LOCK(self->lock);
+      if ( (self->capacity > 0) && (adt_hash_get(&self->entryMap, key, 0) == 0) )
+      {
+         adt_hash_set(&self->entryMap, key, 0, entry);
+         apx_definitionCache_pushFront(self, entry);
+         self->numEntries++;
+         isInserted = true;
+         while (self->numEntries > self->capacity)
+         {
+            apx_definitionCacheEntry_t *lru = self->tail;
+            char lruKey[APX_DEFINITION_CACHE_KEY_LEN+1];
+            assert(lru != 0);
+            apx_definitionCache_makeKey(lru->digest, lruKey);
+            adt_hash_remove(&self->entryMap, lruKey, 0);
+            apx_definitionCache_unlink(self, lru);
+            self->numEntries--;
+            if (apx_definitionCache_unref(lru) == true)
+            {
+               //the evicted entries are chained through next and deleted after the lock is released
+               lru->next = evicted;
+               evicted = lru;
+            }
+         }
+      }
+      MUTEX_UNLOCK(self->lock);
+      if (isInserted == false)
+      {
+         apx_definitionCacheEntry_delete(entry);
+      }
+      while (evicted != 0)
+      {
+         apx_definitionCacheEntry_t *next = evicted->next;
+         apx_definitionCacheEntry_delete(evicted);
+         evicted = next;
+      }
+   }
+}
+
+/**
+ * returns the entry with the given digest (marked as most recently used) or NULL when not cached.
+ * The entry stays valid, even if it is evicted, until it is given to apx_definitionCache_release
+ */
+apx_definitionCacheEntry_t *apx_definitionCache_acquire(apx_definitionCache_t *self, const uint8_t *digest)
+{
+   if ( (self != 0) && (digest != 0) )
+   {
+      char key[APX_DEFINITION_CACHE_KEY_LEN+1];
+      void **ppVal;
+      apx_definitionCacheEntry_t *entry = (apx_definitionCacheEntry_t*) 0;
+      apx_definitionCache_makeKey(digest, key);
+      MUTEX_LOCK(self->lock);
+      ppVal = adt_hash_get(&self->entryMap, key, 0);
+      if (ppVal != 0)
+      {
+         entry = (apx_definitionCacheEntry_t*) *ppVal;
+         entry->refCount++;
+         if (self->head != entry)
+         {
+            apx_definitionCache_unlink(self, entry);
+            apx_definitionCache_pushFront(self, entry);
+         }
+         self->numHits++;
+      }
+      else
+      {
+         self->numMisses++;
+      }
+      MUTEX_UNLOCK(self->lock);
+      return entry;
+   }
+   return (apx_definitionCacheEntry_t*) 0;
+}
+
+void apx_definitionCache_release(apx_definitionCache_t *self, apx_definitionCacheEntry_t *entry)
+{
+   if ( (self != 0) && (entry != 0) )
+   {
+      bool isUnused;
+      MUTEX_LOCK(self->lock);
+      isUnused = apx_definitionCache_unref(entry);
+      MUTEX_UNLOCK(self->lock);
+      if (isUnused == true)
+      {
+         apx_definitionCacheEntry_delete(entry);
+      }
+   }
+}
+
+int32_t apx_definitionCache_length(apx_definitionCache_t *self)
+{
+   if (self != 0)
+   {
+      int32_t retval;
+      MUTEX_LOCK(self->lock);
+      retval = self->numEntries;
+      MUTEX_UNLOCK(self->lock);
+      return retval;
+   }
+   return 0;
+}
+
+uint32_t apx_definitionCache_getNumHits(apx_definitionCache_t *self)
+{
+   if (self != 0)
+   {
+      uint32_t retval;
+      MUTEX_LOCK(self->lock);
+      retval = self->numHits;
+      MUTEX_UNLOCK(self->lock);
+      return retval;
+   }
+   return 0;
+}
+
+uint32_t apx_definitionCache_getNumMisses(apx_definitionCache_t *self)
+{
+   if (self != 0)
+   {
+      uint32_t retval;
+      MUTEX_LOCK(self->lock);
+      retval = self->numMisses;
+      MUTEX_UNLOCK(self->lock);
+      return retval;
+   }
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+/**
+ * adt_hash keys are strings, the digest is written in hex
+ */
+static void apx_definitionCache_makeKey(const uint8_t *digest, char *key)
+{
+   static const char hexDigits[] = "0123456789abcdef";
+   uint32_t i;
+   for (i=0; i<APX_DEFINITION_DIGEST_SIZE; i++)
+   {
+      *key++ = hexDigits[digest[i] >> 4];
+      *key++ = hexDigits[digest[i] & 0x0F];
+   }
+   *key = 0;
+}
+
+/**
+ * the caller must hold self->lock
+ */
+static void apx_definitionCache_unlink(apx_definitionCache_t *self, apx_definitionCacheEntry_t *entry)
+{
+   if (entry->prev != 0)
+   {
+      entry->prev->next = entry->next;
+   }
+   else
+   {
+      self->head = entry->next;
+   }
+   if (entry->next != 0)
+   {
+      entry->next->prev = entry->prev;
+   }
+   else
+   {
+      self->tail = entry->prev;
+   }
+   entry->prev = (apx_definitionCacheEntry_t*) 0;
+   entry->next = (apx_definitionCacheEntry_t*) 0;
+}
+
+/**
+ * the caller must hold self->lock
+ */
+static void apx_definitionCache_pushFront(apx_definitionCache_t *self, apx_definitionCacheEntry_t *entry)
+{
+   entry->prev = (apx_definitionCacheEntry_t*) 0;
+   entry->next = self->head;
+   if (self->head != 0)
+   {
+      self->head->prev = entry;
+   }
+   else
+   {
+      self->tail = entry;
+   }
+   self->head = entry;
+}
+
+/**
+ * the caller must hold the cache lock. Returns true when the last reference was dropped
+ */
+static bool apx_definitionCache_unref(apx_definitionCacheEntry_t *entry)
+{
+   assert(entry->refCount > 0);
+   entry->refCount--;
+   return (entry->refCount == 0)? true : false;
+}
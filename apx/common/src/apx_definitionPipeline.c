@@ -0,0 +1,768 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <errno.h>
+#include <malloc.h>
+#include <assert.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <process.h>
+#endif
+#include "apx_definitionPipeline.h"
+#include "apx_nodeTemplate.h"
+#include "apx_parser.h"
+#include "apx_stream.h"
+#include "apx_logging.h"
+#include "sha256.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+//jobDone must be waited on with the lock that protects the queue, on Windows that lock is a critical section
+#ifdef _MSC_VER
+#define APX_PIPELINE_LOCK_INIT(x) InitializeCriticalSection(&(x))
+#define APX_PIPELINE_LOCK_DESTROY(x) DeleteCriticalSection(&(x))
+#define APX_PIPELINE_LOCK(x) EnterCriticalSection(&(x))
+#define APX_PIPELINE_UNLOCK(x) LeaveCriticalSection(&(x))
+#define APX_PIPELINE_COND_INIT(x) InitializeConditionVariable(&(x))
+#define APX_PIPELINE_COND_DESTROY(x)
+#define APX_PIPELINE_COND_WAIT(c,l) SleepConditionVariableCS(&(c), &(l), INFINITE)
+#define APX_PIPELINE_COND_BROADCAST(x) WakeAllConditionVariable(&(x))
+#else
+#define APX_PIPELINE_LOCK_INIT(x) MUTEX_INIT(x)
+#define APX_PIPELINE_LOCK_DESTROY(x) MUTEX_DESTROY(x)
+#define APX_PIPELINE_LOCK(x) MUTEX_LOCK(x)
+#define APX_PIPELINE_UNLOCK(x) MUTEX_UNLOCK(x)
+#define APX_PIPELINE_COND_INIT(x) pthread_cond_init(&(x), 0)
+#define APX_PIPELINE_COND_DESTROY(x) pthread_cond_destroy(&(x))
+#define APX_PIPELINE_COND_WAIT(c,l) pthread_cond_wait(&(c), &(l))
+#define APX_PIPELINE_COND_BROADCAST(x) pthread_cond_broadcast(&(x))
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static apx_definitionJob_t *apx_definitionJob_new(const uint8_t *definitionBuf, int32_t definitionLen, const uint8_t *digest, void *owner);
+static void apx_definitionJob_delete(apx_definitionJob_t *self, apx_definitionCache_t *cache);
+static void apx_preparedNode_delete(apx_preparedNode_t *self);
+static void apx_preparedNode_vdelete(void *arg);
+static int8_t apx_definitionPipeline_submit(apx_definitionPipeline_t *self, apx_definitionJob_t *job);
+static void apx_definitionPipeline_prepare(apx_definitionPipeline_t *self, apx_definitionJob_t *job);
+static void apx_definitionPipeline_instantiate(apx_definitionJob_t *job);
+static void apx_definitionPipeline_cacheJob(apx_definitionPipeline_t *self, apx_definitionJob_t *job);
+static apx_preparedNode_t *apx_definitionPipeline_prepareNode(apx_node_t *node);
+static void apx_definitionPipeline_parse(apx_parser_t *parser, const uint8_t *definitionBuf, int32_t definitionLen);
+static void apx_definitionPipeline_link(apx_definitionPipeline_t *self, apx_definitionJob_t *job);
+static int32_t apx_definitionPipeline_claimWorkerSlot(apx_definitionPipeline_t *self, void *owner);
+static bool apx_definitionPipeline_isOwnerActive(const apx_definitionPipeline_t *self, void *owner);
+static void apx_definitionPipeline_joinWorker(apx_definitionPipeline_t *self, int32_t index);
+static THREAD_PROTO(workerTask,arg);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+void apx_definitionPipeline_create(apx_definitionPipeline_t *self, apx_definitionPipeline_link_fn *linkFunc, void *linkArg)
+{
+   if (self != 0)
+   {
+      int32_t i;
+      self->linkFunc = linkFunc;
+      self->linkArg = linkArg;
+      self->cache = (apx_definitionCache_t*) 0;
+      for (i=0; i<APX_DEFINITION_PIPELINE_MAX_WORKERS; i++)
+      {
+#ifdef _WIN32
+         self->workerThreads[i] = INVALID_HANDLE_VALUE;
+#else
+         self->workerThreads[i] = 0;
+#endif
+         self->activeOwners[i] = (void*) 0;
+      }
+      self->numWorkers = 0;
+      self->isRunning = false;
+      self->queueHead = (apx_definitionJob_t*) 0;
+      self->queueTail = (apx_definitionJob_t*) 0;
+      self->numPendingJobs = 0;
+      APX_PIPELINE_LOCK_INIT(self->lock);
+      APX_PIPELINE_COND_INIT(self->jobDone);
+      MUTEX_INIT(self->linkLock);
+      SEMAPHORE_CREATE(self->semaphore);
+   }
+}
+
+void apx_definitionPipeline_destroy(apx_definitionPipeline_t *self)
+{
+   if (self != 0)
+   {
+      apx_definitionPipeline_stop(self);
+      APX_PIPELINE_COND_DESTROY(self->jobDone);
+      APX_PIPELINE_LOCK_DESTROY(self->lock);
+      MUTEX_DESTROY(self->linkLock);
+      SEMAPHORE_DESTROY(self->semaphore);
+   }
+}
+
+/**
+ * starts numWorkers worker threads for the parse, finalize and init data stages.
+ * With numWorkers set to 0 the pipeline keeps processing definitions in the thread that posts them.
+ */
+int8_t apx_definitionPipeline_start(apx_definitionPipeline_t *self, int32_t numWorkers)
+{
+   if ( (self != 0) && (numWorkers >= 0) )
+   {
+      int32_t i;
+      if ( (self->numWorkers > 0) || (numWorkers == 0) )
+      {
+         return 0; //already started or nothing to start
+      }
+      if (numWorkers > APX_DEFINITION_PIPELINE_MAX_WORKERS)
+      {
+         numWorkers = APX_DEFINITION_PIPELINE_MAX_WORKERS;
+      }
+      APX_PIPELINE_LOCK(self->lock);
+      self->isRunning = true;
+      APX_PIPELINE_UNLOCK(self->lock);
+      for (i=0; i<numWorkers; i++)
+      {
+#ifdef _WIN32
+         THREAD_CREATE(self->workerThreads[i],workerTask,self,self->threadIds[i]);
+         if(self->workerThreads[i] == INVALID_HANDLE_VALUE)
+         {
+            break;
+         }
+#else
+         int rc = THREAD_CREATE(self->workerThreads[i],workerTask,self);
+         if(rc != 0)
+         {
+            break;
+         }
+#endif
+         self->numWorkers++;
+      }
+      if (self->numWorkers < numWorkers)
+      {
+         APX_LOG_ERROR("[APX_DEFINITION_PIPELINE] started %d of %d worker threads", (int) self->numWorkers, (int) numWorkers);
+         if (self->numWorkers == 0)
+         {
+            APX_PIPELINE_LOCK(self->lock);
+            self->isRunning = false;
+            APX_PIPELINE_UNLOCK(self->lock);
+            return -1;
+         }
+      }
+      return 0;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * stops the worker threads. Jobs still waiting in the queue are processed by the calling thread before returning.
+ */
+void apx_definitionPipeline_stop(apx_definitionPipeline_t *self)
+{
+   if ( (self != 0) && (self->numWorkers > 0) )
+   {
+      int32_t i;
+      apx_definitionJob_t *job;
+      APX_PIPELINE_LOCK(self->lock);
+      self->isRunning = false;
+      APX_PIPELINE_UNLOCK(self->lock);
+      for (i=0; i<self->numWorkers; i++)
+      {
+         SEMAPHORE_POST(self->semaphore);
+      }
+      for (i=0; i<self->numWorkers; i++)
+      {
+         apx_definitionPipeline_joinWorker(self, i);
+      }
+      self->numWorkers = 0;
+      for(;;)
+      {
+         APX_PIPELINE_LOCK(self->lock);
+         job = self->queueHead;
+         if (job != 0)
+         {
+            self->queueHead = job->next;
+            if (self->queueHead == 0)
+            {
+               self->queueTail = (apx_definitionJob_t*) 0;
+            }
+         }
+         APX_PIPELINE_UNLOCK(self->lock);
+         if (job == 0)
+         {
+            break;
+         }
+         apx_definitionPipeline_prepare(self, job);
+         apx_definitionPipeline_link(self, job);
+         apx_definitionJob_delete(job, self->cache);
+         APX_PIPELINE_LOCK(self->lock);
+         self->numPendingJobs--;
+         APX_PIPELINE_COND_BROADCAST(self->jobDone);
+         APX_PIPELINE_UNLOCK(self->lock);
+      }
+   }
+}
+
+/**
+ * enables caching of parsed definitions. Must be called before the first definition is posted
+ */
+void apx_definitionPipeline_setCache(apx_definitionPipeline_t *self, apx_definitionCache_t *cache)
+{
+   if (self != 0)
+   {
+      self->cache = cache;
+   }
+}
+
+/**
+ * processes the definition found in definitionBuf. The buffer must stay valid until the definition has been linked or
+ * apx_definitionPipeline_cancel has been called for owner.
+ * digest is the SHA-256 digest published by the sender or NULL. The parsed definition is cached when it matches.
+ * When workers are running this returns as soon as the job is queued, otherwise it returns after the link stage.
+ */
+int8_t apx_definitionPipeline_post(apx_definitionPipeline_t *self, const uint8_t *definitionBuf, int32_t definitionLen, const uint8_t *digest, void *owner)
+{
+   if ( (self != 0) && (definitionBuf != 0) && (definitionLen > 0) )
+   {
+      apx_definitionJob_t *job = apx_definitionJob_new(definitionBuf, definitionLen, digest, owner);
+      if (job == 0)
+      {
+         return -1;
+      }
+      return apx_definitionPipeline_submit(self, job);
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * links new nodes created from a cached definition, skipping the parse, finalize and init data stages.
+ * Takes over the reference to cacheEntry (from apx_definitionCache_acquire), also when an error is returned.
+ */
+int8_t apx_definitionPipeline_postCached(apx_definitionPipeline_t *self, apx_definitionCacheEntry_t *cacheEntry, void *owner)
+{
+   if ( (self != 0) && (self->cache != 0) && (cacheEntry != 0) )
+   {
+      apx_definitionJob_t *job = apx_definitionJob_new(cacheEntry->definitionBuf, cacheEntry->definitionLen, cacheEntry->digest, owner);
+      if (job == 0)
+      {
+         apx_definitionCache_release(self->cache, cacheEntry);
+         return -1;
+      }
+      job->cacheEntry = cacheEntry;
+      return apx_definitionPipeline_submit(self, job);
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * drops the queued jobs of owner and waits until no worker is processing a job of owner.
+ * Must be called before owner (or the definition buffers it posted) is deleted. Must not be called from the link function.
+ */
+void apx_definitionPipeline_cancel(apx_definitionPipeline_t *self, void *owner)
+{
+   if ( (self != 0) && (owner != 0) )
+   {
+      apx_definitionJob_t *job;
+      apx_definitionJob_t *prev = (apx_definitionJob_t*) 0;
+      bool isDropped = false;
+      APX_PIPELINE_LOCK(self->lock);
+      job = self->queueHead;
+      while (job != 0)
+      {
+         apx_definitionJob_t *next = job->next;
+         if (job->owner == owner)
+         {
+            if (prev == 0)
+            {
+               self->queueHead = next;
+            }
+            else
+            {
+               prev->next = next;
+            }
+            if (self->queueTail == job)
+            {
+               self->queueTail = prev;
+            }
+            self->numPendingJobs--;
+            isDropped = true;
+            apx_definitionJob_delete(job, self->cache); //the semaphore post of this job wakes a worker that finds nothing to do
+         }
+         else
+         {
+            prev = job;
+         }
+         job = next;
+      }
+      if (isDropped == true)
+      {
+         //apx_definitionPipeline_flush may be waiting for the dropped jobs
+         APX_PIPELINE_COND_BROADCAST(self->jobDone);
+      }
+      while (apx_definitionPipeline_isOwnerActive(self, owner) == true)
+      {
+         APX_PIPELINE_COND_WAIT(self->jobDone, self->lock);
+      }
+      APX_PIPELINE_UNLOCK(self->lock);
+   }
+}
+
+/**
+ * waits until every job posted before this call has been linked or cancelled
+ */
+void apx_definitionPipeline_flush(apx_definitionPipeline_t *self)
+{
+   if (self != 0)
+   {
+      APX_PIPELINE_LOCK(self->lock);
+      while (self->numPendingJobs > 0)
+      {
+         APX_PIPELINE_COND_WAIT(self->jobDone, self->lock);
+      }
+      APX_PIPELINE_UNLOCK(self->lock);
+   }
+}
+
+int32_t apx_definitionPipeline_getNumWorkers(const apx_definitionPipeline_t *self)
+{
+   if (self != 0)
+   {
+      return self->numWorkers;
+   }
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+static apx_definitionJob_t *apx_definitionJob_new(const uint8_t *definitionBuf, int32_t definitionLen, const uint8_t *digest, void *owner)
+{
+   apx_definitionJob_t *self = (apx_definitionJob_t*) malloc(sizeof(apx_definitionJob_t));
+   if (self != 0)
+   {
+      self->definitionBuf = definitionBuf;
+      self->definitionLen = definitionLen;
+      self->owner = owner;
+      self->hasDigest = false;
+      if (digest != 0)
+      {
+         memcpy(self->digest, digest, APX_DEFINITION_DIGEST_SIZE);
+         self->hasDigest = true;
+      }
+      self->cacheEntry = (apx_definitionCacheEntry_t*) 0;
+      self->next = (apx_definitionJob_t*) 0;
+      adt_ary_create(&self->preparedNodes, apx_preparedNode_vdelete);
+   }
+   else
+   {
+      errno = ENOMEM;
+   }
+   return self;
+}
+
+static void apx_definitionJob_delete(apx_definitionJob_t *self, apx_definitionCache_t *cache)
+{
+   if (self != 0)
+   {
+      if (self->cacheEntry != 0)
+      {
+         apx_definitionCache_release(cache, self->cacheEntry);
+      }
+      adt_ary_destroy(&self->preparedNodes);
+      free(self);
+   }
+}
+
+static void apx_preparedNode_delete(apx_preparedNode_t *self)
+{
+   if (self != 0)
+   {
+      if (self->nodeInfo != 0)
+      {
+         apx_nodeInfo_delete(self->nodeInfo);
+      }
+      if (self->inPortInitData != 0)
+      {
+         free(self->inPortInitData);
+      }
+      free(self);
+   }
+}
+
+static void apx_preparedNode_vdelete(void *arg)
+{
+   apx_preparedNode_delete((apx_preparedNode_t*) arg);
+}
+
+/**
+ * queues job for the workers or, without workers, processes it right away
+ */
+static int8_t apx_definitionPipeline_submit(apx_definitionPipeline_t *self, apx_definitionJob_t *job)
+{
+   bool isQueued = false;
+   APX_PIPELINE_LOCK(self->lock);
+   if (self->isRunning == true)
+   {
+      if (self->queueTail == 0)
+      {
+         self->queueHead = job;
+      }
+      else
+      {
+         self->queueTail->next = job;
+      }
+      self->queueTail = job;
+      self->numPendingJobs++;
+      isQueued = true;
+   }
+   APX_PIPELINE_UNLOCK(self->lock);
+   if (isQueued == true)
+   {
+      SEMAPHORE_POST(self->semaphore);
+   }
+   else
+   {
+      apx_definitionPipeline_prepare(self, job);
+      apx_definitionPipeline_link(self, job);
+      apx_definitionJob_delete(job, self->cache);
+   }
+   return 0;
+}
+
+/**
+ * parse, finalize and init data stages. Only touches memory owned by job, safe to run in parallel with other jobs
+ */
+static void apx_definitionPipeline_prepare(apx_definitionPipeline_t *self, apx_definitionJob_t *job)
+{
+   apx_parser_t parser;
+   int32_t numNodes;
+   int32_t i;
+   if (job->cacheEntry != 0)
+   {
+      apx_definitionPipeline_instantiate(job);
+      return;
+   }
+   apx_parser_create(&parser);
+   apx_definitionPipeline_parse(&parser, job->definitionBuf, job->definitionLen);
+   numNodes = apx_parser_getNumNodes(&parser);
+   for (i=0; i<numNodes; i++)
+   {
+      apx_preparedNode_t *preparedNode;
+      apx_node_t *node = apx_parser_getNode(&parser, i);
+      assert(node != 0);
+      node = apx_nodeTemplate_shareNode(node);
+      if (node == 0)
+      {
+         APX_LOG_ERROR("[APX_DEFINITION_PIPELINE] %s", "Failed to create node template");
+         continue;
+      }
+      preparedNode = apx_definitionPipeline_prepareNode(node);
+      if (preparedNode != 0)
+      {
+         adt_ary_push(&job->preparedNodes, preparedNode);
+      }
+   }
+   apx_parser_clearNodes(&parser); //the nodes are now owned by the prepared nodes
+   apx_parser_destroy(&parser);
+   if ( (self->cache != 0) && (job->hasDigest == true) )
+   {
+      apx_definitionPipeline_cacheJob(self, job);
+   }
+}
+
+/**
+ * creates the prepared nodes of job from the node templates of its cache entry
+ */
+static void apx_definitionPipeline_instantiate(apx_definitionJob_t *job)
+{
+   int32_t numNodes;
+   int32_t i;
+   numNodes = apx_definitionCacheEntry_getNumNodes(job->cacheEntry);
+   for (i=0; i<numNodes; i++)
+   {
+      apx_preparedNode_t *preparedNode;
+      const apx_node_t *cachedNode = apx_definitionCacheEntry_getNode(job->cacheEntry, i);
+      apx_node_t *node = apx_nodeTemplate_createNode(cachedNode->nodeTemplate, cachedNode->name);
+      if (node == 0)
+      {
+         APX_LOG_ERROR("[APX_DEFINITION_PIPELINE] Failed to create cached node %s", cachedNode->name);
+         continue;
+      }
+      preparedNode = apx_definitionPipeline_prepareNode(node);
+      if (preparedNode != 0)
+      {
+         adt_ary_push(&job->preparedNodes, preparedNode);
+      }
+   }
+}
+
+/**
+ * stores the prepared nodes of job in the cache, provided that definitionBuf really has the digest published by the sender
+ */
+static void apx_definitionPipeline_cacheJob(apx_definitionPipeline_t *self, apx_definitionJob_t *job)
+{
+   uint8_t digest[APX_DEFINITION_DIGEST_SIZE];
+   apx_definitionCacheEntry_t *entry;
+   int32_t numNodes;
+   int32_t i;
+   numNodes = adt_ary_length(&job->preparedNodes);
+   if (numNodes == 0)
+   {
+      return;
+   }
+   sha256_calc(job->definitionBuf, (uint32_t) job->definitionLen, digest);
+   if (memcmp(digest, job->digest, APX_DEFINITION_DIGEST_SIZE) != 0)
+   {
+      APX_LOG_WARNING("[APX_DEFINITION_PIPELINE] %s", "definition does not match its digest, not cached");
+      return;
+   }
+   entry = apx_definitionCacheEntry_new(job->digest, job->definitionBuf, job->definitionLen);
+   if (entry == 0)
+   {
+      return;
+   }
+   for (i=0; i<numNodes; i++)
+   {
+      apx_preparedNode_t *preparedNode = (apx_preparedNode_t*) adt_ary_value(&job->preparedNodes, i);
+      if (apx_definitionCacheEntry_addNode(entry, preparedNode->nodeInfo->node) != 0)
+      {
+         apx_definitionCacheEntry_delete(entry);
+         return;
+      }
+   }
+   apx_definitionCache_insert(self->cache, entry);
+}
+
+/**
+ * returns a new prepared node owning node, or NULL (node is deleted) on failure.
+ * node must have been created from a node template, the init data is copied from the template
+ */
+static apx_preparedNode_t *apx_definitionPipeline_prepareNode(apx_node_t *node)
+{
+   apx_preparedNode_t *self;
+   apx_nodeInfo_t *nodeInfo;
+   assert(node->nodeTemplate != 0);
+   nodeInfo = apx_nodeInfo_new(node);
+   if (nodeInfo == 0)
+   {
+      APX_LOG_ERROR("[APX_DEFINITION_PIPELINE] Failed to create nodeInfo for node %s", apx_node_getName(node));
+      apx_node_delete(node);
+      return (apx_preparedNode_t*) 0;
+   }
+   nodeInfo->isWeakRef_node = false; //nodeInfo is now the owner of the node pointer (will trigger deletion when apx_nodeInfo_delete is called)
+   self = (apx_preparedNode_t*) malloc(sizeof(apx_preparedNode_t));
+   if (self == 0)
+   {
+      apx_nodeInfo_delete(nodeInfo);
+      errno = ENOMEM;
+      return (apx_preparedNode_t*) 0;
+   }
+   self->nodeInfo = nodeInfo;
+   self->inPortInitData = (uint8_t*) 0;
+   self->inPortDataLen = apx_nodeInfo_getInPortDataLen(nodeInfo);
+   if (self->inPortDataLen > 0)
+   {
+      self->inPortInitData = (uint8_t*) malloc(self->inPortDataLen);
+      if (self->inPortInitData == 0)
+      {
+         APX_LOG_ERROR("[APX_DEFINITION_PIPELINE] out of memory when attempting to create init data of length %d for node %s", (int) self->inPortDataLen, apx_node_getName(node));
+         apx_preparedNode_delete(self);
+         errno = ENOMEM;
+         return (apx_preparedNode_t*) 0;
+      }
+      assert(self->inPortDataLen == node->nodeTemplate->inPortDataLen);
+      memcpy(self->inPortInitData, node->nodeTemplate->inPortInitData, self->inPortDataLen);
+   }
+   return self;
+}
+
+/**
+ * parses definitionBuf, the resulting nodes are found in parser
+ */
+static void apx_definitionPipeline_parse(apx_parser_t *parser, const uint8_t *definitionBuf, int32_t definitionLen)
+{
+   apx_istream_t apx_istream;
+   apx_istream_handler_t apx_istream_handler;
+   memset(&apx_istream_handler,0,sizeof(apx_istream_handler));
+   apx_istream_handler.arg = parser;
+   apx_istream_handler.open = apx_parser_vopen;
+   apx_istream_handler.close = apx_parser_vclose;
+   apx_istream_handler.node = apx_parser_vnode;
+   apx_istream_handler.datatype = apx_parser_vdatatype;
+   apx_istream_handler.provide = apx_parser_vprovide;
+   apx_istream_handler.require = apx_parser_vrequire;
+   apx_istream_handler.node_end = apx_parser_vnode_end;
+   apx_istream_create(&apx_istream,&apx_istream_handler);
+   apx_istream_open(&apx_istream);
+   apx_istream_write(&apx_istream, definitionBuf, (uint32_t) definitionLen);
+   apx_istream_close(&apx_istream);
+   apx_istream_destroy(&apx_istream);
+}
+
+/**
+ * link stage, one job at a time
+ */
+static void apx_definitionPipeline_link(apx_definitionPipeline_t *self, apx_definitionJob_t *job)
+{
+   if (self->linkFunc != 0)
+   {
+      MUTEX_LOCK(self->linkLock);
+      self->linkFunc(self->linkArg, job);
+      MUTEX_UNLOCK(self->linkLock);
+   }
+}
+
+/**
+ * the caller must hold self->lock. There is always a free slot since a worker processes one job at a time
+ */
+static int32_t apx_definitionPipeline_claimWorkerSlot(apx_definitionPipeline_t *self, void *owner)
+{
+   int32_t i;
+   if (owner == 0)
+   {
+      owner = (void*) self; //NULL marks a free slot
+   }
+   for (i=0; i<APX_DEFINITION_PIPELINE_MAX_WORKERS; i++)
+   {
+      if (self->activeOwners[i] == 0)
+      {
+         self->activeOwners[i] = owner;
+         return i;
+      }
+   }
+   assert(0);
+   return -1;
+}
+
+/**
+ * the caller must hold self->lock
+ */
+static bool apx_definitionPipeline_isOwnerActive(const apx_definitionPipeline_t *self, void *owner)
+{
+   int32_t i;
+   for (i=0; i<APX_DEFINITION_PIPELINE_MAX_WORKERS; i++)
+   {
+      if (self->activeOwners[i] == owner)
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+static void apx_definitionPipeline_joinWorker(apx_definitionPipeline_t *self, int32_t index)
+{
+#ifdef _MSC_VER
+   DWORD result = WaitForSingleObject(self->workerThreads[index], 5000);
+   if (result == WAIT_TIMEOUT)
+   {
+      APX_LOG_ERROR("[APX_DEFINITION_PIPELINE] timeout while joining workerThread");
+   }
+   else if (result == WAIT_FAILED)
+   {
+      DWORD lastError = GetLastError();
+      APX_LOG_ERROR("[APX_DEFINITION_PIPELINE] joining workerThread failed with %d", (int)lastError);
+   }
+   CloseHandle(self->workerThreads[index]);
+   self->workerThreads[index] = INVALID_HANDLE_VALUE;
+#else
+   if(pthread_equal(pthread_self(),self->workerThreads[index]) == 0)
+   {
+      void *status;
+      int s = pthread_join(self->workerThreads[index], &status);
+      if (s != 0)
+      {
+         APX_LOG_ERROR("[APX_DEFINITION_PIPELINE] pthread_join error %d\n", s);
+      }
+   }
+   else
+   {
+      APX_LOG_ERROR("[APX_DEFINITION_PIPELINE] pthread_join attempted on pthread_self()\n");
+   }
+#endif
+}
+
+static THREAD_PROTO(workerTask,arg)
+{
+   if (arg != 0)
+   {
+      apx_definitionPipeline_t *self = (apx_definitionPipeline_t*) arg;
+      for(;;)
+      {
+#ifdef _MSC_VER
+         DWORD result = WaitForSingleObject(self->semaphore, INFINITE);
+         if (result == WAIT_OBJECT_0)
+#else
+         int result = sem_wait(&self->semaphore);
+         if (result == 0)
+#endif
+         {
+            apx_definitionJob_t *job;
+            int32_t slot = -1;
+            APX_PIPELINE_LOCK(self->lock);
+            if (self->isRunning == false)
+            {
+               APX_PIPELINE_UNLOCK(self->lock);
+               break;
+            }
+            job = self->queueHead;
+            if (job != 0)
+            {
+               self->queueHead = job->next;
+               if (self->queueHead == 0)
+               {
+                  self->queueTail = (apx_definitionJob_t*) 0;
+               }
+               slot = apx_definitionPipeline_claimWorkerSlot(self, job->owner);
+            }
+            APX_PIPELINE_UNLOCK(self->lock);
+            if (job != 0)
+            {
+               apx_definitionPipeline_prepare(self, job);
+               apx_definitionPipeline_link(self, job);
+               apx_definitionJob_delete(job, self->cache);
+               APX_PIPELINE_LOCK(self->lock);
+               if (slot >= 0)
+               {
+                  self->activeOwners[slot] = (void*) 0;
+               }
+               self->numPendingJobs--;
+               APX_PIPELINE_COND_BROADCAST(self->jobDone);
+               APX_PIPELINE_UNLOCK(self->lock);
+            }
+         }
+         else
+         {
+#ifdef _MSC_VER
+            DWORD lastError = GetLastError();
+            APX_LOG_ERROR("[APX_DEFINITION_PIPELINE]: failure while waiting for semaphore, lastError=%d", lastError);
+#else
+            if (errno == EINTR)
+            {
+               continue;
+            }
+            APX_LOG_ERROR("[APX_DEFINITION_PIPELINE]: failure while waiting for semaphore, errno=%d", errno);
+#endif
+            break;
+         }
+      }
+   }
+   THREAD_RETURN(0);
+}
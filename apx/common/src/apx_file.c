@@ -7,6 +7,8 @@
 #ifndef APX_EMBEDDED
 #include <malloc.h>
 #include "bstr.h"
+#include "sha256.h"
+#include "apx_sharedPayload.h"
 #endif
 #include <string.h>
 #include <assert.h>
@@ -44,6 +46,14 @@ int8_t apx_file_createLocalFile(apx_file_t *self, uint8_t fileType, apx_nodeData
       self->nodeData=nodeData;
       self->isRemoteFile = false;
       self->isOpen = false;
+      self->fragmentStartOffset = 0;
+      self->fragmentEndOffset = 0;
+      self->isFragmentPending = false;
+#ifndef APX_EMBEDDED
+      self->transferPayload = (apx_sharedPayload_t*) 0;
+      self->transferOffset = 0;
+      self->transferNextOffset = 0;
+#endif
       len = strlen(self->nodeData->name);
 
       if (len+APX_MAX_FILE_EXT_LEN <= RMF_MAX_FILE_NAME)
@@ -72,6 +82,15 @@ int8_t apx_file_createLocalFile(apx_file_t *self, uint8_t fileType, apx_nodeData
          }
          strcpy(name+len, ext);
          rmf_fileInfo_create(&self->fileInfo, name, RMF_INVALID_ADDRESS, filelen, RMF_FILE_TYPE_FIXED);
+#ifndef APX_EMBEDDED
+         if ( (fileType == APX_DEFINITION_FILE) && (nodeData->definitionDataBuf != 0) && (filelen > 0) )
+         {
+            //lets the server use a cached copy of an identical definition instead of downloading it
+            uint8_t digest[RMF_DIGEST_SIZE];
+            sha256_calc(nodeData->definitionDataBuf, filelen, digest);
+            rmf_fileInfo_setDigestData(&self->fileInfo, RMF_DIGEST_TYPE_SHA256, digest, RMF_DIGEST_SIZE);
+         }
+#endif
          return 0;
       }
    }
@@ -86,6 +105,14 @@ int8_t apx_file_createRemoteFile(apx_file_t *self, const rmf_fileInfo_t *cmdFile
       self->isRemoteFile = true;
       self->nodeData = 0;
       self->isOpen = false;
+      self->fragmentStartOffset = 0;
+      self->fragmentEndOffset = 0;
+      self->isFragmentPending = false;
+#ifndef APX_EMBEDDED
+      self->transferPayload = (apx_sharedPayload_t*) 0;
+      self->transferOffset = 0;
+      self->transferNextOffset = 0;
+#endif
 
       rmf_fileInfo_create(&self->fileInfo, cmdFileInfo->name, cmdFileInfo->address, cmdFileInfo->length, cmdFileInfo->fileType);
       rmf_fileInfo_setDigestData(&self->fileInfo, cmdFileInfo->digestType, cmdFileInfo->digestData, 0);
@@ -101,6 +128,13 @@ void apx_file_destroy(apx_file_t *self)
    if (self != 0)
    {
       rmf_fileInfo_destroy(&self->fileInfo);
+#ifndef APX_EMBEDDED
+      if (self->transferPayload != 0)
+      {
+         apx_sharedPayload_unref(self->transferPayload);
+         self->transferPayload = (apx_sharedPayload_t*) 0;
+      }
+#endif
    }
 }
 
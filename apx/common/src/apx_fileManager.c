@@ -14,6 +14,8 @@
 #include "apx_fileManager.h"
 #include "apx_nodeManager.h"
 #include "apx_logging.h"
+#include "apx_atomic.h"
+#include "apx_rcu.h"
 #ifdef MEM_LEAK_CHECK
 #include "CMemLeak.h"
 #endif
@@ -22,11 +24,6 @@
 //////////////////////////////////////////////////////////////////////////////
 // CONSTANTS AND DATA TYPES
 //////////////////////////////////////////////////////////////////////////////
-#ifdef _WIN32
-#undef SEMAPHORE_MAX_COUNT
-#define SEMAPHORE_MAX_COUNT APX_CONTEXT_NUM_MESSAGES //redefine here on Win32 platforms
-#endif
-
 #ifndef APX_FILEMANAGER_DEBUG_ENABLE
 #define APX_FILEMANAGER_DEBUG_ENABLE 0
 #endif
@@ -35,22 +32,56 @@
 //////////////////////////////////////////////////////////////////////////////
 static int8_t apx_fileManager_startThread(apx_fileManager_t *self);
 static THREAD_PROTO(threadTask,arg);
+static int8_t apx_fileManager_postMessage(apx_fileManager_t *self, const apx_msg_t *msg);
+static bool apx_fileManager_processMessage(apx_fileManager_t *self, const apx_msg_t *msg);
+static int32_t apx_fileManager_drainMessages(apx_fileManager_t *self, bool *isRunning);
 
 
 //handlers are run by internal thread
 static void apx_fileManager_connectHandler(apx_fileManager_t *self);
 static void apx_fileManager_fileWriteNotifyHandler(apx_fileManager_t *self, apx_file_t *file, apx_offset_t offset, apx_size_t len);
 static void apx_fileManager_fileWriteCmdHandler(apx_fileManager_t *self, apx_file_t *file, const uint8_t *data, apx_offset_t offset, apx_size_t len);
+static void apx_fileManager_latestWriteHandler(apx_fileManager_t *self, apx_file_t *file, apx_offset_t offset, apx_size_t len);
+static void apx_fileManager_writeContinueHandler(apx_fileManager_t *self, apx_file_t *file);
+static void apx_fileManager_sendFileWrite(apx_fileManager_t *self, apx_file_t *file, const uint8_t *data, apx_offset_t offset, apx_size_t len);
+static void apx_fileManager_sendFileData(apx_fileManager_t *self, apx_file_t *file, apx_offset_t offset, apx_size_t len);
+static bool apx_fileManager_sendTransferFragment(apx_fileManager_t *self, apx_file_t *file);
+static void apx_fileManager_continueTransfer(apx_fileManager_t *self, apx_file_t *file);
+static void apx_fileManager_finishTransfer(apx_fileManager_t *self, apx_file_t *file);
+static bool apx_fileManager_mergeTransfer(apx_fileManager_t *self, apx_file_t *file, apx_offset_t offset, apx_size_t len);
+static void apx_fileManager_releaseTransfer(apx_fileManager_t *self, apx_file_t *file);
+static int8_t apx_fileManager_readFileData(apx_file_t *file, uint8_t *dataBuf, apx_offset_t offset, apx_size_t len);
+static apx_size_t apx_fileManager_getMaxFragmentLen(apx_fileManager_t *self);
+static void apx_fileManager_sendData(apx_fileManager_t *self, uint32_t address, const uint8_t *data, int32_t len);
+static int8_t apx_fileManager_sendFragment(apx_fileManager_t *self, uint32_t address, const uint8_t *data, int32_t len, bool more_bit);
+static uint8_t *apx_fileManager_reserveMultiWrite(apx_fileManager_t *self, apx_file_t *file, apx_offset_t offset, apx_size_t len);
+static void apx_fileManager_commitMultiWrite(apx_fileManager_t *self, const uint8_t *recordData, apx_size_t len);
+static void apx_fileManager_flushMultiWrite(apx_fileManager_t *self);
+#if APX_SHM_TRANSPORT_ENABLE
+static bool apx_fileManager_sendSharedWrite(apx_fileManager_t *self, uint32_t address, const uint8_t *data, apx_size_t len);
+static void apx_fileManager_sharedWriteReceived(void *arg, uint32_t address, const uint8_t *data, uint32_t dataLen);
+#endif
 
 //process functions are called from inside apx_fileManager_parseMessage)
 static void apx_fileManager_parseCmdMsg(apx_fileManager_t *self, const uint8_t *msgBuf, int32_t msgLen);
 static void apx_fileManager_parseDataMsg(apx_fileManager_t *self, uint32_t address, const uint8_t *msgBuf, int32_t msgLen, bool more_bit);
+static void apx_fileManager_parseMultiWrite(apx_fileManager_t *self, const uint8_t *msgBuf, int32_t msgLen);
 static void apx_fileManager_processRemoteFileInfo(apx_fileManager_t *self, const rmf_fileInfo_t *cmdFileInfo);
 static void apx_fileManager_processOpenFile(apx_fileManager_t *self, const rmf_cmdOpenFile_t *cmdOpenFile);
+static void apx_fileManager_openResumedInPortDataFile(apx_fileManager_t *self, apx_file_t *localFile);
 
 //other internal functions
 static void apx_fileManager_sendFileInfo(apx_fileManager_t *self, rmf_fileInfo_t *fileInfo);
 static void apx_fileManager_sendAck(apx_fileManager_t *self);
+static void apx_fileManager_sendMultiWriteAccept(apx_fileManager_t *self);
+static void apx_fileManager_flush(apx_fileManager_t *self);
+static void apx_fileManager_releaseQueuedMessages(apx_fileManager_t *self);
+
+//message queue overflow handlers
+static bool apx_fileManager_isDroppableMessage(void *arg, const apx_msg_t *msg);
+static bool apx_fileManager_isConflatableMessage(void *arg, const apx_msg_t *queuedMsg, const apx_msg_t *newMsg);
+static uint32_t apx_fileManager_getMessageSize(void *arg, const apx_msg_t *msg);
+static void apx_fileManager_releaseMessage(void *arg, const apx_msg_t *msg);
 
 //////////////////////////////////////////////////////////////////////////////
 // GLOBAL VARIABLES
@@ -68,12 +99,11 @@ int8_t apx_fileManager_create(apx_fileManager_t *self, uint8_t mode)
 {
    if (self != 0 && ( (mode == APX_FILEMANAGER_CLIENT_MODE) || (mode == APX_FILEMANAGER_SERVER_MODE) ) )
    {
-      size_t numItems = APX_CONTEXT_NUM_MESSAGES;
-      size_t elemSize = RMF_MSG_SIZE;
       int8_t result = apx_allocator_create(&self->allocator, APX_CONTEXT_NUM_MESSAGES);
 
       if (result == 0)
       {
+         apx_msgQueueHandler_t queueHandler;
 #ifdef _WIN32
          self->workerThread = INVALID_HANDLE_VALUE;
 #else
@@ -82,26 +112,44 @@ int8_t apx_fileManager_create(apx_fileManager_t *self, uint8_t mode)
          self->mode = mode;
          self->debugInfo = (void*) 0;
          self->workerThreadValid=false;
-         SPINLOCK_INIT(self->lock);
-         SEMAPHORE_CREATE(self->semaphore);
-         self->ringbufferLen = numItems;
-         self->ringbufferData = (uint8_t*) malloc(numItems*elemSize);
-         if (self->ringbufferData == 0)
+         if (apx_msgQueue_create(&self->messageQueue, APX_CONTEXT_NUM_MESSAGES) != 0)
          {
             apx_allocator_destroy(&self->allocator);
             return -1;
          }
-         rbfs_create(&self->ringbuffer, self->ringbufferData,(uint16_t) numItems,(uint8_t) elemSize);
+         queueHandler.arg = (void*) self;
+         queueHandler.isDroppable = apx_fileManager_isDroppableMessage;
+         queueHandler.isConflatable = apx_fileManager_isConflatableMessage;
+         queueHandler.getSize = apx_fileManager_getMessageSize;
+         queueHandler.release = apx_fileManager_releaseMessage;
+         apx_msgQueue_setOverflowPolicy(&self->messageQueue, APX_CONTEXT_QUEUE_POLICY, APX_CONTEXT_QUEUE_MAX_BYTES, &queueHandler);
+         SPINLOCK_INIT(self->lock);
          apx_fileMap_create(&self->localFileMap);
          apx_fileMap_create(&self->remoteFileMap);
          apx_fileManager_setTransmitHandler(self, 0);
-         apx_allocator_start(&self->allocator);
 
          self->curFileStartAddress = 0;
          self->curFileEndAddress = 0;
          self->curFile = 0;
+         self->streamAddress = 0;
+         self->streamRemain = 0;
+         self->streamMoreBit = false;
+         self->isStreamDiscarded = false;
          self->nodeManager = (apx_nodeManager_t*) 0;
+         self->numRefs = 0;
+         self->isRefClosed = 0;
+         self->numTransfers = 0;
          self->isConnected = false;
+         self->isConflationEnabled = false;
+         self->isDirectDispatchEnabled = false;
+         self->isMultiWriteEnabled = false;
+         self->multiWriteLen = 0;
+         self->multiWriteNumRecords = 0;
+         self->multiWriteFile = (apx_file_t*) 0;
+#if APX_SHM_TRANSPORT_ENABLE
+         self->shmTransport = (apx_shmTransport_t*) 0;
+         MUTEX_INIT(self->parseLock);
+#endif
          return 0;
       }
    }
@@ -113,14 +161,22 @@ void apx_fileManager_destroy(apx_fileManager_t *self)
 {
    if (self != 0)
    {
+#if APX_SHM_TRANSPORT_ENABLE
+      //no more writes may arrive from the shared memory receive thread
+      apx_fileManager_setSharedMemoryTransport(self, (apx_shmTransport_t*) 0);
+#endif
+      //the message queue supports a single consumer, the worker thread must be gone before we drain it
+      apx_fileManager_stop(self);
+      assert(self->workerThreadValid == false);
+      //release queued messages while the allocator can still take back their data
+      apx_fileManager_releaseQueuedMessages(self);
       apx_allocator_stop(&self->allocator);
-      if (self->ringbufferData != 0)
-      {
-         free(self->ringbufferData);
-      }
-      SEMAPHORE_DESTROY(self->semaphore);
+      apx_msgQueue_destroy(&self->messageQueue);
       SPINLOCK_DESTROY(self->lock);
       apx_allocator_destroy(&self->allocator);
+#if APX_SHM_TRANSPORT_ENABLE
+      MUTEX_DESTROY(self->parseLock);
+#endif
       apx_fileMap_destroy(&self->localFileMap);
       apx_fileMap_destroy(&self->remoteFileMap);
    }
@@ -169,6 +225,7 @@ void apx_fileManager_start(apx_fileManager_t *self)
 {
    if( (self != 0) && (self->workerThreadValid == false) )
    {
+      apx_allocator_start(&self->allocator);
       apx_fileManager_startThread(self);
    }
 }
@@ -181,10 +238,7 @@ void apx_fileManager_stop(apx_fileManager_t *self)
       DWORD result;
 #endif
       apx_msg_t msg = {RMF_MSG_EXIT,0,0,0,0}; //{msgType, sender, msgData1, msgData2, msgData3}
-      SPINLOCK_ENTER(self->lock);
-      rbfs_insert(&self->ringbuffer,(const uint8_t*) &msg);
-      SPINLOCK_LEAVE(self->lock);
-      SEMAPHORE_POST(self->semaphore);
+      apx_fileManager_postMessage(self, &msg);
 #ifdef _MSC_VER
       result = WaitForSingleObject(self->workerThread, 5000);
       if (result == WAIT_TIMEOUT)
@@ -213,9 +267,52 @@ void apx_fileManager_stop(apx_fileManager_t *self)
          APX_LOG_ERROR("[APX_FILE_MANAGER] pthread_join attempted on pthread_self()\n");
       }
 #endif
+      self->workerThreadValid = false;
+   }
+}
+
+
+/**
+ * starts the fileManager without its own worker thread (or allocator thread).
+ * wakeupFunc is called when messages are queued to an empty queue, the owner of the event loop must then call apx_fileManager_processMessages.
+ */
+void apx_fileManager_startExternal(apx_fileManager_t *self, apx_fileManager_wakeup_fn *wakeupFunc, void *wakeupArg)
+{
+   if( (self != 0) && (self->workerThreadValid == false) && (wakeupFunc != 0) )
+   {
+      apx_msgQueue_setWakeup(&self->messageQueue, wakeupFunc, wakeupArg);
    }
 }
 
+/**
+ * processes all queued messages in the calling thread. Only used when fileManager was started using apx_fileManager_startExternal.
+ * returns number of processed messages or -1 on error
+ */
+int32_t apx_fileManager_processMessages(apx_fileManager_t *self)
+{
+   if ( (self != 0) && (self->workerThreadValid == false) )
+   {
+      int32_t messagesProcessed = 0;
+      bool isRunning = true;
+      for(;;)
+      {
+         int32_t numProcessed = apx_fileManager_drainMessages(self, &isRunning);
+         messagesProcessed += numProcessed;
+         //batched writes must be on their way before the queue looks empty to apx_fileManager_directWriteCmd
+         apx_fileManager_flushMultiWrite(self);
+         //producers only call the wakeup function when the queue was empty, keep going until nothing is pending
+         if ( (apx_msgQueue_consumed(&self->messageQueue, numProcessed) <= 0) || (isRunning == false) )
+         {
+            break;
+         }
+      }
+      //the queue is drained, transmit everything that was held back for coalescing
+      apx_fileManager_flush(self);
+      return messagesProcessed;
+   }
+   errno = EINVAL;
+   return -1;
+}
 
 /**
  * used to attach a node manager to allow fileManager to create remote nodes
@@ -253,6 +350,229 @@ void apx_fileManager_setDebugInfo(apx_fileManager_t *self, void *debugInfo)
    }
 }
 
+/**
+ * returns high-water-mark and overflow/drop counters of the message queue of this connection
+ */
+void apx_fileManager_getQueueStats(apx_fileManager_t *self, apx_msgQueueStats_t *stats)
+{
+   if (self != 0)
+   {
+      apx_msgQueue_getStats(&self->messageQueue, stats);
+   }
+}
+
+/**
+ * Enables latest-value conflation of writes to non-queued ports of this connection.
+ * A slow client then never has more than one update per port waiting in the queue. Must be set before any data is routed.
+ */
+void apx_fileManager_setConflation(apx_fileManager_t *self, bool enable)
+{
+   if (self != 0)
+   {
+      self->isConflationEnabled = enable;
+   }
+}
+
+bool apx_fileManager_isConflationEnabled(apx_fileManager_t *self)
+{
+   if (self != 0)
+   {
+      return self->isConflationEnabled;
+   }
+   return false;
+}
+
+/**
+ * Enables run-to-completion dispatch of routed writes, see apx_fileManager_directWriteCmd. Must be set before any data is routed.
+ */
+void apx_fileManager_setDirectDispatch(apx_fileManager_t *self, bool enable)
+{
+   if (self != 0)
+   {
+      self->isDirectDispatchEnabled = enable;
+   }
+}
+
+bool apx_fileManager_isDirectDispatchEnabled(apx_fileManager_t *self)
+{
+   if (self != 0)
+   {
+      return self->isDirectDispatchEnabled;
+   }
+   return false;
+}
+
+/**
+ * Tells the fileManager that the remote side accepts RMF_CMD_MULTI_WRITE messages, small port writes are then batched into one message.
+ * In server mode the client is told that the server accepts them as well when the connection is acknowledged.
+ * In client mode this is called by the fileManager itself when that message arrives.
+ */
+void apx_fileManager_setMultiWrite(apx_fileManager_t *self, bool enable)
+{
+   if (self != 0)
+   {
+      SPINLOCK_ENTER(self->lock);
+      self->isMultiWriteEnabled = enable;
+      SPINLOCK_LEAVE(self->lock);
+   }
+}
+
+bool apx_fileManager_isMultiWriteEnabled(apx_fileManager_t *self)
+{
+   if (self != 0)
+   {
+      bool retval;
+      SPINLOCK_ENTER(self->lock);
+      retval = self->isMultiWriteEnabled;
+      SPINLOCK_LEAVE(self->lock);
+      return retval;
+   }
+   return false;
+}
+
+/**
+ * Takes a reference that keeps this fileManager, its files and the nodeData of its nodes alive after the rcu read-side section
+ * in which they were looked up has ended. This allows other connections to send to it without blocking the grace period.
+ * returns false when the fileManager is being detached from its nodeManager, it must then not be used outside of the section.
+ */
+bool apx_fileManager_tryRef(apx_fileManager_t *self)
+{
+   if (self != 0)
+   {
+      (void) APX_ATOMIC_INCREMENT(self->numRefs);
+      //read-modify-write instead of a plain load, it must not be ordered before the increment (pairs with apx_fileManager_closeRefs)
+      if (APX_ATOMIC_FETCH_ADD(self->isRefClosed, 0) == 0)
+      {
+         return true;
+      }
+      (void) APX_ATOMIC_DECREMENT(self->numRefs);
+   }
+   return false;
+}
+
+void apx_fileManager_unref(apx_fileManager_t *self)
+{
+   if (self != 0)
+   {
+      int32_t numRefs = APX_ATOMIC_DECREMENT(self->numRefs);
+      assert(numRefs >= 0);
+      (void) numRefs;
+   }
+}
+
+/**
+ * Refuses new references and waits until all references taken with apx_fileManager_tryRef have been released.
+ * Called by the nodeManager before it retires the nodes of this fileManager. Must not be called from inside an rcu read-side section.
+ */
+void apx_fileManager_closeRefs(apx_fileManager_t *self)
+{
+   if (self != 0)
+   {
+      (void) APX_ATOMIC_INCREMENT(self->isRefClosed);
+      //references are held while sending a single batch of writes, which is bounded by the backpressure timeout of our queue
+      while (APX_ATOMIC_FETCH_ADD(self->numRefs, 0) != 0)
+      {
+         SLEEP(0);
+      }
+   }
+}
+
+/**
+ * Writes data into an inPortData file and appends the data message to the transmit buffer of this connection from the calling thread.
+ * The calling thread never transmits or waits for this connection, a flush request is queued instead and the worker of this connection sends the data.
+ * This is only done while the message queue is empty, otherwise the write would overtake older writes still waiting to be sent.
+ * The pending flush request also makes writes that follow before it has been processed take the queued path.
+ * The transmit handler must support trySendGather, it refuses the message when the transmit buffer is busy or full (a slow receiver).
+ * While a fragmented transfer is in progress the fragments not yet sent are updated by the worker, the write must then be queued.
+ * returns 0 when the data has been written and appended, -1 when the caller must queue the write instead (errno is set to EAGAIN).
+ */
+int8_t apx_fileManager_directWriteCmd(apx_fileManager_t *self, apx_file_t *file, const uint8_t *data, apx_offset_t offset, apx_size_t length)
+{
+   if ( (self != 0) && (file != 0) && (data != 0) )
+   {
+      bool isConnected;
+      apx_msg_t msg = {RMF_MSG_FLUSH,0,0,0,0}; //{msgType,  msgData1, msgData2, msgData3, msgData4}
+      uint8_t header[RMF_MAX_HEADER_SIZE];
+      int32_t headerLen;
+      if ( (self->isDirectDispatchEnabled == false) || (self->transmitHandler.trySendGather == 0) || (length > APX_FILEMANAGER_DIRECT_WRITE_MAX_LEN) ||
+           (length > apx_fileManager_getMaxFragmentLen(self)) || (file->fileType != APX_INDATA_FILE) || (file->nodeData == 0) || (file->isOpen == false) ||
+           (apx_msgQueue_getNumPending(&self->messageQueue) != 0) )
+      {
+         errno = EAGAIN;
+         return -1;
+      }
+      SPINLOCK_ENTER(self->lock);
+      isConnected = self->isConnected;
+      SPINLOCK_LEAVE(self->lock);
+      //write errors are reported by the worker thread when it processes the queued write
+      if ( (isConnected == false) || (apx_nodeData_writeInPortData(file->nodeData, data, offset, length) != 0) )
+      {
+         errno = EAGAIN;
+         return -1;
+      }
+      //checked after the data is written, a transfer that starts after this point reads the new data
+      if (APX_ATOMIC_FETCH_ADD(self->numTransfers, 0) != 0)
+      {
+         errno = EAGAIN;
+         return -1;
+      }
+#if APX_SHM_TRANSPORT_ENABLE
+      if (APX_ATOMIC_LOAD_ACQUIRE(self->shmTransport) != 0)
+      {
+         //a write to shared memory waits while the channel is full
+         errno = EAGAIN;
+         return -1;
+      }
+#endif
+      headerLen = rmf_packHeader(header, (int32_t) sizeof(header), file->fileInfo.address + offset, false);
+      if ( (headerLen <= 0) || (self->transmitHandler.trySendGather(self->transmitHandler.arg, header, headerLen, data, (int32_t) length) != 0) )
+      {
+         //the data written above is written again when the queued write is processed
+         errno = EAGAIN;
+         return -1;
+      }
+      if (self->debugInfo != 0)
+      {
+         APX_LOG_DEBUG("[APX_FILE_MANAGER] (%p) Server Direct Write %s[%d,%d]", self->debugInfo, file->fileInfo.name, (int) offset, (int) length );
+      }
+      //the data is flushed after the worker has drained the queue, if the request can't be queued it goes out with the next flush
+      (void) apx_fileManager_postMessage(self, &msg);
+      return 0;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+#if APX_SHM_TRANSPORT_ENABLE
+/**
+ * Sends port data through shmTransport instead of the transmit handler and starts the receive thread of the transport.
+ * Writes received from the other side are processed the same way as data messages parsed from the socket.
+ * Must be set before apx_fileManager_onConnected. Setting it to 0 stops the receive thread, the transport itself is owned by the connection.
+ */
+int8_t apx_fileManager_setSharedMemoryTransport(apx_fileManager_t *self, apx_shmTransport_t *shmTransport)
+{
+   if (self != 0)
+   {
+      apx_shmTransport_t *previous = self->shmTransport;
+      APX_ATOMIC_STORE_RELEASE(self->shmTransport, (apx_shmTransport_t*) 0);
+      if (previous != 0)
+      {
+         apx_shmTransport_stopReceiver(previous);
+      }
+      if (shmTransport != 0)
+      {
+         if (apx_shmTransport_startReceiver(shmTransport, apx_fileManager_sharedWriteReceived, (void*) self) != 0)
+         {
+            return -1;
+         }
+         APX_ATOMIC_STORE_RELEASE(self->shmTransport, shmTransport);
+      }
+      return 0;
+   }
+   errno = EINVAL;
+   return -1;
+}
+#endif
 
 /**
  * returns number of bytes parsed from msgBuf. returns -1 on error or 0 if msgBuf is too short (wait for more data to arrive)
@@ -268,6 +588,9 @@ int32_t apx_fileManager_parseMessage(apx_fileManager_t *self, const uint8_t *msg
       APX_LOG_DEBUG("[APX_FILE_MANAGER] address: %08X", msg.address);
       APX_LOG_DEBUG("[APX_FILE_MANAGER] length: %d", msg.dataLen);
       APX_LOG_DEBUG("[APX_FILE_MANAGER] more_bit: %d", (int) msg.more_bit);
+#endif
+#if APX_SHM_TRANSPORT_ENABLE
+      MUTEX_LOCK(self->parseLock);
 #endif
       if (msg.address == RMF_CMD_START_ADDR)
       {
@@ -281,6 +604,9 @@ int32_t apx_fileManager_parseMessage(apx_fileManager_t *self, const uint8_t *msg
       {
          //discard
       }
+#if APX_SHM_TRANSPORT_ENABLE
+      MUTEX_UNLOCK(self->parseLock);
+#endif
    }
    else if (result < 0)
    {
@@ -293,6 +619,87 @@ int32_t apx_fileManager_parseMessage(apx_fileManager_t *self, const uint8_t *msg
    return result;
 }
 
+/**
+ * starts parsing a data message of msgLen bytes before all of it has been received, msgBuf holds the bufLen bytes received so far.
+ * The data is written to the remote file as it arrives, the rest is given to apx_fileManager_parseMessageContinue.
+ * Returns number of bytes consumed from msgBuf, 0 when the message must be parsed whole by apx_fileManager_parseMessage
+ * (command messages and messages where the RMF header has not yet been received) or -1 on error
+ */
+int32_t apx_fileManager_parseMessageBegin(apx_fileManager_t *self, const uint8_t *msgBuf, int32_t bufLen, int32_t msgLen)
+{
+   if ( (self != 0) && (msgBuf != 0) && (bufLen > 0) && (bufLen < msgLen) && (self->streamRemain == 0) )
+   {
+      rmf_msg_t msg;
+      int32_t result = rmf_unpackMsg(msgBuf, bufLen, &msg);
+      if ( (result > 0) && (msg.address < RMF_CMD_START_ADDR) )
+      {
+         int32_t headerLen = bufLen - msg.dataLen;
+         uint32_t dataLen = (uint32_t) (msgLen - headerLen);
+         apx_file_t *remoteFile;
+         SPINLOCK_ENTER(self->lock);
+         remoteFile = apx_fileMap_findByAddress(&self->remoteFileMap, msg.address);
+         SPINLOCK_LEAVE(self->lock);
+         self->streamAddress = msg.address;
+         self->streamRemain = dataLen;
+         self->streamMoreBit = msg.more_bit;
+         self->isStreamDiscarded = false;
+         if ( (remoteFile == 0) || (msg.address+dataLen > remoteFile->fileInfo.address+remoteFile->fileInfo.length) )
+         {
+            APX_LOG_ERROR("[APX_FILE_MANAGER(%s)] invalid write attempted at address %08X, len=%d",apx_fileManager_modeString(self), (int) msg.address, (int) dataLen);
+            self->isStreamDiscarded = true;
+         }
+         return headerLen + apx_fileManager_parseMessageContinue(self, msg.data, msg.dataLen);
+      }
+      return (result < 0)? -1 : 0;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * writes the next part of a message started by apx_fileManager_parseMessageBegin. Every part except the last one is handled
+ * like a message with more_bit set, this way the nodeManager is told about the write once, when all of it has arrived.
+ * Returns number of bytes consumed from dataBuf, this is less than dataLen when dataBuf also holds the start of the next message
+ */
+int32_t apx_fileManager_parseMessageContinue(apx_fileManager_t *self, const uint8_t *dataBuf, int32_t dataLen)
+{
+   if ( (self != 0) && (dataLen >= 0) && ( (dataBuf != 0) || (dataLen == 0) ) )
+   {
+      int32_t partLen = (dataLen < (int32_t) self->streamRemain)? dataLen : (int32_t) self->streamRemain;
+      if (partLen > 0)
+      {
+         if (self->isStreamDiscarded == false)
+         {
+            bool more_bit = (partLen < (int32_t) self->streamRemain)? true : self->streamMoreBit;
+#if APX_SHM_TRANSPORT_ENABLE
+            MUTEX_LOCK(self->parseLock);
+#endif
+            apx_fileManager_parseDataMsg(self, self->streamAddress, dataBuf, partLen, more_bit);
+#if APX_SHM_TRANSPORT_ENABLE
+            MUTEX_UNLOCK(self->parseLock);
+#endif
+         }
+         self->streamAddress += (uint32_t) partLen;
+         self->streamRemain -= (uint32_t) partLen;
+      }
+      return partLen;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * returns true while a message started by apx_fileManager_parseMessageBegin has data that has not yet been received
+ */
+bool apx_fileManager_isParsingMessage(apx_fileManager_t *self)
+{
+   if (self != 0)
+   {
+      return (self->streamRemain > 0)? true : false;
+   }
+   return false;
+}
+
 /**
  * sends a file open request
  */
@@ -316,6 +723,7 @@ void apx_fileManager_sendFileOpen(apx_fileManager_t *self, uint32_t remoteAddres
          {
             int32_t msgLen = (headerLen+dataLen);
             self->transmitHandler.send(self->transmitHandler.arg, RMF_MAX_HEADER_SIZE-headerLen, msgLen);
+            apx_fileManager_flush(self);
          }
       }
    }
@@ -328,7 +736,12 @@ apx_file_t *apx_fileManager_findRemoteFile(apx_fileManager_t *self, const char *
 {
    if (self != 0)
    {
-      return apx_fileMap_findByName(&self->remoteFileMap, name);
+      apx_file_t *file;
+      //the nodeManager may search from a definition pipeline worker while our receive thread inserts new files
+      SPINLOCK_ENTER(self->lock);
+      file = apx_fileMap_findByName(&self->remoteFileMap, name);
+      SPINLOCK_LEAVE(self->lock);
+      return file;
    }
    errno=EINVAL;
    return (apx_file_t*) 0;
@@ -351,6 +764,7 @@ void apx_fileManager_attachLocalDefinitionFile(apx_fileManager_t *self, apx_file
          apx_fileManager_sendFileInfo(self, &localFile->fileInfo);
       }
       SPINLOCK_LEAVE(self->lock);
+      apx_fileManager_flush(self);
    }
 }
 
@@ -371,6 +785,7 @@ void apx_fileManager_attachLocalPortDataFile(apx_fileManager_t *self, apx_file_t
          apx_fileManager_sendFileInfo(self, &localFile->fileInfo);
       }
       SPINLOCK_LEAVE(self->lock);
+      apx_fileManager_flush(self);
    }
 }
 
@@ -400,10 +815,7 @@ void apx_fileManager_onConnected(apx_fileManager_t *self)
    if (self != 0)
    {
       apx_msg_t msg = {RMF_MSG_CONNECT,0,0,0,0}; //{msgType,  msgData1, msgData2, msgData3, msgData4}
-      SPINLOCK_ENTER(self->lock);
-      rbfs_insert(&self->ringbuffer,(const uint8_t*) &msg);
-      SPINLOCK_LEAVE(self->lock);
-      SEMAPHORE_POST(self->semaphore);
+      apx_fileManager_postMessage(self, &msg);
    }
 }
 
@@ -412,10 +824,7 @@ void apx_fileManager_onDisconnected(apx_fileManager_t *self)
    if (self != 0)
    {
       apx_msg_t msg = {RMF_MSG_DISCONNECT,0,0,0,0}; //{msgType,  msgData1, msgData2, msgData3, msgData4}
-      SPINLOCK_ENTER(self->lock);
-      rbfs_insert(&self->ringbuffer,(const uint8_t*) &msg);
-      SPINLOCK_LEAVE(self->lock);
-      SEMAPHORE_POST(self->semaphore);
+      apx_fileManager_postMessage(self, &msg);
    }
 }
 
@@ -427,10 +836,10 @@ void apx_fileManager_triggerFileUpdatedEvent(apx_fileManager_t *self, apx_file_t
       msg.msgData1 = (uint32_t) offset;
       msg.msgData2 = (uint32_t) length;
       msg.msgData3 = file; //sent from node in nodeDataPtr
-      SPINLOCK_ENTER(self->lock);
-      rbfs_insert(&self->ringbuffer,(const uint8_t*) &msg);
-      SPINLOCK_LEAVE(self->lock);
-      SEMAPHORE_POST(self->semaphore);
+      if (apx_fileManager_postMessage(self, &msg) != 0)
+      {
+         APX_LOG_ERROR("[APX_FILE_MANAGER] message queue full, dropped update of %s", (file != 0)? file->fileInfo.name : "");
+      }
    }
 }
 
@@ -452,14 +861,69 @@ void apx_fileManager_triggerFileWriteCmdEvent(apx_fileManager_t *self, apx_file_
       {
          memcpy(dataCopy, data, length);
          msg.msgData4 = dataCopy;
-         SPINLOCK_ENTER(self->lock);
-         rbfs_insert(&self->ringbuffer,(const uint8_t*) &msg);
-         SPINLOCK_LEAVE(self->lock);
-         SEMAPHORE_POST(self->semaphore);
+         if (apx_fileManager_postMessage(self, &msg) != 0)
+         {
+            APX_LOG_ERROR("[APX_FILE_MANAGER] message queue full, dropped write to %s", (file != 0)? file->fileInfo.name : "");
+            apx_allocator_free(&self->allocator, dataCopy, (uint32_t) length);
+         }
+      }
+   }
+}
+
+/**
+ * queues a write of payload data into file. The fileManager keeps its own reference to payload until the write has been sent,
+ * this allows the caller to share a single copy of the data among many destinations.
+ * Writes to queued ports (isQueued) are never dropped or conflated when the queue is over budget.
+ */
+void apx_fileManager_triggerSharedWriteCmdEvent(apx_fileManager_t *self, apx_file_t *file, apx_sharedPayload_t *payload, apx_offset_t offset, bool isQueued)
+{
+   if ( (self != 0) && (payload != 0) )
+   {
+      apx_msg_t msg = {RMF_MSG_SHARED_WRITE,0,0,0,0}; //{msgType,  msgData1, msgData2, msgData3, msgData4}
+      if (isQueued == true)
+      {
+         msg.msgType = RMF_MSG_QUEUED_WRITE;
+      }
+      msg.msgData1 = (uint32_t) offset;
+      msg.msgData2 = payload->dataLen;
+      msg.msgData3 = file;
+      msg.msgData4 = payload;
+      apx_sharedPayload_ref(payload);
+      if (apx_fileManager_postMessage(self, &msg) != 0)
+      {
+         APX_LOG_ERROR("[APX_FILE_MANAGER] message queue full, dropped write to %s", (file != 0)? file->fileInfo.name : "");
+         apx_sharedPayload_unref(payload);
       }
    }
 }
 
+/**
+ * Writes data into an inPortData file right away and queues a message that sends the latest value of the port.
+ * While that message is waiting in the queue, later writes to the same port only replace the data.
+ */
+void apx_fileManager_triggerLatestWriteCmdEvent(apx_fileManager_t *self, apx_file_t *file, const uint8_t *data, apx_offset_t offset, apx_size_t length)
+{
+   if ( (self != 0) && (file != 0) && (data != 0) && (file->fileType == APX_INDATA_FILE) && (file->nodeData != 0) )
+   {
+      int8_t result = apx_nodeData_writeInPortDataPending(file->nodeData, data, offset, length);
+      if (result == 0)
+      {
+         apx_msg_t msg = {RMF_MSG_LATEST_WRITE,0,0,0,0}; //{msgType,  msgData1, msgData2, msgData3, msgData4}
+         msg.msgData1 = (uint32_t) offset;
+         msg.msgData2 = (uint32_t) length;
+         msg.msgData3 = file;
+         if (apx_fileManager_postMessage(self, &msg) != 0)
+         {
+            APX_LOG_ERROR("[APX_FILE_MANAGER] message queue full, dropped write to %s", file->fileInfo.name);
+            apx_nodeData_clearInPortDataPending(file->nodeData, offset);
+         }
+      }
+      else if (result < 0)
+      {
+         APX_LOG_ERROR("[APX_FILE_MANAGER] attempted write outside bounds, file=%s, offset=%d, len=%d", file->fileInfo.name, (int) offset, (int) length);
+      }
+   }
+}
 
 //////////////////////////////////////////////////////////////////////////////
 // LOCAL FUNCTIONS
@@ -496,58 +960,99 @@ static THREAD_PROTO(threadTask,arg)
 {
    if(arg!=0)
    {
-      apx_msg_t msg;
       apx_fileManager_t *self;
       uint32_t messages_processed=0;
       bool isRunning=true;
       self = (apx_fileManager_t*) arg;
       while(isRunning == true)
       {
-
-#ifdef _MSC_VER
-         DWORD result = WaitForSingleObject(self->semaphore, INFINITE);
-         if (result == WAIT_OBJECT_0)
-#else
-         int result = sem_wait(&self->semaphore);
-         if (result == 0)
-#endif
+         int32_t numProcessed;
+         //returns immediately while there are pending messages, the thread only sleeps when the queue has been drained
+         apx_msgQueue_wait(&self->messageQueue);
+         numProcessed = apx_fileManager_drainMessages(self, &isRunning);
+         if (isRunning == true)
          {
-            SPINLOCK_ENTER(self->lock);
-            rbfs_remove(&self->ringbuffer,(uint8_t*) &msg);
-            SPINLOCK_LEAVE(self->lock);
-            messages_processed++;
-            switch(msg.msgType)
-            {
-            case RMF_MSG_EXIT:
-               isRunning=false;
-               break;
-            case RMF_MSG_CONNECT:
-               apx_fileManager_connectHandler(self);
-               break;
-            case RMF_MSG_WRITE_NOTIFY:
-               apx_fileManager_fileWriteNotifyHandler(self, (apx_file_t*) msg.msgData3, (apx_offset_t) msg.msgData1, (apx_size_t) msg.msgData2);
-               break;
-            case RMF_MSG_FILE_WRITE:
-               apx_fileManager_fileWriteCmdHandler(self, (apx_file_t*) msg.msgData3, (const uint8_t*) msg.msgData4, (apx_offset_t) msg.msgData1, (apx_size_t) msg.msgData2);
-               apx_allocator_free(&self->allocator, (uint8_t*) msg.msgData4, (uint32_t) msg.msgData2);
-               break;
-            default:
-               APX_LOG_ERROR("[APX_FILE_MANAGER]: unknown message type: %u", msg.msgType);               
-               isRunning=false;
-               break;
-            }
-         }
-         else
-         {            
-            APX_LOG_ERROR("[APX_FILE_MANAGER]: failure while waiting for semaphore, errno=%d",errno);
-            break;
+            apx_fileManager_flushMultiWrite(self);
+            apx_fileManager_flush(self);
          }
+         (void) apx_msgQueue_consumed(&self->messageQueue, numProcessed);
+         messages_processed += (uint32_t) numProcessed;
       }
       APX_LOG_ERROR("[APX_FILE_MANAGER]: messages_processed: %u",messages_processed);
    }
    THREAD_RETURN(0);
 }
 
+/**
+ * queues a message, the queue wakes up whoever is responsible for processing it
+ * returns 0 on success, -1 if the message could not be queued
+ */
+static int8_t apx_fileManager_postMessage(apx_fileManager_t *self, const apx_msg_t *msg)
+{
+   return apx_msgQueue_post(&self->messageQueue, msg);
+}
+
+/**
+ * runs the handler for a single message, returns false when it's time to stop processing messages
+ */
+static bool apx_fileManager_processMessage(apx_fileManager_t *self, const apx_msg_t *msg)
+{
+   bool isRunning = true;
+   switch(msg->msgType)
+   {
+   case RMF_MSG_EXIT:
+      isRunning=false;
+      break;
+   case RMF_MSG_CONNECT:
+      apx_fileManager_connectHandler(self);
+      break;
+   case RMF_MSG_WRITE_NOTIFY:
+      apx_fileManager_fileWriteNotifyHandler(self, (apx_file_t*) msg->msgData3, (apx_offset_t) msg->msgData1, (apx_size_t) msg->msgData2);
+      break;
+   case RMF_MSG_FILE_WRITE:
+      apx_fileManager_fileWriteCmdHandler(self, (apx_file_t*) msg->msgData3, (const uint8_t*) msg->msgData4, (apx_offset_t) msg->msgData1, (apx_size_t) msg->msgData2);
+      apx_allocator_free(&self->allocator, (uint8_t*) msg->msgData4, (uint32_t) msg->msgData2);
+      break;
+   case RMF_MSG_SHARED_WRITE: //intentional fallthrough
+   case RMF_MSG_QUEUED_WRITE:
+      {
+         apx_sharedPayload_t *payload = (apx_sharedPayload_t*) msg->msgData4;
+         apx_fileManager_fileWriteCmdHandler(self, (apx_file_t*) msg->msgData3, payload->data, (apx_offset_t) msg->msgData1, (apx_size_t) msg->msgData2);
+         apx_sharedPayload_unref(payload);
+      }
+      break;
+   case RMF_MSG_LATEST_WRITE:
+      apx_fileManager_latestWriteHandler(self, (apx_file_t*) msg->msgData3, (apx_offset_t) msg->msgData1, (apx_size_t) msg->msgData2);
+      break;
+   case RMF_MSG_WRITE_CONTINUE:
+      apx_fileManager_writeContinueHandler(self, (apx_file_t*) msg->msgData3);
+      break;
+   case RMF_MSG_FLUSH:
+      //transmit buffer is flushed when the queue has been drained
+      break;
+   default:
+      APX_LOG_ERROR("[APX_FILE_MANAGER]: unknown message type: %u", msg->msgType);
+      isRunning=false;
+      break;
+   }
+   return isRunning;
+}
+
+/**
+ * processes messages until the queue is empty or an exit message is found, returns number of removed messages
+ */
+static int32_t apx_fileManager_drainMessages(apx_fileManager_t *self, bool *isRunning)
+{
+   int32_t numProcessed = 0;
+   apx_msg_t msg;
+   while ( (*isRunning == true) && (apx_msgQueue_remove(&self->messageQueue, &msg) == true) )
+   {
+      numProcessed++;
+      *isRunning = apx_fileManager_processMessage(self, &msg);
+   }
+   return numProcessed;
+}
+
 /**
  * Handlers are run by our worker thread
  */
@@ -555,33 +1060,51 @@ static void apx_fileManager_connectHandler(apx_fileManager_t *self)
 {
    if ( (self != 0) )
    {
-      SPINLOCK_ENTER(self->lock);
-      self->isConnected = true;
-      SPINLOCK_LEAVE(self->lock);
+      if ( (self->transmitHandler.send == 0) || (self->mode != APX_FILEMANAGER_SERVER_MODE) )
+      {
+         SPINLOCK_ENTER(self->lock);
+         self->isConnected = true;
+         SPINLOCK_LEAVE(self->lock);
+      }
       if (self->transmitHandler.send != 0)
       {
          if (self->mode == APX_FILEMANAGER_CLIENT_MODE)
          {
-            adt_list_elem_t *iter;
-            SPINLOCK_ENTER(self->lock);
-            adt_list_iter_init(&self->localFileMap.fileList);
-            SPINLOCK_LEAVE(self->lock);
-            do
+            int32_t i;
+            for (i=0;;i++)
             {
+               apx_file_t *file;
                SPINLOCK_ENTER(self->lock);
-               iter = adt_list_iter_next(&self->localFileMap.fileList);
+               file = apx_fileMap_get(&self->localFileMap, i);
                SPINLOCK_LEAVE(self->lock);
-               if (iter != 0)
+               if (file == 0)
                {
-                  apx_file_t *file = (apx_file_t*)iter->pItem;
-                  assert(file != 0);
-                  apx_fileManager_sendFileInfo(self, &file->fileInfo);
+                  break;
                }
-            } while (iter != 0);
+               apx_fileManager_sendFileInfo(self, &file->fileInfo);
+            }
          }
          else if (self->mode == APX_FILEMANAGER_SERVER_MODE)
          {
+            int32_t i;
             apx_fileManager_sendAck(self);
+            if (apx_fileManager_isMultiWriteEnabled(self) == true)
+            {
+               apx_fileManager_sendMultiWriteAccept(self);
+            }
+            //the files of a resumed node can be attached before the greeting has been acknowledged, they are announced now
+            SPINLOCK_ENTER(self->lock);
+            self->isConnected = true;
+            for (i=0;;i++)
+            {
+               apx_file_t *file = apx_fileMap_get(&self->localFileMap, i);
+               if (file == 0)
+               {
+                  break;
+               }
+               apx_fileManager_sendFileInfo(self, &file->fileInfo);
+            }
+            SPINLOCK_LEAVE(self->lock);
          }
       }      
    }
@@ -594,55 +1117,24 @@ static void apx_fileManager_fileWriteNotifyHandler(apx_fileManager_t *self, apx_
 {
    if ( (self != 0) && (file != 0) && (len > 0) )
    {
-      //in addition to the data itself we need to send a 2 byte or 4 byte header in addition to the actual data
-      //to achieve this we increase the len variable with 4 bytes and then adjust for the header length later
-      uint8_t *buf=0;
-      buf = self->transmitHandler.getSendBuffer(self->transmitHandler.arg, len+RMF_MAX_HEADER_SIZE);
-      if (buf != 0)
+      uint8_t *dataBuf;
+      if (apx_fileManager_mergeTransfer(self, file, offset, len) == true)
       {
-         uint8_t *dataBuf = &buf[RMF_MAX_HEADER_SIZE]; //the dataBuf starts RMF_MAX_HEADER_SIZE (4 bytes) into buf
-         int32_t dataLen = len;
-         int32_t address = file->fileInfo.address + offset;
-         int8_t result=-1;
-         switch(file->fileType)
-         {
-            case APX_UNKNOWN_FILE:
-               break;
-            case APX_OUTDATA_FILE:
-               result = apx_nodeData_readOutPortData(file->nodeData, dataBuf, offset, dataLen);
-               if (result != 0)
-               {
-                  APX_LOG_ERROR("[APX_FILE_MANAGER] apx_nodeData_readOutPortData failed");
-               }
-               break;
-            case APX_INDATA_FILE:
-               result = apx_nodeData_readInPortData(file->nodeData, dataBuf, offset, dataLen);
-               if (result != 0)
-               {
-                  APX_LOG_ERROR("[APX_FILE_MANAGER] apx_nodeData_writeInData failed");
-               }
-               break;
-            case APX_DEFINITION_FILE:
-               result = apx_nodeData_readDefinitionData(file->nodeData, dataBuf, offset, dataLen);
-               if (result != 0)
-               {
-                  APX_LOG_ERROR("[APX_FILE_MANAGER] apx_nodeData_readDefinitionData failed");
-               }
-               break;
-            default:
-               //TODO: check fpr user data files here
-               break;
-         }
-         if (result == 0)
+         return;
+      }
+      //small writes are read directly into the next record of the pending RMF_CMD_MULTI_WRITE message
+      dataBuf = apx_fileManager_reserveMultiWrite(self, file, offset, len);
+      if (dataBuf != 0)
+      {
+         if (apx_fileManager_readFileData(file, dataBuf, offset, len) == 0)
          {
-            int32_t headerLen = rmf_packHeaderBeforeData(dataBuf, RMF_MAX_HEADER_SIZE, address, false);
-            if (headerLen > 0)
-            {
-               int32_t msgLen = (headerLen+dataLen);
-               self->transmitHandler.send(self->transmitHandler.arg, RMF_MAX_HEADER_SIZE-headerLen, msgLen);
-            }
+            apx_fileManager_commitMultiWrite(self, dataBuf, len);
          }
       }
+      else
+      {
+         apx_fileManager_sendFileData(self, file, offset, len);
+      }
    }
 }
 
@@ -673,25 +1165,24 @@ static void apx_fileManager_fileWriteCmdHandler(apx_fileManager_t *self, apx_fil
             {
                if ( (self->isConnected == true) && (file->isOpen == true) )
                {
-                  uint8_t *sendBuf=0;
+                  uint8_t *recordData;
                   if (self->debugInfo != 0)
                   {
                      APX_LOG_DEBUG("[APX_FILE_MANAGER] (%p) Server Write %s[%d,%d]", self->debugInfo, file->fileInfo.name, (int) offset, (int) len );
                   }
-                  sendBuf = self->transmitHandler.getSendBuffer(self->transmitHandler.arg, len+RMF_MAX_HEADER_SIZE);
-                  if (sendBuf != 0)
+                  if (apx_fileManager_mergeTransfer(self, file, offset, len) == true)
                   {
-                     uint8_t *dataBuf = &sendBuf[RMF_MAX_HEADER_SIZE]; //the dataBuf starts RMF_MAX_HEADER_SIZE (4 bytes) into sendBuf, this gives us enough room for a header
-                     int32_t dataLen = len;
-                     int32_t headerLen;
-                     int32_t address = file->fileInfo.address + offset;
-                     memcpy(dataBuf,data,len);
-                     headerLen = rmf_packHeaderBeforeData(dataBuf, RMF_MAX_HEADER_SIZE, address, false);
-                     if (headerLen > 0)
-                     {
-                        int32_t msgLen = (headerLen+dataLen);
-                        self->transmitHandler.send(self->transmitHandler.arg, RMF_MAX_HEADER_SIZE-headerLen, msgLen);
-                     }
+                     return;
+                  }
+                  recordData = apx_fileManager_reserveMultiWrite(self, file, offset, len);
+                  if (recordData != 0)
+                  {
+                     memcpy(recordData, data, len);
+                     apx_fileManager_commitMultiWrite(self, recordData, len);
+                  }
+                  else
+                  {
+                     apx_fileManager_sendFileWrite(self, file, data, offset, len);
                   }
                }
                else if (file->isOpen == false)
@@ -704,6 +1195,477 @@ static void apx_fileManager_fileWriteCmdHandler(apx_fileManager_t *self, apx_fil
    }
 }
 
+/**
+ * called by worker thread to send the current value of a port written by apx_fileManager_triggerLatestWriteCmdEvent
+ */
+static void apx_fileManager_latestWriteHandler(apx_fileManager_t *self, apx_file_t *file, apx_offset_t offset, apx_size_t len)
+{
+   if ( (self != 0) && (file != 0) && (file->nodeData != 0) )
+   {
+      //clear the flag before reading the data, a write made after this point queues a new message instead of being lost
+      apx_nodeData_clearInPortDataPending(file->nodeData, offset);
+      if ( (self->isConnected == true) && (file->isOpen == true) )
+      {
+         apx_fileManager_fileWriteNotifyHandler(self, file, offset, len);
+      }
+   }
+}
+
+/**
+ * called by worker thread to send the next fragment of a large transfer
+ */
+static void apx_fileManager_writeContinueHandler(apx_fileManager_t *self, apx_file_t *file)
+{
+   if ( (self != 0) && (file != 0) && (file->transferPayload != 0) )
+   {
+      //writes batched before the fragment may hold older values of the same bytes, they must not arrive after it
+      apx_fileManager_flushMultiWrite(self);
+      if ( (self->isConnected == true) && (file->isOpen == true) )
+      {
+         apx_fileManager_continueTransfer(self, file);
+      }
+      else
+      {
+         apx_fileManager_releaseTransfer(self, file);
+      }
+   }
+}
+
+/**
+ * sends data to the remote side of file. When the transmit handler supports it, only the RMF header is encoded here
+ * and the data is gathered directly from the caller's buffer.
+ */
+static void apx_fileManager_sendFileWrite(apx_fileManager_t *self, apx_file_t *file, const uint8_t *data, apx_offset_t offset, apx_size_t len)
+{
+   uint32_t address = file->fileInfo.address + offset;
+#if APX_SHM_TRANSPORT_ENABLE
+   if (apx_fileManager_sendSharedWrite(self, address, data, len) == true)
+   {
+      return;
+   }
+#endif
+   apx_fileManager_sendData(self, address, data, (int32_t) len);
+}
+
+/**
+ * sends one RMF message with data written to address, the data is copied or gathered from the caller's buffer
+ */
+static void apx_fileManager_sendData(apx_fileManager_t *self, uint32_t address, const uint8_t *data, int32_t len)
+{
+   //data that does not fit in one message is split into several messages, all but the last one sent with more_bit
+   int32_t maxFragmentLen = (int32_t) apx_fileManager_getMaxFragmentLen(self);
+   do
+   {
+      int32_t fragmentLen = (len > maxFragmentLen)? maxFragmentLen : len;
+      bool more_bit = (len > maxFragmentLen)? true : false;
+      if (apx_fileManager_sendFragment(self, address, data, fragmentLen, more_bit) != 0)
+      {
+         return;
+      }
+      address += (uint32_t) fragmentLen;
+      data += fragmentLen;
+      len -= fragmentLen;
+   } while (len > 0);
+}
+
+/**
+ * sends one RMF data message that fits within the max fragment length. Returns 0 on success, -1 when there is no room in the transmit buffer
+ */
+static int8_t apx_fileManager_sendFragment(apx_fileManager_t *self, uint32_t address, const uint8_t *data, int32_t len, bool more_bit)
+{
+   int32_t headerLen;
+   if (self->transmitHandler.sendGather != 0)
+   {
+      uint8_t header[RMF_MAX_HEADER_SIZE];
+      headerLen = rmf_packHeader(header, (int32_t) sizeof(header), address, more_bit);
+      if (headerLen > 0)
+      {
+         self->transmitHandler.sendGather(self->transmitHandler.arg, header, headerLen, data, len);
+      }
+   }
+   else
+   {
+      uint8_t *dataBuf;
+      uint8_t *sendBuf = self->transmitHandler.getSendBuffer(self->transmitHandler.arg, len+RMF_MAX_HEADER_SIZE);
+      if (sendBuf == 0)
+      {
+         return -1;
+      }
+      dataBuf = &sendBuf[RMF_MAX_HEADER_SIZE]; //the dataBuf starts RMF_MAX_HEADER_SIZE (4 bytes) into sendBuf, this gives us enough room for a header
+      memcpy(dataBuf,data,len);
+      headerLen = rmf_packHeaderBeforeData(dataBuf, RMF_MAX_HEADER_SIZE, address, more_bit);
+      if (headerLen > 0)
+      {
+         int32_t msgLen = (headerLen+len);
+         self->transmitHandler.send(self->transmitHandler.arg, RMF_MAX_HEADER_SIZE-headerLen, msgLen);
+      }
+   }
+   return 0;
+}
+
+/**
+ * reads data from a local file and sends it to the remote side.
+ * Data that does not fit in one message is read once into a transfer that is sent in fragments, see apx_fileManager_continueTransfer.
+ * A port is then never split between two reads of the file.
+ */
+static void apx_fileManager_sendFileData(apx_fileManager_t *self, apx_file_t *file, apx_offset_t offset, apx_size_t len)
+{
+   if (len > apx_fileManager_getMaxFragmentLen(self))
+   {
+      apx_sharedPayload_t *payload;
+      //the remote side keeps track of one sequence per file
+      apx_fileManager_finishTransfer(self, file);
+      payload = apx_sharedPayload_new(len);
+      if (payload == 0)
+      {
+         APX_LOG_ERROR("[APX_FILE_MANAGER] out of memory for transfer of %d bytes", (int) len);
+         return;
+      }
+      //counted before the file is read, see apx_fileManager_directWriteCmd
+      (void) APX_ATOMIC_INCREMENT(self->numTransfers);
+      if (apx_fileManager_readFileData(file, payload->data, offset, len) != 0)
+      {
+         apx_sharedPayload_unref(payload);
+         (void) APX_ATOMIC_DECREMENT(self->numTransfers);
+         return;
+      }
+      file->transferPayload = payload;
+      file->transferOffset = offset;
+      file->transferNextOffset = offset;
+      apx_fileManager_continueTransfer(self, file);
+   }
+   else
+   {
+      //the data is read RMF_MAX_HEADER_SIZE (4 bytes) into the send buffer, the RMF header is then packed right before it
+      uint8_t *buf;
+      uint8_t *dataBuf;
+      int32_t headerLen;
+      uint32_t address = file->fileInfo.address + offset;
+      buf = self->transmitHandler.getSendBuffer(self->transmitHandler.arg, len+RMF_MAX_HEADER_SIZE);
+      if (buf == 0)
+      {
+         return;
+      }
+      dataBuf = &buf[RMF_MAX_HEADER_SIZE];
+      if (apx_fileManager_readFileData(file, dataBuf, offset, len) != 0)
+      {
+         return;
+      }
+#if APX_SHM_TRANSPORT_ENABLE
+      //definition data is always sent over the socket, it must arrive after the file info that announced it
+      if ( (file->fileType != APX_DEFINITION_FILE) && (apx_fileManager_sendSharedWrite(self, address, dataBuf, len) == true) )
+      {
+         return;
+      }
+#endif
+      headerLen = rmf_packHeaderBeforeData(dataBuf, RMF_MAX_HEADER_SIZE, address, false);
+      if (headerLen > 0)
+      {
+         int32_t msgLen = (headerLen+(int32_t) len);
+         self->transmitHandler.send(self->transmitHandler.arg, RMF_MAX_HEADER_SIZE-headerLen, msgLen);
+      }
+   }
+}
+
+/**
+ * sends the next fragment of the transfer pending in file, all but the last fragment is sent with more_bit.
+ * Returns true while more fragments remain.
+ */
+static bool apx_fileManager_sendTransferFragment(apx_fileManager_t *self, apx_file_t *file)
+{
+   apx_sharedPayload_t *payload = file->transferPayload;
+   apx_size_t maxFragmentLen = apx_fileManager_getMaxFragmentLen(self);
+   apx_offset_t endOffset = file->transferOffset + payload->dataLen;
+   apx_size_t fragmentLen = endOffset - file->transferNextOffset;
+   bool more_bit = false;
+   if (fragmentLen > maxFragmentLen)
+   {
+      fragmentLen = maxFragmentLen;
+      more_bit = true;
+   }
+   if (apx_fileManager_sendFragment(self, file->fileInfo.address + file->transferNextOffset, &payload->data[file->transferNextOffset - file->transferOffset], (int32_t) fragmentLen, more_bit) != 0)
+   {
+      more_bit = false;
+   }
+   file->transferNextOffset += fragmentLen;
+   if (more_bit == false)
+   {
+      apx_fileManager_releaseTransfer(self, file);
+   }
+   return more_bit;
+}
+
+/**
+ * sends the next fragment of the transfer pending in file, the rest of the transfer is queued behind the writes that are already waiting
+ */
+static void apx_fileManager_continueTransfer(apx_fileManager_t *self, apx_file_t *file)
+{
+   while (apx_fileManager_sendTransferFragment(self, file) == true)
+   {
+      apx_msg_t msg = {RMF_MSG_WRITE_CONTINUE,0,0,0,0}; //{msgType,  msgData1, msgData2, msgData3, msgData4}
+      msg.msgData3 = file;
+      if (apx_fileManager_postMessage(self, &msg) == 0)
+      {
+         return;
+      }
+      //the queue is full, the rest is sent without giving other writes a chance to get in between
+   }
+}
+
+/**
+ * sends all remaining fragments of the transfer pending in file without giving other writes a chance to get in between
+ */
+static void apx_fileManager_finishTransfer(apx_fileManager_t *self, apx_file_t *file)
+{
+   if (file->transferPayload != 0)
+   {
+      apx_fileManager_flushMultiWrite(self);
+      while (apx_fileManager_sendTransferFragment(self, file) == true)
+      {
+         //MISRA
+      }
+   }
+}
+
+/**
+ * called before a write to file is sent. The fragments of a pending transfer of the same file that are not yet sent are updated with the new data,
+ * they would otherwise overwrite it with older values on the remote side.
+ * Returns true when the write is covered by those fragments, it must then not be sent on its own.
+ * The remote side would take a write that starts where the next fragment starts for the end of the transfer.
+ */
+static bool apx_fileManager_mergeTransfer(apx_fileManager_t *self, apx_file_t *file, apx_offset_t offset, apx_size_t len)
+{
+   apx_sharedPayload_t *payload = file->transferPayload;
+   if (payload != 0)
+   {
+      apx_offset_t transferEnd = file->transferOffset + payload->dataLen;
+      apx_offset_t writeEnd = offset + len;
+      if (len > apx_fileManager_getMaxFragmentLen(self))
+      {
+         //a write sent in fragments of its own can't be interleaved with the pending transfer
+         apx_fileManager_finishTransfer(self, file);
+      }
+      else if ( (offset < transferEnd) && (writeEnd > file->transferNextOffset) )
+      {
+         apx_offset_t beginOffset = (offset > file->transferNextOffset)? offset : file->transferNextOffset;
+         apx_offset_t endOffset = (writeEnd < transferEnd)? writeEnd : transferEnd;
+         if (apx_fileManager_readFileData(file, &payload->data[beginOffset - file->transferOffset], beginOffset, endOffset-beginOffset) == 0)
+         {
+            return ( (offset >= file->transferNextOffset) && (writeEnd <= transferEnd) );
+         }
+      }
+      else
+      {
+         //MISRA
+      }
+   }
+   return false;
+}
+
+/**
+ * ends the transfer pending in file, fragments not sent yet are discarded
+ */
+static void apx_fileManager_releaseTransfer(apx_fileManager_t *self, apx_file_t *file)
+{
+   if (file->transferPayload != 0)
+   {
+      apx_sharedPayload_unref(file->transferPayload);
+      file->transferPayload = (apx_sharedPayload_t*) 0;
+      (void) APX_ATOMIC_DECREMENT(self->numTransfers);
+   }
+}
+
+/**
+ * reads len bytes starting at offset from the nodeData of a local file into dataBuf. Returns 0 on success, -1 on failure
+ */
+static int8_t apx_fileManager_readFileData(apx_file_t *file, uint8_t *dataBuf, apx_offset_t offset, apx_size_t len)
+{
+   int8_t result=-1;
+   switch(file->fileType)
+   {
+      case APX_UNKNOWN_FILE:
+         break;
+      case APX_OUTDATA_FILE:
+         result = apx_nodeData_readOutPortData(file->nodeData, dataBuf, offset, len);
+         if (result != 0)
+         {
+            APX_LOG_ERROR("[APX_FILE_MANAGER] apx_nodeData_readOutPortData failed");
+         }
+         break;
+      case APX_INDATA_FILE:
+         result = apx_nodeData_readInPortData(file->nodeData, dataBuf, offset, len);
+         if (result != 0)
+         {
+            APX_LOG_ERROR("[APX_FILE_MANAGER] apx_nodeData_writeInData failed");
+         }
+         break;
+      case APX_DEFINITION_FILE:
+         result = apx_nodeData_readDefinitionData(file->nodeData, dataBuf, offset, len);
+         if (result != 0)
+         {
+            APX_LOG_ERROR("[APX_FILE_MANAGER] apx_nodeData_readDefinitionData failed");
+         }
+         break;
+      default:
+         //TODO: check fpr user data files here
+         break;
+   }
+   return (result == 0)? 0 : -1;
+}
+
+/**
+ * returns the largest number of data bytes sent in one message. This is APX_FILEMANAGER_MAX_FRAGMENT_LEN unless
+ * the message length header negotiated by the connection cannot describe messages that long
+ */
+static apx_size_t apx_fileManager_getMaxFragmentLen(apx_fileManager_t *self)
+{
+   if (self->transmitHandler.getSendAvail != 0)
+   {
+      int32_t sendAvail = self->transmitHandler.getSendAvail(self->transmitHandler.arg);
+      if ( (sendAvail > (int32_t) RMF_MAX_HEADER_SIZE) && (sendAvail-RMF_MAX_HEADER_SIZE < APX_FILEMANAGER_MAX_FRAGMENT_LEN) )
+      {
+         return (apx_size_t) (sendAvail-RMF_MAX_HEADER_SIZE);
+      }
+   }
+   return (apx_size_t) APX_FILEMANAGER_MAX_FRAGMENT_LEN;
+}
+
+/**
+ * returns where the data of a new record in the pending RMF_CMD_MULTI_WRITE message shall be written, the record is added by apx_fileManager_commitMultiWrite.
+ * Returns NULL when the write must be sent as an ordinary data message, in that case everything batched so far has already been sent.
+ */
+static uint8_t *apx_fileManager_reserveMultiWrite(apx_fileManager_t *self, apx_file_t *file, apx_offset_t offset, apx_size_t len)
+{
+   int32_t headerLen;
+   if ( (self->multiWriteLen > 0) && (self->multiWriteFile != file) )
+   {
+      apx_fileManager_flushMultiWrite(self);
+   }
+   if ( (file->fileType == APX_DEFINITION_FILE) || (offset > RMF_MULTI_WRITE_MAX_OFFSET) || (len > RMF_MULTI_WRITE_MAX_OFFSET) ||
+#if APX_SHM_TRANSPORT_ENABLE
+        (APX_ATOMIC_LOAD_ACQUIRE(self->shmTransport) != 0) ||
+#endif
+        (apx_fileManager_isMultiWriteEnabled(self) == false) )
+   {
+      apx_fileManager_flushMultiWrite(self);
+      return (uint8_t*) 0;
+   }
+   if (self->multiWriteLen == 0)
+   {
+      self->multiWriteLen = rmf_serialize_cmdMultiWrite(self->multiWriteBuf, (int32_t) sizeof(self->multiWriteBuf), file->fileInfo.address);
+      if (self->multiWriteLen <= 0)
+      {
+         self->multiWriteLen = 0;
+         return (uint8_t*) 0;
+      }
+      self->multiWriteFile = file;
+   }
+   headerLen = rmf_packMultiWriteRecordHeader(&self->multiWriteBuf[self->multiWriteLen], (int32_t) sizeof(self->multiWriteBuf)-self->multiWriteLen, offset, (int32_t) len);
+   if ( (headerLen == 0) && (self->multiWriteNumRecords > 0) )
+   {
+      //message is full, start a new one
+      apx_fileManager_flushMultiWrite(self);
+      return apx_fileManager_reserveMultiWrite(self, file, offset, len);
+   }
+   if (headerLen <= 0)
+   {
+      //too large to ever fit in a multi-write message
+      self->multiWriteLen = 0;
+      return (uint8_t*) 0;
+   }
+   return &self->multiWriteBuf[self->multiWriteLen+headerLen];
+}
+
+/**
+ * adds the record whose data was written to the location returned by apx_fileManager_reserveMultiWrite
+ */
+static void apx_fileManager_commitMultiWrite(apx_fileManager_t *self, const uint8_t *recordData, apx_size_t len)
+{
+   self->multiWriteLen = (int32_t) (recordData-self->multiWriteBuf) + (int32_t) len;
+   self->multiWriteNumRecords++;
+}
+
+/**
+ * sends the pending RMF_CMD_MULTI_WRITE message.
+ * When there are too few records to make up for the extra header, the records are sent as ordinary data messages instead
+ */
+static void apx_fileManager_flushMultiWrite(apx_fileManager_t *self)
+{
+   if (self->multiWriteNumRecords > 0)
+   {
+      rmf_msg_t msg;
+      uint32_t baseAddress;
+      int32_t plainLen = 0;
+      int32_t pass;
+      int32_t result = rmf_deserialize_cmdMultiWrite(self->multiWriteBuf, self->multiWriteLen, &baseAddress);
+      assert(result == RMF_MULTI_WRITE_CMD_LEN);
+      //pass 0 calculates the size of the ordinary data messages, pass 1 sends them if they are smaller
+      for (pass=0; pass<2; pass++)
+      {
+         const uint8_t *pNext = &self->multiWriteBuf[RMF_MULTI_WRITE_CMD_LEN];
+         const uint8_t *pEnd = &self->multiWriteBuf[self->multiWriteLen];
+         while (pNext < pEnd)
+         {
+            result = rmf_deserialize_multiWriteRecord(pNext, (int32_t) (pEnd-pNext), baseAddress, &msg);
+            assert(result > 0);
+            if (pass == 0)
+            {
+               //each message also needs a length header of at least one byte
+               plainLen += (int32_t) ((msg.address <= RMF_DATA_LOW_MAX_ADDR)? RMF_LOW_ADDRESS_SIZE : RMF_HIGH_ADDRESS_SIZE) + msg.dataLen + 1;
+            }
+            else
+            {
+               apx_fileManager_sendData(self, msg.address, msg.data, msg.dataLen);
+            }
+            pNext += result;
+         }
+         if ( (pass == 0) && (plainLen > (int32_t) RMF_HIGH_ADDRESS_SIZE + self->multiWriteLen + 1) )
+         {
+            apx_fileManager_sendData(self, RMF_CMD_START_ADDR, self->multiWriteBuf, self->multiWriteLen);
+            break;
+         }
+      }
+   }
+   self->multiWriteLen = 0;
+   self->multiWriteNumRecords = 0;
+   self->multiWriteFile = (apx_file_t*) 0;
+}
+
+#if APX_SHM_TRANSPORT_ENABLE
+/**
+ * sends port data through the shared memory transport when one is attached.
+ * returns false when the data must be sent over the socket instead. Writes too large for the shared data area always take the socket,
+ * the transport first waits until all earlier shared memory writes have been consumed so the receiver still sees writes in order.
+ */
+static bool apx_fileManager_sendSharedWrite(apx_fileManager_t *self, uint32_t address, const uint8_t *data, apx_size_t len)
+{
+   apx_shmTransport_t *shmTransport = APX_ATOMIC_LOAD_ACQUIRE(self->shmTransport);
+   if (shmTransport != 0)
+   {
+      if (apx_shmTransport_write(shmTransport, address, data, (uint32_t) len) == 0)
+      {
+         return true;
+      }
+      if (errno != EMSGSIZE)
+      {
+         APX_LOG_WARNING("[APX_FILE_MANAGER(%s)] shared memory write failed with %d, sending over socket", apx_fileManager_modeString(self), (int) errno);
+      }
+   }
+   return false;
+}
+
+/**
+ * called by the receive thread of the shared memory transport
+ */
+static void apx_fileManager_sharedWriteReceived(void *arg, uint32_t address, const uint8_t *data, uint32_t dataLen)
+{
+   apx_fileManager_t *self = (apx_fileManager_t*) arg;
+   MUTEX_LOCK(self->parseLock);
+   apx_fileManager_parseDataMsg(self, address, data, (int32_t) dataLen, false);
+   MUTEX_UNLOCK(self->parseLock);
+}
+#endif
+
 static void apx_fileManager_sendFileInfo(apx_fileManager_t *self, rmf_fileInfo_t *fileInfo)
 {
    if (self != 0)
@@ -785,6 +1747,9 @@ static void apx_fileManager_parseCmdMsg(apx_fileManager_t *self, const uint8_t *
                   }
                }
                break;
+            case RMF_CMD_MULTI_WRITE:
+               apx_fileManager_parseMultiWrite(self, msgBuf, msgLen);
+               break;
             case RMF_CMD_HEARTBEAT_RQST:
                ///TODO: implement
                break;
@@ -881,9 +1846,40 @@ static void apx_fileManager_parseDataMsg(apx_fileManager_t *self, uint32_t addre
                }
                if (result == 0)
                {
-                  if ((more_bit == false) && (self->nodeManager != 0) )
+                  //the sender takes turns between large transfers, each file keeps track of its own pending sequence.
+                  //Other writes to the file may arrive while a sequence is pending
+                  uint32_t startOffset = offset;
+                  if (remoteFile->isFragmentPending == true)
+                  {
+                     if (offset == remoteFile->fragmentEndOffset)
+                     {
+                        //continuation of the pending sequence, the notification covers all of it
+                        startOffset = remoteFile->fragmentStartOffset;
+                        remoteFile->isFragmentPending = false;
+                     }
+                     else if ( (more_bit == true) && (self->nodeManager != 0) )
+                     {
+                        //a new sequence replaces the pending one, the part of it that was received is notified now
+                        apx_nodeManager_remoteFileWritten(self->nodeManager, self, remoteFile, remoteFile->fragmentStartOffset, remoteFile->fragmentEndOffset - remoteFile->fragmentStartOffset);
+                     }
+                     else
+                     {
+                        //MISRA
+                     }
+                  }
+                  if (more_bit == true)
+                  {
+                     remoteFile->isFragmentPending = true;
+                     remoteFile->fragmentStartOffset = startOffset;
+                     remoteFile->fragmentEndOffset = offset + (uint32_t) dataLen;
+                  }
+                  else if (self->nodeManager != 0)
+                  {
+                     apx_nodeManager_remoteFileWritten(self->nodeManager, self, remoteFile, startOffset, (offset - startOffset) + (uint32_t) dataLen);
+                  }
+                  else
                   {
-                     apx_nodeManager_remoteFileWritten(self->nodeManager, self, remoteFile, offset, dataLen);
+                     //MISRA
                   }
                }
             }
@@ -896,6 +1892,41 @@ static void apx_fileManager_parseDataMsg(apx_fileManager_t *self, uint32_t addre
    }
 }
 
+/**
+ * each record of an RMF_CMD_MULTI_WRITE message is processed as if it had been received in a data message of its own.
+ * A message without records tells a client that the server accepts RMF_CMD_MULTI_WRITE.
+ */
+static void apx_fileManager_parseMultiWrite(apx_fileManager_t *self, const uint8_t *msgBuf, int32_t msgLen)
+{
+   uint32_t baseAddress;
+   int32_t result = rmf_deserialize_cmdMultiWrite(msgBuf, msgLen, &baseAddress);
+   if (result <= 0)
+   {
+      APX_LOG_ERROR("[APX_FILE_MANAGER] rmf_deserialize_cmdMultiWrite failed with %d", (int) result);
+      return;
+   }
+   if ( (result == msgLen) && (self->mode == APX_FILEMANAGER_CLIENT_MODE) )
+   {
+      apx_fileManager_setMultiWrite(self, true);
+      return;
+   }
+   msgBuf += result;
+   msgLen -= result;
+   while (msgLen > 0)
+   {
+      rmf_msg_t msg;
+      result = rmf_deserialize_multiWriteRecord(msgBuf, msgLen, baseAddress, &msg);
+      if (result <= 0)
+      {
+         APX_LOG_ERROR("[APX_FILE_MANAGER(%s)] invalid record in multi-write message", apx_fileManager_modeString(self));
+         break;
+      }
+      apx_fileManager_parseDataMsg(self, msg.address, msg.data, msg.dataLen, false);
+      msgBuf += result;
+      msgLen -= result;
+   }
+}
+
 /**
  * called when we see a new rmf_fileInfo_t in the input/parse stream
  */
@@ -936,6 +1967,11 @@ static void apx_fileManager_processOpenFile(apx_fileManager_t *self, const rmf_c
          {
             APX_LOG_DEBUG("[APX_FILE_MANAGER] (%p) Client opened %s", self->debugInfo, localFile->fileInfo.name);
          }
+         if ( (localFile->fileType == APX_INDATA_FILE) && (localFile->nodeData != 0) && (localFile->nodeData->inPortResumeFlags != 0) )
+         {
+            apx_fileManager_openResumedInPortDataFile(self, localFile);
+            return;
+         }
          apx_fileManager_triggerFileUpdatedEvent(self, localFile, 0, bytesToSend);
          if (localFile->nodeData != 0)
          {
@@ -955,6 +1991,42 @@ static void apx_fileManager_processOpenFile(apx_fileManager_t *self, const rmf_c
    }
 }
 
+/**
+ * The client of a resumed session still has the values it received before its connection was lost, only the bytes written since then are sent
+ */
+static void apx_fileManager_openResumedInPortDataFile(apx_fileManager_t *self, apx_file_t *localFile)
+{
+   uint8_t *resumeFlags;
+   uint32_t offset = 0;
+   apx_file_open(localFile);
+   apx_nodeData_setInPortDataFile(localFile->nodeData, localFile);
+   apx_nodeData_setFileManager(localFile->nodeData, self);
+   //routed writes that did not see the file yet have flagged their bytes once this returns
+   apx_rcu_synchronize();
+   resumeFlags = apx_nodeData_takeInPortResumeFlags(localFile->nodeData);
+   if (resumeFlags == 0)
+   {
+      return;
+   }
+   while (offset < localFile->fileInfo.length)
+   {
+      uint32_t end;
+      if (resumeFlags[offset] == 0)
+      {
+         offset++;
+         continue;
+      }
+      end = offset + 1;
+      while ( (end < localFile->fileInfo.length) && (resumeFlags[end] != 0) )
+      {
+         end++;
+      }
+      apx_fileManager_triggerFileUpdatedEvent(self, localFile, offset, end - offset);
+      offset = end;
+   }
+   free(resumeFlags);
+}
+
 /*
 * send an acknowledge message
 */
@@ -980,3 +2052,98 @@ static void apx_fileManager_sendAck(apx_fileManager_t *self)
       }
    }
 }
+
+/**
+ * tells the client that the server accepts RMF_CMD_MULTI_WRITE, must be sent after the acknowledge
+ */
+static void apx_fileManager_sendMultiWriteAccept(apx_fileManager_t *self)
+{
+   uint8_t cmdBuf[RMF_MULTI_WRITE_CMD_LEN];
+   int32_t dataLen = rmf_serialize_cmdMultiWrite(cmdBuf, (int32_t) sizeof(cmdBuf), 0u);
+   if (dataLen > 0)
+   {
+      apx_fileManager_sendData(self, RMF_CMD_START_ADDR, cmdBuf, dataLen);
+   }
+}
+
+/**
+ * asks the transmit handler to send all messages it has held back
+ */
+static void apx_fileManager_flush(apx_fileManager_t *self)
+{
+   if (self->transmitHandler.flush != 0)
+   {
+      self->transmitHandler.flush(self->transmitHandler.arg);
+   }
+}
+
+/**
+ * releases resources held by messages that were never processed
+ */
+static void apx_fileManager_releaseQueuedMessages(apx_fileManager_t *self)
+{
+   apx_msg_t msg;
+   while (apx_msgQueue_remove(&self->messageQueue, &msg) == true)
+   {
+      apx_fileManager_releaseMessage((void*) self, &msg);
+   }
+}
+
+/**
+ * Port data writes may be discarded when the queue is over budget. Connection events and exit requests must always be processed.
+ * Latest-value writes are never discarded, there is at most one of them per port.
+ * Write notifications are never discarded either, they hold no data of their own and the initial notification of an opened file must reach the peer.
+ * Writes to queued ports (RMF_MSG_QUEUED_WRITE) must all be delivered.
+ */
+static bool apx_fileManager_isDroppableMessage(void *arg, const apx_msg_t *msg)
+{
+   (void) arg;
+   return ( (msg->msgType == RMF_MSG_FILE_WRITE) || (msg->msgType == RMF_MSG_SHARED_WRITE) );
+}
+
+/**
+ * A queued write is obsolete when a newer write of the same kind covers exactly the same bytes of the same file
+ */
+static bool apx_fileManager_isConflatableMessage(void *arg, const apx_msg_t *queuedMsg, const apx_msg_t *newMsg)
+{
+   (void) arg;
+   return ( (apx_fileManager_isDroppableMessage(arg, newMsg) == true) &&
+            (queuedMsg->msgType == newMsg->msgType) &&
+            (queuedMsg->msgData3 == newMsg->msgData3) &&
+            (queuedMsg->msgData1 == newMsg->msgData1) &&
+            (queuedMsg->msgData2 == newMsg->msgData2) );
+}
+
+static uint32_t apx_fileManager_getMessageSize(void *arg, const apx_msg_t *msg)
+{
+   (void) arg;
+   if ( (msg->msgType == RMF_MSG_FILE_WRITE) || (msg->msgType == RMF_MSG_SHARED_WRITE) || (msg->msgType == RMF_MSG_QUEUED_WRITE) )
+   {
+      return msg->msgData2;
+   }
+   return 0;
+}
+
+/**
+ * releases the data owned by a message that is discarded without being processed
+ */
+static void apx_fileManager_releaseMessage(void *arg, const apx_msg_t *msg)
+{
+   apx_fileManager_t *self = (apx_fileManager_t*) arg;
+   if (msg->msgType == RMF_MSG_FILE_WRITE)
+   {
+      apx_allocator_free(&self->allocator, (uint8_t*) msg->msgData4, (uint32_t) msg->msgData2);
+   }
+   else if ( (msg->msgType == RMF_MSG_SHARED_WRITE) || (msg->msgType == RMF_MSG_QUEUED_WRITE) )
+   {
+      apx_sharedPayload_unref((apx_sharedPayload_t*) msg->msgData4);
+   }
+   else if ( (msg->msgType == RMF_MSG_LATEST_WRITE) && (msg->msgData3 != 0) )
+   {
+      apx_nodeData_clearInPortDataPending(((apx_file_t*) msg->msgData3)->nodeData, msg->msgData1);
+   }
+   else if ( (msg->msgType == RMF_MSG_WRITE_CONTINUE) && (msg->msgData3 != 0) )
+   {
+      apx_fileManager_releaseTransfer(self, (apx_file_t*) msg->msgData3);
+   }
+}
@@ -29,6 +29,9 @@
 // LOCAL FUNCTION PROTOTYPES
 //////////////////////////////////////////////////////////////////////////////
 static int8_t apx_fileMap_autoInsertFile(apx_fileMap_t *self, apx_file_t *pFile, uint32_t start_address, uint32_t end_address, uint32_t address_boundary);
+static int32_t apx_fileMap_upperBound(const apx_fileMap_t *self, uint32_t address);
+static int32_t apx_fileMap_indexOf(const apx_fileMap_t *self, const apx_file_t *pFile);
+static void apx_fileMap_restoreFileName(apx_fileMap_t *self, const char *name);
 
 //////////////////////////////////////////////////////////////////////////////
 // GLOBAL VARIABLES
@@ -46,14 +49,16 @@ void apx_fileMap_create(apx_fileMap_t *self)
 {
    if (self != 0)
    {
-      adt_list_create(&self->fileList, apx_file_vdelete);
+      adt_ary_create(&self->fileList, apx_file_vdelete);
+      adt_hash_create(&self->fileNameMap, (void(*)(void*)) 0);
    }
 }
 void apx_fileMap_destroy(apx_fileMap_t *self)
 {
    if (self !=0)
    {
-      adt_list_destroy(&self->fileList);
+      adt_hash_destroy(&self->fileNameMap);
+      adt_ary_destroy(&self->fileList);
    }
 }
 
@@ -88,140 +93,138 @@ int8_t apx_fileMap_insertFile(apx_fileMap_t *self, apx_file_t *pFile)
 {
    if ( (self != 0) && (pFile != 0) )
    {
-      adt_list_elem_t *pIter = adt_list_first(&self->fileList);
-      if (pIter == 0)
+      int32_t index;
+      int32_t len = adt_ary_length(&self->fileList);
+      void **files;
+      void **ppVal;
+      uint32_t start_address = pFile->fileInfo.address;
+      uint32_t end_address = start_address+pFile->fileInfo.length;
+      //index of the first file with an address greater than the address of pFile
+      index = apx_fileMap_upperBound(self, start_address);
+      if (index > 0)
       {
-         adt_list_insert(&self->fileList, pFile);
-      }
-      else
-      {
-         apx_file_t *pLast=0;
-         apx_file_t *pCurrent=0;
-         adt_list_iter_init(&self->fileList);
-         do
-         {
-            pIter = adt_list_iter_next(&self->fileList);
-            if (pIter != 0)
-            {
-               pCurrent = (apx_file_t*) pIter->pItem;
-               assert(pCurrent != 0);
-               if( pCurrent->fileInfo.address > pFile->fileInfo.address)
-               {
-                  //try to fit pFile in before pCurrent;
-                  break;
-               }
-               pLast = pCurrent;
-            }
-         } while(pIter != 0);
-         if (pIter != 0)
+         //check if there is room to fit this file between pLast and pFile
+         apx_file_t *pLast = (apx_file_t*) adt_ary_value(&self->fileList, index-1);
+         if ( (pLast->fileInfo.address+pLast->fileInfo.length) > start_address)
          {
-            uint32_t start_address;
-            uint32_t end_address;
-            assert(pCurrent != 0);
-            assert( ((apx_file_t*) pIter->pItem) == pCurrent);
-            if (pLast != 0)
-            {
-               //check if there is room to fit this file between pLast and pFile
-               uint32_t start_address;
-               uint32_t end_address;
-               start_address = pLast->fileInfo.address;
-               end_address = start_address+pLast->fileInfo.length;
-               if (end_address > pFile->fileInfo.address)
-               {
-                  //address collision between pLast and pFile, reject insertion of pFile
-                  errno = EADDRINUSE; /* Address already in use */
-                  return -1;
-               }
-            }
-            start_address = pFile->fileInfo.address;
-            end_address = start_address+pFile->fileInfo.length;
-            if (end_address > pCurrent->fileInfo.address)
-            {
-               //address collision between pCurrent and pFile, reject insertion of pFile
-               errno = EFBIG; /* File too large */
-               return -1;
-            }
-            //it should now be safe to insert the file before pIter
-            adt_list_insertBefore(&self->fileList, pIter, pFile);
+            //address collision between pLast and pFile, reject insertion of pFile
+            errno = EADDRINUSE; /* Address already in use */
+            return -1;
          }
-         else
+      }
+      if (index < len)
+      {
+         apx_file_t *pCurrent = (apx_file_t*) adt_ary_value(&self->fileList, index);
+         if (end_address > pCurrent->fileInfo.address)
          {
-            //insert pFile at end of list
-            adt_list_insert(&self->fileList, pFile);
+            //address collision between pCurrent and pFile, reject insertion of pFile
+            errno = EFBIG; /* File too large */
+            return -1;
          }
-         return 0;
       }
+      //grow the array by one and move the files after index one step up
+      adt_ary_push(&self->fileList, pFile);
+      files = adt_ary_get(&self->fileList, 0);
+      if (index < len)
+      {
+         memmove(&files[index+1], &files[index], (len-index)*sizeof(void*));
+         files[index] = pFile;
+      }
+      //when names are not unique, findByName returns the file with the lowest address
+      ppVal = adt_hash_get(&self->fileNameMap, pFile->fileInfo.name, 0);
+      if ( (ppVal == 0) || ( ((apx_file_t*) *ppVal)->fileInfo.address > start_address) )
+      {
+         adt_hash_set(&self->fileNameMap, pFile->fileInfo.name, 0, pFile);
+      }
+      return 0;
    }
    errno = EINVAL;
    return -1;
 }
 
 /**
- * removes pFile from self->fileList
+ * removes pFile from self->fileList without deleting it
+ * returns 0 success, -1 when pFile is not in the map
  */
 int8_t apx_fileMap_removeFile(apx_fileMap_t *self, apx_file_t *pFile)
 {
    if ( (self != 0) && (pFile != 0) )
    {
-      //TODO: fix adt_list_remove so that it returns success/failure
-      adt_list_remove(&self->fileList, pFile);
-      return 0;
+      int32_t index = apx_fileMap_indexOf(self, pFile);
+      if (index >= 0)
+      {
+         void **ppVal;
+         adt_ary_destructorEnable(&self->fileList, false);
+         adt_ary_splice(&self->fileList, index, 1);
+         adt_ary_destructorEnable(&self->fileList, true);
+         ppVal = adt_hash_get(&self->fileNameMap, pFile->fileInfo.name, 0);
+         if ( (ppVal != 0) && (*ppVal == pFile) )
+         {
+            adt_hash_remove(&self->fileNameMap, pFile->fileInfo.name, 0);
+            apx_fileMap_restoreFileName(self, pFile->fileInfo.name);
+         }
+         return 0;
+      }
    }
+   errno = EINVAL;
    return -1;
 }
 
 apx_file_t *apx_fileMap_findByAddress(apx_fileMap_t *self, uint32_t address)
 {
-   apx_file_t *retval=0;
    if (self != 0)
    {
-      adt_list_elem_t *pIter;
-      adt_list_iter_init(&self->fileList);
-      do
+      //files never overlap, only the last file starting at or before address can contain it
+      int32_t index = apx_fileMap_upperBound(self, address);
+      if (index > 0)
       {
-         pIter = adt_list_iter_next(&self->fileList);
-         if (pIter != 0)
+         apx_file_t *pFile = (apx_file_t*) adt_ary_value(&self->fileList, index-1);
+         uint32_t startAddress;
+         uint32_t endAddress;
+         assert(pFile != 0);
+         startAddress = pFile->fileInfo.address;
+         endAddress = startAddress + pFile->fileInfo.length;
+         if ( (address>=startAddress) && (address<endAddress) )
          {
-            uint32_t startAddress;
-            uint32_t endAddress;
-            apx_file_t *pFile = (apx_file_t*) pIter->pItem;
-            assert(pFile != 0);
-            startAddress = pFile->fileInfo.address;
-            endAddress = startAddress + pFile->fileInfo.length;
-            if ( (address>=startAddress) && (address<endAddress) )
-            {
-               retval = pFile;
-               break;
-            }
+            return pFile;
          }
-      } while(pIter != 0);
+      }
    }
-   return retval;
+   return (apx_file_t*) 0;
 }
 
 apx_file_t *apx_fileMap_findByName(apx_fileMap_t *self, const char *name)
 {
-   apx_file_t *retval=0;
-   if (self != 0)
+   if ( (self != 0) && (name != 0) )
    {
-      adt_list_elem_t *pIter;
-      adt_list_iter_init(&self->fileList);
-      do
+      void **ppVal = adt_hash_get(&self->fileNameMap, name, 0);
+      if (ppVal != 0)
       {
-         pIter = adt_list_iter_next(&self->fileList);
-         if (pIter != 0)
-         {
-            apx_file_t *pFile = (apx_file_t*) pIter->pItem;
-            assert(pFile != 0);
-            if ( (strcmp(pFile->fileInfo.name, name)==0) )
-            {
-               retval = pFile;
-               break;
-            }
-         }
-      } while(pIter != 0);
+         return (apx_file_t*) *ppVal;
+      }
+   }
+   return (apx_file_t*) 0;
+}
+
+int32_t apx_fileMap_length(const apx_fileMap_t *self)
+{
+   if (self != 0)
+   {
+      return adt_ary_length(&self->fileList);
+   }
+   return -1;
+}
+
+/**
+ * returns the file at index, files are sorted by address
+ */
+apx_file_t *apx_fileMap_get(const apx_fileMap_t *self, int32_t index)
+{
+   if ( (self != 0) && (index >= 0) && (index < adt_ary_length(&self->fileList)) )
+   {
+      return (apx_file_t*) adt_ary_value(&self->fileList, index);
    }
-   return retval;
+   return (apx_file_t*) 0;
 }
 
 
@@ -236,71 +239,107 @@ static int8_t apx_fileMap_autoInsertFile(apx_fileMap_t *self, apx_file_t *pFile,
 {
    if ( (self != 0) && (pFile != 0) )
    {
-      adt_list_elem_t *pIter = adt_list_first(&self->fileList);
-      if (pIter == 0)
-      {
-         pFile->fileInfo.address = start_address;
-      }
-      else
+      uint32_t placement_address = start_address;
+      //index of the first file in the next area
+      int32_t index = apx_fileMap_upperBound(self, end_address-1);
+      if (index > 0)
       {
-         adt_list_elem_t *pIter=0;
-         adt_list_elem_t *pFound=0;
-         uint32_t placement_address = start_address;
-         adt_list_iter_init(&self->fileList);
-         do
+         apx_file_t *pOther = (apx_file_t*) adt_ary_value(&self->fileList, index-1);
+         assert(pOther != 0);
+         if (pOther->fileInfo.address >= start_address)
          {
-            pIter = adt_list_iter_next(&self->fileList);
-            if (pIter != 0)
+            //pOther is the last file in the range
+            uint32_t other_end_address;
+            uint32_t other_start_address;
+            other_start_address=pOther->fileInfo.address;
+            other_end_address=other_start_address + pOther->fileInfo.length;
+            //check if address_boundary is a power of two. If not, we need to use another slower method to calculate new placement_address
+            assert(address_boundary != 0);
+            if ((address_boundary & (address_boundary-1)) == 0)
             {
-               apx_file_t *pOther;
-               pOther = (apx_file_t*) pIter->pItem;
-               assert(pOther != 0);
-
-               if( pOther->fileInfo.address >= end_address)
-               {
-                  break; //we have passed into the next area, break and use latest seen value of pFound
-               }
-               else if(pOther->fileInfo.address >= start_address)
-               {
-                  pFound = pIter; //update pFound
-               }
-               else
-               {
-                  //MISRA
-               }
+               //address_boundary is a power of 2, use faster method
+               placement_address  = (other_end_address + (address_boundary-1)) & (~(address_boundary-1)); //note that address_boundary must be a power of 2 for this code to work
+            }
+            else
+            {
+               //use slower method
+               assert(0); ///TODO: implement this
             }
-         } while(pIter != 0);
-         if (pFound != 0)
-         {
-           uint32_t other_end_address;
-           uint32_t other_start_address;
-           apx_file_t *pOther = (apx_file_t*) pFound->pItem;
-           assert(pOther != 0);
-           other_start_address=pOther->fileInfo.address;
-           other_end_address=other_start_address + pOther->fileInfo.length;
-           //check if address_boundary is a power of two. If not, we need to use another slower method to calculate new placement_address
-           assert(address_boundary != 0);
-           if ((address_boundary & (address_boundary-1)) == 0)
-           {
-              //address_boundary is a power of 2, use faster method
-              placement_address  = (other_end_address + (address_boundary-1)) & (~(address_boundary-1)); //note that address_boundary must be a power of 2 for this code to work
-           }
-           else
-           {
-              //use slower method
-              assert(0); ///TODO: implement this
-           }
 
-           if (placement_address >= end_address)
-           {
-              //memory map full, cannot fit any more files into this region
-              errno = ENOMEM;
-              return -1;
-           }
+            if (placement_address >= end_address)
+            {
+               //memory map full, cannot fit any more files into this region
+               errno = ENOMEM;
+               return -1;
+            }
          }
-         pFile->fileInfo.address = placement_address;
       }
+      pFile->fileInfo.address = placement_address;
       return apx_fileMap_insertFile(self, pFile);
    }
    return -1;
 }
+
+/**
+ * returns the index of the first file with a start address greater than address, the length of fileList when there is none
+ */
+static int32_t apx_fileMap_upperBound(const apx_fileMap_t *self, uint32_t address)
+{
+   int32_t low = 0;
+   int32_t high = adt_ary_length(&self->fileList);
+   while (low < high)
+   {
+      int32_t mid = low + (high-low)/2;
+      apx_file_t *pFile = (apx_file_t*) adt_ary_value(&self->fileList, mid);
+      if (pFile->fileInfo.address > address)
+      {
+         high = mid;
+      }
+      else
+      {
+         low = mid+1;
+      }
+   }
+   return low;
+}
+
+static int32_t apx_fileMap_indexOf(const apx_fileMap_t *self, const apx_file_t *pFile)
+{
+   int32_t index = apx_fileMap_upperBound(self, pFile->fileInfo.address)-1;
+   if ( (index >= 0) && (adt_ary_value(&self->fileList, index) == pFile) )
+   {
+      return index;
+   }
+   else
+   {
+      //the address of the file was changed after it was inserted
+      int32_t i;
+      int32_t len = adt_ary_length(&self->fileList);
+      for (i=0; i<len; i++)
+      {
+         if (adt_ary_value(&self->fileList, i) == pFile)
+         {
+            return i;
+         }
+      }
+   }
+   return -1;
+}
+
+/**
+ * name lost its file, lets it refer to the remaining file with the lowest address using the same name (if any)
+ */
+static void apx_fileMap_restoreFileName(apx_fileMap_t *self, const char *name)
+{
+   int32_t i;
+   int32_t len = adt_ary_length(&self->fileList);
+   for (i=0; i<len; i++)
+   {
+      apx_file_t *pFile = (apx_file_t*) adt_ary_value(&self->fileList, i);
+      if (strcmp(pFile->fileInfo.name, name) == 0)
+      {
+         adt_hash_set(&self->fileNameMap, name, 0, pFile);
+         break;
+      }
+   }
+}
@@ -0,0 +1,370 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <errno.h>
+#include <string.h>
+#include <assert.h>
+#ifndef _WIN32
+#include <time.h>
+#endif
+#include "apx_frameAccumulator.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#ifdef _MSC_VER
+#define APX_FRAME_ACCUMULATOR_TRY_LOCK(x) (WaitForSingleObject((x), 0) == WAIT_OBJECT_0)
+#else
+#define APX_FRAME_ACCUMULATOR_TRY_LOCK(x) (pthread_mutex_trylock(&(x)) == 0)
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static int32_t apx_frameAccumulator_transmit(apx_frameAccumulator_t *self, const apx_frameBuffer_t *buffers, int32_t numBuffers);
+static int32_t apx_frameAccumulator_flushInternal(apx_frameAccumulator_t *self);
+static int32_t apx_frameAccumulator_appendInternal(apx_frameAccumulator_t *self, const uint8_t *header, uint32_t headerLen, const uint8_t *payload, uint32_t payloadLen);
+static void apx_frameAccumulator_addPending(apx_frameAccumulator_t *self, const uint8_t *header, uint32_t headerLen, const uint8_t *payload, uint32_t payloadLen);
+static uint32_t apx_frameAccumulator_getTimeMs(void);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+void apx_frameAccumulator_create(apx_frameAccumulator_t *self, uint32_t maxPendingLen, uint32_t maxDelayMs, apx_frameAccumulator_transmit_fn *transmitFunc, void *transmitArg)
+{
+   if (self != 0)
+   {
+      MUTEX_INIT(self->mutex);
+      adt_bytearray_create(&self->pending, 0);
+      if (maxPendingLen > 0)
+      {
+         //pending never grows beyond maxPendingLen, allocate it once
+         if (adt_bytearray_resize(&self->pending, maxPendingLen) != 0)
+         {
+            maxPendingLen = 0; //fall back to transmitting each frame directly
+         }
+      }
+      self->pendingLen = 0;
+      self->maxPendingLen = maxPendingLen;
+      self->maxDelayMs = maxDelayMs;
+      self->firstFrameTime = 0;
+      memset(&self->stats, 0, sizeof(self->stats));
+      self->transmitFunc = transmitFunc;
+      self->transmitArg = transmitArg;
+      self->deadlineFunc = (apx_frameAccumulator_deadline_fn*) 0;
+      self->deadlineArg = (void*) 0;
+   }
+}
+
+void apx_frameAccumulator_destroy(apx_frameAccumulator_t *self)
+{
+   if (self != 0)
+   {
+      adt_bytearray_destroy(&self->pending);
+      MUTEX_DESTROY(self->mutex);
+   }
+}
+
+/**
+ * adds a complete frame (message header included) to the pending data.
+ * The pending data is transmitted when the byte or time threshold is reached.
+ * returns 0 on success, -1 when the frame could not be accepted (pending data that failed to transmit is kept)
+ */
+int32_t apx_frameAccumulator_append(apx_frameAccumulator_t *self, const uint8_t *frame, uint32_t frameLen)
+{
+   if ( (self != 0) && (frame != 0) )
+   {
+      return apx_frameAccumulator_appendInternal(self, frame, frameLen, 0, 0);
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * same as apx_frameAccumulator_append but the frame is given in two parts, a header and a payload.
+ * The payload is copied directly from the caller's buffer, it does not have to be placed after the header in memory.
+ * returns 0 on success, -1 on error
+ */
+int32_t apx_frameAccumulator_appendGather(apx_frameAccumulator_t *self, const uint8_t *header, uint32_t headerLen, const uint8_t *payload, uint32_t payloadLen)
+{
+   if ( (self != 0) && (header != 0) && ( (payload != 0) || (payloadLen == 0) ) )
+   {
+      return apx_frameAccumulator_appendInternal(self, header, headerLen, payload, payloadLen);
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * same as apx_frameAccumulator_appendGather but it never blocks, it neither waits for the mutex nor transmits.
+ * returns 0 when the frame has been added to the pending data. Returns -1 with errno set to EAGAIN when the mutex is held by another
+ * thread or when the frame can't be added without transmitting first, the frame is then not added.
+ */
+int32_t apx_frameAccumulator_tryAppendGather(apx_frameAccumulator_t *self, const uint8_t *header, uint32_t headerLen, const uint8_t *payload, uint32_t payloadLen)
+{
+   if ( (self != 0) && (header != 0) && ( (payload != 0) || (payloadLen == 0) ) )
+   {
+      int32_t retval = -1;
+      uint32_t frameLen = headerLen + payloadLen;
+      //the mutex is held while transmitting, to a slow receiver this can take a long time
+      if (APX_FRAME_ACCUMULATOR_TRY_LOCK(self->mutex) == false)
+      {
+         errno = EAGAIN;
+         return -1;
+      }
+      if ( (self->maxPendingLen > 0) && (frameLen < self->maxPendingLen) && ( (self->pendingLen + frameLen) <= self->maxPendingLen) &&
+           ( (self->pendingLen == 0) || (self->maxDelayMs == 0) || ( (apx_frameAccumulator_getTimeMs() - self->firstFrameTime) < self->maxDelayMs ) ) )
+      {
+         self->stats.numFrames++;
+         apx_frameAccumulator_addPending(self, header, headerLen, payload, payloadLen);
+         retval = 0;
+      }
+      else
+      {
+         errno = EAGAIN;
+      }
+      MUTEX_UNLOCK(self->mutex);
+      return retval;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * transmits all pending frames. Called by the sender when it has nothing more to send at the moment.
+ * returns 0 on success, -1 on error (the pending frames are kept)
+ */
+int32_t apx_frameAccumulator_flush(apx_frameAccumulator_t *self)
+{
+   if (self != 0)
+   {
+      int32_t retval = 0;
+      MUTEX_LOCK(self->mutex);
+      if (self->pendingLen > 0)
+      {
+         self->stats.numDrainFlushes++;
+         retval = apx_frameAccumulator_flushInternal(self);
+      }
+      MUTEX_UNLOCK(self->mutex);
+      return retval;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * Registers a function that is told when the time threshold of the pending data expires. Must be called before any frames are appended.
+ */
+void apx_frameAccumulator_setDeadlineHandler(apx_frameAccumulator_t *self, apx_frameAccumulator_deadline_fn *deadlineFunc, void *deadlineArg)
+{
+   if (self != 0)
+   {
+      MUTEX_LOCK(self->mutex);
+      self->deadlineFunc = deadlineFunc;
+      self->deadlineArg = deadlineArg;
+      MUTEX_UNLOCK(self->mutex);
+   }
+}
+
+/**
+ * transmits the pending frames if the oldest of them has waited for the time threshold.
+ * Called by the owner of the deadline timer, the deadline handler is called again when the pending data is not yet due.
+ * returns 0 on success, -1 on error (the pending frames are kept)
+ */
+int32_t apx_frameAccumulator_flushExpired(apx_frameAccumulator_t *self)
+{
+   if (self != 0)
+   {
+      int32_t retval = 0;
+      MUTEX_LOCK(self->mutex);
+      if ( (self->pendingLen > 0) && (self->maxDelayMs > 0) )
+      {
+         uint32_t elapsed = apx_frameAccumulator_getTimeMs() - self->firstFrameTime;
+         if (elapsed >= self->maxDelayMs)
+         {
+            self->stats.numTimeFlushes++;
+            retval = apx_frameAccumulator_flushInternal(self);
+         }
+         else if (self->deadlineFunc != 0)
+         {
+            self->deadlineFunc(self->deadlineArg, self->maxDelayMs - elapsed);
+         }
+         else
+         {
+            //MISRA
+         }
+      }
+      MUTEX_UNLOCK(self->mutex);
+      return retval;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+uint32_t apx_frameAccumulator_getPendingLen(apx_frameAccumulator_t *self)
+{
+   uint32_t retval = 0;
+   if (self != 0)
+   {
+      MUTEX_LOCK(self->mutex);
+      retval = self->pendingLen;
+      MUTEX_UNLOCK(self->mutex);
+   }
+   return retval;
+}
+
+void apx_frameAccumulator_getStats(apx_frameAccumulator_t *self, apx_frameAccumulatorStats_t *stats)
+{
+   if ( (self != 0) && (stats != 0) )
+   {
+      MUTEX_LOCK(self->mutex);
+      memcpy(stats, &self->stats, sizeof(apx_frameAccumulatorStats_t));
+      MUTEX_UNLOCK(self->mutex);
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+static int32_t apx_frameAccumulator_transmit(apx_frameAccumulator_t *self, const apx_frameBuffer_t *buffers, int32_t numBuffers)
+{
+   int32_t i;
+   uint32_t totalLen = 0;
+   for (i = 0; i < numBuffers; i++)
+   {
+      totalLen += buffers[i].dataLen;
+   }
+   self->stats.numFlushes++;
+   if (totalLen > self->stats.maxFlushLen)
+   {
+      self->stats.maxFlushLen = totalLen;
+   }
+   if (self->transmitFunc != 0)
+   {
+      return self->transmitFunc(self->transmitArg, buffers, numBuffers);
+   }
+   return 0;
+}
+
+/**
+ * must be called while holding self->mutex. The pending data is only discarded once it has been transmitted.
+ */
+static int32_t apx_frameAccumulator_flushInternal(apx_frameAccumulator_t *self)
+{
+   int32_t retval = 0;
+   if (self->pendingLen > 0)
+   {
+      apx_frameBuffer_t buffer;
+      buffer.data = adt_bytearray_data(&self->pending);
+      buffer.dataLen = self->pendingLen;
+      retval = apx_frameAccumulator_transmit(self, &buffer, 1);
+      if (retval == 0)
+      {
+         self->pendingLen = 0;
+      }
+   }
+   return retval;
+}
+
+static int32_t apx_frameAccumulator_appendInternal(apx_frameAccumulator_t *self, const uint8_t *header, uint32_t headerLen, const uint8_t *payload, uint32_t payloadLen)
+{
+   int32_t retval = 0;
+   uint32_t frameLen = headerLen + payloadLen;
+   MUTEX_LOCK(self->mutex);
+   self->stats.numFrames++;
+   if ( (self->maxPendingLen == 0) || (frameLen >= self->maxPendingLen) )
+   {
+      //coalescing is disabled or the frame is too large to be worth copying, pending data and frame are written together
+      apx_frameBuffer_t buffers[APX_FRAME_ACCUMULATOR_MAX_BUFFERS];
+      int32_t numBuffers = 0;
+      if (self->pendingLen > 0)
+      {
+         buffers[numBuffers].data = adt_bytearray_data(&self->pending);
+         buffers[numBuffers++].dataLen = self->pendingLen;
+      }
+      buffers[numBuffers].data = header;
+      buffers[numBuffers++].dataLen = headerLen;
+      if (payloadLen > 0)
+      {
+         buffers[numBuffers].data = payload;
+         buffers[numBuffers++].dataLen = payloadLen;
+      }
+      retval = apx_frameAccumulator_transmit(self, &buffers[0], numBuffers);
+      if (retval == 0)
+      {
+         self->pendingLen = 0;
+      }
+   }
+   else
+   {
+      if ( (self->pendingLen + frameLen) > self->maxPendingLen )
+      {
+         self->stats.numSizeFlushes++;
+         retval = apx_frameAccumulator_flushInternal(self);
+      }
+      else if ( (self->pendingLen > 0) && (self->maxDelayMs > 0) && ( (apx_frameAccumulator_getTimeMs() - self->firstFrameTime) >= self->maxDelayMs ) )
+      {
+         //the deadline passed before anyone called apx_frameAccumulator_flushExpired
+         self->stats.numTimeFlushes++;
+         retval = apx_frameAccumulator_flushInternal(self);
+      }
+      else
+      {
+         //MISRA
+      }
+      if (retval == 0)
+      {
+         apx_frameAccumulator_addPending(self, header, headerLen, payload, payloadLen);
+      }
+   }
+   MUTEX_UNLOCK(self->mutex);
+   return retval;
+}
+
+/**
+ * must be called while holding self->mutex, the caller makes sure the frame fits in the pending data
+ */
+static void apx_frameAccumulator_addPending(apx_frameAccumulator_t *self, const uint8_t *header, uint32_t headerLen, const uint8_t *payload, uint32_t payloadLen)
+{
+   uint8_t *data = adt_bytearray_data(&self->pending);
+   bool isFirstFrame = (self->pendingLen == 0);
+   if (isFirstFrame == true)
+   {
+      self->firstFrameTime = apx_frameAccumulator_getTimeMs();
+   }
+   memcpy(&data[self->pendingLen], header, headerLen);
+   self->pendingLen += headerLen;
+   if (payloadLen > 0)
+   {
+      memcpy(&data[self->pendingLen], payload, payloadLen);
+      self->pendingLen += payloadLen;
+   }
+   if ( (isFirstFrame == true) && (self->maxDelayMs > 0) && (self->deadlineFunc != 0) )
+   {
+      self->deadlineFunc(self->deadlineArg, self->maxDelayMs);
+   }
+}
+
+static uint32_t apx_frameAccumulator_getTimeMs(void)
+{
+#ifdef _WIN32
+   return (uint32_t) GetTickCount();
+#else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint32_t) ( (ts.tv_sec * 1000u) + (ts.tv_nsec / 1000000u) );
+#endif
+}
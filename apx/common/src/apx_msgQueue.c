@@ -0,0 +1,691 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "apx_msgQueue.h"
+#include "apx_atomic.h"
+#if APX_MSG_QUEUE_USE_FUTEX
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#ifdef _WIN32
+#undef SEMAPHORE_MAX_COUNT
+#define SEMAPHORE_MAX_COUNT 0x7FFFFFFF //the semaphore is posted at most once per empty to non-empty transition
+#endif
+
+#define APX_MSG_QUEUE_MIN_CAPACITY 2u
+
+//results of apx_msgQueue_postInternal
+#define APX_MSG_QUEUE_POST_OK       0
+#define APX_MSG_QUEUE_POST_REFUSED  1
+#define APX_MSG_QUEUE_POST_WAIT     2
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static void apx_msgQueue_signal(apx_msgQueue_t *self);
+static void apx_msgQueue_waitForRoom(apx_msgQueue_t *self, int32_t roomSequence, uint32_t timeoutMs);
+static void apx_msgQueue_signalRoom(apx_msgQueue_t *self);
+static uint32_t apx_msgQueue_getTimeMs(void);
+static int32_t apx_msgQueue_postInternal(apx_msgQueue_t *self, const apx_msg_t *msg);
+static int32_t apx_msgQueue_postOverflow(apx_msgQueue_t *self, const apx_msg_t *msg, int32_t *pendingAdjust);
+static bool apx_msgQueue_publish(apx_msgQueue_t *self, const apx_msg_t *msg);
+static bool apx_msgQueue_removeRing(apx_msgQueue_t *self, apx_msg_t *msg);
+static void apx_msgQueue_updateHighWaterMark(apx_msgQueue_t *self, int32_t numPending);
+static uint32_t apx_msgQueue_getMsgSize(apx_msgQueue_t *self, const apx_msg_t *msg);
+static bool apx_msgQueue_isDroppable(apx_msgQueue_t *self, const apx_msg_t *msg);
+static void apx_msgQueue_release(apx_msgQueue_t *self, const apx_msg_t *msg);
+static int8_t apx_msgQueue_appendOverflow(apx_msgQueue_t *self, const apx_msg_t *msg);
+static void apx_msgQueue_eraseOverflow(apx_msgQueue_t *self, uint32_t i);
+static void apx_msgQueue_updateOverflowBytes(apx_msgQueue_t *self, int32_t delta);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+ * creates a queue that can hold at least minNumMessages messages (capacity is rounded up to a power of two)
+ */
+int8_t apx_msgQueue_create(apx_msgQueue_t *self, uint32_t minNumMessages)
+{
+   if ( (self != 0) && (minNumMessages <= 0x80000000u) )
+   {
+      uint32_t i;
+      uint32_t capacity = APX_MSG_QUEUE_MIN_CAPACITY;
+      while (capacity < minNumMessages)
+      {
+         capacity <<= 1;
+      }
+      memset(self, 0, sizeof(apx_msgQueue_t));
+      self->cells = (apx_msgQueueCell_t*) malloc(sizeof(apx_msgQueueCell_t) * capacity);
+      if (self->cells == 0)
+      {
+         errno = ENOMEM;
+         return -1;
+      }
+      for (i=0;i<capacity;i++)
+      {
+         self->cells[i].sequence = i;
+      }
+      self->mask = capacity-1;
+      self->policy = APX_MSG_QUEUE_POLICY_DROP_OLDEST;
+#if (APX_MSG_QUEUE_USE_FUTEX == 0)
+      SEMAPHORE_CREATE(self->semaphore);
+      SEMAPHORE_CREATE(self->roomSemaphore);
+#endif
+      MUTEX_INIT(self->overflowLock);
+      return 0;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+void apx_msgQueue_destroy(apx_msgQueue_t *self)
+{
+   if ( (self != 0) && (self->cells != 0) )
+   {
+#if (APX_MSG_QUEUE_USE_FUTEX == 0)
+      SEMAPHORE_DESTROY(self->semaphore);
+      SEMAPHORE_DESTROY(self->roomSemaphore);
+#endif
+      MUTEX_DESTROY(self->overflowLock);
+      if (self->overflowMsgs != 0)
+      {
+         free(self->overflowMsgs);
+         self->overflowMsgs = 0;
+      }
+      free(self->cells);
+      self->cells = 0;
+   }
+}
+
+/**
+ * Makes the queue call wakeupFunc instead of waking up a thread blocked in apx_msgQueue_wait.
+ * Must be called before any messages are posted.
+ */
+void apx_msgQueue_setWakeup(apx_msgQueue_t *self, apx_msgQueue_wakeup_fn *wakeupFunc, void *wakeupArg)
+{
+   if (self != 0)
+   {
+      self->wakeupArg = wakeupArg;
+      self->wakeupFunc = wakeupFunc;
+   }
+}
+
+uint32_t apx_msgQueue_getCapacity(const apx_msgQueue_t *self)
+{
+   if (self != 0)
+   {
+      return self->mask+1;
+   }
+   return 0;
+}
+
+/**
+ * Sets what happens when the overflow storage reaches maxBytes (0 means no limit).
+ * Messages discarded by the queue itself are given to handler->release.
+ * Must be called before any messages are posted.
+ */
+void apx_msgQueue_setOverflowPolicy(apx_msgQueue_t *self, uint8_t policy, uint32_t maxBytes, const apx_msgQueueHandler_t *handler)
+{
+   if (self != 0)
+   {
+      MUTEX_LOCK(self->overflowLock);
+      self->policy = policy;
+      self->maxBytes = maxBytes;
+      if (handler != 0)
+      {
+         memcpy(&self->handler, handler, sizeof(apx_msgQueueHandler_t));
+      }
+      else
+      {
+         memset(&self->handler, 0, sizeof(apx_msgQueueHandler_t));
+      }
+      MUTEX_UNLOCK(self->overflowLock);
+   }
+}
+
+void apx_msgQueue_getStats(apx_msgQueue_t *self, apx_msgQueueStats_t *stats)
+{
+   if ( (self != 0) && (stats != 0) )
+   {
+      MUTEX_LOCK(self->overflowLock);
+      memcpy(stats, &self->stats, sizeof(apx_msgQueueStats_t));
+      MUTEX_UNLOCK(self->overflowLock);
+      stats->highWaterMark = (uint32_t) APX_ATOMIC_LOAD_ACQUIRE(self->highWaterMark);
+   }
+}
+
+/**
+ * adds a copy of msg to the queue. Safe to call from any number of threads concurrently.
+ * Under APX_MSG_QUEUE_POLICY_BACKPRESSURE the caller sleeps until the consumer reports consumed messages,
+ * for at most APX_MSG_QUEUE_BACKPRESSURE_TIMEOUT_MS.
+ * returns 0 on success, -1 if the message was refused by the overflow policy (errno is set to ENOSPC).
+ * A refused message is still owned by the caller.
+ */
+int8_t apx_msgQueue_post(apx_msgQueue_t *self, const apx_msg_t *msg)
+{
+   if ( (self != 0) && (msg != 0) )
+   {
+      int8_t retval = 0;
+      bool isWaiting = false;
+      uint32_t startTime = 0;
+      for(;;)
+      {
+         //read before the attempt, a consumer making room after the attempt changes it and the wait returns immediately
+         int32_t roomSequence = APX_ATOMIC_LOAD_ACQUIRE(self->roomSequence);
+         int32_t result = apx_msgQueue_postInternal(self, msg);
+         if (result == APX_MSG_QUEUE_POST_OK)
+         {
+            break;
+         }
+         else if (result == APX_MSG_QUEUE_POST_WAIT)
+         {
+            if (isWaiting == false)
+            {
+               //register before trying again so the consumer can't make room unnoticed
+               isWaiting = true;
+               startTime = apx_msgQueue_getTimeMs();
+               (void) APX_ATOMIC_INCREMENT(self->numRoomWaiters);
+               (void) APX_ATOMIC_INCREMENT(self->stats.numBackpressureWaits);
+            }
+            else
+            {
+               uint32_t elapsed = apx_msgQueue_getTimeMs() - startTime;
+               if (elapsed >= APX_MSG_QUEUE_BACKPRESSURE_TIMEOUT_MS)
+               {
+                  retval = -1;
+                  break;
+               }
+               apx_msgQueue_waitForRoom(self, roomSequence, APX_MSG_QUEUE_BACKPRESSURE_TIMEOUT_MS - elapsed);
+            }
+         }
+         else
+         {
+            retval = -1;
+            break;
+         }
+      }
+      if (isWaiting == true)
+      {
+         (void) APX_ATOMIC_DECREMENT(self->numRoomWaiters);
+      }
+      if (retval != 0)
+      {
+         MUTEX_LOCK(self->overflowLock);
+         self->stats.numDropped++;
+         MUTEX_UNLOCK(self->overflowLock);
+         errno = ENOSPC;
+      }
+      return retval;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * blocks the consumer until there is at least one pending message. Returns immediately if messages are already pending.
+ */
+void apx_msgQueue_wait(apx_msgQueue_t *self)
+{
+   if (self != 0)
+   {
+      while (APX_ATOMIC_LOAD_ACQUIRE(self->numPending) == 0)
+      {
+#if APX_MSG_QUEUE_USE_FUTEX
+         //returns immediately if numPending is no longer 0
+         (void) syscall(SYS_futex, &self->numPending, FUTEX_WAIT_PRIVATE, 0, (void*) 0, (void*) 0, 0);
+#elif defined(_MSC_VER)
+         (void) WaitForSingleObject(self->semaphore, INFINITE);
+#else
+         (void) sem_wait(&self->semaphore);
+#endif
+      }
+   }
+}
+
+/**
+ * removes the oldest message from the queue. Must only be called by the consumer.
+ * Each removed message must later be reported using apx_msgQueue_consumed.
+ * returns false when there are no (fully published) messages left
+ */
+bool apx_msgQueue_remove(apx_msgQueue_t *self, apx_msg_t *msg)
+{
+   bool retval = false;
+   if ( (self != 0) && (msg != 0) )
+   {
+      retval = apx_msgQueue_removeRing(self, msg);
+      if ( (retval == false) && (APX_ATOMIC_LOAD_ACQUIRE(self->overflowActive) != 0) )
+      {
+         MUTEX_LOCK(self->overflowLock);
+         //messages in the ring are older than the ones in the overflow storage
+         retval = apx_msgQueue_removeRing(self, msg);
+         if ( (retval == false) && (self->overflowLen > 0) )
+         {
+            memcpy(msg, &self->overflowMsgs[self->overflowHead], sizeof(apx_msg_t));
+            self->overflowHead = (self->overflowHead + 1) % self->overflowCapacity;
+            self->overflowLen--;
+            apx_msgQueue_updateOverflowBytes(self, -((int32_t) apx_msgQueue_getMsgSize(self, msg)));
+            retval = true;
+         }
+         if (self->overflowLen == 0)
+         {
+            self->overflowHead = 0;
+            APX_ATOMIC_STORE_RELEASE(self->overflowActive, 0);
+            if (self->overflowCapacity > APX_MSG_QUEUE_GROW_LEN)
+            {
+               //the burst is over, give back the memory
+               free(self->overflowMsgs);
+               self->overflowMsgs = 0;
+               self->overflowCapacity = 0;
+            }
+         }
+         MUTEX_UNLOCK(self->overflowLock);
+      }
+   }
+   return retval;
+}
+
+/**
+ * returns number of messages posted but not yet consumed. A message stays pending while the consumer is processing it.
+ */
+int32_t apx_msgQueue_getNumPending(apx_msgQueue_t *self)
+{
+   if (self != 0)
+   {
+      return APX_ATOMIC_LOAD_ACQUIRE(self->numPending);
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * Called by the consumer after it has processed a batch of removed messages.
+ * returns number of messages still pending. When this is greater than 0 the consumer must keep draining,
+ * producers will not signal again until the queue has been seen empty.
+ */
+int32_t apx_msgQueue_consumed(apx_msgQueue_t *self, int32_t numMessages)
+{
+   if (self != 0)
+   {
+      int32_t retval = APX_ATOMIC_FETCH_ADD(self->numPending, -numMessages) - numMessages;
+      if ( (numMessages > 0) && (APX_ATOMIC_LOAD_ACQUIRE(self->numRoomWaiters) > 0) )
+      {
+         apx_msgQueue_signalRoom(self);
+      }
+      return retval;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+static void apx_msgQueue_signal(apx_msgQueue_t *self)
+{
+   if (self->wakeupFunc != 0)
+   {
+      self->wakeupFunc(self->wakeupArg);
+   }
+   else
+   {
+#if APX_MSG_QUEUE_USE_FUTEX
+      (void) syscall(SYS_futex, &self->numPending, FUTEX_WAKE_PRIVATE, 1, (void*) 0, (void*) 0, 0);
+#else
+      SEMAPHORE_POST(self->semaphore);
+#endif
+   }
+}
+
+/**
+ * sleeps until roomSequence no longer has the given value or timeoutMs has passed
+ */
+static void apx_msgQueue_waitForRoom(apx_msgQueue_t *self, int32_t roomSequence, uint32_t timeoutMs)
+{
+#if APX_MSG_QUEUE_USE_FUTEX
+   struct timespec timeout;
+   timeout.tv_sec = (time_t) (timeoutMs / 1000u);
+   timeout.tv_nsec = (long) ((timeoutMs % 1000u) * 1000000u);
+   //returns immediately if roomSequence has already changed
+   (void) syscall(SYS_futex, &self->roomSequence, FUTEX_WAIT_PRIVATE, roomSequence, &timeout, (void*) 0, 0);
+#elif defined(_MSC_VER)
+   (void) roomSequence;
+   (void) WaitForSingleObject(self->roomSemaphore, (DWORD) timeoutMs);
+#else
+   struct timespec deadline;
+   (void) roomSequence;
+   clock_gettime(CLOCK_REALTIME, &deadline);
+   deadline.tv_sec += (time_t) (timeoutMs / 1000u);
+   deadline.tv_nsec += (long) ((timeoutMs % 1000u) * 1000000u);
+   if (deadline.tv_nsec >= 1000000000L)
+   {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+   }
+   (void) sem_timedwait(&self->roomSemaphore, &deadline);
+#endif
+}
+
+/**
+ * wakes up the producers sleeping in apx_msgQueue_waitForRoom, they try again and go back to sleep if there is still no room
+ */
+static void apx_msgQueue_signalRoom(apx_msgQueue_t *self)
+{
+   (void) APX_ATOMIC_INCREMENT(self->roomSequence);
+#if APX_MSG_QUEUE_USE_FUTEX
+   (void) syscall(SYS_futex, &self->roomSequence, FUTEX_WAKE_PRIVATE, INT32_MAX, (void*) 0, (void*) 0, 0);
+#else
+   {
+      int32_t i;
+      int32_t numWaiters = APX_ATOMIC_LOAD_ACQUIRE(self->numRoomWaiters);
+      for (i=0; i<numWaiters; i++)
+      {
+         SEMAPHORE_POST(self->roomSemaphore);
+      }
+   }
+#endif
+}
+
+static uint32_t apx_msgQueue_getTimeMs(void)
+{
+#ifdef _WIN32
+   return (uint32_t) GetTickCount();
+#else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint32_t) ( (ts.tv_sec * 1000u) + (ts.tv_nsec / 1000000u) );
+#endif
+}
+
+static int32_t apx_msgQueue_postInternal(apx_msgQueue_t *self, const apx_msg_t *msg)
+{
+   int32_t result = APX_MSG_QUEUE_POST_OK;
+   int32_t pendingAdjust = 0;
+   //numPending is increased before the message is published, this way it never goes below the number of messages in the queue
+   int32_t prevPending = APX_ATOMIC_FETCH_ADD(self->numPending, 1);
+   apx_msgQueue_updateHighWaterMark(self, prevPending+1);
+   if ( (APX_ATOMIC_LOAD_ACQUIRE(self->overflowActive) != 0) || (apx_msgQueue_publish(self, msg) == false) )
+   {
+      MUTEX_LOCK(self->overflowLock);
+      result = apx_msgQueue_postOverflow(self, msg, &pendingAdjust);
+      MUTEX_UNLOCK(self->overflowLock);
+      if (result != APX_MSG_QUEUE_POST_OK)
+      {
+         pendingAdjust--;
+      }
+      if (pendingAdjust != 0)
+      {
+         (void) APX_ATOMIC_FETCH_ADD(self->numPending, pendingAdjust);
+      }
+   }
+   if (prevPending == 0)
+   {
+      //also done for refused messages, another producer may have published while we held the empty to non-empty transition
+      apx_msgQueue_signal(self);
+   }
+   return result;
+}
+
+/**
+ * must be called while holding self->overflowLock.
+ * pendingAdjust is decreased for each message that leaves the queue without reaching the consumer
+ */
+static int32_t apx_msgQueue_postOverflow(apx_msgQueue_t *self, const apx_msg_t *msg, int32_t *pendingAdjust)
+{
+   uint32_t msgSize;
+   if ( (self->overflowLen == 0) && (apx_msgQueue_publish(self, msg) == true) )
+   {
+      //the consumer made room in the ring while we waited for the lock
+      return APX_MSG_QUEUE_POST_OK;
+   }
+   msgSize = apx_msgQueue_getMsgSize(self, msg);
+   if ( (self->maxBytes != 0) && ( (self->stats.overflowBytes + msgSize) > self->maxBytes) && (apx_msgQueue_isDroppable(self, msg) == true) )
+   {
+      uint32_t i;
+      if ( (self->policy == APX_MSG_QUEUE_POLICY_CONFLATE) && (self->handler.isConflatable != 0) )
+      {
+         //search from newest to oldest, the newest matching message is the one most likely to be replaced again
+         for (i=self->overflowLen; i>0; i--)
+         {
+            apx_msg_t *queuedMsg = &self->overflowMsgs[(self->overflowHead + i - 1) % self->overflowCapacity];
+            if (self->handler.isConflatable(self->handler.arg, queuedMsg, msg) == true)
+            {
+               apx_msg_t oldMsg;
+               memcpy(&oldMsg, queuedMsg, sizeof(apx_msg_t));
+               memcpy(queuedMsg, msg, sizeof(apx_msg_t));
+               apx_msgQueue_updateOverflowBytes(self, (int32_t) msgSize - (int32_t) apx_msgQueue_getMsgSize(self, &oldMsg));
+               apx_msgQueue_release(self, &oldMsg);
+               self->stats.numConflated++;
+               (*pendingAdjust)--;
+               return APX_MSG_QUEUE_POST_OK;
+            }
+         }
+      }
+      if (self->policy == APX_MSG_QUEUE_POLICY_BACKPRESSURE)
+      {
+         return APX_MSG_QUEUE_POST_WAIT;
+      }
+      //find out how many of the oldest droppable messages must go, drop none of them if that still leaves no room
+      {
+         uint32_t numToDrop = 0;
+         uint32_t freedBytes = 0;
+         for (i=0; (i<self->overflowLen) && ( (self->stats.overflowBytes - freedBytes + msgSize) > self->maxBytes ); i++)
+         {
+            const apx_msg_t *queuedMsg = &self->overflowMsgs[(self->overflowHead + i) % self->overflowCapacity];
+            if (apx_msgQueue_isDroppable(self, queuedMsg) == true)
+            {
+               freedBytes += apx_msgQueue_getMsgSize(self, queuedMsg);
+               numToDrop++;
+            }
+         }
+         if ( (self->stats.overflowBytes - freedBytes + msgSize) > self->maxBytes)
+         {
+            return APX_MSG_QUEUE_POST_REFUSED;
+         }
+         i = 0;
+         while (numToDrop > 0)
+         {
+            uint32_t j = (self->overflowHead + i) % self->overflowCapacity;
+            if (apx_msgQueue_isDroppable(self, &self->overflowMsgs[j]) == true)
+            {
+               apx_msg_t oldMsg;
+               memcpy(&oldMsg, &self->overflowMsgs[j], sizeof(apx_msg_t));
+               apx_msgQueue_eraseOverflow(self, i); //the next message moves into position i
+               apx_msgQueue_updateOverflowBytes(self, -((int32_t) apx_msgQueue_getMsgSize(self, &oldMsg)));
+               apx_msgQueue_release(self, &oldMsg);
+               self->stats.numDropped++;
+               (*pendingAdjust)--;
+               numToDrop--;
+            }
+            else
+            {
+               i++;
+            }
+         }
+      }
+   }
+   //messages which must not be dropped (such as exit or connect) are always accepted
+   if (apx_msgQueue_appendOverflow(self, msg) != 0)
+   {
+      return APX_MSG_QUEUE_POST_REFUSED;
+   }
+   apx_msgQueue_updateOverflowBytes(self, (int32_t) msgSize);
+   return APX_MSG_QUEUE_POST_OK;
+}
+
+/**
+ * tries to place msg in the ring, returns false when the ring is full
+ */
+static bool apx_msgQueue_publish(apx_msgQueue_t *self, const apx_msg_t *msg)
+{
+   apx_msgQueueCell_t *cell;
+   uint32_t pos = APX_ATOMIC_LOAD_ACQUIRE(self->enqueuePos);
+   for(;;)
+   {
+      int32_t diff;
+      cell = &self->cells[pos & self->mask];
+      diff = (int32_t) (APX_ATOMIC_LOAD_ACQUIRE(cell->sequence) - pos);
+      if (diff == 0)
+      {
+         //cell is free, try to claim it
+         if (APX_ATOMIC_CAS(self->enqueuePos, pos, pos+1))
+         {
+            break;
+         }
+         pos = APX_ATOMIC_LOAD_ACQUIRE(self->enqueuePos);
+      }
+      else if (diff < 0)
+      {
+         //cell still holds a message from the previous lap, the ring is full
+         return false;
+      }
+      else
+      {
+         //another producer claimed the cell before us
+         pos = APX_ATOMIC_LOAD_ACQUIRE(self->enqueuePos);
+      }
+   }
+   memcpy(&cell->msg, msg, sizeof(apx_msg_t));
+   APX_ATOMIC_STORE_RELEASE(cell->sequence, pos+1);
+   return true;
+}
+
+static bool apx_msgQueue_removeRing(apx_msgQueue_t *self, apx_msg_t *msg)
+{
+   apx_msgQueueCell_t *cell = &self->cells[self->dequeuePos & self->mask];
+   int32_t diff = (int32_t) (APX_ATOMIC_LOAD_ACQUIRE(cell->sequence) - (self->dequeuePos+1));
+   if (diff == 0)
+   {
+      memcpy(msg, &cell->msg, sizeof(apx_msg_t));
+      //release the cell to producers of the next lap
+      APX_ATOMIC_STORE_RELEASE(cell->sequence, self->dequeuePos + self->mask + 1);
+      self->dequeuePos++;
+      return true;
+   }
+   return false;
+}
+
+static void apx_msgQueue_updateHighWaterMark(apx_msgQueue_t *self, int32_t numPending)
+{
+   int32_t highWaterMark = APX_ATOMIC_LOAD_ACQUIRE(self->highWaterMark);
+   while (numPending > highWaterMark)
+   {
+      if (APX_ATOMIC_CAS(self->highWaterMark, highWaterMark, numPending))
+      {
+         break;
+      }
+      highWaterMark = APX_ATOMIC_LOAD_ACQUIRE(self->highWaterMark);
+   }
+}
+
+static uint32_t apx_msgQueue_getMsgSize(apx_msgQueue_t *self, const apx_msg_t *msg)
+{
+   uint32_t msgSize = (uint32_t) sizeof(apx_msg_t);
+   if (self->handler.getSize != 0)
+   {
+      msgSize += self->handler.getSize(self->handler.arg, msg);
+   }
+   return msgSize;
+}
+
+static bool apx_msgQueue_isDroppable(apx_msgQueue_t *self, const apx_msg_t *msg)
+{
+   if (self->handler.isDroppable != 0)
+   {
+      return self->handler.isDroppable(self->handler.arg, msg);
+   }
+   return true;
+}
+
+static void apx_msgQueue_release(apx_msgQueue_t *self, const apx_msg_t *msg)
+{
+   if (self->handler.release != 0)
+   {
+      self->handler.release(self->handler.arg, msg);
+   }
+}
+
+/**
+ * adds msg last in the overflow storage, growing it by APX_MSG_QUEUE_GROW_LEN messages when needed
+ */
+static int8_t apx_msgQueue_appendOverflow(apx_msgQueue_t *self, const apx_msg_t *msg)
+{
+   if (self->overflowLen == self->overflowCapacity)
+   {
+      uint32_t i;
+      uint32_t newCapacity = self->overflowCapacity + APX_MSG_QUEUE_GROW_LEN;
+      apx_msg_t *newMsgs = (apx_msg_t*) malloc(sizeof(apx_msg_t) * newCapacity);
+      if (newMsgs == 0)
+      {
+         return -1;
+      }
+      //unwrap the old contents so that the oldest message ends up at index 0
+      for (i=0; i<self->overflowLen; i++)
+      {
+         memcpy(&newMsgs[i], &self->overflowMsgs[(self->overflowHead + i) % self->overflowCapacity], sizeof(apx_msg_t));
+      }
+      if (self->overflowMsgs != 0)
+      {
+         free(self->overflowMsgs);
+      }
+      self->overflowMsgs = newMsgs;
+      self->overflowCapacity = newCapacity;
+      self->overflowHead = 0;
+   }
+   memcpy(&self->overflowMsgs[(self->overflowHead + self->overflowLen) % self->overflowCapacity], msg, sizeof(apx_msg_t));
+   self->overflowLen++;
+   self->stats.numOverflowed++;
+   APX_ATOMIC_STORE_RELEASE(self->overflowActive, 1);
+   return 0;
+}
+
+/**
+ * removes the i:th oldest message from the overflow storage, newer messages keep their order
+ */
+static void apx_msgQueue_eraseOverflow(apx_msgQueue_t *self, uint32_t i)
+{
+   if (i == 0)
+   {
+      self->overflowHead = (self->overflowHead + 1) % self->overflowCapacity;
+   }
+   else
+   {
+      for (; i+1 < self->overflowLen; i++)
+      {
+         memcpy(&self->overflowMsgs[(self->overflowHead + i) % self->overflowCapacity],
+               &self->overflowMsgs[(self->overflowHead + i + 1) % self->overflowCapacity], sizeof(apx_msg_t));
+      }
+   }
+   self->overflowLen--;
+}
+
+static void apx_msgQueue_updateOverflowBytes(apx_msgQueue_t *self, int32_t delta)
+{
+   self->stats.overflowBytes = (uint32_t) ((int32_t) self->stats.overflowBytes + delta);
+   if (self->stats.overflowBytes > self->stats.maxOverflowBytes)
+   {
+      self->stats.maxOverflowBytes = self->stats.overflowBytes;
+   }
+}
@@ -7,6 +7,7 @@
 #include "bstr.h"
 #include "apx_node.h"
 #include "apx_nodeInfo.h"
+#include "apx_nodeTemplate.h"
 #include "apx_logging.h"
 #include "apx_error.h"
 #include "pack.h"
@@ -67,6 +68,7 @@ void apx_node_create(apx_node_t *self,const char *name){
       self->lastPortId=-1;
       self->lastPortType=-1;
       self->nodeInfo=(apx_nodeInfo_t*) 0;
+      self->nodeTemplate=(apx_nodeTemplate_t*) 0;
       self->isFinalized = false;
    }
 }
@@ -80,7 +82,66 @@ void apx_node_destroy(apx_node_t *self){
       if(self->name != 0){
          free(self->name);
       }
+      if (self->nodeTemplate != 0)
+      {
+         apx_nodeTemplate_release(self->nodeTemplate);
+      }
+   }
+}
+
+/**
+ * returns a deep copy of a finalized node without parsing any strings again.
+ * Init values of port attributes are not copied, the init data of the copy must be taken from other.
+ */
+apx_node_t *apx_node_clone(const apx_node_t *other)
+{
+   apx_node_t *self;
+   int32_t i;
+   int32_t len;
+   if ( (other == 0) || (other->isFinalized == false) )
+   {
+      errno = EINVAL;
+      return (apx_node_t*) 0;
+   }
+   self = apx_node_new(other->name);
+   if (self == 0)
+   {
+      return (apx_node_t*) 0;
+   }
+   len = adt_ary_length(&other->datatypeList);
+   for (i=0; i<len; i++)
+   {
+      const apx_datatype_t *datatype = (const apx_datatype_t*) adt_ary_value(&other->datatypeList, i);
+      if (apx_node_createDataType(self, datatype->name, datatype->dsg, datatype->attr) == 0)
+      {
+         apx_node_delete(self);
+         return (apx_node_t*) 0;
+      }
+   }
+   len = adt_ary_length(&other->requirePortList);
+   for (i=0; i<len; i++)
+   {
+      apx_port_t *port = apx_port_clone((const apx_port_t*) adt_ary_value(&other->requirePortList, i));
+      if (port == 0)
+      {
+         apx_node_delete(self);
+         return (apx_node_t*) 0;
+      }
+      adt_ary_push(&self->requirePortList, port);
+   }
+   len = adt_ary_length(&other->providePortList);
+   for (i=0; i<len; i++)
+   {
+      apx_port_t *port = apx_port_clone((const apx_port_t*) adt_ary_value(&other->providePortList, i));
+      if (port == 0)
+      {
+         apx_node_delete(self);
+         return (apx_node_t*) 0;
+      }
+      adt_ary_push(&self->providePortList, port);
    }
+   self->isFinalized = true;
+   return self;
 }
 
 //node functions
@@ -279,6 +340,7 @@ static void apx_node_setPortSignature(const apx_node_t *self, apx_port_t *port)
       apx_port_setDerivedDataSignature(port,dataSignature);
    }
    apx_port_derivePortSignature(port);
+   (void) apx_port_internPortSignature(port);
 }
 
 static int apx_node_getDatatypeId(apx_port_t *port)
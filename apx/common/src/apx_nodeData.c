@@ -70,6 +70,12 @@ void apx_nodeData_create(apx_nodeData_t *self, const char *name, uint8_t *defini
       SPINLOCK_INIT(self->internalLock);
       self->fileManager = (apx_fileManager_t*) 0;
       self->nodeInfo = (apx_nodeInfo_t*) 0;
+      self->isStale = false;
+      self->staleSinceMs = 0;
+      self->inPortResumeFlags = (uint8_t*) 0;
+      self->outPortResumeData = (uint8_t*) 0;
+      self->outPortResumeFlags = (uint8_t*) 0;
+      self->outPortResumeRemain = 0;
 #endif
    }
 }
@@ -83,6 +89,18 @@ void apx_nodeData_destroy(apx_nodeData_t *self)
       SPINLOCK_DESTROY(self->outPortDataLock);
       SPINLOCK_DESTROY(self->definitionDataLock);
       SPINLOCK_DESTROY(self->internalLock);
+      if (self->inPortResumeFlags != 0)
+      {
+         free(self->inPortResumeFlags);
+      }
+      if (self->outPortResumeData != 0)
+      {
+         free(self->outPortResumeData);
+      }
+      if (self->outPortResumeFlags != 0)
+      {
+         free(self->outPortResumeFlags);
+      }
 
       if (self->isWeakref == false)
       {
@@ -331,6 +349,51 @@ int8_t apx_nodeData_writeInPortData(apx_nodeData_t *self, const uint8_t *src, ui
 
 }
 
+/**
+ * Writes port data which has not yet been sent. The dirty flag of the port (at offset) stays set until the data is read back
+ * using apx_nodeData_readInPortData, this way a port never has more than one outstanding update.
+ * returns 1 if an update was already outstanding (it now carries the new value), 0 if this is the first outstanding update, -1 on error
+ */
+int8_t apx_nodeData_writeInPortDataPending(apx_nodeData_t *self, const uint8_t *src, uint32_t offset, uint32_t len)
+{
+   int8_t retval = -1;
+   if ( (self == 0) || (self->inPortDataBuf == 0) || (self->inPortDirtyFlags == 0) )
+   {
+      errno = EINVAL;
+      return retval;
+   }
+#ifndef APX_EMBEDDED
+   SPINLOCK_ENTER(self->inPortDataLock);
+#endif
+   if ( (offset+len) <= self->inPortDataLen)
+   {
+      memcpy(&self->inPortDataBuf[offset], src, len);
+      retval = (self->inPortDirtyFlags[offset] != 0)? 1 : 0;
+      self->inPortDirtyFlags[offset] = 1;
+   }
+#ifndef APX_EMBEDDED
+   SPINLOCK_LEAVE(self->inPortDataLock);
+#endif
+   return retval;
+}
+
+/**
+ * drops the outstanding update of the port at offset without reading it
+ */
+void apx_nodeData_clearInPortDataPending(apx_nodeData_t *self, uint32_t offset)
+{
+   if ( (self != 0) && (self->inPortDirtyFlags != 0) && (offset < self->inPortDataLen) )
+   {
+#ifndef APX_EMBEDDED
+      SPINLOCK_ENTER(self->inPortDataLock);
+#endif
+      self->inPortDirtyFlags[offset] = 0;
+#ifndef APX_EMBEDDED
+      SPINLOCK_LEAVE(self->inPortDataLock);
+#endif
+   }
+}
+
 int8_t apx_nodeData_writeOutPortData(apx_nodeData_t *self, const uint8_t *src, uint32_t offset, uint32_t len)
 {
    int8_t retval = 0;
@@ -396,6 +459,143 @@ void apx_nodeData_setNodeInfo(apx_nodeData_t *self, struct apx_nodeInfo_tag *nod
       self->nodeInfo = nodeInfo;
    }
 }
+
+/**
+ * Writes port data that the client cannot receive right now because its connection is lost or not yet resumed.
+ * The written bytes are flagged (when inPortResumeFlags is set) and sent as part of the resume delta once the client reopens its inPortData file.
+ */
+int8_t apx_nodeData_writeInPortDataResume(apx_nodeData_t *self, const uint8_t *src, uint32_t offset, uint32_t len)
+{
+   int8_t retval = -1;
+   if ( (self == 0) || (self->inPortDataBuf == 0) || (src == 0) )
+   {
+      errno = EINVAL;
+      return retval;
+   }
+   SPINLOCK_ENTER(self->inPortDataLock);
+   if ( (offset+len) <= self->inPortDataLen)
+   {
+      memcpy(&self->inPortDataBuf[offset], src, len);
+      if (self->inPortResumeFlags != 0)
+      {
+         memset(&self->inPortResumeFlags[offset], 1, len);
+      }
+      retval = 0;
+   }
+   SPINLOCK_LEAVE(self->inPortDataLock);
+   return retval;
+}
+
+/**
+ * moves ownership of inPortResumeFlags to the caller, later writes are no longer flagged
+ */
+uint8_t *apx_nodeData_takeInPortResumeFlags(apx_nodeData_t *self)
+{
+   uint8_t *retval = (uint8_t*) 0;
+   if (self != 0)
+   {
+      SPINLOCK_ENTER(self->inPortDataLock);
+      retval = self->inPortResumeFlags;
+      self->inPortResumeFlags = (uint8_t*) 0;
+      SPINLOCK_LEAVE(self->inPortDataLock);
+   }
+   return retval;
+}
+
+/**
+ * keeps a copy of outPortData from when the client resumed its session, every byte is flagged until the client has sent it again.
+ * returns 0 on success, -1 on failure
+ */
+int8_t apx_nodeData_beginOutPortResume(apx_nodeData_t *self)
+{
+   if ( (self != 0) && (self->outPortDataBuf != 0) && (self->outPortDataLen > 0) )
+   {
+      uint8_t *resumeData = (uint8_t*) malloc(self->outPortDataLen);
+      uint8_t *resumeFlags = (uint8_t*) malloc(self->outPortDataLen);
+      if ( (resumeData == 0) || (resumeFlags == 0) )
+      {
+         if (resumeData != 0)
+         {
+            free(resumeData);
+         }
+         if (resumeFlags != 0)
+         {
+            free(resumeFlags);
+         }
+         errno = ENOMEM;
+         return -1;
+      }
+      memset(resumeFlags, 1, self->outPortDataLen);
+      SPINLOCK_ENTER(self->outPortDataLock);
+      memcpy(resumeData, self->outPortDataBuf, self->outPortDataLen);
+      if (self->outPortResumeData != 0)
+      {
+         free(self->outPortResumeData);
+      }
+      if (self->outPortResumeFlags != 0)
+      {
+         free(self->outPortResumeFlags);
+      }
+      self->outPortResumeData = resumeData;
+      self->outPortResumeFlags = resumeFlags;
+      self->outPortResumeRemain = self->outPortDataLen;
+      SPINLOCK_LEAVE(self->outPortDataLock);
+      return 0;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * returns true when the resumed client sends the port at offset for the first time and its value is the same as before the client resumed.
+ * Such a write does not need to be routed, the subscribers already have the value.
+ */
+bool apx_nodeData_isOutPortResumeUnchanged(apx_nodeData_t *self, uint32_t offset, uint32_t len)
+{
+   bool retval = false;
+   if (self != 0)
+   {
+      SPINLOCK_ENTER(self->outPortDataLock);
+      if ( (self->outPortResumeData != 0) && ((offset+len) <= self->outPortDataLen) && (self->outPortResumeFlags[offset] != 0) )
+      {
+         retval = (memcmp(&self->outPortResumeData[offset], &self->outPortDataBuf[offset], len) == 0)? true : false;
+      }
+      SPINLOCK_LEAVE(self->outPortDataLock);
+   }
+   return retval;
+}
+
+/**
+ * marks a range of outPortData as sent again by the resumed client. The resume data is freed when the client has sent every byte,
+ * no matter if it did so in one write or in several
+ */
+void apx_nodeData_clearOutPortResume(apx_nodeData_t *self, uint32_t offset, uint32_t len)
+{
+   if (self != 0)
+   {
+      SPINLOCK_ENTER(self->outPortDataLock);
+      if ( (self->outPortResumeData != 0) && ((offset+len) <= self->outPortDataLen) )
+      {
+         uint32_t i;
+         for (i=offset; i<offset+len; i++)
+         {
+            if (self->outPortResumeFlags[i] != 0)
+            {
+               self->outPortResumeFlags[i] = 0;
+               self->outPortResumeRemain--;
+            }
+         }
+         if (self->outPortResumeRemain == 0)
+         {
+            free(self->outPortResumeData);
+            free(self->outPortResumeFlags);
+            self->outPortResumeData = (uint8_t*) 0;
+            self->outPortResumeFlags = (uint8_t*) 0;
+         }
+      }
+      SPINLOCK_LEAVE(self->outPortDataLock);
+   }
+}
 #endif
 
 #ifdef APX_EMBEDDED
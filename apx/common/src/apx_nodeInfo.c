@@ -8,6 +8,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include "apx_nodeInfo.h"
+#include "apx_nodeTemplate.h"
 #include "apx_dataTrigger.h"
 #include "apx_fileManager.h"
 #include "apx_nodeData.h"
@@ -29,6 +30,7 @@ static void apx_nodeInfo_connectProvidePortInternal(apx_nodeInfo_t *self, int32_
 static void apx_nodeInfo_disconnectRequirePortInternal(apx_nodeInfo_t *requesterNodeInfo, int32_t requesterPortIndex);
 static void apx_nodeInfo_disconnectProvidePortInternal(apx_nodeInfo_t *providerNodeInfo, int32_t providerPortIndex, apx_portref_t *portref);
 static bool apx_nodeInfo_isPortEntryOutsidePortDataLen(const apx_portDataMapEntry_t* portEntry, uint32_t portDataLen);
+static void apx_nodeInfo_markDirty(apx_nodeInfo_t *self);
 
 //////////////////////////////////////////////////////////////////////////////
 // GLOBAL VARIABLES
@@ -51,13 +53,13 @@ void apx_nodeInfo_create(apx_nodeInfo_t *self, apx_node_t *node)
       int32_t requireDataLen;
       int32_t provideDataLen;
       adt_ary_create(&self->requireConnectors,apx_portref_vdelete);
-      adt_ary_create(&self->provideConnectors,adt_ary_vdelete);
-      apx_portDataMap_create(&self->inDataMap);
-      apx_portDataMap_create(&self->outDataMap);
+      adt_ary_create(&self->provideConnectors,apx_portrefSet_vdelete);
       self->providePortFlags=0;
       self->requirePortFlags=0;
       self->pendingProvidePortFlags=0;
       self->pendingRequirePortFlags=0;
+      self->dirtyList = (adt_ary_t*) 0;
+      self->isDirty = false;
       self->node=node;
       node->nodeInfo=self;
       self->isWeakRef_node = true; //default true
@@ -65,11 +67,24 @@ void apx_nodeInfo_create(apx_nodeInfo_t *self, apx_node_t *node)
       numProvidePorts = adt_ary_length(&self->node->providePortList);
       adt_ary_resize(&self->requireConnectors,numRequirePorts);
       adt_ary_resize(&self->provideConnectors,numProvidePorts);
-      apx_node_finalize(node);
-      apx_portDataMap_build(&self->inDataMap,node,APX_REQUIRE_PORT);
-      apx_portDataMap_build(&self->outDataMap,node,APX_PROVIDE_PORT);
-      requireDataLen = apx_portDataMap_getDataLen(&self->inDataMap);
-      provideDataLen = apx_portDataMap_getDataLen(&self->outDataMap);
+      if (node->nodeTemplate != 0)
+      {
+         //node is already finalized, its data maps are shared with all other nodes created from the same template
+         self->inDataMap = &node->nodeTemplate->inDataMap;
+         self->outDataMap = &node->nodeTemplate->outDataMap;
+         self->isWeakRef_dataMaps = true;
+      }
+      else
+      {
+         apx_node_finalize(node);
+         self->inDataMap = apx_portDataMap_new();
+         self->outDataMap = apx_portDataMap_new();
+         self->isWeakRef_dataMaps = false;
+         apx_portDataMap_build(self->inDataMap,node,APX_REQUIRE_PORT);
+         apx_portDataMap_build(self->outDataMap,node,APX_PROVIDE_PORT);
+      }
+      requireDataLen = apx_portDataMap_getDataLen(self->inDataMap);
+      provideDataLen = apx_portDataMap_getDataLen(self->outDataMap);
       //GFX_LOG_INFO("%s/require: %d\n",node->name,requireDataLen);
       //GFX_LOG_INFO("%s/provide: %d\n",node->name,provideDataLen);
       if(requireDataLen < 0)
@@ -114,8 +129,11 @@ void apx_nodeInfo_destroy(apx_nodeInfo_t *self)
    {
       adt_ary_destroy(&self->requireConnectors);
       adt_ary_destroy(&self->provideConnectors);
-      apx_portDataMap_destroy(&self->inDataMap);
-      apx_portDataMap_destroy(&self->outDataMap);
+      if (self->isWeakRef_dataMaps == false)
+      {
+         apx_portDataMap_delete(self->inDataMap);
+         apx_portDataMap_delete(self->outDataMap);
+      }
       apx_dataTriggerTable_destroy(&self->outDataTriggerTable);
       if (self->requirePortFlags != 0)
       {
@@ -189,10 +207,12 @@ void apx_nodeInfo_connectPort(apx_nodeInfo_t *providerNodeInfo, int32_t provider
          //set event flag on require port (for later processing)
          providerNodeInfo->providePortFlags[providerPortIndex] |= APX_PORT_EVENT_CONNECTED;
          providerNodeInfo->pendingProvidePortFlags++;
+         apx_nodeInfo_markDirty(providerNodeInfo);
 
          //set event flag on require port (for later processing)
          requesterNodeInfo->requirePortFlags[requesterPortIndex] |= APX_PORT_EVENT_CONNECTED;
          requesterNodeInfo->pendingRequirePortFlags++;
+         apx_nodeInfo_markDirty(requesterNodeInfo);
       }
    }
 }
@@ -211,15 +231,15 @@ void apx_nodeInfo_disconnectProvidePort(apx_nodeInfo_t *providerNodeInfo, int32_
       if ( (providerPortIndex>=0) && (providerPortIndex<numProvidePorts) &&
            (providerPortIndex<numProvideConnectionPoints) )
       {
-         adt_ary_t *connectionList = (adt_ary_t*) *adt_ary_get(&providerNodeInfo->provideConnectors,providerPortIndex);
+         apx_portrefSet_t *connectionList = (apx_portrefSet_t*) *adt_ary_get(&providerNodeInfo->provideConnectors,providerPortIndex);
          int32_t i;
          int32_t end;
-         end = adt_ary_length(connectionList);
+         end = apx_portrefSet_length(connectionList);
          for(i=0;i<end;i++)
          {
             apx_nodeInfo_t *requesterNodeInfo;
             int32_t requesterPortIndex;
-            apx_portref_t *portref = (apx_portref_t*) adt_ary_value(connectionList,i);
+            apx_portref_t *portref = apx_portrefSet_get(connectionList,i);
             requesterNodeInfo = portref->node->nodeInfo;
             requesterPortIndex = portref->port->portIndex;
             //We cannot use the normal function apx_nodeInfo_disconnectRequirePort here, it will cause a recursive loop.
@@ -227,15 +247,17 @@ void apx_nodeInfo_disconnectProvidePort(apx_nodeInfo_t *providerNodeInfo, int32_
             apx_nodeInfo_disconnectRequirePortInternal(requesterNodeInfo,requesterPortIndex);
             requesterNodeInfo->requirePortFlags[requesterPortIndex] |= APX_PORT_EVENT_DISCONNECTED;
             requesterNodeInfo->pendingRequirePortFlags++;
+            apx_nodeInfo_markDirty(requesterNodeInfo);
          }
          //now all connections to connectList should be cleared, time to delete connectionList entirely
          //First set the connectorList pointer to NULL (i.e. we detach the object from the list)
          adt_ary_set(&providerNodeInfo->provideConnectors,providerPortIndex, (void*) 0);
          //Now delete the detached object, the virtual destructor will take care of freeing memory for the internal objects in the list
-         adt_ary_delete(connectionList);
+         apx_portrefSet_delete(connectionList);
          //finally set the disconnected event for later processing where we will need to update data trigger tables
          providerNodeInfo->providePortFlags[providerPortIndex] |= APX_PORT_EVENT_DISCONNECTED;
          providerNodeInfo->pendingProvidePortFlags++;
+         apx_nodeInfo_markDirty(providerNodeInfo);
       }
    }
 }
@@ -274,6 +296,8 @@ void apx_nodeInfo_disconnectRequirePort(apx_nodeInfo_t *requesterNodeInfo, int32
             providerNodeInfo->providePortFlags[providerPortIndex] |= APX_PORT_EVENT_DISCONNECTED;
             providerNodeInfo->pendingProvidePortFlags++;
             requesterNodeInfo->pendingRequirePortFlags++;
+            apx_nodeInfo_markDirty(providerNodeInfo);
+            apx_nodeInfo_markDirty(requesterNodeInfo);
          }
          else
          {
@@ -291,7 +315,7 @@ adt_ary_t *apx_nodeInfo_getProvidePortConnectorList(apx_nodeInfo_t *self, int32_
       int32_t numProvideConnectors = adt_ary_length(&self->provideConnectors);
       if ( (providerPortIndex >= 0) && (providerPortIndex < numProvideConnectors) )
       {
-         return (adt_ary_t*) *adt_ary_get(&self->provideConnectors,providerPortIndex);
+         return apx_portrefSet_getList((apx_portrefSet_t*) *adt_ary_get(&self->provideConnectors,providerPortIndex));
       }
    }
    return (adt_ary_t *) 0;
@@ -382,7 +406,7 @@ apx_portDataMap_t *apx_nodeInfo_getOutDataMap(apx_nodeInfo_t *self)
 {
    if (self != 0)
    {
-      return &self->outDataMap;
+      return self->outDataMap;
    }
    errno=EINVAL;
    return 0;
@@ -392,7 +416,7 @@ int32_t apx_nodeInfo_getInPortDataOffset(apx_nodeInfo_t *self, int32_t requirePo
 {
    if ( self != 0)
    {
-      apx_portDataMapEntry_t *entry = apx_portDataMap_getEntry(&self->inDataMap, requirePortIndex);
+      apx_portDataMapEntry_t *entry = apx_portDataMap_getEntry(self->inDataMap, requirePortIndex);
       if (entry != 0)
       {
          return entry->offset;
@@ -406,7 +430,7 @@ int32_t apx_nodeInfo_getOutPortDataOffset(apx_nodeInfo_t *self, int32_t provideP
 {
    if ( self != 0)
    {
-      apx_portDataMapEntry_t *entry = apx_portDataMap_getEntry(&self->outDataMap, providePortIndex);
+      apx_portDataMapEntry_t *entry = apx_portDataMap_getEntry(self->outDataMap, providePortIndex);
       if (entry != 0)
       {
          return entry->offset;
@@ -448,6 +472,19 @@ apx_dataTriggerFunction_t *apx_nodeInfo_getTriggerFunction(const apx_nodeInfo_t
    return (apx_dataTriggerFunction_t*) 0;
 }
 
+/**
+ * returns the first dataTriggerFunction found at or after offset
+ */
+apx_dataTriggerFunction_t *apx_nodeInfo_getNextTriggerFunction(const apx_nodeInfo_t *self, int32_t offset)
+{
+   if ( (self != 0) )
+   {
+      return apx_dataTriggerTable_getNext(&self->outDataTriggerTable, offset);
+   }
+   errno=EINVAL;
+   return (apx_dataTriggerFunction_t*) 0;
+}
+
 /**
  * for each require port in self, copy init data from the outDataBuf of connected provide port
  */
@@ -475,7 +512,7 @@ void apx_nodeInfo_copyInitDataFromProvideConnectors(apx_nodeInfo_t *self)
             provideNodeData = provideNodeInfo->nodeData;
             if ( (provideNodeData!=0) && (provideNodeData->outPortDataBuf != 0) )
             {
-               const apx_portDataMapEntry_t* const providePortEntry = apx_portDataMap_getEntry(&provideNodeInfo->outDataMap, providePortIndex);
+               const apx_portDataMapEntry_t* const providePortEntry = apx_portDataMap_getEntry(provideNodeInfo->outDataMap, providePortIndex);
                assert(providePortEntry != 0);
                //array bounds check
                if (apx_nodeInfo_isPortEntryOutsidePortDataLen(providePortEntry, provideNodeData->outPortDataLen))
@@ -484,7 +521,7 @@ void apx_nodeInfo_copyInitDataFromProvideConnectors(apx_nodeInfo_t *self)
                }
                else
                {
-                  apx_portDataMapEntry_t *requirePortEntry = apx_portDataMap_getEntry(&self->inDataMap, requirePortIndex);
+                  apx_portDataMapEntry_t *requirePortEntry = apx_portDataMap_getEntry(self->inDataMap, requirePortIndex);
                   assert(requirePortEntry != 0);
                   if (apx_nodeInfo_isPortEntryOutsidePortDataLen(requirePortEntry, requireNodeData->inPortDataLen))
                   {
@@ -509,6 +546,23 @@ void apx_nodeInfo_setNodeData(apx_nodeInfo_t *self, apx_nodeData_t *nodeData)
    }
 }
 
+/**
+ * Sets the list this nodeInfo adds itself to when one of its port flags is set. The router post-processes only the nodes in this list
+ * instead of scanning every attached node. Set to 0 when the nodeInfo is detached from the router.
+ */
+void apx_nodeInfo_setDirtyList(apx_nodeInfo_t *self, adt_ary_t *dirtyList)
+{
+   if (self != 0)
+   {
+      self->dirtyList = dirtyList;
+      self->isDirty = false;
+      if ( (self->pendingProvidePortFlags > 0) || (self->pendingRequirePortFlags > 0) )
+      {
+         apx_nodeInfo_markDirty(self);
+      }
+   }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // LOCAL FUNCTIONS
 //////////////////////////////////////////////////////////////////////////////
@@ -517,6 +571,15 @@ static bool apx_nodeInfo_isPortEntryOutsidePortDataLen(const apx_portDataMapEntr
    return ( (uint32_t)portEntry->offset >= portDataLen) || ( (uint32_t)(portEntry->offset+portEntry->length) > portDataLen);
 }
 
+static void apx_nodeInfo_markDirty(apx_nodeInfo_t *self)
+{
+   if ( (self->isDirty == false) && (self->dirtyList != 0) )
+   {
+      self->isDirty = true;
+      adt_ary_push(self->dirtyList, (void*) self);
+   }
+}
+
 /**
  * connect one of our require ports to another nodes' provide port
  */
@@ -560,8 +623,7 @@ static void apx_nodeInfo_connectProvidePortInternal(apx_nodeInfo_t *self, int32_
       }
       if ( (portIndex >= 0) && (portIndex<numPorts) )
       {
-         apx_portref_t *newConnection = apx_portref_new(requesterNode, requirePort);
-         adt_ary_t *innerConnectionList;
+         apx_portrefSet_t *innerConnectionList;
          /*
           * For provide ports it gets a little trickier than for require ports.
           * Each provide port can provide its output value to many receivers (multiplicity 0..*).
@@ -571,13 +633,13 @@ static void apx_nodeInfo_connectProvidePortInternal(apx_nodeInfo_t *self, int32_
           *
           * self->provideConnections (outerConnectionList)
           * |
-          * +--- provide port 1: adt_ary_t<apx_portref_t>
+          * +--- provide port 1: apx_portrefSet_t<apx_portref_t>
           * |                     |
           * |                     +--- connector 0 apx_portref_t(requesterNode1,requesterPort1)
           * |                     |
           * |                     +--- connector 1 apx_portref_t(requesterNode2,reqesterPort2)
           * |
-          * +--- provide port 2: adt_ary_t<apx_portref_t>
+          * +--- provide port 2: apx_portrefSet_t<apx_portref_t>
             |                     |
           * |                     +--- connector 0 apx_portref_t(requesterNode3,requesterPort3)
           * |                     |
@@ -588,32 +650,19 @@ static void apx_nodeInfo_connectProvidePortInternal(apx_nodeInfo_t *self, int32_
           */
 
          //1. check for empty list
-         innerConnectionList = (adt_ary_t*) *adt_ary_get(outerConnectionList,portIndex);
+         innerConnectionList = (apx_portrefSet_t*) *adt_ary_get(outerConnectionList,portIndex);
          if (innerConnectionList == 0)
          {
-            //innerConnectionList does not exist for this port, create inner list and append new item to it
-            innerConnectionList = adt_ary_new(apx_portref_vdelete);
-            adt_ary_push(innerConnectionList, newConnection);
-            adt_ary_set(outerConnectionList, portIndex,innerConnectionList);
-         }
-         else
-         {
-            //innerConnectionList already exists for this port, grab it and search for duplicates before appending
-            int32_t end;
-            int32_t i;
-            end = adt_ary_length(innerConnectionList);
-            for(i=0;i<end;i++)
+            //innerConnectionList does not exist for this port, create it
+            innerConnectionList = apx_portrefSet_new();
+            if (innerConnectionList == 0)
             {
-               apx_portref_t *ref = (apx_portref_t*) adt_ary_value(innerConnectionList,i);
-               if (apx_portref_equals(ref,newConnection) != 0)
-               {
-                  //identical connection found, don't add it again
-                  return;
-               }
+               return;
             }
-            //add new connection
-            adt_ary_push(innerConnectionList, newConnection);
+            adt_ary_set(outerConnectionList, portIndex,innerConnectionList);
          }
+         //2. add new connection, the set ignores identical connections
+         (void) apx_portrefSet_insert(innerConnectionList, requesterNode, requirePort);
       }
    }
 }
@@ -650,23 +699,10 @@ static void apx_nodeInfo_disconnectProvidePortInternal(apx_nodeInfo_t *providerN
       numConnectionPoints = adt_ary_length(&providerNodeInfo->provideConnectors);
       if ( (providerPortIndex >= 0) && (providerPortIndex<numConnectionPoints) )
       {
-         adt_ary_t *innerList = (adt_ary_t*) *adt_ary_get(&providerNodeInfo->provideConnectors, providerPortIndex);
-         if (innerList != 0)
+         apx_portrefSet_t *innerList = (apx_portrefSet_t*) *adt_ary_get(&providerNodeInfo->provideConnectors, providerPortIndex);
+         if ( (innerList != 0) && (portref != 0) )
          {
-            int32_t i;
-            int32_t end;
-
-            end = adt_ary_length(innerList);
-            for (i=0;i<end;i++)
-            {
-               apx_portref_t *other = (apx_portref_t*) *adt_ary_get(innerList,i); // todo adt_ary_value
-               if ( apx_portref_equals(portref,other) != 0)
-               {
-                  //found element
-                  adt_ary_splice(innerList,i,1);
-                  return; //cannot continue loop, we just modified the list. This is OK since duplicates are not allowed
-               }
-            }
+            (void) apx_portrefSet_remove(innerList, portref->node, portref->port);
          }
       }
    }
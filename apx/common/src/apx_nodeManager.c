@@ -8,6 +8,9 @@
 #include <string.h>
 #include <assert.h>
 #include <stdint.h>
+#ifndef _WIN32
+#include <time.h>
+#endif
 #if defined(_MSC_PLATFORM_TOOLSET) && (_MSC_PLATFORM_TOOLSET<=110)
 #include "msc_bool.h"
 #else
@@ -22,6 +25,8 @@
 #include "apx_nodeInfo.h"
 #include "apx_router.h"
 #include "apx_logging.h"
+#include "apx_rcu.h"
+#include "sha256.h"
 #ifdef MEM_LEAK_CHECK
 #include "CMemLeak.h"
 #endif
@@ -34,17 +39,50 @@
 #define snprintf _snprintf
 #endif
 
+#define APX_NODE_MANAGER_WRITE_BATCH_LEN 32 //routed writes collected on the stack before they are sent
+
+/**
+ * a routed write that is looked up inside an rcu read-side section and sent after the section has ended
+ */
+typedef struct apx_nodeManager_pendingWrite_tag
+{
+   apx_fileManager_t *fileManager; //reference taken with apx_fileManager_tryRef
+   apx_file_t *file; //inPortData file of the destination
+   apx_sharedPayload_t *payload; //holds a reference
+   apx_offset_t offset;
+   bool isQueued;
+}apx_nodeManager_pendingWrite_t;
+
+typedef struct apx_nodeManager_writeBatch_tag
+{
+   apx_nodeManager_pendingWrite_t *writes; //points to localWrites unless a trigger function has more destinations than fit in it
+   int32_t numWrites;
+   int32_t capacity;
+   apx_nodeManager_pendingWrite_t localWrites[APX_NODE_MANAGER_WRITE_BATCH_LEN];
+}apx_nodeManager_writeBatch_t;
+
 //////////////////////////////////////////////////////////////////////////////
 // LOCAL FUNCTION PROTOTYPES
 //////////////////////////////////////////////////////////////////////////////
-static void apx_nodeManager_createNode(apx_nodeManager_t *self, const uint8_t *definitionBuf, int32_t definitionLen, struct apx_fileManager_tag *fileManager);
-static apx_nodeData_t *apx_nodeManager_getNodeData(const apx_nodeManager_t *self, const char *name);
+static void apx_nodeManager_linkNodes(void *arg, apx_definitionJob_t *job);
+static void apx_nodeManager_openRemoteOutDataFile(apx_nodeManager_t *self, apx_fileManager_t *fileManager, apx_nodeData_t *nodeData, apx_file_t *outDataFile, const char *debugInfoStr);
+static apx_nodeManagerShard_t *apx_nodeManager_getShard(apx_nodeManager_t *self, const char *name);
+static apx_nodeData_t *apx_nodeManager_getNodeData(apx_nodeManager_t *self, const char *name);
+static bool apx_nodeManager_addRemoteNodeData(apx_nodeManager_t *self, apx_nodeData_t *nodeData);
 static void apx_nodeManager_setLocalNodeData(apx_nodeManager_t *self, apx_nodeData_t *nodeData);
-static void apx_nodeManager_executePortTriggerFunction(const apx_dataTriggerFunction_t *triggerFunction, const apx_file_t *file);
+static void apx_nodeManager_initWriteBatch(apx_nodeManager_writeBatch_t *batch);
+static void apx_nodeManager_destroyWriteBatch(apx_nodeManager_writeBatch_t *batch);
+static bool apx_nodeManager_reserveWrites(apx_nodeManager_writeBatch_t *batch, int32_t numWrites);
+static void apx_nodeManager_collectPortWrites(apx_nodeManager_writeBatch_t *batch, const apx_dataTriggerFunction_t *triggerFunction, const apx_file_t *file);
+static void apx_nodeManager_sendWrites(apx_nodeManager_writeBatch_t *batch);
 static void apx_nodeManager_attachLocalNodeToFileManager(apx_nodeData_t *nodeData, apx_fileManager_t *fileManager);
-static void apx_nodeManager_removeRemoteNodeData(apx_nodeManager_t *self, apx_nodeData_t *nodeData);
-static void apx_nodeManager_removeNodeInfo(apx_nodeManager_t *self, apx_nodeInfo_t *nodeInfo);
-static bool apx_nodeManager_createInitData(apx_node_t *node, uint8_t *buf, int32_t bufLen);
+static void apx_nodeManager_removeRemoteNodeData(apx_nodeManagerShard_t *shard, apx_nodeData_t *nodeData);
+static void apx_nodeManager_removeNodeInfo(apx_nodeManagerShard_t *shard, apx_nodeInfo_t *nodeInfo);
+static void apx_nodeManager_retireNodes(apx_nodeManager_t *self, adt_ary_t *nodeInfoList);
+static bool apx_nodeManager_parkNode(apx_nodeData_t *nodeData, uint32_t now);
+static int8_t apx_nodeManager_resumeNode(apx_nodeManager_t *self, apx_fileManager_t *fileManager, apx_file_t *definitionFile, const char *name);
+static void apx_nodeManager_openResumedFiles(apx_nodeManager_t *self, apx_fileManager_t *fileManager, apx_nodeData_t *nodeData);
+static uint32_t apx_nodeManager_getTimeMs(void);
 //////////////////////////////////////////////////////////////////////////////
 // GLOBAL VARIABLES
 //////////////////////////////////////////////////////////////////////////////
@@ -61,25 +99,24 @@ void apx_nodeManager_create(apx_nodeManager_t *self)
 {
    if (self != 0)
    {
-      apx_istream_handler_t apx_istream_handler;
-      adt_hash_create(&self->nodeInfoMap, apx_nodeInfo_vdelete);
-      apx_parser_create(&self->parser);
-      memset(&apx_istream_handler,0,sizeof(apx_istream_handler));
+      int32_t i;
+      for (i=0; i<APX_NODE_MANAGER_NUM_SHARDS; i++)
+      {
+         apx_nodeManagerShard_t *shard = &self->shards[i];
+         adt_hash_create(&shard->nodeInfoMap, apx_nodeInfo_vdelete);
+         adt_hash_create(&shard->remoteNodeDataMap, apx_nodeData_vdelete);
+         MUTEX_INIT(shard->lock);
+      }
       self->router = (apx_router_t*) 0;
       self->debugMode = APX_DEBUG_NONE;
-      apx_istream_handler.arg = &self->parser;
-      apx_istream_handler.open = apx_parser_vopen;
-      apx_istream_handler.close = apx_parser_vclose;
-      apx_istream_handler.node = apx_parser_vnode;
-      apx_istream_handler.datatype = apx_parser_vdatatype;
-      apx_istream_handler.provide = apx_parser_vprovide;
-      apx_istream_handler.require = apx_parser_vrequire;
-      apx_istream_handler.node_end = apx_parser_vnode_end;
-      apx_istream_create(&self->apx_istream,&apx_istream_handler);
-      adt_hash_create(&self->remoteNodeDataMap, apx_nodeData_vdelete);
+      self->gracePeriodMs = 0;
       adt_hash_create(&self->localNodeDataMap, (void(*)(void*)) 0);
       adt_list_create(&self->fileManagerList, (void(*)(void*)) 0);
       MUTEX_INIT(self->lock);
+      MUTEX_INIT(self->routerLock);
+      apx_definitionPipeline_create(&self->definitionPipeline, apx_nodeManager_linkNodes, (void*) self);
+      apx_definitionCache_create(&self->definitionCache, APX_DEFINITION_CACHE_DEFAULT_CAPACITY);
+      apx_definitionPipeline_setCache(&self->definitionPipeline, &self->definitionCache);
    }
 }
 
@@ -87,13 +124,21 @@ void apx_nodeManager_destroy(apx_nodeManager_t *self)
 {
    if(self != 0)
    {
-      apx_parser_destroy(&self->parser);
-      adt_hash_destroy(&self->nodeInfoMap);
-      apx_istream_destroy(&self->apx_istream);
-      adt_hash_destroy(&self->remoteNodeDataMap);
+      int32_t i;
+      //stops the workers, definitions still in the queue are linked before the maps go away
+      apx_definitionPipeline_destroy(&self->definitionPipeline);
+      apx_definitionCache_destroy(&self->definitionCache);
+      for (i=0; i<APX_NODE_MANAGER_NUM_SHARDS; i++)
+      {
+         apx_nodeManagerShard_t *shard = &self->shards[i];
+         adt_hash_destroy(&shard->nodeInfoMap);
+         adt_hash_destroy(&shard->remoteNodeDataMap);
+         MUTEX_DESTROY(shard->lock);
+      }
       adt_hash_destroy(&self->localNodeDataMap);
       adt_list_destroy(&self->fileManagerList);
       MUTEX_DESTROY(self->lock);
+      MUTEX_DESTROY(self->routerLock);
    }
 }
 
@@ -111,13 +156,39 @@ void apx_nodeManager_remoteFileAdded(apx_nodeManager_t *self, struct apx_fileMan
          {
             apx_nodeData_t *nodeData;
             //this is potentially a new node, check if it exists already
-            MUTEX_LOCK(self->lock);
             nodeData = apx_nodeManager_getNodeData(self, basename);
-            MUTEX_UNLOCK(self->lock);
+            if ( (nodeData != 0) && (fileManager->mode == APX_FILEMANAGER_SERVER_MODE) )
+            {
+               int8_t result = apx_nodeManager_resumeNode(self, fileManager, remoteFile, basename);
+               if (result == 0)
+               {
+                  free(basename);
+                  return;
+               }
+               else if (result > 0)
+               {
+                  //the stale node could not be resumed and has been deleted, the definition is processed as a new node
+                  nodeData = (apx_nodeData_t*) 0;
+               }
+               else
+               {
+                  //the node is in use by another connection
+               }
+            }
             if (nodeData == 0)
             {
                if (fileManager->mode == APX_FILEMANAGER_SERVER_MODE)
                {
+                  apx_definitionCacheEntry_t *cacheEntry = (apx_definitionCacheEntry_t*) 0;
+                  if (remoteFile->fileInfo.digestType == RMF_DIGEST_TYPE_SHA256)
+                  {
+                     cacheEntry = apx_definitionCache_acquire(&self->definitionCache, remoteFile->fileInfo.digestData);
+                     if ( (cacheEntry != 0) && (cacheEntry->definitionLen != (int32_t) remoteFile->fileInfo.length) )
+                     {
+                        apx_definitionCache_release(&self->definitionCache, cacheEntry);
+                        cacheEntry = (apx_definitionCacheEntry_t*) 0;
+                     }
+                  }
                   //create new nodeData structure and initiate download of file
                   nodeData = apx_nodeData_newRemote(basename, false); //setting weakref to false will force apx_nodeData_delete to delete all buffers we created here
                   if (nodeData != 0)
@@ -128,20 +199,40 @@ void apx_nodeManager_remoteFileAdded(apx_nodeManager_t *self, struct apx_fileMan
                         APX_LOG_ERROR("[APX_NODE_MANAGER] out of memory when attempting to create definitionDataBuf of length %d for node %s", (int) remoteFile->fileInfo.length, basename);
                         free(basename);
                         apx_nodeData_delete(nodeData);
+                        apx_definitionCache_release(&self->definitionCache, cacheEntry);
                         return;
                      }
+                     nodeData->definitionDataLen = remoteFile->fileInfo.length;
+                     if (apx_nodeManager_addRemoteNodeData(self, nodeData) == false)
+                     {
+                        //another connection created the same node after our first check
+                        APX_LOG_ERROR("[APX_NODE_MANAGER] node already exists: %s", basename);
+                        apx_nodeData_delete(nodeData);
+                        apx_definitionCache_release(&self->definitionCache, cacheEntry);
+                     }
+                     else if (cacheEntry != 0)
+                     {
+                        //the same definition has been parsed before, the nodes are created from the cache without opening the file
+                        memcpy(nodeData->definitionDataBuf, cacheEntry->definitionBuf, cacheEntry->definitionLen);
+                        remoteFile->nodeData=nodeData;
+                        APX_LOG_INFO("[APX_NODE_MANAGER] using cached definition for %s", basename);
+                        if (apx_definitionPipeline_postCached(&self->definitionPipeline, cacheEntry, fileManager) != 0)
+                        {
+                           APX_LOG_ERROR("[APX_NODE_MANAGER] failed to process definition of %s", remoteFile->fileInfo.name);
+                        }
+                     }
                      else
                      {
-                        nodeData->definitionDataLen = remoteFile->fileInfo.length;
-                        MUTEX_LOCK(self->lock);
-                        adt_hash_set(&self->remoteNodeDataMap, basename, 0, nodeData);
-                        MUTEX_UNLOCK(self->lock);
                         //now that memory has been allocated, send request to open the file (triggering file transfer)
                         apx_fileManager_sendFileOpen(fileManager, remoteFile->fileInfo.address);
                         //the following line binds our new nodeData object to the apx_file_t structure
                         remoteFile->nodeData=nodeData;
                      }
                   }
+                  else
+                  {
+                     apx_definitionCache_release(&self->definitionCache, cacheEntry);
+                  }
                }
                else
                {
@@ -162,9 +253,7 @@ void apx_nodeManager_remoteFileAdded(apx_nodeManager_t *self, struct apx_fileMan
          {
             apx_nodeData_t *nodeData;
             //this is potentially a new node, check if it exists already
-            MUTEX_LOCK(self->lock);
             nodeData = apx_nodeManager_getNodeData(self, basename);
-            MUTEX_UNLOCK(self->lock);
             if ( nodeData != 0 )
             {
                if (nodeData->inPortDataLen != remoteFile->fileInfo.length)
@@ -187,6 +276,21 @@ void apx_nodeManager_remoteFileAdded(apx_nodeManager_t *self, struct apx_fileMan
             free(basename);
          }
       }
+      else if ( (remoteFile->fileType == APX_OUTDATA_FILE) && (fileManager->mode == APX_FILEMANAGER_SERVER_MODE) )
+      {
+         char *basename = apx_file_basename(remoteFile);
+         if (basename != 0)
+         {
+            apx_nodeData_t *nodeData;
+            //usually the node is linked later and opens the file itself, unless its definition came from the cache
+            nodeData = apx_nodeManager_getNodeData(self, basename);
+            if ( (nodeData != 0) && (nodeData->fileManager == fileManager) )
+            {
+               apx_nodeManager_openRemoteOutDataFile(self, fileManager, nodeData, remoteFile, "");
+            }
+            free(basename);
+         }
+      }
       else
       {
          
@@ -216,9 +320,13 @@ void apx_nodeManager_remoteFileWritten(apx_nodeManager_t *self, struct apx_fileM
    {
       if (remoteFile->fileType == APX_DEFINITION_FILE)
       {
-         MUTEX_LOCK(self->lock);
-         apx_nodeManager_createNode(self, remoteFile->nodeData->definitionDataBuf, remoteFile->nodeData->definitionDataLen, fileManager);
-         MUTEX_UNLOCK(self->lock);
+         //parsing and preparing the nodes takes no locks, only apx_nodeManager_linkNodes is serialized.
+         //definitionDataBuf lives until the fileManager is detached, which cancels the job first
+         const uint8_t *digest = (remoteFile->fileInfo.digestType == RMF_DIGEST_TYPE_SHA256)? remoteFile->fileInfo.digestData : (const uint8_t*) 0;
+         if (apx_definitionPipeline_post(&self->definitionPipeline, remoteFile->nodeData->definitionDataBuf, remoteFile->nodeData->definitionDataLen, digest, fileManager) != 0)
+         {
+            APX_LOG_ERROR("[APX_NODE_MANAGER] failed to process definition of %s", remoteFile->fileInfo.name);
+         }
       }
       else
       {
@@ -234,21 +342,49 @@ void apx_nodeManager_remoteFileWritten(apx_nodeManager_t *self, struct apx_fileM
          if (remoteFile->fileType == APX_OUTDATA_FILE)
          {
             apx_nodeInfo_t *nodeInfo = remoteFile->nodeData->nodeInfo;
+            const apx_dataTriggerSnapshot_t *snapshot;
+            //a resumed client first sends all its values again, in one write or in several.
+            //Only the ones that changed since it was disconnected are routed
+            bool isResuming = (remoteFile->nodeData->outPortResumeData != 0)? true : false;
+            uint32_t startOffset = offset;
+            int32_t readIndex;
+            apx_nodeManager_writeBatch_t writeBatch;
             assert(nodeInfo != 0);
+            apx_nodeManager_initWriteBatch(&writeBatch);
+            //takes no locks, topology changes publish new snapshots instead of modifying the one used here.
+            //The section only looks up the destinations, a slow destination must not hold back the grace period of other writers
+            readIndex = apx_rcu_readLock();
+            snapshot = apx_dataTriggerTable_getSnapshot(&nodeInfo->outDataTriggerTable);
             while (offset < endOffset)
             {
                apx_dataTriggerFunction_t *triggerFunction;
-               triggerFunction = apx_nodeInfo_getTriggerFunction(nodeInfo, offset);
-               if (triggerFunction != 0)
+               //bytes without a trigger function (unconnected ports) are skipped in one step
+               triggerFunction = apx_dataTriggerSnapshot_getNext(snapshot, (int32_t) offset);
+               if ( (triggerFunction == 0) || (triggerFunction->srcOffset >= endOffset) )
                {
-                  apx_nodeManager_executePortTriggerFunction(triggerFunction, remoteFile);
-                  offset = triggerFunction->srcOffset + triggerFunction->dataLength;
+                  break;
                }
-               else
+               if ( (isResuming == false) || (apx_nodeData_isOutPortResumeUnchanged(remoteFile->nodeData, triggerFunction->srcOffset, triggerFunction->dataLength) == false) )
                {
-                  //fprintf(stderr, "APX_NODE_MANAGER(%s)] no trigger function found for file %s at offset %d\n", apx_fileManager_modeString(fileManager), remoteFile->fileInfo.name, offset);               
-                  offset++;
+                  if (apx_nodeManager_reserveWrites(&writeBatch, adt_ary_length(&triggerFunction->writeInfoList)) == false)
+                  {
+                     //the batch is full, send it and look up the trigger function again in a new section
+                     apx_rcu_readUnlock(readIndex);
+                     apx_nodeManager_sendWrites(&writeBatch);
+                     readIndex = apx_rcu_readLock();
+                     snapshot = apx_dataTriggerTable_getSnapshot(&nodeInfo->outDataTriggerTable);
+                     continue;
+                  }
+                  apx_nodeManager_collectPortWrites(&writeBatch, triggerFunction, remoteFile);
                }
+               offset = triggerFunction->srcOffset + triggerFunction->dataLength;
+            }
+            apx_rcu_readUnlock(readIndex);
+            apx_nodeManager_sendWrites(&writeBatch);
+            apx_nodeManager_destroyWriteBatch(&writeBatch);
+            if (isResuming == true)
+            {
+               apx_nodeData_clearOutPortResume(remoteFile->nodeData, startOffset, endOffset-startOffset);
             }
          }
       }
@@ -277,6 +413,7 @@ void apx_nodeManager_attachLocalNode(apx_nodeManager_t *self, apx_nodeData_t *no
       adt_list_elem_t *pIter;
       apx_nodeManager_setLocalNodeData(self, nodeData);
       //for each attached fileManager, create a new file
+      MUTEX_LOCK(self->lock);
       adt_list_iter_init(&self->fileManagerList);
       do
       {
@@ -287,7 +424,7 @@ void apx_nodeManager_attachLocalNode(apx_nodeManager_t *self, apx_nodeData_t *no
             apx_nodeManager_attachLocalNodeToFileManager(nodeData, fileManager);
          }
       }while(pIter != 0);
-
+      MUTEX_UNLOCK(self->lock);
    }
 }
 
@@ -302,6 +439,9 @@ void apx_nodeManager_attachFileManager(apx_nodeManager_t *self, struct apx_fileM
       //search for duplicates
       adt_list_elem_t *pIter;
       void **ppVal;
+      bool isAttached = false;
+      //connections are attached and detached by different threads, the list and its iterator are only used with the lock held
+      MUTEX_LOCK(self->lock);
       adt_list_iter_init(&self->fileManagerList);
 
       do
@@ -312,31 +452,37 @@ void apx_nodeManager_attachFileManager(apx_nodeManager_t *self, struct apx_fileM
             if (pIter->pItem == (void*) fileManager)
             {
                //fileManager already attached to list, take no action
-               return;
+               isAttached = true;
+               break;
             }
          }
       }while(pIter != 0);
-      //add fileManager to list
-      adt_list_insert(&self->fileManagerList, (void*) fileManager);
-      apx_fileManager_setNodeManager(fileManager, self);
-
-      adt_hash_iter_init(&self->localNodeDataMap);
-      do
+      if (isAttached == false)
       {
-         const char *key;
-         uint32_t keyLen;
-         ppVal = adt_hash_iter_next(&self->localNodeDataMap, &key, &keyLen);
-         if (ppVal != 0 )
+         //add fileManager to list
+         adt_list_insert(&self->fileManagerList, (void*) fileManager);
+         apx_fileManager_setNodeManager(fileManager, self);
+
+         adt_hash_iter_init(&self->localNodeDataMap);
+         do
          {
-            apx_nodeData_t *nodeData = *ppVal;
-            apx_nodeManager_attachLocalNodeToFileManager(nodeData, fileManager);
-         }
-      } while(ppVal != 0);
+            const char *key;
+            uint32_t keyLen;
+            ppVal = adt_hash_iter_next(&self->localNodeDataMap, &key, &keyLen);
+            if (ppVal != 0 )
+            {
+               apx_nodeData_t *nodeData = *ppVal;
+               apx_nodeManager_attachLocalNodeToFileManager(nodeData, fileManager);
+            }
+         } while(ppVal != 0);
+      }
+      MUTEX_UNLOCK(self->lock);
    }
 }
 
 /**
- * detaches a fileManager from this nodeManager
+ * detaches a fileManager from this nodeManager.
+ * With a grace period the remote nodes of the fileManager are kept as stale nodes instead of being deleted, see apx_nodeManager_setGracePeriod
  */
 void apx_nodeManager_detachFileManager(apx_nodeManager_t *self, struct apx_fileManager_tag *fileManager)
 {
@@ -357,90 +503,111 @@ void apx_nodeManager_detachFileManager(apx_nodeManager_t *self, struct apx_fileM
       int32_t end;
       uint32_t keyLen;
       adt_ary_t toBeDeleted; //list of nodeInfo_t that we need to remove from nodeInfoMap due to the removal of the file manager
-      adt_ary_t deletedNodeData; //list of deleted nodeData_t, used to prevent duplicate deletions
-
+      adt_ary_t handledNodeData; //list of deleted or parked nodeData_t, used to prevent duplicate deletions
+      uint32_t now = apx_nodeManager_getTimeMs();
+      int32_t shardIndex;
+      //a definition of this fileManager may still be on its way through the pipeline
+      apx_definitionPipeline_cancel(&self->definitionPipeline, fileManager);
+      //other connections may be sending to this fileManager outside of a read-side section, its nodes can't be retired before they are done
+      apx_fileManager_closeRefs(fileManager);
       adt_ary_create(&toBeDeleted, NULL);
-      adt_ary_create(&deletedNodeData, NULL);
+      adt_ary_create(&handledNodeData, NULL);
+      MUTEX_LOCK(self->lock);
       adt_list_remove(&self->fileManagerList, fileManager);
-      adt_hash_iter_init(&self->nodeInfoMap);
-      do
+      MUTEX_UNLOCK(self->lock);
+      for (shardIndex=0; shardIndex<APX_NODE_MANAGER_NUM_SHARDS; shardIndex++)
       {
-         ppVal = adt_hash_iter_next(&self->nodeInfoMap,&key, &keyLen);
-         if (ppVal != 0)
+         apx_nodeManagerShard_t *shard = &self->shards[shardIndex];
+         int32_t begin = adt_ary_length(&toBeDeleted);
+         MUTEX_LOCK(shard->lock);
+         adt_hash_iter_init(&shard->nodeInfoMap);
+         do
          {
-            apx_nodeInfo_t *nodeInfo = (apx_nodeInfo_t*) *ppVal;
-            assert(nodeInfo != 0);
-            if (nodeInfo->nodeData != 0)
+            ppVal = adt_hash_iter_next(&shard->nodeInfoMap,&key, &keyLen);
+            if (ppVal != 0)
             {
-               if (nodeInfo->nodeData->fileManager == fileManager)
+               apx_nodeInfo_t *nodeInfo = (apx_nodeInfo_t*) *ppVal;
+               assert(nodeInfo != 0);
+               if (nodeInfo->nodeData != 0)
                {
-                  adt_ary_push(&toBeDeleted, nodeInfo);
+                  if (nodeInfo->nodeData->fileManager == fileManager)
+                  {
+                     if ( (self->gracePeriodMs > 0) && (apx_nodeManager_parkNode(nodeInfo->nodeData, now) == true) )
+                     {
+                        //routes and last values are kept, the client may resume its session within the grace period
+                        adt_ary_push(&handledNodeData, nodeInfo->nodeData);
+                     }
+                     else
+                     {
+                        adt_ary_push(&toBeDeleted, nodeInfo);
+                     }
+                  }
                }
             }
+         } while(ppVal != 0);
+         end = adt_ary_length(&toBeDeleted);
+         for (i=begin; i<end; i++)
+         {
+            apx_nodeInfo_t *nodeInfo = (apx_nodeInfo_t*) *adt_ary_get(&toBeDeleted, i);
+            apx_nodeManager_removeRemoteNodeData(shard, nodeInfo->nodeData);
+            apx_nodeManager_removeNodeInfo(shard, nodeInfo);
          }
-      } while(ppVal != 0);
+         MUTEX_UNLOCK(shard->lock);
+      }
+      apx_nodeManager_retireNodes(self, &toBeDeleted);
       end = adt_ary_length(&toBeDeleted);
       for (i=0; i<end; i++)
       {
          apx_nodeInfo_t *nodeInfo = (apx_nodeInfo_t*) *adt_ary_get(&toBeDeleted, i);
-         apx_nodeData_t *nodeData = nodeInfo->nodeData;
-         if (self->router != 0)
-         {
-            apx_router_detachNodeInfo(self->router, nodeInfo);
-         }
-         apx_nodeManager_removeRemoteNodeData(self, nodeData);
-         apx_nodeData_delete(nodeData);
-         adt_ary_push(&deletedNodeData,nodeData);
-         apx_nodeManager_removeNodeInfo(self, nodeInfo);
-         apx_nodeInfo_delete(nodeInfo);
+         adt_ary_push(&handledNodeData, nodeInfo->nodeData);
       }
-      
+
       {
          //remove any remaining nodeInfos attached to this fileManager
-         adt_list_elem_t *iter;
-         adt_list_iter_init(&fileManager->remoteFileMap.fileList);
-         do
+         int32_t fileIndex;
+         int32_t numFiles = apx_fileMap_length(&fileManager->remoteFileMap);
+         for (fileIndex=0; fileIndex<numFiles; fileIndex++)
          {
-            iter = adt_list_iter_next(&fileManager->remoteFileMap.fileList);
-            if (iter != 0)
+            apx_file_t *file = apx_fileMap_get(&fileManager->remoteFileMap, fileIndex);
+            if ( (file != 0) && (file->nodeData != 0))
             {
-               apx_file_t *file = (apx_file_t*)iter->pItem;
-               if ( (file != 0) && (file->nodeData != 0))
+               bool found=false;
+               end = adt_ary_length(&handledNodeData);
+               for (i=0; i<end; i++)
                {
-                  bool found=false;
-                  end = adt_ary_length(&deletedNodeData);
-                  for (i=0; i<end; i++)
+                  //prevent deleting nodeData twice
+                  apx_nodeData_t *nodeData = (apx_nodeData_t*) *adt_ary_get(&handledNodeData, i);
+                  if (nodeData == file->nodeData)
                   {
-                     //prevent deleting nodeData twice
-                     apx_nodeData_t *nodeData = (apx_nodeData_t*) *adt_ary_get(&deletedNodeData, i);
-                     if (nodeData == file->nodeData)
-                     {
-                        found=true;
-                        break;
-                     }
+                     found=true;
+                     break;
                   }
-                  if (found == false)
+               }
+               if (found == false)
+               {
+                  void** ppVal;
+                  apx_nodeManagerShard_t *shard = apx_nodeManager_getShard(self, file->nodeData->name);
+                  MUTEX_LOCK(shard->lock);
+                  ppVal = adt_hash_get(&shard->remoteNodeDataMap, file->nodeData->name, 0);
+                  if (ppVal != 0)
                   {
-                     void** ppVal;
-                     MUTEX_LOCK(self->lock);
-                     ppVal = adt_hash_get(&self->remoteNodeDataMap, file->nodeData->name, 0);
-                     if (ppVal != 0)
-                     {
-                        APX_LOG_INFO("[APX_NODE_MANAGER] deleting nodeData for %s",file->nodeData->name);
-                        apx_nodeManager_removeRemoteNodeData(self, file->nodeData);
-                        apx_nodeData_delete(file->nodeData);
-                        adt_ary_push(&deletedNodeData, file->nodeData);
+                     APX_LOG_INFO("[APX_NODE_MANAGER] deleting nodeData for %s",file->nodeData->name);
+                     apx_nodeManager_removeRemoteNodeData(shard, file->nodeData);
+                     apx_rcu_retire(file->nodeData, apx_nodeData_vdelete);
+                     adt_ary_push(&handledNodeData, file->nodeData);
 //                        apx_nodeManager_removeNodeInfo(self, nodeInfo);
 //                        apx_nodeInfo_delete(nodeInfo);
-                     }
-                     MUTEX_UNLOCK(self->lock);
                   }
+                  MUTEX_UNLOCK(shard->lock);
                }
             }
-         }while(iter != 0);
+         }
       }
       adt_ary_destroy(&toBeDeleted);
-      adt_ary_destroy(&deletedNodeData);
+      adt_ary_destroy(&handledNodeData);
+      //deletes the detached nodes and the routing snapshots replaced by detaching them
+      apx_rcu_synchronize();
+      (void) apx_nodeManager_expireStaleNodes(self);
    }
 }
 
@@ -452,166 +619,342 @@ void apx_nodeManager_setDebugMode(apx_nodeManager_t *self, int8_t debugMode)
    }
 }
 
+/**
+ * Sets how long the nodes of a lost connection are kept. During the grace period the nodes are stale: their routes stay in place,
+ * subscribers keep the last provided values and writes to their require ports are collected.
+ * A client that presents the same node name and definition digest within the grace period resumes its session without a new
+ * definition being parsed or routed, and only receives the values that were written while it was disconnected.
+ * Stale nodes are deleted by apx_nodeManager_expireStaleNodes. 0 (the default) deletes nodes as soon as their connection is lost.
+ */
+void apx_nodeManager_setGracePeriod(apx_nodeManager_t *self, uint32_t gracePeriodMs)
+{
+   if (self != 0)
+   {
+      self->gracePeriodMs = gracePeriodMs;
+   }
+}
+
+/**
+ * deletes the stale nodes whose grace period has passed. Returns the number of deleted nodes, -1 on failure
+ */
+int32_t apx_nodeManager_expireStaleNodes(apx_nodeManager_t *self)
+{
+   if (self != 0)
+   {
+      adt_ary_t expired;
+      int32_t shardIndex;
+      int32_t numExpired;
+      uint32_t now = apx_nodeManager_getTimeMs();
+      adt_ary_create(&expired, NULL);
+      for (shardIndex=0; shardIndex<APX_NODE_MANAGER_NUM_SHARDS; shardIndex++)
+      {
+         apx_nodeManagerShard_t *shard = &self->shards[shardIndex];
+         int32_t begin = adt_ary_length(&expired);
+         int32_t end;
+         int32_t i;
+         void **ppVal;
+         MUTEX_LOCK(shard->lock);
+         adt_hash_iter_init(&shard->nodeInfoMap);
+         do
+         {
+            const char *key;
+            uint32_t keyLen;
+            ppVal = adt_hash_iter_next(&shard->nodeInfoMap, &key, &keyLen);
+            if (ppVal != 0)
+            {
+               apx_nodeInfo_t *nodeInfo = (apx_nodeInfo_t*) *ppVal;
+               apx_nodeData_t *nodeData = nodeInfo->nodeData;
+               if ( (nodeData != 0) && (nodeData->isStale == true) && ( (uint32_t) (now - nodeData->staleSinceMs) >= self->gracePeriodMs) )
+               {
+                  adt_ary_push(&expired, nodeInfo);
+               }
+            }
+         } while(ppVal != 0);
+         end = adt_ary_length(&expired);
+         for (i=begin; i<end; i++)
+         {
+            apx_nodeInfo_t *nodeInfo = (apx_nodeInfo_t*) *adt_ary_get(&expired, i);
+            APX_LOG_INFO("[APX_NODE_MANAGER] grace period of %s has passed", nodeInfo->node->name);
+            apx_nodeManager_removeRemoteNodeData(shard, nodeInfo->nodeData);
+            apx_nodeManager_removeNodeInfo(shard, nodeInfo);
+         }
+         MUTEX_UNLOCK(shard->lock);
+      }
+      numExpired = adt_ary_length(&expired);
+      if (numExpired > 0)
+      {
+         apx_nodeManager_retireNodes(self, &expired);
+         apx_rcu_synchronize();
+      }
+      adt_ary_destroy(&expired);
+      return numExpired;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * moves the parse, finalize and init data stages of received definitions to numWorkers worker threads.
+ * Without workers definitions are processed by the thread that received them.
+ */
+int8_t apx_nodeManager_startDefinitionWorkers(apx_nodeManager_t *self, int32_t numWorkers)
+{
+   if (self != 0)
+   {
+      return apx_definitionPipeline_start(&self->definitionPipeline, numWorkers);
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * stops the definition workers, definitions waiting in the queue are processed before this returns
+ */
+void apx_nodeManager_stopDefinitionWorkers(apx_nodeManager_t *self)
+{
+   if (self != 0)
+   {
+      apx_definitionPipeline_stop(&self->definitionPipeline);
+   }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // LOCAL FUNCTIONS
 //////////////////////////////////////////////////////////////////////////////
 
 /**
- * used to create new remote nodes on server side
+ * link stage of the definition pipeline, creates the remote nodes of a server side definition.
+ * job->owner is the fileManager that received the definition
  */
-static void apx_nodeManager_createNode(apx_nodeManager_t *self, const uint8_t *definitionBuf, int32_t definitionLen, struct apx_fileManager_tag *fileManager)
+static void apx_nodeManager_linkNodes(void *arg, apx_definitionJob_t *job)
 {
-   if( (self != 0) && (definitionBuf != 0) && (definitionLen > 0) )
+   apx_nodeManager_t *self = (apx_nodeManager_t*) arg;
+   apx_fileManager_t *fileManager = (apx_fileManager_t*) job->owner;
+   if( (self != 0) && (fileManager != 0) )
    {
       int32_t numNodes;
+      int32_t numLinked;
       int32_t i;
+      adt_ary_t linkedNodeInfos; //weak references to the nodeInfos created by this job
       char debugInfoStr[APX_DEBUG_INFO_MAX_LEN];
       debugInfoStr[0]=0;
       if (fileManager->debugInfo != 0)
       {
          snprintf(debugInfoStr, APX_DEBUG_INFO_MAX_LEN, " (%p)", fileManager->debugInfo);
       }
-      APX_LOG_INFO("[APX_NODE_MANAGER]%s Server processing APX definition, len=%d", debugInfoStr, (int) definitionLen);
+      APX_LOG_INFO("[APX_NODE_MANAGER]%s Server processing APX definition, len=%d", debugInfoStr, (int) job->definitionLen);
+      adt_ary_create(&linkedNodeInfos, (void(*)(void*)) 0);
 
-
-      apx_istream_reset(&self->apx_istream);
-      apx_istream_open(&self->apx_istream);
-      apx_istream_write(&self->apx_istream, definitionBuf, (uint32_t) definitionLen);
-      apx_istream_close(&self->apx_istream);
-      numNodes = apx_parser_getNumNodes(&self->parser);
+      numNodes = adt_ary_length(&job->preparedNodes);
       for (i=0;i<numNodes;i++)
       {
-         apx_nodeInfo_t *nodeInfo;
-         apx_node_t *apxNode = apx_parser_getNode(&self->parser, i);
-         assert(apxNode != 0);
-         apx_node_finalize(apxNode);
-         nodeInfo = apx_nodeInfo_new(apxNode);
-         if (nodeInfo != 0)
+         apx_preparedNode_t *preparedNode = (apx_preparedNode_t*) adt_ary_value(&job->preparedNodes, i);
+         apx_nodeInfo_t *nodeInfo = preparedNode->nodeInfo;
+         apx_node_t *apxNode = nodeInfo->node;
+         apx_nodeData_t *nodeData=0;
+         char fileName[RMF_MAX_FILE_NAME];
+         char *p;
+         int32_t inPortDataLen;
+         int32_t outPortDataLen;
+
+         nodeData = apx_nodeManager_getNodeData(self, apxNode->name);
+         if (nodeData == 0)
          {
-            apx_nodeData_t *nodeData=0;
-            char fileName[RMF_MAX_FILE_NAME];
-            char *p;
-            int32_t inPortDataLen;
-            int32_t outPortDataLen;
+            APX_LOG_ERROR("[APX_NODE_MANAGER] %s", "Failed to create nodeData object");
+            continue; //the pipeline deletes the prepared node
+         }
+         apx_nodeData_setFileManager(nodeData,fileManager);
+         apx_nodeInfo_setNodeData(nodeInfo, nodeData);
+         preparedNode->nodeInfo = (apx_nodeInfo_t*) 0; //ownership moves to nodeInfoMap
+         {
+            apx_nodeManagerShard_t *shard = apx_nodeManager_getShard(self, apxNode->name);
+            MUTEX_LOCK(shard->lock);
+            apx_nodeData_setNodeInfo(nodeData, nodeInfo);
+            adt_hash_set(&shard->nodeInfoMap, apxNode->name, 0, nodeInfo);
+            MUTEX_UNLOCK(shard->lock);
+         }
+         inPortDataLen = apx_nodeInfo_getInPortDataLen(nodeInfo);
+         outPortDataLen = apx_nodeInfo_getOutPortDataLen(nodeInfo);
 
+         //if node has output data, search a file called "<node_name>.out"
+         if (outPortDataLen > 0)
+         {
+            apx_file_t *outDataFile;
+            strcpy(fileName,apxNode->name);
+            p=fileName+strlen(fileName);
+            strcpy(p,".out");
 
-            nodeData = apx_nodeManager_getNodeData(self, apxNode->name);
-            if (nodeData == 0)
+            outDataFile = apx_fileManager_findRemoteFile(fileManager, fileName);
+            if (outDataFile != 0)
             {
-               APX_LOG_ERROR("[APX_NODE_MANAGER] %s", "Failed to create nodeData object");
-               return;
+               apx_nodeManager_openRemoteOutDataFile(self, fileManager, nodeData, outDataFile, debugInfoStr);
             }
-            apx_nodeData_setFileManager(nodeData,fileManager);
-            apx_nodeData_setNodeInfo(nodeData, nodeInfo);
-            apx_nodeInfo_setNodeData(nodeInfo, nodeData);
-            nodeInfo->isWeakRef_node = false; //nodeInfo is now the owner of the node pointer (will trigger deletion when apx_nodeInfo_delete is called)
-            adt_hash_set(&self->nodeInfoMap, apxNode->name, 0, nodeInfo);
-            inPortDataLen = apx_nodeInfo_getInPortDataLen(nodeInfo);
-            outPortDataLen = apx_nodeInfo_getOutPortDataLen(nodeInfo);
-            
-            //if node has output data, search a file called "<node_name>.out"
-            if (outPortDataLen > 0)
+            else if (job->cacheEntry == 0)
             {
-               apx_file_t *outDataFile;
-               strcpy(fileName,apxNode->name);
-               p=fileName+strlen(fileName);
-               strcpy(p,".out");
-               
-               outDataFile = apx_fileManager_findRemoteFile(fileManager, fileName);
-               if (outDataFile != 0)
-               {
-                  //check if length of file is the expected length of our outPortDataLen calculation
-                  if (outPortDataLen != (int32_t) outDataFile->fileInfo.length)
-                  {
-                     APX_LOG_ERROR("[APX_NODE_MANAGER] length of file %s is %d, expected length was %d\n", fileName, outDataFile->fileInfo.length, outPortDataLen);
-                  }
-                  else
-                  {
-                     if (outDataFile->nodeData==0)
-                     {
-                        outDataFile->nodeData=nodeData;
-                        //now create memory for the outPortData
-                        nodeData->outPortDataBuf = (uint8_t*) malloc(outPortDataLen);
-                        assert(nodeData->outPortDataBuf);
-                        nodeData->outPortDirtyFlags = (uint8_t*) malloc(outPortDataLen);
-                        assert(nodeData->outPortDirtyFlags);
-                        nodeData->outPortDataLen = outPortDataLen;
-                        APX_LOG_INFO("[APX_NODE_MANAGER]%s Server opening client file %s[%d,%d]", debugInfoStr, fileName, outDataFile->fileInfo.address, outDataFile->fileInfo.length);
-                        apx_nodeData_setNodeInfo(nodeData, nodeInfo);
-                        apx_fileManager_sendFileOpen(fileManager, outDataFile->fileInfo.address);
-                     }
-                  }
-               }
-               else
-               {
-                  APX_LOG_WARNING("[APX_NODE_MANAGER] '%s': no file found", fileName);
-               }
+               APX_LOG_WARNING("[APX_NODE_MANAGER] '%s': no file found", fileName);
             }
-            if (inPortDataLen > 0)
+            else
             {
-               //create local inPortData file
-               apx_file_t *inDataFile;
-               bool result;
-               strcpy(fileName,apxNode->name);
-               p=fileName+strlen(fileName);
-               strcpy(p,".in");
-               
-               nodeData->inPortDataBuf = (uint8_t*) malloc(inPortDataLen);
-               assert(nodeData->inPortDataBuf);
-               nodeData->inPortDirtyFlags = (uint8_t*) malloc(inPortDataLen);
-               assert(nodeData->inPortDirtyFlags);
-               result = apx_nodeManager_createInitData(apxNode, nodeData->inPortDataBuf, inPortDataLen);
-               if (result == false)
-               {
-                  APX_LOG_ERROR("[APX_NODE_MANAGER] Failed to create init data for node %s", apx_node_getName(apxNode));
-               }
-               nodeData->inPortDataLen = inPortDataLen;
-               inDataFile = apx_file_newLocalInPortDataFile(nodeData);
-               if (inDataFile != 0)
-               {
-                  apx_fileManager_attachLocalPortDataFile(fileManager, inDataFile);
-                  APX_LOG_INFO("[APX_NODE_MANAGER]%s Server created file %s[%d,%d]", debugInfoStr, fileName, inDataFile->fileInfo.address, inDataFile->fileInfo.length);
-               }
-               else
-               {
-                  APX_LOG_ERROR("[APX_NODE_MANAGER]%s Server failed to create local file '%s'", debugInfoStr, fileName);
-               }
+               //a cached definition is linked before the client has announced its other files, the file is opened when it is seen
             }
-            //router is set, attach the newly create nodeInfo to the router
-            if (self->router != 0)
+         }
+         if (inPortDataLen > 0)
+         {
+            //create local inPortData file
+            apx_file_t *inDataFile;
+            strcpy(fileName,apxNode->name);
+            p=fileName+strlen(fileName);
+            strcpy(p,".in");
+
+            //the init data was created by the pipeline, outside of any lock
+            assert(preparedNode->inPortInitData != 0);
+            nodeData->inPortDataBuf = preparedNode->inPortInitData;
+            preparedNode->inPortInitData = (uint8_t*) 0;
+            nodeData->inPortDirtyFlags = (uint8_t*) malloc(inPortDataLen);
+            assert(nodeData->inPortDirtyFlags);
+            memset(nodeData->inPortDirtyFlags, 0, inPortDataLen);
+            nodeData->inPortDataLen = inPortDataLen;
+            inDataFile = apx_file_newLocalInPortDataFile(nodeData);
+            if (inDataFile != 0)
             {
-               apx_router_attachNodeInfo(self->router, nodeInfo);
+               apx_fileManager_attachLocalPortDataFile(fileManager, inDataFile);
+               APX_LOG_INFO("[APX_NODE_MANAGER]%s Server created file %s[%d,%d]", debugInfoStr, fileName, inDataFile->fileInfo.address, inDataFile->fileInfo.length);
             }
-            //for all connected require ports copy data from the provide port into our newly create inDataFile buffer
-            apx_nodeInfo_copyInitDataFromProvideConnectors(nodeInfo);
+            else
+            {
+               APX_LOG_ERROR("[APX_NODE_MANAGER]%s Server failed to create local file '%s'", debugInfoStr, fileName);
+            }
+         }
+         adt_ary_push(&linkedNodeInfos, nodeInfo);
+      }
+      numLinked = adt_ary_length(&linkedNodeInfos);
+      if (numLinked > 0)
+      {
+         //linking is the only step shared by all connections, all nodes of the definition are attached in one go
+         MUTEX_LOCK(self->routerLock);
+         if (self->router != 0)
+         {
+            apx_router_attachNodeInfos(self->router, (apx_nodeInfo_t**) adt_ary_get(&linkedNodeInfos, 0), numLinked);
+         }
+         //for all connected require ports copy data from the provide port into our newly create inDataFile buffer
+         for (i=0;i<numLinked;i++)
+         {
+            apx_nodeInfo_copyInitDataFromProvideConnectors((apx_nodeInfo_t*) adt_ary_value(&linkedNodeInfos, i));
+         }
+         MUTEX_UNLOCK(self->routerLock);
+      }
+      adt_ary_destroy(&linkedNodeInfos);
+      //free the routing snapshots replaced by the new nodes once the data path has stopped using them
+      apx_rcu_synchronize();
+   }
+}
+
+/**
+ * allocates outPortData for a linked remote node and asks the client to open its .out file.
+ * Both the link stage and the arrival of the file info can get here, the shard lock makes sure only one of them opens the file
+ */
+static void apx_nodeManager_openRemoteOutDataFile(apx_nodeManager_t *self, apx_fileManager_t *fileManager, apx_nodeData_t *nodeData, apx_file_t *outDataFile, const char *debugInfoStr)
+{
+   apx_nodeManagerShard_t *shard = apx_nodeManager_getShard(self, nodeData->name);
+   bool isOpening = false;
+   MUTEX_LOCK(shard->lock);
+   if ( (nodeData->nodeInfo != 0) && (outDataFile->nodeData == 0) )
+   {
+      int32_t outPortDataLen = apx_nodeInfo_getOutPortDataLen(nodeData->nodeInfo);
+      //check if length of file is the expected length of our outPortDataLen calculation
+      if (outPortDataLen != (int32_t) outDataFile->fileInfo.length)
+      {
+         APX_LOG_ERROR("[APX_NODE_MANAGER] length of file %s is %d, expected length was %d\n", outDataFile->fileInfo.name, outDataFile->fileInfo.length, outPortDataLen);
+      }
+      else
+      {
+         outDataFile->nodeData=nodeData;
+         //a resumed node keeps the outPortData it had before its connection was lost
+         if (nodeData->outPortDataBuf == 0)
+         {
+            //now create memory for the outPortData
+            nodeData->outPortDataBuf = (uint8_t*) malloc(outPortDataLen);
+            assert(nodeData->outPortDataBuf);
+            nodeData->outPortDirtyFlags = (uint8_t*) malloc(outPortDataLen);
+            assert(nodeData->outPortDirtyFlags);
+            nodeData->outPortDataLen = outPortDataLen;
          }
+         isOpening = true;
       }
-      apx_parser_clearNodes(&self->parser);
    }
+   MUTEX_UNLOCK(shard->lock);
+   if (isOpening == true)
+   {
+      APX_LOG_INFO("[APX_NODE_MANAGER]%s Server opening client file %s[%d,%d]", debugInfoStr, outDataFile->fileInfo.name, outDataFile->fileInfo.address, outDataFile->fileInfo.length);
+      apx_fileManager_sendFileOpen(fileManager, outDataFile->fileInfo.address);
+   }
+}
+
+/**
+ * returns the shard where the node with the given name is stored (FNV-1a hash of name)
+ */
+static apx_nodeManagerShard_t *apx_nodeManager_getShard(apx_nodeManager_t *self, const char *name)
+{
+   uint32_t hash = 2166136261u;
+   const uint8_t *p = (const uint8_t*) name;
+   while (*p != 0)
+   {
+      hash ^= *p++;
+      hash *= 16777619u;
+   }
+   return &self->shards[hash & (APX_NODE_MANAGER_NUM_SHARDS-1)];
 }
 
 /**
  * searches both local and remote nodeData maps using name as key
  */
-static apx_nodeData_t *apx_nodeManager_getNodeData(const apx_nodeManager_t *self, const char *name)
+static apx_nodeData_t *apx_nodeManager_getNodeData(apx_nodeManager_t *self, const char *name)
 {
    if ( (self != 0) && (name != 0) )
    {
       void** ppVal;
-      ppVal = adt_hash_get(&self->remoteNodeDataMap, name, 0);
+      apx_nodeData_t *nodeData = (apx_nodeData_t*) 0;
+      apx_nodeManagerShard_t *shard = apx_nodeManager_getShard(self, name);
+      MUTEX_LOCK(shard->lock);
+      ppVal = adt_hash_get(&shard->remoteNodeDataMap, name, 0);
       if (ppVal != 0)
       {
-         return (apx_nodeData_t*) *ppVal;
+         nodeData = (apx_nodeData_t*) *ppVal;
       }
-      ppVal = adt_hash_get(&self->localNodeDataMap, name, 0);
-      if (ppVal != 0)
+      MUTEX_UNLOCK(shard->lock);
+      if (nodeData == 0)
       {
-         return (apx_nodeData_t*) *ppVal;
+         MUTEX_LOCK(self->lock);
+         ppVal = adt_hash_get(&self->localNodeDataMap, name, 0);
+         if (ppVal != 0)
+         {
+            nodeData = (apx_nodeData_t*) *ppVal;
+         }
+         MUTEX_UNLOCK(self->lock);
       }
+      return nodeData;
    }
    return (apx_nodeData_t*) 0;
 }
 
+/**
+ * adds nodeData to the remoteNodeDataMap of its shard.
+ * returns false if a node with the same name already exists, nodeData is not added in that case
+ */
+static bool apx_nodeManager_addRemoteNodeData(apx_nodeManager_t *self, apx_nodeData_t *nodeData)
+{
+   bool retval = false;
+   apx_nodeManagerShard_t *shard = apx_nodeManager_getShard(self, nodeData->name);
+   MUTEX_LOCK(shard->lock);
+   if (adt_hash_get(&shard->remoteNodeDataMap, nodeData->name, 0) == 0)
+   {
+      adt_hash_set(&shard->remoteNodeDataMap, nodeData->name, 0, nodeData);
+      retval = true;
+   }
+   MUTEX_UNLOCK(shard->lock);
+   return retval;
+}
+
 /**
  * adds nodeData to localNodeDataMap
  */
@@ -619,23 +962,76 @@ static void apx_nodeManager_setLocalNodeData(apx_nodeManager_t *self, apx_nodeDa
 {
    if ( (self != 0) && (nodeData != 0) )
    {
+      MUTEX_LOCK(self->lock);
       adt_hash_set(&self->localNodeDataMap, nodeData->name, 0, nodeData);
+      MUTEX_UNLOCK(self->lock);
+   }
+}
+
+static void apx_nodeManager_initWriteBatch(apx_nodeManager_writeBatch_t *batch)
+{
+   batch->writes = &batch->localWrites[0];
+   batch->numWrites = 0;
+   batch->capacity = APX_NODE_MANAGER_WRITE_BATCH_LEN;
+}
+
+static void apx_nodeManager_destroyWriteBatch(apx_nodeManager_writeBatch_t *batch)
+{
+   assert(batch->numWrites == 0);
+   if (batch->writes != &batch->localWrites[0])
+   {
+      free(batch->writes);
+   }
+}
+
+/**
+ * returns false when batch must be sent before numWrites more writes fit. An empty batch grows instead
+ */
+static bool apx_nodeManager_reserveWrites(apx_nodeManager_writeBatch_t *batch, int32_t numWrites)
+{
+   if ( (batch->numWrites + numWrites) <= batch->capacity)
+   {
+      return true;
+   }
+   else if (batch->numWrites > 0)
+   {
+      return false;
+   }
+   else
+   {
+      apx_nodeManager_pendingWrite_t *writes = (apx_nodeManager_pendingWrite_t*) malloc(numWrites*sizeof(apx_nodeManager_pendingWrite_t));
+      if (writes != 0)
+      {
+         if (batch->writes != &batch->localWrites[0])
+         {
+            free(batch->writes);
+         }
+         batch->writes = writes;
+         batch->capacity = numWrites;
+      }
+      else
+      {
+         APX_LOG_ERROR("[APX_NODE_MANAGER] out of memory, only %d of %d routed writes are sent", (int) batch->capacity, (int) numWrites);
+      }
+      return true;
    }
 }
 
 /**
- * applies the portTriggerFunction
+ * reads the port data once into a shared payload and adds a write of it to each connected require port to batch.
+ * Called inside an rcu read-side section, it does not block. The writes are sent by apx_nodeManager_sendWrites after the section has ended
  */
-static void apx_nodeManager_executePortTriggerFunction(const apx_dataTriggerFunction_t *triggerFunction, const apx_file_t *file)
+static void apx_nodeManager_collectPortWrites(apx_nodeManager_writeBatch_t *batch, const apx_dataTriggerFunction_t *triggerFunction, const apx_file_t *file)
 {
    if( (triggerFunction != 0) && (file != 0) )
    {
       if (file->fileType == APX_OUTDATA_FILE)
       {
-         uint8_t *dataBuf = (uint8_t*) malloc(triggerFunction->dataLength);
-         if (dataBuf != 0)
+         //the data is read once into a shared payload, each destination queue holds a reference to it instead of its own copy
+         apx_sharedPayload_t *payload = apx_sharedPayload_new(triggerFunction->dataLength);
+         if (payload != 0)
          {
-            int8_t result = apx_nodeData_readOutPortData(file->nodeData, dataBuf, triggerFunction->srcOffset, triggerFunction->dataLength);
+            int8_t result = apx_nodeData_readOutPortData(file->nodeData, payload->data, triggerFunction->srcOffset, triggerFunction->dataLength);
             if (result == 0)
             {
                int32_t i;
@@ -649,17 +1045,63 @@ static void apx_nodeManager_executePortTriggerFunction(const apx_dataTriggerFunc
                      apx_nodeData_t *targetNodeData = targetNodeInfo->nodeData;
                      if( (targetNodeData->inPortDataFile != 0) && (targetNodeData->fileManager != 0) )
                      {
-                        apx_fileManager_triggerFileWriteCmdEvent(targetNodeData->fileManager, targetNodeData->inPortDataFile, dataBuf, writeInfo->destOffset, triggerFunction->dataLength);
+                        //the reference keeps the destination alive once the section has ended, it's refused while the destination is detached
+                        if ( (batch->numWrites < batch->capacity) && (apx_fileManager_tryRef(targetNodeData->fileManager) == true) )
+                        {
+                           apx_nodeManager_pendingWrite_t *pendingWrite = &batch->writes[batch->numWrites++];
+                           pendingWrite->fileManager = targetNodeData->fileManager;
+                           pendingWrite->file = targetNodeData->inPortDataFile;
+                           pendingWrite->payload = payload;
+                           pendingWrite->offset = writeInfo->destOffset;
+                           pendingWrite->isQueued = writeInfo->isQueued;
+                           apx_sharedPayload_ref(payload);
+                        }
+                     }
+                     else if (targetNodeData->inPortResumeFlags != 0)
+                     {
+                        //the client of a stale or resuming node receives the value as part of its resume delta
+                        (void) apx_nodeData_writeInPortDataResume(targetNodeData, payload->data, writeInfo->destOffset, payload->dataLen);
                      }
                   }
                }
             }
-            free(dataBuf);
+            apx_sharedPayload_unref(payload);
          }
       }
    }
 }
 
+/**
+ * sends the writes collected in batch and releases the references they hold. Must be called outside of an rcu read-side section,
+ * the direct write and posting to a destination queue under backpressure may block
+ */
+static void apx_nodeManager_sendWrites(apx_nodeManager_writeBatch_t *batch)
+{
+   int32_t i;
+   for (i=0; i<batch->numWrites; i++)
+   {
+      apx_nodeManager_pendingWrite_t *pendingWrite = &batch->writes[i];
+      apx_fileManager_t *fileManager = pendingWrite->fileManager;
+      apx_sharedPayload_t *payload = pendingWrite->payload;
+      if (apx_fileManager_directWriteCmd(fileManager, pendingWrite->file, payload->data, pendingWrite->offset, payload->dataLen) == 0)
+      {
+         //already written by this thread, the worker of the destination transmits it
+      }
+      else if ( (pendingWrite->isQueued == false) && (apx_fileManager_isConflationEnabled(fileManager) == true) )
+      {
+         //only the latest value matters, at most one update per port is outstanding in the destination queue
+         apx_fileManager_triggerLatestWriteCmdEvent(fileManager, pendingWrite->file, payload->data, pendingWrite->offset, payload->dataLen);
+      }
+      else
+      {
+         apx_fileManager_triggerSharedWriteCmdEvent(fileManager, pendingWrite->file, payload, pendingWrite->offset, pendingWrite->isQueued);
+      }
+      apx_sharedPayload_unref(payload);
+      apx_fileManager_unref(fileManager);
+   }
+   batch->numWrites = 0;
+}
+
 static void apx_nodeManager_attachLocalNodeToFileManager(apx_nodeData_t *nodeData, apx_fileManager_t *fileManager)
 {
    if (nodeData->definitionDataLen > 0)
@@ -679,52 +1121,216 @@ static void apx_nodeManager_attachLocalNodeToFileManager(apx_nodeData_t *nodeDat
    }
 }
 
-static void apx_nodeManager_removeRemoteNodeData(apx_nodeManager_t *self, apx_nodeData_t *nodeData)
+/**
+ * the caller must hold shard->lock
+ */
+static void apx_nodeManager_removeRemoteNodeData(apx_nodeManagerShard_t *shard, apx_nodeData_t *nodeData)
 {
-   if ( (self != 0) && (nodeData != 0) )
+   if ( (shard != 0) && (nodeData != 0) )
    {
-      void **tmp = adt_hash_remove(&self->remoteNodeDataMap, nodeData->name, 0);
+      void **tmp = adt_hash_remove(&shard->remoteNodeDataMap, nodeData->name, 0);
       assert(tmp != 0);
    }
 }
 
-static void apx_nodeManager_removeNodeInfo(apx_nodeManager_t *self, apx_nodeInfo_t *nodeInfo)
+/**
+ * the caller must hold shard->lock
+ */
+static void apx_nodeManager_removeNodeInfo(apx_nodeManagerShard_t *shard, apx_nodeInfo_t *nodeInfo)
 {
-   if ( (self != 0) && (nodeInfo != 0) )
+   if ( (shard != 0) && (nodeInfo != 0) )
    {
-      void **tmp = adt_hash_remove(&self->nodeInfoMap, nodeInfo->node->name, 0);
+      void **tmp = adt_hash_remove(&shard->nodeInfoMap, nodeInfo->node->name, 0);
       assert(tmp != 0);
    }
 }
 
-static bool apx_nodeManager_createInitData(apx_node_t *node, uint8_t *buf, int32_t bufLen)
+/**
+ * detaches nodes that have been removed from the shard maps from the router and retires them together with their nodeData
+ */
+static void apx_nodeManager_retireNodes(apx_nodeManager_t *self, adt_ary_t *nodeInfoList)
+{
+   int32_t i;
+   int32_t end = adt_ary_length(nodeInfoList);
+   if ( (self->router != 0) && (end > 0) )
+   {
+      MUTEX_LOCK(self->routerLock);
+      apx_router_detachNodeInfos(self->router, (apx_nodeInfo_t**) adt_ary_get(nodeInfoList, 0), end);
+      MUTEX_UNLOCK(self->routerLock);
+   }
+   for (i=0; i<end; i++)
+   {
+      apx_nodeInfo_t *nodeInfo = (apx_nodeInfo_t*) *adt_ary_get(nodeInfoList, i);
+      //other connections may still be writing to this node through trigger functions they loaded before the detach
+      apx_rcu_retire(nodeInfo->nodeData, apx_nodeData_vdelete);
+      apx_rcu_retire(nodeInfo, apx_nodeInfo_vdelete);
+   }
+}
+
+/**
+ * marks a linked remote node as stale, from now on writes to its require ports are collected for the resume delta.
+ * Returns false when the node cannot be kept, it must then be deleted. The caller must hold the shard lock
+ */
+static bool apx_nodeManager_parkNode(apx_nodeData_t *nodeData, uint32_t now)
 {
-   if ( (node != 0) && (buf != 0) && (bufLen > 0))
+   apx_nodeInfo_t *nodeInfo = nodeData->nodeInfo;
+   assert(nodeInfo != 0);
+   if ( (nodeData->inPortDataBuf != 0) && (nodeData->inPortDataLen > 0) )
    {
-      uint8_t *pNext = buf;
-      uint8_t *pEnd = buf+bufLen;
+      int32_t numRequirePorts = apx_nodeInfo_getNumRequirePorts(nodeInfo);
       int32_t i;
-      int32_t numRequirePorts;
-      adt_bytearray_t *portData;
-      portData = adt_bytearray_new(0);
-      numRequirePorts = apx_node_getNumRequirePorts(node);
-      for(i=0; i<numRequirePorts; i++)
-      {
-         int32_t packLen;
-         int32_t dataLen;
-         apx_port_t *port = apx_node_getRequirePort(node, i);
-         assert(port != 0);
-         packLen = apx_port_getPackLen(port);
-         apx_node_fillPortInitData(node, port, portData);
-         dataLen = adt_bytearray_length(portData);
-         assert(packLen == dataLen);
-         memcpy(pNext, adt_bytearray_data(portData), packLen);
-         pNext+=packLen;
-         assert(pNext<=pEnd);
-      }
-      assert(pNext==pEnd);
-      adt_bytearray_delete(portData);
-      return true;
+      uint8_t *resumeFlags = (uint8_t*) 0;
+      if (nodeData->inPortResumeFlags == 0)
+      {
+         resumeFlags = (uint8_t*) calloc(nodeData->inPortDataLen, 1);
+         if (resumeFlags == 0)
+         {
+            return false;
+         }
+      }
+      apx_nodeData_lockInPortData(nodeData);
+      if (resumeFlags != 0)
+      {
+         nodeData->inPortResumeFlags = resumeFlags;
+      }
+      if (nodeData->inPortDirtyFlags != 0)
+      {
+         //latest-value updates still waiting in the queue of the lost connection become part of the resume delta
+         for (i=0; i<numRequirePorts; i++)
+         {
+            apx_portDataMapEntry_t *entry = apx_portDataMap_getEntry(nodeInfo->inDataMap, i);
+            if ( (entry != 0) && (nodeData->inPortDirtyFlags[entry->offset] != 0) )
+            {
+               memset(&nodeData->inPortResumeFlags[entry->offset], 1, entry->length);
+               nodeData->inPortDirtyFlags[entry->offset] = 0;
+            }
+         }
+      }
+      apx_nodeData_unlockInPortData(nodeData);
+   }
+   nodeData->isStale = true;
+   nodeData->staleSinceMs = now;
+   //the files belong to the lost connection
+   apx_nodeData_setInPortDataFile(nodeData, (apx_file_t*) 0);
+   apx_nodeData_setOutPortDataFile(nodeData, (apx_file_t*) 0);
+   apx_nodeData_setFileManager(nodeData, (apx_fileManager_t*) 0);
+   return true;
+}
+
+/**
+ * Resumes the session of the stale node called name when definitionFile has the digest of the definition the node was created from.
+ * Returns 0 when the session was resumed, 1 when the stale node could not be resumed and has been deleted and -1 when no stale node has that name
+ */
+static int8_t apx_nodeManager_resumeNode(apx_nodeManager_t *self, apx_fileManager_t *fileManager, apx_file_t *definitionFile, const char *name)
+{
+   apx_nodeManagerShard_t *shard = apx_nodeManager_getShard(self, name);
+   apx_nodeData_t *nodeData = (apx_nodeData_t*) 0;
+   adt_ary_t staleNodeInfo;
+   int8_t retval = -1;
+   void **ppVal;
+   adt_ary_create(&staleNodeInfo, NULL);
+   MUTEX_LOCK(shard->lock);
+   ppVal = adt_hash_get(&shard->remoteNodeDataMap, name, 0);
+   if (ppVal != 0)
+   {
+      nodeData = (apx_nodeData_t*) *ppVal;
+      if (nodeData->isStale == true)
+      {
+         bool isResumable = false;
+         if ( (definitionFile->fileInfo.digestType == RMF_DIGEST_TYPE_SHA256) &&
+              (definitionFile->fileInfo.length == nodeData->definitionDataLen) &&
+              ( (uint32_t) (apx_nodeManager_getTimeMs() - nodeData->staleSinceMs) < self->gracePeriodMs) )
+         {
+            uint8_t digest[SHA256_DIGEST_SIZE];
+            sha256_calc(nodeData->definitionDataBuf, nodeData->definitionDataLen, digest);
+            isResumable = (memcmp(digest, definitionFile->fileInfo.digestData, SHA256_DIGEST_SIZE) == 0)? true : false;
+         }
+         if (isResumable == true)
+         {
+            nodeData->isStale = false;
+            apx_nodeData_setFileManager(nodeData, fileManager);
+            definitionFile->nodeData = nodeData;
+            retval = 0;
+         }
+         else
+         {
+            adt_ary_push(&staleNodeInfo, nodeData->nodeInfo);
+            apx_nodeManager_removeRemoteNodeData(shard, nodeData);
+            apx_nodeManager_removeNodeInfo(shard, nodeData->nodeInfo);
+            retval = 1;
+         }
+      }
+   }
+   MUTEX_UNLOCK(shard->lock);
+   if (retval == 0)
+   {
+      apx_nodeManager_openResumedFiles(self, fileManager, nodeData);
+   }
+   else if (retval > 0)
+   {
+      APX_LOG_INFO("[APX_NODE_MANAGER] definition of %s has changed, deleting stale node", name);
+      apx_nodeManager_retireNodes(self, &staleNodeInfo);
+      apx_rcu_synchronize();
+   }
+   else
+   {
+      //no stale node
+   }
+   adt_ary_destroy(&staleNodeInfo);
+   return retval;
+}
+
+/**
+ * binds the files of a resumed client to its stale node. The definition file is never opened, the node keeps its routes
+ */
+static void apx_nodeManager_openResumedFiles(apx_nodeManager_t *self, apx_fileManager_t *fileManager, apx_nodeData_t *nodeData)
+{
+   char fileName[RMF_MAX_FILE_NAME];
+   char *p;
+   APX_LOG_INFO("[APX_NODE_MANAGER] resuming session of %s", nodeData->name);
+   if (apx_nodeInfo_getOutPortDataLen(nodeData->nodeInfo) > 0)
+   {
+      apx_file_t *outDataFile;
+      if (nodeData->outPortDataBuf != 0)
+      {
+         //without the copy all values the client sends again are routed
+         (void) apx_nodeData_beginOutPortResume(nodeData);
+      }
+      strcpy(fileName, nodeData->name);
+      p=fileName+strlen(fileName);
+      strcpy(p,".out");
+      outDataFile = apx_fileManager_findRemoteFile(fileManager, fileName);
+      if (outDataFile != 0)
+      {
+         apx_nodeManager_openRemoteOutDataFile(self, fileManager, nodeData, outDataFile, "");
+      }
+      else
+      {
+         //the file is opened when the client announces it
+      }
    }
-   return false;
+   if (nodeData->inPortDataLen > 0)
+   {
+      apx_file_t *inDataFile = apx_file_newLocalInPortDataFile(nodeData);
+      if (inDataFile != 0)
+      {
+         //the client only receives the resume delta when it opens the file
+         apx_fileManager_attachLocalPortDataFile(fileManager, inDataFile);
+      }
+      else
+      {
+         APX_LOG_ERROR("[APX_NODE_MANAGER] failed to create inPortData file of %s", nodeData->name);
+      }
+   }
+}
+
+static uint32_t apx_nodeManager_getTimeMs(void)
+{
+#ifdef _WIN32
+   return (uint32_t) GetTickCount();
+#else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint32_t) ( (ts.tv_sec * 1000u) + (ts.tv_nsec / 1000000u) );
+#endif
 }
@@ -0,0 +1,421 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <errno.h>
+#include <malloc.h>
+#include <assert.h>
+#include <string.h>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "osmacro.h"
+#include "adt_hash.h"
+#include "adt_bytearray.h"
+#include "apx_once.h"
+#include "apx_nodeTemplate.h"
+#include "apx_logging.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#define APX_NODE_TEMPLATE_KEY_LEN (APX_NODE_TEMPLATE_DIGEST_SIZE*2)
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static apx_nodeTemplate_t *apx_nodeTemplate_new(apx_node_t *node, const uint8_t *digest);
+static void apx_nodeTemplate_delete(apx_nodeTemplate_t *self);
+static bool apx_nodeTemplate_createInitData(apx_node_t *node, uint8_t *buf, int32_t bufLen);
+static void apx_nodeTemplate_calcDigest(const apx_node_t *node, uint8_t *digest);
+static void apx_nodeTemplate_hashString(sha256_ctx_t *ctx, const char *str);
+static void apx_nodeTemplate_hashPorts(sha256_ctx_t *ctx, const adt_ary_t *portList, uint8_t portType);
+static void apx_nodeTemplate_makeKey(const uint8_t *digest, char *key);
+static void apx_nodeTemplate_initTable(void);
+static void apx_nodeTemplate_initTableOnce(void);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+static apx_once_t m_initOnce = APX_ONCE_INIT;
+static MUTEX_T m_mutex; //protects m_templateMap and the refCount of every template
+static adt_hash_t m_templateMap; //key is the digest in hex, weak references to apx_nodeTemplate_t
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+/**
+ * returns the template for node with one reference held by the caller, or NULL on failure.
+ * Takes ownership of node: it becomes the node of a new template, or is deleted when a template for an identical node already exists.
+ */
+apx_nodeTemplate_t *apx_nodeTemplate_intern(apx_node_t *node)
+{
+   uint8_t digest[APX_NODE_TEMPLATE_DIGEST_SIZE];
+   char key[APX_NODE_TEMPLATE_KEY_LEN+1];
+   apx_nodeTemplate_t *self;
+   apx_nodeTemplate_t *existing = (apx_nodeTemplate_t*) 0;
+   void **ptr;
+   if (node == 0)
+   {
+      errno = EINVAL;
+      return (apx_nodeTemplate_t*) 0;
+   }
+   if (node->nodeTemplate != 0)
+   {
+      self = node->nodeTemplate;
+      apx_nodeTemplate_acquire(self);
+      apx_node_delete(node);
+      return self;
+   }
+   apx_node_finalize(node);
+   apx_nodeTemplate_calcDigest(node, digest);
+   apx_nodeTemplate_makeKey(digest, key);
+   apx_nodeTemplate_initTable();
+   MUTEX_LOCK(m_mutex);
+   ptr = adt_hash_get(&m_templateMap, key, APX_NODE_TEMPLATE_KEY_LEN);
+   if (ptr != 0)
+   {
+      existing = (apx_nodeTemplate_t*) *ptr;
+      existing->refCount++;
+   }
+   MUTEX_UNLOCK(m_mutex);
+   if (existing != 0)
+   {
+      apx_node_delete(node);
+      return existing;
+   }
+   //data maps and init data are created outside the lock, another thread may add the same template in the meantime
+   self = apx_nodeTemplate_new(node, digest);
+   if (self == 0)
+   {
+      apx_node_delete(node);
+      return (apx_nodeTemplate_t*) 0;
+   }
+   MUTEX_LOCK(m_mutex);
+   ptr = adt_hash_get(&m_templateMap, key, APX_NODE_TEMPLATE_KEY_LEN);
+   if (ptr != 0)
+   {
+      existing = (apx_nodeTemplate_t*) *ptr;
+      existing->refCount++;
+   }
+   else
+   {
+      adt_hash_set(&m_templateMap, key, APX_NODE_TEMPLATE_KEY_LEN, self);
+   }
+   MUTEX_UNLOCK(m_mutex);
+   if (existing != 0)
+   {
+      apx_nodeTemplate_delete(self);
+      return existing;
+   }
+   return self;
+}
+
+/**
+ * returns a node with the name of node that shares its ports with all other nodes having the same data types and ports.
+ * Takes ownership of node, returns NULL on failure.
+ */
+apx_node_t *apx_nodeTemplate_shareNode(apx_node_t *node)
+{
+   apx_nodeTemplate_t *self;
+   apx_node_t *sharedNode;
+   char *name;
+   if (node == 0)
+   {
+      errno = EINVAL;
+      return (apx_node_t*) 0;
+   }
+   if (node->nodeTemplate != 0)
+   {
+      return node;
+   }
+   //the name is all that is left of node once it has been interned, the template node has no name
+   name = node->name;
+   node->name = (char*) 0;
+   self = apx_nodeTemplate_intern(node);
+   if (self == 0)
+   {
+      free(name);
+      return (apx_node_t*) 0;
+   }
+   sharedNode = apx_nodeTemplate_createNode(self, name);
+   apx_nodeTemplate_release(self);
+   free(name);
+   return sharedNode;
+}
+
+/**
+ * creates a finalized node named name whose ports belong to the template. The node holds a reference to the template until it is deleted
+ */
+apx_node_t *apx_nodeTemplate_createNode(apx_nodeTemplate_t *self, const char *name)
+{
+   apx_node_t *node;
+   int32_t numPorts;
+   int32_t i;
+   if (self == 0)
+   {
+      errno = EINVAL;
+      return (apx_node_t*) 0;
+   }
+   node = apx_node_new(name);
+   if (node == 0)
+   {
+      return (apx_node_t*) 0;
+   }
+   adt_ary_destructorEnable(&node->requirePortList, 0);
+   adt_ary_destructorEnable(&node->providePortList, 0);
+   numPorts = adt_ary_length(&self->node->requirePortList);
+   for (i=0; i<numPorts; i++)
+   {
+      adt_ary_push(&node->requirePortList, adt_ary_value(&self->node->requirePortList, i));
+   }
+   numPorts = adt_ary_length(&self->node->providePortList);
+   for (i=0; i<numPorts; i++)
+   {
+      adt_ary_push(&node->providePortList, adt_ary_value(&self->node->providePortList, i));
+   }
+   node->isFinalized = true;
+   apx_nodeTemplate_acquire(self);
+   node->nodeTemplate = self;
+   return node;
+}
+
+void apx_nodeTemplate_acquire(apx_nodeTemplate_t *self)
+{
+   if (self != 0)
+   {
+      MUTEX_LOCK(m_mutex);
+      assert(self->refCount > 0);
+      self->refCount++;
+      MUTEX_UNLOCK(m_mutex);
+   }
+}
+
+/**
+ * releases one reference, the template is removed from the table and deleted when it was the last one
+ */
+void apx_nodeTemplate_release(apx_nodeTemplate_t *self)
+{
+   if (self != 0)
+   {
+      bool isUnused = false;
+      MUTEX_LOCK(m_mutex);
+      assert(self->refCount > 0);
+      self->refCount--;
+      if (self->refCount == 0)
+      {
+         char key[APX_NODE_TEMPLATE_KEY_LEN+1];
+         apx_nodeTemplate_makeKey(self->digest, key);
+         (void) adt_hash_remove(&m_templateMap, key, APX_NODE_TEMPLATE_KEY_LEN);
+         isUnused = true;
+      }
+      MUTEX_UNLOCK(m_mutex);
+      if (isUnused == true)
+      {
+         apx_nodeTemplate_delete(self);
+      }
+   }
+}
+
+/**
+ * returns number of templates in use
+ */
+int32_t apx_nodeTemplate_getNumTemplates(void)
+{
+   int32_t retval;
+   apx_nodeTemplate_initTable();
+   MUTEX_LOCK(m_mutex);
+   retval = (int32_t) adt_hash_length(&m_templateMap);
+   MUTEX_UNLOCK(m_mutex);
+   return retval;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+/**
+ * creates a template owning the finalized node, node is not deleted on failure
+ */
+static apx_nodeTemplate_t *apx_nodeTemplate_new(apx_node_t *node, const uint8_t *digest)
+{
+   apx_nodeTemplate_t *self = (apx_nodeTemplate_t*) malloc(sizeof(apx_nodeTemplate_t));
+   if (self == 0)
+   {
+      errno = ENOMEM;
+      return (apx_nodeTemplate_t*) 0;
+   }
+   apx_portDataMap_create(&self->inDataMap);
+   apx_portDataMap_create(&self->outDataMap);
+   apx_portDataMap_build(&self->inDataMap, node, APX_REQUIRE_PORT);
+   apx_portDataMap_build(&self->outDataMap, node, APX_PROVIDE_PORT);
+   self->inPortDataLen = apx_portDataMap_getDataLen(&self->inDataMap);
+   self->outPortDataLen = apx_portDataMap_getDataLen(&self->outDataMap);
+   if (self->inPortDataLen < 0)
+   {
+      APX_LOG_ERROR("[APX_NODE_TEMPLATE] %s", "apx_portDataMap_getDataLen for requirePortDataMap return negative result");
+      self->inPortDataLen = 0;
+   }
+   if (self->outPortDataLen < 0)
+   {
+      APX_LOG_ERROR("[APX_NODE_TEMPLATE] %s", "apx_portDataMap_getDataLen for providePortDataMap return negative result");
+      self->outPortDataLen = 0;
+   }
+   self->inPortInitData = (uint8_t*) 0;
+   if (self->inPortDataLen > 0)
+   {
+      self->inPortInitData = (uint8_t*) malloc(self->inPortDataLen);
+      if (self->inPortInitData == 0)
+      {
+         APX_LOG_ERROR("[APX_NODE_TEMPLATE] out of memory when attempting to create init data of length %d", (int) self->inPortDataLen);
+         apx_portDataMap_destroy(&self->inDataMap);
+         apx_portDataMap_destroy(&self->outDataMap);
+         free(self);
+         errno = ENOMEM;
+         return (apx_nodeTemplate_t*) 0;
+      }
+      if (apx_nodeTemplate_createInitData(node, self->inPortInitData, self->inPortDataLen) == false)
+      {
+         APX_LOG_ERROR("[APX_NODE_TEMPLATE] %s", "Failed to create init data");
+      }
+   }
+   memcpy(self->digest, digest, APX_NODE_TEMPLATE_DIGEST_SIZE);
+   self->node = node;
+   self->refCount = 1;
+   return self;
+}
+
+static void apx_nodeTemplate_delete(apx_nodeTemplate_t *self)
+{
+   if (self != 0)
+   {
+      apx_portDataMap_destroy(&self->inDataMap);
+      apx_portDataMap_destroy(&self->outDataMap);
+      if (self->inPortInitData != 0)
+      {
+         free(self->inPortInitData);
+      }
+      apx_node_delete(self->node);
+      free(self);
+   }
+}
+
+static bool apx_nodeTemplate_createInitData(apx_node_t *node, uint8_t *buf, int32_t bufLen)
+{
+   if ( (node != 0) && (buf != 0) && (bufLen > 0))
+   {
+      uint8_t *pNext = buf;
+      uint8_t *pEnd = buf+bufLen;
+      int32_t i;
+      int32_t numRequirePorts;
+      adt_bytearray_t *portData;
+      portData = adt_bytearray_new(0);
+      numRequirePorts = apx_node_getNumRequirePorts(node);
+      for(i=0; i<numRequirePorts; i++)
+      {
+         int32_t packLen;
+         int32_t dataLen;
+         apx_port_t *port = apx_node_getRequirePort(node, i);
+         assert(port != 0);
+         packLen = apx_port_getPackLen(port);
+         apx_node_fillPortInitData(node, port, portData);
+         dataLen = adt_bytearray_length(portData);
+         assert(packLen == dataLen);
+         memcpy(pNext, adt_bytearray_data(portData), packLen);
+         pNext+=packLen;
+         assert(pNext<=pEnd);
+      }
+      assert(pNext==pEnd);
+      adt_bytearray_delete(portData);
+      return true;
+   }
+   return false;
+}
+
+/**
+ * digest of everything in node except its name: data types and ports in the order they were declared
+ */
+static void apx_nodeTemplate_calcDigest(const apx_node_t *node, uint8_t *digest)
+{
+   sha256_ctx_t ctx;
+   int32_t numDataTypes;
+   int32_t i;
+   sha256_init(&ctx);
+   numDataTypes = adt_ary_length(&node->datatypeList);
+   for (i=0; i<numDataTypes; i++)
+   {
+      const apx_datatype_t *datatype = (const apx_datatype_t*) adt_ary_value(&node->datatypeList, i);
+      sha256_update(&ctx, (const uint8_t*) "T", 1u);
+      apx_nodeTemplate_hashString(&ctx, datatype->name);
+      apx_nodeTemplate_hashString(&ctx, datatype->dsg);
+      apx_nodeTemplate_hashString(&ctx, datatype->attr);
+   }
+   apx_nodeTemplate_hashPorts(&ctx, &node->requirePortList, APX_REQUIRE_PORT);
+   apx_nodeTemplate_hashPorts(&ctx, &node->providePortList, APX_PROVIDE_PORT);
+   sha256_final(&ctx, digest);
+}
+
+/**
+ * adds str including its null terminator. A NULL pointer is added as a single 0xFF byte, which no string starts with
+ */
+static void apx_nodeTemplate_hashString(sha256_ctx_t *ctx, const char *str)
+{
+   if (str != 0)
+   {
+      sha256_update(ctx, (const uint8_t*) str, (uint32_t) strlen(str)+1u);
+   }
+   else
+   {
+      static const uint8_t nullMarker = 0xFF;
+      sha256_update(ctx, &nullMarker, 1u);
+   }
+}
+
+static void apx_nodeTemplate_hashPorts(sha256_ctx_t *ctx, const adt_ary_t *portList, uint8_t portType)
+{
+   int32_t numPorts = adt_ary_length(portList);
+   int32_t i;
+   const uint8_t portChar = (portType == APX_REQUIRE_PORT)? (uint8_t) 'R' : (uint8_t) 'P';
+   for (i=0; i<numPorts; i++)
+   {
+      const apx_port_t *port = (const apx_port_t*) adt_ary_value(portList, i);
+      sha256_update(ctx, &portChar, 1u);
+      apx_nodeTemplate_hashString(ctx, port->name);
+      apx_nodeTemplate_hashString(ctx, port->dataSignature);
+      apx_nodeTemplate_hashString(ctx, (port->portAttributes != 0)? port->portAttributes->rawValue : (const char*) 0);
+   }
+}
+
+static void apx_nodeTemplate_makeKey(const uint8_t *digest, char *key)
+{
+   static const char hexDigits[] = "0123456789abcdef";
+   uint32_t i;
+   for (i=0; i<APX_NODE_TEMPLATE_DIGEST_SIZE; i++)
+   {
+      *key++ = hexDigits[digest[i] >> 4];
+      *key++ = hexDigits[digest[i] & 0x0F];
+   }
+   *key = 0;
+}
+
+/**
+ * initializes the table on first use
+ */
+static void apx_nodeTemplate_initTable(void)
+{
+   apx_once(&m_initOnce, apx_nodeTemplate_initTableOnce);
+}
+
+static void apx_nodeTemplate_initTableOnce(void)
+{
+   MUTEX_INIT(m_mutex);
+   adt_hash_create(&m_templateMap, (void(*)(void*)) 0);
+}
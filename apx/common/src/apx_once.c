@@ -0,0 +1,61 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include "apx_once.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+#ifdef _WIN32
+static BOOL CALLBACK apx_once_callback(PINIT_ONCE once, PVOID param, PVOID *context);
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+/**
+ * calls initFunc unless it has already been called for once. Threads arriving while another thread runs initFunc
+ * wait until it has returned.
+ */
+void apx_once(apx_once_t *once, apx_once_fn *initFunc)
+{
+   if ( (once != 0) && (initFunc != 0) )
+   {
+#ifdef _WIN32
+      (void) InitOnceExecuteOnce(once, apx_once_callback, (PVOID) initFunc, (PVOID*) 0);
+#else
+      (void) pthread_once(once, initFunc);
+#endif
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+#ifdef _WIN32
+static BOOL CALLBACK apx_once_callback(PINIT_ONCE once, PVOID param, PVOID *context)
+{
+   apx_once_fn *initFunc = (apx_once_fn*) param;
+   (void) once;
+   (void) context;
+   initFunc();
+   return TRUE;
+}
+#endif
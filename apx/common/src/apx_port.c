@@ -35,6 +35,7 @@ void apx_port_create(apx_port_t *self,uint8_t portDirection,const char *name, co
 			self->dataSignature = (dataSignature != 0)? STRDUP(dataSignature) : 0;
 			self->portType = portDirection;
          self->portSignature = 0;
+         self->portSignatureId = APX_PORT_SIGNATURE_ID_INVALID;
          self->portIndex = -1;
 			apx_dataSignature_create(&self->derivedDsg,0);
 			if (attributes != 0)
@@ -61,10 +62,18 @@ void apx_port_destroy(apx_port_t *self){
 		{
 			apx_portAttributes_delete(self->portAttributes);
 		}
-      if (self->portSignature != 0)
+      if (self->portSignatureId != APX_PORT_SIGNATURE_ID_INVALID)
+      {
+         apx_portSignatureTable_release(self->portSignatureId);
+      }
+      else if (self->portSignature != 0)
       {
          free(self->portSignature);
       }
+      else
+      {
+         //MISRA
+      }
       apx_dataSignature_destroy(&self->derivedDsg);
 	}
 }
@@ -106,6 +115,64 @@ void apx_port_vdelete(void *arg){
 	apx_port_delete((apx_port_t*) arg);
 }
 
+/**
+ * returns a deep copy of other. An interned port signature is shared with other, the init value of the port attributes is not copied
+ */
+apx_port_t* apx_port_clone(const apx_port_t *other)
+{
+   apx_port_t *self;
+   if (other == 0)
+   {
+      errno = EINVAL;
+      return (apx_port_t*) 0;
+   }
+   self = (apx_port_t*) malloc(sizeof(apx_port_t));
+   if (self == 0)
+   {
+      errno = ENOMEM;
+      return (apx_port_t*) 0;
+   }
+   self->name = (other->name != 0)? STRDUP(other->name) : 0;
+   self->dataSignature = (other->dataSignature != 0)? STRDUP(other->dataSignature) : 0;
+   self->portType = other->portType;
+   self->portIndex = other->portIndex;
+   self->portSignatureId = APX_PORT_SIGNATURE_ID_INVALID;
+   self->portSignature = 0;
+   if ( (other->portSignature != 0) && (other->portSignatureId == APX_PORT_SIGNATURE_ID_INVALID) )
+   {
+      self->portSignature = STRDUP(other->portSignature);
+   }
+   else if (other->portSignature != 0)
+   {
+      //the copy holds a reference of its own to the interned string
+      const char *internedSignature = 0;
+      self->portSignatureId = apx_portSignatureTable_intern(other->portSignature, &internedSignature);
+      self->portSignature = (char*) internedSignature;
+   }
+   else
+   {
+      //MISRA
+   }
+   self->portAttributes = (other->portAttributes != 0)? apx_portAttributes_clone(other->portAttributes) : 0;
+   if (apx_dataSignature_createCopy(&self->derivedDsg, &other->derivedDsg) != 0)
+   {
+      apx_dataSignature_create(&self->derivedDsg, 0);
+      apx_port_delete(self);
+      errno = ENOMEM;
+      return (apx_port_t*) 0;
+   }
+   if ( ( (other->name != 0) && (self->name == 0) ) ||
+        ( (other->dataSignature != 0) && (self->dataSignature == 0) ) ||
+        ( (other->portSignature != 0) && (self->portSignature == 0) ) ||
+        ( (other->portAttributes != 0) && (self->portAttributes == 0) ) )
+   {
+      apx_port_delete(self);
+      errno = ENOMEM;
+      return (apx_port_t*) 0;
+   }
+   return self;
+}
+
 void apx_port_setDerivedDataSignature(apx_port_t *self, const char *dataSignature)
 {
    if (self != 0)
@@ -129,8 +196,16 @@ const char *apx_port_derivePortSignature(apx_port_t *self)
 
       if (self->portSignature != 0)
       {
-         free(self->portSignature);
+         if (self->portSignatureId == APX_PORT_SIGNATURE_ID_INVALID)
+         {
+            free(self->portSignature);
+         }
+         else
+         {
+            apx_portSignatureTable_release(self->portSignatureId);
+         }
          self->portSignature = 0;
+         self->portSignatureId = APX_PORT_SIGNATURE_ID_INVALID;
       }
 
       if (self->name != 0)
@@ -184,6 +259,50 @@ const char *apx_port_getPortSignature(apx_port_t *self)
    return 0;
 }
 
+/**
+ * interns the port signature in apx_portSignatureTable. The private copy of the string is released and replaced by the shared one.
+ * returns the port signature id or APX_PORT_SIGNATURE_ID_INVALID on failure
+ */
+int32_t apx_port_internPortSignature(apx_port_t *self)
+{
+   if (self != 0)
+   {
+      if (self->portSignatureId == APX_PORT_SIGNATURE_ID_INVALID)
+      {
+         const char *psg = apx_port_getPortSignature(self);
+         if (psg != 0)
+         {
+            const char *internedSignature = 0;
+            int32_t id = apx_portSignatureTable_intern(psg, &internedSignature);
+            if (id != APX_PORT_SIGNATURE_ID_INVALID)
+            {
+               free(self->portSignature);
+               self->portSignature = (char*) internedSignature;
+               self->portSignatureId = id;
+            }
+         }
+      }
+      return self->portSignatureId;
+   }
+   return APX_PORT_SIGNATURE_ID_INVALID;
+}
+
+/**
+ * returns the port signature id, the signature is interned on first call unless apx_node_finalize already did so
+ */
+int32_t apx_port_getPortSignatureId(apx_port_t *self)
+{
+   if (self != 0)
+   {
+      if (self->portSignatureId == APX_PORT_SIGNATURE_ID_INVALID)
+      {
+         return apx_port_internPortSignature(self);
+      }
+      return self->portSignatureId;
+   }
+   return APX_PORT_SIGNATURE_ID_INVALID;
+}
+
 int32_t apx_port_getPackLen(apx_port_t *self)
 {
    if (self != 0)
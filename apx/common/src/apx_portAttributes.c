@@ -108,6 +108,27 @@ void apx_portAttributes_vdelete(void *arg)
    apx_portAttributes_delete((apx_portAttributes_t*) arg);
 }
 
+/**
+ * returns a copy of other. The parsed init value is not copied, initValue of the copy is NULL
+ */
+apx_portAttributes_t* apx_portAttributes_clone(const apx_portAttributes_t *other)
+{
+   if (other != 0)
+   {
+      apx_portAttributes_t *self = apx_portAttributes_new(other->rawValue);
+      if (self != 0)
+      {
+         self->isFinalized = other->isFinalized;
+         self->isParameter = other->isParameter;
+         self->isQueued = other->isQueued;
+         self->queueLen = other->queueLen;
+      }
+      return self;
+   }
+   errno = EINVAL;
+   return (apx_portAttributes_t*) 0;
+}
+
 void apx_portAttributes_clearInitValue(apx_portAttributes_t *self)
 {
    if ( (self != 0) && (self->initValue != 0) )
@@ -0,0 +1,195 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <errno.h>
+#include <malloc.h>
+#include <string.h>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "osmacro.h"
+#include "adt_ary.h"
+#include "adt_hash.h"
+#include "apx_once.h"
+#include "apx_portSignatureTable.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+typedef struct apx_portSignatureEntry_tag
+{
+   int32_t refCount; //references handed out by apx_portSignatureTable_intern
+   char *signature; //points to memory allocated directly after the struct
+}apx_portSignatureEntry_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static void apx_portSignatureTable_init(void);
+static void apx_portSignatureTable_initOnce(void);
+static apx_portSignatureEntry_t *apx_portSignatureTable_newEntry(const char *portSignature);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+static apx_once_t m_initOnce = APX_ONCE_INIT;
+static MUTEX_T m_mutex;
+static adt_hash_t m_idMap; //key is the port signature, value is id+1 (a value of 0 cannot be told apart from a missing entry)
+static adt_ary_t m_entries; //strong references to apx_portSignatureEntry_t, indexed by id. Released ids hold NULL
+static adt_ary_t m_freeIds; //released ids (stored as id+1), they are given out again before the table grows
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+/**
+ * returns the id of portSignature, adding it to the table if it is not already there. The caller holds a reference to the id until it calls apx_portSignatureTable_release.
+ * When internedSignature is given it is set to the table's copy of the string which stays valid while the reference is held.
+ * returns APX_PORT_SIGNATURE_ID_INVALID and sets errno on failure
+ */
+int32_t apx_portSignatureTable_intern(const char *portSignature, const char **internedSignature)
+{
+   int32_t id = APX_PORT_SIGNATURE_ID_INVALID;
+   apx_portSignatureEntry_t *entry = (apx_portSignatureEntry_t*) 0;
+   void **ptr;
+   if (portSignature == 0)
+   {
+      errno = EINVAL;
+      return APX_PORT_SIGNATURE_ID_INVALID;
+   }
+   apx_portSignatureTable_init();
+   MUTEX_LOCK(m_mutex);
+   ptr = adt_hash_get(&m_idMap, portSignature, 0);
+   if (ptr != 0)
+   {
+      id = (int32_t) (((intptr_t) *ptr) - 1);
+      entry = (apx_portSignatureEntry_t*) adt_ary_value(&m_entries, id);
+      entry->refCount++;
+   }
+   else
+   {
+      entry = apx_portSignatureTable_newEntry(portSignature);
+      if (entry != 0)
+      {
+         if (adt_ary_length(&m_freeIds) > 0)
+         {
+            id = (int32_t) (((intptr_t) adt_ary_pop(&m_freeIds)) - 1);
+         }
+         else
+         {
+            id = adt_ary_length(&m_entries);
+         }
+         adt_ary_set(&m_entries, id, entry);
+         adt_hash_set(&m_idMap, entry->signature, 0, (void*) (((intptr_t) id) + 1));
+      }
+   }
+   if ( (internedSignature != 0) && (entry != 0) )
+   {
+      *internedSignature = entry->signature;
+   }
+   MUTEX_UNLOCK(m_mutex);
+   return id;
+}
+
+/**
+ * gives back a reference taken by apx_portSignatureTable_intern. The string is freed and the id can be given out again when the last reference is released.
+ */
+void apx_portSignatureTable_release(int32_t id)
+{
+   if (id >= 0)
+   {
+      apx_portSignatureEntry_t *entry;
+      apx_portSignatureTable_init();
+      MUTEX_LOCK(m_mutex);
+      entry = (apx_portSignatureEntry_t*) adt_ary_value(&m_entries, id);
+      if (entry != 0)
+      {
+         entry->refCount--;
+         if (entry->refCount == 0)
+         {
+            (void) adt_hash_remove(&m_idMap, entry->signature, 0);
+            adt_ary_set(&m_entries, id, (void*) 0);
+            adt_ary_push(&m_freeIds, (void*) (((intptr_t) id) + 1));
+            free(entry);
+         }
+      }
+      MUTEX_UNLOCK(m_mutex);
+   }
+}
+
+/**
+ * returns the interned string for id or NULL if no signature currently has that id
+ */
+const char *apx_portSignatureTable_getSignature(int32_t id)
+{
+   const char *retval = (const char*) 0;
+   if (id >= 0)
+   {
+      apx_portSignatureEntry_t *entry;
+      apx_portSignatureTable_init();
+      MUTEX_LOCK(m_mutex);
+      entry = (apx_portSignatureEntry_t*) adt_ary_value(&m_entries, id);
+      if (entry != 0)
+      {
+         retval = entry->signature;
+      }
+      MUTEX_UNLOCK(m_mutex);
+   }
+   return retval;
+}
+
+/**
+ * returns the size of the id range. All ids are less than this number, released ids in the range are given out again first.
+ */
+int32_t apx_portSignatureTable_length(void)
+{
+   int32_t retval;
+   apx_portSignatureTable_init();
+   MUTEX_LOCK(m_mutex);
+   retval = adt_ary_length(&m_entries);
+   MUTEX_UNLOCK(m_mutex);
+   return retval;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+/**
+ * initializes the table on first use
+ */
+static void apx_portSignatureTable_init(void)
+{
+   apx_once(&m_initOnce, apx_portSignatureTable_initOnce);
+}
+
+static void apx_portSignatureTable_initOnce(void)
+{
+   MUTEX_INIT(m_mutex);
+   adt_hash_create(&m_idMap, (void(*)(void*)) 0);
+   adt_ary_create(&m_entries, (void(*)(void*)) 0);
+   adt_ary_create(&m_freeIds, (void(*)(void*)) 0);
+}
+
+static apx_portSignatureEntry_t *apx_portSignatureTable_newEntry(const char *portSignature)
+{
+   size_t len = strlen(portSignature);
+   apx_portSignatureEntry_t *entry = (apx_portSignatureEntry_t*) malloc(sizeof(apx_portSignatureEntry_t)+len+1);
+   if (entry == 0)
+   {
+      errno = ENOMEM;
+      return entry;
+   }
+   entry->refCount = 1;
+   entry->signature = ((char*) entry) + sizeof(apx_portSignatureEntry_t);
+   memcpy(entry->signature, portSignature, len+1);
+   return entry;
+}
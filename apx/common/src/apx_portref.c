@@ -38,6 +38,7 @@ void apx_portref_create(apx_portref_t *self,apx_node_t *node,apx_port_t *port)
    {
       self->node=node;
       self->port=port;
+      self->listIndex=-1;
    }
 }
 
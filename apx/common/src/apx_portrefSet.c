@@ -0,0 +1,327 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <errno.h>
+#include <malloc.h>
+#include <assert.h>
+#include <string.h>
+#include "apx_portrefSet.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#define APX_PORTREF_SET_MIN_INDEX_LEN 8
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static uint32_t apx_portrefSet_hash(const apx_node_t *node, const apx_port_t *port);
+static int32_t apx_portrefSet_findIndexPos(const apx_portrefSet_t *self, const apx_node_t *node, const apx_port_t *port, bool *found);
+static void apx_portrefSet_removeIndexPos(apx_portrefSet_t *self, int32_t pos);
+static int8_t apx_portrefSet_growIndex(apx_portrefSet_t *self);
+static void apx_portrefSet_compact(apx_portrefSet_t *self);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+void apx_portrefSet_create(apx_portrefSet_t *self)
+{
+   if (self != 0)
+   {
+      adt_ary_create(&self->list, apx_portref_vdelete);
+      self->index = (apx_portref_t**) 0;
+      self->indexAllocLen = 0;
+      self->numElements = 0;
+      self->numRemoved = 0;
+   }
+}
+
+void apx_portrefSet_destroy(apx_portrefSet_t *self)
+{
+   if (self != 0)
+   {
+      adt_ary_destroy(&self->list);
+      if (self->index != 0)
+      {
+         free(self->index);
+         self->index = (apx_portref_t**) 0;
+      }
+      self->indexAllocLen = 0;
+      self->numElements = 0;
+   }
+}
+
+apx_portrefSet_t *apx_portrefSet_new(void)
+{
+   apx_portrefSet_t *self = (apx_portrefSet_t*) malloc(sizeof(apx_portrefSet_t));
+   if(self != 0){
+      apx_portrefSet_create(self);
+   }
+   else{
+      errno = ENOMEM;
+   }
+   return self;
+}
+
+void apx_portrefSet_delete(apx_portrefSet_t *self)
+{
+   if (self != 0)
+   {
+      apx_portrefSet_destroy(self);
+      free(self);
+   }
+}
+
+void apx_portrefSet_vdelete(void *arg)
+{
+   apx_portrefSet_delete((apx_portrefSet_t*) arg);
+}
+
+/**
+ * adds a new apx_portref_t to the end of the list unless an equal portref already exists in the set.
+ * returns 0 on success (also when the portref already exists), -1 on failure
+ */
+int8_t apx_portrefSet_insert(apx_portrefSet_t *self, apx_node_t *node, apx_port_t *port)
+{
+   if ( (self != 0) && (node != 0) && (port != 0) )
+   {
+      bool found;
+      int32_t pos;
+      apx_portref_t *portref;
+      //keeps the load factor of the index at or below 1/2
+      if ( ((self->numElements+1)*2 > self->indexAllocLen) && (apx_portrefSet_growIndex(self) != 0) )
+      {
+         return -1;
+      }
+      pos = apx_portrefSet_findIndexPos(self, node, port, &found);
+      if (found)
+      {
+         return 0;
+      }
+      portref = apx_portref_new(node, port);
+      if (portref == 0)
+      {
+         return -1; //apx_portref_new should already have set errno
+      }
+      portref->listIndex = adt_ary_length(&self->list);
+      adt_ary_push(&self->list, portref);
+      self->index[pos] = portref;
+      self->numElements++;
+      return 0;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * removes the portref matching node and port. The order of the remaining elements is kept.
+ * returns true if an element was removed
+ */
+bool apx_portrefSet_remove(apx_portrefSet_t *self, apx_node_t *node, apx_port_t *port)
+{
+   if ( (self != 0) && (node != 0) && (port != 0) )
+   {
+      bool found;
+      int32_t pos = apx_portrefSet_findIndexPos(self, node, port, &found);
+      if (found)
+      {
+         apx_portref_t *portref = self->index[pos];
+         void **slot = adt_ary_get(&self->list, portref->listIndex);
+         assert( (slot != 0) && (*slot == (void*) portref) );
+         *slot = (void*) 0;
+         apx_portref_delete(portref);
+         apx_portrefSet_removeIndexPos(self, pos);
+         self->numElements--;
+         self->numRemoved++;
+         if (self->numRemoved > self->numElements)
+         {
+            apx_portrefSet_compact(self);
+         }
+         return true;
+      }
+   }
+   return false;
+}
+
+bool apx_portrefSet_contains(const apx_portrefSet_t *self, apx_node_t *node, apx_port_t *port)
+{
+   if (self != 0)
+   {
+      bool found;
+      (void) apx_portrefSet_findIndexPos(self, node, port, &found);
+      return found;
+   }
+   return false;
+}
+
+int32_t apx_portrefSet_length(const apx_portrefSet_t *self)
+{
+   if (self != 0)
+   {
+      return self->numElements;
+   }
+   return 0;
+}
+
+/**
+ * returns element at position index in insertion order or NULL if index is out of range
+ */
+apx_portref_t *apx_portrefSet_get(apx_portrefSet_t *self, int32_t index)
+{
+   if ( (self != 0) && (index >= 0) && (index < self->numElements) )
+   {
+      apx_portrefSet_compact(self);
+      return (apx_portref_t*) adt_ary_value(&self->list, index);
+   }
+   return (apx_portref_t*) 0;
+}
+
+/**
+ * returns the elements in insertion order. The caller must not modify the list.
+ */
+adt_ary_t *apx_portrefSet_getList(apx_portrefSet_t *self)
+{
+   if (self != 0)
+   {
+      apx_portrefSet_compact(self);
+      return &self->list;
+   }
+   return (adt_ary_t*) 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+static uint32_t apx_portrefSet_hash(const apx_node_t *node, const apx_port_t *port)
+{
+   uint64_t key = ( (uint64_t) (uintptr_t) node * 31u ) + (uint64_t) (uintptr_t) port;
+   //finalizer of MurmurHash3, spreads the aligned pointer bits over the whole word
+   key ^= key >> 33;
+   key *= 0xff51afd7ed558ccdull;
+   key ^= key >> 33;
+   return (uint32_t) key;
+}
+
+/**
+ * linear probing in self->index. Returns position of the matching element or the empty position where it should be inserted.
+ */
+static int32_t apx_portrefSet_findIndexPos(const apx_portrefSet_t *self, const apx_node_t *node, const apx_port_t *port, bool *found)
+{
+   uint32_t mask;
+   uint32_t pos;
+   *found = false;
+   if (self->indexAllocLen == 0)
+   {
+      return -1;
+   }
+   mask = (uint32_t) self->indexAllocLen - 1u;
+   pos = apx_portrefSet_hash(node, port) & mask;
+   while (self->index[pos] != 0)
+   {
+      const apx_portref_t *portref = self->index[pos];
+      if ( (portref->node == node) && (portref->port == port) )
+      {
+         *found = true;
+         break;
+      }
+      pos = (pos + 1u) & mask;
+   }
+   return (int32_t) pos;
+}
+
+/**
+ * empties position pos of the index, moving back later elements of the same probe sequence so no tombstones are needed
+ */
+static void apx_portrefSet_removeIndexPos(apx_portrefSet_t *self, int32_t pos)
+{
+   uint32_t mask = (uint32_t) self->indexAllocLen - 1u;
+   uint32_t hole = (uint32_t) pos;
+   uint32_t next = (hole + 1u) & mask;
+   while (self->index[next] != 0)
+   {
+      apx_portref_t *portref = self->index[next];
+      uint32_t home = apx_portrefSet_hash(portref->node, portref->port) & mask;
+      //the element can fill the hole unless its home position lies cyclically in (hole, next]
+      if ( ((next - home) & mask) >= ((next - hole) & mask) )
+      {
+         self->index[hole] = portref;
+         hole = next;
+      }
+      next = (next + 1u) & mask;
+   }
+   self->index[hole] = (apx_portref_t*) 0;
+}
+
+static int8_t apx_portrefSet_growIndex(apx_portrefSet_t *self)
+{
+   int32_t i;
+   int32_t end;
+   int32_t allocLen = (self->indexAllocLen == 0)? APX_PORTREF_SET_MIN_INDEX_LEN : self->indexAllocLen*2;
+   apx_portref_t **index = (apx_portref_t**) calloc((size_t) allocLen, sizeof(apx_portref_t*));
+   if (index == 0)
+   {
+      errno = ENOMEM;
+      return -1;
+   }
+   if (self->index != 0)
+   {
+      free(self->index);
+   }
+   self->index = index;
+   self->indexAllocLen = allocLen;
+   end = adt_ary_length(&self->list);
+   for (i=0; i<end; i++)
+   {
+      apx_portref_t *portref = (apx_portref_t*) adt_ary_value(&self->list, i);
+      if (portref != 0)
+      {
+         bool found;
+         int32_t pos = apx_portrefSet_findIndexPos(self, portref->node, portref->port, &found);
+         assert(found == false);
+         self->index[pos] = portref;
+      }
+   }
+   return 0;
+}
+
+/**
+ * removes the empty slots left in the list by apx_portrefSet_remove, keeping the order of the remaining elements
+ */
+static void apx_portrefSet_compact(apx_portrefSet_t *self)
+{
+   if (self->numRemoved > 0)
+   {
+      int32_t i;
+      int32_t numKept = 0;
+      int32_t end = adt_ary_length(&self->list);
+      for (i=0; i<end; i++)
+      {
+         apx_portref_t *portref = (apx_portref_t*) adt_ary_value(&self->list, i);
+         if (portref != 0)
+         {
+            if (numKept < i)
+            {
+               *adt_ary_get(&self->list, numKept) = (void*) portref;
+               *adt_ary_get(&self->list, i) = (void*) 0;
+            }
+            portref->listIndex = numKept++;
+         }
+      }
+      assert(numKept == self->numElements);
+      (void) adt_ary_resize(&self->list, numKept); //only empty slots are cut off
+      self->numRemoved = 0;
+   }
+}
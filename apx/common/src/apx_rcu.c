@@ -0,0 +1,197 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <errno.h>
+#include <malloc.h>
+#include <string.h>
+#if defined(_MSC_PLATFORM_TOOLSET) && (_MSC_PLATFORM_TOOLSET<=110)
+#include "msc_bool.h"
+#else
+#include <stdbool.h>
+#endif
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "osmacro.h"
+#include "apx_atomic.h"
+#include "apx_once.h"
+#include "apx_logging.h"
+#include "apx_rcu.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#define APX_RCU_MIN_NUM_RETIRED 16
+
+typedef struct apx_rcuRetired_tag
+{
+   void *arg;
+   apx_rcu_free_fn *freeFunc;
+}apx_rcuRetired_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static void apx_rcu_init(void);
+static void apx_rcu_initOnce(void);
+static void apx_rcu_waitForReaders(void);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+static apx_once_t m_initOnce = APX_ONCE_INIT;
+static volatile int32_t m_epoch = 0; //the lowest bit selects which of m_readers new readers use
+static volatile int32_t m_readers[2] = {0, 0};
+static MUTEX_T m_retireLock; //protects m_retired
+static MUTEX_T m_syncLock; //serializes grace periods
+static apx_rcuRetired_t *m_retired = (apx_rcuRetired_t*) 0;
+static int32_t m_numRetired = 0;
+static int32_t m_maxNumRetired = 0;
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+/**
+ * enters a read-side section, published routing data read after this call stays valid until apx_rcu_readUnlock.
+ * Read-side sections may be nested. returns the value to give to apx_rcu_readUnlock
+ */
+int32_t apx_rcu_readLock(void)
+{
+   int32_t readIndex = APX_ATOMIC_LOAD_ACQUIRE(m_epoch) & 1;
+   //full barrier, the caller's loads of published pointers cannot move above this increment
+   (void) APX_ATOMIC_INCREMENT(m_readers[readIndex]);
+   return readIndex;
+}
+
+void apx_rcu_readUnlock(int32_t readIndex)
+{
+   (void) APX_ATOMIC_DECREMENT(m_readers[readIndex & 1]);
+}
+
+/**
+ * schedules arg to be freed by freeFunc after the next grace period.
+ * arg must already be unreachable for new readers (unpublished) when this is called.
+ */
+void apx_rcu_retire(void *arg, apx_rcu_free_fn *freeFunc)
+{
+   if ( (arg != 0) && (freeFunc != 0) )
+   {
+      bool freeNow = false;
+      apx_rcu_init();
+      MUTEX_LOCK(m_retireLock);
+      if (m_numRetired == m_maxNumRetired)
+      {
+         int32_t maxNumRetired = (m_maxNumRetired == 0)? APX_RCU_MIN_NUM_RETIRED : m_maxNumRetired*2;
+         apx_rcuRetired_t *retired = (apx_rcuRetired_t*) realloc(m_retired, sizeof(apx_rcuRetired_t) * maxNumRetired);
+         if (retired != 0)
+         {
+            m_retired = retired;
+            m_maxNumRetired = maxNumRetired;
+         }
+      }
+      if (m_numRetired < m_maxNumRetired)
+      {
+         m_retired[m_numRetired].arg = arg;
+         m_retired[m_numRetired].freeFunc = freeFunc;
+         m_numRetired++;
+      }
+      else
+      {
+         freeNow = true;
+      }
+      MUTEX_UNLOCK(m_retireLock);
+      if (freeNow)
+      {
+         //out of memory, wait here for the grace period instead of leaking arg
+         APX_LOG_ERROR("[APX_RCU] %s", "failed to grow retire list");
+         apx_rcu_waitForReaders();
+         freeFunc(arg);
+      }
+   }
+}
+
+/**
+ * waits until all read-side sections that started before this call have finished, then frees everything retired before this call.
+ * Must not be called from inside a read-side section.
+ */
+void apx_rcu_synchronize(void)
+{
+   apx_rcuRetired_t *retired;
+   int32_t numRetired;
+   int32_t i;
+   apx_rcu_init();
+   MUTEX_LOCK(m_retireLock);
+   retired = m_retired;
+   numRetired = m_numRetired;
+   m_retired = (apx_rcuRetired_t*) 0;
+   m_numRetired = 0;
+   m_maxNumRetired = 0;
+   MUTEX_UNLOCK(m_retireLock);
+   apx_rcu_waitForReaders();
+   for (i=0; i<numRetired; i++)
+   {
+      retired[i].freeFunc(retired[i].arg);
+   }
+   if (retired != 0)
+   {
+      free(retired);
+   }
+}
+
+/**
+ * returns number of objects waiting for a grace period
+ */
+int32_t apx_rcu_getNumRetired(void)
+{
+   int32_t retval;
+   apx_rcu_init();
+   MUTEX_LOCK(m_retireLock);
+   retval = m_numRetired;
+   MUTEX_UNLOCK(m_retireLock);
+   return retval;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+static void apx_rcu_init(void)
+{
+   apx_once(&m_initOnce, apx_rcu_initOnce);
+}
+
+static void apx_rcu_initOnce(void)
+{
+   MUTEX_INIT(m_retireLock);
+   MUTEX_INIT(m_syncLock);
+}
+
+/**
+ * Moves new readers over to the other counter and waits for the old counter to drain, twice.
+ * Both counters are seen at zero at some point after the call started, so every reader which was already inside its
+ * read-side section has left it. A reader that picked its counter just before a flip but incremented it after the wait
+ * can only have loaded pointers published before this call.
+ */
+static void apx_rcu_waitForReaders(void)
+{
+   int32_t phase;
+   MUTEX_LOCK(m_syncLock);
+   for (phase=0; phase<2; phase++)
+   {
+      int32_t oldIndex = APX_ATOMIC_FETCH_ADD(m_epoch, 1) & 1;
+      while (APX_ATOMIC_LOAD_ACQUIRE(m_readers[oldIndex]) != 0)
+      {
+         SLEEP(0);
+      }
+   }
+   MUTEX_UNLOCK(m_syncLock);
+}
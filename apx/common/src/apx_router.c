@@ -4,6 +4,7 @@
 #include <errno.h>
 #include <malloc.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <string.h>
 #include "adt_str.h"
@@ -29,9 +30,13 @@
 static void apx_router_attachPortToPortMap(apx_router_t *self, apx_node_t *node, apx_port_t *port);
 static void apx_router_detachPortFromPortMap(apx_router_t *self, apx_node_t *node, apx_port_t *port);
 static bool apx_router_createDefaultPortConnector(const apx_router_t *self, apx_nodeInfo_t *nodeInfo, apx_port_t *port, apx_portref_t *provideConnector);
+static apx_routerPortMapEntry_t *apx_router_findPortMapEntry(const apx_router_t *self, apx_port_t *port);
 static void apx_router_build_requireRefs(apx_nodeInfo_t *nodeInfo, adt_ary_t *requireRefs);
-static void apx_router_postProcessNodes(const apx_router_t *self, apx_nodeInfo_t *detachedNodeInfo);
+static void apx_router_postProcessNodes(apx_router_t *self);
 static void apx_router_postProcessNode(apx_nodeInfo_t *extraNodeInfo, int8_t debugMode);
+static void apx_router_connectToLastProvider(const apx_router_t *self, apx_routerPortMapEntry_t *portMapEntry);
+static int apx_router_compareNodeInfo(const void *a, const void *b);
+static bool apx_router_isInNodeInfoSet(apx_nodeInfo_t **nodeInfoSet, int32_t setLen, apx_nodeInfo_t *nodeInfo);
 
 //////////////////////////////////////////////////////////////////////////////
 // GLOBAL VARIABLES
@@ -52,7 +57,8 @@ void apx_router_create(apx_router_t *self)
    if ( (self != 0) )
    {
       adt_ary_create(&self->nodeInfoList, (void(*)(void*)) 0); //weak references to apx_nodeInfo_t.
-      adt_hash_create(&self->portMap, apx_routerPortMapEntry_vdelete); //hash where key is the port signature (string) and value is apx_routerPortMapEntry_t
+      adt_ary_create(&self->portMap, apx_routerPortMapEntry_vdelete); //index is the port signature id, unused ids hold NULL
+      adt_ary_create(&self->dirtyNodeInfoList, (void(*)(void*)) 0); //weak references to apx_nodeInfo_t.
       self->debugMode = APX_DEBUG_NONE;
    }
 }
@@ -65,7 +71,8 @@ void apx_router_destroy(apx_router_t *self)
    if ( self != 0)
    {
       adt_ary_destroy(&self->nodeInfoList);
-      adt_hash_destroy(&self->portMap);
+      adt_ary_destroy(&self->portMap);
+      adt_ary_destroy(&self->dirtyNodeInfoList);
    }
 }
 
@@ -112,6 +119,7 @@ void apx_router_attachNodeInfo(apx_router_t *self, apx_nodeInfo_t *nodeInfo)
       //This is a new node.
       //2. add this nodeInfo to the nodeInfoList
       adt_ary_push(&self->nodeInfoList,nodeInfo);
+      apx_nodeInfo_setDirtyList(nodeInfo, &self->dirtyNodeInfoList);
 
       //3. register all require ports into the portMap
       for (i=0;i<requirePortLen;i++)
@@ -144,8 +152,8 @@ void apx_router_attachNodeInfo(apx_router_t *self, apx_nodeInfo_t *nodeInfo)
       {
          APX_LOG_DEBUG("[APX_ROUTER] done creating default connectors for %s",node->name);
       }
-      //6. loop through all nodes and check for flags (flags indicate extra post processing steps are required)
-      apx_router_postProcessNodes(self,0);
+      //6. check flags of the nodes affected by the new connectors (flags indicate extra post processing steps are required)
+      apx_router_postProcessNodes(self);
       if (self->debugMode == APX_DEBUG_1_PROFILE)
       {
          APX_LOG_DEBUG("[APX_ROUTER] done post processing %s connect",node->name);
@@ -172,7 +180,8 @@ void apx_router_detachNodeInfo(apx_router_t *self, apx_nodeInfo_t *nodeInfo)
       assert(node != 0);
 
       debugInfoStr[0]=0;
-      if ( (nodeInfo->nodeData != 0) && (nodeInfo->nodeData->fileManager->debugInfo != 0) )
+      //a stale node has no fileManager
+      if ( (nodeInfo->nodeData != 0) && (nodeInfo->nodeData->fileManager != 0) && (nodeInfo->nodeData->fileManager->debugInfo != 0) )
       {
          snprintf(debugInfoStr, APX_DEBUG_INFO_MAX_LEN, " (%p)", nodeInfo->nodeData->fileManager->debugInfo);
       }
@@ -240,7 +249,228 @@ void apx_router_detachNodeInfo(apx_router_t *self, apx_nodeInfo_t *nodeInfo)
          (void)apx_router_createDefaultPortConnector(self,requesterNodeInfo,portref->port,0);
       }
       adt_ary_destroy(&requireRefs);
-      apx_router_postProcessNodes(self,nodeInfo);
+      //the detached nodeInfo is still in the dirty list, it needs its data triggers updated as well
+      apx_router_postProcessNodes(self);
+      apx_nodeInfo_setDirtyList(nodeInfo, (adt_ary_t*) 0);
+   }
+}
+
+/**
+ * Attaches numNodeInfos nodes at once. All ports are registered before any connector is created, this way each signature
+ * that got a new provider is connected to its final provider once instead of once for every provider attached after it.
+ * The resulting connectors are the same as when the nodes are attached one at a time in array order.
+ * Data triggers are updated once per affected provide port. Nodes that are already attached are ignored.
+ */
+void apx_router_attachNodeInfos(apx_router_t *self, apx_nodeInfo_t **nodeInfos, int32_t numNodeInfos)
+{
+   if ( (self != 0) && (nodeInfos != 0) && (numNodeInfos > 0) )
+   {
+      int32_t i;
+      int32_t j;
+      int32_t numAttached;
+      uint8_t *hasNewProvider; //one flag per port signature id
+      adt_ary_t attached; //weak references to the nodeInfos attached by this call
+
+      adt_ary_create(&attached, (void(*)(void*)) 0);
+      //1. register the ports of all new nodes
+      for (i=0;i<numNodeInfos;i++)
+      {
+         apx_nodeInfo_t *nodeInfo = nodeInfos[i];
+         apx_node_t *node;
+         int32_t requirePortLen;
+         int32_t providePortLen;
+         if ( (nodeInfo == 0) || (nodeInfo->dirtyList == &self->dirtyNodeInfoList) )
+         {
+            continue; //an attached nodeInfo always uses our dirty list
+         }
+         node = nodeInfo->node;
+         assert(node != 0);
+         APX_LOG_DEBUG("[APX_ROUTER] Attaching %s", node->name);
+         adt_ary_push(&self->nodeInfoList,nodeInfo);
+         apx_nodeInfo_setDirtyList(nodeInfo, &self->dirtyNodeInfoList);
+         adt_ary_push(&attached, nodeInfo);
+         requirePortLen = adt_ary_length(&node->requirePortList);
+         providePortLen = adt_ary_length(&node->providePortList);
+         for (j=0;j<requirePortLen;j++)
+         {
+            apx_router_attachPortToPortMap(self,node,apx_node_getRequirePort(node,j));
+         }
+         for (j=0;j<providePortLen;j++)
+         {
+            apx_router_attachPortToPortMap(self,node,apx_node_getProvidePort(node,j));
+         }
+      }
+      numAttached = adt_ary_length(&attached);
+      //2. find the signatures that got a new provider, all their require ports are rerouted to the last provider
+      hasNewProvider = (uint8_t*) calloc(adt_ary_length(&self->portMap)+1, 1);
+      for (i=0;i<numAttached;i++)
+      {
+         apx_nodeInfo_t *nodeInfo = (apx_nodeInfo_t*) adt_ary_value(&attached,i);
+         int32_t providePortLen = adt_ary_length(&nodeInfo->node->providePortList);
+         for (j=0;j<providePortLen;j++)
+         {
+            apx_port_t *port = apx_node_getProvidePort(nodeInfo->node,j);
+            int32_t portSignatureId = apx_port_getPortSignatureId(port);
+            if (hasNewProvider == 0)
+            {
+               //out of memory, fall back to the connection order of single attach
+               (void) apx_router_createDefaultPortConnector(self,nodeInfo,port,0);
+            }
+            else if (portSignatureId != APX_PORT_SIGNATURE_ID_INVALID)
+            {
+               hasNewProvider[portSignatureId] = 1;
+            }
+            else
+            {
+               //port was never registered
+            }
+         }
+      }
+      //3. connect the new require ports of the other signatures to the existing provider
+      for (i=0;i<numAttached;i++)
+      {
+         apx_nodeInfo_t *nodeInfo = (apx_nodeInfo_t*) adt_ary_value(&attached,i);
+         int32_t requirePortLen = adt_ary_length(&nodeInfo->node->requirePortList);
+         for (j=0;j<requirePortLen;j++)
+         {
+            apx_port_t *port = apx_node_getRequirePort(nodeInfo->node,j);
+            int32_t portSignatureId = apx_port_getPortSignatureId(port);
+            if ( (hasNewProvider == 0) || (portSignatureId == APX_PORT_SIGNATURE_ID_INVALID) || (hasNewProvider[portSignatureId] == 0) )
+            {
+               (void) apx_router_createDefaultPortConnector(self,nodeInfo,port,0);
+            }
+         }
+      }
+      //4. resolve the final provider of each signature once
+      if (hasNewProvider != 0)
+      {
+         for (i=0;i<numAttached;i++)
+         {
+            apx_nodeInfo_t *nodeInfo = (apx_nodeInfo_t*) adt_ary_value(&attached,i);
+            int32_t providePortLen = adt_ary_length(&nodeInfo->node->providePortList);
+            for (j=0;j<providePortLen;j++)
+            {
+               apx_port_t *port = apx_node_getProvidePort(nodeInfo->node,j);
+               int32_t portSignatureId = apx_port_getPortSignatureId(port);
+               if ( (portSignatureId != APX_PORT_SIGNATURE_ID_INVALID) && (hasNewProvider[portSignatureId] != 0) )
+               {
+                  hasNewProvider[portSignatureId] = 0;
+                  apx_router_connectToLastProvider(self, apx_router_findPortMapEntry(self, port));
+               }
+            }
+         }
+         free(hasNewProvider);
+      }
+      //5. update the data triggers of all affected nodes
+      apx_router_postProcessNodes(self);
+      if (self->debugMode == APX_DEBUG_1_PROFILE)
+      {
+         APX_LOG_DEBUG("[APX_ROUTER] done attaching %d nodes", (int) numAttached);
+      }
+      adt_ary_destroy(&attached);
+   }
+}
+
+/**
+ * Detaches numNodeInfos nodes at once. The ports of all nodes are removed before the require ports they provided are rerouted,
+ * a signal is never rerouted to a provider that is detached by the same call. Nodes that are not attached are ignored.
+ */
+void apx_router_detachNodeInfos(apx_router_t *self, apx_nodeInfo_t **nodeInfos, int32_t numNodeInfos)
+{
+   if ( (self != 0) && (nodeInfos != 0) && (numNodeInfos > 0) )
+   {
+      int32_t i;
+      int32_t j;
+      int32_t numDetached = 0;
+      int32_t numRequireRefs;
+      int32_t nodeInfoListLen;
+      apx_nodeInfo_t **detached; //nodeInfos detached by this call, sorted by address
+      adt_ary_t requireRefs; //array of apx_portref_t*
+
+      detached = (apx_nodeInfo_t**) malloc(numNodeInfos*sizeof(apx_nodeInfo_t*));
+      if (detached == 0)
+      {
+         //out of memory, detach one at a time
+         for (i=0;i<numNodeInfos;i++)
+         {
+            apx_router_detachNodeInfo(self, nodeInfos[i]);
+         }
+         return;
+      }
+      for (i=0;i<numNodeInfos;i++)
+      {
+         if ( (nodeInfos[i] != 0) && (nodeInfos[i]->dirtyList == &self->dirtyNodeInfoList) )
+         {
+            detached[numDetached++] = nodeInfos[i];
+         }
+      }
+      qsort(detached, numDetached, sizeof(apx_nodeInfo_t*), apx_router_compareNodeInfo);
+      //1. remove the nodes from nodeInfoList in a single pass
+      nodeInfoListLen = adt_ary_length(&self->nodeInfoList);
+      for (i=0,j=0;i<nodeInfoListLen;i++)
+      {
+         apx_nodeInfo_t *elem = (apx_nodeInfo_t*) adt_ary_value(&self->nodeInfoList,i);
+         if (apx_router_isInNodeInfoSet(detached, numDetached, elem) == false)
+         {
+            adt_ary_set(&self->nodeInfoList, j++, elem);
+         }
+      }
+      adt_ary_resize(&self->nodeInfoList, j);
+      //2. detach all ports from the portMap
+      for (i=0;i<numDetached;i++)
+      {
+         apx_node_t *node = detached[i]->node;
+         int32_t requirePortLen = adt_ary_length(&node->requirePortList);
+         int32_t providePortLen = adt_ary_length(&node->providePortList);
+         APX_LOG_DEBUG("[APX_ROUTER] Detaching %s", node->name);
+         for (j=0;j<requirePortLen;j++)
+         {
+            apx_router_detachPortFromPortMap(self,node,apx_node_getRequirePort(node,j));
+         }
+         for (j=0;j<providePortLen;j++)
+         {
+            apx_router_detachPortFromPortMap(self,node,apx_node_getProvidePort(node,j));
+         }
+      }
+      //3. collect the require ports of the remaining nodes that lose their provider, then disconnect all ports
+      adt_ary_create(&requireRefs,apx_portref_vdelete);
+      for (i=0;i<numDetached;i++)
+      {
+         apx_router_build_requireRefs(detached[i],&requireRefs);
+      }
+      for (i=0;i<numDetached;i++)
+      {
+         apx_nodeInfo_t *nodeInfo = detached[i];
+         int32_t requirePortLen = adt_ary_length(&nodeInfo->node->requirePortList);
+         int32_t providePortLen = adt_ary_length(&nodeInfo->node->providePortList);
+         for (j=0;j<requirePortLen;j++)
+         {
+            apx_nodeInfo_disconnectRequirePort(nodeInfo,j);
+         }
+         for (j=0;j<providePortLen;j++)
+         {
+            apx_nodeInfo_disconnectProvidePort(nodeInfo,j);
+         }
+      }
+      //4. reroute the remaining require ports using the default rule
+      numRequireRefs = adt_ary_length(&requireRefs);
+      for (i=0;i<numRequireRefs;i++)
+      {
+         apx_portref_t *portref = (apx_portref_t*) adt_ary_value(&requireRefs,i);
+         apx_nodeInfo_t *requesterNodeInfo = portref->node->nodeInfo;
+         if (apx_router_isInNodeInfoSet(detached, numDetached, requesterNodeInfo) == false)
+         {
+            (void)apx_router_createDefaultPortConnector(self,requesterNodeInfo,portref->port,0);
+         }
+      }
+      adt_ary_destroy(&requireRefs);
+      //the detached nodeInfos are still in the dirty list, they need their data triggers updated as well
+      apx_router_postProcessNodes(self);
+      for (i=0;i<numDetached;i++)
+      {
+         apx_nodeInfo_setDirtyList(detached[i], (adt_ary_t*) 0);
+      }
+      free(detached);
    }
 }
 
@@ -261,19 +491,16 @@ static void apx_router_attachPortToPortMap(apx_router_t *self, apx_node_t *node,
 {
    if ( (self != 0) && (node != 0) && (port != 0) )
    {
-      apx_routerPortMapEntry_t *portMapEntry = (apx_routerPortMapEntry_t*) 0;
-      void **ptr;
-      const char *psg = apx_port_getPortSignature(port);
-      ptr = adt_hash_get(&self->portMap,psg,0);
-      if (ptr == 0)
+      apx_routerPortMapEntry_t *portMapEntry = apx_router_findPortMapEntry(self, port);
+      if (portMapEntry == 0)
       {
          //no entry, create new entry
-         portMapEntry = apx_routerPortMapEntry_new();
-         adt_hash_set(&self->portMap,psg,0,portMapEntry);
-      }
-      else
-      {
-         portMapEntry = (apx_routerPortMapEntry_t*) *ptr;
+         int32_t portSignatureId = apx_port_getPortSignatureId(port);
+         if (portSignatureId != APX_PORT_SIGNATURE_ID_INVALID)
+         {
+            portMapEntry = apx_routerPortMapEntry_new();
+            adt_ary_set(&self->portMap, portSignatureId, portMapEntry);
+         }
       }
       if (portMapEntry != 0)
       {
@@ -286,21 +513,16 @@ static void apx_router_detachPortFromPortMap(apx_router_t *self, apx_node_t *nod
 {
    if ( (self != 0) && (node != 0) && (port != 0) )
    {
-      apx_routerPortMapEntry_t *portMapEntry = (apx_routerPortMapEntry_t*) 0;
-      void **ptr;
-      const char *psg = apx_port_getPortSignature(port);
-      ptr = adt_hash_get(&self->portMap,psg,0);
-      if (ptr == 0)
-      {
-         //no entry, this is a weird situation
-      }
-      else
-      {
-         portMapEntry = (apx_routerPortMapEntry_t*) *ptr;
-      }
+      apx_routerPortMapEntry_t *portMapEntry = apx_router_findPortMapEntry(self, port);
       if (portMapEntry != 0)
       {
          apx_routerPortMapEntry_removePort(portMapEntry,node,port);
+         if ( (apx_portrefSet_length(&portMapEntry->requirePorts) == 0) && (apx_portrefSet_length(&portMapEntry->providePorts) == 0) )
+         {
+            //the signature id is released with the last port that uses it and may then be given to another signature
+            adt_ary_set(&self->portMap, apx_port_getPortSignatureId(port), (void*) 0);
+            apx_routerPortMapEntry_delete(portMapEntry);
+         }
       }
    }
 }
@@ -312,30 +534,26 @@ static bool apx_router_createDefaultPortConnector(const apx_router_t *self, apx_
 {
    if ( (self != 0) && (nodeInfo != 0) && (port != 0) )
    {
-      apx_routerPortMapEntry_t *portMapEntry = (apx_routerPortMapEntry_t*) 0;
+      apx_routerPortMapEntry_t *portMapEntry;
       //char debugInfoStr[APX_DEBUG_INFO_MAX_LEN];
-      void **ptr;
-      const char *psg = apx_port_getPortSignature(port);
       //debugInfoStr[0]=0;
 /*      if (nodeInfo->nodeData->fileManager->debugInfo != 0)
       {
          snprintf(debugInfoStr, APX_DEBUG_INFO_MAX_LEN, " (%p)", nodeInfo->nodeData->fileManager->debugInfo);
       }*/
-      ptr = adt_hash_get(&self->portMap,psg,0);
-      if (ptr == 0)
+      portMapEntry = apx_router_findPortMapEntry(self, port);
+      if (portMapEntry == 0)
       {
          //no entry, this is a weird situation
       }
       else
       {
-         portMapEntry = (apx_routerPortMapEntry_t*) *ptr;
-
 
          if (port->portType == APX_REQUIRE_PORT)
          {
             //if port is a require port, try to find a matching provide port.
             int32_t numProvidePorts;
-            numProvidePorts = adt_ary_length(&portMapEntry->providePorts);
+            numProvidePorts = apx_portrefSet_length(&portMapEntry->providePorts);
             if (numProvidePorts > 0)
             {
                //OK, there is at least one provider for this signal.
@@ -372,7 +590,7 @@ static bool apx_router_createDefaultPortConnector(const apx_router_t *self, apx_
             //if port is a provide port, try to find all require ports and try to connect them to this new provider port
             int32_t numRequirePorts;
             int32_t i;
-            numRequirePorts = adt_ary_length(&portMapEntry->requirePorts);
+            numRequirePorts = apx_portrefSet_length(&portMapEntry->requirePorts);
             for (i=0;i<numRequirePorts;i++)
             {
                apx_portref_t *portref = apx_routerPortMapEntry_getRequirePortById(portMapEntry,i);
@@ -388,7 +606,7 @@ static bool apx_router_createDefaultPortConnector(const apx_router_t *self, apx_
                   {
                      //the require port already has a connection, the default rule is to override the requireConnector
                      //and reroute it to our new provide port.
-                     apx_nodeInfo_disconnectRequirePort(requireNodeInfo,requireConnector->port->portIndex);
+                     apx_nodeInfo_disconnectRequirePort(requireNodeInfo,requirePortIndex);
                   }
                   if (self->debugMode > APX_DEBUG_2_LOW)
                   {
@@ -415,6 +633,20 @@ static bool apx_router_createDefaultPortConnector(const apx_router_t *self, apx_
 
 
 
+/**
+ * returns the portMap entry for the signature of port or NULL if there is none.
+ * The lookup is a plain array index, the signature string was interned (and hashed) once by apx_node_finalize.
+ */
+static apx_routerPortMapEntry_t *apx_router_findPortMapEntry(const apx_router_t *self, apx_port_t *port)
+{
+   int32_t portSignatureId = apx_port_getPortSignatureId(port);
+   if (portSignatureId != APX_PORT_SIGNATURE_ID_INVALID)
+   {
+      return (apx_routerPortMapEntry_t*) adt_ary_value(&self->portMap, portSignatureId);
+   }
+   return (apx_routerPortMapEntry_t*) 0;
+}
+
 static void apx_router_build_requireRefs(apx_nodeInfo_t *nodeInfo, adt_ary_t *requireRefs)
 {
    int32_t providePortLen;
@@ -446,21 +678,23 @@ static void apx_router_build_requireRefs(apx_nodeInfo_t *nodeInfo, adt_ary_t *re
    }
 }
 
-static void apx_router_postProcessNodes(const apx_router_t *self, apx_nodeInfo_t *detachedNodeInfo)
+/**
+ * processes the nodes whose port flags were set since the last call, these nodes added themselves to dirtyNodeInfoList.
+ * The time spent here depends on the number of changed nodes instead of the number of attached nodes.
+ */
+static void apx_router_postProcessNodes(apx_router_t *self)
 {
    int32_t numNodes;
    int32_t i;
-   numNodes = adt_ary_length(&self->nodeInfoList);
+   numNodes = adt_ary_length(&self->dirtyNodeInfoList);
    for (i=0;i<numNodes;i++)
    {
-      apx_nodeInfo_t *nodeInfo = (apx_nodeInfo_t*) adt_ary_value(&self->nodeInfoList,i);
+      apx_nodeInfo_t *nodeInfo = (apx_nodeInfo_t*) adt_ary_value(&self->dirtyNodeInfoList,i);
       assert(nodeInfo != 0);
+      nodeInfo->isDirty = false;
       apx_router_postProcessNode(nodeInfo, self->debugMode);
    }
-   if (detachedNodeInfo != 0) //detachedNodeInfo is the nodeInfo that is no longer in self->nodeInfoList
-   {
-      apx_router_postProcessNode(detachedNodeInfo, self->debugMode);
-   }
+   adt_ary_clear(&self->dirtyNodeInfoList);
 }
 
 static void apx_router_postProcessNode(apx_nodeInfo_t *nodeInfo, int8_t debugMode)
@@ -471,6 +705,8 @@ static void apx_router_postProcessNode(apx_nodeInfo_t *nodeInfo, int8_t debugMod
       int32_t numProvidePorts = adt_ary_length(&nodeInfo->node->providePortList);
       adt_str_t *str = adt_str_new();
 
+      //all trigger changes of this node are published to the data path as a single new snapshot
+      apx_dataTriggerTable_beginUpdate(&nodeInfo->outDataTriggerTable);
       for(i=0;i<numProvidePorts;i++)
       {
          if (nodeInfo->providePortFlags[i] != 0)
@@ -526,9 +762,11 @@ static void apx_router_postProcessNode(apx_nodeInfo_t *nodeInfo, int8_t debugMod
             }
          }
       }
+      apx_dataTriggerTable_commitUpdate(&nodeInfo->outDataTriggerTable);
       adt_str_delete(str);
-      //clear flags
+      //clear flags, the counter is also reset since a port flagged twice is only counted down once
       memset(nodeInfo->providePortFlags,0,numProvidePorts);
+      nodeInfo->pendingProvidePortFlags = 0;
    }
    if (nodeInfo->pendingRequirePortFlags>0)
    {
@@ -564,5 +802,85 @@ static void apx_router_postProcessNode(apx_nodeInfo_t *nodeInfo, int8_t debugMod
       }
       //clear flags
       memset(nodeInfo->requirePortFlags,0,numRequirePorts);
+      nodeInfo->pendingRequirePortFlags = 0;
+   }
+}
+
+/**
+ * connects every require port of the signature to its last provider, which is the result of attaching its providers one at a time
+ */
+static void apx_router_connectToLastProvider(const apx_router_t *self, apx_routerPortMapEntry_t *portMapEntry)
+{
+   int32_t numProvidePorts;
+   int32_t numRequirePorts;
+   int32_t i;
+   apx_portref_t *provider;
+   apx_nodeInfo_t *providerNodeInfo;
+   if (portMapEntry == 0)
+   {
+      return;
+   }
+   numProvidePorts = apx_portrefSet_length(&portMapEntry->providePorts);
+   if (numProvidePorts == 0)
+   {
+      return;
+   }
+   provider = apx_routerPortMapEntry_getProvidePortById(portMapEntry,numProvidePorts-1);
+   if ( (provider == 0) || (provider->node == 0) || (provider->port == 0) || (provider->node->nodeInfo == 0) )
+   {
+      return;
+   }
+   providerNodeInfo = provider->node->nodeInfo;
+   numRequirePorts = apx_portrefSet_length(&portMapEntry->requirePorts);
+   for (i=0;i<numRequirePorts;i++)
+   {
+      apx_portref_t *portref = apx_routerPortMapEntry_getRequirePortById(portMapEntry,i);
+      if ( (portref != 0) && (portref->node != 0) && (portref->port != 0) )
+      {
+         apx_nodeInfo_t *requireNodeInfo = portref->node->nodeInfo;
+         int32_t requirePortIndex = portref->port->portIndex;
+         apx_portref_t *requireConnector = apx_nodeInfo_getRequirePortConnector(requireNodeInfo,requirePortIndex);
+         if (requireConnector != 0)
+         {
+            if ( (requireConnector->node == provider->node) && (requireConnector->port == provider->port) )
+            {
+               continue; //already connected to the final provider
+            }
+            apx_nodeInfo_disconnectRequirePort(requireNodeInfo,requirePortIndex);
+         }
+         if (self->debugMode > APX_DEBUG_2_LOW)
+         {
+            int32_t requirePortOffset;
+            int32_t providePortOffset;
+            requirePortOffset = apx_nodeInfo_getInPortDataOffset(requireNodeInfo, requirePortIndex);
+            providePortOffset = apx_nodeInfo_getOutPortDataOffset(providerNodeInfo, provider->port->portIndex);
+            APX_LOG_DEBUG("   %s/%s[%d] -> %s/%s[%d]",provider->node->name, provider->port->name, providePortOffset,
+                  portref->node->name,portref->port->name, requirePortOffset);
+         }
+         apx_nodeInfo_connectPort(providerNodeInfo, provider->port->portIndex, requireNodeInfo, requirePortIndex);
+      }
+   }
+}
+
+static int apx_router_compareNodeInfo(const void *a, const void *b)
+{
+   const apx_nodeInfo_t *lhs = *(apx_nodeInfo_t * const *) a;
+   const apx_nodeInfo_t *rhs = *(apx_nodeInfo_t * const *) b;
+   if (lhs < rhs)
+   {
+      return -1;
+   }
+   return (lhs > rhs)? 1 : 0;
+}
+
+/**
+ * nodeInfoSet must be sorted by apx_router_compareNodeInfo
+ */
+static bool apx_router_isInNodeInfoSet(apx_nodeInfo_t **nodeInfoSet, int32_t setLen, apx_nodeInfo_t *nodeInfo)
+{
+   if (setLen == 0)
+   {
+      return false;
    }
+   return (bsearch(&nodeInfo, nodeInfoSet, setLen, sizeof(apx_nodeInfo_t*), apx_router_compareNodeInfo) != 0)? true : false;
 }
@@ -37,8 +37,8 @@ void apx_routerPortMapEntry_create(apx_routerPortMapEntry_t *self)
 {
    if (self != 0)
    {
-      adt_ary_create(&self->requirePorts,apx_portref_vdelete);
-      adt_ary_create(&self->providePorts,apx_portref_vdelete);
+      apx_portrefSet_create(&self->requirePorts);
+      apx_portrefSet_create(&self->providePorts);
    }
 }
 
@@ -46,8 +46,8 @@ void apx_routerPortMapEntry_destroy(apx_routerPortMapEntry_t *self)
 {
    if (self != 0)
    {
-      adt_ary_destroy(&self->requirePorts);
-      adt_ary_destroy(&self->providePorts);
+      apx_portrefSet_destroy(&self->requirePorts);
+      apx_portrefSet_destroy(&self->providePorts);
    }
 }
 
@@ -81,46 +81,24 @@ int8_t apx_routerPortMapEntry_insertPort(apx_routerPortMapEntry_t *self, apx_nod
 {
    if ( (self != 0) && (node != 0) && (port != 0) )
    {
-      int32_t i;
-      int32_t end;
-      adt_ary_t *portrefList = 0;
-      apx_portref_t *portref = apx_portref_new(node,port);
-
-      if (portref == 0)
-      {
-         return -1; //apx_portref_new should already have set errno
-      }
-      if (portref->port->portType == APX_REQUIRE_PORT)
+      apx_portrefSet_t *portrefSet = 0;
+      if (port->portType == APX_REQUIRE_PORT)
       {
-         portrefList = &self->requirePorts;
+         portrefSet = &self->requirePorts;
       }
-      else if (portref->port->portType == APX_PROVIDE_PORT)
+      else if (port->portType == APX_PROVIDE_PORT)
       {
-         portrefList = &self->providePorts;
+         portrefSet = &self->providePorts;
       }
       else
       {
-         apx_portref_delete(portref);
          errno = EINVAL;
          return -1;
       }
-      //prevent the user from adding the same port reference twice.
-      assert(portrefList != 0);
-      end = adt_ary_length(portrefList);
-      for (i=0;i<end;i++)
-      {
-         apx_portref_t *elem = (apx_portref_t*) adt_ary_value(portrefList,i);
-         if (apx_portref_equals(elem,portref) != 0)
-         {
-            //the portref already exists in this list, take no more action
-            apx_portref_delete(portref);
-            return 0;
-         }
-      }
-      //New portref.
-      //Add it to portrefList, destruction of portref will be automatically taken care of when destructor of apx_routerPortMapEntry_t is called.
-      adt_ary_push(portrefList,portref);
-      return 0;
+      //the set prevents the user from adding the same port reference twice.
+      //destruction of the portref will be automatically taken care of when destructor of apx_routerPortMapEntry_t is called.
+      assert(portrefSet != 0);
+      return apx_portrefSet_insert(portrefSet,node,port);
    }
    errno = EINVAL;
    return -1;
@@ -162,38 +140,23 @@ int8_t apx_routerPortMapEntry_removePort(apx_routerPortMapEntry_t *self, apx_nod
 {
    if ( (self != 0) && (node != 0) && (port != 0) )
    {
-      int32_t i;
-      int32_t end;
-      apx_portref_t portref;
-      adt_ary_t *portrefList = 0;
-      apx_portref_create(&portref,node,port);
-      if (portref.port->portType == APX_REQUIRE_PORT)
+      apx_portrefSet_t *portrefSet = 0;
+      if (port->portType == APX_REQUIRE_PORT)
       {
-         portrefList = &self->requirePorts;
+         portrefSet = &self->requirePorts;
       }
-      else if (portref.port->portType == APX_PROVIDE_PORT)
+      else if (port->portType == APX_PROVIDE_PORT)
       {
-         portrefList = &self->providePorts;
+         portrefSet = &self->providePorts;
       }
       else
       {
          errno = EINVAL;
          return -1;
       }
-      assert(portrefList != 0);
-      end = adt_ary_length(portrefList);
-      for (i=0;i<end;i++)
-      {
-         apx_portref_t *elem = (apx_portref_t*) adt_ary_value(portrefList,i);
-         if (apx_portref_equals(elem,&portref) != 0)
-         {
-            //found in list, we can now remove it and shorten the list.
-            //using the adt_ary_splice method will both shorten the list and destroy the object (it calls apx_portref_vdelete)
-            adt_ary_splice(portrefList,i,1);
-            break;
-         }
-      }
-      apx_portref_destroy(&portref); //nothing is actually destroyed here but call is made here to match call to the constructor
+      assert(portrefSet != 0);
+      //the set keeps the order of the remaining ports, the last provide port is still the last one attached
+      (void) apx_portrefSet_remove(portrefSet,node,port);
       return 0;
    }
    errno=EINVAL;
@@ -208,12 +171,7 @@ apx_portref_t *apx_routerPortMapEntry_getProvidePortById(apx_routerPortMapEntry_
 {
    if (self != 0)
    {
-      int32_t length = adt_ary_length(&self->providePorts);
-
-      if( (index >= 0) && (index < length) )
-      {
-         return (apx_portref_t*) *adt_ary_get(&self->providePorts,index);
-      }
+      return apx_portrefSet_get(&self->providePorts,index);
    }
    return (apx_portref_t*) 0;
 }
@@ -227,12 +185,7 @@ apx_portref_t *apx_routerPortMapEntry_getRequirePortById(apx_routerPortMapEntry_
 {
    if (self != 0)
    {
-      int32_t length = adt_ary_length(&self->requirePorts);
-
-      if( (index >= 0) && (index < length) )
-      {
-         return (apx_portref_t*) *adt_ary_get(&self->requirePorts,index);
-      }
+      return apx_portrefSet_get(&self->requirePorts,index);
    }
    return (apx_portref_t*) 0;
 }
@@ -0,0 +1,88 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <stdlib.h>
+#include <errno.h>
+#include "apx_sharedPayload.h"
+#include "apx_atomic.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+ * allocates header and data in a single block. The returned payload has a reference count of 1.
+ */
+apx_sharedPayload_t *apx_sharedPayload_new(uint32_t dataLen)
+{
+   apx_sharedPayload_t *self = (apx_sharedPayload_t*) malloc(sizeof(apx_sharedPayload_t) + dataLen);
+   if (self != 0)
+   {
+      self->refCount = 1;
+      self->dataLen = dataLen;
+      self->data = ((uint8_t*) self) + sizeof(apx_sharedPayload_t);
+   }
+   else
+   {
+      errno = ENOMEM;
+   }
+   return self;
+}
+
+void apx_sharedPayload_ref(apx_sharedPayload_t *self)
+{
+   if (self != 0)
+   {
+      (void) APX_ATOMIC_INCREMENT(self->refCount);
+   }
+}
+
+/**
+ * releases one reference, the payload is freed when the last reference is released
+ */
+void apx_sharedPayload_unref(apx_sharedPayload_t *self)
+{
+   if (self != 0)
+   {
+      if (APX_ATOMIC_DECREMENT(self->refCount) == 0)
+      {
+         free(self);
+      }
+   }
+}
+
+int32_t apx_sharedPayload_getRefCount(apx_sharedPayload_t *self)
+{
+   if (self != 0)
+   {
+      return self->refCount;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
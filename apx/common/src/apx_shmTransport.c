@@ -0,0 +1,612 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "apx_shmTransport.h"
+#if APX_SHM_TRANSPORT_ENABLE
+#include <errno.h>
+#include <malloc.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include "apx_atomic.h"
+#include "apx_logging.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#define APX_SHM_MAGIC   0x41505853u //"APXS"
+#define APX_SHM_VERSION 1u
+#define APX_SHM_REQUIRED_SEALS (F_SEAL_SHRINK | F_SEAL_GROW) //the size of the region can't change after it has been mapped
+
+typedef struct apx_shmNotification_tag
+{
+   uint32_t address; //RMF address of the write
+   uint32_t dataStart; //free running position of the first data byte in the data area
+   uint32_t dataLen;
+   uint32_t reserved;
+}apx_shmNotification_t;
+
+/**
+ * One direction of the transport. head and dataHead are only written by the producer, tail and dataTail only by the consumer.
+ */
+typedef struct apx_shmChannel_tag
+{
+   volatile uint32_t head; //number of published notifications
+   volatile uint32_t dataHead; //free running write position in data
+   uint8_t pad1[56]; //keep producer and consumer variables on separate cache lines
+   volatile uint32_t tail; //number of consumed notifications
+   volatile uint32_t dataTail; //free running release position in data
+   volatile int32_t isWaiting; //1 while the consumer sleeps on its eventfd
+   uint8_t pad2[52];
+   apx_shmNotification_t notifications[APX_SHM_NUM_NOTIFICATIONS];
+   uint8_t data[APX_SHM_DATA_SIZE];
+}apx_shmChannel_t;
+
+typedef struct apx_shmRegion_tag
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t numNotifications;
+   uint32_t dataSize;
+   volatile int32_t isAttached; //set by the server before it acknowledges the greeting
+   uint8_t pad[44];
+   apx_shmChannel_t channels[APX_SHM_NUM_CHANNELS];
+}apx_shmRegion_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static void apx_shmTransport_init(apx_shmTransport_t *self);
+static int8_t apx_shmTransport_map(apx_shmTransport_t *self);
+static int8_t apx_shmTransport_verifyMemFd(apx_shmTransport_t *self);
+static int apx_shmTransport_getRemoteFd(int pidFd, int remoteFd);
+static bool apx_shmTransport_reserve(apx_shmChannel_t *channel, uint32_t dataLen, uint32_t *dataStart);
+static bool apx_shmTransport_waitEmpty(apx_shmChannel_t *channel);
+static void apx_shmTransport_signal(apx_shmTransport_t *self, uint8_t channelId);
+static uint32_t apx_shmTransport_getTimeMs(void);
+static THREAD_PROTO(receiveTask,arg);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+ * creates a new shared memory region (client side). The server side is created using apx_shmTransport_attach.
+ * returns 0 on success, -1 on error
+ */
+int8_t apx_shmTransport_create(apx_shmTransport_t *self)
+{
+   if (self != 0)
+   {
+      int i;
+      apx_shmTransport_init(self);
+      self->isCreator = true;
+      self->txChannel = APX_SHM_CHANNEL_CLIENT_TO_SERVER;
+      self->rxChannel = APX_SHM_CHANNEL_SERVER_TO_CLIENT;
+      self->memFd = (int) syscall(SYS_memfd_create, "apx_shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+      if ( (self->memFd >= 0) && (ftruncate(self->memFd, (off_t) self->regionSize) == 0) &&
+           (fcntl(self->memFd, F_ADD_SEALS, APX_SHM_REQUIRED_SEALS | F_SEAL_SEAL) == 0) && (apx_shmTransport_map(self) == 0) )
+      {
+         for (i=0; i<APX_SHM_NUM_CHANNELS; i++)
+         {
+            self->eventFd[i] = eventfd(0, EFD_CLOEXEC);
+         }
+         if ( (self->eventFd[0] >= 0) && (self->eventFd[1] >= 0) )
+         {
+            //the mapping is zero-filled by ftruncate, only the header needs to be written
+            self->region->numNotifications = APX_SHM_NUM_NOTIFICATIONS;
+            self->region->dataSize = APX_SHM_DATA_SIZE;
+            self->region->version = APX_SHM_VERSION;
+            self->region->magic = APX_SHM_MAGIC;
+            return 0;
+         }
+      }
+      apx_shmTransport_destroy(self);
+      return -1;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * attaches to a region created by apx_shmTransport_create in process pid (server side).
+ * The file descriptors are the ones announced by the client in its greeting, they are duplicated into this process using pidfd_getfd.
+ * This fails when the client runs on a different host, in a different pid namespace or as a different user.
+ * The memfd must be sealed against shrinking and growing and hold at least a full region, otherwise errno is set to EPERM.
+ * returns 0 on success, -1 on error. On error the connection keeps using the socket for all messages.
+ */
+int8_t apx_shmTransport_attach(apx_shmTransport_t *self, pid_t pid, int memFd, int eventFd0, int eventFd1)
+{
+   if (self != 0)
+   {
+      int pidFd;
+      apx_shmTransport_init(self);
+      self->txChannel = APX_SHM_CHANNEL_SERVER_TO_CLIENT;
+      self->rxChannel = APX_SHM_CHANNEL_CLIENT_TO_SERVER;
+      pidFd = (int) syscall(SYS_pidfd_open, pid, 0);
+      if (pidFd >= 0)
+      {
+         self->memFd = apx_shmTransport_getRemoteFd(pidFd, memFd);
+         self->eventFd[0] = apx_shmTransport_getRemoteFd(pidFd, eventFd0);
+         self->eventFd[1] = apx_shmTransport_getRemoteFd(pidFd, eventFd1);
+         close(pidFd);
+         if ( (self->memFd >= 0) && (self->eventFd[0] >= 0) && (self->eventFd[1] >= 0) &&
+              (apx_shmTransport_verifyMemFd(self) == 0) && (apx_shmTransport_map(self) == 0) )
+         {
+            apx_shmRegion_t *region = self->region;
+            if ( (region->magic == APX_SHM_MAGIC) && (region->version == APX_SHM_VERSION) &&
+                 (region->numNotifications == APX_SHM_NUM_NOTIFICATIONS) && (region->dataSize == APX_SHM_DATA_SIZE) )
+            {
+               APX_ATOMIC_STORE_RELEASE(region->isAttached, 1);
+               return 0;
+            }
+            errno = EPROTO;
+         }
+      }
+      apx_shmTransport_destroy(self);
+      return -1;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+void apx_shmTransport_destroy(apx_shmTransport_t *self)
+{
+   if (self != 0)
+   {
+      int i;
+      apx_shmTransport_stopReceiver(self);
+      if (self->region != 0)
+      {
+         munmap((void*) self->region, self->regionSize);
+         self->region = (apx_shmRegion_t*) 0;
+      }
+      if (self->memFd >= 0)
+      {
+         close(self->memFd);
+         self->memFd = -1;
+      }
+      for (i=0; i<APX_SHM_NUM_CHANNELS; i++)
+      {
+         if (self->eventFd[i] >= 0)
+         {
+            close(self->eventFd[i]);
+            self->eventFd[i] = -1;
+         }
+      }
+      MUTEX_DESTROY(self->txLock);
+   }
+}
+
+apx_shmTransport_t *apx_shmTransport_new(void)
+{
+   apx_shmTransport_t *self = (apx_shmTransport_t*) malloc(sizeof(apx_shmTransport_t));
+   if (self != 0)
+   {
+      int8_t result = apx_shmTransport_create(self);
+      if (result != 0)
+      {
+         free(self);
+         self = 0;
+      }
+   }
+   else
+   {
+      errno = ENOMEM;
+   }
+   return self;
+}
+
+/**
+ * creates the server side of the transport from the value of the greeting header line APX_SHM_GREETING_HEADER.
+ * peerPid is the process id of the connected client as reported by the socket (SO_PEERCRED), the greeting must announce the same pid.
+ * returns 0 if the header is malformed, announces another process (errno is set to EPERM) or the region cannot be attached
+ */
+apx_shmTransport_t *apx_shmTransport_newFromGreeting(const char *headerValue, pid_t peerPid)
+{
+   long pid;
+   int memFd;
+   int eventFd0;
+   int eventFd1;
+   if ( (headerValue != 0) && (sscanf(headerValue, "%ld %d %d %d", &pid, &memFd, &eventFd0, &eventFd1) == 4) && (pid > 0) )
+   {
+      apx_shmTransport_t *self;
+      if ( (pid_t) pid != peerPid )
+      {
+         //never duplicate file descriptors out of a process that is not at the other end of the socket
+         errno = EPERM;
+         return (apx_shmTransport_t*) 0;
+      }
+      self = (apx_shmTransport_t*) malloc(sizeof(apx_shmTransport_t));
+      if (self != 0)
+      {
+         if (apx_shmTransport_attach(self, (pid_t) pid, memFd, eventFd0, eventFd1) != 0)
+         {
+            free(self);
+            self = 0;
+         }
+      }
+      else
+      {
+         errno = ENOMEM;
+      }
+      return self;
+   }
+   errno = EINVAL;
+   return (apx_shmTransport_t*) 0;
+}
+
+void apx_shmTransport_delete(apx_shmTransport_t *self)
+{
+   if (self != 0)
+   {
+      apx_shmTransport_destroy(self);
+      free(self);
+   }
+}
+
+/**
+ * writes the greeting header line (including the ending newline) which lets the server attach to our region.
+ * returns number of characters written or -1 if buf is too small
+ */
+int32_t apx_shmTransport_getGreetingLine(apx_shmTransport_t *self, char *buf, int32_t bufLen)
+{
+   if ( (self != 0) && (buf != 0) && (self->isCreator == true) )
+   {
+      int result = snprintf(buf, (size_t) bufLen, "%s: %ld %d %d %d\n", APX_SHM_GREETING_HEADER, (long) getpid(), self->memFd, self->eventFd[0], self->eventFd[1]);
+      if ( (result > 0) && (result < bufLen) )
+      {
+         return (int32_t) result;
+      }
+      errno = ENOSPC;
+      return -1;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * returns true once the server has attached to the region. The server attaches before it acknowledges the greeting.
+ */
+bool apx_shmTransport_isAttached(apx_shmTransport_t *self)
+{
+   if ( (self != 0) && (self->region != 0) )
+   {
+      return (APX_ATOMIC_LOAD_ACQUIRE(self->region->isAttached) != 0)? true : false;
+   }
+   return false;
+}
+
+/**
+ * starts a thread which calls receivedFunc for each write made by the other side
+ */
+int8_t apx_shmTransport_startReceiver(apx_shmTransport_t *self, apx_shmTransport_received_fn *receivedFunc, void *receivedArg)
+{
+   if ( (self != 0) && (self->region != 0) && (receivedFunc != 0) && (self->receiveThreadValid == false) )
+   {
+      self->receivedFunc = receivedFunc;
+      self->receivedArg = receivedArg;
+      APX_ATOMIC_STORE_RELEASE(self->isRunning, 1);
+      if (THREAD_CREATE(self->receiveThread, receiveTask, self) != 0)
+      {
+         APX_ATOMIC_STORE_RELEASE(self->isRunning, 0);
+         return -1;
+      }
+      self->receiveThreadValid = true;
+      return 0;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+void apx_shmTransport_stopReceiver(apx_shmTransport_t *self)
+{
+   if ( (self != 0) && (self->receiveThreadValid == true) )
+   {
+      void *status;
+      uint64_t value = 1;
+      APX_ATOMIC_STORE_RELEASE(self->isRunning, 0);
+      //our copy of the eventfd is still open even if the other process has exited
+      if (write(self->eventFd[self->rxChannel], &value, sizeof(value)) < 0)
+      {
+         APX_LOG_ERROR("[APX_SHM_TRANSPORT] eventfd write failed with %d", errno);
+      }
+      pthread_join(self->receiveThread, &status);
+      self->receiveThreadValid = false;
+   }
+}
+
+/**
+ * calls receivedFunc for each pending notification in the receive channel.
+ * returns number of processed notifications or -1 when the other side has corrupted the channel
+ */
+int32_t apx_shmTransport_processReceived(apx_shmTransport_t *self)
+{
+   if ( (self != 0) && (self->region != 0) )
+   {
+      int32_t numProcessed = 0;
+      apx_shmChannel_t *channel = &self->region->channels[self->rxChannel];
+      uint32_t head = APX_ATOMIC_LOAD_ACQUIRE(channel->head);
+      uint32_t tail = channel->tail;
+      while (tail != head)
+      {
+         const apx_shmNotification_t *notification = &channel->notifications[tail & (APX_SHM_NUM_NOTIFICATIONS-1)];
+         uint32_t address = notification->address;
+         uint32_t dataStart = notification->dataStart;
+         uint32_t dataLen = notification->dataLen;
+         uint32_t pos = dataStart & (APX_SHM_DATA_SIZE-1);
+         //the other process is not trusted, never read outside of the data area
+         if ( (dataLen > APX_SHM_DATA_SIZE) || ( (pos+dataLen) > APX_SHM_DATA_SIZE ) )
+         {
+            APX_LOG_ERROR("[APX_SHM_TRANSPORT] invalid notification, offset=%u, len=%u", pos, dataLen);
+            return -1;
+         }
+         if (self->receivedFunc != 0)
+         {
+            self->receivedFunc(self->receivedArg, address, &channel->data[pos], dataLen);
+         }
+         tail++;
+         numProcessed++;
+         APX_ATOMIC_STORE_RELEASE(channel->dataTail, dataStart+dataLen);
+         APX_ATOMIC_STORE_RELEASE(channel->tail, tail);
+         if (tail == head)
+         {
+            head = APX_ATOMIC_LOAD_ACQUIRE(channel->head);
+         }
+      }
+      return numProcessed;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * copies data into the transmit channel and notifies the other side. Safe to call from several threads.
+ * Waits up to APX_SHM_SEND_TIMEOUT_MS for room when the channel is full.
+ * returns 0 on success, -1 when the data must be sent over the socket instead (errno is set to EMSGSIZE or ETIMEDOUT).
+ * Before -1 is returned all previous writes have been consumed, this keeps the order of writes when falling back to the socket.
+ */
+int8_t apx_shmTransport_write(apx_shmTransport_t *self, uint32_t address, const uint8_t *data, uint32_t dataLen)
+{
+   if ( (self != 0) && (self->region != 0) && ( (data != 0) || (dataLen == 0) ) )
+   {
+      int8_t retval = 0;
+      apx_shmChannel_t *channel = &self->region->channels[self->txChannel];
+      MUTEX_LOCK(self->txLock);
+      if (dataLen > (APX_SHM_DATA_SIZE/4))
+      {
+         (void) apx_shmTransport_waitEmpty(channel);
+         errno = EMSGSIZE;
+         retval = -1;
+      }
+      else
+      {
+         uint32_t dataStart = 0;
+         uint32_t startTime = apx_shmTransport_getTimeMs();
+         while (apx_shmTransport_reserve(channel, dataLen, &dataStart) == false)
+         {
+            if ( (apx_shmTransport_getTimeMs() - startTime) >= APX_SHM_SEND_TIMEOUT_MS )
+            {
+               errno = ETIMEDOUT;
+               retval = -1;
+               break;
+            }
+            apx_shmTransport_signal(self, self->txChannel);
+            sched_yield();
+         }
+         if (retval == 0)
+         {
+            uint32_t head = channel->head;
+            apx_shmNotification_t *notification = &channel->notifications[head & (APX_SHM_NUM_NOTIFICATIONS-1)];
+            memcpy(&channel->data[dataStart & (APX_SHM_DATA_SIZE-1)], data, dataLen);
+            notification->address = address;
+            notification->dataStart = dataStart;
+            notification->dataLen = dataLen;
+            channel->dataHead = dataStart + dataLen;
+            //full barrier, orders the publication against the read of isWaiting in apx_shmTransport_signal
+            (void) APX_ATOMIC_FETCH_ADD(channel->head, 1);
+            apx_shmTransport_signal(self, self->txChannel);
+         }
+      }
+      MUTEX_UNLOCK(self->txLock);
+      return retval;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+static void apx_shmTransport_init(apx_shmTransport_t *self)
+{
+   int i;
+   self->region = (apx_shmRegion_t*) 0;
+   self->regionSize = sizeof(apx_shmRegion_t);
+   self->memFd = -1;
+   for (i=0; i<APX_SHM_NUM_CHANNELS; i++)
+   {
+      self->eventFd[i] = -1;
+   }
+   self->isCreator = false;
+   self->receiveThreadValid = false;
+   self->isRunning = 0;
+   self->receivedFunc = (apx_shmTransport_received_fn*) 0;
+   self->receivedArg = (void*) 0;
+   MUTEX_INIT(self->txLock);
+}
+
+static int8_t apx_shmTransport_map(apx_shmTransport_t *self)
+{
+   void *addr = mmap(0, self->regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, self->memFd, 0);
+   if (addr == MAP_FAILED)
+   {
+      return -1;
+   }
+   self->region = (apx_shmRegion_t*) addr;
+   return 0;
+}
+
+/**
+ * checks the memfd received from the client before it is mapped. Without the seals the client could shrink the file
+ * while it's mapped, making our next access to the region raise SIGBUS.
+ */
+static int8_t apx_shmTransport_verifyMemFd(apx_shmTransport_t *self)
+{
+   struct stat fileStat;
+   int seals = fcntl(self->memFd, F_GET_SEALS);
+   if (seals < 0)
+   {
+      return -1;
+   }
+   if ( (seals & APX_SHM_REQUIRED_SEALS) != APX_SHM_REQUIRED_SEALS )
+   {
+      APX_LOG_ERROR("[APX_SHM_TRANSPORT] memfd is missing seals, seals=0x%x", (unsigned int) seals);
+      errno = EPERM;
+      return -1;
+   }
+   if (fstat(self->memFd, &fileStat) != 0)
+   {
+      return -1;
+   }
+   if ( (fileStat.st_size < 0) || ((size_t) fileStat.st_size < self->regionSize) )
+   {
+      APX_LOG_ERROR("[APX_SHM_TRANSPORT] memfd is too small, size=%ld", (long) fileStat.st_size);
+      errno = EPERM;
+      return -1;
+   }
+   return 0;
+}
+
+static int apx_shmTransport_getRemoteFd(int pidFd, int remoteFd)
+{
+   if (remoteFd < 0)
+   {
+      errno = EBADF;
+      return -1;
+   }
+   return (int) syscall(SYS_pidfd_getfd, pidFd, remoteFd, 0);
+}
+
+/**
+ * finds room for dataLen contiguous bytes in the data area, skipping the unused space at its end when needed.
+ * Only called by the producer.
+ */
+static bool apx_shmTransport_reserve(apx_shmChannel_t *channel, uint32_t dataLen, uint32_t *dataStart)
+{
+   uint32_t tail = APX_ATOMIC_LOAD_ACQUIRE(channel->tail);
+   uint32_t dataTail = APX_ATOMIC_LOAD_ACQUIRE(channel->dataTail);
+   uint32_t dataHead = channel->dataHead;
+   uint32_t pos = dataHead & (APX_SHM_DATA_SIZE-1);
+   if ( (channel->head - tail) >= APX_SHM_NUM_NOTIFICATIONS )
+   {
+      return false;
+   }
+   if ( (pos + dataLen) > APX_SHM_DATA_SIZE )
+   {
+      dataHead += (APX_SHM_DATA_SIZE - pos);
+   }
+   if ( ((dataHead + dataLen) - dataTail) > APX_SHM_DATA_SIZE )
+   {
+      return false;
+   }
+   *dataStart = dataHead;
+   return true;
+}
+
+/**
+ * waits until the consumer has processed everything in the channel, returns false on timeout
+ */
+static bool apx_shmTransport_waitEmpty(apx_shmChannel_t *channel)
+{
+   uint32_t startTime = apx_shmTransport_getTimeMs();
+   while (APX_ATOMIC_LOAD_ACQUIRE(channel->tail) != channel->head)
+   {
+      if ( (apx_shmTransport_getTimeMs() - startTime) >= APX_SHM_SEND_TIMEOUT_MS )
+      {
+         return false;
+      }
+      sched_yield();
+   }
+   return true;
+}
+
+/**
+ * wakes up the consumer of channelId if it's sleeping
+ */
+static void apx_shmTransport_signal(apx_shmTransport_t *self, uint8_t channelId)
+{
+   apx_shmChannel_t *channel = &self->region->channels[channelId];
+   if (APX_ATOMIC_FETCH_ADD(channel->isWaiting, 0) != 0)
+   {
+      uint64_t value = 1;
+      if (write(self->eventFd[channelId], &value, sizeof(value)) < 0)
+      {
+         APX_LOG_ERROR("[APX_SHM_TRANSPORT] eventfd write failed with %d", errno);
+      }
+   }
+}
+
+static uint32_t apx_shmTransport_getTimeMs(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint32_t) ( (ts.tv_sec * 1000u) + (ts.tv_nsec / 1000000u) );
+}
+
+static THREAD_PROTO(receiveTask,arg)
+{
+   apx_shmTransport_t *self = (apx_shmTransport_t*) arg;
+   if (self != 0)
+   {
+      apx_shmChannel_t *channel = &self->region->channels[self->rxChannel];
+      int fd = self->eventFd[self->rxChannel];
+      while (APX_ATOMIC_LOAD_ACQUIRE(self->isRunning) != 0)
+      {
+         if (apx_shmTransport_processReceived(self) < 0)
+         {
+            break;
+         }
+         //announce that we are about to sleep, then check once more to not miss a write made in between
+         (void) APX_ATOMIC_FETCH_ADD(channel->isWaiting, 1);
+         if (APX_ATOMIC_FETCH_ADD(channel->head, 0) == channel->tail)
+         {
+            uint64_t value;
+            if ( (read(fd, &value, sizeof(value)) < 0) && (errno != EINTR) )
+            {
+               APX_LOG_ERROR("[APX_SHM_TRANSPORT] eventfd read failed with %d", errno);
+               (void) APX_ATOMIC_FETCH_ADD(channel->isWaiting, -1);
+               break;
+            }
+         }
+         (void) APX_ATOMIC_FETCH_ADD(channel->isWaiting, -1);
+      }
+   }
+   THREAD_RETURN(0);
+}
+
+#endif //APX_SHM_TRANSPORT_ENABLE
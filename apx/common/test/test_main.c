@@ -11,17 +11,28 @@ CuSuite* testSuite_apx_node(void);
 CuSuite* testSuite_apx_parser(void);
 CuSuite* testSuite_apx_portDataMap(void);
 CuSuite* testSuite_apx_nodeInfo(void);
+CuSuite* testSuite_apx_nodeTemplate(void);
 CuSuite* testSuite_apx_routerPortMapEntry(void);
+CuSuite* testSuite_apx_portrefSet(void);
 CuSuite* testSuite_apx_router(void);
+CuSuite* testSuite_apx_rcu(void);
+CuSuite* testSuite_apx_definitionPipeline(void);
+CuSuite* testSuite_apx_definitionCache(void);
 CuSuite* testSuite_apx_dataTrigger(void);
 CuSuite* testSuite_apx_allocator(void);
+CuSuite* testSuite_apx_frameAccumulator(void);
+CuSuite* testSuite_apx_sharedPayload(void);
+CuSuite* testSuite_apx_msgQueue(void);
+CuSuite* testSuite_apx_shmTransport(void);
 CuSuite* testSuite_apx_file(void);
 CuSuite* testSuite_apx_fileMap(void);
 CuSuite* testSuite_apx_nodeData(void);
+CuSuite* testSuite_apx_nodeManager(void);
 CuSuite* testsuite_apx_attributesParser(void);
 CuSuite* testSuite_apx_dataElement(void);
 CuSuite* testSuite_remotefile(void);
 CuSuite* testSuite_apx_testServer(void);
+CuSuite* testSuite_apx_transport(void);
 CuSuite* testSuite_apx_clientSession(void);
 CuSuite* testSuite_apx_sessionCmd(void);
 
@@ -36,17 +47,28 @@ void RunAllTests(void)
    CuSuiteAddSuite(suite, testSuite_apx_parser());
    CuSuiteAddSuite(suite, testSuite_apx_portDataMap());
    CuSuiteAddSuite(suite, testSuite_apx_nodeInfo());
+   CuSuiteAddSuite(suite, testSuite_apx_nodeTemplate());
    CuSuiteAddSuite(suite, testSuite_apx_routerPortMapEntry());
+   CuSuiteAddSuite(suite, testSuite_apx_portrefSet());
    CuSuiteAddSuite(suite, testSuite_apx_router());
+   CuSuiteAddSuite(suite, testSuite_apx_rcu());
+   CuSuiteAddSuite(suite, testSuite_apx_definitionPipeline());
+   CuSuiteAddSuite(suite, testSuite_apx_definitionCache());
    CuSuiteAddSuite(suite, testSuite_apx_dataTrigger());
    CuSuiteAddSuite(suite, testSuite_apx_file());
    CuSuiteAddSuite(suite, testSuite_apx_fileMap());
    CuSuiteAddSuite(suite, testSuite_apx_nodeData());
+   CuSuiteAddSuite(suite, testSuite_apx_nodeManager());
    CuSuiteAddSuite(suite, testSuite_apx_allocator());
+   CuSuiteAddSuite(suite, testSuite_apx_frameAccumulator());
+   CuSuiteAddSuite(suite, testSuite_apx_sharedPayload());
+   CuSuiteAddSuite(suite, testSuite_apx_msgQueue());
+   CuSuiteAddSuite(suite, testSuite_apx_shmTransport());
    CuSuiteAddSuite(suite, testSuite_remotefile());
    CuSuiteAddSuite(suite, testsuite_apx_attributesParser());
    CuSuiteAddSuite(suite, testSuite_apx_dataElement());
    CuSuiteAddSuite(suite, testSuite_apx_testServer());
+   CuSuiteAddSuite(suite, testSuite_apx_transport());
    CuSuiteAddSuite(suite, testSuite_apx_clientSession());
    CuSuiteAddSuite(suite, testSuite_apx_sessionCmd());
    CuSuiteRun(suite);
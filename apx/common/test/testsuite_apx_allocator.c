@@ -22,6 +22,7 @@
 // LOCAL FUNCTION PROTOTYPES
 //////////////////////////////////////////////////////////////////////////////
 static void test_apx_allocator_create(CuTest* tc);
+static void test_apx_allocator_freeWithoutThread(CuTest* tc);
 
 //////////////////////////////////////////////////////////////////////////////
 // GLOBAL VARIABLES
@@ -42,6 +43,7 @@ CuSuite* testSuite_apx_allocator(void)
    CuSuite* suite = CuSuiteNew();
 
    SUITE_ADD_TEST(suite, test_apx_allocator_create);
+   SUITE_ADD_TEST(suite, test_apx_allocator_freeWithoutThread);
 
    return suite;
 }
@@ -78,3 +80,21 @@ static void test_apx_allocator_create(CuTest* tc)
    apx_allocator_destroy(&allocator);
 }
 
+static void test_apx_allocator_freeWithoutThread(CuTest* tc)
+{
+   int i;
+   apx_allocator_t allocator;
+   apx_allocator_create(&allocator,10);
+   //allocator is never started, more objects than maxPendingMessages are freed to verify that nothing is queued
+   for (i=0;i<100;i++)
+   {
+      uint8_t *data1 = apx_allocator_alloc(&allocator,8);
+      uint8_t *data2 = apx_allocator_alloc(&allocator,256);
+      CuAssertPtrNotNull(tc,data1);
+      CuAssertPtrNotNull(tc,data2);
+      apx_allocator_free(&allocator,data1,8);
+      apx_allocator_free(&allocator,data2,256);
+   }
+   apx_allocator_stop(&allocator);
+   apx_allocator_destroy(&allocator);
+}
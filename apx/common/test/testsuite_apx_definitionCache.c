@@ -0,0 +1,214 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "CuTest.h"
+#include "apx_definitionCache.h"
+#include "apx_definitionPipeline.h"
+#include "sha256.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+typedef struct linkSpy_tag
+{
+   int32_t numJobs;
+   int32_t numNodes;
+   int32_t numCachedJobs;
+   uint8_t inPortInitData[16];
+   int32_t inPortDataLen;
+}linkSpy_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static void test_apx_definitionCache_evictLeastRecentlyUsed(CuTest* tc);
+static void test_apx_definitionCache_entryOutlivesEviction(CuTest* tc);
+static void test_apx_definitionCache_pipelineCreatesNodesFromCache(CuTest* tc);
+static void test_apx_definitionCache_pipelineRejectsWrongDigest(CuTest* tc);
+static apx_definitionCacheEntry_t *createEntry(uint8_t id);
+static void linkSpy_link(void *arg, apx_definitionJob_t *job);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+static const char *m_apx_definition1 = "APX/1.2\n"
+      "N\"TestNode1\"\n"
+      "P\"EngineSpeed\"S\n"
+      "R\"VehicleSpeed\"S:=65535\n"
+      "R\"CabTiltLockWarning\"C(0,7):=7\n"
+      "\n";
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+
+CuSuite* testSuite_apx_definitionCache(void)
+{
+   CuSuite* suite = CuSuiteNew();
+
+   SUITE_ADD_TEST(suite, test_apx_definitionCache_evictLeastRecentlyUsed);
+   SUITE_ADD_TEST(suite, test_apx_definitionCache_entryOutlivesEviction);
+   SUITE_ADD_TEST(suite, test_apx_definitionCache_pipelineCreatesNodesFromCache);
+   SUITE_ADD_TEST(suite, test_apx_definitionCache_pipelineRejectsWrongDigest);
+
+   return suite;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+static void test_apx_definitionCache_evictLeastRecentlyUsed(CuTest* tc)
+{
+   apx_definitionCache_t cache;
+   apx_definitionCacheEntry_t *entry;
+   uint8_t digest[APX_DEFINITION_DIGEST_SIZE];
+   apx_definitionCache_create(&cache, 2);
+   apx_definitionCache_insert(&cache, createEntry(1));
+   apx_definitionCache_insert(&cache, createEntry(2));
+   CuAssertIntEquals(tc, 2, apx_definitionCache_length(&cache));
+   //using entry 1 makes entry 2 the least recently used
+   memset(digest, 1, sizeof(digest));
+   entry = apx_definitionCache_acquire(&cache, digest);
+   CuAssertPtrNotNull(tc, entry);
+   CuAssertIntEquals(tc, 1, entry->definitionBuf[0]);
+   apx_definitionCache_release(&cache, entry);
+   apx_definitionCache_insert(&cache, createEntry(3));
+   CuAssertIntEquals(tc, 2, apx_definitionCache_length(&cache));
+   memset(digest, 2, sizeof(digest));
+   CuAssertPtrEquals(tc, 0, apx_definitionCache_acquire(&cache, digest));
+   memset(digest, 3, sizeof(digest));
+   entry = apx_definitionCache_acquire(&cache, digest);
+   CuAssertPtrNotNull(tc, entry);
+   apx_definitionCache_release(&cache, entry);
+   CuAssertUIntEquals(tc, 2, apx_definitionCache_getNumHits(&cache));
+   CuAssertUIntEquals(tc, 1, apx_definitionCache_getNumMisses(&cache));
+   //an entry with a digest already in the cache is dropped
+   apx_definitionCache_insert(&cache, createEntry(3));
+   CuAssertIntEquals(tc, 2, apx_definitionCache_length(&cache));
+   apx_definitionCache_destroy(&cache);
+}
+
+static void test_apx_definitionCache_entryOutlivesEviction(CuTest* tc)
+{
+   apx_definitionCache_t cache;
+   apx_definitionCacheEntry_t *entry;
+   uint8_t digest[APX_DEFINITION_DIGEST_SIZE];
+   apx_definitionCache_create(&cache, 1);
+   apx_definitionCache_insert(&cache, createEntry(1));
+   memset(digest, 1, sizeof(digest));
+   entry = apx_definitionCache_acquire(&cache, digest);
+   CuAssertPtrNotNull(tc, entry);
+   apx_definitionCache_insert(&cache, createEntry(2));
+   CuAssertIntEquals(tc, 1, apx_definitionCache_length(&cache));
+   CuAssertPtrEquals(tc, 0, apx_definitionCache_acquire(&cache, digest));
+   //the evicted entry is deleted when the last reference is released
+   CuAssertIntEquals(tc, 4, entry->definitionLen);
+   CuAssertIntEquals(tc, 1, entry->definitionBuf[3]);
+   apx_definitionCache_release(&cache, entry);
+   apx_definitionCache_destroy(&cache);
+}
+
+static void test_apx_definitionCache_pipelineCreatesNodesFromCache(CuTest* tc)
+{
+   apx_definitionCache_t cache;
+   apx_definitionPipeline_t pipeline;
+   apx_definitionCacheEntry_t *entry;
+   linkSpy_t spy;
+   uint8_t digest[APX_DEFINITION_DIGEST_SIZE];
+   const uint8_t *definition = (const uint8_t*) m_apx_definition1;
+   int32_t definitionLen = (int32_t) strlen(m_apx_definition1);
+   memset(&spy, 0, sizeof(spy));
+   sha256_calc(definition, (uint32_t) definitionLen, digest);
+   apx_definitionCache_create(&cache, 4);
+   apx_definitionPipeline_create(&pipeline, linkSpy_link, &spy);
+   apx_definitionPipeline_setCache(&pipeline, &cache);
+   CuAssertIntEquals(tc, 0, apx_definitionPipeline_post(&pipeline, definition, definitionLen, digest, &spy));
+   CuAssertIntEquals(tc, 1, spy.numJobs);
+   CuAssertIntEquals(tc, 1, apx_definitionCache_length(&cache));
+   entry = apx_definitionCache_acquire(&cache, digest);
+   CuAssertPtrNotNull(tc, entry);
+   CuAssertIntEquals(tc, definitionLen, entry->definitionLen);
+   CuAssertIntEquals(tc, 1, apx_definitionCacheEntry_getNumNodes(entry));
+   //the pipeline takes over the reference
+   memset(spy.inPortInitData, 0, sizeof(spy.inPortInitData));
+   CuAssertIntEquals(tc, 0, apx_definitionPipeline_postCached(&pipeline, entry, &spy));
+   CuAssertIntEquals(tc, 2, spy.numJobs);
+   CuAssertIntEquals(tc, 1, spy.numCachedJobs);
+   CuAssertIntEquals(tc, 2, spy.numNodes);
+   CuAssertIntEquals(tc, 3, spy.inPortDataLen);
+   CuAssertIntEquals(tc, 0xFF, spy.inPortInitData[0]);
+   CuAssertIntEquals(tc, 0xFF, spy.inPortInitData[1]);
+   CuAssertIntEquals(tc, 7, spy.inPortInitData[2]);
+   apx_definitionPipeline_destroy(&pipeline);
+   apx_definitionCache_destroy(&cache);
+}
+
+static void test_apx_definitionCache_pipelineRejectsWrongDigest(CuTest* tc)
+{
+   apx_definitionCache_t cache;
+   apx_definitionPipeline_t pipeline;
+   linkSpy_t spy;
+   uint8_t digest[APX_DEFINITION_DIGEST_SIZE];
+   const uint8_t *definition = (const uint8_t*) m_apx_definition1;
+   int32_t definitionLen = (int32_t) strlen(m_apx_definition1);
+   memset(&spy, 0, sizeof(spy));
+   memset(digest, 0, sizeof(digest));
+   apx_definitionCache_create(&cache, 4);
+   apx_definitionPipeline_create(&pipeline, linkSpy_link, &spy);
+   apx_definitionPipeline_setCache(&pipeline, &cache);
+   //the node is still created, but the definition is not cached under a digest it does not have
+   CuAssertIntEquals(tc, 0, apx_definitionPipeline_post(&pipeline, definition, definitionLen, digest, &spy));
+   CuAssertIntEquals(tc, 1, spy.numNodes);
+   CuAssertIntEquals(tc, 0, apx_definitionCache_length(&cache));
+   apx_definitionPipeline_destroy(&pipeline);
+   apx_definitionCache_destroy(&cache);
+}
+
+/**
+ * creates an entry without nodes where every byte of the digest and of the 4 byte definition is id
+ */
+static apx_definitionCacheEntry_t *createEntry(uint8_t id)
+{
+   uint8_t digest[APX_DEFINITION_DIGEST_SIZE];
+   uint8_t definition[4];
+   memset(digest, id, sizeof(digest));
+   memset(definition, id, sizeof(definition));
+   return apx_definitionCacheEntry_new(digest, definition, (int32_t) sizeof(definition));
+}
+
+static void linkSpy_link(void *arg, apx_definitionJob_t *job)
+{
+   int32_t i;
+   int32_t numNodes = adt_ary_length(&job->preparedNodes);
+   linkSpy_t *self = (linkSpy_t*) arg;
+   for (i=0; i<numNodes; i++)
+   {
+      apx_preparedNode_t *preparedNode = (apx_preparedNode_t*) adt_ary_value(&job->preparedNodes, i);
+      assert(preparedNode->nodeInfo != 0);
+      if ( (preparedNode->inPortInitData != 0) && (preparedNode->inPortDataLen <= (int32_t) sizeof(self->inPortInitData)) )
+      {
+         memcpy(self->inPortInitData, preparedNode->inPortInitData, preparedNode->inPortDataLen);
+      }
+      self->inPortDataLen = preparedNode->inPortDataLen;
+   }
+   if (job->cacheEntry != 0)
+   {
+      self->numCachedJobs++;
+   }
+   self->numNodes += numNodes;
+   self->numJobs++;
+}
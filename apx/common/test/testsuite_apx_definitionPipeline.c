@@ -0,0 +1,342 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#ifdef APX_ENABLE_BENCHMARK
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+#endif
+#include "CuTest.h"
+#include "apx_atomic.h"
+#include "apx_definitionPipeline.h"
+#ifdef APX_ENABLE_BENCHMARK
+#include "apx_router.h"
+#include "apx_rcu.h"
+#endif
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#if defined(_MSC_VER) && (_MSC_VER<=1800)
+#define snprintf _snprintf
+#endif
+
+#define APX_TEST_NUM_JOBS 50
+#define APX_TEST_DEFINITION_LEN 1024
+
+#ifdef APX_ENABLE_BENCHMARK
+#define APX_BENCHMARK_NUM_CLIENTS 1000 //number of clients connecting at the same time
+#define APX_BENCHMARK_NUM_PROVIDE_PORTS 10
+#define APX_BENCHMARK_NUM_REQUIRE_PORTS 20
+
+typedef struct benchmarkRouter_tag
+{
+   apx_router_t router;
+   adt_ary_t nodeInfoList; //strong references to the attached apx_nodeInfo_t
+}benchmarkRouter_t;
+#endif
+
+typedef struct linkSpy_tag
+{
+   volatile int32_t numJobs;
+   volatile int32_t numNodes;
+   volatile int32_t isLinking; //set while a job of blockedOwner is inside the link function
+   volatile int32_t isReleased; //the link function waits for this when called with a job of blockedOwner
+   void *blockedOwner;
+   uint8_t inPortInitData[16];
+   int32_t inPortDataLen;
+}linkSpy_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static void test_apx_definitionPipeline_inlineWithoutWorkers(CuTest* tc);
+static void test_apx_definitionPipeline_workersLinkEveryJob(CuTest* tc);
+static void test_apx_definitionPipeline_cancelDropsQueuedJobs(CuTest* tc);
+#ifdef APX_ENABLE_BENCHMARK
+static void test_apx_definitionPipeline_benchmarkConnectStorm(CuTest* tc);
+static void attachToRouter(void *arg, apx_definitionJob_t *job);
+static double getWallClockSec(void);
+#endif
+static void linkSpy_create(linkSpy_t *self);
+static void linkSpy_link(void *arg, apx_definitionJob_t *job);
+static int32_t createDefinition(char *buf, int32_t bufLen, int32_t clientId, int32_t numClients);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+static const char *m_apx_definition1 = "APX/1.2\n"
+      "N\"TestNode1\"\n"
+      "P\"EngineSpeed\"S\n"
+      "R\"VehicleSpeed\"S:=65535\n"
+      "R\"CabTiltLockWarning\"C(0,7):=7\n"
+      "\n";
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+
+CuSuite* testSuite_apx_definitionPipeline(void)
+{
+   CuSuite* suite = CuSuiteNew();
+
+   SUITE_ADD_TEST(suite, test_apx_definitionPipeline_inlineWithoutWorkers);
+   SUITE_ADD_TEST(suite, test_apx_definitionPipeline_workersLinkEveryJob);
+   SUITE_ADD_TEST(suite, test_apx_definitionPipeline_cancelDropsQueuedJobs);
+#ifdef APX_ENABLE_BENCHMARK
+   SUITE_ADD_TEST(suite, test_apx_definitionPipeline_benchmarkConnectStorm);
+#endif
+
+   return suite;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+static void test_apx_definitionPipeline_inlineWithoutWorkers(CuTest* tc)
+{
+   apx_definitionPipeline_t pipeline;
+   linkSpy_t spy;
+   const uint8_t *definition = (const uint8_t*) m_apx_definition1;
+   linkSpy_create(&spy);
+   apx_definitionPipeline_create(&pipeline, linkSpy_link, &spy);
+   CuAssertIntEquals(tc, 0, apx_definitionPipeline_start(&pipeline, 0));
+   CuAssertIntEquals(tc, 0, apx_definitionPipeline_getNumWorkers(&pipeline));
+   CuAssertIntEquals(tc, -1, apx_definitionPipeline_post(&pipeline, definition, 0, (const uint8_t*) 0, &spy));
+   //without workers the job has been linked when post returns
+   CuAssertIntEquals(tc, 0, apx_definitionPipeline_post(&pipeline, definition, (int32_t) strlen(m_apx_definition1), (const uint8_t*) 0, &spy));
+   CuAssertIntEquals(tc, 1, spy.numJobs);
+   CuAssertIntEquals(tc, 1, spy.numNodes);
+   CuAssertIntEquals(tc, 3, spy.inPortDataLen);
+   CuAssertIntEquals(tc, 0xFF, spy.inPortInitData[0]);
+   CuAssertIntEquals(tc, 0xFF, spy.inPortInitData[1]);
+   CuAssertIntEquals(tc, 7, spy.inPortInitData[2]);
+   apx_definitionPipeline_destroy(&pipeline);
+}
+
+static void test_apx_definitionPipeline_workersLinkEveryJob(CuTest* tc)
+{
+   int32_t i;
+   apx_definitionPipeline_t pipeline;
+   linkSpy_t spy;
+   char *definitions = (char*) malloc(APX_TEST_NUM_JOBS * APX_TEST_DEFINITION_LEN);
+   CuAssertPtrNotNull(tc, definitions);
+   linkSpy_create(&spy);
+   apx_definitionPipeline_create(&pipeline, linkSpy_link, &spy);
+   CuAssertIntEquals(tc, 0, apx_definitionPipeline_start(&pipeline, 3));
+   CuAssertIntEquals(tc, 3, apx_definitionPipeline_getNumWorkers(&pipeline));
+   for (i=0; i<APX_TEST_NUM_JOBS; i++)
+   {
+      char *definition = &definitions[i*APX_TEST_DEFINITION_LEN];
+      int32_t definitionLen = createDefinition(definition, APX_TEST_DEFINITION_LEN, i, APX_TEST_NUM_JOBS);
+      CuAssertTrue(tc, definitionLen > 0);
+      CuAssertIntEquals(tc, 0, apx_definitionPipeline_post(&pipeline, (const uint8_t*) definition, definitionLen, (const uint8_t*) 0, &definitions[i]));
+   }
+   apx_definitionPipeline_flush(&pipeline);
+   CuAssertIntEquals(tc, APX_TEST_NUM_JOBS, spy.numJobs);
+   CuAssertIntEquals(tc, APX_TEST_NUM_JOBS, spy.numNodes);
+   apx_definitionPipeline_stop(&pipeline);
+   CuAssertIntEquals(tc, 0, apx_definitionPipeline_getNumWorkers(&pipeline));
+   apx_definitionPipeline_destroy(&pipeline);
+   free(definitions);
+}
+
+static void test_apx_definitionPipeline_cancelDropsQueuedJobs(CuTest* tc)
+{
+   apx_definitionPipeline_t pipeline;
+   linkSpy_t spy;
+   int32_t owner1;
+   int32_t owner2;
+   const uint8_t *definition = (const uint8_t*) m_apx_definition1;
+   int32_t definitionLen = (int32_t) strlen(m_apx_definition1);
+   linkSpy_create(&spy);
+   spy.blockedOwner = &owner1;
+   apx_definitionPipeline_create(&pipeline, linkSpy_link, &spy);
+   CuAssertIntEquals(tc, 0, apx_definitionPipeline_start(&pipeline, 1));
+   CuAssertIntEquals(tc, 0, apx_definitionPipeline_post(&pipeline, definition, definitionLen, (const uint8_t*) 0, &owner1));
+   //the only worker is now held inside the link function, the jobs below stay in the queue
+   while (APX_ATOMIC_LOAD_ACQUIRE(spy.isLinking) == 0)
+   {
+      SLEEP(1);
+   }
+   CuAssertIntEquals(tc, 0, apx_definitionPipeline_post(&pipeline, definition, definitionLen, (const uint8_t*) 0, &owner2));
+   CuAssertIntEquals(tc, 0, apx_definitionPipeline_post(&pipeline, definition, definitionLen, (const uint8_t*) 0, &owner1));
+   CuAssertIntEquals(tc, 0, apx_definitionPipeline_post(&pipeline, definition, definitionLen, (const uint8_t*) 0, &owner2));
+   apx_definitionPipeline_cancel(&pipeline, &owner2);
+   APX_ATOMIC_STORE_RELEASE(spy.isReleased, 1);
+   apx_definitionPipeline_flush(&pipeline);
+   CuAssertIntEquals(tc, 2, spy.numJobs);
+   //nothing left to cancel, returns immediately
+   apx_definitionPipeline_cancel(&pipeline, &owner1);
+   apx_definitionPipeline_destroy(&pipeline);
+}
+
+#ifdef APX_ENABLE_BENCHMARK
+/**
+ * APX_BENCHMARK_NUM_CLIENTS clients send their definitions at the same time, for example when a broker restarts.
+ * Each definition is parsed and prepared by the pipeline and then attached to a router. Reports nodes per second with
+ * definitions processed inline (the connection threads) and with a growing number of worker threads.
+ */
+static void test_apx_definitionPipeline_benchmarkConnectStorm(CuTest* tc)
+{
+   int32_t numWorkers;
+   char *definitions = (char*) malloc(APX_BENCHMARK_NUM_CLIENTS * APX_TEST_DEFINITION_LEN);
+   int32_t *definitionLengths = (int32_t*) malloc(APX_BENCHMARK_NUM_CLIENTS * sizeof(int32_t));
+   CuAssertPtrNotNull(tc, definitions);
+   CuAssertPtrNotNull(tc, definitionLengths);
+   for (numWorkers = 0; numWorkers <= 4; numWorkers = (numWorkers == 0)? 1 : numWorkers*2)
+   {
+      int32_t i;
+      double start;
+      double elapsedSec;
+      benchmarkRouter_t benchmarkRouter;
+      apx_definitionPipeline_t pipeline;
+      for (i=0; i<APX_BENCHMARK_NUM_CLIENTS; i++)
+      {
+         definitionLengths[i] = createDefinition(&definitions[i*APX_TEST_DEFINITION_LEN], APX_TEST_DEFINITION_LEN, i, APX_BENCHMARK_NUM_CLIENTS);
+         CuAssertTrue(tc, definitionLengths[i] > 0);
+      }
+      apx_router_create(&benchmarkRouter.router);
+      adt_ary_create(&benchmarkRouter.nodeInfoList, apx_nodeInfo_vdelete);
+      apx_definitionPipeline_create(&pipeline, attachToRouter, &benchmarkRouter);
+      CuAssertIntEquals(tc, 0, apx_definitionPipeline_start(&pipeline, numWorkers));
+      start = getWallClockSec();
+      for (i=0; i<APX_BENCHMARK_NUM_CLIENTS; i++)
+      {
+         apx_definitionPipeline_post(&pipeline, (const uint8_t*) &definitions[i*APX_TEST_DEFINITION_LEN], definitionLengths[i], (const uint8_t*) 0, &definitions[i]);
+      }
+      apx_definitionPipeline_flush(&pipeline);
+      elapsedSec = getWallClockSec() - start;
+      printf("[apx_definitionPipeline] %d clients, %d workers: %.1f ms, %.0f nodes/s\n", APX_BENCHMARK_NUM_CLIENTS, (int) numWorkers,
+            elapsedSec*1000.0, (double) APX_BENCHMARK_NUM_CLIENTS / elapsedSec);
+      CuAssertIntEquals(tc, APX_BENCHMARK_NUM_CLIENTS, adt_ary_length(&benchmarkRouter.nodeInfoList));
+      apx_definitionPipeline_destroy(&pipeline);
+      for (i=0; i<APX_BENCHMARK_NUM_CLIENTS; i++)
+      {
+         apx_router_detachNodeInfo(&benchmarkRouter.router, (apx_nodeInfo_t*) adt_ary_value(&benchmarkRouter.nodeInfoList, i));
+      }
+      apx_router_destroy(&benchmarkRouter.router);
+      apx_rcu_synchronize();
+      adt_ary_destroy(&benchmarkRouter.nodeInfoList);
+   }
+   free(definitions);
+   free(definitionLengths);
+}
+
+/**
+ * link function of the benchmark, attaches the prepared nodes to the router the way apx_nodeManager does
+ */
+static void attachToRouter(void *arg, apx_definitionJob_t *job)
+{
+   int32_t i;
+   int32_t numNodes = adt_ary_length(&job->preparedNodes);
+   benchmarkRouter_t *benchmarkRouter = (benchmarkRouter_t*) arg;
+   for (i=0; i<numNodes; i++)
+   {
+      apx_preparedNode_t *preparedNode = (apx_preparedNode_t*) adt_ary_value(&job->preparedNodes, i);
+      adt_ary_push(&benchmarkRouter->nodeInfoList, preparedNode->nodeInfo);
+      apx_router_attachNodeInfo(&benchmarkRouter->router, preparedNode->nodeInfo);
+      apx_nodeInfo_copyInitDataFromProvideConnectors(preparedNode->nodeInfo);
+      preparedNode->nodeInfo = (apx_nodeInfo_t*) 0;
+   }
+   apx_rcu_synchronize();
+}
+
+static double getWallClockSec(void)
+{
+#ifdef _WIN32
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER counter;
+   QueryPerformanceFrequency(&frequency);
+   QueryPerformanceCounter(&counter);
+   return ((double) counter.QuadPart) / ((double) frequency.QuadPart);
+#else
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return ((double) now.tv_sec) + ((double) now.tv_nsec) / 1000000000.0;
+#endif
+}
+#endif
+
+static void linkSpy_create(linkSpy_t *self)
+{
+   memset(self, 0, sizeof(linkSpy_t));
+}
+
+/**
+ * counts linked jobs and copies the init data of the last node, the pipeline deletes the prepared nodes afterwards
+ */
+static void linkSpy_link(void *arg, apx_definitionJob_t *job)
+{
+   int32_t i;
+   int32_t numNodes = adt_ary_length(&job->preparedNodes);
+   linkSpy_t *self = (linkSpy_t*) arg;
+   if ( (self->blockedOwner != 0) && (job->owner == self->blockedOwner) )
+   {
+      APX_ATOMIC_STORE_RELEASE(self->isLinking, 1);
+      while (APX_ATOMIC_LOAD_ACQUIRE(self->isReleased) == 0)
+      {
+         SLEEP(1);
+      }
+   }
+   for (i=0; i<numNodes; i++)
+   {
+      apx_preparedNode_t *preparedNode = (apx_preparedNode_t*) adt_ary_value(&job->preparedNodes, i);
+      assert(preparedNode->nodeInfo != 0);
+      if ( (preparedNode->inPortInitData != 0) && (preparedNode->inPortDataLen <= (int32_t) sizeof(self->inPortInitData)) )
+      {
+         memcpy(self->inPortInitData, preparedNode->inPortInitData, preparedNode->inPortDataLen);
+      }
+      self->inPortDataLen = preparedNode->inPortDataLen;
+   }
+   //the link stage is serialized, no other job is linked at the same time
+   self->numNodes += numNodes;
+   self->numJobs++;
+}
+
+/**
+ * creates the definition of one client. Each client provides its own signals and requires signals provided by the clients after it
+ */
+static int32_t createDefinition(char *buf, int32_t bufLen, int32_t clientId, int32_t numClients)
+{
+   int32_t i;
+   int32_t len = 0;
+#ifdef APX_ENABLE_BENCHMARK
+   int32_t numProvidePorts = APX_BENCHMARK_NUM_PROVIDE_PORTS;
+   int32_t numRequirePorts = APX_BENCHMARK_NUM_REQUIRE_PORTS;
+#else
+   int32_t numProvidePorts = 2;
+   int32_t numRequirePorts = 4;
+#endif
+   len += snprintf(&buf[len], bufLen-len, "APX/1.2\nN\"Client%d\"\n", (int) clientId);
+   for (i=0; (i<numProvidePorts) && (len<bufLen); i++)
+   {
+      len += snprintf(&buf[len], bufLen-len, "P\"Signal%d_%d\"S\n", (int) clientId, (int) i);
+   }
+   for (i=0; (i<numRequirePorts) && (len<bufLen); i++)
+   {
+      len += snprintf(&buf[len], bufLen-len, "R\"Signal%d_%d\"S:=65535\n", (int) ((clientId+i+1) % numClients), (int) (i % numProvidePorts));
+   }
+   if (len >= bufLen)
+   {
+      return -1;
+   }
+   len += snprintf(&buf[len], bufLen-len, "\n");
+   return (len < bufLen)? len : -1;
+}
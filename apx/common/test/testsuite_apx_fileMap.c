@@ -6,6 +6,9 @@
 #include <stdio.h>
 #include <stddef.h>
 #include <string.h>
+#ifdef APX_ENABLE_BENCHMARK
+#include <time.h>
+#endif
 #include "CuTest.h"
 #include "apx_fileMap.h"
 #ifdef MEM_LEAK_CHECK
@@ -16,12 +19,21 @@
 //////////////////////////////////////////////////////////////////////////////
 // CONSTANTS AND DATA TYPES
 //////////////////////////////////////////////////////////////////////////////
+#ifdef APX_ENABLE_BENCHMARK
+#define APX_BENCHMARK_NUM_FILES 128
+#define APX_BENCHMARK_NUM_WRITES 1000000
+#endif
 
 //////////////////////////////////////////////////////////////////////////////
 // LOCAL FUNCTION PROTOTYPES
 //////////////////////////////////////////////////////////////////////////////
 static void test_apx_fileMap_create(CuTest* tc);
 static void test_apx_fileMap_autoInsert(CuTest* tc);
+static void test_apx_fileMap_findAndRemove(CuTest* tc);
+#ifdef APX_ENABLE_BENCHMARK
+static void test_apx_fileMap_benchmarkFindByAddress(CuTest* tc);
+#endif
+static apx_file_t *fileMap_createRemoteFile(const char *name, uint32_t address, uint32_t length);
 //////////////////////////////////////////////////////////////////////////////
 // GLOBAL VARIABLES
 //////////////////////////////////////////////////////////////////////////////
@@ -42,6 +54,10 @@ CuSuite* testSuite_apx_fileMap(void)
 
    SUITE_ADD_TEST(suite, test_apx_fileMap_create);
    SUITE_ADD_TEST(suite, test_apx_fileMap_autoInsert);
+   SUITE_ADD_TEST(suite, test_apx_fileMap_findAndRemove);
+#ifdef APX_ENABLE_BENCHMARK
+   SUITE_ADD_TEST(suite, test_apx_fileMap_benchmarkFindByAddress);
+#endif
 
    return suite;
 }
@@ -75,7 +91,6 @@ static void test_apx_fileMap_autoInsert(CuTest* tc)
    uint8_t def1[256];
    uint8_t def2[256];
    uint8_t def3[256];
-   adt_list_elem_t *iter;
    apx_file_t *pFile;
 
    apx_fileMap_create(&fileMap);
@@ -100,37 +115,120 @@ static void test_apx_fileMap_autoInsert(CuTest* tc)
    apx_fileMap_autoInsertPortDataFile(&fileMap, file3);
    apx_fileMap_autoInsertDefinitionFile(&fileMap, file6);
    apx_fileMap_autoInsertPortDataFile(&fileMap, file5);
-   adt_list_iter_init(&fileMap.fileList);
-   iter = adt_list_iter_next(&fileMap.fileList);
-   pFile = (apx_file_t*) iter->pItem;
-   CuAssertPtrEquals(tc, iter->pItem, file1 );
+   CuAssertIntEquals(tc, 6, apx_fileMap_length(&fileMap));
+   pFile = apx_fileMap_get(&fileMap, 0);
+   CuAssertPtrEquals(tc, file1, pFile);
    CuAssertStrEquals(tc, "testnode1.out", pFile->fileInfo.name);
    CuAssertUIntEquals(tc, 0, pFile->fileInfo.address);
-   iter = adt_list_iter_next(&fileMap.fileList);
-   pFile = (apx_file_t*) iter->pItem;
+   pFile = apx_fileMap_get(&fileMap, 1);
    CuAssertStrEquals(tc, "testnode2.out", pFile->fileInfo.name);
    CuAssertUIntEquals(tc, 1024, pFile->fileInfo.address);
-   CuAssertPtrEquals(tc, iter->pItem, file3 );
-   iter = adt_list_iter_next(&fileMap.fileList);
-   pFile = (apx_file_t*) iter->pItem;
+   CuAssertPtrEquals(tc, file3, pFile);
+   pFile = apx_fileMap_get(&fileMap, 2);
    CuAssertStrEquals(tc, "testnode3.out", pFile->fileInfo.name);
    CuAssertUIntEquals(tc, 1024*3, pFile->fileInfo.address);
-   CuAssertPtrEquals(tc, iter->pItem, file5 );
-   iter = adt_list_iter_next(&fileMap.fileList);
-   pFile = (apx_file_t*) iter->pItem;
+   CuAssertPtrEquals(tc, file5, pFile);
+   pFile = apx_fileMap_get(&fileMap, 3);
    CuAssertStrEquals(tc, "testnode1.apx", pFile->fileInfo.name);
    CuAssertUIntEquals(tc, 64*1024*1024, pFile->fileInfo.address);
-   CuAssertPtrEquals(tc, iter->pItem, file2 );
-   iter = adt_list_iter_next(&fileMap.fileList);
-   pFile = (apx_file_t*) iter->pItem;
+   CuAssertPtrEquals(tc, file2, pFile);
+   pFile = apx_fileMap_get(&fileMap, 4);
    CuAssertStrEquals(tc, "testnode2.apx", pFile->fileInfo.name);
    CuAssertUIntEquals(tc, 65*1024*1024, pFile->fileInfo.address);
-   CuAssertPtrEquals(tc, iter->pItem, file4 );
-   iter = adt_list_iter_next(&fileMap.fileList);
-   pFile = (apx_file_t*) iter->pItem;
+   CuAssertPtrEquals(tc, file4, pFile);
+   pFile = apx_fileMap_get(&fileMap, 5);
    CuAssertStrEquals(tc, "testnode3.apx", pFile->fileInfo.name);
    CuAssertUIntEquals(tc, 66*1024*1024, pFile->fileInfo.address);
-   CuAssertPtrEquals(tc, iter->pItem, file6 );
+   CuAssertPtrEquals(tc, file6, pFile);
+   apx_fileMap_destroy(&fileMap);
+
+}
+
+static void test_apx_fileMap_findAndRemove(CuTest* tc)
+{
+   apx_fileMap_t fileMap;
+   apx_file_t *file1 = fileMap_createRemoteFile("node1.out", 0, 100);
+   apx_file_t *file2 = fileMap_createRemoteFile("node2.out", 1024, 1024);
+   apx_file_t *file3 = fileMap_createRemoteFile("node3.out", 4096, 10);
+   apx_file_t *file4 = fileMap_createRemoteFile("node2.out", 1000, 100);
+   apx_fileMap_create(&fileMap);
+   CuAssertIntEquals(tc, 0, apx_fileMap_insertFile(&fileMap, file3));
+   CuAssertIntEquals(tc, 0, apx_fileMap_insertFile(&fileMap, file1));
+   CuAssertIntEquals(tc, 0, apx_fileMap_insertFile(&fileMap, file2));
+   CuAssertPtrEquals(tc, file1, apx_fileMap_findByAddress(&fileMap, 0));
+   CuAssertPtrEquals(tc, file1, apx_fileMap_findByAddress(&fileMap, 99));
+   CuAssertPtrEquals(tc, 0, apx_fileMap_findByAddress(&fileMap, 100));
+   CuAssertPtrEquals(tc, file2, apx_fileMap_findByAddress(&fileMap, 1024));
+   CuAssertPtrEquals(tc, file2, apx_fileMap_findByAddress(&fileMap, 2047));
+   CuAssertPtrEquals(tc, 0, apx_fileMap_findByAddress(&fileMap, 2048));
+   CuAssertPtrEquals(tc, file3, apx_fileMap_findByAddress(&fileMap, 4105));
+   CuAssertPtrEquals(tc, 0, apx_fileMap_findByAddress(&fileMap, 4106));
+   CuAssertPtrEquals(tc, file2, apx_fileMap_findByName(&fileMap, "node2.out"));
+   CuAssertPtrEquals(tc, 0, apx_fileMap_findByName(&fileMap, "node4.out"));
+   //overlapping files are rejected
+   CuAssertIntEquals(tc, -1, apx_fileMap_insertFile(&fileMap, file4));
+   file4->fileInfo.address = 100;
+   CuAssertIntEquals(tc, 0, apx_fileMap_insertFile(&fileMap, file4));
+   //the file with the lowest address is found when names are not unique
+   CuAssertPtrEquals(tc, file4, apx_fileMap_findByName(&fileMap, "node2.out"));
+   CuAssertPtrEquals(tc, file4, apx_fileMap_get(&fileMap, 1));
+   CuAssertIntEquals(tc, 0, apx_fileMap_removeFile(&fileMap, file4));
+   CuAssertIntEquals(tc, -1, apx_fileMap_removeFile(&fileMap, file4));
+   CuAssertPtrEquals(tc, file2, apx_fileMap_findByName(&fileMap, "node2.out"));
+   CuAssertIntEquals(tc, 0, apx_fileMap_removeFile(&fileMap, file2));
+   CuAssertPtrEquals(tc, 0, apx_fileMap_findByName(&fileMap, "node2.out"));
+   CuAssertPtrEquals(tc, 0, apx_fileMap_findByAddress(&fileMap, 1024));
+   CuAssertIntEquals(tc, 2, apx_fileMap_length(&fileMap));
+   CuAssertPtrEquals(tc, file3, apx_fileMap_get(&fileMap, 1));
+   apx_fileMap_destroy(&fileMap);
+   apx_file_delete(file2);
+   apx_file_delete(file4);
+}
+
+#ifdef APX_ENABLE_BENCHMARK
+/**
+ * a client writing to many port data files in turn, every write lands in another file than the previous one
+ */
+static void test_apx_fileMap_benchmarkFindByAddress(CuTest* tc)
+{
+   apx_fileMap_t fileMap;
+   int32_t i;
+   clock_t start;
+   double elapsedSec;
+   uint32_t numFound = 0;
+   apx_fileMap_create(&fileMap);
+   for (i=0; i<APX_BENCHMARK_NUM_FILES; i++)
+   {
+      char name[RMF_MAX_FILE_NAME];
+      apx_file_t *file;
+      snprintf(name, sizeof(name), "node%d.out", (int) i);
+      file = fileMap_createRemoteFile(name, 0, 100);
+      CuAssertIntEquals(tc, 0, apx_fileMap_autoInsertPortDataFile(&fileMap, file));
+   }
+   start = clock();
+   for (i=0; i<APX_BENCHMARK_NUM_WRITES; i++)
+   {
+      //stride through the files so consecutive writes never hit the same file
+      uint32_t address = (uint32_t) ((i*37) % APX_BENCHMARK_NUM_FILES) * 1024 + (i % 100);
+      if (apx_fileMap_findByAddress(&fileMap, address) != 0)
+      {
+         numFound++;
+      }
+   }
+   elapsedSec = ((double) (clock()-start)) / CLOCKS_PER_SEC;
+   CuAssertUIntEquals(tc, APX_BENCHMARK_NUM_WRITES, numFound);
+   printf("[apx_fileMap] %d files, %d interleaved writes: %.1f ms (%.1f ns per lookup)\n", APX_BENCHMARK_NUM_FILES, APX_BENCHMARK_NUM_WRITES,
+         elapsedSec*1000.0, elapsedSec*1e9/APX_BENCHMARK_NUM_WRITES);
    apx_fileMap_destroy(&fileMap);
+}
+#endif
 
+static apx_file_t *fileMap_createRemoteFile(const char *name, uint32_t address, uint32_t length)
+{
+   apx_file_t *file;
+   rmf_fileInfo_t fileInfo;
+   rmf_fileInfo_create(&fileInfo, name, address, length, RMF_FILE_TYPE_FIXED);
+   file = apx_file_newRemoteFile(&fileInfo);
+   rmf_fileInfo_destroy(&fileInfo);
+   return file;
 }
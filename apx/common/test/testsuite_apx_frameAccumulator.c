@@ -0,0 +1,312 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "CuTest.h"
+#include "apx_frameAccumulator.h"
+#include "osmacro.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+typedef struct transmitSpy_tag
+{
+   int32_t numCalls;
+   int32_t numFailures; //number of upcoming calls that shall fail
+   uint32_t totalLen;
+   uint8_t data[256];
+   int32_t numDeadlines;
+   uint32_t lastDelayMs;
+}transmitSpy_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static void test_apx_frameAccumulator_flushOnDrain(CuTest* tc);
+static void test_apx_frameAccumulator_flushOnSize(CuTest* tc);
+static void test_apx_frameAccumulator_largeFrame(CuTest* tc);
+static void test_apx_frameAccumulator_disabled(CuTest* tc);
+static void test_apx_frameAccumulator_appendGather(CuTest* tc);
+static void test_apx_frameAccumulator_keepDataOnError(CuTest* tc);
+static void test_apx_frameAccumulator_flushExpired(CuTest* tc);
+static void test_apx_frameAccumulator_tryAppendGather(CuTest* tc);
+static int32_t transmitSpy_transmit(void *arg, const apx_frameBuffer_t *buffers, int32_t numBuffers);
+static void transmitSpy_deadline(void *arg, uint32_t delayMs);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+
+CuSuite* testSuite_apx_frameAccumulator(void)
+{
+   CuSuite* suite = CuSuiteNew();
+
+   SUITE_ADD_TEST(suite, test_apx_frameAccumulator_flushOnDrain);
+   SUITE_ADD_TEST(suite, test_apx_frameAccumulator_flushOnSize);
+   SUITE_ADD_TEST(suite, test_apx_frameAccumulator_largeFrame);
+   SUITE_ADD_TEST(suite, test_apx_frameAccumulator_disabled);
+   SUITE_ADD_TEST(suite, test_apx_frameAccumulator_appendGather);
+   SUITE_ADD_TEST(suite, test_apx_frameAccumulator_keepDataOnError);
+   SUITE_ADD_TEST(suite, test_apx_frameAccumulator_flushExpired);
+   SUITE_ADD_TEST(suite, test_apx_frameAccumulator_tryAppendGather);
+
+   return suite;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+static void test_apx_frameAccumulator_flushOnDrain(CuTest* tc)
+{
+   int i;
+   transmitSpy_t spy;
+   apx_frameAccumulator_t accumulator;
+   apx_frameAccumulatorStats_t stats;
+   const uint8_t frame[4] = {3, 0x01, 0x02, 0x03};
+   memset(&spy, 0, sizeof(spy));
+   apx_frameAccumulator_create(&accumulator, 100, 0, transmitSpy_transmit, &spy);
+   for (i=0;i<10;i++)
+   {
+      CuAssertIntEquals(tc, 0, apx_frameAccumulator_append(&accumulator, frame, sizeof(frame)));
+   }
+   CuAssertIntEquals(tc, 0, spy.numCalls);
+   CuAssertUIntEquals(tc, 40, apx_frameAccumulator_getPendingLen(&accumulator));
+   CuAssertIntEquals(tc, 0, apx_frameAccumulator_flush(&accumulator));
+   CuAssertIntEquals(tc, 1, spy.numCalls);
+   CuAssertUIntEquals(tc, 40, spy.totalLen);
+   CuAssertIntEquals(tc, 0, memcmp(&spy.data[36], frame, sizeof(frame)));
+   //flushing an empty accumulator shall not call transmit
+   CuAssertIntEquals(tc, 0, apx_frameAccumulator_flush(&accumulator));
+   CuAssertIntEquals(tc, 1, spy.numCalls);
+   apx_frameAccumulator_getStats(&accumulator, &stats);
+   CuAssertUIntEquals(tc, 10, stats.numFrames);
+   CuAssertUIntEquals(tc, 1, stats.numFlushes);
+   CuAssertUIntEquals(tc, 1, stats.numDrainFlushes);
+   CuAssertUIntEquals(tc, 0, stats.numSizeFlushes);
+   CuAssertUIntEquals(tc, 40, stats.maxFlushLen);
+   apx_frameAccumulator_destroy(&accumulator);
+}
+
+static void test_apx_frameAccumulator_flushOnSize(CuTest* tc)
+{
+   int i;
+   transmitSpy_t spy;
+   apx_frameAccumulator_t accumulator;
+   apx_frameAccumulatorStats_t stats;
+   const uint8_t frame[10] = {9, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+   memset(&spy, 0, sizeof(spy));
+   apx_frameAccumulator_create(&accumulator, 25, 0, transmitSpy_transmit, &spy);
+   for (i=0;i<5;i++)
+   {
+      CuAssertIntEquals(tc, 0, apx_frameAccumulator_append(&accumulator, frame, sizeof(frame)));
+   }
+   //frames are never split, 2 frames (20 bytes) fit below the threshold
+   CuAssertIntEquals(tc, 2, spy.numCalls);
+   CuAssertUIntEquals(tc, 40, spy.totalLen);
+   CuAssertUIntEquals(tc, 10, apx_frameAccumulator_getPendingLen(&accumulator));
+   apx_frameAccumulator_flush(&accumulator);
+   apx_frameAccumulator_getStats(&accumulator, &stats);
+   CuAssertUIntEquals(tc, 5, stats.numFrames);
+   CuAssertUIntEquals(tc, 3, stats.numFlushes);
+   CuAssertUIntEquals(tc, 2, stats.numSizeFlushes);
+   CuAssertUIntEquals(tc, 1, stats.numDrainFlushes);
+   apx_frameAccumulator_destroy(&accumulator);
+}
+
+static void test_apx_frameAccumulator_largeFrame(CuTest* tc)
+{
+   transmitSpy_t spy;
+   apx_frameAccumulator_t accumulator;
+   uint8_t small[4] = {3, 0xAA, 0xAA, 0xAA};
+   uint8_t large[40];
+   memset(&spy, 0, sizeof(spy));
+   memset(large, 0x55, sizeof(large));
+   apx_frameAccumulator_create(&accumulator, 32, 0, transmitSpy_transmit, &spy);
+   apx_frameAccumulator_append(&accumulator, small, sizeof(small));
+   CuAssertIntEquals(tc, 0, spy.numCalls);
+   //the large frame is sent directly together with the pending frame, which goes first to keep the order
+   apx_frameAccumulator_append(&accumulator, large, sizeof(large));
+   CuAssertIntEquals(tc, 1, spy.numCalls);
+   CuAssertUIntEquals(tc, 44, spy.totalLen);
+   CuAssertIntEquals(tc, 0, memcmp(&spy.data[0], small, sizeof(small)));
+   CuAssertIntEquals(tc, 0, memcmp(&spy.data[4], large, sizeof(large)));
+   CuAssertUIntEquals(tc, 0, apx_frameAccumulator_getPendingLen(&accumulator));
+   apx_frameAccumulator_destroy(&accumulator);
+}
+
+static void test_apx_frameAccumulator_disabled(CuTest* tc)
+{
+   transmitSpy_t spy;
+   apx_frameAccumulator_t accumulator;
+   const uint8_t frame[4] = {3, 0x01, 0x02, 0x03};
+   memset(&spy, 0, sizeof(spy));
+   apx_frameAccumulator_create(&accumulator, 0, 0, transmitSpy_transmit, &spy);
+   apx_frameAccumulator_append(&accumulator, frame, sizeof(frame));
+   apx_frameAccumulator_append(&accumulator, frame, sizeof(frame));
+   CuAssertIntEquals(tc, 2, spy.numCalls);
+   CuAssertUIntEquals(tc, 8, spy.totalLen);
+   apx_frameAccumulator_destroy(&accumulator);
+}
+
+static void test_apx_frameAccumulator_appendGather(CuTest* tc)
+{
+   transmitSpy_t spy;
+   apx_frameAccumulator_t accumulator;
+   apx_frameAccumulatorStats_t stats;
+   const uint8_t header1[3] = {4, 0x00, 0x10};
+   const uint8_t header2[3] = {4, 0x00, 0x20};
+   const uint8_t payload[2] = {0x12, 0x34};
+   const uint8_t expected[10] = {4, 0x00, 0x10, 0x12, 0x34, 4, 0x00, 0x20, 0x12, 0x34};
+   memset(&spy, 0, sizeof(spy));
+   apx_frameAccumulator_create(&accumulator, 100, 0, transmitSpy_transmit, &spy);
+   //the same payload is gathered behind two different headers
+   CuAssertIntEquals(tc, 0, apx_frameAccumulator_appendGather(&accumulator, header1, sizeof(header1), payload, sizeof(payload)));
+   CuAssertIntEquals(tc, 0, apx_frameAccumulator_appendGather(&accumulator, header2, sizeof(header2), payload, sizeof(payload)));
+   CuAssertUIntEquals(tc, 10, apx_frameAccumulator_getPendingLen(&accumulator));
+   apx_frameAccumulator_flush(&accumulator);
+   CuAssertIntEquals(tc, 1, spy.numCalls);
+   CuAssertUIntEquals(tc, 10, spy.totalLen);
+   CuAssertIntEquals(tc, 0, memcmp(spy.data, expected, sizeof(expected)));
+   apx_frameAccumulator_getStats(&accumulator, &stats);
+   CuAssertUIntEquals(tc, 2, stats.numFrames);
+   apx_frameAccumulator_destroy(&accumulator);
+}
+
+static void test_apx_frameAccumulator_keepDataOnError(CuTest* tc)
+{
+   transmitSpy_t spy;
+   apx_frameAccumulator_t accumulator;
+   const uint8_t frame1[4] = {3, 0x01, 0x02, 0x03};
+   const uint8_t frame2[4] = {3, 0x04, 0x05, 0x06};
+   memset(&spy, 0, sizeof(spy));
+   apx_frameAccumulator_create(&accumulator, 6, 0, transmitSpy_transmit, &spy);
+   CuAssertIntEquals(tc, 0, apx_frameAccumulator_append(&accumulator, frame1, sizeof(frame1)));
+   spy.numFailures = 2;
+   CuAssertIntEquals(tc, -1, apx_frameAccumulator_flush(&accumulator));
+   CuAssertUIntEquals(tc, 4, apx_frameAccumulator_getPendingLen(&accumulator));
+   //frame2 does not fit behind frame1, it's rejected when frame1 can't be transmitted
+   CuAssertIntEquals(tc, -1, apx_frameAccumulator_append(&accumulator, frame2, sizeof(frame2)));
+   CuAssertUIntEquals(tc, 4, apx_frameAccumulator_getPendingLen(&accumulator));
+   CuAssertUIntEquals(tc, 0, spy.totalLen);
+   CuAssertIntEquals(tc, 0, apx_frameAccumulator_append(&accumulator, frame2, sizeof(frame2)));
+   CuAssertIntEquals(tc, 0, apx_frameAccumulator_flush(&accumulator));
+   CuAssertUIntEquals(tc, 8, spy.totalLen);
+   CuAssertIntEquals(tc, 0, memcmp(&spy.data[0], frame1, sizeof(frame1)));
+   CuAssertIntEquals(tc, 0, memcmp(&spy.data[4], frame2, sizeof(frame2)));
+   apx_frameAccumulator_destroy(&accumulator);
+}
+
+static void test_apx_frameAccumulator_flushExpired(CuTest* tc)
+{
+   transmitSpy_t spy;
+   apx_frameAccumulator_t accumulator;
+   apx_frameAccumulatorStats_t stats;
+   const uint8_t frame[4] = {3, 0x01, 0x02, 0x03};
+   memset(&spy, 0, sizeof(spy));
+   apx_frameAccumulator_create(&accumulator, 100, 20, transmitSpy_transmit, &spy);
+   apx_frameAccumulator_setDeadlineHandler(&accumulator, transmitSpy_deadline, &spy);
+   CuAssertIntEquals(tc, 0, apx_frameAccumulator_append(&accumulator, frame, sizeof(frame)));
+   CuAssertIntEquals(tc, 1, spy.numDeadlines);
+   CuAssertUIntEquals(tc, 20, spy.lastDelayMs);
+   //only the first frame of a batch starts the timer
+   CuAssertIntEquals(tc, 0, apx_frameAccumulator_append(&accumulator, frame, sizeof(frame)));
+   CuAssertIntEquals(tc, 1, spy.numDeadlines);
+   //a timer that fires early is told to wait for the rest of the time
+   CuAssertIntEquals(tc, 0, apx_frameAccumulator_flushExpired(&accumulator));
+   CuAssertIntEquals(tc, 0, spy.numCalls);
+   CuAssertIntEquals(tc, 2, spy.numDeadlines);
+   CuAssertTrue(tc, spy.lastDelayMs <= 20);
+   SLEEP(30);
+   CuAssertIntEquals(tc, 0, apx_frameAccumulator_flushExpired(&accumulator));
+   CuAssertIntEquals(tc, 1, spy.numCalls);
+   CuAssertUIntEquals(tc, 8, spy.totalLen);
+   CuAssertUIntEquals(tc, 0, apx_frameAccumulator_getPendingLen(&accumulator));
+   apx_frameAccumulator_getStats(&accumulator, &stats);
+   CuAssertUIntEquals(tc, 1, stats.numTimeFlushes);
+   apx_frameAccumulator_destroy(&accumulator);
+}
+
+/**
+ * tryAppendGather never transmits, frames that don't fit without a flush and frames offered while the mutex is held are refused
+ */
+static void test_apx_frameAccumulator_tryAppendGather(CuTest* tc)
+{
+   transmitSpy_t spy;
+   apx_frameAccumulator_t accumulator;
+   apx_frameAccumulatorStats_t stats;
+   const uint8_t header[2] = {5, 0x01};
+   const uint8_t payload[4] = {0x02, 0x03, 0x04, 0x05};
+   memset(&spy, 0, sizeof(spy));
+   apx_frameAccumulator_create(&accumulator, 15, 0, transmitSpy_transmit, &spy);
+   CuAssertIntEquals(tc, 0, apx_frameAccumulator_tryAppendGather(&accumulator, header, sizeof(header), payload, sizeof(payload)));
+   CuAssertIntEquals(tc, 0, apx_frameAccumulator_tryAppendGather(&accumulator, header, sizeof(header), payload, sizeof(payload)));
+   CuAssertUIntEquals(tc, 12, apx_frameAccumulator_getPendingLen(&accumulator));
+   //the third frame only fits after a flush
+   errno = 0;
+   CuAssertIntEquals(tc, -1, apx_frameAccumulator_tryAppendGather(&accumulator, header, sizeof(header), payload, sizeof(payload)));
+   CuAssertIntEquals(tc, EAGAIN, errno);
+   CuAssertIntEquals(tc, 0, spy.numCalls);
+   CuAssertUIntEquals(tc, 12, apx_frameAccumulator_getPendingLen(&accumulator));
+   CuAssertIntEquals(tc, 0, apx_frameAccumulator_flush(&accumulator));
+   CuAssertIntEquals(tc, 1, spy.numCalls);
+   //another thread is transmitting
+   MUTEX_LOCK(accumulator.mutex);
+   errno = 0;
+   CuAssertIntEquals(tc, -1, apx_frameAccumulator_tryAppendGather(&accumulator, header, sizeof(header), payload, sizeof(payload)));
+   CuAssertIntEquals(tc, EAGAIN, errno);
+   MUTEX_UNLOCK(accumulator.mutex);
+   CuAssertIntEquals(tc, 0, apx_frameAccumulator_tryAppendGather(&accumulator, header, sizeof(header), payload, sizeof(payload)));
+   CuAssertUIntEquals(tc, 6, apx_frameAccumulator_getPendingLen(&accumulator));
+   apx_frameAccumulator_getStats(&accumulator, &stats);
+   CuAssertUIntEquals(tc, 3, stats.numFrames);
+   CuAssertUIntEquals(tc, 1, stats.numFlushes);
+   apx_frameAccumulator_destroy(&accumulator);
+}
+
+static int32_t transmitSpy_transmit(void *arg, const apx_frameBuffer_t *buffers, int32_t numBuffers)
+{
+   int32_t i;
+   transmitSpy_t *spy = (transmitSpy_t*) arg;
+   spy->numCalls++;
+   if (spy->numFailures > 0)
+   {
+      spy->numFailures--;
+      return -1;
+   }
+   for (i = 0; i < numBuffers; i++)
+   {
+      if ( (spy->totalLen + buffers[i].dataLen) <= sizeof(spy->data) )
+      {
+         memcpy(&spy->data[spy->totalLen], buffers[i].data, buffers[i].dataLen);
+      }
+      spy->totalLen += buffers[i].dataLen;
+   }
+   return 0;
+}
+
+static void transmitSpy_deadline(void *arg, uint32_t delayMs)
+{
+   transmitSpy_t *spy = (transmitSpy_t*) arg;
+   spy->numDeadlines++;
+   spy->lastDelayMs = delayMs;
+}
@@ -0,0 +1,552 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#ifndef _WIN32
+#include <sched.h>
+#include <time.h>
+#endif
+#include "CuTest.h"
+#include "apx_msgQueue.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#define NUM_PRODUCERS 4
+#define NUM_MESSAGES_PER_PRODUCER 20000
+
+typedef struct handlerSpy_tag
+{
+   uint32_t numReleased;
+   uint32_t lastReleased; //msgData1 of last released message
+}handlerSpy_t;
+
+typedef struct producerArg_tag
+{
+   apx_msgQueue_t *queue;
+   uint32_t producerId;
+}producerArg_t;
+
+typedef struct waitingProducerArg_tag
+{
+   apx_msgQueue_t *queue;
+   int8_t result;
+   uint32_t elapsedMs;
+}waitingProducerArg_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static void test_apx_msgQueue_create(CuTest* tc);
+static void test_apx_msgQueue_postRemove(CuTest* tc);
+static void test_apx_msgQueue_overflow(CuTest* tc);
+static void test_apx_msgQueue_dropOldest(CuTest* tc);
+static void test_apx_msgQueue_dropOldestMakesRoom(CuTest* tc);
+static void test_apx_msgQueue_conflate(CuTest* tc);
+static void test_apx_msgQueue_backpressure(CuTest* tc);
+static void test_apx_msgQueue_wakeupOnTransition(CuTest* tc);
+#ifndef _WIN32
+static void test_apx_msgQueue_multipleProducers(CuTest* tc);
+static void test_apx_msgQueue_backpressureWakesProducer(CuTest* tc);
+static void *producerTask(void *arg);
+static void *waitingProducerTask(void *arg);
+static uint32_t getTimeMs(void);
+#endif
+static void wakeupSpy(void *arg);
+static void handlerSpy_create(apx_msgQueueHandler_t *handler, handlerSpy_t *spy);
+static bool handlerSpy_isDroppable(void *arg, const apx_msg_t *msg);
+static bool handlerSpy_isConflatable(void *arg, const apx_msg_t *queuedMsg, const apx_msg_t *newMsg);
+static void handlerSpy_release(void *arg, const apx_msg_t *msg);
+static uint32_t handlerSpy_getSize(void *arg, const apx_msg_t *msg);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+
+CuSuite* testSuite_apx_msgQueue(void)
+{
+   CuSuite* suite = CuSuiteNew();
+
+   SUITE_ADD_TEST(suite, test_apx_msgQueue_create);
+   SUITE_ADD_TEST(suite, test_apx_msgQueue_postRemove);
+   SUITE_ADD_TEST(suite, test_apx_msgQueue_overflow);
+   SUITE_ADD_TEST(suite, test_apx_msgQueue_dropOldest);
+   SUITE_ADD_TEST(suite, test_apx_msgQueue_dropOldestMakesRoom);
+   SUITE_ADD_TEST(suite, test_apx_msgQueue_conflate);
+   SUITE_ADD_TEST(suite, test_apx_msgQueue_backpressure);
+   SUITE_ADD_TEST(suite, test_apx_msgQueue_wakeupOnTransition);
+#ifndef _WIN32
+   SUITE_ADD_TEST(suite, test_apx_msgQueue_multipleProducers);
+   SUITE_ADD_TEST(suite, test_apx_msgQueue_backpressureWakesProducer);
+#endif
+
+   return suite;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+static void test_apx_msgQueue_create(CuTest* tc)
+{
+   apx_msgQueue_t queue;
+   CuAssertIntEquals(tc, 0, apx_msgQueue_create(&queue, 1000));
+   CuAssertUIntEquals(tc, 1024, apx_msgQueue_getCapacity(&queue));
+   apx_msgQueue_destroy(&queue);
+   CuAssertIntEquals(tc, 0, apx_msgQueue_create(&queue, 0));
+   CuAssertUIntEquals(tc, 2, apx_msgQueue_getCapacity(&queue));
+   apx_msgQueue_destroy(&queue);
+}
+
+static void test_apx_msgQueue_postRemove(CuTest* tc)
+{
+   apx_msgQueue_t queue;
+   apx_msg_t msg = {RMF_MSG_WRITE_NOTIFY, 0, 0, 0, 0};
+   uint32_t i;
+   int32_t numRemoved = 0;
+   CuAssertIntEquals(tc, 0, apx_msgQueue_create(&queue, 8));
+   CuAssertTrue(tc, apx_msgQueue_remove(&queue, &msg) == false);
+   //wrap around the ring a few times
+   for (i=0;i<20;i++)
+   {
+      msg.msgData1 = i;
+      CuAssertIntEquals(tc, 0, apx_msgQueue_post(&queue, &msg));
+      if ( (i % 3) == 2)
+      {
+         while (apx_msgQueue_remove(&queue, &msg) == true)
+         {
+            CuAssertUIntEquals(tc, (uint32_t) numRemoved, msg.msgData1);
+            numRemoved++;
+         }
+      }
+   }
+   while (apx_msgQueue_remove(&queue, &msg) == true)
+   {
+      CuAssertUIntEquals(tc, (uint32_t) numRemoved, msg.msgData1);
+      numRemoved++;
+   }
+   CuAssertIntEquals(tc, 20, numRemoved);
+   CuAssertIntEquals(tc, 0, apx_msgQueue_consumed(&queue, numRemoved));
+   apx_msgQueue_destroy(&queue);
+}
+
+static void test_apx_msgQueue_overflow(CuTest* tc)
+{
+   apx_msgQueue_t queue;
+   apx_msgQueueStats_t stats;
+   apx_msg_t msg = {RMF_MSG_WRITE_NOTIFY, 0, 0, 0, 0};
+   uint32_t i;
+   uint32_t numMessages = 4 + APX_MSG_QUEUE_GROW_LEN + 10; //forces the overflow storage to grow twice
+   CuAssertIntEquals(tc, 0, apx_msgQueue_create(&queue, 4));
+   for (i=0;i<numMessages;i++)
+   {
+      msg.msgData1 = i;
+      CuAssertIntEquals(tc, 0, apx_msgQueue_post(&queue, &msg));
+   }
+   apx_msgQueue_getStats(&queue, &stats);
+   CuAssertUIntEquals(tc, numMessages, stats.highWaterMark);
+   CuAssertUIntEquals(tc, numMessages-4, stats.numOverflowed);
+   CuAssertUIntEquals(tc, (numMessages-4)*sizeof(apx_msg_t), stats.overflowBytes);
+   CuAssertUIntEquals(tc, 0, stats.numDropped);
+   //ring is drained first, then the overflow storage, messages stay in order
+   for (i=0;i<numMessages;i++)
+   {
+      CuAssertTrue(tc, apx_msgQueue_remove(&queue, &msg));
+      CuAssertUIntEquals(tc, i, msg.msgData1);
+   }
+   CuAssertTrue(tc, apx_msgQueue_remove(&queue, &msg) == false);
+   CuAssertIntEquals(tc, 0, apx_msgQueue_consumed(&queue, (int32_t) numMessages));
+   apx_msgQueue_getStats(&queue, &stats);
+   CuAssertUIntEquals(tc, 0, stats.overflowBytes);
+   CuAssertUIntEquals(tc, (numMessages-4)*sizeof(apx_msg_t), stats.maxOverflowBytes);
+   //once the overflow storage is empty the ring is used again
+   msg.msgData1 = 1234;
+   CuAssertIntEquals(tc, 0, apx_msgQueue_post(&queue, &msg));
+   apx_msgQueue_getStats(&queue, &stats);
+   CuAssertUIntEquals(tc, numMessages-4, stats.numOverflowed);
+   apx_msgQueue_destroy(&queue);
+}
+
+static void test_apx_msgQueue_dropOldest(CuTest* tc)
+{
+   apx_msgQueue_t queue;
+   apx_msgQueueHandler_t handler;
+   apx_msgQueueStats_t stats;
+   handlerSpy_t spy;
+   apx_msg_t msg = {RMF_MSG_WRITE_NOTIFY, 0, 0, 0, 0};
+   apx_msg_t connectMsg = {RMF_MSG_CONNECT, 100, 0, 0, 0};
+   uint32_t i;
+   handlerSpy_create(&handler, &spy);
+   CuAssertIntEquals(tc, 0, apx_msgQueue_create(&queue, 2));
+   apx_msgQueue_setOverflowPolicy(&queue, APX_MSG_QUEUE_POLICY_DROP_OLDEST, 3*sizeof(apx_msg_t), &handler);
+   //2 messages in ring, 3 in overflow storage
+   for (i=0;i<5;i++)
+   {
+      msg.msgData1 = i;
+      CuAssertIntEquals(tc, 0, apx_msgQueue_post(&queue, &msg));
+   }
+   CuAssertUIntEquals(tc, 0, spy.numReleased);
+   msg.msgData1 = 5;
+   CuAssertIntEquals(tc, 0, apx_msgQueue_post(&queue, &msg));
+   CuAssertUIntEquals(tc, 1, spy.numReleased);
+   CuAssertUIntEquals(tc, 2, spy.lastReleased);
+   //messages which are not droppable are accepted beyond the budget
+   CuAssertIntEquals(tc, 0, apx_msgQueue_post(&queue, &connectMsg));
+   CuAssertUIntEquals(tc, 1, spy.numReleased);
+   apx_msgQueue_getStats(&queue, &stats);
+   CuAssertUIntEquals(tc, 1, stats.numDropped);
+   CuAssertUIntEquals(tc, 6, stats.highWaterMark);
+   {
+      const uint32_t expected[6] = {0, 1, 3, 4, 5, 100};
+      for (i=0;i<6;i++)
+      {
+         CuAssertTrue(tc, apx_msgQueue_remove(&queue, &msg));
+         CuAssertUIntEquals(tc, expected[i], msg.msgData1);
+      }
+   }
+   CuAssertTrue(tc, apx_msgQueue_remove(&queue, &msg) == false);
+   //dropped message was taken out of the pending count
+   CuAssertIntEquals(tc, 0, apx_msgQueue_consumed(&queue, 6));
+   apx_msgQueue_destroy(&queue);
+}
+
+/**
+ * a large message may need several droppable messages to go, when dropping all of them is not enough nothing is dropped
+ */
+static void test_apx_msgQueue_dropOldestMakesRoom(CuTest* tc)
+{
+   apx_msgQueue_t queue;
+   apx_msgQueueHandler_t handler;
+   apx_msgQueueStats_t stats;
+   handlerSpy_t spy;
+   apx_msg_t msg = {RMF_MSG_WRITE_NOTIFY, 0, 0, 0, 0};
+   apx_msg_t connectMsg = {RMF_MSG_CONNECT, 100, 0, 0, 0};
+   const uint32_t msgSize = (uint32_t) sizeof(apx_msg_t);
+   uint32_t i;
+   handlerSpy_create(&handler, &spy);
+   handler.getSize = handlerSpy_getSize;
+   CuAssertIntEquals(tc, 0, apx_msgQueue_create(&queue, 2));
+   apx_msgQueue_setOverflowPolicy(&queue, APX_MSG_QUEUE_POLICY_DROP_OLDEST, 4*msgSize, &handler);
+   //2 messages in ring, then one message that can't be dropped followed by 3 that can in the overflow storage
+   for (i=0;i<2;i++)
+   {
+      msg.msgData1 = i;
+      CuAssertIntEquals(tc, 0, apx_msgQueue_post(&queue, &msg));
+   }
+   CuAssertIntEquals(tc, 0, apx_msgQueue_post(&queue, &connectMsg));
+   for (i=2;i<5;i++)
+   {
+      msg.msgData1 = i;
+      CuAssertIntEquals(tc, 0, apx_msgQueue_post(&queue, &msg));
+   }
+   //all 3 droppable messages are not enough for this one, it's refused and nothing is dropped
+   msg.msgData1 = 5;
+   msg.msgData2 = 4*msgSize;
+   errno = 0;
+   CuAssertIntEquals(tc, -1, apx_msgQueue_post(&queue, &msg));
+   CuAssertIntEquals(tc, ENOSPC, errno);
+   CuAssertUIntEquals(tc, 0, spy.numReleased);
+   //this one needs room for 2 messages, the 2 oldest droppable messages are dropped
+   msg.msgData1 = 6;
+   msg.msgData2 = msgSize;
+   CuAssertIntEquals(tc, 0, apx_msgQueue_post(&queue, &msg));
+   CuAssertUIntEquals(tc, 2, spy.numReleased);
+   CuAssertUIntEquals(tc, 3, spy.lastReleased);
+   apx_msgQueue_getStats(&queue, &stats);
+   CuAssertUIntEquals(tc, 3, stats.numDropped);
+   CuAssertUIntEquals(tc, 4*msgSize, stats.overflowBytes);
+   {
+      const uint32_t expected[5] = {0, 1, 100, 4, 6};
+      for (i=0;i<5;i++)
+      {
+         CuAssertTrue(tc, apx_msgQueue_remove(&queue, &msg));
+         CuAssertUIntEquals(tc, expected[i], msg.msgData1);
+      }
+   }
+   CuAssertTrue(tc, apx_msgQueue_remove(&queue, &msg) == false);
+   CuAssertIntEquals(tc, 0, apx_msgQueue_consumed(&queue, 5));
+   apx_msgQueue_destroy(&queue);
+}
+
+static void test_apx_msgQueue_conflate(CuTest* tc)
+{
+   apx_msgQueue_t queue;
+   apx_msgQueueHandler_t handler;
+   apx_msgQueueStats_t stats;
+   handlerSpy_t spy;
+   apx_msg_t msg = {RMF_MSG_WRITE_NOTIFY, 0, 0, 0, 0};
+   uint32_t i;
+   handlerSpy_create(&handler, &spy);
+   CuAssertIntEquals(tc, 0, apx_msgQueue_create(&queue, 2));
+   apx_msgQueue_setOverflowPolicy(&queue, APX_MSG_QUEUE_POLICY_CONFLATE, 2*sizeof(apx_msg_t), &handler);
+   //msgData2 is the destination, msgData1 the value
+   for (i=0;i<4;i++)
+   {
+      msg.msgData1 = i;
+      msg.msgData2 = i;
+      CuAssertIntEquals(tc, 0, apx_msgQueue_post(&queue, &msg));
+   }
+   //a new value for destination 2 replaces the queued one, it does not take a new slot
+   msg.msgData1 = 20;
+   msg.msgData2 = 2;
+   CuAssertIntEquals(tc, 0, apx_msgQueue_post(&queue, &msg));
+   CuAssertUIntEquals(tc, 1, spy.numReleased);
+   CuAssertUIntEquals(tc, 2, spy.lastReleased);
+   //no queued message for destination 4, the oldest droppable one is dropped instead
+   msg.msgData1 = 4;
+   msg.msgData2 = 4;
+   CuAssertIntEquals(tc, 0, apx_msgQueue_post(&queue, &msg));
+   CuAssertUIntEquals(tc, 2, spy.numReleased);
+   CuAssertUIntEquals(tc, 20, spy.lastReleased);
+   apx_msgQueue_getStats(&queue, &stats);
+   CuAssertUIntEquals(tc, 1, stats.numConflated);
+   CuAssertUIntEquals(tc, 1, stats.numDropped);
+   {
+      const uint32_t expected[4] = {0, 1, 3, 4};
+      for (i=0;i<4;i++)
+      {
+         CuAssertTrue(tc, apx_msgQueue_remove(&queue, &msg));
+         CuAssertUIntEquals(tc, expected[i], msg.msgData1);
+      }
+   }
+   CuAssertIntEquals(tc, 0, apx_msgQueue_consumed(&queue, 4));
+   apx_msgQueue_destroy(&queue);
+}
+
+static void test_apx_msgQueue_backpressure(CuTest* tc)
+{
+   apx_msgQueue_t queue;
+   apx_msgQueueHandler_t handler;
+   apx_msgQueueStats_t stats;
+   handlerSpy_t spy;
+   apx_msg_t msg = {RMF_MSG_WRITE_NOTIFY, 0, 0, 0, 0};
+   uint32_t i;
+   handlerSpy_create(&handler, &spy);
+   CuAssertIntEquals(tc, 0, apx_msgQueue_create(&queue, 2));
+   apx_msgQueue_setOverflowPolicy(&queue, APX_MSG_QUEUE_POLICY_BACKPRESSURE, 1*sizeof(apx_msg_t), &handler);
+   for (i=0;i<3;i++)
+   {
+      CuAssertIntEquals(tc, 0, apx_msgQueue_post(&queue, &msg));
+   }
+   //nobody is consuming, the post times out and the message stays with the caller
+   errno = 0;
+   CuAssertIntEquals(tc, -1, apx_msgQueue_post(&queue, &msg));
+   CuAssertIntEquals(tc, ENOSPC, errno);
+   CuAssertUIntEquals(tc, 0, spy.numReleased);
+   apx_msgQueue_getStats(&queue, &stats);
+   CuAssertUIntEquals(tc, 1, stats.numBackpressureWaits);
+   CuAssertUIntEquals(tc, 1, stats.numDropped);
+   //a refused post must not be counted as pending
+   for (i=0;i<3;i++)
+   {
+      CuAssertTrue(tc, apx_msgQueue_remove(&queue, &msg));
+   }
+   CuAssertIntEquals(tc, 0, apx_msgQueue_consumed(&queue, 3));
+   apx_msgQueue_destroy(&queue);
+}
+
+static void test_apx_msgQueue_wakeupOnTransition(CuTest* tc)
+{
+   apx_msgQueue_t queue;
+   apx_msg_t msg = {RMF_MSG_WRITE_NOTIFY, 0, 0, 0, 0};
+   int numWakeups = 0;
+   int32_t numRemoved = 0;
+   CuAssertIntEquals(tc, 0, apx_msgQueue_create(&queue, 16));
+   apx_msgQueue_setWakeup(&queue, wakeupSpy, &numWakeups);
+   apx_msgQueue_post(&queue, &msg);
+   apx_msgQueue_post(&queue, &msg);
+   apx_msgQueue_post(&queue, &msg);
+   CuAssertIntEquals(tc, 1, numWakeups);
+   //consumer removes two messages, the queue is still non-empty so there is no new wakeup
+   apx_msgQueue_remove(&queue, &msg);
+   apx_msgQueue_remove(&queue, &msg);
+   CuAssertIntEquals(tc, 1, apx_msgQueue_consumed(&queue, 2));
+   apx_msgQueue_post(&queue, &msg);
+   CuAssertIntEquals(tc, 1, numWakeups);
+   while (apx_msgQueue_remove(&queue, &msg) == true)
+   {
+      numRemoved++;
+   }
+   CuAssertIntEquals(tc, 0, apx_msgQueue_consumed(&queue, numRemoved));
+   apx_msgQueue_post(&queue, &msg);
+   CuAssertIntEquals(tc, 2, numWakeups);
+   apx_msgQueue_destroy(&queue);
+}
+
+#ifndef _WIN32
+static void test_apx_msgQueue_multipleProducers(CuTest* tc)
+{
+   apx_msgQueue_t queue;
+   pthread_t threads[NUM_PRODUCERS];
+   producerArg_t args[NUM_PRODUCERS];
+   uint32_t nextExpected[NUM_PRODUCERS];
+   uint32_t totalRemoved = 0;
+   uint32_t i;
+   CuAssertIntEquals(tc, 0, apx_msgQueue_create(&queue, 256));
+   memset(nextExpected, 0, sizeof(nextExpected));
+   for (i=0;i<NUM_PRODUCERS;i++)
+   {
+      args[i].queue = &queue;
+      args[i].producerId = i;
+      CuAssertIntEquals(tc, 0, pthread_create(&threads[i], 0, producerTask, &args[i]));
+   }
+   while (totalRemoved < (NUM_PRODUCERS*NUM_MESSAGES_PER_PRODUCER))
+   {
+      apx_msg_t msg;
+      int32_t numRemoved = 0;
+      apx_msgQueue_wait(&queue);
+      while (apx_msgQueue_remove(&queue, &msg) == true)
+      {
+         //messages from each producer arrive in the order they were posted
+         CuAssertUIntEquals(tc, nextExpected[msg.msgData2], msg.msgData1);
+         nextExpected[msg.msgData2]++;
+         numRemoved++;
+      }
+      apx_msgQueue_consumed(&queue, numRemoved);
+      totalRemoved += (uint32_t) numRemoved;
+   }
+   for (i=0;i<NUM_PRODUCERS;i++)
+   {
+      pthread_join(threads[i], 0);
+      CuAssertUIntEquals(tc, NUM_MESSAGES_PER_PRODUCER, nextExpected[i]);
+   }
+   apx_msgQueue_destroy(&queue);
+}
+
+/**
+ * a producer waiting for room is woken up as soon as the consumer reports consumed messages
+ */
+static void test_apx_msgQueue_backpressureWakesProducer(CuTest* tc)
+{
+   apx_msgQueue_t queue;
+   apx_msgQueueHandler_t handler;
+   apx_msgQueueStats_t stats;
+   handlerSpy_t spy;
+   apx_msg_t msg = {RMF_MSG_WRITE_NOTIFY, 0, 0, 0, 0};
+   waitingProducerArg_t arg;
+   pthread_t thread;
+   int32_t numRemoved = 0;
+   uint32_t i;
+   handlerSpy_create(&handler, &spy);
+   CuAssertIntEquals(tc, 0, apx_msgQueue_create(&queue, 2));
+   apx_msgQueue_setOverflowPolicy(&queue, APX_MSG_QUEUE_POLICY_BACKPRESSURE, 1*sizeof(apx_msg_t), &handler);
+   for (i=0;i<3;i++)
+   {
+      CuAssertIntEquals(tc, 0, apx_msgQueue_post(&queue, &msg));
+   }
+   arg.queue = &queue;
+   arg.result = -1;
+   arg.elapsedMs = 0;
+   CuAssertIntEquals(tc, 0, pthread_create(&thread, 0, waitingProducerTask, &arg));
+   SLEEP(20);
+   while (apx_msgQueue_remove(&queue, &msg) == true)
+   {
+      numRemoved++;
+   }
+   CuAssertIntEquals(tc, 3, numRemoved);
+   (void) apx_msgQueue_consumed(&queue, numRemoved);
+   pthread_join(thread, 0);
+   CuAssertIntEquals(tc, 0, arg.result);
+   CuAssertTrue(tc, arg.elapsedMs < APX_MSG_QUEUE_BACKPRESSURE_TIMEOUT_MS);
+   apx_msgQueue_getStats(&queue, &stats);
+   CuAssertUIntEquals(tc, 1, stats.numBackpressureWaits);
+   CuAssertUIntEquals(tc, 0, stats.numDropped);
+   CuAssertTrue(tc, apx_msgQueue_remove(&queue, &msg));
+   CuAssertIntEquals(tc, 0, apx_msgQueue_consumed(&queue, 1));
+   apx_msgQueue_destroy(&queue);
+}
+
+static void *producerTask(void *arg)
+{
+   producerArg_t *producerArg = (producerArg_t*) arg;
+   apx_msg_t msg = {RMF_MSG_WRITE_NOTIFY, 0, 0, 0, 0};
+   uint32_t i;
+   msg.msgData2 = producerArg->producerId;
+   for (i=0;i<NUM_MESSAGES_PER_PRODUCER;i++)
+   {
+      msg.msgData1 = i;
+      while (apx_msgQueue_post(producerArg->queue, &msg) != 0)
+      {
+         sched_yield(); //queue is full, let the consumer catch up
+      }
+   }
+   return 0;
+}
+
+static void *waitingProducerTask(void *arg)
+{
+   waitingProducerArg_t *producerArg = (waitingProducerArg_t*) arg;
+   apx_msg_t msg = {RMF_MSG_WRITE_NOTIFY, 3, 0, 0, 0};
+   uint32_t startTime = getTimeMs();
+   producerArg->result = apx_msgQueue_post(producerArg->queue, &msg);
+   producerArg->elapsedMs = getTimeMs() - startTime;
+   return 0;
+}
+
+static uint32_t getTimeMs(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint32_t) ( (ts.tv_sec * 1000u) + (ts.tv_nsec / 1000000u) );
+}
+#endif
+
+static void wakeupSpy(void *arg)
+{
+   int *numWakeups = (int*) arg;
+   (*numWakeups)++;
+}
+
+static void handlerSpy_create(apx_msgQueueHandler_t *handler, handlerSpy_t *spy)
+{
+   memset(spy, 0, sizeof(handlerSpy_t));
+   handler->arg = spy;
+   handler->isDroppable = handlerSpy_isDroppable;
+   handler->isConflatable = handlerSpy_isConflatable;
+   handler->getSize = 0;
+   handler->release = handlerSpy_release;
+}
+
+static bool handlerSpy_isDroppable(void *arg, const apx_msg_t *msg)
+{
+   (void) arg;
+   return (msg->msgType == RMF_MSG_WRITE_NOTIFY);
+}
+
+static bool handlerSpy_isConflatable(void *arg, const apx_msg_t *queuedMsg, const apx_msg_t *newMsg)
+{
+   (void) arg;
+   return ( (queuedMsg->msgType == newMsg->msgType) && (queuedMsg->msgData2 == newMsg->msgData2) );
+}
+
+static void handlerSpy_release(void *arg, const apx_msg_t *msg)
+{
+   handlerSpy_t *spy = (handlerSpy_t*) arg;
+   spy->numReleased++;
+   spy->lastReleased = msg->msgData1;
+}
+
+static uint32_t handlerSpy_getSize(void *arg, const apx_msg_t *msg)
+{
+   (void) arg;
+   return msg->msgData2;
+}
@@ -22,6 +22,7 @@
 // LOCAL FUNCTION PROTOTYPES
 //////////////////////////////////////////////////////////////////////////////
 static void test_apx_node_create(CuTest* tc);
+static void test_apx_node_clone(CuTest* tc);
 static void test_apx_node_initValue_U8(CuTest* tc);
 static void test_apx_node_initValue_U16(CuTest* tc);
 static void test_apx_node_initValue_U32(CuTest* tc);
@@ -55,6 +56,7 @@ CuSuite* testSuite_apx_node(void)
    CuSuite* suite = CuSuiteNew();
 
    SUITE_ADD_TEST(suite, test_apx_node_create);
+   SUITE_ADD_TEST(suite, test_apx_node_clone);
    SUITE_ADD_TEST(suite, test_apx_node_initValue_U8);
    SUITE_ADD_TEST(suite, test_apx_node_initValue_U16);
    SUITE_ADD_TEST(suite, test_apx_node_initValue_U32);
@@ -100,6 +102,53 @@ static void test_apx_node_create(CuTest* tc)
    CuAssertIntEquals(tc, APX_NO_ERROR, apx_getLastError());
 }
 
+static void test_apx_node_clone(CuTest* tc)
+{
+   apx_node_t node;
+   apx_node_t *copy;
+   apx_port_t *port;
+   apx_port_t *portCopy;
+   apx_dataElement_t *child;
+   apx_clearError();
+   apx_node_create(&node,"Dummy");
+   apx_node_createDataType(&node,"Position_T","{\"X\"S\"Y\"S}",0);
+   apx_node_createRequirePort(&node,"WheelBasedVehicleSpeed","S",0);
+   apx_node_createRequirePort(&node,"Position","T[0]",0);
+   apx_node_createProvidePort(&node,"ParkBrakeActuationFalue","C(0,3)",0);
+   //only finalized nodes can be copied
+   CuAssertPtrEquals(tc, 0, apx_node_clone(&node));
+   apx_node_finalize(&node);
+   copy = apx_node_clone(&node);
+   CuAssertPtrNotNull(tc, copy);
+   CuAssertStrEquals(tc, "Dummy", copy->name);
+   CuAssertTrue(tc, copy->isFinalized);
+   CuAssertIntEquals(tc, 1, adt_ary_length(&copy->datatypeList));
+   CuAssertIntEquals(tc, 2, apx_node_getNumRequirePorts(copy));
+   CuAssertIntEquals(tc, 1, apx_node_getNumProvidePorts(copy));
+   port = apx_node_getRequirePort(&node, 1);
+   portCopy = apx_node_getRequirePort(copy, 1);
+   CuAssertTrue(tc, port != portCopy);
+   CuAssertStrEquals(tc, "T[0]", portCopy->dataSignature);
+   CuAssertIntEquals(tc, 1, apx_port_getPortIndex(portCopy));
+   CuAssertIntEquals(tc, 4, apx_port_getPackLen(portCopy));
+   //interned port signatures are shared, data elements are copied
+   CuAssertPtrEquals(tc, (void*) port->portSignature, (void*) portCopy->portSignature);
+   CuAssertIntEquals(tc, apx_port_getPortSignatureId(port), apx_port_getPortSignatureId(portCopy));
+   CuAssertTrue(tc, port->derivedDsg.dataElement != portCopy->derivedDsg.dataElement);
+   CuAssertIntEquals(tc, 2, apx_dataElement_getNumChild(portCopy->derivedDsg.dataElement));
+   child = apx_dataElement_getChildAt(portCopy->derivedDsg.dataElement, 1);
+   CuAssertPtrNotNull(tc, child);
+   CuAssertStrEquals(tc, "Y", child->name);
+   CuAssertIntEquals(tc, 2, child->packLen);
+   portCopy = apx_node_getProvidePort(copy, 0);
+   CuAssertIntEquals(tc, 3, portCopy->derivedDsg.dataElement->max.u32);
+   apx_node_destroy(&node);
+   //the copy does not depend on the original
+   CuAssertStrEquals(tc, "\"ParkBrakeActuationFalue\"C(0,3)", apx_port_getPortSignature(portCopy));
+   apx_node_delete(copy);
+   CuAssertIntEquals(tc, APX_NO_ERROR, apx_getLastError());
+}
+
 static void test_apx_node_initValue_U8(CuTest* tc)
 {
    apx_node_t node;
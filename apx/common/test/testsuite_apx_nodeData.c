@@ -23,6 +23,8 @@
 // LOCAL FUNCTION PROTOTYPES
 //////////////////////////////////////////////////////////////////////////////
 static void test_apx_nodeData_newEmpty(CuTest* tc);
+static void test_apx_nodeData_writeInPortDataPending(CuTest* tc);
+static void test_apx_nodeData_writeInPortDataResume(CuTest* tc);
 
 //////////////////////////////////////////////////////////////////////////////
 // GLOBAL VARIABLES
@@ -43,6 +45,8 @@ CuSuite* testSuite_apx_nodeData(void)
    CuSuite* suite = CuSuiteNew();
 
    SUITE_ADD_TEST(suite, test_apx_nodeData_newEmpty);
+   SUITE_ADD_TEST(suite, test_apx_nodeData_writeInPortDataPending);
+   SUITE_ADD_TEST(suite, test_apx_nodeData_writeInPortDataResume);
 
    return suite;
 }
@@ -78,3 +82,52 @@ static void test_apx_nodeData_newEmpty(CuTest* tc)
 
 }
 
+static void test_apx_nodeData_writeInPortDataPending(CuTest* tc)
+{
+   apx_nodeData_t nodeData;
+   uint8_t inPortDataBuf[4] = {0, 0, 0, 0};
+   uint8_t inPortDirtyFlags[4] = {0, 0, 0, 0};
+   uint8_t value1[2] = {0x12, 0x34};
+   uint8_t value2[2] = {0x56, 0x78};
+   uint8_t readBuf[2];
+   apx_nodeData_create(&nodeData, "TestNode1", 0, 0, inPortDataBuf, inPortDirtyFlags, sizeof(inPortDataBuf), 0, 0, 0);
+   //first write makes the port pending, second write only replaces the value
+   CuAssertIntEquals(tc, 0, apx_nodeData_writeInPortDataPending(&nodeData, value1, 2, 2));
+   CuAssertIntEquals(tc, 1, apx_nodeData_writeInPortDataPending(&nodeData, value2, 2, 2));
+   CuAssertIntEquals(tc, 0, apx_nodeData_readInPortData(&nodeData, readBuf, 2, 2));
+   CuAssertIntEquals(tc, 0, memcmp(readBuf, value2, sizeof(value2)));
+   //reading the data ends the pending state
+   CuAssertIntEquals(tc, 0, apx_nodeData_writeInPortDataPending(&nodeData, value1, 2, 2));
+   apx_nodeData_clearInPortDataPending(&nodeData, 2);
+   CuAssertIntEquals(tc, 0, apx_nodeData_writeInPortDataPending(&nodeData, value1, 2, 2));
+   //writes to other ports are tracked separately
+   CuAssertIntEquals(tc, 0, apx_nodeData_writeInPortDataPending(&nodeData, value1, 0, 2));
+   CuAssertIntEquals(tc, -1, apx_nodeData_writeInPortDataPending(&nodeData, value1, 3, 2));
+   apx_nodeData_destroy(&nodeData);
+}
+
+static void test_apx_nodeData_writeInPortDataResume(CuTest* tc)
+{
+   apx_nodeData_t nodeData;
+   uint8_t inPortDataBuf[4] = {0, 0, 0, 0};
+   uint8_t value[2] = {0x12, 0x34};
+   uint8_t *resumeFlags;
+   apx_nodeData_create(&nodeData, "TestNode1", 0, 0, inPortDataBuf, 0, sizeof(inPortDataBuf), 0, 0, 0);
+   CuAssertPtrEquals(tc, 0, apx_nodeData_takeInPortResumeFlags(&nodeData));
+   //without resume flags only the value is written
+   CuAssertIntEquals(tc, 0, apx_nodeData_writeInPortDataResume(&nodeData, value, 0, 1));
+   CuAssertIntEquals(tc, 0x12, inPortDataBuf[0]);
+   nodeData.inPortResumeFlags = (uint8_t*) calloc(sizeof(inPortDataBuf), 1);
+   CuAssertIntEquals(tc, 0, apx_nodeData_writeInPortDataResume(&nodeData, value, 1, 2));
+   CuAssertIntEquals(tc, -1, apx_nodeData_writeInPortDataResume(&nodeData, value, 3, 2));
+   CuAssertIntEquals(tc, 0x34, inPortDataBuf[2]);
+   resumeFlags = apx_nodeData_takeInPortResumeFlags(&nodeData);
+   CuAssertPtrNotNull(tc, resumeFlags);
+   CuAssertPtrEquals(tc, 0, nodeData.inPortResumeFlags);
+   CuAssertIntEquals(tc, 0, resumeFlags[0]);
+   CuAssertIntEquals(tc, 1, resumeFlags[1]);
+   CuAssertIntEquals(tc, 1, resumeFlags[2]);
+   CuAssertIntEquals(tc, 0, resumeFlags[3]);
+   free(resumeFlags);
+   apx_nodeData_destroy(&nodeData);
+}
@@ -97,16 +97,16 @@ static void test_apx_nodeInfo_create(CuTest* tc)
    apx_nodeInfo_create(&nodeInfo3,node3);
    apx_nodeInfo_create(&nodeInfo4,node4);
    apx_nodeInfo_create(&nodeInfo5,node5);
-   CuAssertIntEquals(tc,1,apx_portDataMap_getDataLen(&nodeInfo1.inDataMap));
-   CuAssertIntEquals(tc,4,apx_portDataMap_getDataLen(&nodeInfo1.outDataMap));
-   CuAssertIntEquals(tc,1,apx_portDataMap_getDataLen(&nodeInfo2.inDataMap));
-   CuAssertIntEquals(tc,3,apx_portDataMap_getDataLen(&nodeInfo2.outDataMap));
-   CuAssertIntEquals(tc,2,apx_portDataMap_getDataLen(&nodeInfo3.inDataMap));
-   CuAssertIntEquals(tc,0,apx_portDataMap_getDataLen(&nodeInfo3.outDataMap));
-   CuAssertIntEquals(tc,4,apx_portDataMap_getDataLen(&nodeInfo4.inDataMap));
-   CuAssertIntEquals(tc,0,apx_portDataMap_getDataLen(&nodeInfo4.outDataMap));
-   CuAssertIntEquals(tc,3,apx_portDataMap_getDataLen(&nodeInfo5.inDataMap));
-   CuAssertIntEquals(tc,1,apx_portDataMap_getDataLen(&nodeInfo5.outDataMap));
+   CuAssertIntEquals(tc,1,apx_portDataMap_getDataLen(nodeInfo1.inDataMap));
+   CuAssertIntEquals(tc,4,apx_portDataMap_getDataLen(nodeInfo1.outDataMap));
+   CuAssertIntEquals(tc,1,apx_portDataMap_getDataLen(nodeInfo2.inDataMap));
+   CuAssertIntEquals(tc,3,apx_portDataMap_getDataLen(nodeInfo2.outDataMap));
+   CuAssertIntEquals(tc,2,apx_portDataMap_getDataLen(nodeInfo3.inDataMap));
+   CuAssertIntEquals(tc,0,apx_portDataMap_getDataLen(nodeInfo3.outDataMap));
+   CuAssertIntEquals(tc,4,apx_portDataMap_getDataLen(nodeInfo4.inDataMap));
+   CuAssertIntEquals(tc,0,apx_portDataMap_getDataLen(nodeInfo4.outDataMap));
+   CuAssertIntEquals(tc,3,apx_portDataMap_getDataLen(nodeInfo5.inDataMap));
+   CuAssertIntEquals(tc,1,apx_portDataMap_getDataLen(nodeInfo5.outDataMap));
    CuAssertPtrEquals(tc,&nodeInfo1,node1->nodeInfo);
    CuAssertPtrEquals(tc,&nodeInfo2,node2->nodeInfo);
    CuAssertPtrEquals(tc,&nodeInfo3,node3->nodeInfo);
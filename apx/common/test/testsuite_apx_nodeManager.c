@@ -0,0 +1,306 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+#include "CuTest.h"
+#include "apx_fileManager.h"
+#include "apx_nodeManager.h"
+#include "apx_router.h"
+#include "rmf.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#if defined(_MSC_VER) && (_MSC_VER<=1800)
+#define snprintf _snprintf
+#endif
+
+#define NUM_CONNECTIONS 4
+#define NUM_ITERATIONS 50
+#define DEFINITION_ADDRESS 0x4000000
+#define DEFINITION_MAX_LEN 256
+#define SEND_BUFFER_LEN 4096
+
+typedef struct connectionArg_tag
+{
+   apx_nodeManager_t *nodeManager;
+   apx_fileManager_t *fileManager; //the file manager that is still attached when the task returns
+   int32_t connectionId;
+   bool isInline; //true when the definitions are linked before apx_fileManager_parseMessage returns
+   int32_t numErrors;
+   uint8_t sendBuffer[SEND_BUFFER_LEN];
+}connectionArg_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static void test_apx_nodeManager_attachDetachInline(CuTest* tc);
+#ifndef _WIN32
+static void test_apx_nodeManager_concurrentAttachDetach(CuTest* tc);
+static void test_apx_nodeManager_concurrentAttachDetachWithWorkers(CuTest* tc);
+static void runConnections(CuTest* tc, int32_t numWorkers);
+static void *connectionTask(void *arg);
+#endif
+static apx_fileManager_t *connectClient(connectionArg_t *arg);
+static void disconnectClient(connectionArg_t *arg, apx_fileManager_t *fileManager);
+static void addNode(connectionArg_t *arg, apx_fileManager_t *fileManager);
+static void sendMessage(apx_fileManager_t *fileManager, uint32_t address, const uint8_t *data, int32_t dataLen);
+static int32_t getNumNodes(apx_nodeManager_t *nodeManager);
+static int32_t transmitHandler_getSendAvail(void *arg);
+static uint8_t *transmitHandler_getSendBuffer(void *arg, int32_t msgLen);
+static int32_t transmitHandler_send(void *arg, int32_t offset, int32_t msgLen);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+
+CuSuite* testSuite_apx_nodeManager(void)
+{
+   CuSuite* suite = CuSuiteNew();
+
+   SUITE_ADD_TEST(suite, test_apx_nodeManager_attachDetachInline);
+#ifndef _WIN32
+   SUITE_ADD_TEST(suite, test_apx_nodeManager_concurrentAttachDetach);
+   SUITE_ADD_TEST(suite, test_apx_nodeManager_concurrentAttachDetachWithWorkers);
+#endif
+
+   return suite;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+static void test_apx_nodeManager_attachDetachInline(CuTest* tc)
+{
+   apx_nodeManager_t nodeManager;
+   apx_router_t router;
+   connectionArg_t arg;
+   apx_fileManager_t *fileManager;
+   apx_nodeManager_create(&nodeManager);
+   apx_router_create(&router);
+   apx_nodeManager_setRouter(&nodeManager, &router);
+   memset(&arg, 0, sizeof(arg));
+   arg.nodeManager = &nodeManager;
+   arg.isInline = true;
+   fileManager = connectClient(&arg);
+   CuAssertPtrNotNull(tc, fileManager);
+   addNode(&arg, fileManager);
+   CuAssertIntEquals(tc, 0, arg.numErrors);
+   CuAssertIntEquals(tc, 1, getNumNodes(&nodeManager));
+   disconnectClient(&arg, fileManager);
+   CuAssertIntEquals(tc, 0, getNumNodes(&nodeManager));
+   apx_nodeManager_destroy(&nodeManager);
+   apx_router_destroy(&router);
+}
+
+#ifndef _WIN32
+/**
+ * Connections create, link and delete their nodes at the same time. Every node provides a port required by the node of the next connection.
+ */
+static void test_apx_nodeManager_concurrentAttachDetach(CuTest* tc)
+{
+   runConnections(tc, 0);
+}
+
+/**
+ * Same as above with the definitions processed by workers. Connections are often detached while their definition is still in the pipeline
+ */
+static void test_apx_nodeManager_concurrentAttachDetachWithWorkers(CuTest* tc)
+{
+   runConnections(tc, 2);
+}
+
+static void runConnections(CuTest* tc, int32_t numWorkers)
+{
+   apx_nodeManager_t nodeManager;
+   apx_router_t router;
+   pthread_t threads[NUM_CONNECTIONS];
+   connectionArg_t *args;
+   int32_t i;
+   args = (connectionArg_t*) malloc(sizeof(connectionArg_t)*NUM_CONNECTIONS);
+   CuAssertPtrNotNull(tc, args);
+   memset(args, 0, sizeof(connectionArg_t)*NUM_CONNECTIONS);
+   apx_nodeManager_create(&nodeManager);
+   apx_router_create(&router);
+   apx_nodeManager_setRouter(&nodeManager, &router);
+   if (numWorkers > 0)
+   {
+      CuAssertIntEquals(tc, 0, apx_nodeManager_startDefinitionWorkers(&nodeManager, numWorkers));
+   }
+   for (i=0; i<NUM_CONNECTIONS; i++)
+   {
+      args[i].nodeManager = &nodeManager;
+      args[i].connectionId = i;
+      args[i].isInline = (numWorkers == 0)? true : false;
+      CuAssertIntEquals(tc, 0, pthread_create(&threads[i], 0, connectionTask, &args[i]));
+   }
+   for (i=0; i<NUM_CONNECTIONS; i++)
+   {
+      pthread_join(threads[i], 0);
+      CuAssertIntEquals(tc, 0, args[i].numErrors);
+      CuAssertPtrNotNull(tc, args[i].fileManager);
+   }
+   //the last definition of every connection has been linked
+   apx_definitionPipeline_flush(&nodeManager.definitionPipeline);
+   CuAssertIntEquals(tc, NUM_CONNECTIONS, getNumNodes(&nodeManager));
+   for (i=0; i<NUM_CONNECTIONS; i++)
+   {
+      char name[RMF_MAX_FILE_NAME+1];
+      sprintf(name, "Node%d.in", (int) i);
+      CuAssertPtrNotNull(tc, apx_fileMap_findByName(&args[i].fileManager->localFileMap, name));
+      disconnectClient(&args[i], args[i].fileManager);
+   }
+   CuAssertIntEquals(tc, 0, getNumNodes(&nodeManager));
+   apx_nodeManager_destroy(&nodeManager);
+   apx_router_destroy(&router);
+   free(args);
+}
+
+static void *connectionTask(void *arg)
+{
+   connectionArg_t *connectionArg = (connectionArg_t*) arg;
+   int32_t i;
+   for (i=0; i<NUM_ITERATIONS; i++)
+   {
+      apx_fileManager_t *fileManager = connectClient(connectionArg);
+      if (fileManager == 0)
+      {
+         connectionArg->numErrors++;
+         break;
+      }
+      addNode(connectionArg, fileManager);
+      if (i < NUM_ITERATIONS-1)
+      {
+         disconnectClient(connectionArg, fileManager);
+      }
+      else
+      {
+         connectionArg->fileManager = fileManager;
+      }
+   }
+   return 0;
+}
+#endif
+
+/**
+ * creates a file manager the way a server connection does. Its messages are never processed, it only needs to accept what is sent
+ */
+static apx_fileManager_t *connectClient(connectionArg_t *arg)
+{
+   apx_fileManager_t *fileManager = apx_fileManager_new(APX_FILEMANAGER_SERVER_MODE);
+   if (fileManager != 0)
+   {
+      apx_transmitHandler_t transmitHandler;
+      memset(&transmitHandler, 0, sizeof(transmitHandler));
+      transmitHandler.arg = arg;
+      transmitHandler.getSendAvail = transmitHandler_getSendAvail;
+      transmitHandler.getSendBuffer = transmitHandler_getSendBuffer;
+      transmitHandler.send = transmitHandler_send;
+      apx_fileManager_setTransmitHandler(fileManager, &transmitHandler);
+      apx_nodeManager_attachFileManager(arg->nodeManager, fileManager);
+   }
+   return fileManager;
+}
+
+static void disconnectClient(connectionArg_t *arg, apx_fileManager_t *fileManager)
+{
+   apx_nodeManager_detachFileManager(arg->nodeManager, fileManager);
+   apx_fileManager_delete(fileManager);
+}
+
+/**
+ * announces and writes the definition of Node<connectionId>, which requires the port provided by the node of the next connection
+ */
+static void addNode(connectionArg_t *arg, apx_fileManager_t *fileManager)
+{
+   char definition[DEFINITION_MAX_LEN];
+   char name[RMF_MAX_FILE_NAME+1];
+   uint8_t msgBuffer[RMF_MAX_CMD_BUF_SIZE];
+   rmf_fileInfo_t fileInfo;
+   int32_t definitionLen;
+   int32_t msgLen;
+   definitionLen = (int32_t) snprintf(definition, sizeof(definition), "APX/1.2\nN\"Node%d\"\nP\"Signal%d\"S\nR\"Signal%d\"S\n\n",
+         (int) arg->connectionId, (int) arg->connectionId, (int) ((arg->connectionId+1) % NUM_CONNECTIONS));
+   sprintf(name, "Node%d.apx", (int) arg->connectionId);
+   rmf_fileInfo_create(&fileInfo, name, DEFINITION_ADDRESS, (uint32_t) definitionLen, RMF_FILE_TYPE_FIXED);
+   msgLen = rmf_serialize_cmdFileInfo(&msgBuffer[0], sizeof(msgBuffer), &fileInfo);
+   assert(msgLen > 0);
+   sendMessage(fileManager, RMF_CMD_START_ADDR, &msgBuffer[0], msgLen);
+   sendMessage(fileManager, DEFINITION_ADDRESS, (const uint8_t*) definition, definitionLen);
+   if (arg->isInline == true)
+   {
+      //the node has been linked, its inPortData file is waiting to be opened by the client
+      sprintf(name, "Node%d.in", (int) arg->connectionId);
+      if (apx_fileMap_findByName(&fileManager->localFileMap, name) == 0)
+      {
+         arg->numErrors++;
+      }
+   }
+}
+
+static void sendMessage(apx_fileManager_t *fileManager, uint32_t address, const uint8_t *data, int32_t dataLen)
+{
+   uint8_t msgBuffer[RMF_MAX_HEADER_SIZE+DEFINITION_MAX_LEN];
+   int32_t headerLen = rmf_packHeader(&msgBuffer[0], sizeof(msgBuffer), address, false);
+   assert( (headerLen > 0) && (headerLen+dataLen <= (int32_t) sizeof(msgBuffer)) );
+   memcpy(&msgBuffer[headerLen], data, dataLen);
+   (void) apx_fileManager_parseMessage(fileManager, &msgBuffer[0], headerLen+dataLen);
+}
+
+static int32_t getNumNodes(apx_nodeManager_t *nodeManager)
+{
+   int32_t numNodes = 0;
+   int32_t i;
+   for (i=0; i<APX_NODE_MANAGER_NUM_SHARDS; i++)
+   {
+      apx_nodeManagerShard_t *shard = &nodeManager->shards[i];
+      MUTEX_LOCK(shard->lock);
+      numNodes += (int32_t) adt_hash_length(&shard->nodeInfoMap);
+      MUTEX_UNLOCK(shard->lock);
+   }
+   return numNodes;
+}
+
+static int32_t transmitHandler_getSendAvail(void *arg)
+{
+   (void) arg;
+   return SEND_BUFFER_LEN;
+}
+
+static uint8_t *transmitHandler_getSendBuffer(void *arg, int32_t msgLen)
+{
+   connectionArg_t *connectionArg = (connectionArg_t*) arg;
+   if (msgLen <= SEND_BUFFER_LEN)
+   {
+      return &connectionArg->sendBuffer[0];
+   }
+   return (uint8_t*) 0;
+}
+
+static int32_t transmitHandler_send(void *arg, int32_t offset, int32_t msgLen)
+{
+   (void) arg;
+   (void) offset;
+   return msgLen;
+}
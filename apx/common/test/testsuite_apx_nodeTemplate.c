@@ -0,0 +1,138 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "CuTest.h"
+#include "apx_nodeTemplate.h"
+#include "apx_nodeInfo.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static void test_apx_nodeTemplate_shareIdenticalNodes(CuTest* tc);
+static void test_apx_nodeTemplate_differentPortsDifferentTemplates(CuTest* tc);
+static void test_apx_nodeTemplate_nodeInfoUsesTemplateDataMaps(CuTest* tc);
+static apx_node_t *createEcuNode(const char *name, const char *speedSignature);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+
+CuSuite* testSuite_apx_nodeTemplate(void)
+{
+   CuSuite* suite = CuSuiteNew();
+
+   SUITE_ADD_TEST(suite, test_apx_nodeTemplate_shareIdenticalNodes);
+   SUITE_ADD_TEST(suite, test_apx_nodeTemplate_differentPortsDifferentTemplates);
+   SUITE_ADD_TEST(suite, test_apx_nodeTemplate_nodeInfoUsesTemplateDataMaps);
+
+   return suite;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+static void test_apx_nodeTemplate_shareIdenticalNodes(CuTest* tc)
+{
+   apx_node_t *node1;
+   apx_node_t *node2;
+   int32_t numTemplates = apx_nodeTemplate_getNumTemplates();
+   node1 = apx_nodeTemplate_shareNode(createEcuNode("Ecu1", "S"));
+   node2 = apx_nodeTemplate_shareNode(createEcuNode("Ecu2", "S"));
+   CuAssertPtrNotNull(tc, node1);
+   CuAssertPtrNotNull(tc, node2);
+   CuAssertStrEquals(tc, "Ecu1", apx_node_getName(node1));
+   CuAssertStrEquals(tc, "Ecu2", apx_node_getName(node2));
+   CuAssertTrue(tc, node1->isFinalized);
+   CuAssertPtrNotNull(tc, node1->nodeTemplate);
+   CuAssertPtrEquals(tc, node1->nodeTemplate, node2->nodeTemplate);
+   CuAssertIntEquals(tc, numTemplates+1, apx_nodeTemplate_getNumTemplates());
+   CuAssertIntEquals(tc, 2, apx_node_getNumRequirePorts(node2));
+   CuAssertIntEquals(tc, 1, apx_node_getNumProvidePorts(node2));
+   CuAssertPtrEquals(tc, apx_node_getRequirePort(node1, 1), apx_node_getRequirePort(node2, 1));
+   CuAssertPtrEquals(tc, apx_node_getProvidePort(node1, 0), apx_node_getProvidePort(node2, 0));
+   CuAssertIntEquals(tc, 3, node2->nodeTemplate->inPortDataLen);
+   CuAssertIntEquals(tc, 7, node2->nodeTemplate->inPortInitData[0]);
+   CuAssertIntEquals(tc, 0xFF, node2->nodeTemplate->inPortInitData[1]);
+   CuAssertIntEquals(tc, 0xFF, node2->nodeTemplate->inPortInitData[2]);
+   //the ports stay until the last node using them is deleted
+   apx_node_delete(node1);
+   CuAssertIntEquals(tc, numTemplates+1, apx_nodeTemplate_getNumTemplates());
+   CuAssertStrEquals(tc, "VehicleSpeed", apx_node_getRequirePort(node2, 1)->name);
+   apx_node_delete(node2);
+   CuAssertIntEquals(tc, numTemplates, apx_nodeTemplate_getNumTemplates());
+}
+
+static void test_apx_nodeTemplate_differentPortsDifferentTemplates(CuTest* tc)
+{
+   apx_node_t *node1;
+   apx_node_t *node2;
+   int32_t numTemplates = apx_nodeTemplate_getNumTemplates();
+   node1 = apx_nodeTemplate_shareNode(createEcuNode("Ecu1", "S"));
+   node2 = apx_nodeTemplate_shareNode(createEcuNode("Ecu1", "L"));
+   CuAssertPtrNotNull(tc, node1);
+   CuAssertPtrNotNull(tc, node2);
+   CuAssertTrue(tc, node1->nodeTemplate != node2->nodeTemplate);
+   CuAssertIntEquals(tc, numTemplates+2, apx_nodeTemplate_getNumTemplates());
+   CuAssertIntEquals(tc, 5, node2->nodeTemplate->inPortDataLen);
+   apx_node_delete(node1);
+   apx_node_delete(node2);
+   CuAssertIntEquals(tc, numTemplates, apx_nodeTemplate_getNumTemplates());
+}
+
+static void test_apx_nodeTemplate_nodeInfoUsesTemplateDataMaps(CuTest* tc)
+{
+   apx_nodeInfo_t *nodeInfo1;
+   apx_nodeInfo_t *nodeInfo2;
+   apx_node_t *node1 = apx_nodeTemplate_shareNode(createEcuNode("Ecu1", "S"));
+   apx_node_t *node2 = apx_nodeTemplate_createNode(node1->nodeTemplate, "Ecu2");
+   CuAssertPtrNotNull(tc, node2);
+   nodeInfo1 = apx_nodeInfo_new(node1);
+   nodeInfo2 = apx_nodeInfo_new(node2);
+   nodeInfo1->isWeakRef_node = false;
+   nodeInfo2->isWeakRef_node = false;
+   CuAssertPtrEquals(tc, &node1->nodeTemplate->inDataMap, nodeInfo1->inDataMap);
+   CuAssertPtrEquals(tc, nodeInfo1->inDataMap, nodeInfo2->inDataMap);
+   CuAssertPtrEquals(tc, nodeInfo1->outDataMap, nodeInfo2->outDataMap);
+   CuAssertIntEquals(tc, 3, apx_nodeInfo_getInPortDataLen(nodeInfo2));
+   CuAssertIntEquals(tc, 4, apx_nodeInfo_getOutPortDataLen(nodeInfo2));
+   CuAssertIntEquals(tc, 1, apx_nodeInfo_getInPortDataOffset(nodeInfo2, 1));
+   //each nodeInfo has its own connectors and port flags
+   CuAssertTrue(tc, nodeInfo1->requirePortFlags != nodeInfo2->requirePortFlags);
+   CuAssertPtrEquals(tc, nodeInfo1, node1->nodeInfo);
+   CuAssertPtrEquals(tc, nodeInfo2, node2->nodeInfo);
+   apx_nodeInfo_delete(nodeInfo1);
+   apx_nodeInfo_delete(nodeInfo2);
+}
+
+static apx_node_t *createEcuNode(const char *name, const char *speedSignature)
+{
+   apx_node_t *node = apx_node_new(name);
+   apx_node_createDataType(node, "Gear_T", "C(0,7)", 0);
+   apx_node_createRequirePort(node, "Gear", "T[0]", "=7");
+   apx_node_createRequirePort(node, "VehicleSpeed", speedSignature, "=65535");
+   apx_node_createProvidePort(node, "EngineSpeed", "L", 0);
+   return node;
+}
@@ -30,6 +30,42 @@ void test_apx_port_create(CuTest* tc)
 
 }
 
+void test_apx_port_internPortSignature(CuTest* tc)
+{
+   apx_port_t port1;
+   apx_port_t port2;
+   apx_port_t port3;
+   int32_t id1;
+   int32_t id3;
+   apx_port_create(&port1,APX_REQUIRE_PORT,"VehicleSpeed","S",NULL);
+   apx_port_create(&port2,APX_PROVIDE_PORT,"VehicleSpeed","S",NULL);
+   apx_port_create(&port3,APX_REQUIRE_PORT,"EngineSpeed","S",NULL);
+   CuAssertIntEquals(tc,APX_PORT_SIGNATURE_ID_INVALID,port1.portSignatureId);
+   id1 = apx_port_internPortSignature(&port1);
+   CuAssertTrue(tc,id1 >= 0);
+   //ports with the same signature share the id and the string
+   CuAssertIntEquals(tc,id1,apx_port_getPortSignatureId(&port2));
+   CuAssertPtrEquals(tc,port1.portSignature,port2.portSignature);
+   CuAssertStrEquals(tc,"\"VehicleSpeed\"S",apx_port_getPortSignature(&port2));
+   id3 = apx_port_getPortSignatureId(&port3);
+   CuAssertTrue(tc,id3 >= 0);
+   CuAssertTrue(tc,id3 != id1);
+   CuAssertStrEquals(tc,"\"VehicleSpeed\"S",apx_portSignatureTable_getSignature(id1));
+   CuAssertStrEquals(tc,"\"EngineSpeed\"S",apx_portSignatureTable_getSignature(id3));
+   CuAssertTrue(tc,apx_portSignatureTable_length() > id3);
+   CuAssertPtrEquals(tc,NULL,(void*)apx_portSignatureTable_getSignature(apx_portSignatureTable_length()));
+   apx_port_destroy(&port1);
+   //the signature stays while port2 holds a reference
+   CuAssertStrEquals(tc,"\"VehicleSpeed\"S",apx_portSignatureTable_getSignature(id1));
+   apx_port_destroy(&port2);
+   //the last reference is gone, the string is freed and the id is given to the next new signature
+   CuAssertPtrEquals(tc,NULL,(void*)apx_portSignatureTable_getSignature(id1));
+   CuAssertIntEquals(tc,id1,apx_portSignatureTable_intern("\"WheelSpeed\"S",NULL));
+   CuAssertStrEquals(tc,"\"WheelSpeed\"S",apx_portSignatureTable_getSignature(id1));
+   apx_portSignatureTable_release(id1);
+   apx_port_destroy(&port3);
+}
+
 
 
 
@@ -38,6 +74,7 @@ CuSuite* testsuite_apx_port(void)
    CuSuite* suite = CuSuiteNew();
 
    SUITE_ADD_TEST(suite, test_apx_port_create);
+   SUITE_ADD_TEST(suite, test_apx_port_internPortSignature);
 
    return suite;
 }
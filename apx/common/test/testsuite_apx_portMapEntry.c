@@ -75,16 +75,27 @@ static void test_apx_routerPortMapEntry_create(CuTest* tc)
    apx_routerPortMapEntry_insertRequirePort(&portMapEntry,&node3,0);
    apx_routerPortMapEntry_insertRequirePort(&portMapEntry,&node4,0);
    apx_routerPortMapEntry_insertRequirePort(&portMapEntry,&node5,0);
-   CuAssertIntEquals(tc, 2, adt_ary_length(&portMapEntry.providePorts));
-   CuAssertIntEquals(tc, 3, adt_ary_length(&portMapEntry.requirePorts));
+   CuAssertIntEquals(tc, 2, apx_portrefSet_length(&portMapEntry.providePorts));
+   CuAssertIntEquals(tc, 3, apx_portrefSet_length(&portMapEntry.requirePorts));
    //test that it prevents duplicate items
    apx_routerPortMapEntry_insertProvidePort(&portMapEntry,&node1,0);
    apx_routerPortMapEntry_insertProvidePort(&portMapEntry,&node2,0);
    apx_routerPortMapEntry_insertRequirePort(&portMapEntry,&node3,0);
    apx_routerPortMapEntry_insertRequirePort(&portMapEntry,&node4,0);
    apx_routerPortMapEntry_insertRequirePort(&portMapEntry,&node5,0);
-   CuAssertIntEquals(tc, 2, adt_ary_length(&portMapEntry.providePorts));
-   CuAssertIntEquals(tc, 3, adt_ary_length(&portMapEntry.requirePorts));
+   CuAssertIntEquals(tc, 2, apx_portrefSet_length(&portMapEntry.providePorts));
+   CuAssertIntEquals(tc, 3, apx_portrefSet_length(&portMapEntry.requirePorts));
+   //removing a port keeps the order of the others, the last provider is still the most recently inserted one
+   apx_routerPortMapEntry_insertProvidePort(&portMapEntry,&node1,0);
+   CuAssertPtrEquals(tc, &node2, apx_routerPortMapEntry_getProvidePortById(&portMapEntry,1)->node);
+   CuAssertIntEquals(tc, 0, apx_routerPortMapEntry_removePort(&portMapEntry,&node1,(apx_port_t*) adt_ary_value(&node1.providePortList,0)));
+   CuAssertIntEquals(tc, 1, apx_portrefSet_length(&portMapEntry.providePorts));
+   CuAssertIntEquals(tc, 0, apx_routerPortMapEntry_removePort(&portMapEntry,&node4,(apx_port_t*) adt_ary_value(&node4.requirePortList,0)));
+   CuAssertIntEquals(tc, 2, apx_portrefSet_length(&portMapEntry.requirePorts));
+   CuAssertPtrEquals(tc, &node3, apx_routerPortMapEntry_getRequirePortById(&portMapEntry,0)->node);
+   CuAssertPtrEquals(tc, &node5, apx_routerPortMapEntry_getRequirePortById(&portMapEntry,1)->node);
+   apx_routerPortMapEntry_insertProvidePort(&portMapEntry,&node1,0);
+   CuAssertPtrEquals(tc, &node1, apx_routerPortMapEntry_getProvidePortById(&portMapEntry,1)->node);
 
    apx_routerPortMapEntry_destroy(&portMapEntry);
    apx_node_destroy(&node1);
@@ -0,0 +1,197 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "CuTest.h"
+#include "apx_portrefSet.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#define APX_TEST_NUM_NODES 300
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static void test_apx_portrefSet_insertRemove(CuTest* tc);
+static void test_apx_portrefSet_keepsOrder(CuTest* tc);
+static void test_apx_portrefSet_reconnectStorm(CuTest* tc);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+
+CuSuite* testSuite_apx_portrefSet(void)
+{
+   CuSuite* suite = CuSuiteNew();
+
+   SUITE_ADD_TEST(suite, test_apx_portrefSet_insertRemove);
+   SUITE_ADD_TEST(suite, test_apx_portrefSet_keepsOrder);
+   SUITE_ADD_TEST(suite, test_apx_portrefSet_reconnectStorm);
+
+   return suite;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+static void test_apx_portrefSet_insertRemove(CuTest* tc)
+{
+   apx_portrefSet_t set;
+   apx_node_t node1;
+   apx_node_t node2;
+   apx_port_t *port1;
+   apx_port_t *port2;
+   apx_node_create(&node1, "test1");
+   apx_node_create(&node2, "test2");
+   apx_node_createRequirePort(&node1, "VehicleSpeed", "S", 0);
+   apx_node_createRequirePort(&node2, "VehicleSpeed", "S", 0);
+   port1 = (apx_port_t*) adt_ary_value(&node1.requirePortList, 0);
+   port2 = (apx_port_t*) adt_ary_value(&node2.requirePortList, 0);
+   apx_portrefSet_create(&set);
+   CuAssertIntEquals(tc, 0, apx_portrefSet_length(&set));
+   CuAssertTrue(tc, !apx_portrefSet_contains(&set, &node1, port1));
+   CuAssertIntEquals(tc, 0, apx_portrefSet_insert(&set, &node1, port1));
+   CuAssertIntEquals(tc, 0, apx_portrefSet_insert(&set, &node2, port2));
+   //duplicates are ignored
+   CuAssertIntEquals(tc, 0, apx_portrefSet_insert(&set, &node1, port1));
+   CuAssertIntEquals(tc, 2, apx_portrefSet_length(&set));
+   CuAssertIntEquals(tc, 2, adt_ary_length(apx_portrefSet_getList(&set)));
+   CuAssertTrue(tc, apx_portrefSet_contains(&set, &node1, port1));
+   CuAssertTrue(tc, !apx_portrefSet_contains(&set, &node1, port2));
+   CuAssertTrue(tc, apx_portrefSet_remove(&set, &node1, port1));
+   CuAssertTrue(tc, !apx_portrefSet_remove(&set, &node1, port1));
+   CuAssertIntEquals(tc, 1, apx_portrefSet_length(&set));
+   CuAssertPtrEquals(tc, port2, apx_portrefSet_get(&set, 0)->port);
+   CuAssertPtrEquals(tc, 0, apx_portrefSet_get(&set, 1));
+   apx_portrefSet_destroy(&set);
+   apx_node_destroy(&node1);
+   apx_node_destroy(&node2);
+}
+
+static void test_apx_portrefSet_keepsOrder(CuTest* tc)
+{
+   int32_t i;
+   apx_portrefSet_t set;
+   apx_node_t node;
+   apx_port_t *ports[APX_TEST_NUM_NODES];
+   apx_node_create(&node, "test");
+   for (i=0; i<APX_TEST_NUM_NODES; i++)
+   {
+      char name[32];
+      sprintf(name, "Port%d", (int) i);
+      apx_node_createRequirePort(&node, name, "S", 0);
+      ports[i] = (apx_port_t*) adt_ary_value(&node.requirePortList, i);
+   }
+   apx_portrefSet_create(&set);
+   //insert in reverse order, the list keeps insertion order regardless of the index order
+   for (i=APX_TEST_NUM_NODES-1; i>=0; i--)
+   {
+      CuAssertIntEquals(tc, 0, apx_portrefSet_insert(&set, &node, ports[i]));
+   }
+   //remove every other element
+   for (i=0; i<APX_TEST_NUM_NODES; i+=2)
+   {
+      CuAssertTrue(tc, apx_portrefSet_remove(&set, &node, ports[i]));
+   }
+   CuAssertIntEquals(tc, APX_TEST_NUM_NODES/2, apx_portrefSet_length(&set));
+   for (i=0; i<APX_TEST_NUM_NODES/2; i++)
+   {
+      CuAssertPtrEquals(tc, ports[APX_TEST_NUM_NODES-1-2*i], apx_portrefSet_get(&set, i)->port);
+   }
+   //a re-inserted element goes last
+   CuAssertIntEquals(tc, 0, apx_portrefSet_insert(&set, &node, ports[0]));
+   CuAssertPtrEquals(tc, ports[0], apx_portrefSet_get(&set, APX_TEST_NUM_NODES/2)->port);
+   apx_portrefSet_destroy(&set);
+   apx_node_destroy(&node);
+}
+
+/**
+ * subscribers disconnect and reconnect in rounds, the set must match a plain array kept in insertion order
+ */
+static void test_apx_portrefSet_reconnectStorm(CuTest* tc)
+{
+   int32_t i;
+   int32_t j;
+   int32_t round;
+   int32_t expectedLen;
+   apx_portrefSet_t set;
+   apx_node_t node;
+   apx_port_t *ports[APX_TEST_NUM_NODES];
+   apx_port_t *expected[APX_TEST_NUM_NODES];
+   apx_node_create(&node, "test");
+   for (i=0; i<APX_TEST_NUM_NODES; i++)
+   {
+      char name[32];
+      sprintf(name, "Port%d", (int) i);
+      apx_node_createRequirePort(&node, name, "S", 0);
+      ports[i] = (apx_port_t*) adt_ary_value(&node.requirePortList, i);
+   }
+   apx_portrefSet_create(&set);
+   for (i=0; i<APX_TEST_NUM_NODES; i++)
+   {
+      CuAssertIntEquals(tc, 0, apx_portrefSet_insert(&set, &node, ports[i]));
+      expected[i] = ports[i];
+   }
+   expectedLen = APX_TEST_NUM_NODES;
+   for (round=0; round<6; round++)
+   {
+      int32_t numRemoved = 0;
+      //remove a third of the ports, then put them back at the end
+      for (i=0; i<APX_TEST_NUM_NODES; i++)
+      {
+         if ( (i % 3) == (round % 3) )
+         {
+            CuAssertTrue(tc, apx_portrefSet_remove(&set, &node, ports[i]));
+            numRemoved++;
+         }
+      }
+      for (i=0, j=0; i<expectedLen; i++)
+      {
+         if ( (expected[i]->portIndex % 3) != (round % 3) )
+         {
+            expected[j++] = expected[i];
+         }
+      }
+      expectedLen = j;
+      CuAssertIntEquals(tc, expectedLen, apx_portrefSet_length(&set));
+      CuAssertIntEquals(tc, APX_TEST_NUM_NODES, expectedLen+numRemoved);
+      for (i=0; i<APX_TEST_NUM_NODES; i++)
+      {
+         CuAssertTrue(tc, apx_portrefSet_contains(&set, &node, ports[i]) == ( (i % 3) != (round % 3) ));
+      }
+      for (i=APX_TEST_NUM_NODES-1; i>=0; i--)
+      {
+         if ( (i % 3) == (round % 3) )
+         {
+            CuAssertIntEquals(tc, 0, apx_portrefSet_insert(&set, &node, ports[i]));
+            expected[expectedLen++] = ports[i];
+         }
+      }
+      CuAssertIntEquals(tc, APX_TEST_NUM_NODES, apx_portrefSet_length(&set));
+      for (i=0; i<APX_TEST_NUM_NODES; i++)
+      {
+         CuAssertPtrEquals(tc, expected[i], apx_portrefSet_get(&set, i)->port);
+      }
+   }
+   apx_portrefSet_destroy(&set);
+   apx_node_destroy(&node);
+}
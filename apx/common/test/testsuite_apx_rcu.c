@@ -0,0 +1,123 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#include "CuTest.h"
+#include "apx_atomic.h"
+#include "apx_rcu.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static void test_apx_rcu_retireSynchronize(CuTest* tc);
+#ifndef _WIN32
+static void test_apx_rcu_readerDelaysReclaim(CuTest* tc);
+static void *synchronizeTask(void *arg);
+#endif
+static void freeSpy(void *arg);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+static volatile int32_t m_numFreed;
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+
+CuSuite* testSuite_apx_rcu(void)
+{
+   CuSuite* suite = CuSuiteNew();
+
+   SUITE_ADD_TEST(suite, test_apx_rcu_retireSynchronize);
+#ifndef _WIN32
+   SUITE_ADD_TEST(suite, test_apx_rcu_readerDelaysReclaim);
+#endif
+
+   return suite;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+static void test_apx_rcu_retireSynchronize(CuTest* tc)
+{
+   int32_t readIndex;
+   int32_t i;
+   int32_t values[40];
+   apx_rcu_synchronize();
+   m_numFreed = 0;
+   //read-side sections may be nested and never block
+   readIndex = apx_rcu_readLock();
+   apx_rcu_readUnlock(apx_rcu_readLock());
+   apx_rcu_readUnlock(readIndex);
+   for (i=0;i<40;i++)
+   {
+      apx_rcu_retire(&values[i], freeSpy);
+   }
+   CuAssertIntEquals(tc, 40, apx_rcu_getNumRetired());
+   CuAssertIntEquals(tc, 0, m_numFreed);
+   apx_rcu_synchronize();
+   CuAssertIntEquals(tc, 0, apx_rcu_getNumRetired());
+   CuAssertIntEquals(tc, 40, m_numFreed);
+   //nothing left to free
+   apx_rcu_synchronize();
+   CuAssertIntEquals(tc, 40, m_numFreed);
+}
+
+#ifndef _WIN32
+static void test_apx_rcu_readerDelaysReclaim(CuTest* tc)
+{
+   pthread_t thread;
+   volatile int32_t isDone = 0;
+   int32_t value;
+   int32_t readIndex;
+   m_numFreed = 0;
+   readIndex = apx_rcu_readLock();
+   apx_rcu_retire(&value, freeSpy);
+   CuAssertIntEquals(tc, 0, pthread_create(&thread, 0, synchronizeTask, (void*) &isDone));
+   usleep(50000);
+   //the writer waits for this reader
+   CuAssertIntEquals(tc, 0, APX_ATOMIC_LOAD_ACQUIRE(isDone));
+   CuAssertIntEquals(tc, 0, APX_ATOMIC_LOAD_ACQUIRE(m_numFreed));
+   apx_rcu_readUnlock(readIndex);
+   pthread_join(thread, 0);
+   CuAssertIntEquals(tc, 1, isDone);
+   CuAssertIntEquals(tc, 1, m_numFreed);
+}
+
+static void *synchronizeTask(void *arg)
+{
+   volatile int32_t *isDone = (volatile int32_t*) arg;
+   apx_rcu_synchronize();
+   APX_ATOMIC_STORE_RELEASE(*isDone, 1);
+   return 0;
+}
+#endif
+
+static void freeSpy(void *arg)
+{
+   (void) arg;
+   (void) APX_ATOMIC_INCREMENT(m_numFreed);
+}
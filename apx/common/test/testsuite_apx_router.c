@@ -6,9 +6,13 @@
 #include <stdio.h>
 #include <stddef.h>
 #include <string.h>
+#ifdef APX_ENABLE_BENCHMARK
+#include <time.h>
+#endif
 #include "CuTest.h"
 #include "apx_router.h"
 #include "apx_parser.h"
+#include "apx_rcu.h"
 #ifdef MEM_LEAK_CHECK
 #include "CMemLeak.h"
 #endif
@@ -23,10 +27,24 @@
 #define APX_TEST_DATA_PATH  "../../../apx/common/test/data/"
 #endif
 
+#ifdef APX_ENABLE_BENCHMARK
+#define APX_BENCHMARK_NUM_REQUIRE_PORTS 10 //each node requires the signals provided by this many other nodes
+#define APX_BENCHMARK_NUM_RECONNECTS 20 //number of times the overriding provider is attached and detached
+#endif
+
 //////////////////////////////////////////////////////////////////////////////
 // LOCAL FUNCTION PROTOTYPES
 //////////////////////////////////////////////////////////////////////////////
 static void test_apx_router_create(CuTest* tc);
+static void test_apx_router_postProcessDirtyNodes(CuTest* tc);
+static void test_apx_router_attachDetachNodeInfos(CuTest* tc);
+static void test_apx_router_releasePortSignature(CuTest* tc);
+#ifdef APX_ENABLE_BENCHMARK
+static void test_apx_router_benchmarkAttach(CuTest* tc);
+static void test_apx_router_benchmarkFanOut(CuTest* tc);
+static apx_node_t *router_createBenchmarkNode(int32_t nodeIndex, int32_t numNodes);
+static apx_nodeInfo_t *router_createFanOutNodeInfo(const char *name, uint8_t portType);
+#endif
 //static int create_test_nodes(apx_node_t *nodeList, apx_nodeInfo_t *nodeInfoList, apx_port_t **ports, int maxNumNodes);
 //static void destroy_test_nodes(apx_node_t *nodeList, apx_nodeInfo_t *nodeInfoList, int numNodes);
 
@@ -49,6 +67,13 @@ CuSuite* testSuite_apx_router(void)
    CuSuite* suite = CuSuiteNew();
 
    SUITE_ADD_TEST(suite, test_apx_router_create);
+   SUITE_ADD_TEST(suite, test_apx_router_postProcessDirtyNodes);
+   SUITE_ADD_TEST(suite, test_apx_router_attachDetachNodeInfos);
+   SUITE_ADD_TEST(suite, test_apx_router_releasePortSignature);
+#ifdef APX_ENABLE_BENCHMARK
+   SUITE_ADD_TEST(suite, test_apx_router_benchmarkAttach);
+   SUITE_ADD_TEST(suite, test_apx_router_benchmarkFanOut);
+#endif
 
    return suite;
 }
@@ -98,7 +123,7 @@ static void test_apx_router_create(CuTest* tc)
    apx_router_attachNodeInfo(&router,&nodeInfoList[2]);
    apx_router_attachNodeInfo(&router,&nodeInfoList[3]);
    apx_router_attachNodeInfo(&router,&nodeInfoList[4]);
-   connectors = (adt_ary_t*) *adt_ary_get(&nodeInfoList[0].provideConnectors,0); //test1/WheelBasedVehicleSpeed (current provider)
+   connectors = apx_nodeInfo_getProvidePortConnectorList(&nodeInfoList[0],0); //test1/WheelBasedVehicleSpeed (current provider)
    if (connectors != 0)
    {
       int32_t numConnectors = adt_ary_length(connectors);
@@ -106,37 +131,37 @@ static void test_apx_router_create(CuTest* tc)
    }
 
    apx_router_attachNodeInfo(&router,&nodeInfoList[1]);
-   connectors = (adt_ary_t*) *adt_ary_get(&nodeInfoList[0].provideConnectors,0); //test1/WheelBasedVehicleSpeed (not connected)
+   connectors = apx_nodeInfo_getProvidePortConnectorList(&nodeInfoList[0],0); //test1/WheelBasedVehicleSpeed (not connected)
    if (connectors != 0)
    {
       int32_t numConnectors = adt_ary_length(connectors);
       CuAssertIntEquals(tc,0,numConnectors);
    }
-   connectors = (adt_ary_t*) *adt_ary_get(&nodeInfoList[1].provideConnectors,0); //test2/WheelBasedVehicleSpeed (new provider)
+   connectors = apx_nodeInfo_getProvidePortConnectorList(&nodeInfoList[1],0); //test2/WheelBasedVehicleSpeed (new provider)
    if (connectors != 0)
    {
       int32_t numConnectors = adt_ary_length(connectors);
       CuAssertIntEquals(tc,3,numConnectors);
    }
-   connectors = (adt_ary_t*) *adt_ary_get(&nodeInfoList[0].provideConnectors,1); //test1/PS_CabTiltLockWarning
+   connectors = apx_nodeInfo_getProvidePortConnectorList(&nodeInfoList[0],1); //test1/PS_CabTiltLockWarning
    CuAssertPtrNotNull(tc,connectors);
    CuAssertIntEquals(tc,1,adt_ary_length(connectors));
 
 
    //Verify port connectors for NodeInfo2
-   connectors = (adt_ary_t*) *adt_ary_get(&nodeInfoList[1].provideConnectors,0); //test2/WheelBasedVehicleSpeed (this should be connected)
+   connectors = apx_nodeInfo_getProvidePortConnectorList(&nodeInfoList[1],0); //test2/WheelBasedVehicleSpeed (this should be connected)
    CuAssertPtrNotNull(tc,connectors);
    CuAssertIntEquals(tc,3,adt_ary_length(connectors));
 
    //try to detach test2
    apx_router_detachNodeInfo(&router, &nodeInfoList[1]); //detach the overrider node of WheelBasedVehicleSpeed
-   connectors = (adt_ary_t*) *adt_ary_get(&nodeInfoList[1].provideConnectors,0); //test2/WheelBasedVehicleSpeed (not connected)
+   connectors = apx_nodeInfo_getProvidePortConnectorList(&nodeInfoList[1],0); //test2/WheelBasedVehicleSpeed (not connected)
    if (connectors != 0)
    {
       int32_t numConnectors = adt_ary_length(connectors);
       CuAssertIntEquals(tc,0,numConnectors);
    }
-   connectors = (adt_ary_t*) *adt_ary_get(&nodeInfoList[0].provideConnectors,0); //test1/WheelBasedVehicleSpeed (new provider)
+   connectors = apx_nodeInfo_getProvidePortConnectorList(&nodeInfoList[0],0); //test1/WheelBasedVehicleSpeed (new provider)
    if (connectors != 0)
    {
       int32_t numConnectors = adt_ary_length(connectors);
@@ -144,13 +169,13 @@ static void test_apx_router_create(CuTest* tc)
    }
    //try to attach test2 again
    apx_router_attachNodeInfo(&router, &nodeInfoList[1]); //this will override WheelBasedVehicleSpeed again
-   connectors = (adt_ary_t*) *adt_ary_get(&nodeInfoList[0].provideConnectors,0); //test1/WheelBasedVehicleSpeed (not connected)
+   connectors = apx_nodeInfo_getProvidePortConnectorList(&nodeInfoList[0],0); //test1/WheelBasedVehicleSpeed (not connected)
    if (connectors != 0)
    {
       int32_t numConnectors = adt_ary_length(connectors);
       CuAssertIntEquals(tc,0,numConnectors);
    }
-   connectors = (adt_ary_t*) *adt_ary_get(&nodeInfoList[1].provideConnectors,0); //test2/WheelBasedVehicleSpeed (new provider)
+   connectors = apx_nodeInfo_getProvidePortConnectorList(&nodeInfoList[1],0); //test2/WheelBasedVehicleSpeed (new provider)
    if (connectors != 0)
    {
       int32_t numConnectors = adt_ary_length(connectors);
@@ -167,6 +192,301 @@ static void test_apx_router_create(CuTest* tc)
    apx_parser_destroy(&parser);
 }
 
+static void test_apx_router_postProcessDirtyNodes(CuTest* tc)
+{
+   apx_node_t provider;
+   apx_node_t requester;
+   apx_node_t other;
+   apx_nodeInfo_t providerInfo;
+   apx_nodeInfo_t requesterInfo;
+   apx_nodeInfo_t otherInfo;
+   apx_router_t router;
+   apx_node_create(&provider, "Provider");
+   apx_node_createProvidePort(&provider, "VehicleSpeed", "S", 0);
+   apx_node_create(&requester, "Requester");
+   apx_node_createRequirePort(&requester, "VehicleSpeed", "S", 0);
+   apx_node_create(&other, "Other");
+   apx_node_createProvidePort(&other, "EngineSpeed", "S", 0);
+   apx_nodeInfo_create(&providerInfo, &provider);
+   apx_nodeInfo_create(&requesterInfo, &requester);
+   apx_nodeInfo_create(&otherInfo, &other);
+   apx_router_create(&router);
+
+   apx_router_attachNodeInfo(&router, &otherInfo);
+   apx_router_attachNodeInfo(&router, &providerInfo);
+   CuAssertPtrEquals(tc, &router.dirtyNodeInfoList, otherInfo.dirtyList);
+   apx_router_attachNodeInfo(&router, &requesterInfo);
+   CuAssertIntEquals(tc, 0, adt_ary_length(&router.dirtyNodeInfoList));
+   CuAssertPtrNotNull(tc, apx_nodeInfo_getRequirePortConnector(&requesterInfo, 0));
+   CuAssertUIntEquals(tc, 0, providerInfo.pendingProvidePortFlags);
+   CuAssertUIntEquals(tc, 0, requesterInfo.pendingRequirePortFlags);
+   CuAssertTrue(tc, providerInfo.isDirty == false);
+   CuAssertTrue(tc, requesterInfo.isDirty == false);
+   //changing connectors adds each affected node to the dirty list once
+   apx_nodeInfo_disconnectRequirePort(&requesterInfo, 0);
+   apx_nodeInfo_connectPort(&providerInfo, 0, &requesterInfo, 0);
+   CuAssertIntEquals(tc, 2, adt_ary_length(&router.dirtyNodeInfoList));
+   CuAssertPtrEquals(tc, &providerInfo, adt_ary_value(&router.dirtyNodeInfoList, 0));
+   CuAssertPtrEquals(tc, &requesterInfo, adt_ary_value(&router.dirtyNodeInfoList, 1));
+
+   //the detached node is processed as well, then it no longer reports to the router
+   apx_router_detachNodeInfo(&router, &providerInfo);
+   CuAssertIntEquals(tc, 0, adt_ary_length(&router.dirtyNodeInfoList));
+   CuAssertPtrEquals(tc, 0, apx_nodeInfo_getRequirePortConnector(&requesterInfo, 0));
+   CuAssertUIntEquals(tc, 0, providerInfo.pendingProvidePortFlags);
+   CuAssertUIntEquals(tc, 0, requesterInfo.pendingRequirePortFlags);
+   CuAssertPtrEquals(tc, 0, providerInfo.dirtyList);
+   CuAssertUIntEquals(tc, 0, otherInfo.pendingProvidePortFlags);
+
+   apx_router_destroy(&router);
+   apx_nodeInfo_destroy(&providerInfo);
+   apx_nodeInfo_destroy(&requesterInfo);
+   apx_nodeInfo_destroy(&otherInfo);
+   apx_node_destroy(&provider);
+   apx_node_destroy(&requester);
+   apx_node_destroy(&other);
+}
+
+static void test_apx_router_attachDetachNodeInfos(CuTest* tc)
+{
+   apx_node_t provider1;
+   apx_node_t provider2;
+   apx_node_t requester;
+   apx_node_t other;
+   apx_nodeInfo_t provider1Info;
+   apx_nodeInfo_t provider2Info;
+   apx_nodeInfo_t requesterInfo;
+   apx_nodeInfo_t otherInfo;
+   apx_nodeInfo_t *nodeInfos[3];
+   apx_portref_t *connector;
+   apx_router_t router;
+   apx_node_create(&provider1, "Provider1");
+   apx_node_createProvidePort(&provider1, "VehicleSpeed", "S", 0);
+   apx_node_create(&provider2, "Provider2");
+   apx_node_createProvidePort(&provider2, "VehicleSpeed", "S", 0);
+   apx_node_create(&requester, "Requester");
+   apx_node_createRequirePort(&requester, "VehicleSpeed", "S", 0);
+   apx_node_createRequirePort(&requester, "EngineSpeed", "S", 0);
+   apx_node_create(&other, "Other");
+   apx_node_createProvidePort(&other, "EngineSpeed", "S", 0);
+   apx_nodeInfo_create(&provider1Info, &provider1);
+   apx_nodeInfo_create(&provider2Info, &provider2);
+   apx_nodeInfo_create(&requesterInfo, &requester);
+   apx_nodeInfo_create(&otherInfo, &other);
+   apx_router_create(&router);
+
+   apx_router_attachNodeInfo(&router, &otherInfo);
+   //the last provider in the array wins, just like when the nodes are attached one at a time
+   nodeInfos[0] = &provider1Info;
+   nodeInfos[1] = &requesterInfo;
+   nodeInfos[2] = &provider2Info;
+   apx_router_attachNodeInfos(&router, nodeInfos, 3);
+   CuAssertIntEquals(tc, 4, adt_ary_length(&router.nodeInfoList));
+   CuAssertIntEquals(tc, 0, adt_ary_length(&router.dirtyNodeInfoList));
+   connector = apx_nodeInfo_getRequirePortConnector(&requesterInfo, 0);
+   CuAssertPtrNotNull(tc, connector);
+   CuAssertPtrEquals(tc, &provider2, connector->node);
+   connector = apx_nodeInfo_getRequirePortConnector(&requesterInfo, 1);
+   CuAssertPtrNotNull(tc, connector);
+   CuAssertPtrEquals(tc, &other, connector->node);
+   CuAssertIntEquals(tc, 1, adt_ary_length(apx_nodeInfo_getProvidePortConnectorList(&provider2Info, 0)));
+   CuAssertUIntEquals(tc, 0, requesterInfo.pendingRequirePortFlags);
+   CuAssertUIntEquals(tc, 0, provider2Info.pendingProvidePortFlags);
+   //attaching a node twice is ignored
+   apx_router_attachNodeInfos(&router, nodeInfos, 1);
+   CuAssertIntEquals(tc, 4, adt_ary_length(&router.nodeInfoList));
+
+   //the requester falls back to the remaining provider, it loses its other signal
+   nodeInfos[0] = &provider2Info;
+   nodeInfos[1] = &otherInfo;
+   apx_router_detachNodeInfos(&router, nodeInfos, 2);
+   CuAssertIntEquals(tc, 2, adt_ary_length(&router.nodeInfoList));
+   CuAssertIntEquals(tc, 0, adt_ary_length(&router.dirtyNodeInfoList));
+   connector = apx_nodeInfo_getRequirePortConnector(&requesterInfo, 0);
+   CuAssertPtrNotNull(tc, connector);
+   CuAssertPtrEquals(tc, &provider1, connector->node);
+   CuAssertPtrEquals(tc, 0, apx_nodeInfo_getRequirePortConnector(&requesterInfo, 1));
+   CuAssertPtrEquals(tc, 0, provider2Info.dirtyList);
+   CuAssertPtrEquals(tc, 0, otherInfo.dirtyList);
+
+   apx_router_destroy(&router);
+   apx_nodeInfo_destroy(&provider1Info);
+   apx_nodeInfo_destroy(&provider2Info);
+   apx_nodeInfo_destroy(&requesterInfo);
+   apx_nodeInfo_destroy(&otherInfo);
+   apx_node_destroy(&provider1);
+   apx_node_destroy(&provider2);
+   apx_node_destroy(&requester);
+   apx_node_destroy(&other);
+}
+
+/**
+ * The portMap entry of a signature is removed with its last port, the signature itself is released when the node is destroyed
+ */
+static void test_apx_router_releasePortSignature(CuTest* tc)
+{
+   apx_node_t provider;
+   apx_nodeInfo_t providerInfo;
+   apx_router_t router;
+   int32_t portSignatureId;
+   apx_node_create(&provider, "Provider");
+   apx_node_createProvidePort(&provider, "ReleasedSpeed", "S", 0);
+   apx_nodeInfo_create(&providerInfo, &provider);
+   apx_router_create(&router);
+
+   apx_router_attachNodeInfo(&router, &providerInfo);
+   portSignatureId = apx_port_getPortSignatureId(apx_node_getProvidePort(&provider, 0));
+   CuAssertTrue(tc, portSignatureId >= 0);
+   CuAssertPtrNotNull(tc, adt_ary_value(&router.portMap, portSignatureId));
+   apx_router_detachNodeInfo(&router, &providerInfo);
+   CuAssertPtrEquals(tc, 0, adt_ary_value(&router.portMap, portSignatureId));
+   CuAssertStrEquals(tc, "\"ReleasedSpeed\"S", apx_portSignatureTable_getSignature(portSignatureId));
+
+   apx_router_destroy(&router);
+   apx_nodeInfo_destroy(&providerInfo);
+   apx_node_destroy(&provider);
+   CuAssertPtrEquals(tc, 0, (void*) apx_portSignatureTable_getSignature(portSignatureId));
+}
+
+#ifdef APX_ENABLE_BENCHMARK
+/**
+ * attaches and then detaches numNodes nodes which share their signals. Each node provides one signal and requires the signals
+ * of APX_BENCHMARK_NUM_REQUIRE_PORTS other nodes, this is what a broker sees when all clients reconnect after a restart.
+ */
+static void test_apx_router_benchmarkAttach(CuTest* tc)
+{
+   int32_t numNodes;
+   for (numNodes = 250; numNodes <= 4000; numNodes *= 2)
+   {
+      int32_t i;
+      clock_t start;
+      double attachSec;
+      double detachSec;
+      apx_router_t router;
+      apx_nodeInfo_t **nodeInfoList = (apx_nodeInfo_t**) malloc(sizeof(apx_nodeInfo_t*) * numNodes);
+      CuAssertPtrNotNull(tc, nodeInfoList);
+      for (i=0; i<numNodes; i++)
+      {
+         nodeInfoList[i] = apx_nodeInfo_new(router_createBenchmarkNode(i, numNodes));
+         CuAssertPtrNotNull(tc, nodeInfoList[i]);
+         nodeInfoList[i]->isWeakRef_node = false;
+      }
+      apx_router_create(&router);
+      start = clock();
+      for (i=0; i<numNodes; i++)
+      {
+         apx_router_attachNodeInfo(&router, nodeInfoList[i]);
+         apx_rcu_synchronize(); //like apx_nodeManager, replaced routing snapshots are freed after each topology change
+      }
+      attachSec = ((double) (clock()-start)) / CLOCKS_PER_SEC;
+      //every require port has a provider once all nodes are attached
+      CuAssertPtrNotNull(tc, apx_nodeInfo_getRequirePortConnector(nodeInfoList[0], APX_BENCHMARK_NUM_REQUIRE_PORTS-1));
+      start = clock();
+      for (i=0; i<numNodes; i++)
+      {
+         apx_router_detachNodeInfo(&router, nodeInfoList[i]);
+         apx_rcu_synchronize();
+      }
+      detachSec = ((double) (clock()-start)) / CLOCKS_PER_SEC;
+      printf("[apx_router] %d nodes, %d ports each: attach %.1f ms, detach %.1f ms\n", (int) numNodes, APX_BENCHMARK_NUM_REQUIRE_PORTS+1,
+            attachSec*1000.0, detachSec*1000.0);
+      apx_router_destroy(&router);
+      for (i=0; i<numNodes; i++)
+      {
+         apx_nodeInfo_delete(nodeInfoList[i]);
+      }
+      free(nodeInfoList);
+   }
+}
+
+/**
+ * a widely consumed signal has numSubscribers require ports. A second provider of the same signal is attached and detached repeatedly,
+ * each time all subscribers are moved to the new provider and back again.
+ */
+static void test_apx_router_benchmarkFanOut(CuTest* tc)
+{
+   int32_t numSubscribers;
+   for (numSubscribers = 300; numSubscribers <= 4800; numSubscribers *= 2)
+   {
+      int32_t i;
+      clock_t start;
+      double elapsedSec;
+      apx_router_t router;
+      apx_nodeInfo_t *provider = router_createFanOutNodeInfo("Provider", APX_PROVIDE_PORT);
+      apx_nodeInfo_t *overrider = router_createFanOutNodeInfo("Overrider", APX_PROVIDE_PORT);
+      apx_nodeInfo_t **subscribers = (apx_nodeInfo_t**) malloc(sizeof(apx_nodeInfo_t*) * numSubscribers);
+      CuAssertPtrNotNull(tc, subscribers);
+      apx_router_create(&router);
+      apx_router_attachNodeInfo(&router, provider);
+      for (i=0; i<numSubscribers; i++)
+      {
+         char name[32];
+         sprintf(name, "Subscriber%d", (int) i);
+         subscribers[i] = router_createFanOutNodeInfo(name, APX_REQUIRE_PORT);
+         apx_router_attachNodeInfo(&router, subscribers[i]);
+      }
+      start = clock();
+      for (i=0; i<APX_BENCHMARK_NUM_RECONNECTS; i++)
+      {
+         apx_router_attachNodeInfo(&router, overrider);
+         apx_rcu_synchronize();
+         apx_router_detachNodeInfo(&router, overrider);
+         apx_rcu_synchronize();
+      }
+      elapsedSec = ((double) (clock()-start)) / CLOCKS_PER_SEC;
+      CuAssertIntEquals(tc, numSubscribers, adt_ary_length(apx_nodeInfo_getProvidePortConnectorList(provider, 0)));
+      printf("[apx_router] %d subscribers: %.2f ms per provider reconnect\n", (int) numSubscribers, elapsedSec*1000.0/APX_BENCHMARK_NUM_RECONNECTS);
+      apx_router_destroy(&router);
+      for (i=0; i<numSubscribers; i++)
+      {
+         apx_nodeInfo_delete(subscribers[i]);
+      }
+      free(subscribers);
+      apx_nodeInfo_delete(provider);
+      apx_nodeInfo_delete(overrider);
+   }
+}
+
+static apx_node_t *router_createBenchmarkNode(int32_t nodeIndex, int32_t numNodes)
+{
+   int32_t i;
+   char name[32];
+   apx_node_t *node;
+   sprintf(name, "Node%d", (int) nodeIndex);
+   node = apx_node_new(name);
+   if (node != 0)
+   {
+      sprintf(name, "Signal%d", (int) nodeIndex);
+      apx_node_createProvidePort(node, name, "S", 0);
+      for (i=1; i<=APX_BENCHMARK_NUM_REQUIRE_PORTS; i++)
+      {
+         sprintf(name, "Signal%d", (int) ((nodeIndex+i) % numNodes));
+         apx_node_createRequirePort(node, name, "S", 0);
+      }
+   }
+   return node;
+}
+
+static apx_nodeInfo_t *router_createFanOutNodeInfo(const char *name, uint8_t portType)
+{
+   apx_nodeInfo_t *nodeInfo = (apx_nodeInfo_t*) 0;
+   apx_node_t *node = apx_node_new(name);
+   if (node != 0)
+   {
+      if (portType == APX_PROVIDE_PORT)
+      {
+         apx_node_createProvidePort(node, "VehicleSpeed", "S", 0);
+      }
+      else
+      {
+         apx_node_createRequirePort(node, "VehicleSpeed", "S", 0);
+      }
+      nodeInfo = apx_nodeInfo_new(node);
+      nodeInfo->isWeakRef_node = false;
+   }
+   return nodeInfo;
+}
+#endif
 
 
 
@@ -0,0 +1,84 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "CuTest.h"
+#include "apx_sharedPayload.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static void test_apx_sharedPayload_new(CuTest* tc);
+static void test_apx_sharedPayload_refUnref(CuTest* tc);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+
+CuSuite* testSuite_apx_sharedPayload(void)
+{
+   CuSuite* suite = CuSuiteNew();
+
+   SUITE_ADD_TEST(suite, test_apx_sharedPayload_new);
+   SUITE_ADD_TEST(suite, test_apx_sharedPayload_refUnref);
+
+   return suite;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+static void test_apx_sharedPayload_new(CuTest* tc)
+{
+   apx_sharedPayload_t *payload = apx_sharedPayload_new(8);
+   CuAssertPtrNotNull(tc, payload);
+   CuAssertIntEquals(tc, 1, apx_sharedPayload_getRefCount(payload));
+   CuAssertUIntEquals(tc, 8, payload->dataLen);
+   CuAssertPtrEquals(tc, ((uint8_t*) payload) + sizeof(apx_sharedPayload_t), payload->data);
+   memset(payload->data, 0xAA, payload->dataLen);
+   apx_sharedPayload_unref(payload);
+}
+
+static void test_apx_sharedPayload_refUnref(CuTest* tc)
+{
+   int i;
+   apx_sharedPayload_t *payload = apx_sharedPayload_new(4);
+   CuAssertPtrNotNull(tc, payload);
+   //simulate three destination queues holding a reference each
+   for (i=0;i<3;i++)
+   {
+      apx_sharedPayload_ref(payload);
+   }
+   CuAssertIntEquals(tc, 4, apx_sharedPayload_getRefCount(payload));
+   apx_sharedPayload_unref(payload); //the producer releases its reference first
+   CuAssertIntEquals(tc, 3, apx_sharedPayload_getRefCount(payload));
+   for (i=0;i<2;i++)
+   {
+      apx_sharedPayload_unref(payload);
+   }
+   CuAssertIntEquals(tc, 1, apx_sharedPayload_getRefCount(payload));
+   apx_sharedPayload_unref(payload); //last reference, memory is freed here
+}
@@ -0,0 +1,274 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include "CuTest.h"
+#include "apx_shmTransport.h"
+#if APX_SHM_TRANSPORT_ENABLE
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#if APX_SHM_TRANSPORT_ENABLE
+typedef struct receiveSpy_tag
+{
+   volatile int32_t numCalls;
+   uint32_t totalLen;
+   uint32_t lastAddress;
+   uint8_t lastData[APX_SHM_DATA_SIZE];
+   uint32_t lastLen;
+}receiveSpy_t;
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+#if APX_SHM_TRANSPORT_ENABLE
+static void test_apx_shmTransport_greeting(CuTest* tc);
+static void test_apx_shmTransport_writeBothDirections(CuTest* tc);
+static void test_apx_shmTransport_wrapAround(CuTest* tc);
+static void test_apx_shmTransport_largeWrite(CuTest* tc);
+static void test_apx_shmTransport_receiveThread(CuTest* tc);
+static void test_apx_shmTransport_rejectsForeignPid(CuTest* tc);
+static void test_apx_shmTransport_rejectsUnsealedRegion(CuTest* tc);
+static int8_t createPair(apx_shmTransport_t *client, apx_shmTransport_t *server);
+static void receiveSpy_received(void *arg, uint32_t address, const uint8_t *data, uint32_t dataLen);
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+
+CuSuite* testSuite_apx_shmTransport(void)
+{
+   CuSuite* suite = CuSuiteNew();
+
+#if APX_SHM_TRANSPORT_ENABLE
+   SUITE_ADD_TEST(suite, test_apx_shmTransport_greeting);
+   SUITE_ADD_TEST(suite, test_apx_shmTransport_writeBothDirections);
+   SUITE_ADD_TEST(suite, test_apx_shmTransport_wrapAround);
+   SUITE_ADD_TEST(suite, test_apx_shmTransport_largeWrite);
+   SUITE_ADD_TEST(suite, test_apx_shmTransport_receiveThread);
+   SUITE_ADD_TEST(suite, test_apx_shmTransport_rejectsForeignPid);
+   SUITE_ADD_TEST(suite, test_apx_shmTransport_rejectsUnsealedRegion);
+#endif
+
+   return suite;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+#if APX_SHM_TRANSPORT_ENABLE
+static void test_apx_shmTransport_greeting(CuTest* tc)
+{
+   apx_shmTransport_t client;
+   apx_shmTransport_t *server;
+   char line[128];
+   char *value;
+   int32_t lineLen;
+   CuAssertIntEquals(tc, 0, apx_shmTransport_create(&client));
+   CuAssertTrue(tc, apx_shmTransport_isAttached(&client) == false);
+   CuAssertIntEquals(tc, -1, apx_shmTransport_getGreetingLine(&client, line, 10));
+   lineLen = apx_shmTransport_getGreetingLine(&client, line, (int32_t) sizeof(line));
+   CuAssertTrue(tc, lineLen > 0);
+   CuAssertIntEquals(tc, '\n', line[lineLen-1]);
+   CuAssertIntEquals(tc, 0, strncmp(line, APX_SHM_GREETING_HEADER ": ", strlen(APX_SHM_GREETING_HEADER ": ")));
+   value = &line[strlen(APX_SHM_GREETING_HEADER ": ")];
+   //the server parses the part after the colon
+   server = apx_shmTransport_newFromGreeting(value, getpid());
+   CuAssertPtrNotNull(tc, server);
+   CuAssertTrue(tc, apx_shmTransport_isAttached(&client));
+   CuAssertPtrEquals(tc, 0, apx_shmTransport_newFromGreeting("not a number", getpid()));
+   apx_shmTransport_delete(server);
+   apx_shmTransport_destroy(&client);
+}
+
+static void test_apx_shmTransport_writeBothDirections(CuTest* tc)
+{
+   apx_shmTransport_t client;
+   apx_shmTransport_t server;
+   receiveSpy_t spy;
+   const uint8_t data1[3] = {1, 2, 3};
+   const uint8_t data2[2] = {0xAA, 0xBB};
+   memset(&spy, 0, sizeof(spy));
+   CuAssertIntEquals(tc, 0, createPair(&client, &server));
+   server.receivedFunc = receiveSpy_received;
+   server.receivedArg = &spy;
+   client.receivedFunc = receiveSpy_received;
+   client.receivedArg = &spy;
+   CuAssertIntEquals(tc, 0, apx_shmTransport_write(&client, 0x10, data1, sizeof(data1)));
+   CuAssertIntEquals(tc, 0, apx_shmTransport_write(&client, 0x20, data2, sizeof(data2)));
+   //nothing is received in the wrong direction
+   CuAssertIntEquals(tc, 0, apx_shmTransport_processReceived(&client));
+   CuAssertIntEquals(tc, 2, apx_shmTransport_processReceived(&server));
+   CuAssertIntEquals(tc, 2, spy.numCalls);
+   CuAssertUIntEquals(tc, 0x20, spy.lastAddress);
+   CuAssertUIntEquals(tc, 5, spy.totalLen);
+   CuAssertIntEquals(tc, 0, memcmp(spy.lastData, data2, sizeof(data2)));
+   CuAssertIntEquals(tc, 0, apx_shmTransport_write(&server, 0x4000, data1, sizeof(data1)));
+   CuAssertIntEquals(tc, 1, apx_shmTransport_processReceived(&client));
+   CuAssertUIntEquals(tc, 0x4000, spy.lastAddress);
+   CuAssertIntEquals(tc, 0, memcmp(spy.lastData, data1, sizeof(data1)));
+   apx_shmTransport_destroy(&server);
+   apx_shmTransport_destroy(&client);
+}
+
+static void test_apx_shmTransport_wrapAround(CuTest* tc)
+{
+   apx_shmTransport_t client;
+   apx_shmTransport_t server;
+   receiveSpy_t spy;
+   uint8_t data[1000];
+   int32_t i;
+   memset(&spy, 0, sizeof(spy));
+   CuAssertIntEquals(tc, 0, createPair(&client, &server));
+   server.receivedFunc = receiveSpy_received;
+   server.receivedArg = &spy;
+   //writes of 1000 bytes never fit exactly at the end of the data area
+   for (i=0; i<1000; i++)
+   {
+      memset(data, (uint8_t) i, sizeof(data));
+      CuAssertIntEquals(tc, 0, apx_shmTransport_write(&client, (uint32_t) i, data, sizeof(data)));
+      if ( (i % 10) == 9)
+      {
+         CuAssertIntEquals(tc, 10, apx_shmTransport_processReceived(&server));
+         CuAssertIntEquals(tc, 0, memcmp(spy.lastData, data, sizeof(data)));
+      }
+   }
+   CuAssertIntEquals(tc, 1000, spy.numCalls);
+   CuAssertUIntEquals(tc, 999, spy.lastAddress);
+   apx_shmTransport_destroy(&server);
+   apx_shmTransport_destroy(&client);
+}
+
+static void test_apx_shmTransport_largeWrite(CuTest* tc)
+{
+   apx_shmTransport_t client;
+   apx_shmTransport_t server;
+   uint8_t *data = (uint8_t*) malloc(APX_SHM_DATA_SIZE);
+   CuAssertIntEquals(tc, 0, createPair(&client, &server));
+   memset(data, 0, APX_SHM_DATA_SIZE);
+   //too large for the shared memory, the caller must send it over the socket
+   errno = 0;
+   CuAssertIntEquals(tc, -1, apx_shmTransport_write(&client, 0, data, APX_SHM_DATA_SIZE));
+   CuAssertIntEquals(tc, EMSGSIZE, errno);
+   CuAssertIntEquals(tc, 0, apx_shmTransport_processReceived(&server));
+   apx_shmTransport_destroy(&server);
+   apx_shmTransport_destroy(&client);
+   free(data);
+}
+
+static void test_apx_shmTransport_receiveThread(CuTest* tc)
+{
+   apx_shmTransport_t client;
+   apx_shmTransport_t server;
+   receiveSpy_t spy;
+   uint8_t data[4];
+   int32_t i;
+   int32_t numWrites = 20000;
+   memset(&spy, 0, sizeof(spy));
+   CuAssertIntEquals(tc, 0, createPair(&client, &server));
+   CuAssertIntEquals(tc, 0, apx_shmTransport_startReceiver(&server, receiveSpy_received, &spy));
+   for (i=0; i<numWrites; i++)
+   {
+      memcpy(data, &i, sizeof(data));
+      CuAssertIntEquals(tc, 0, apx_shmTransport_write(&client, (uint32_t) i, data, sizeof(data)));
+   }
+   for (i=0; (i<1000) && (__atomic_load_n(&spy.numCalls, __ATOMIC_ACQUIRE) < numWrites); i++)
+   {
+      usleep(1000);
+   }
+   CuAssertIntEquals(tc, numWrites, __atomic_load_n(&spy.numCalls, __ATOMIC_ACQUIRE));
+   CuAssertUIntEquals(tc, (uint32_t) numWrites-1, spy.lastAddress);
+   apx_shmTransport_destroy(&server);
+   apx_shmTransport_destroy(&client);
+}
+
+static void test_apx_shmTransport_rejectsForeignPid(CuTest* tc)
+{
+   apx_shmTransport_t client;
+   char line[128];
+   CuAssertIntEquals(tc, 0, apx_shmTransport_create(&client));
+   CuAssertTrue(tc, apx_shmTransport_getGreetingLine(&client, line, (int32_t) sizeof(line)) > 0);
+   //the greeting announces our pid but the socket reports another process
+   errno = 0;
+   CuAssertPtrEquals(tc, 0, apx_shmTransport_newFromGreeting(&line[strlen(APX_SHM_GREETING_HEADER ": ")], getppid()));
+   CuAssertIntEquals(tc, EPERM, errno);
+   CuAssertTrue(tc, apx_shmTransport_isAttached(&client) == false);
+   apx_shmTransport_destroy(&client);
+}
+
+static void test_apx_shmTransport_rejectsUnsealedRegion(CuTest* tc)
+{
+   apx_shmTransport_t client;
+   apx_shmTransport_t server;
+   int memFd;
+   CuAssertIntEquals(tc, 0, apx_shmTransport_create(&client));
+   //a region of the right size without seals could be truncated by the client while we use it
+   memFd = (int) syscall(SYS_memfd_create, "apx_shm_test", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+   CuAssertTrue(tc, memFd >= 0);
+   CuAssertIntEquals(tc, 0, ftruncate(memFd, (off_t) client.regionSize));
+   errno = 0;
+   CuAssertIntEquals(tc, -1, apx_shmTransport_attach(&server, getpid(), memFd, client.eventFd[0], client.eventFd[1]));
+   CuAssertIntEquals(tc, EPERM, errno);
+   //sealed but too small
+   CuAssertIntEquals(tc, 0, ftruncate(memFd, 4096));
+   CuAssertIntEquals(tc, 0, fcntl(memFd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW));
+   errno = 0;
+   CuAssertIntEquals(tc, -1, apx_shmTransport_attach(&server, getpid(), memFd, client.eventFd[0], client.eventFd[1]));
+   CuAssertIntEquals(tc, EPERM, errno);
+   close(memFd);
+   apx_shmTransport_destroy(&client);
+}
+
+static int8_t createPair(apx_shmTransport_t *client, apx_shmTransport_t *server)
+{
+   if (apx_shmTransport_create(client) == 0)
+   {
+      if (apx_shmTransport_attach(server, getpid(), client->memFd, client->eventFd[0], client->eventFd[1]) == 0)
+      {
+         return 0;
+      }
+      apx_shmTransport_destroy(client);
+   }
+   return -1;
+}
+
+static void receiveSpy_received(void *arg, uint32_t address, const uint8_t *data, uint32_t dataLen)
+{
+   receiveSpy_t *spy = (receiveSpy_t*) arg;
+   spy->lastAddress = address;
+   spy->lastLen = dataLen;
+   spy->totalLen += dataLen;
+   memcpy(spy->lastData, data, dataLen);
+   __atomic_add_fetch(&spy->numCalls, 1, __ATOMIC_RELEASE);
+}
+#endif
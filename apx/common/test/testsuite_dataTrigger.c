@@ -10,6 +10,10 @@
 #include "apx_dataTrigger.h"
 #include "apx_parser.h"
 #include "apx_router.h"
+#include "apx_rcu.h"
+#ifdef APX_ENABLE_BENCHMARK
+#include <time.h>
+#endif
 #ifdef MEM_LEAK_CHECK
 #include "CMemLeak.h"
 #endif
@@ -28,6 +32,11 @@
 // LOCAL FUNCTION PROTOTYPES
 //////////////////////////////////////////////////////////////////////////////
 static void test_apx_dataTriggerTable_create(CuTest* tc);
+static void test_apx_dataTriggerTable_largePorts(CuTest* tc);
+static void test_apx_dataTriggerTable_snapshotUnchangedByDetach(CuTest* tc);
+#ifdef APX_ENABLE_BENCHMARK
+static void test_apx_dataTriggerTable_benchmark(CuTest* tc);
+#endif
 
 //////////////////////////////////////////////////////////////////////////////
 // GLOBAL VARIABLES
@@ -48,6 +57,11 @@ CuSuite* testSuite_apx_dataTrigger(void)
    CuSuite* suite = CuSuiteNew();
 
    SUITE_ADD_TEST(suite, test_apx_dataTriggerTable_create);
+   SUITE_ADD_TEST(suite, test_apx_dataTriggerTable_largePorts);
+   SUITE_ADD_TEST(suite, test_apx_dataTriggerTable_snapshotUnchangedByDetach);
+#ifdef APX_ENABLE_BENCHMARK
+   SUITE_ADD_TEST(suite, test_apx_dataTriggerTable_benchmark);
+#endif
 
    return suite;
 }
@@ -108,4 +122,210 @@ static void test_apx_dataTriggerTable_create(CuTest* tc)
    apx_parser_destroy(&parser);
 }
 
+static void test_apx_dataTriggerTable_largePorts(CuTest* tc)
+{
+   apx_node_t *apx_node[2];
+   apx_nodeInfo_t apx_nodeInfo[2];
+   apx_parser_t parser;
+   apx_router_t router;
+   apx_dataTriggerTable_t *table;
+   apx_dataTriggerFunction_t *triggerFunction;
+   int32_t i;
+
+   apx_parser_create(&parser);
+   apx_node[0] = apx_parser_parseFile(&parser, APX_TEST_DATA_PATH "test8.apx");
+   CuAssertPtrNotNull(tc,apx_node[0]);
+   apx_node[1] = apx_parser_parseFile(&parser, APX_TEST_DATA_PATH "test9.apx");
+   CuAssertPtrNotNull(tc,apx_node[1]);
+   apx_nodeInfo_create(&apx_nodeInfo[0],apx_node[0]);
+   apx_nodeInfo_create(&apx_nodeInfo[1],apx_node[1]);
+   apx_router_create(&router);
+   for (i=0;i<2;i++)
+   {
+      apx_router_attachNodeInfo(&router,&apx_nodeInfo[i]);
+   }
+   table = &apx_nodeInfo[0].outDataTriggerTable;
+   //memory is proportional to number of provide ports, not to the 1MB of outPortData
+   CuAssertUIntEquals(tc, 1052675, table->outDataLen);
+   CuAssertUIntEquals(tc, 4*sizeof(apx_dataTriggerFunction_t*), apx_dataTriggerTable_getMemoryUsage(table));
+   //only "Name" and "Speed" are connected
+   CuAssertIntEquals(tc, 2, apx_dataTriggerTable_getNumTriggers(table));
+   CuAssertPtrEquals(tc, 0, apx_dataTriggerTable_get(table, 0));
+   triggerFunction = apx_dataTriggerTable_get(table, 1048576);
+   CuAssertPtrNotNull(tc, triggerFunction);
+   CuAssertUIntEquals(tc, 4096, triggerFunction->dataLength);
+   CuAssertIntEquals(tc, 1, adt_ary_length(&triggerFunction->writeInfoList));
+   //the unconnected "LargeArray" port is skipped in a single lookup
+   CuAssertPtrEquals(tc, triggerFunction, apx_dataTriggerTable_getNext(table, 0));
+   triggerFunction = apx_dataTriggerTable_getNext(table, 1048577);
+   CuAssertPtrNotNull(tc, triggerFunction);
+   CuAssertUIntEquals(tc, 1052672, triggerFunction->srcOffset);
+   CuAssertUIntEquals(tc, 2, triggerFunction->dataLength);
+   CuAssertPtrEquals(tc, 0, apx_dataTriggerTable_getNext(table, 1052674));
+
+   apx_router_destroy(&router);
+   for(i=0;i<2;i++)
+   {
+      apx_nodeInfo_destroy(&apx_nodeInfo[i]);
+   }
+   apx_parser_destroy(&parser);
+}
+
+static void test_apx_dataTriggerTable_snapshotUnchangedByDetach(CuTest* tc)
+{
+   apx_node_t *apx_node[2];
+   apx_nodeInfo_t apx_nodeInfo[2];
+   apx_parser_t parser;
+   apx_router_t router;
+   apx_dataTriggerTable_t *table;
+   const apx_dataTriggerSnapshot_t *snapshot;
+   apx_dataTriggerFunction_t *triggerFunction;
+   int32_t readIndex;
+   int32_t i;
+
+   apx_parser_create(&parser);
+   apx_node[0] = apx_parser_parseFile(&parser, APX_TEST_DATA_PATH "test8.apx");
+   CuAssertPtrNotNull(tc,apx_node[0]);
+   apx_node[1] = apx_parser_parseFile(&parser, APX_TEST_DATA_PATH "test9.apx");
+   CuAssertPtrNotNull(tc,apx_node[1]);
+   apx_nodeInfo_create(&apx_nodeInfo[0],apx_node[0]);
+   apx_nodeInfo_create(&apx_nodeInfo[1],apx_node[1]);
+   apx_router_create(&router);
+   for (i=0;i<2;i++)
+   {
+      apx_router_attachNodeInfo(&router,&apx_nodeInfo[i]);
+   }
+   apx_rcu_synchronize();
+   table = &apx_nodeInfo[0].outDataTriggerTable;
+   //a reader holds on to the snapshot while the requesting node is detached
+   readIndex = apx_rcu_readLock();
+   snapshot = apx_dataTriggerTable_getSnapshot(table);
+   CuAssertPtrNotNull(tc, snapshot);
+   triggerFunction = apx_dataTriggerSnapshot_getNext(snapshot, 0);
+   CuAssertPtrNotNull(tc, triggerFunction);
+   apx_router_detachNodeInfo(&router, &apx_nodeInfo[1]);
+   CuAssertTrue(tc, snapshot != apx_dataTriggerTable_getSnapshot(table));
+   CuAssertIntEquals(tc, 0, adt_ary_length(&apx_dataTriggerTable_getNext(table, 0)->writeInfoList));
+   //the old snapshot and its trigger functions are left untouched
+   CuAssertIntEquals(tc, 2, snapshot->numTriggers);
+   CuAssertPtrEquals(tc, triggerFunction, apx_dataTriggerSnapshot_getNext(snapshot, 0));
+   CuAssertIntEquals(tc, 1, adt_ary_length(&triggerFunction->writeInfoList));
+   //one snapshot and two trigger functions wait for the grace period
+   CuAssertIntEquals(tc, 3, apx_rcu_getNumRetired());
+   apx_rcu_readUnlock(readIndex);
+   apx_rcu_synchronize();
+   CuAssertIntEquals(tc, 0, apx_rcu_getNumRetired());
+
+   apx_router_destroy(&router);
+   for(i=0;i<2;i++)
+   {
+      apx_nodeInfo_destroy(&apx_nodeInfo[i]);
+   }
+   apx_parser_destroy(&parser);
+}
+
+#ifdef APX_ENABLE_BENCHMARK
+/**
+ * compares the trigger index against the per-byte lookup table it replaced.
+ * The old table used one pointer per byte of outPortData and was scanned one byte at a time over unconnected regions.
+ */
+static void test_apx_dataTriggerTable_benchmark(CuTest* tc)
+{
+   apx_node_t *apx_node[2];
+   apx_nodeInfo_t apx_nodeInfo[2];
+   apx_parser_t parser;
+   apx_router_t router;
+   apx_dataTriggerTable_t *table;
+   apx_dataTriggerFunction_t **lookupTable;
+   int32_t i;
+   int32_t numIterations = 1000;
+   uint32_t numFound = 0;
+   clock_t start;
+   double elapsedByteScan;
+   double elapsedIndex;
 
+   apx_parser_create(&parser);
+   apx_node[0] = apx_parser_parseFile(&parser, APX_TEST_DATA_PATH "test8.apx");
+   CuAssertPtrNotNull(tc,apx_node[0]);
+   apx_node[1] = apx_parser_parseFile(&parser, APX_TEST_DATA_PATH "test9.apx");
+   CuAssertPtrNotNull(tc,apx_node[1]);
+   apx_nodeInfo_create(&apx_nodeInfo[0],apx_node[0]);
+   apx_nodeInfo_create(&apx_nodeInfo[1],apx_node[1]);
+   apx_router_create(&router);
+   for (i=0;i<2;i++)
+   {
+      apx_router_attachNodeInfo(&router,&apx_nodeInfo[i]);
+   }
+   table = &apx_nodeInfo[0].outDataTriggerTable;
+
+   //rebuild the old layout: one pointer per byte of outPortData, each byte of a port points to its trigger function
+   lookupTable = (apx_dataTriggerFunction_t**) calloc(table->outDataLen, sizeof(apx_dataTriggerFunction_t*));
+   CuAssertPtrNotNull(tc, lookupTable);
+   for (i=0;i<(int32_t) table->outDataLen;)
+   {
+      uint32_t j;
+      apx_dataTriggerFunction_t *triggerFunction = apx_dataTriggerTable_getNext(table, i);
+      if (triggerFunction == 0)
+      {
+         break;
+      }
+      for (j=0;j<triggerFunction->dataLength;j++)
+      {
+         lookupTable[triggerFunction->srcOffset+j] = triggerFunction;
+      }
+      i = (int32_t) (triggerFunction->srcOffset + triggerFunction->dataLength);
+   }
+
+   //old method: per-byte table lookup at every offset until a trigger is found (what remoteFileWritten used to do)
+   start = clock();
+   for (i=0;i<numIterations;i++)
+   {
+      uint32_t offset = 0;
+      while (offset < table->outDataLen)
+      {
+         apx_dataTriggerFunction_t *triggerFunction = lookupTable[offset];
+         if (triggerFunction != 0)
+         {
+            numFound++;
+            offset = triggerFunction->srcOffset + triggerFunction->dataLength;
+         }
+         else
+         {
+            offset++;
+         }
+      }
+   }
+   elapsedByteScan = ((double) (clock()-start)) / CLOCKS_PER_SEC;
+   free(lookupTable);
+
+   //new method: jump directly to the next trigger
+   start = clock();
+   for (i=0;i<numIterations;i++)
+   {
+      uint32_t offset = 0;
+      while (offset < table->outDataLen)
+      {
+         apx_dataTriggerFunction_t *triggerFunction = apx_dataTriggerTable_getNext(table, (int32_t) offset);
+         if (triggerFunction == 0)
+         {
+            break;
+         }
+         numFound++;
+         offset = triggerFunction->srcOffset + triggerFunction->dataLength;
+      }
+   }
+   elapsedIndex = ((double) (clock()-start)) / CLOCKS_PER_SEC;
+   CuAssertUIntEquals(tc, 4*numIterations, numFound);
+
+   printf("[apx_dataTriggerTable] outDataLen=%u bytes, per-byte table: %u bytes, trigger index: %u bytes\n",
+         table->outDataLen, (unsigned int) (table->outDataLen*sizeof(apx_dataTriggerFunction_t*)), apx_dataTriggerTable_getMemoryUsage(table));
+   printf("[apx_dataTriggerTable] full file write, %d iterations: per-byte table %.3f s, trigger index %.6f s\n", numIterations, elapsedByteScan, elapsedIndex);
+
+   apx_router_destroy(&router);
+   for(i=0;i<2;i++)
+   {
+      apx_nodeInfo_destroy(&apx_nodeInfo[i]);
+   }
+   apx_parser_destroy(&parser);
+}
+#endif
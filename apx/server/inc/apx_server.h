@@ -12,6 +12,8 @@
 #include "msocket_server.h"
 #include "apx_nodeManager.h"
 #include "apx_serverConnection.h"
+#include "apx_serverReactor.h"
+#include "apx_server_cfg.h"
 #include "apx_router.h"
 #include "adt_list.h"
 
@@ -26,12 +28,20 @@ typedef struct apx_server_tag
    uint16_t tcpPort; //TCP port for tcpServer
    char *localServerFile; //path to socket file for unix domain sockets (used for localServer)
    msocket_server_t tcpServer; //tcp server
-   msocket_server_t localServer; //unix domain socket server (to be implemented later)
+   msocket_server_t localServer; //unix domain socket server, only started when localServerFile is set
    adt_list_t connections; //linked list of strong references to apx_serverConnection_t
    apx_nodeManager_t nodeManager; //the server has a single instance of the node manager, all connections interface with this object
    apx_router_t router; //this component handles all routing tables within the server
    MUTEX_T mutex;
    int8_t debugMode;
+   int32_t numReactors; //APX_SERVER_REACTORS_AUTO, APX_SERVER_REACTORS_NONE (threaded mode) or number of reactor threads
+   int32_t numDefinitionWorkers; //APX_SERVER_DEFINITION_WORKERS_AUTO, APX_SERVER_DEFINITION_WORKERS_NONE or number of definition worker threads
+   bool isConflationEnabled; //when true, each connection only keeps the latest value of non-queued ports while waiting to send
+   bool isDirectDispatchEnabled; //when true, routed writes are sent by the receiving thread unless the destination has a backlog
+   bool isSharedMemoryEnabled; //when true, clients connected to localServer may exchange port data through shared memory
+#if APX_SERVER_REACTOR_ENABLE
+   apx_serverReactor_t *reactors; //array of numReactors elements, allocated by apx_server_start
+#endif
 }apx_server_t;
 
 //////////////////////////////////////////////////////////////////////////////
@@ -46,6 +56,15 @@ void apx_server_create(apx_server_t *self, uint16_t port);
 void apx_server_destroy(apx_server_t *self);
 void apx_server_start(apx_server_t *self);
 void apx_server_setDebugMode(apx_server_t *self, int8_t debugMode);
+void apx_server_setNumReactors(apx_server_t *self, int32_t numReactors);
+void apx_server_setNumDefinitionWorkers(apx_server_t *self, int32_t numWorkers);
+void apx_server_setConflation(apx_server_t *self, bool enable);
+void apx_server_setDirectDispatch(apx_server_t *self, bool enable);
+void apx_server_setLocalSocket(apx_server_t *self, const char *socketPath);
+void apx_server_setSharedMemory(apx_server_t *self, bool enable);
+void apx_server_setGracePeriod(apx_server_t *self, uint32_t gracePeriodMs);
+int32_t apx_server_expireStaleNodes(apx_server_t *self);
+void apx_server_detachConnection(apx_server_t *self, apx_serverConnection_t *connection);
 
 
 #endif //APX_SERVER_H
@@ -13,6 +13,8 @@
 #include "adt_bytearray.h"
 #include "apx_fileManager.h"
 #include "apx_nodeManager.h"
+#include "apx_frameAccumulator.h"
+#include "apx_server_cfg.h"
 #ifdef _MSC_VER
 #include <Windows.h>
 #endif
@@ -27,6 +29,7 @@
 //////////////////////////////////////////////////////////////////////////////
 struct apx_server_tag;
 struct apx_testServer_tag;
+struct apx_serverReactor_tag;
 
 typedef struct apx_serverConnection_tag
 {
@@ -34,6 +37,9 @@ typedef struct apx_serverConnection_tag
 #ifdef UNIT_TEST
    testsocket_t *testsocket;
    struct apx_testServer_tag *server;
+#if APX_SERVER_REACTOR_ENABLE
+   int sockfd; //in reactor mode the test server talks to the connection over a socketpair instead of testsocket, -1 when unused
+#endif
 #else
    msocket_t *msocket;
    struct apx_server_tag *server;
@@ -42,7 +48,21 @@ typedef struct apx_serverConnection_tag
    bool isGreetingParsed;
    int8_t debugMode;
    adt_bytearray_t sendBuffer;
+   apx_frameAccumulator_t frameAccumulator; //outgoing messages are coalesced here before being written to the socket
    uint8_t numHeaderMaxLen;
+#if APX_SERVER_REACTOR_ENABLE
+   struct apx_serverReactor_tag *reactor; //owning reactor, NULL when the connection runs in threaded mode
+   adt_bytearray_t receiveBuffer; //partial message data, only used in reactor mode
+   bool isScheduled; //protected by reactor lock
+   bool isFlushScheduled; //protected by reactor lock
+   uint32_t flushDeadline; //time (ms) when the reactor flushes frameAccumulator, protected by reactor lock
+   MUTEX_T outputLock; //protects outputBuffer
+   adt_bytearray_t outputBuffer; //data the (non-blocking) socket did not accept yet, only used in reactor mode
+#endif
+#if APX_SHM_TRANSPORT_ENABLE
+   bool isSharedMemoryEnabled; //when true, shared memory offered by the client in its greeting is attached to
+   apx_shmTransport_t *shmTransport;
+#endif
 }apx_serverConnection_t;
 
 //////////////////////////////////////////////////////////////////////////////
@@ -71,6 +91,15 @@ void apx_serverConnection_attachNodeManager(apx_serverConnection_t *self, apx_no
 void apx_serverConnection_detachNodeManager(apx_serverConnection_t *self, apx_nodeManager_t *nodeManager);
 void apx_serverConnection_start(apx_serverConnection_t *self);
 void apx_serverConnection_setDebugMode(apx_serverConnection_t *self, int8_t debugMode);
+void apx_serverConnection_getSendStats(apx_serverConnection_t *self, apx_frameAccumulatorStats_t *stats);
+#if APX_SHM_TRANSPORT_ENABLE
+void apx_serverConnection_setSharedMemory(apx_serverConnection_t *self, bool enable);
+#endif
+#if APX_SERVER_REACTOR_ENABLE
+void apx_serverConnection_setReactor(apx_serverConnection_t *self, struct apx_serverReactor_tag *reactor);
+int8_t apx_serverConnection_writeOutput(apx_serverConnection_t *self);
+int apx_serverConnection_getSocketFd(apx_serverConnection_t *self);
+#endif
 
 int8_t apx_serverConnection_dataReceived(apx_serverConnection_t *self, const uint8_t *dataBuf, uint32_t dataLen, uint32_t *parseLen);
 
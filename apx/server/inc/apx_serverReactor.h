@@ -0,0 +1,73 @@
+#ifndef APX_SERVER_REACTOR_H
+#define APX_SERVER_REACTOR_H
+
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+#if defined(_MSC_PLATFORM_TOOLSET) && (_MSC_PLATFORM_TOOLSET<=110)
+#include "msc_bool.h"
+#else
+#include <stdbool.h>
+#endif
+#include "apx_server_cfg.h"
+#if APX_SERVER_REACTOR_ENABLE
+#include <pthread.h>
+#include "osmacro.h"
+#include "adt_ary.h"
+#include "apx_serverConnection.h"
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+struct apx_server_tag;
+struct apx_testServer_tag;
+
+/**
+ * An epoll driven event loop that owns many server connections.
+ * Receiving, message parsing, routing and sending for an attached connection all run in the reactor worker thread.
+ */
+typedef struct apx_serverReactor_tag
+{
+   THREAD_T workerThread;
+   SPINLOCK_T lock; //protects the variables below
+   adt_ary_t pendingConnections; //weak references to apx_serverConnection_t which have queued fileManager messages
+   adt_ary_t flushConnections; //weak references to apx_serverConnection_t which have a deadline for their frameAccumulator
+   uint32_t numConnections; //number of attached connections
+   bool isRunning;
+   bool workerThreadValid;
+   int epollFd;
+   int eventFd; //used to wake up workerThread when messages are queued from other threads
+   uint8_t *readBuf; //receive buffer, only used by workerThread
+#ifdef UNIT_TEST
+   struct apx_testServer_tag *server;
+#else
+   struct apx_server_tag *server;
+#endif
+}apx_serverReactor_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+#ifdef UNIT_TEST
+int8_t apx_serverReactor_create(apx_serverReactor_t *self, struct apx_testServer_tag *server);
+#else
+int8_t apx_serverReactor_create(apx_serverReactor_t *self, struct apx_server_tag *server);
+#endif
+void apx_serverReactor_destroy(apx_serverReactor_t *self);
+int8_t apx_serverReactor_start(apx_serverReactor_t *self);
+void apx_serverReactor_stop(apx_serverReactor_t *self);
+int8_t apx_serverReactor_attachConnection(apx_serverReactor_t *self, apx_serverConnection_t *connection);
+void apx_serverReactor_schedule(apx_serverReactor_t *self, apx_serverConnection_t *connection);
+void apx_serverReactor_scheduleFlush(apx_serverReactor_t *self, apx_serverConnection_t *connection, uint32_t delayMs);
+void apx_serverReactor_setWriteNotify(apx_serverReactor_t *self, apx_serverConnection_t *connection, bool enable);
+uint32_t apx_serverReactor_getNumConnections(apx_serverReactor_t *self);
+
+#endif //APX_SERVER_REACTOR_ENABLE
+#endif //APX_SERVER_REACTOR_H
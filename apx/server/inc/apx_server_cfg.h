@@ -0,0 +1,52 @@
+#ifndef APX_SERVER_CFG_H
+#define APX_SERVER_CFG_H
+
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#ifndef APX_SERVER_REACTOR_ENABLE
+#if defined(__linux__)
+#define APX_SERVER_REACTOR_ENABLE 1 //epoll based reactor pool is only available on Linux
+#else
+#define APX_SERVER_REACTOR_ENABLE 0
+#endif
+#endif
+
+#ifndef APX_SERVER_REACTOR_MAX_EVENTS
+#define APX_SERVER_REACTOR_MAX_EVENTS 64 //maximum number of events returned from each call to epoll_wait
+#endif
+
+#ifndef APX_SERVER_REACTOR_READ_SIZE
+#define APX_SERVER_REACTOR_READ_SIZE 16384 //size of the receive buffer owned by each reactor
+#endif
+
+#ifndef APX_SERVER_REACTOR_MAX_OUTPUT_LEN
+#ifdef UNIT_TEST
+#define APX_SERVER_REACTOR_MAX_OUTPUT_LEN 65536 //small enough for the unit tests to reach with a handful of writes
+#else
+#define APX_SERVER_REACTOR_MAX_OUTPUT_LEN 4194304 //a client that lets this many bytes (4MB) back up in its output buffer is disconnected
+#endif
+#endif
+
+#define APX_SERVER_REACTORS_AUTO  -1 //one reactor per online CPU core
+#define APX_SERVER_REACTORS_NONE   0 //threaded mode, each connection has its own set of threads
+
+#define APX_SERVER_DEFINITION_WORKERS_AUTO -1 //one definition worker per online CPU core
+#define APX_SERVER_DEFINITION_WORKERS_NONE  0 //definitions are processed by the connection that received them
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+
+#endif //APX_SERVER_CFG_H
@@ -20,6 +20,7 @@
 #include "testsocket.h"
 #include "apx_nodeManager.h"
 #include "apx_serverConnection.h"
+#include "apx_serverReactor.h"
 #include "apx_router.h"
 #include "adt_list.h"
 
@@ -30,9 +31,14 @@
 typedef struct apx_testServer_tag
 {
    testsocket_t *clientConnection;
+   MUTEX_T mutex; //protects connections, connections served by the reactor are removed by the reactor thread
    adt_list_t connections; //linked list of strong references to apx_serverConnection_t
    apx_nodeManager_t nodeManager; //the server has a single instance of the node manager, all connections interface with this object
    apx_router_t router; //this component handles all routing tables within the server
+   bool isDirectDispatchEnabled; //applied to connections accepted from now on, see apx_server_setDirectDispatch
+#if APX_SERVER_REACTOR_ENABLE
+   apx_serverReactor_t *reactor; //NULL until apx_testServer_setNumReactors is called
+#endif
 }apx_testServer_t;
 
 //////////////////////////////////////////////////////////////////////////////
@@ -41,5 +47,12 @@ typedef struct apx_testServer_tag
 void apx_testServer_create(apx_testServer_t *self);
 void apx_testServer_destroy(apx_testServer_t *self);
 void apx_testServer_accept(apx_testServer_t *self, testsocket_t *socket);
+void apx_testServer_setDirectDispatch(apx_testServer_t *self, bool enable);
+void apx_testServer_closeConnection(apx_testServer_t *self, testsocket_t *socket);
+void apx_testServer_detachConnection(apx_testServer_t *self, apx_serverConnection_t *connection);
+#if APX_SERVER_REACTOR_ENABLE
+void apx_testServer_setNumReactors(apx_testServer_t *self, int32_t numReactors);
+int apx_testServer_acceptReactor(apx_testServer_t *self, testsocket_t *socket);
+#endif
 
 #endif //APX_TEST_SERVER_H
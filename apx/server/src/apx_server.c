@@ -5,11 +5,23 @@
 #include "apx_server.h"
 #include "apx_logging.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _MSC_VER
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
 
 
 //////////////////////////////////////////////////////////////////////////////
 // CONSTANTS AND DATA TYPES
 //////////////////////////////////////////////////////////////////////////////
+#ifdef _MSC_VER
+#define STRDUP _strdup
+#else
+#define STRDUP strdup
+#endif
+
 typedef struct apx_serverInfo_tag
 {
    uint8_t addressFamily;
@@ -21,6 +33,15 @@ typedef struct apx_serverInfo_tag
 static void apx_server_accept(void *arg,msocket_server_t *srv,msocket_t *msocket);
 static int8_t apx_server_data(void *arg, const uint8_t *dataBuf, uint32_t dataLen, uint32_t *parseLen);
 static void apx_server_disconnected(void *arg);
+static void apx_server_startDefinitionWorkers(apx_server_t *self);
+#ifndef _MSC_VER
+static void apx_server_removeLocalSocketFile(const char *socketPath);
+#endif
+#if APX_SERVER_REACTOR_ENABLE
+static void apx_server_startReactors(apx_server_t *self);
+static void apx_server_stopReactors(apx_server_t *self);
+static apx_serverReactor_t *apx_server_selectReactor(apx_server_t *self);
+#endif
 
 //////////////////////////////////////////////////////////////////////////////
 // GLOBAL VARIABLES
@@ -41,7 +62,16 @@ void apx_server_create(apx_server_t *self, uint16_t tcpPort)
       msocket_handler_t serverHandler;
       adt_list_create(&self->connections,apx_serverConnection_vdelete);
       self->tcpPort = tcpPort;
+      self->localServerFile = (char*) 0;
       self->debugMode = APX_DEBUG_NONE;
+      self->numReactors = APX_SERVER_REACTORS_NONE;
+      self->numDefinitionWorkers = APX_SERVER_DEFINITION_WORKERS_NONE;
+      self->isConflationEnabled = false;
+      self->isDirectDispatchEnabled = false;
+      self->isSharedMemoryEnabled = false;
+#if APX_SERVER_REACTOR_ENABLE
+      self->reactors = (apx_serverReactor_t*) 0;
+#endif
       memset(&serverHandler,0,sizeof(serverHandler));
       msocket_server_create(&self->tcpServer,AF_INET, apx_serverConnection_vdelete);
 #ifndef _MSC_VER
@@ -49,6 +79,9 @@ void apx_server_create(apx_server_t *self, uint16_t tcpPort)
 #endif
       serverHandler.tcp_accept = apx_server_accept;
       msocket_server_sethandler(&self->tcpServer,&serverHandler,self);
+#ifndef _MSC_VER
+      msocket_server_sethandler(&self->localServer,&serverHandler,self);
+#endif
       apx_nodeManager_create(&self->nodeManager);
       apx_router_create(&self->router);
       apx_nodeManager_setRouter(&self->nodeManager, &self->router);
@@ -61,7 +94,20 @@ void apx_server_start(apx_server_t *self)
 {
    if (self != 0)
    {
+      apx_server_startDefinitionWorkers(self);
+#if APX_SERVER_REACTOR_ENABLE
+      apx_server_startReactors(self);
+#endif
       msocket_server_start(&self->tcpServer,0,0,self->tcpPort);
+#ifndef _MSC_VER
+      if (self->localServerFile != 0)
+      {
+         //a socket file left behind by a server that was not shut down properly would make bind fail
+         apx_server_removeLocalSocketFile(self->localServerFile);
+         msocket_server_start(&self->localServer,self->localServerFile,0,0);
+         APX_LOG_INFO("[APX_SERVER] Listening on %s", self->localServerFile);
+      }
+#endif
    }
 }
 
@@ -69,6 +115,12 @@ void apx_server_destroy(apx_server_t *self)
 {
    if (self != 0)
    {
+#if APX_SERVER_REACTOR_ENABLE
+      //reactor threads must be stopped before the connections they own are deleted
+      apx_server_stopReactors(self);
+#endif
+      //the definition workers link nodes into the connections deleted below
+      apx_nodeManager_stopDefinitionWorkers(&self->nodeManager);
       //close and delete all open server connections
       adt_list_destroy(&self->connections);
       //destroy the tcp server
@@ -76,9 +128,28 @@ void apx_server_destroy(apx_server_t *self)
       //destroy the local socket server
 #ifndef _MSC_VER
       msocket_server_destroy(&self->localServer);
+      if (self->localServerFile != 0)
+      {
+         apx_server_removeLocalSocketFile(self->localServerFile);
+      }
 #endif
+      if (self->localServerFile != 0)
+      {
+         free(self->localServerFile);
+      }
       apx_nodeManager_destroy(&self->nodeManager);
       apx_router_destroy(&self->router);
+#if APX_SERVER_REACTOR_ENABLE
+      if (self->reactors != 0)
+      {
+         int32_t i;
+         for (i = 0; i < self->numReactors; i++)
+         {
+            apx_serverReactor_destroy(&self->reactors[i]);
+         }
+         free(self->reactors);
+      }
+#endif
       MUTEX_DESTROY(self->mutex);
    }
 }
@@ -94,6 +165,128 @@ void apx_server_setDebugMode(apx_server_t *self, int8_t debugMode)
 }
 
 
+/**
+ * Selects between reactor mode and threaded mode. Must be called before apx_server_start.
+ * APX_SERVER_REACTORS_AUTO creates one reactor thread per online CPU core while APX_SERVER_REACTORS_NONE
+ * selects threaded mode (the default) where each connection gets its own set of threads.
+ * Reactor mode is only available on Linux, other platforms always use threaded mode.
+ */
+void apx_server_setNumReactors(apx_server_t *self, int32_t numReactors)
+{
+   if ( (self != 0) && (numReactors >= APX_SERVER_REACTORS_AUTO) )
+   {
+      self->numReactors = numReactors;
+   }
+}
+
+/**
+ * Sets the number of threads that parse incoming node definitions. Must be called before apx_server_start.
+ * Only linking the parsed nodes into the routing tables is serialized, a storm of connecting clients is parsed in parallel.
+ * APX_SERVER_DEFINITION_WORKERS_NONE (the default) processes each definition in the thread of the connection that received it.
+ */
+void apx_server_setNumDefinitionWorkers(apx_server_t *self, int32_t numWorkers)
+{
+   if ( (self != 0) && (numWorkers >= APX_SERVER_DEFINITION_WORKERS_AUTO) )
+   {
+      self->numDefinitionWorkers = numWorkers;
+   }
+}
+
+/**
+ * Enables latest-value conflation for connections accepted from now on. Writes to non-queued require ports of a slow client
+ * are then collapsed so that memory used per client is bounded by the size of its inPortData file.
+ */
+void apx_server_setConflation(apx_server_t *self, bool enable)
+{
+   if (self != 0)
+   {
+      self->isConflationEnabled = enable;
+   }
+}
+
+/**
+ * Enables direct dispatch for connections accepted from now on. A write received from one client is then copied into the
+ * inPortData of each destination and sent by the receiving thread, the destination worker only handles writes that arrive
+ * while it still has a backlog. This removes a thread handoff from the receive-to-send path.
+ */
+void apx_server_setDirectDispatch(apx_server_t *self, bool enable)
+{
+   if (self != 0)
+   {
+      self->isDirectDispatchEnabled = enable;
+   }
+}
+
+/**
+ * Sets the path of the unix domain socket that co-located clients connect to using apx_client_connect_unix.
+ * The local socket is served alongside the TCP port. Must be called before apx_server_start, 0 disables the local socket.
+ */
+void apx_server_setLocalSocket(apx_server_t *self, const char *socketPath)
+{
+   if (self != 0)
+   {
+      if (self->localServerFile != 0)
+      {
+         free(self->localServerFile);
+      }
+      self->localServerFile = (socketPath != 0)? STRDUP(socketPath) : (char*) 0;
+   }
+}
+
+/**
+ * Lets clients connected to the local socket exchange port data through shared memory instead of the socket.
+ * The server must be allowed to duplicate file descriptors of the client process (same user or CAP_SYS_PTRACE),
+ * otherwise the connection silently keeps using the socket. Has no effect on platforms without shared memory transport.
+ */
+void apx_server_setSharedMemory(apx_server_t *self, bool enable)
+{
+   if (self != 0)
+   {
+      self->isSharedMemoryEnabled = enable;
+   }
+}
+
+/**
+ * Keeps the nodes of a lost connection, with their routes and last values, for gracePeriodMs milliseconds.
+ * A client reconnecting with the same node name and definition digest within that time resumes its session without
+ * the definition being parsed and routed again. 0 (the default) deletes the nodes as soon as the connection is lost.
+ */
+void apx_server_setGracePeriod(apx_server_t *self, uint32_t gracePeriodMs)
+{
+   if (self != 0)
+   {
+      apx_nodeManager_setGracePeriod(&self->nodeManager, gracePeriodMs);
+   }
+}
+
+/**
+ * deletes the nodes of lost connections whose grace period has passed, should be called periodically when a grace period is set.
+ * Returns the number of deleted nodes
+ */
+int32_t apx_server_expireStaleNodes(apx_server_t *self)
+{
+   if (self != 0)
+   {
+      return apx_nodeManager_expireStaleNodes(&self->nodeManager);
+   }
+   return 0;
+}
+
+/**
+ * removes connection from the server connection list and detaches it from the nodeManager.
+ * The caller is responsible for deleting the connection object afterwards.
+ */
+void apx_server_detachConnection(apx_server_t *self, apx_serverConnection_t *connection)
+{
+   if ( (self != 0) && (connection != 0) )
+   {
+      MUTEX_LOCK(self->mutex);
+      adt_list_remove(&self->connections, connection);
+      apx_nodeManager_detachFileManager(&self->nodeManager, &connection->fileManager);
+      MUTEX_UNLOCK(self->mutex);
+   }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // LOCAL FUNCTIONS
 //////////////////////////////////////////////////////////////////////////////
@@ -108,9 +301,14 @@ static void apx_server_accept(void *arg,msocket_server_t *srv,msocket_t *msocket
       if (newConnection != 0)
       {
          msocket_handler_t handlerTable;
+#if APX_SERVER_REACTOR_ENABLE
+         apx_serverReactor_t *reactor;
+#endif
 
          //add it to our list of connections. The linked list is used to keep track of all open connections
+         MUTEX_LOCK(self->mutex);
          adt_list_insert(&self->connections,newConnection);
+         MUTEX_UNLOCK(self->mutex);
 
          //attach our (single) instance of the nodeManager with the connection
          //apx_serverConnection_attachNodeManager()
@@ -133,6 +331,28 @@ static void apx_server_accept(void *arg,msocket_server_t *srv,msocket_t *msocket
          {
             apx_serverConnection_setDebugMode(newConnection, self->debugMode);
          }
+         apx_fileManager_setConflation(&newConnection->fileManager, self->isConflationEnabled);
+         apx_fileManager_setDirectDispatch(&newConnection->fileManager, self->isDirectDispatchEnabled);
+#if APX_SHM_TRANSPORT_ENABLE
+         //the greeting of a remote client could name any local process, only trust it on the local socket
+         apx_serverConnection_setSharedMemory(newConnection, (self->isSharedMemoryEnabled == true) && (msocket->addressFamily == AF_LOCAL));
+#endif
+#if APX_SERVER_REACTOR_ENABLE
+         reactor = apx_server_selectReactor(self);
+         if (reactor != 0)
+         {
+            //reactor mode: no msocket IO thread is started, the reactor reads directly from the socket
+            apx_serverConnection_setReactor(newConnection, reactor);
+            apx_serverConnection_start(newConnection);
+            if (apx_serverReactor_attachConnection(reactor, newConnection) != 0)
+            {
+               APX_LOG_ERROR("[APX_SERVER] %s", "apx_serverReactor_attachConnection() failed");
+               apx_server_detachConnection(self, newConnection);
+               apx_serverConnection_delete(newConnection);
+            }
+            return;
+         }
+#endif
          //now that the handler is setup, start the internal listening thread in the msocket
          msocket_start_io(msocket);
          //trigger the new connection to send the greeting message (in case there is any to be sent)
@@ -184,3 +404,121 @@ static void apx_server_disconnected(void *arg)
    }
 }
 
+#ifndef _MSC_VER
+/**
+ * removes the file at socketPath, but only if it is a socket
+ */
+static void apx_server_removeLocalSocketFile(const char *socketPath)
+{
+   struct stat fileInfo;
+   if ( (stat(socketPath, &fileInfo) == 0) && (S_ISSOCK(fileInfo.st_mode)) )
+   {
+      (void) unlink(socketPath);
+   }
+}
+#endif
+
+static void apx_server_startDefinitionWorkers(apx_server_t *self)
+{
+   if (self->numDefinitionWorkers == APX_SERVER_DEFINITION_WORKERS_AUTO)
+   {
+#ifdef _MSC_VER
+      SYSTEM_INFO systemInfo;
+      GetSystemInfo(&systemInfo);
+      self->numDefinitionWorkers = (int32_t) systemInfo.dwNumberOfProcessors;
+#else
+      long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+      self->numDefinitionWorkers = (numCores > 0)? (int32_t) numCores : 1;
+#endif
+   }
+   if (self->numDefinitionWorkers > APX_SERVER_DEFINITION_WORKERS_NONE)
+   {
+      if (apx_nodeManager_startDefinitionWorkers(&self->nodeManager, self->numDefinitionWorkers) != 0)
+      {
+         APX_LOG_ERROR("[APX_SERVER] %s", "failed to start definition workers, definitions are processed by the connections");
+         self->numDefinitionWorkers = APX_SERVER_DEFINITION_WORKERS_NONE;
+      }
+   }
+}
+
+#if APX_SERVER_REACTOR_ENABLE
+static void apx_server_startReactors(apx_server_t *self)
+{
+   int32_t i;
+   if (self->numReactors == APX_SERVER_REACTORS_AUTO)
+   {
+      long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+      self->numReactors = (numCores > 0)? (int32_t) numCores : 1;
+   }
+   if ( (self->numReactors == APX_SERVER_REACTORS_NONE) || (self->reactors != 0) )
+   {
+      return;
+   }
+   self->reactors = (apx_serverReactor_t*) malloc(sizeof(apx_serverReactor_t) * self->numReactors);
+   if (self->reactors == 0)
+   {
+      APX_LOG_ERROR("[APX_SERVER] %s", "failed to allocate reactors, falling back to threaded mode");
+      self->numReactors = APX_SERVER_REACTORS_NONE;
+      return;
+   }
+   for (i = 0; i < self->numReactors; i++)
+   {
+      int8_t result = apx_serverReactor_create(&self->reactors[i], self);
+      if (result == 0)
+      {
+         result = apx_serverReactor_start(&self->reactors[i]);
+         if (result != 0)
+         {
+            apx_serverReactor_destroy(&self->reactors[i]);
+         }
+      }
+      if (result != 0)
+      {
+         APX_LOG_ERROR("[APX_SERVER] failed to start reactor %d, running with %d reactor(s)", (int) i, (int) i);
+         if (i == 0)
+         {
+            free(self->reactors);
+            self->reactors = (apx_serverReactor_t*) 0;
+         }
+         self->numReactors = i;
+         break;
+      }
+   }
+   APX_LOG_INFO("[APX_SERVER] Using %d reactor thread(s)", (int) self->numReactors);
+}
+
+static void apx_server_stopReactors(apx_server_t *self)
+{
+   if (self->reactors != 0)
+   {
+      int32_t i;
+      for (i = 0; i < self->numReactors; i++)
+      {
+         apx_serverReactor_stop(&self->reactors[i]);
+      }
+   }
+}
+
+/**
+ * returns the reactor with fewest connections or NULL when running in threaded mode
+ */
+static apx_serverReactor_t *apx_server_selectReactor(apx_server_t *self)
+{
+   apx_serverReactor_t *selected = (apx_serverReactor_t*) 0;
+   if (self->reactors != 0)
+   {
+      int32_t i;
+      uint32_t minConnections = 0;
+      for (i = 0; i < self->numReactors; i++)
+      {
+         uint32_t numConnections = apx_serverReactor_getNumConnections(&self->reactors[i]);
+         if ( (selected == 0) || (numConnections < minConnections) )
+         {
+            selected = &self->reactors[i];
+            minConnections = numConnections;
+         }
+      }
+   }
+   return selected;
+}
+#endif
@@ -4,19 +4,35 @@
 #ifndef APX_DEBUG_ENABLE
 #define APX_DEBUG_ENABLE 0
 #endif
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE //struct ucred
+#endif
 #include <errno.h>
 #include <malloc.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <stdio.h>
 #include "apx_serverConnection.h"
 #include "apx_logging.h"
+#if APX_SHM_TRANSPORT_ENABLE
+#include <unistd.h>
+#endif
 #ifdef UNIT_TEST
 #include "apx_testServer.h"
 #else
 #include "apx_server.h"
 #endif
+#if APX_SERVER_REACTOR_ENABLE || (!defined(UNIT_TEST) && !defined(_MSC_VER))
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+#if APX_SERVER_REACTOR_ENABLE
+#include <unistd.h>
+#include "apx_serverReactor.h"
+#endif
 #include "headerutil.h"
+#include "rmf.h"
 #include "bstr.h"
 #ifdef MEM_LEAK_CHECK
 #include "CMemLeak.h"
@@ -32,14 +48,38 @@
 #define MAX_DEBUG_BYTES 100
 #define MAX_DEBUG_MSG_SIZE 400
 #define HEX_DATA_LEN 3u
+#if (APX_SERVER_REACTOR_ENABLE || (!defined(UNIT_TEST) && !defined(_MSC_VER))) && !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0 //platforms without it are expected to ignore SIGPIPE
+#endif
 
 //////////////////////////////////////////////////////////////////////////////
 // LOCAL FUNCTION PROTOTYPES
 //////////////////////////////////////////////////////////////////////////////
 static void apx_serverConnection_parseGreeting(apx_serverConnection_t *self, const uint8_t *msgBuf, int32_t msgLen);
+static void apx_serverConnection_parseMultiWriteGreetingLine(apx_serverConnection_t *self, const char *line);
+static void apx_serverConnection_parseNumHeaderGreetingLine(apx_serverConnection_t *self, const char *line);
+static void apx_serverConnection_sendNumHeaderFormat(apx_serverConnection_t *self);
+#if APX_SHM_TRANSPORT_ENABLE
+static void apx_serverConnection_parseShmGreetingLine(apx_serverConnection_t *self, const char *line);
+static pid_t apx_serverConnection_getPeerPid(apx_serverConnection_t *self);
+#endif
 static uint8_t apx_serverConnection_parseMessage(apx_serverConnection_t *self, const uint8_t *dataBuf, uint32_t dataLen, uint32_t *parseLen);
 static uint8_t *apx_serverConnection_getSendBuffer(void *arg, int32_t msgLen);
 static int32_t apx_serverConnection_send(void *arg, int32_t offset, int32_t msgLen);
+static int32_t apx_serverConnection_sendGather(void *arg, const uint8_t *header, int32_t headerLen, const uint8_t *payload, int32_t payloadLen);
+static int32_t apx_serverConnection_trySendGather(void *arg, const uint8_t *header, int32_t headerLen, const uint8_t *payload, int32_t payloadLen);
+static int32_t apx_serverConnection_appendGather(apx_serverConnection_t *self, const uint8_t *header, int32_t headerLen, const uint8_t *payload, int32_t payloadLen, bool isBlocking);
+static int32_t apx_serverConnection_getSendAvail(void *arg);
+static int32_t apx_serverConnection_flush(void *arg);
+static int32_t apx_serverConnection_transmit(void *arg, const apx_frameBuffer_t *buffers, int32_t numBuffers);
+#if APX_SERVER_REACTOR_ENABLE || (!defined(UNIT_TEST) && !defined(_MSC_VER))
+static ssize_t apx_serverConnection_sendmsg(int sockfd, const apx_frameBuffer_t *buffers, int32_t numBuffers, uint32_t skipLen);
+#endif
+#if APX_SERVER_REACTOR_ENABLE
+static int32_t apx_serverConnection_transmitNonBlocking(apx_serverConnection_t *self, const apx_frameBuffer_t *buffers, int32_t numBuffers);
+static void apx_serverConnection_wakeup(void *arg);
+static void apx_serverConnection_flushDeadline(void *arg, uint32_t delayMs);
+#endif
 
 
 //////////////////////////////////////////////////////////////////////////////
@@ -65,14 +105,31 @@ int8_t apx_serverConnection_create(apx_serverConnection_t *self, msocket_t *sock
    {
 #ifdef UNIT_TEST
       self->testsocket=socket;
+#if APX_SERVER_REACTOR_ENABLE
+      self->sockfd = -1;
+#endif
 #else
       self->msocket = socket;
 #endif
       self->server=server;
       self->isGreetingParsed = false;
       self->debugMode = APX_DEBUG_NONE;
-      self->numHeaderMaxLen = (int8_t) sizeof(uint32_t); //currently only 4-byte header is supported. There might be a future version where we support both 16-bit and 32-bit message headers
+      self->numHeaderMaxLen = (uint8_t) sizeof(uint32_t); //changed to 2 when the client requests RMF_NUMHEADER_FORMAT_16 in its greeting
       adt_bytearray_create(&self->sendBuffer, SEND_BUFFER_GROW_SIZE);
+      apx_frameAccumulator_create(&self->frameAccumulator, APX_FRAME_ACCUMULATOR_MAX_LEN, APX_FRAME_ACCUMULATOR_MAX_DELAY_MS, apx_serverConnection_transmit, (void*) self);
+#if APX_SERVER_REACTOR_ENABLE
+      self->reactor = (struct apx_serverReactor_tag*) 0;
+      self->isScheduled = false;
+      self->isFlushScheduled = false;
+      self->flushDeadline = 0;
+      adt_bytearray_create(&self->receiveBuffer, SEND_BUFFER_GROW_SIZE);
+      MUTEX_INIT(self->outputLock);
+      adt_bytearray_create(&self->outputBuffer, SEND_BUFFER_GROW_SIZE);
+#endif
+#if APX_SHM_TRANSPORT_ENABLE
+      self->isSharedMemoryEnabled = false;
+      self->shmTransport = (apx_shmTransport_t*) 0;
+#endif
       return apx_fileManager_create(&self->fileManager, APX_FILEMANAGER_SERVER_MODE);
    }
    errno=EINVAL;
@@ -83,9 +140,25 @@ void apx_serverConnection_destroy(apx_serverConnection_t *self)
 {
    if (self != 0)
    {
+      //stops the shared memory receive thread before the transport is deleted
       apx_fileManager_destroy(&self->fileManager);
+#if APX_SHM_TRANSPORT_ENABLE
+      apx_shmTransport_delete(self->shmTransport);
+#endif
       adt_bytearray_destroy(&self->sendBuffer);
+      apx_frameAccumulator_destroy(&self->frameAccumulator);
+#if APX_SERVER_REACTOR_ENABLE
+      adt_bytearray_destroy(&self->receiveBuffer);
+      adt_bytearray_destroy(&self->outputBuffer);
+      MUTEX_DESTROY(self->outputLock);
+#endif
 #ifdef UNIT_TEST
+#if APX_SERVER_REACTOR_ENABLE
+      if (self->sockfd >= 0)
+      {
+         close(self->sockfd);
+      }
+#endif
       testsocket_delete(self->testsocket);
 #else
       msocket_delete(self->msocket);
@@ -165,12 +238,25 @@ void apx_serverConnection_start(apx_serverConnection_t *self)
       //register transmit handler with our fileManager
       serverTransmitHandler.arg = self;
       serverTransmitHandler.send = apx_serverConnection_send;
-      serverTransmitHandler.getSendAvail = 0;
+      serverTransmitHandler.getSendAvail = apx_serverConnection_getSendAvail;
       serverTransmitHandler.getSendBuffer = apx_serverConnection_getSendBuffer;
+      serverTransmitHandler.flush = apx_serverConnection_flush;
+      serverTransmitHandler.sendGather = apx_serverConnection_sendGather;
+      serverTransmitHandler.trySendGather = apx_serverConnection_trySendGather;
       apx_fileManager_setTransmitHandler(&self->fileManager, &serverTransmitHandler);
       //register connection with the server nodeManager
       apx_nodeManager_attachFileManager(&self->server->nodeManager, &self->fileManager);
-      apx_fileManager_start(&self->fileManager);      
+#if APX_SERVER_REACTOR_ENABLE
+      if (self->reactor != 0)
+      {
+         //fileManager messages are processed by the reactor thread instead of by a dedicated worker thread
+         apx_fileManager_startExternal(&self->fileManager, apx_serverConnection_wakeup, (void*) self);
+      }
+      else
+#endif
+      {
+         apx_fileManager_start(&self->fileManager);
+      }
    }
 }
 
@@ -227,6 +313,99 @@ void apx_serverConnection_setDebugMode(apx_serverConnection_t *self, int8_t debu
    }
 }
 
+/**
+ * returns counters describing how well outgoing messages were coalesced into socket writes
+ */
+void apx_serverConnection_getSendStats(apx_serverConnection_t *self, apx_frameAccumulatorStats_t *stats)
+{
+   if ( (self != 0) && (stats != 0) )
+   {
+      apx_frameAccumulator_getStats(&self->frameAccumulator, stats);
+   }
+}
+
+#if APX_SHM_TRANSPORT_ENABLE
+/**
+ * Allows the client to offer shared memory for port data in its greeting. Only enable this for clients on the same host,
+ * the offer contains a process id and file descriptors of the client process. Must be called before data is received.
+ */
+void apx_serverConnection_setSharedMemory(apx_serverConnection_t *self, bool enable)
+{
+   if (self != 0)
+   {
+      self->isSharedMemoryEnabled = enable;
+   }
+}
+#endif
+
+#if APX_SERVER_REACTOR_ENABLE
+/**
+ * assigns the reactor that will own this connection. Must be called before apx_serverConnection_start
+ */
+void apx_serverConnection_setReactor(apx_serverConnection_t *self, struct apx_serverReactor_tag *reactor)
+{
+   if (self != 0)
+   {
+      self->reactor = reactor;
+      //in threaded mode the fileManager worker flushes before it goes to sleep, in reactor mode the reactor also keeps a deadline timer
+      apx_frameAccumulator_setDeadlineHandler(&self->frameAccumulator, apx_serverConnection_flushDeadline, (void*) self);
+   }
+}
+
+/**
+ * writes data held back by apx_serverConnection_transmit to the socket. Called by the reactor when the socket is writable.
+ * returns 0 on success, -1 when the connection is broken
+ */
+int8_t apx_serverConnection_writeOutput(apx_serverConnection_t *self)
+{
+   if (self != 0)
+   {
+      int8_t retval = 0;
+      uint32_t pendingLen;
+      MUTEX_LOCK(self->outputLock);
+      pendingLen = adt_bytearray_length(&self->outputBuffer);
+      if (pendingLen > 0)
+      {
+         const uint8_t *pBegin = adt_bytearray_data(&self->outputBuffer);
+         ssize_t sendLen = send(apx_serverConnection_getSocketFd(self), pBegin, pendingLen, MSG_NOSIGNAL);
+         if (sendLen > 0)
+         {
+            adt_bytearray_trimLeft(&self->outputBuffer, pBegin + sendLen);
+            pendingLen -= (uint32_t) sendLen;
+         }
+         else if ( (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR) )
+         {
+            retval = -1;
+         }
+         else
+         {
+            //MISRA
+         }
+      }
+      if ( (retval == 0) && (pendingLen == 0) )
+      {
+         apx_serverReactor_setWriteNotify(self->reactor, self, false);
+      }
+      MUTEX_UNLOCK(self->outputLock);
+      return retval;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * returns the socket descriptor the reactor waits on
+ */
+int apx_serverConnection_getSocketFd(apx_serverConnection_t *self)
+{
+#ifdef UNIT_TEST
+   return self->sockfd;
+#else
+   return self->msocket->tcpsockfd;
+#endif
+}
+#endif
+
 //////////////////////////////////////////////////////////////////////////////
 // LOCAL FUNCTIONS
 //////////////////////////////////////////////////////////////////////////////
@@ -262,18 +441,27 @@ static void apx_serverConnection_parseGreeting(apx_serverConnection_t *self, con
                APX_LOG_INFO("%s", "[APX_SRV_CONNECTION] Greeting parsed");
             }
 
+            if (self->numHeaderMaxLen == (uint8_t) sizeof(uint16_t))
+            {
+               //the client must know the header format before it sees the acknowledge
+               apx_serverConnection_sendNumHeaderFormat(self);
+            }
             apx_fileManager_onConnected(&self->fileManager);
             break;
          }
          else
          {
-            //TODO: parse greeting line
             if (lengthOfLine<MAX_HEADER_LEN)
             {
                char tmp[MAX_HEADER_LEN+1];
                memcpy(tmp,pMark,lengthOfLine);
                tmp[lengthOfLine]=0;
                //printf("\tgreeting-line: '%s'\n",tmp);
+               apx_serverConnection_parseMultiWriteGreetingLine(self, tmp);
+               apx_serverConnection_parseNumHeaderGreetingLine(self, tmp);
+#if APX_SHM_TRANSPORT_ENABLE
+               apx_serverConnection_parseShmGreetingLine(self, tmp);
+#endif
             }
          }
       }
@@ -285,20 +473,127 @@ static void apx_serverConnection_parseGreeting(apx_serverConnection_t *self, con
 }
 
 /**
- * a message consists of a message length (1 or 4 bytes) packed as binary integer (big endian). Then follows the message data followed by a new message length header etc.
+ * the greeting line "Multi-Write: 1" means that the client accepts RMF_CMD_MULTI_WRITE.
+ * The fileManager tells the client that we do as well right after the acknowledge.
+ */
+static void apx_serverConnection_parseMultiWriteGreetingLine(apx_serverConnection_t *self, const char *line)
+{
+   size_t headerLen = strlen(RMF_MULTI_WRITE);
+   if ( (strncmp(line, RMF_MULTI_WRITE, headerLen) == 0) && (atoi(&line[headerLen]) == 1) )
+   {
+      apx_fileManager_setMultiWrite(&self->fileManager, true);
+   }
+}
+
+/**
+ * the greeting line "NumHeader-Format: 16" requests 16-bit message length headers in both directions.
+ * Nothing has been sent to the client yet, all messages following the greeting use the requested format.
+ */
+static void apx_serverConnection_parseNumHeaderGreetingLine(apx_serverConnection_t *self, const char *line)
+{
+   size_t headerLen = strlen(RMF_NUMHEADER_FORMAT);
+   if ( (strncmp(line, RMF_NUMHEADER_FORMAT, headerLen) == 0) && (atoi(&line[headerLen]) == (int) RMF_NUMHEADER_FORMAT_16) )
+   {
+      self->numHeaderMaxLen = (uint8_t) sizeof(uint16_t);
+   }
+}
+
+/**
+ * tells the client that its requested header format is used from now on
+ */
+static void apx_serverConnection_sendNumHeaderFormat(apx_serverConnection_t *self)
+{
+   uint8_t *sendBuffer = apx_serverConnection_getSendBuffer((void*) self, RMF_NUMHEADER_FORMAT_CMD_LEN+RMF_MAX_HEADER_SIZE);
+   if (sendBuffer != 0)
+   {
+      uint8_t *dataBuf = &sendBuffer[RMF_MAX_HEADER_SIZE];
+      int32_t dataLen = rmf_serialize_cmdNumHeaderFormat(dataBuf, RMF_NUMHEADER_FORMAT_CMD_LEN, RMF_NUMHEADER_FORMAT_16);
+      if (dataLen > 0)
+      {
+         int32_t headerLen = rmf_packHeaderBeforeData(dataBuf, RMF_MAX_HEADER_SIZE, RMF_CMD_START_ADDR, false);
+         if (headerLen > 0)
+         {
+            apx_serverConnection_send((void*) self, RMF_MAX_HEADER_SIZE-headerLen, headerLen+dataLen);
+            apx_serverConnection_flush((void*) self);
+         }
+      }
+   }
+}
+
+#if APX_SHM_TRANSPORT_ENABLE
+/**
+ * attaches to the shared memory offered in the greeting line "Shm-Transport: <pid> <memfd> <eventfd> <eventfd>".
+ * This happens before the greeting is acknowledged, the client falls back to the socket if we did not attach.
+ * The offer is ignored unless the pid is the one the kernel reports for the other end of our socket.
+ */
+static void apx_serverConnection_parseShmGreetingLine(apx_serverConnection_t *self, const char *line)
+{
+   size_t headerLen = strlen(APX_SHM_GREETING_HEADER);
+   if ( (self->isSharedMemoryEnabled == true) && (self->shmTransport == 0) &&
+        (strncmp(line, APX_SHM_GREETING_HEADER, headerLen) == 0) && (line[headerLen] == ':') )
+   {
+      pid_t peerPid = apx_serverConnection_getPeerPid(self);
+      self->shmTransport = apx_shmTransport_newFromGreeting(&line[headerLen+1], peerPid);
+      if (self->shmTransport == 0)
+      {
+         APX_LOG_WARNING("[APX_SRV_CONNECTION] (%p) Unable to attach to shared memory of client, errno=%d", (void*) self, (int) errno);
+      }
+      else if (apx_fileManager_setSharedMemoryTransport(&self->fileManager, self->shmTransport) != 0)
+      {
+         APX_LOG_WARNING("[APX_SRV_CONNECTION] (%p) Unable to start shared memory receiver", (void*) self);
+         apx_shmTransport_delete(self->shmTransport);
+         self->shmTransport = (apx_shmTransport_t*) 0;
+      }
+      else
+      {
+         APX_LOG_INFO("[APX_SRV_CONNECTION] (%p) Port data uses shared memory", (void*) self);
+      }
+   }
+}
+
+/**
+ * returns the process id of the client as reported by the kernel (SO_PEERCRED), -1 when it's unknown
+ */
+static pid_t apx_serverConnection_getPeerPid(apx_serverConnection_t *self)
+{
+#ifdef UNIT_TEST
+   (void) self;
+   return getpid(); //test clients run in the same process as the test server
+#else
+   struct ucred cred;
+   socklen_t credLen = (socklen_t) sizeof(cred);
+   if ( (getsockopt(self->msocket->tcpsockfd, SOL_SOCKET, SO_PEERCRED, &cred, &credLen) != 0) || (credLen != (socklen_t) sizeof(cred)) )
+   {
+      return (pid_t) -1;
+   }
+   return cred.pid;
+#endif
+}
+#endif
+
+/**
+ * a message consists of a message length (1 or 4 bytes, 1 or 2 bytes with RMF_NUMHEADER_FORMAT_16) packed as binary integer (big endian).
+ * Then follows the message data followed by a new message length header etc.
+ * Data messages of at least APX_FILEMANAGER_STREAM_MIN_LEN bytes are parsed in parts as they arrive, the rest are parsed once complete.
  */
 static uint8_t apx_serverConnection_parseMessage(apx_serverConnection_t *self, const uint8_t *dataBuf, uint32_t dataLen, uint32_t *parseLen)
 {
    uint32_t totalParsed=0;
    uint32_t msgLen;
    const uint8_t *pBegin = dataBuf;
-   const uint8_t *pResult;
    const uint8_t *pEnd = dataBuf+dataLen;
    const uint8_t *pNext = pBegin;
-   pResult = headerutil_numDecode32(pNext, pEnd, &msgLen);
-   if (pResult>pNext)
+   int32_t result;
+   if (apx_fileManager_isParsingMessage(&self->fileManager) == true)
+   {
+      result = apx_fileManager_parseMessageContinue(&self->fileManager, dataBuf, (int32_t) dataLen);
+      *parseLen = (result > 0)? (uint32_t) result : 0u;
+      return 0;
+   }
+   result = rmf_unpackNumHeader(pNext, (int32_t) dataLen, &msgLen, self->numHeaderMaxLen);
+   if (result > 0)
    {
-      uint32_t headerLen = (uint32_t) (pResult-pNext);
+      uint32_t headerLen = (uint32_t) result;
       pNext+=headerLen;
       if (pNext+msgLen<=pEnd)
       {
@@ -330,6 +625,15 @@ static uint8_t apx_serverConnection_parseMessage(apx_serverConnection_t *self, c
             apx_fileManager_parseMessage(&self->fileManager, pNext, msgLen);
          }
       }
+      else if ( (self->isGreetingParsed == true) && (msgLen >= APX_FILEMANAGER_STREAM_MIN_LEN) )
+      {
+         //write what has been received so far, this keeps large messages from piling up in the receive buffer
+         result = apx_fileManager_parseMessageBegin(&self->fileManager, pNext, (int32_t) (pEnd-pNext), (int32_t) msgLen);
+         if (result > 0)
+         {
+            totalParsed+=headerLen+(uint32_t) result;
+         }
+      }
       else
       {
          //we have to wait until entire message is in the buffer
@@ -384,25 +688,12 @@ static int32_t apx_serverConnection_send(void *arg, int32_t offset, int32_t msgL
       if ((sendBuffer != 0) && (msgLen+self->numHeaderMaxLen<=sendBufferLen) )
       {
          uint8_t header[sizeof(uint32_t)];
-         uint8_t headerLen;
-         uint8_t *headerEnd;
+         int32_t headerLen = rmf_packNumHeader(header, (int32_t) sizeof(header), (uint32_t) msgLen, self->numHeaderMaxLen);
          uint8_t *pBegin;
-         if (self->numHeaderMaxLen == (uint8_t) sizeof(uint32_t))
-         {
-            headerEnd = headerutil_numEncode32(header, (uint32_t) sizeof(header), msgLen);
-            if (headerEnd>header)
-            {
-               headerLen=headerEnd-header;
-            }
-            else
-            {
-               assert(0);
-               return -1; //header buffer too small
-            }
-         }
-         else
+         if (headerLen <= 0)
          {
-            return -1; //not yet implemented
+            APX_LOG_ERROR("[APX_SRV_CONNECTION] (%p) Message of %d bytes is too long for the header format", (void*) self, (int) msgLen);
+            return -1;
          }
          //place header just before user data begin
          pBegin = sendBuffer+(self->numHeaderMaxLen+offset-headerLen); //the part in the parenthesis is where the user data begins
@@ -424,18 +715,273 @@ static int32_t apx_serverConnection_send(void *arg, int32_t offset, int32_t msgL
             }
             APX_LOG_DEBUG("[APX_SRV_CONNECTION] %s", msg);
          }
-		 
+         return apx_frameAccumulator_append(&self->frameAccumulator, pBegin, (uint32_t) (msgLen+headerLen));
+      }
+      else
+      {
+         assert(0);
+      }
+   }
+   return -1;
+}
+
+/**
+ * callback for fileManager when it wants to send an RMF header followed by data that is stored elsewhere (e.g. in a shared payload).
+ * The data is copied straight into the outgoing frame, there is no intermediate copy in sendBuffer.
+ */
+static int32_t apx_serverConnection_sendGather(void *arg, const uint8_t *header, int32_t headerLen, const uint8_t *payload, int32_t payloadLen)
+{
+   return apx_serverConnection_appendGather((apx_serverConnection_t*) arg, header, headerLen, payload, payloadLen, true);
+}
+
+/**
+ * callback for fileManager when another connection sends a routed write through this connection, see apx_fileManager_directWriteCmd.
+ * Same as apx_serverConnection_sendGather but the frame is only added when that can be done without waiting for the socket.
+ */
+static int32_t apx_serverConnection_trySendGather(void *arg, const uint8_t *header, int32_t headerLen, const uint8_t *payload, int32_t payloadLen)
+{
+   return apx_serverConnection_appendGather((apx_serverConnection_t*) arg, header, headerLen, payload, payloadLen, false);
+}
+
+static int32_t apx_serverConnection_appendGather(apx_serverConnection_t *self, const uint8_t *header, int32_t headerLen, const uint8_t *payload, int32_t payloadLen, bool isBlocking)
+{
+   if ( (self != 0) && (header != 0) && (headerLen > 0) && (headerLen <= (int32_t) RMF_MAX_HEADER_SIZE) && (payloadLen >= 0) )
+   {
+      uint8_t frameHeader[sizeof(uint32_t)+RMF_MAX_HEADER_SIZE];
+      uint8_t *numHeaderEnd;
+      int32_t numHeaderLen = rmf_packNumHeader(frameHeader, (int32_t) sizeof(uint32_t), (uint32_t) (headerLen+payloadLen), self->numHeaderMaxLen);
+      if (numHeaderLen <= 0)
+      {
+         APX_LOG_ERROR("[APX_SRV_CONNECTION] (%p) Message of %d bytes is too long for the header format", (void*) self, (int) (headerLen+payloadLen));
+         return -1;
+      }
+      numHeaderEnd = &frameHeader[numHeaderLen];
+      memcpy(numHeaderEnd, header, headerLen);
+      if (self->debugMode >= APX_DEBUG_4_HIGH)
+      {
+         APX_LOG_DEBUG("[APX_SRV_CONNECTION] (%p) Sending %d+%d+%d bytes (gathered)", (void*)self, (int)(numHeaderEnd-frameHeader), (int)headerLen, (int)payloadLen);
+      }
+      if (isBlocking == false)
+      {
+         return apx_frameAccumulator_tryAppendGather(&self->frameAccumulator, frameHeader, (uint32_t) ((numHeaderEnd-frameHeader)+headerLen), payload, (uint32_t) payloadLen);
+      }
+      return apx_frameAccumulator_appendGather(&self->frameAccumulator, frameHeader, (uint32_t) ((numHeaderEnd-frameHeader)+headerLen), payload, (uint32_t) payloadLen);
+   }
+   return -1;
+}
+
+/**
+ * callback for fileManager, returns the length of the largest message the header format can describe
+ */
+static int32_t apx_serverConnection_getSendAvail(void *arg)
+{
+   apx_serverConnection_t *self = (apx_serverConnection_t*) arg;
+   if (self != 0)
+   {
+      return rmf_getNumHeaderMaxMsgLen(self->numHeaderMaxLen);
+   }
+   return -1;
+}
+
+/**
+ * callback for fileManager when it has no more messages to send for the moment
+ */
+static int32_t apx_serverConnection_flush(void *arg)
+{
+   apx_serverConnection_t *self = (apx_serverConnection_t*) arg;
+   if (self != 0)
+   {
+      return apx_frameAccumulator_flush(&self->frameAccumulator);
+   }
+   return -1;
+}
+
+/**
+ * writes one or more framed messages to the socket, all buffers are written using a single sendmsg call whenever the socket accepts them.
+ */
+static int32_t apx_serverConnection_transmit(void *arg, const apx_frameBuffer_t *buffers, int32_t numBuffers)
+{
+   apx_serverConnection_t *self = (apx_serverConnection_t*) arg;
+   if ( (self != 0) && (buffers != 0) )
+   {
+#if defined(UNIT_TEST) || defined(_MSC_VER)
+      int32_t i;
+#else
+      int32_t i;
+      uint32_t totalLen = 0;
+      uint32_t sentLen = 0;
+#endif
+#if APX_SERVER_REACTOR_ENABLE
+      if (self->reactor != 0)
+      {
+         return apx_serverConnection_transmitNonBlocking(self, buffers, numBuffers);
+      }
+#endif
 #ifdef UNIT_TEST
-		 testsocket_serverSend(self->testsocket, pBegin, msgLen+headerLen);
+      for (i = 0; i < numBuffers; i++)
+      {
+         testsocket_serverSend(self->testsocket, buffers[i].data, buffers[i].dataLen);
+      }
+#elif defined(_MSC_VER)
+      //Winsock has no sendmsg, the buffers are written one at a time
+      for (i = 0; i < numBuffers; i++)
+      {
+         if (msocket_send(self->msocket, buffers[i].data, buffers[i].dataLen) != 0)
+         {
+            return -1;
+         }
+      }
 #else
-		 msocket_send(self->msocket, pBegin, msgLen+headerLen);
+      for (i = 0; i < numBuffers; i++)
+      {
+         totalLen += buffers[i].dataLen;
+      }
+      while (sentLen < totalLen)
+      {
+         ssize_t result = apx_serverConnection_sendmsg(self->msocket->tcpsockfd, buffers, numBuffers, sentLen);
+         if (result < 0)
+         {
+            if (errno == EINTR)
+            {
+               continue;
+            }
+            return -1;
+         }
+         sentLen += (uint32_t) result;
+      }
 #endif
-         return 0;
+      return 0;
+   }
+   return -1;
+}
+
+#if APX_SERVER_REACTOR_ENABLE || (!defined(UNIT_TEST) && !defined(_MSC_VER))
+/**
+ * writes buffers to sockfd in a single sendmsg call, leaving out the first skipLen bytes (already written by an earlier call).
+ * returns the number of bytes written or -1 on error
+ */
+static ssize_t apx_serverConnection_sendmsg(int sockfd, const apx_frameBuffer_t *buffers, int32_t numBuffers, uint32_t skipLen)
+{
+   struct iovec iov[APX_FRAME_ACCUMULATOR_MAX_BUFFERS];
+   struct msghdr msg;
+   int32_t i;
+   int numIov = 0;
+   for (i = 0; (i < numBuffers) && (numIov < APX_FRAME_ACCUMULATOR_MAX_BUFFERS); i++)
+   {
+      if (skipLen >= buffers[i].dataLen)
+      {
+         skipLen -= buffers[i].dataLen;
       }
       else
       {
-         assert(0);
+         iov[numIov].iov_base = (void*) (buffers[i].data + skipLen);
+         iov[numIov].iov_len = (size_t) (buffers[i].dataLen - skipLen);
+         skipLen = 0;
+         numIov++;
       }
    }
-   return -1;
+   if (numIov == 0)
+   {
+      return 0;
+   }
+   memset(&msg, 0, sizeof(msg));
+   msg.msg_iov = &iov[0];
+   msg.msg_iovlen = (size_t) numIov;
+   return sendmsg(sockfd, &msg, MSG_NOSIGNAL);
 }
+#endif
+
+#if APX_SERVER_REACTOR_ENABLE
+/**
+ * Reactor mode transmit, never blocks the calling thread (which may be the reactor thread of another connection).
+ * Data the socket does not accept right away is kept in outputBuffer and written by the reactor once the socket is writable.
+ */
+static int32_t apx_serverConnection_transmitNonBlocking(apx_serverConnection_t *self, const apx_frameBuffer_t *buffers, int32_t numBuffers)
+{
+   int32_t retval = 0;
+   int32_t i;
+   uint32_t dataLen = 0;
+   uint32_t sentLen = 0;
+   for (i = 0; i < numBuffers; i++)
+   {
+      dataLen += buffers[i].dataLen;
+   }
+   MUTEX_LOCK(self->outputLock);
+   if (adt_bytearray_length(&self->outputBuffer) == 0)
+   {
+      //nothing is waiting in front of this data, try to write it directly
+      ssize_t sendLen = apx_serverConnection_sendmsg(apx_serverConnection_getSocketFd(self), buffers, numBuffers, 0);
+      if (sendLen > 0)
+      {
+         sentLen = (uint32_t) sendLen;
+         dataLen -= sentLen;
+      }
+      else if ( (sendLen < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR) )
+      {
+         retval = -1;
+      }
+      else
+      {
+         //MISRA
+      }
+   }
+   if ( (retval == 0) && (dataLen > 0) )
+   {
+      uint32_t pendingLen = adt_bytearray_length(&self->outputBuffer);
+      if ( (pendingLen + dataLen) > APX_SERVER_REACTOR_MAX_OUTPUT_LEN )
+      {
+         APX_LOG_ERROR("[APX_SRV_CONNECTION] (%p) Client is not reading its data, disconnecting", (void*) self);
+         //the reactor sees the hangup and closes the connection from its own thread
+         (void) shutdown(apx_serverConnection_getSocketFd(self), SHUT_RDWR);
+         errno = ENOBUFS;
+         retval = -1;
+      }
+      else
+      {
+         //keep the part of the buffers that was not written
+         for (i = 0; (i < numBuffers) && (retval == 0); i++)
+         {
+            if (sentLen >= buffers[i].dataLen)
+            {
+               sentLen -= buffers[i].dataLen;
+            }
+            else
+            {
+               retval = (int32_t) adt_bytearray_append(&self->outputBuffer, buffers[i].data + sentLen, buffers[i].dataLen - sentLen);
+               sentLen = 0;
+            }
+         }
+         if ( (retval == 0) && (pendingLen == 0) )
+         {
+            apx_serverReactor_setWriteNotify(self->reactor, self, true);
+         }
+      }
+   }
+   MUTEX_UNLOCK(self->outputLock);
+   return retval;
+}
+
+/**
+ * called by fileManager (from any thread) when it has new messages to process
+ */
+static void apx_serverConnection_wakeup(void *arg)
+{
+   apx_serverConnection_t *self = (apx_serverConnection_t*) arg;
+   if (self != 0)
+   {
+      apx_serverReactor_schedule(self->reactor, self);
+   }
+}
+
+/**
+ * called by frameAccumulator when its pending data must be flushed delayMs milliseconds from now
+ */
+static void apx_serverConnection_flushDeadline(void *arg, uint32_t delayMs)
+{
+   apx_serverConnection_t *self = (apx_serverConnection_t*) arg;
+   if (self != 0)
+   {
+      apx_serverReactor_scheduleFlush(self->reactor, self, delayMs);
+   }
+}
+#endif
@@ -0,0 +1,548 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include "apx_serverReactor.h"
+#if APX_SERVER_REACTOR_ENABLE
+#include <errno.h>
+#include <malloc.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#ifdef UNIT_TEST
+#include "apx_testServer.h"
+#else
+#include "apx_server.h"
+#endif
+#include "apx_logging.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#define REACTOR_READ_EVENTS (EPOLLIN | EPOLLRDHUP)
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static THREAD_PROTO(threadTask,arg);
+static void apx_serverReactor_wakeup(apx_serverReactor_t *self);
+static void apx_serverReactor_readConnection(apx_serverReactor_t *self, apx_serverConnection_t *connection);
+static void apx_serverReactor_closeConnection(apx_serverReactor_t *self, apx_serverConnection_t *connection);
+static void apx_serverReactor_processPending(apx_serverReactor_t *self);
+static int apx_serverReactor_getFlushTimeout(apx_serverReactor_t *self);
+static void apx_serverReactor_processFlushTimers(apx_serverReactor_t *self);
+static void apx_serverReactor_removeConnection(adt_ary_t *connections, apx_serverConnection_t *connection);
+static uint32_t apx_serverReactor_getTimeMs(void);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+#ifdef UNIT_TEST
+int8_t apx_serverReactor_create(apx_serverReactor_t *self, struct apx_testServer_tag *server)
+#else
+int8_t apx_serverReactor_create(apx_serverReactor_t *self, struct apx_server_tag *server)
+#endif
+{
+   if (self != 0)
+   {
+      struct epoll_event event;
+      self->workerThread = 0;
+      self->workerThreadValid = false;
+      self->isRunning = false;
+      self->numConnections = 0;
+      self->server = server;
+      self->readBuf = (uint8_t*) malloc(APX_SERVER_REACTOR_READ_SIZE);
+      if (self->readBuf == 0)
+      {
+         errno = ENOMEM;
+         return -1;
+      }
+      self->epollFd = epoll_create1(EPOLL_CLOEXEC);
+      if (self->epollFd < 0)
+      {
+         free(self->readBuf);
+         return -1;
+      }
+      self->eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if (self->eventFd < 0)
+      {
+         close(self->epollFd);
+         free(self->readBuf);
+         return -1;
+      }
+      //the eventFd is registered using a null pointer, all other registered pointers are apx_serverConnection_t
+      memset(&event, 0, sizeof(event));
+      event.events = EPOLLIN;
+      event.data.ptr = (void*) 0;
+      if (epoll_ctl(self->epollFd, EPOLL_CTL_ADD, self->eventFd, &event) != 0)
+      {
+         close(self->eventFd);
+         close(self->epollFd);
+         free(self->readBuf);
+         return -1;
+      }
+      SPINLOCK_INIT(self->lock);
+      adt_ary_create(&self->pendingConnections, (void(*)(void*)) 0);
+      adt_ary_create(&self->flushConnections, (void(*)(void*)) 0);
+      return 0;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+void apx_serverReactor_destroy(apx_serverReactor_t *self)
+{
+   if (self != 0)
+   {
+      apx_serverReactor_stop(self);
+      adt_ary_destroy(&self->pendingConnections);
+      adt_ary_destroy(&self->flushConnections);
+      SPINLOCK_DESTROY(self->lock);
+      close(self->eventFd);
+      close(self->epollFd);
+      free(self->readBuf);
+   }
+}
+
+int8_t apx_serverReactor_start(apx_serverReactor_t *self)
+{
+   if( (self != 0) && (self->workerThreadValid == false) )
+   {
+      int rc;
+      self->isRunning = true;
+      self->workerThreadValid = true;
+      rc = THREAD_CREATE(self->workerThread,threadTask,self);
+      if(rc != 0)
+      {
+         self->isRunning = false;
+         self->workerThreadValid = false;
+         return -1;
+      }
+      return 0;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+void apx_serverReactor_stop(apx_serverReactor_t *self)
+{
+   if ( (self != 0) && (self->workerThreadValid == true) )
+   {
+      SPINLOCK_ENTER(self->lock);
+      self->isRunning = false;
+      SPINLOCK_LEAVE(self->lock);
+      apx_serverReactor_wakeup(self);
+      if (pthread_equal(pthread_self(), self->workerThread) == 0)
+      {
+         void *status;
+         int s = pthread_join(self->workerThread, &status);
+         if (s != 0)
+         {
+            APX_LOG_ERROR("[APX_SERVER_REACTOR] pthread_join error %d\n", s);
+         }
+      }
+      else
+      {
+         APX_LOG_ERROR("[APX_SERVER_REACTOR] pthread_join attempted on pthread_self()\n");
+      }
+      self->workerThreadValid = false;
+   }
+}
+
+/**
+ * Hands over the IO of connection to this reactor. From this point forward the connection is only read from the reactor worker thread.
+ * The socket is switched to non-blocking mode, no thread ever waits for a slow client.
+ * apx_serverConnection_setReactor and apx_serverConnection_start must have been called before this function.
+ */
+int8_t apx_serverReactor_attachConnection(apx_serverReactor_t *self, apx_serverConnection_t *connection)
+{
+   if ( (self != 0) && (connection != 0) )
+   {
+      struct epoll_event event;
+      int sockfd = apx_serverConnection_getSocketFd(connection);
+      int flags = fcntl(sockfd, F_GETFL, 0);
+      if ( (flags < 0) || (fcntl(sockfd, F_SETFL, flags | O_NONBLOCK) < 0) )
+      {
+         return -1;
+      }
+      memset(&event, 0, sizeof(event));
+      //EPOLLOUT picks up output buffered before the connection was attached, it's removed again on the first call to apx_serverConnection_writeOutput
+      event.events = REACTOR_READ_EVENTS | EPOLLOUT;
+      event.data.ptr = (void*) connection;
+      SPINLOCK_ENTER(self->lock);
+      self->numConnections++;
+      SPINLOCK_LEAVE(self->lock);
+      if (epoll_ctl(self->epollFd, EPOLL_CTL_ADD, sockfd, &event) != 0)
+      {
+         SPINLOCK_ENTER(self->lock);
+         self->numConnections--;
+         SPINLOCK_LEAVE(self->lock);
+         return -1;
+      }
+      return 0;
+   }
+   errno = EINVAL;
+   return -1;
+}
+
+/**
+ * Requests the reactor worker thread to process the queued fileManager messages of connection.
+ * Can be called from any thread.
+ */
+void apx_serverReactor_schedule(apx_serverReactor_t *self, apx_serverConnection_t *connection)
+{
+   if ( (self != 0) && (connection != 0) )
+   {
+      bool wakeupNeeded = false;
+      SPINLOCK_ENTER(self->lock);
+      if (connection->isScheduled == false)
+      {
+         connection->isScheduled = true;
+         adt_ary_push(&self->pendingConnections, connection);
+         //the worker thread always checks its pending list before it goes back to epoll_wait
+         wakeupNeeded = (pthread_equal(pthread_self(), self->workerThread) == 0);
+      }
+      SPINLOCK_LEAVE(self->lock);
+      if (wakeupNeeded == true)
+      {
+         apx_serverReactor_wakeup(self);
+      }
+   }
+}
+
+/**
+ * Makes the reactor worker thread call apx_frameAccumulator_flushExpired for connection delayMs milliseconds from now.
+ * Can be called from any thread.
+ */
+void apx_serverReactor_scheduleFlush(apx_serverReactor_t *self, apx_serverConnection_t *connection, uint32_t delayMs)
+{
+   if ( (self != 0) && (connection != 0) )
+   {
+      bool wakeupNeeded = false;
+      uint32_t deadline = apx_serverReactor_getTimeMs() + delayMs;
+      SPINLOCK_ENTER(self->lock);
+      if (connection->isFlushScheduled == false)
+      {
+         connection->isFlushScheduled = true;
+         connection->flushDeadline = deadline;
+         adt_ary_push(&self->flushConnections, connection);
+         //the worker thread recalculates its epoll_wait timeout before it goes back to sleep
+         wakeupNeeded = (pthread_equal(pthread_self(), self->workerThread) == 0);
+      }
+      else if ( (int32_t) (deadline - connection->flushDeadline) < 0 )
+      {
+         connection->flushDeadline = deadline;
+         wakeupNeeded = (pthread_equal(pthread_self(), self->workerThread) == 0);
+      }
+      else
+      {
+         //MISRA
+      }
+      SPINLOCK_LEAVE(self->lock);
+      if (wakeupNeeded == true)
+      {
+         apx_serverReactor_wakeup(self);
+      }
+   }
+}
+
+/**
+ * Enables or disables writability notifications for connection. Called by the connection while holding its outputLock.
+ * Can be called from any thread.
+ */
+void apx_serverReactor_setWriteNotify(apx_serverReactor_t *self, apx_serverConnection_t *connection, bool enable)
+{
+   if ( (self != 0) && (connection != 0) )
+   {
+      struct epoll_event event;
+      memset(&event, 0, sizeof(event));
+      event.events = (enable == true)? (REACTOR_READ_EVENTS | EPOLLOUT) : REACTOR_READ_EVENTS;
+      event.data.ptr = (void*) connection;
+      //ENOENT before the connection is attached is harmless, attachConnection always starts out with EPOLLOUT enabled
+      (void) epoll_ctl(self->epollFd, EPOLL_CTL_MOD, apx_serverConnection_getSocketFd(connection), &event);
+   }
+}
+
+uint32_t apx_serverReactor_getNumConnections(apx_serverReactor_t *self)
+{
+   uint32_t retval = 0;
+   if (self != 0)
+   {
+      SPINLOCK_ENTER(self->lock);
+      retval = self->numConnections;
+      SPINLOCK_LEAVE(self->lock);
+   }
+   return retval;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+static THREAD_PROTO(threadTask,arg)
+{
+   if (arg != 0)
+   {
+      struct epoll_event events[APX_SERVER_REACTOR_MAX_EVENTS];
+      apx_serverReactor_t *self = (apx_serverReactor_t*) arg;
+      bool isRunning = true;
+      while (isRunning == true)
+      {
+         int i;
+         int numEvents = epoll_wait(self->epollFd, &events[0], APX_SERVER_REACTOR_MAX_EVENTS, apx_serverReactor_getFlushTimeout(self));
+         if (numEvents < 0)
+         {
+            if (errno == EINTR)
+            {
+               continue;
+            }
+            APX_LOG_ERROR("[APX_SERVER_REACTOR] epoll_wait failed, errno=%d", errno);
+            break;
+         }
+         for (i = 0; i < numEvents; i++)
+         {
+            apx_serverConnection_t *connection = (apx_serverConnection_t*) events[i].data.ptr;
+            if (connection == 0)
+            {
+               uint64_t counter;
+               //reset the eventfd counter, the actual work is found in pendingConnections
+               if (read(self->eventFd, &counter, sizeof(counter)) < 0)
+               {
+                  //EAGAIN, counter was already reset
+               }
+            }
+            else
+            {
+               if ( ( (events[i].events & EPOLLOUT) != 0 ) && (apx_serverConnection_writeOutput(connection) != 0) )
+               {
+                  apx_serverReactor_closeConnection(self, connection);
+                  continue;
+               }
+               if ( (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0 )
+               {
+                  apx_serverReactor_readConnection(self, connection);
+               }
+            }
+         }
+         apx_serverReactor_processPending(self);
+         apx_serverReactor_processFlushTimers(self);
+         SPINLOCK_ENTER(self->lock);
+         isRunning = self->isRunning;
+         SPINLOCK_LEAVE(self->lock);
+      }
+   }
+   THREAD_RETURN(0);
+}
+
+static void apx_serverReactor_wakeup(apx_serverReactor_t *self)
+{
+   uint64_t value = 1;
+   if (write(self->eventFd, &value, sizeof(value)) < 0)
+   {
+      //EAGAIN means the counter is already non-zero, worker thread will wake up anyway
+   }
+}
+
+/**
+ * reads available data from the connection socket and parses all complete messages in it.
+ */
+static void apx_serverReactor_readConnection(apx_serverReactor_t *self, apx_serverConnection_t *connection)
+{
+   ssize_t readLen = recv(apx_serverConnection_getSocketFd(connection), self->readBuf, APX_SERVER_REACTOR_READ_SIZE, 0);
+   if (readLen > 0)
+   {
+      int8_t result;
+      uint32_t parseLen = 0;
+      adt_bytearray_t *receiveBuffer = &connection->receiveBuffer;
+      if (adt_bytearray_length(receiveBuffer) == 0)
+      {
+         //fast path, no partial message from earlier reads
+         result = apx_serverConnection_dataReceived(connection, self->readBuf, (uint32_t) readLen, &parseLen);
+         if ( (result == 0) && (parseLen < (uint32_t) readLen) )
+         {
+            adt_bytearray_append(receiveBuffer, self->readBuf + parseLen, (uint32_t) readLen - parseLen);
+         }
+      }
+      else
+      {
+         const uint8_t *pBegin;
+         adt_bytearray_append(receiveBuffer, self->readBuf, (uint32_t) readLen);
+         pBegin = adt_bytearray_data(receiveBuffer);
+         result = apx_serverConnection_dataReceived(connection, pBegin, adt_bytearray_length(receiveBuffer), &parseLen);
+         if ( (result == 0) && (parseLen > 0) )
+         {
+            adt_bytearray_trimLeft(receiveBuffer, pBegin + parseLen);
+         }
+      }
+      if (result != 0)
+      {
+         apx_serverReactor_closeConnection(self, connection);
+      }
+   }
+   else if (readLen == 0)
+   {
+      apx_serverReactor_closeConnection(self, connection);
+   }
+   else if ( (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR) )
+   {
+      apx_serverReactor_closeConnection(self, connection);
+   }
+   else
+   {
+      //MISRA
+   }
+}
+
+static void apx_serverReactor_closeConnection(apx_serverReactor_t *self, apx_serverConnection_t *connection)
+{
+   epoll_ctl(self->epollFd, EPOLL_CTL_DEL, apx_serverConnection_getSocketFd(connection), (struct epoll_event*) 0);
+   //stop other connections from routing data into this connection before it's removed from the pending list
+#ifdef UNIT_TEST
+   apx_testServer_detachConnection(self->server, connection);
+#else
+   apx_server_detachConnection(self->server, connection);
+#endif
+   SPINLOCK_ENTER(self->lock);
+   if (connection->isScheduled == true)
+   {
+      apx_serverReactor_removeConnection(&self->pendingConnections, connection);
+      connection->isScheduled = false;
+   }
+   if (connection->isFlushScheduled == true)
+   {
+      apx_serverReactor_removeConnection(&self->flushConnections, connection);
+      connection->isFlushScheduled = false;
+   }
+   self->numConnections--;
+   SPINLOCK_LEAVE(self->lock);
+   APX_LOG_INFO("[APX_SERVER_REACTOR] Client (%p) disconnected", (void*)connection);
+   apx_serverConnection_delete(connection);
+}
+
+/**
+ * runs the fileManager message handlers of all scheduled connections
+ */
+static void apx_serverReactor_processPending(apx_serverReactor_t *self)
+{
+   for(;;)
+   {
+      apx_serverConnection_t *connection = (apx_serverConnection_t*) 0;
+      SPINLOCK_ENTER(self->lock);
+      if (adt_ary_length(&self->pendingConnections) > 0)
+      {
+         connection = (apx_serverConnection_t*) *adt_ary_shift(&self->pendingConnections);
+         connection->isScheduled = false;
+      }
+      SPINLOCK_LEAVE(self->lock);
+      if (connection == 0)
+      {
+         break;
+      }
+      apx_fileManager_processMessages(&connection->fileManager);
+   }
+}
+
+/**
+ * returns the number of milliseconds until the earliest flush deadline, -1 (wait forever) when there is none
+ */
+static int apx_serverReactor_getFlushTimeout(apx_serverReactor_t *self)
+{
+   int timeout = -1;
+   int32_t i;
+   int32_t end;
+   uint32_t now = apx_serverReactor_getTimeMs();
+   SPINLOCK_ENTER(self->lock);
+   end = adt_ary_length(&self->flushConnections);
+   for (i = 0; i < end; i++)
+   {
+      apx_serverConnection_t *connection = (apx_serverConnection_t*) adt_ary_value(&self->flushConnections, i);
+      int32_t remain = (int32_t) (connection->flushDeadline - now);
+      if (remain < 0)
+      {
+         remain = 0;
+      }
+      if ( (timeout < 0) || (remain < timeout) )
+      {
+         timeout = (int) remain;
+      }
+   }
+   SPINLOCK_LEAVE(self->lock);
+   return timeout;
+}
+
+/**
+ * flushes the frameAccumulator of each connection whose deadline has passed
+ */
+static void apx_serverReactor_processFlushTimers(apx_serverReactor_t *self)
+{
+   for(;;)
+   {
+      int32_t i;
+      int32_t end;
+      uint32_t now = apx_serverReactor_getTimeMs();
+      apx_serverConnection_t *connection = (apx_serverConnection_t*) 0;
+      SPINLOCK_ENTER(self->lock);
+      end = adt_ary_length(&self->flushConnections);
+      for (i = 0; i < end; i++)
+      {
+         apx_serverConnection_t *candidate = (apx_serverConnection_t*) adt_ary_value(&self->flushConnections, i);
+         if ( (int32_t) (candidate->flushDeadline - now) <= 0 )
+         {
+            adt_ary_splice(&self->flushConnections, i, 1);
+            candidate->isFlushScheduled = false;
+            connection = candidate;
+            break;
+         }
+      }
+      SPINLOCK_LEAVE(self->lock);
+      if (connection == 0)
+      {
+         break;
+      }
+      //reschedules itself through apx_serverConnection_flushDeadline when the pending data is not yet due
+      (void) apx_frameAccumulator_flushExpired(&connection->frameAccumulator);
+   }
+}
+
+/**
+ * must be called while holding self->lock
+ */
+static void apx_serverReactor_removeConnection(adt_ary_t *connections, apx_serverConnection_t *connection)
+{
+   int32_t i;
+   int32_t end = adt_ary_length(connections);
+   for (i = 0; i < end; i++)
+   {
+      if (adt_ary_value(connections, i) == (void*) connection)
+      {
+         adt_ary_splice(connections, i, 1);
+         break;
+      }
+   }
+}
+
+static uint32_t apx_serverReactor_getTimeMs(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint32_t) ( (ts.tv_sec * 1000u) + (ts.tv_nsec / 1000000u) );
+}
+
+#endif //APX_SERVER_REACTOR_ENABLE
@@ -2,6 +2,10 @@
 // INCLUDES
 //////////////////////////////////////////////////////////////////////////////
 #include "apx_testServer.h"
+#if APX_SERVER_REACTOR_ENABLE
+#include <errno.h>
+#include <sys/socket.h>
+#endif
 #ifdef MEM_LEAK_CHECK
 #include "CMemLeak.h"
 #endif
@@ -31,6 +35,11 @@ void apx_testServer_create(apx_testServer_t *self)
    if(self != 0)
    {
       self->clientConnection = 0;
+      self->isDirectDispatchEnabled = false;
+#if APX_SERVER_REACTOR_ENABLE
+      self->reactor = (apx_serverReactor_t*) 0;
+#endif
+      MUTEX_INIT(self->mutex);
       apx_nodeManager_create(&self->nodeManager);
       apx_router_create(&self->router);
       apx_nodeManager_setRouter(&self->nodeManager, &self->router);
@@ -42,9 +51,21 @@ void apx_testServer_destroy(apx_testServer_t *self)
 {
    if (self != 0)
    {
+#if APX_SERVER_REACTOR_ENABLE
+      //the reactor thread must be stopped before the connections it owns are deleted
+      apx_serverReactor_stop(self->reactor);
+#endif
       adt_list_destroy(&self->connections);
       apx_nodeManager_destroy(&self->nodeManager);
       apx_router_destroy(&self->router);
+#if APX_SERVER_REACTOR_ENABLE
+      if (self->reactor != 0)
+      {
+         apx_serverReactor_destroy(self->reactor);
+         free(self->reactor);
+      }
+#endif
+      MUTEX_DESTROY(self->mutex);
    }
 }
 
@@ -56,16 +77,140 @@ void apx_testServer_accept(apx_testServer_t *self, testsocket_t *socket)
       if (newConnection != 0)
       {
          msocket_handler_t handlerTable;
+         MUTEX_LOCK(self->mutex);
          adt_list_insert(&self->connections,newConnection);
+         MUTEX_UNLOCK(self->mutex);
          memset(&handlerTable,0,sizeof(handlerTable));
          handlerTable.tcp_data = apx_testServer_data;
          handlerTable.tcp_disconnected = apx_testServer_disconnected;
          testsocket_setServerHandler(socket, &handlerTable, newConnection);
+         apx_fileManager_setDirectDispatch(&newConnection->fileManager, self->isDirectDispatchEnabled);
          apx_serverConnection_start(newConnection);
       }
    }
 }
 
+void apx_testServer_setDirectDispatch(apx_testServer_t *self, bool enable)
+{
+   if (self != 0)
+   {
+      self->isDirectDispatchEnabled = enable;
+   }
+}
+
+/**
+ * handles a lost connection the same way apx_server does: the connection is detached from the nodeManager and deleted (along with socket)
+ */
+void apx_testServer_closeConnection(apx_testServer_t *self, testsocket_t *socket)
+{
+   if ( (self != 0) && (socket != 0) )
+   {
+      adt_list_elem_t *pIter;
+      apx_serverConnection_t *connection = (apx_serverConnection_t*) 0;
+      adt_list_iter_init(&self->connections);
+      do
+      {
+         pIter = adt_list_iter_next(&self->connections);
+         if ( (pIter != 0) && (((apx_serverConnection_t*) pIter->pItem)->testsocket == socket) )
+         {
+            connection = (apx_serverConnection_t*) pIter->pItem;
+         }
+      } while( (pIter != 0) && (connection == 0) );
+      if (connection != 0)
+      {
+         apx_testServer_detachConnection(self, connection);
+         apx_serverConnection_delete(connection);
+      }
+   }
+}
+
+/**
+ * removes connection from the server without deleting it, see apx_server_detachConnection
+ */
+void apx_testServer_detachConnection(apx_testServer_t *self, apx_serverConnection_t *connection)
+{
+   if ( (self != 0) && (connection != 0) )
+   {
+      MUTEX_LOCK(self->mutex);
+      adt_list_remove(&self->connections, connection);
+      apx_nodeManager_detachFileManager(&self->nodeManager, &connection->fileManager);
+      MUTEX_UNLOCK(self->mutex);
+   }
+}
+
+#if APX_SERVER_REACTOR_ENABLE
+/**
+ * Connections accepted by apx_testServer_acceptReactor are served by a reactor thread, the same way as in apx_server.
+ * The test server has at most one reactor, it's started by the first call with numReactors > 0.
+ */
+void apx_testServer_setNumReactors(apx_testServer_t *self, int32_t numReactors)
+{
+   if ( (self != 0) && (numReactors > 0) && (self->reactor == 0) )
+   {
+      self->reactor = (apx_serverReactor_t*) malloc(sizeof(apx_serverReactor_t));
+      if (self->reactor != 0)
+      {
+         if (apx_serverReactor_create(self->reactor, self) != 0)
+         {
+            free(self->reactor);
+            self->reactor = (apx_serverReactor_t*) 0;
+         }
+         else if (apx_serverReactor_start(self->reactor) != 0)
+         {
+            apx_serverReactor_destroy(self->reactor);
+            free(self->reactor);
+            self->reactor = (apx_serverReactor_t*) 0;
+         }
+         else
+         {
+            //MISRA
+         }
+      }
+   }
+}
+
+/**
+ * Accepts a new connection in reactor mode. Instead of going through socket, the connection reads and writes one end of a socketpair.
+ * returns the other end of the socketpair (owned by the caller) or -1 on failure.
+ */
+int apx_testServer_acceptReactor(apx_testServer_t *self, testsocket_t *socket)
+{
+   if ( (self != 0) && (self->reactor != 0) && (socket != 0) )
+   {
+      int sockets[2];
+      apx_serverConnection_t *newConnection;
+      if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0)
+      {
+         return -1;
+      }
+      newConnection = apx_serverConnection_new(socket, self);
+      if (newConnection == 0)
+      {
+         close(sockets[0]);
+         close(sockets[1]);
+         return -1;
+      }
+      newConnection->sockfd = sockets[0];
+      MUTEX_LOCK(self->mutex);
+      adt_list_insert(&self->connections,newConnection);
+      MUTEX_UNLOCK(self->mutex);
+      apx_fileManager_setDirectDispatch(&newConnection->fileManager, self->isDirectDispatchEnabled);
+      apx_serverConnection_setReactor(newConnection, self->reactor);
+      apx_serverConnection_start(newConnection);
+      if (apx_serverReactor_attachConnection(self->reactor, newConnection) != 0)
+      {
+         apx_testServer_detachConnection(self, newConnection);
+         apx_serverConnection_delete(newConnection);
+         close(sockets[1]);
+         return -1;
+      }
+      return sockets[1];
+   }
+   errno = EINVAL;
+   return -1;
+}
+#endif
+
 //////////////////////////////////////////////////////////////////////////////
 // LOCAL FUNCTIONS
 //////////////////////////////////////////////////////////////////////////////
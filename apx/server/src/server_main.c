@@ -34,6 +34,13 @@ int8_t g_debug; // Global so apx_logging can use it from everywhere
 // LOCAL VARIABLES
 //////////////////////////////////////////////////////////////////////////////
 static uint16_t m_port;
+static int32_t m_numReactors;
+static int32_t m_numDefinitionWorkers;
+static bool m_conflate;
+static bool m_direct;
+static bool m_shm;
+static uint32_t m_gracePeriodMs;
+static const char *m_socketPath;
 static apx_server_t m_server;
 static int32_t m_count;
 static const char *SW_VERSION_STR = SW_VERSION_LITERAL;
@@ -50,6 +57,13 @@ int main(int argc, char **argv)
    m_count = 0;
    g_debug = 0;
    m_port = DEFAULT_PORT;
+   m_numReactors = APX_SERVER_REACTORS_NONE;
+   m_numDefinitionWorkers = APX_SERVER_DEFINITION_WORKERS_NONE;
+   m_conflate = false;
+   m_direct = false;
+   m_shm = false;
+   m_gracePeriodMs = 0;
+   m_socketPath = (const char*) 0;
    printf("APX Server %s\n", SW_VERSION_STR);
    if(argc>1)
    {
@@ -76,10 +90,21 @@ int main(int argc, char **argv)
 #endif
    apx_server_create(&m_server,m_port);
    apx_server_setDebugMode(&m_server, g_debug);
+   apx_server_setNumReactors(&m_server, m_numReactors);
+   apx_server_setNumDefinitionWorkers(&m_server, m_numDefinitionWorkers);
+   apx_server_setConflation(&m_server, m_conflate);
+   apx_server_setDirectDispatch(&m_server, m_direct);
+   apx_server_setLocalSocket(&m_server, m_socketPath);
+   apx_server_setSharedMemory(&m_server, m_shm);
+   apx_server_setGracePeriod(&m_server, m_gracePeriodMs);
    apx_server_start(&m_server);
    for(;;)
    {
       SLEEP(5000); //main thread is sleeping while child threads do all the work
+      if (m_gracePeriodMs > 0)
+      {
+         apx_server_expireStaleNodes(&m_server);
+      }
 /*    if (++m_count==20) //this counter is used during testing to verify that all resources are properly cleaned up
       {
          break;
@@ -139,6 +164,60 @@ static int parse_args(int argc, char **argv)
             }
          }
       }
+      else if (strcmp(argv[i], "--reactors=auto") == 0)
+      {
+         m_numReactors = APX_SERVER_REACTORS_AUTO;
+      }
+      else if (strncmp(argv[i], "--reactors=", 11) == 0)
+      {
+         char *endptr=0;
+         long num = strtol(&argv[i][11],&endptr,10);
+         if ( (endptr > &argv[i][11]) && (num >= 0) )
+         {
+            m_numReactors=(int32_t) num;
+         }
+      }
+      else if (strcmp(argv[i], "--definition-workers=auto") == 0)
+      {
+         m_numDefinitionWorkers = APX_SERVER_DEFINITION_WORKERS_AUTO;
+      }
+      else if (strncmp(argv[i], "--definition-workers=", 21) == 0)
+      {
+         char *endptr=0;
+         long num = strtol(&argv[i][21],&endptr,10);
+         if ( (endptr > &argv[i][21]) && (num >= 0) )
+         {
+            m_numDefinitionWorkers=(int32_t) num;
+         }
+      }
+      else if (strcmp(argv[i], "--conflate") == 0)
+      {
+         m_conflate = true;
+      }
+      else if (strcmp(argv[i], "--direct") == 0)
+      {
+         m_direct = true;
+      }
+      else if (strcmp(argv[i], "--shm") == 0)
+      {
+         m_shm = true;
+      }
+      else if (strncmp(argv[i], "--grace=", 8) == 0)
+      {
+         char *endptr=0;
+         long num = strtol(&argv[i][8],&endptr,10);
+         if ( (endptr > &argv[i][8]) && (num >= 0) )
+         {
+            m_gracePeriodMs=(uint32_t) num;
+         }
+      }
+      else if (strncmp(argv[i], "--socket=", 9) == 0)
+      {
+         if (argv[i][9] != '\0')
+         {
+            m_socketPath = &argv[i][9];
+         }
+      }
       else
       {
          printf("Unknown argument %s\n", argv[i]);
@@ -151,7 +230,7 @@ static int parse_args(int argc, char **argv)
 
 static void printUsage(char *name)
 {   
-   printf("%s -p<port> [--debug=<level 1-4>]\n",name);
+   printf("%s -p<port> [--debug=<level 1-4>] [--reactors=<count or auto, 0 (default) for thread per connection>] [--definition-workers=<count or auto, 0 (default)>] [--conflate] [--direct] [--socket=<path>] [--shm] [--grace=<milliseconds>]\n",name);
 }
 
 
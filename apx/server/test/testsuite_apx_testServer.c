@@ -6,15 +6,24 @@
 #include <stdio.h>
 #include <stddef.h>
 #include <string.h>
+#include <time.h>
 #include "CuTest.h"
 #include "apx_testServer.h"
 #include "rmf.h"
+#include "sha256.h"
 #ifdef _WIN32
 #include <Windows.h>
 #else
 #include <unistd.h>
+#include <pthread.h>
 #endif
 #include "osmacro.h"
+#include "apx_rcu.h"
+#include "apx_atomic.h"
+#if APX_SERVER_REACTOR_ENABLE
+#include <errno.h>
+#include <sys/socket.h>
+#endif
 #ifdef MEM_LEAK_CHECK
 #include "CMemLeak.h"
 #endif
@@ -23,12 +32,62 @@
 //////////////////////////////////////////////////////////////////////////////
 // CONSTANTS AND DATA TYPES
 //////////////////////////////////////////////////////////////////////////////
+typedef struct providerWriteArg_tag
+{
+   testsocket_t *provider;
+   const uint8_t *value;
+   int32_t valueLen;
+   volatile int32_t isDone;
+}providerWriteArg_t;
 
 //////////////////////////////////////////////////////////////////////////////
 // LOCAL FUNCTION PROTOTYPES
 //////////////////////////////////////////////////////////////////////////////
 static void test_apx_testServer_create(CuTest* tc);
 static void test_apx_testServer_greeting(CuTest* tc);
+static void test_apx_testServer_multiWriteGreeting(CuTest* tc);
+static void test_apx_testServer_numHeaderFormat16(CuTest* tc);
+static void test_apx_testServer_streamLargeDataMessage(CuTest* tc);
+static void test_apx_testServer_directDispatch(CuTest* tc);
+static void test_apx_testServer_routedWrite(CuTest* tc);
+static void test_apx_testServer_fragmentedWrite(CuTest* tc);
+static void test_apx_testServer_interleavedFragmentedWrites(CuTest* tc);
+static void test_apx_testServer_writeDuringFragmentedTransfer(CuTest* tc);
+static void test_apx_testServer_resumeSendsOnlyDelta(CuTest* tc);
+static void test_apx_testServer_resumeRoutesChangedValuesPerRange(CuTest* tc);
+static void test_apx_testServer_resumeWithChangedDefinition(CuTest* tc);
+static void test_apx_testServer_parkedNodeExpires(CuTest* tc);
+static void test_apx_testServer_batchedWrites(CuTest* tc);
+#ifndef _WIN32
+static void test_apx_testServer_backpressuredRouteOutsideReadSection(CuTest* tc);
+static void test_apx_testServer_directDispatchToSlowReader(CuTest* tc);
+static void *providerWriteTask(void *arg);
+#endif
+#if APX_SERVER_REACTOR_ENABLE
+static void test_apx_testServer_reactorBuffersOutputOfSlowReader(CuTest* tc);
+static void test_apx_testServer_reactorDisconnectsSlowReader(CuTest* tc);
+static void test_apx_testServer_reactorFlushTimer(CuTest* tc);
+static int reactorConnectRequester(CuTest* tc, apx_testServer_t *server, testsocket_t *socket, const char *definition, const char *nodeName, rmf_fileInfo_t *inDataFileInfo);
+static void reactorClientRun(testsocket_t *socket, int sockfd);
+static int32_t reactorClientReceive(adt_bytearray_t *received, int sockfd);
+static uint32_t reactorGetOutputLen(apx_serverConnection_t *connection);
+#endif
+static void clientSendMessage(testsocket_t *socket, uint32_t address, const uint8_t *data, int32_t dataLen, bool more_bit);
+static void clientSendGreeting(testsocket_t *socket);
+static void clientSendMultiWriteGreeting(testsocket_t *socket);
+static void clientSendFileInfo(testsocket_t *socket, const char *name, uint32_t address, uint32_t length, const uint8_t *digest);
+static void clientSendFileOpen(testsocket_t *socket, uint32_t address);
+static void clientAddNode(testsocket_t *socket, const char *definition, const char *nodeName, uint32_t definitionAddress, uint32_t outAddress, uint32_t outPortDataLen);
+static void clientOpenInPortDataFile(CuTest* tc, testsocket_t *socket, const char *name, rmf_fileInfo_t *fileInfo);
+static bool clientNextMessage(testsocket_t *socket, int32_t *pos, rmf_msg_t *msg);
+static bool clientFindFileInfo(testsocket_t *socket, const char *name, rmf_fileInfo_t *fileInfo);
+static bool clientFindFileOpen(testsocket_t *socket, uint32_t address);
+static const uint8_t *clientFindWrite(testsocket_t *socket, uint32_t address, int32_t *dataLen);
+static int32_t clientApplyWrites(testsocket_t *socket, const rmf_fileInfo_t *fileInfo, uint8_t *fileData);
+static uint32_t routedWriteLatency(CuTest* tc, bool isDirectDispatchEnabled);
+static uint32_t getTimeUs(void);
+static apx_serverConnection_t *getConnection(apx_testServer_t *server, testsocket_t *socket);
+static void externalWakeup(void *arg);
 
 //////////////////////////////////////////////////////////////////////////////
 // GLOBAL VARIABLES
@@ -37,6 +96,103 @@ static void test_apx_testServer_greeting(CuTest* tc);
 //////////////////////////////////////////////////////////////////////////////
 // LOCAL VARIABLES
 //////////////////////////////////////////////////////////////////////////////
+#define DEFINITION_ADDRESS 0x4000000
+#define BATCH_NUM_PORTS 16
+
+static const char *m_providerDefinition = "APX/1.2\n"
+      "N\"Provider\"\n"
+      "P\"VehicleSpeed\"S\n"
+      "\n";
+
+static const char *m_requesterDefinition = "APX/1.2\n"
+      "N\"Requester\"\n"
+      "R\"VehicleSpeed\"S\n"
+      "\n";
+
+static const char *m_providerADefinition = "APX/1.2\n"
+      "N\"ProviderA\"\n"
+      "P\"SpeedA\"S\n"
+      "P\"RpmA\"S\n"
+      "\n";
+
+static const char *m_providerBDefinition = "APX/1.2\n"
+      "N\"ProviderB\"\n"
+      "P\"SpeedB\"S\n"
+      "P\"RpmB\"S\n"
+      "\n";
+
+static const char *m_resumeRequesterDefinition = "APX/1.2\n"
+      "N\"ResumeRequester\"\n"
+      "R\"SpeedA\"S\n"
+      "R\"RpmA\"S\n"
+      "\n";
+
+static const char *m_changedResumeRequesterDefinition = "APX/1.2\n"
+      "N\"ResumeRequester\"\n"
+      "R\"SpeedA\"S\n"
+      "R\"RpmA\"S\n"
+      "R\"SpeedB\"S\n"
+      "\n";
+
+static const char *m_batchProviderDefinition = "APX/1.2\n"
+      "N\"BatchProvider\"\n"
+      "P\"Value0\"S\n"
+      "P\"Value1\"S\n"
+      "P\"Value2\"S\n"
+      "P\"Value3\"S\n"
+      "P\"Value4\"S\n"
+      "P\"Value5\"S\n"
+      "P\"Value6\"S\n"
+      "P\"Value7\"S\n"
+      "P\"Value8\"S\n"
+      "P\"Value9\"S\n"
+      "P\"Value10\"S\n"
+      "P\"Value11\"S\n"
+      "P\"Value12\"S\n"
+      "P\"Value13\"S\n"
+      "P\"Value14\"S\n"
+      "P\"Value15\"S\n"
+      "\n";
+
+static const char *m_batchRequesterDefinition = "APX/1.2\n"
+      "N\"BatchRequester\"\n"
+      "R\"Value0\"S\n"
+      "R\"Value1\"S\n"
+      "R\"Value2\"S\n"
+      "R\"Value3\"S\n"
+      "R\"Value4\"S\n"
+      "R\"Value5\"S\n"
+      "R\"Value6\"S\n"
+      "R\"Value7\"S\n"
+      "R\"Value8\"S\n"
+      "R\"Value9\"S\n"
+      "R\"Value10\"S\n"
+      "R\"Value11\"S\n"
+      "R\"Value12\"S\n"
+      "R\"Value13\"S\n"
+      "R\"Value14\"S\n"
+      "R\"Value15\"S\n"
+      "\n";
+
+static const char *m_fragmentRequesterDefinition = "APX/1.2\n"
+      "N\"FragmentRequester\"\n"
+      "R\"SpeedA\"S\n"
+      "R\"RpmA\"S\n"
+      "R\"SpeedB\"S\n"
+      "R\"RpmB\"S\n"
+      "\n";
+
+static const char *m_bigProviderDefinition = "APX/1.2\n"
+      "N\"BigProvider\"\n"
+      "P\"BlockA\"C[4096]\n"
+      "P\"BlockB\"C[100]\n"
+      "\n";
+
+static const char *m_bigRequesterDefinition = "APX/1.2\n"
+      "N\"BigRequester\"\n"
+      "R\"BlockA\"C[4096]\n"
+      "R\"BlockB\"C[100]\n"
+      "\n";
 
 
 //////////////////////////////////////////////////////////////////////////////
@@ -50,6 +206,28 @@ CuSuite* testSuite_apx_testServer(void)
 
    SUITE_ADD_TEST(suite, test_apx_testServer_create);
    SUITE_ADD_TEST(suite, test_apx_testServer_greeting);
+   SUITE_ADD_TEST(suite, test_apx_testServer_multiWriteGreeting);
+   SUITE_ADD_TEST(suite, test_apx_testServer_numHeaderFormat16);
+   SUITE_ADD_TEST(suite, test_apx_testServer_streamLargeDataMessage);
+   SUITE_ADD_TEST(suite, test_apx_testServer_directDispatch);
+   SUITE_ADD_TEST(suite, test_apx_testServer_routedWrite);
+   SUITE_ADD_TEST(suite, test_apx_testServer_fragmentedWrite);
+   SUITE_ADD_TEST(suite, test_apx_testServer_interleavedFragmentedWrites);
+   SUITE_ADD_TEST(suite, test_apx_testServer_writeDuringFragmentedTransfer);
+   SUITE_ADD_TEST(suite, test_apx_testServer_resumeSendsOnlyDelta);
+   SUITE_ADD_TEST(suite, test_apx_testServer_resumeRoutesChangedValuesPerRange);
+   SUITE_ADD_TEST(suite, test_apx_testServer_resumeWithChangedDefinition);
+   SUITE_ADD_TEST(suite, test_apx_testServer_parkedNodeExpires);
+   SUITE_ADD_TEST(suite, test_apx_testServer_batchedWrites);
+#ifndef _WIN32
+   SUITE_ADD_TEST(suite, test_apx_testServer_backpressuredRouteOutsideReadSection);
+   SUITE_ADD_TEST(suite, test_apx_testServer_directDispatchToSlowReader);
+#endif
+#if APX_SERVER_REACTOR_ENABLE
+   SUITE_ADD_TEST(suite, test_apx_testServer_reactorBuffersOutputOfSlowReader);
+   SUITE_ADD_TEST(suite, test_apx_testServer_reactorDisconnectsSlowReader);
+   SUITE_ADD_TEST(suite, test_apx_testServer_reactorFlushTimer);
+#endif
 
    return suite;
 }
@@ -109,3 +287,1229 @@ static void test_apx_testServer_greeting(CuTest* tc)
    free(sendBuffer);
 }
 
+static void test_apx_testServer_multiWriteGreeting(CuTest* tc)
+{
+   apx_testServer_t server;
+   apx_serverConnection_t *connection;
+   testsocket_t *socket;
+   uint8_t sendBuffer[RMF_GREETING_MAX_LEN+1];
+   uint32_t greetingLen;
+   const uint8_t *data;
+   uint8_t expectedArray[12];
+   char greeting[RMF_GREETING_MAX_LEN];
+   socket = testsocket_new();
+   apx_testServer_create(&server);
+   apx_testServer_accept(&server, socket);
+   connection = (apx_serverConnection_t*) adt_list_first(&server.connections)->pItem;
+   strcpy(greeting, RMF_GREETING_START);
+   strcat(greeting, RMF_MULTI_WRITE " 1\n");
+   strcat(greeting, "\n");
+   greetingLen = (uint32_t) strlen(greeting);
+   sendBuffer[0]=greetingLen;
+   memcpy(&sendBuffer[1], greeting, greetingLen);
+   testsocket_clientSend(socket, sendBuffer, 1+greetingLen);
+   testSocket_run(socket);
+   SLEEP(10);
+   CuAssertTrue(tc, apx_fileManager_isMultiWriteEnabled(&connection->fileManager));
+   //the acknowledge is followed by an empty multi-write message
+   CuAssertIntEquals(tc, 9+13, adt_bytearray_length(&socket->pendingClient));
+   data = adt_bytearray_data(&socket->pendingClient);
+   CuAssertIntEquals(tc, 12, data[9]);
+   CuAssertIntEquals(tc, 4, rmf_packHeader(&expectedArray[0], sizeof(expectedArray), RMF_CMD_START_ADDR, false));
+   CuAssertIntEquals(tc, RMF_MULTI_WRITE_CMD_LEN, rmf_serialize_cmdMultiWrite(&expectedArray[4], sizeof(expectedArray)-4, 0));
+   CuAssertIntEquals(tc, 0, memcmp(&expectedArray[0], &data[10], sizeof(expectedArray)));
+   apx_testServer_destroy(&server);
+}
+
+static void test_apx_testServer_numHeaderFormat16(CuTest* tc)
+{
+   apx_testServer_t server;
+   apx_serverConnection_t *connection;
+   testsocket_t *socket;
+   uint8_t sendBuffer[RMF_GREETING_MAX_LEN+1];
+   uint32_t greetingLen;
+   const uint8_t *data;
+   uint8_t expectedArray[12];
+   char greeting[RMF_GREETING_MAX_LEN];
+   char fileName[RMF_MAX_FILE_NAME+1];
+   uint8_t msgBuffer[256];
+   rmf_fileInfo_t fileInfo;
+   int32_t msgLen;
+   socket = testsocket_new();
+   apx_testServer_create(&server);
+   apx_testServer_accept(&server, socket);
+   connection = (apx_serverConnection_t*) adt_list_first(&server.connections)->pItem;
+   strcpy(greeting, RMF_GREETING_START);
+   strcat(greeting, RMF_NUMHEADER_FORMAT " 16\n");
+   strcat(greeting, "\n");
+   greetingLen = (uint32_t) strlen(greeting);
+   sendBuffer[0]=greetingLen;
+   memcpy(&sendBuffer[1], greeting, greetingLen);
+   testsocket_clientSend(socket, sendBuffer, 1+greetingLen);
+   testSocket_run(socket);
+   SLEEP(10);
+   CuAssertIntEquals(tc, 2, connection->numHeaderMaxLen);
+   //the confirmation comes before the acknowledge, both are short enough to use a 1 byte header
+   CuAssertIntEquals(tc, 13+9, adt_bytearray_length(&socket->pendingClient));
+   data = adt_bytearray_data(&socket->pendingClient);
+   CuAssertIntEquals(tc, 12, data[0]);
+   CuAssertIntEquals(tc, 4, rmf_packHeader(&expectedArray[0], sizeof(expectedArray), RMF_CMD_START_ADDR, false));
+   CuAssertIntEquals(tc, RMF_NUMHEADER_FORMAT_CMD_LEN, rmf_serialize_cmdNumHeaderFormat(&expectedArray[4], sizeof(expectedArray)-4, RMF_NUMHEADER_FORMAT_16));
+   CuAssertIntEquals(tc, 0, memcmp(&expectedArray[0], &data[1], sizeof(expectedArray)));
+   CuAssertIntEquals(tc, 8, data[13]);
+   //a file info with a long name needs the 2 byte form of the header
+   memset(fileName, 'N', 100);
+   strcpy(&fileName[100], ".out");
+   rmf_fileInfo_create(&fileInfo, fileName, 0, 64, RMF_FILE_TYPE_FIXED);
+   msgLen = rmf_packHeader(&msgBuffer[2], sizeof(msgBuffer)-2, RMF_CMD_START_ADDR, false);
+   msgLen += rmf_serialize_cmdFileInfo(&msgBuffer[2+msgLen], sizeof(msgBuffer)-2-msgLen, &fileInfo);
+   CuAssertTrue(tc, msgLen > 127);
+   CuAssertIntEquals(tc, 2, rmf_packNumHeader(&msgBuffer[0], 2, (uint32_t) msgLen, (uint8_t) sizeof(uint16_t)));
+   testsocket_clientSend(socket, msgBuffer, 2+msgLen);
+   testSocket_run(socket);
+   SLEEP(10);
+   CuAssertPtrNotNull(tc, apx_fileManager_findRemoteFile(&connection->fileManager, fileName));
+   rmf_fileInfo_destroy(&fileInfo);
+   apx_testServer_destroy(&server);
+}
+
+static void test_apx_testServer_streamLargeDataMessage(CuTest* tc)
+{
+   apx_testServer_t server;
+   apx_serverConnection_t *connection;
+   testsocket_t *socket;
+   apx_file_t *remoteFile;
+   uint8_t *msgBuffer;
+   int32_t msgLen;
+   const uint32_t address = 0x4000000;
+   const int32_t definitionLen = APX_FILEMANAGER_STREAM_MIN_LEN+1000;
+   const int32_t firstPartLen = 1000;
+   socket = testsocket_new();
+   apx_testServer_create(&server);
+   apx_testServer_accept(&server, socket);
+   connection = (apx_serverConnection_t*) adt_list_first(&server.connections)->pItem;
+   msgBuffer = (uint8_t*) malloc(sizeof(uint32_t)+RMF_MAX_HEADER_SIZE+definitionLen);
+   //greeting without headers
+   msgBuffer[0] = (uint8_t) (strlen(RMF_GREETING_START)+1);
+   strcpy((char*) &msgBuffer[1], RMF_GREETING_START "\n");
+   testsocket_clientSend(socket, msgBuffer, 1+msgBuffer[0]);
+   testSocket_run(socket);
+   SLEEP(10);
+   clientSendFileInfo(socket, "LargeNode.apx", address, (uint32_t) definitionLen, (const uint8_t*) 0);
+   testSocket_run(socket);
+   SLEEP(10);
+   remoteFile = apx_fileManager_findRemoteFile(&connection->fileManager, "LargeNode.apx");
+   CuAssertPtrNotNull(tc, remoteFile);
+   CuAssertPtrNotNull(tc, remoteFile->nodeData);
+   //the definition is sent in one data message that arrives in two parts
+   msgLen = rmf_packHeader(&msgBuffer[4], RMF_MAX_HEADER_SIZE, address, false) + definitionLen;
+   memset(&msgBuffer[4+RMF_MAX_HEADER_SIZE], 'A', firstPartLen);
+   memset(&msgBuffer[4+RMF_MAX_HEADER_SIZE+firstPartLen], 'B', definitionLen-firstPartLen);
+   CuAssertIntEquals(tc, 4, rmf_packNumHeader(&msgBuffer[0], 4, (uint32_t) msgLen, (uint8_t) sizeof(uint32_t)));
+   testsocket_clientSend(socket, msgBuffer, 4+RMF_MAX_HEADER_SIZE+firstPartLen);
+   testSocket_run(socket);
+   SLEEP(10);
+   //the first part has been written to the definition, nothing is left waiting in the receive buffer
+   CuAssertIntEquals(tc, 0, adt_bytearray_length(&socket->pendingServer));
+   CuAssertTrue(tc, apx_fileManager_isParsingMessage(&connection->fileManager));
+   CuAssertIntEquals(tc, 'A', remoteFile->nodeData->definitionDataBuf[firstPartLen-1]);
+   testsocket_clientSend(socket, &msgBuffer[4+RMF_MAX_HEADER_SIZE+firstPartLen], definitionLen-firstPartLen);
+   testSocket_run(socket);
+   SLEEP(10);
+   CuAssertTrue(tc, apx_fileManager_isParsingMessage(&connection->fileManager) == false);
+   CuAssertIntEquals(tc, 'B', remoteFile->nodeData->definitionDataBuf[firstPartLen]);
+   CuAssertIntEquals(tc, 'B', remoteFile->nodeData->definitionDataBuf[definitionLen-1]);
+   free(msgBuffer);
+   apx_testServer_destroy(&server);
+}
+
+static void test_apx_testServer_directDispatch(CuTest* tc)
+{
+   apx_testServer_t server;
+   apx_serverConnection_t *connection;
+   adt_list_elem_t *pIter;
+   uint8_t data[2] = {0x12, 0x34};
+   apx_testServer_create(&server);
+   CuAssertTrue(tc, server.isDirectDispatchEnabled == false);
+   apx_testServer_setDirectDispatch(&server, true);
+   apx_testServer_accept(&server, testsocket_new());
+   pIter = adt_list_first(&server.connections);
+   CuAssertPtrNotNull(tc, pIter);
+   connection = (apx_serverConnection_t*) pIter->pItem;
+   CuAssertTrue(tc, apx_fileManager_isDirectDispatchEnabled(&connection->fileManager));
+   //invalid arguments are refused, the caller then queues the write as before
+   CuAssertIntEquals(tc, -1, apx_fileManager_directWriteCmd(&connection->fileManager, 0, data, 0, sizeof(data)));
+   apx_fileManager_setDirectDispatch(&connection->fileManager, false);
+   CuAssertTrue(tc, apx_fileManager_isDirectDispatchEnabled(&connection->fileManager) == false);
+   apx_testServer_destroy(&server);
+}
+
+/**
+ * A write from one client is routed to another, in the direct dispatch case the receive thread of the provider
+ * appends it to the transmit buffer of the requester and the worker of the requester transmits it.
+ */
+static void test_apx_testServer_routedWrite(CuTest* tc)
+{
+   uint32_t queuedLatency = routedWriteLatency(tc, false);
+   uint32_t directLatency = routedWriteLatency(tc, true);
+#ifdef APX_ENABLE_BENCHMARK
+   printf("[apx_testServer] routed write latency: queued %u us, direct dispatch %u us\n", (unsigned int) queuedLatency, (unsigned int) directLatency);
+#else
+   (void) queuedLatency;
+   (void) directLatency;
+#endif
+}
+
+/**
+ * The port data of ProviderA is sent in two messages, the first one with more_bit set.
+ * Nothing is routed until the last message has arrived, then both ports are routed.
+ */
+static void test_apx_testServer_fragmentedWrite(CuTest* tc)
+{
+   apx_testServer_t server;
+   testsocket_t *provider;
+   testsocket_t *requester;
+   rmf_fileInfo_t inDataFileInfo;
+   const uint8_t value[4] = {0x12, 0x34, 0x56, 0x78};
+   uint8_t inPortData[8];
+   provider = testsocket_new();
+   requester = testsocket_new();
+   apx_testServer_create(&server);
+   apx_testServer_accept(&server, provider);
+   apx_testServer_accept(&server, requester);
+   clientSendGreeting(provider);
+   clientAddNode(provider, m_providerADefinition, "ProviderA", DEFINITION_ADDRESS, 0, sizeof(value));
+   clientSendGreeting(requester);
+   clientAddNode(requester, m_fragmentRequesterDefinition, "FragmentRequester", DEFINITION_ADDRESS, 0, 0);
+   clientOpenInPortDataFile(tc, requester, "FragmentRequester.in", &inDataFileInfo);
+   CuAssertIntEquals(tc, sizeof(inPortData), inDataFileInfo.length);
+   adt_bytearray_clear(&requester->pendingClient);
+   clientSendMessage(provider, 0, &value[0], 2, true);
+   testSocket_run(provider);
+   SLEEP(10);
+   CuAssertIntEquals(tc, 0, adt_bytearray_length(&requester->pendingClient));
+   clientSendMessage(provider, 2, &value[2], 2, false);
+   testSocket_run(provider);
+   SLEEP(10);
+   memset(&inPortData[0], 0, sizeof(inPortData));
+   CuAssertIntEquals(tc, 2, clientApplyWrites(requester, &inDataFileInfo, &inPortData[0]));
+   CuAssertIntEquals(tc, 0, memcmp(&inPortData[0], &value[0], sizeof(value)));
+   apx_testServer_destroy(&server);
+}
+
+/**
+ * The transfers to the .out files of two nodes take turns, the way the sender interleaves large transfers.
+ * Each file keeps its own pending sequence, the first fragment of one file is routed even though a fragment of the other file came in between.
+ */
+static void test_apx_testServer_interleavedFragmentedWrites(CuTest* tc)
+{
+   apx_testServer_t server;
+   testsocket_t *provider;
+   testsocket_t *requester;
+   rmf_fileInfo_t inDataFileInfo;
+   const uint8_t valueA[4] = {0x12, 0x34, 0x56, 0x78};
+   const uint8_t valueB[4] = {0x9A, 0xBC, 0xDE, 0xF0};
+   const uint32_t outAddressB = 0x400;
+   uint8_t inPortData[8];
+   provider = testsocket_new();
+   requester = testsocket_new();
+   apx_testServer_create(&server);
+   apx_testServer_accept(&server, provider);
+   apx_testServer_accept(&server, requester);
+   clientSendGreeting(provider);
+   clientAddNode(provider, m_providerADefinition, "ProviderA", DEFINITION_ADDRESS, 0, sizeof(valueA));
+   clientAddNode(provider, m_providerBDefinition, "ProviderB", DEFINITION_ADDRESS+0x400, outAddressB, sizeof(valueB));
+   clientSendGreeting(requester);
+   clientAddNode(requester, m_fragmentRequesterDefinition, "FragmentRequester", DEFINITION_ADDRESS, 0, 0);
+   clientOpenInPortDataFile(tc, requester, "FragmentRequester.in", &inDataFileInfo);
+   CuAssertIntEquals(tc, sizeof(inPortData), inDataFileInfo.length);
+   adt_bytearray_clear(&requester->pendingClient);
+   clientSendMessage(provider, 0, &valueA[0], 2, true);
+   clientSendMessage(provider, outAddressB, &valueB[0], 2, true);
+   clientSendMessage(provider, 2, &valueA[2], 2, false);
+   clientSendMessage(provider, outAddressB+2, &valueB[2], 2, false);
+   testSocket_run(provider);
+   SLEEP(10);
+   memset(&inPortData[0], 0, sizeof(inPortData));
+   CuAssertIntEquals(tc, 4, clientApplyWrites(requester, &inDataFileInfo, &inPortData[0]));
+   CuAssertIntEquals(tc, 0, memcmp(&inPortData[0], &valueA[0], sizeof(valueA)));
+   CuAssertIntEquals(tc, 0, memcmp(&inPortData[4], &valueB[0], sizeof(valueB)));
+   apx_testServer_destroy(&server);
+}
+
+/**
+ * The .in file of the requester is larger than one fragment. BlockB starts where the second fragment starts and is written while the transfer is pending.
+ * The write goes out with the second fragment, on its own the requester would take it for the end of the transfer.
+ */
+static void test_apx_testServer_writeDuringFragmentedTransfer(CuTest* tc)
+{
+   apx_testServer_t server;
+   apx_serverConnection_t *requesterConnection;
+   testsocket_t *provider;
+   testsocket_t *requester;
+   rmf_fileInfo_t inDataFileInfo;
+   uint8_t valueB[100];
+   uint8_t inPortData[4096+100];
+   provider = testsocket_new();
+   requester = testsocket_new();
+   memset(&valueB[0], 0x5A, sizeof(valueB));
+   apx_testServer_create(&server);
+   apx_testServer_accept(&server, provider);
+   apx_testServer_accept(&server, requester);
+   clientSendGreeting(provider);
+   clientAddNode(provider, m_bigProviderDefinition, "BigProvider", DEFINITION_ADDRESS, 0, sizeof(inPortData));
+   clientSendGreeting(requester);
+   clientAddNode(requester, m_bigRequesterDefinition, "BigRequester", DEFINITION_ADDRESS, 0, 0);
+   requesterConnection = getConnection(&server, requester);
+   CuAssertPtrNotNull(tc, requesterConnection);
+   apx_fileManager_stop(&requesterConnection->fileManager);
+   apx_fileManager_startExternal(&requesterConnection->fileManager, externalWakeup, (void*) 0);
+   (void) apx_fileManager_processMessages(&requesterConnection->fileManager);
+   clientOpenInPortDataFile(tc, requester, "BigRequester.in", &inDataFileInfo);
+   CuAssertIntEquals(tc, sizeof(inPortData), inDataFileInfo.length);
+   adt_bytearray_clear(&requester->pendingClient);
+   clientSendMessage(provider, 4096, &valueB[0], (int32_t) sizeof(valueB), false);
+   testSocket_run(provider);
+   SLEEP(10);
+   (void) apx_fileManager_processMessages(&requesterConnection->fileManager);
+   memset(&inPortData[0], 0, sizeof(inPortData));
+   CuAssertIntEquals(tc, 2, clientApplyWrites(requester, &inDataFileInfo, &inPortData[0]));
+   CuAssertIntEquals(tc, 0, memcmp(&inPortData[4096], &valueB[0], sizeof(valueB)));
+   apx_testServer_destroy(&server);
+}
+
+/**
+ * The requester loses its connection and comes back with the same definition within the grace period.
+ * The session is resumed without the definition being downloaded and the client only receives the port that was written in between.
+ */
+static void test_apx_testServer_resumeSendsOnlyDelta(CuTest* tc)
+{
+   apx_testServer_t server;
+   testsocket_t *provider;
+   testsocket_t *requester;
+   rmf_fileInfo_t inDataFileInfo;
+   const uint8_t value[2] = {0x56, 0x78};
+   const uint8_t *data;
+   int32_t dataLen;
+   uint8_t inPortData[4];
+   provider = testsocket_new();
+   requester = testsocket_new();
+   apx_testServer_create(&server);
+   apx_nodeManager_setGracePeriod(&server.nodeManager, 10000);
+   apx_testServer_accept(&server, provider);
+   apx_testServer_accept(&server, requester);
+   clientSendGreeting(provider);
+   clientAddNode(provider, m_providerADefinition, "ProviderA", DEFINITION_ADDRESS, 0, 4);
+   clientSendGreeting(requester);
+   clientAddNode(requester, m_resumeRequesterDefinition, "ResumeRequester", DEFINITION_ADDRESS, 0, 0);
+   clientOpenInPortDataFile(tc, requester, "ResumeRequester.in", &inDataFileInfo);
+   apx_testServer_closeConnection(&server, requester);
+   //RpmA is written while the requester is parked
+   clientSendMessage(provider, 2, &value[0], sizeof(value), false);
+   testSocket_run(provider);
+   SLEEP(10);
+   requester = testsocket_new();
+   apx_testServer_accept(&server, requester);
+   clientSendGreeting(requester);
+   clientAddNode(requester, m_resumeRequesterDefinition, "ResumeRequester", DEFINITION_ADDRESS, 0, 0);
+   CuAssertTrue(tc, clientFindFileOpen(requester, DEFINITION_ADDRESS) == false);
+   clientOpenInPortDataFile(tc, requester, "ResumeRequester.in", &inDataFileInfo);
+   memset(&inPortData[0], 0, sizeof(inPortData));
+   CuAssertIntEquals(tc, 1, clientApplyWrites(requester, &inDataFileInfo, &inPortData[0]));
+   data = clientFindWrite(requester, inDataFileInfo.address+2, &dataLen);
+   CuAssertPtrNotNull(tc, data);
+   CuAssertIntEquals(tc, sizeof(value), dataLen);
+   CuAssertIntEquals(tc, 0, memcmp(data, &value[0], sizeof(value)));
+   apx_testServer_destroy(&server);
+}
+
+/**
+ * A resumed provider sends its values again in two writes, the changed value first. Only the value that changed while it was disconnected is routed
+ */
+static void test_apx_testServer_resumeRoutesChangedValuesPerRange(CuTest* tc)
+{
+   apx_testServer_t server;
+   testsocket_t *provider;
+   testsocket_t *requester;
+   rmf_fileInfo_t inDataFileInfo;
+   const uint8_t value[4] = {0x12, 0x34, 0x56, 0x78};
+   const uint8_t changedValue[2] = {0x9A, 0xBC};
+   const uint8_t *data;
+   int32_t dataLen;
+   uint8_t inPortData[4];
+   provider = testsocket_new();
+   requester = testsocket_new();
+   apx_testServer_create(&server);
+   apx_nodeManager_setGracePeriod(&server.nodeManager, 10000);
+   apx_testServer_accept(&server, provider);
+   apx_testServer_accept(&server, requester);
+   clientSendGreeting(provider);
+   clientAddNode(provider, m_providerADefinition, "ProviderA", DEFINITION_ADDRESS, 0, sizeof(value));
+   clientSendGreeting(requester);
+   clientAddNode(requester, m_resumeRequesterDefinition, "ResumeRequester", DEFINITION_ADDRESS, 0, 0);
+   clientOpenInPortDataFile(tc, requester, "ResumeRequester.in", &inDataFileInfo);
+   clientSendMessage(provider, 0, &value[0], sizeof(value), false);
+   testSocket_run(provider);
+   SLEEP(10);
+   apx_testServer_closeConnection(&server, provider);
+   provider = testsocket_new();
+   apx_testServer_accept(&server, provider);
+   clientSendGreeting(provider);
+   clientAddNode(provider, m_providerADefinition, "ProviderA", DEFINITION_ADDRESS, 0, sizeof(value));
+   CuAssertTrue(tc, clientFindFileOpen(provider, DEFINITION_ADDRESS) == false);
+   CuAssertTrue(tc, clientFindFileOpen(provider, 0));
+   adt_bytearray_clear(&requester->pendingClient);
+   clientSendMessage(provider, 2, &changedValue[0], sizeof(changedValue), false);
+   clientSendMessage(provider, 0, &value[0], 2, false);
+   testSocket_run(provider);
+   SLEEP(10);
+   memset(&inPortData[0], 0, sizeof(inPortData));
+   CuAssertIntEquals(tc, 1, clientApplyWrites(requester, &inDataFileInfo, &inPortData[0]));
+   data = clientFindWrite(requester, inDataFileInfo.address+2, &dataLen);
+   CuAssertPtrNotNull(tc, data);
+   CuAssertIntEquals(tc, 0, memcmp(data, &changedValue[0], sizeof(changedValue)));
+   //the resumed session is over once every value has been sent again, a write of an unchanged value is routed as usual
+   adt_bytearray_clear(&requester->pendingClient);
+   clientSendMessage(provider, 0, &value[0], 2, false);
+   testSocket_run(provider);
+   SLEEP(10);
+   CuAssertIntEquals(tc, 1, clientApplyWrites(requester, &inDataFileInfo, &inPortData[0]));
+   apx_testServer_destroy(&server);
+}
+
+/**
+ * A client that comes back with another definition for the same node name gets a new node, the definition is downloaded again
+ */
+static void test_apx_testServer_resumeWithChangedDefinition(CuTest* tc)
+{
+   apx_testServer_t server;
+   testsocket_t *requester;
+   rmf_fileInfo_t inDataFileInfo;
+   requester = testsocket_new();
+   apx_testServer_create(&server);
+   apx_nodeManager_setGracePeriod(&server.nodeManager, 10000);
+   apx_testServer_accept(&server, requester);
+   clientSendGreeting(requester);
+   clientAddNode(requester, m_resumeRequesterDefinition, "ResumeRequester", DEFINITION_ADDRESS, 0, 0);
+   CuAssertTrue(tc, clientFindFileOpen(requester, DEFINITION_ADDRESS));
+   clientOpenInPortDataFile(tc, requester, "ResumeRequester.in", &inDataFileInfo);
+   CuAssertIntEquals(tc, 4, inDataFileInfo.length);
+   apx_testServer_closeConnection(&server, requester);
+   requester = testsocket_new();
+   apx_testServer_accept(&server, requester);
+   clientSendGreeting(requester);
+   clientAddNode(requester, m_changedResumeRequesterDefinition, "ResumeRequester", DEFINITION_ADDRESS, 0, 0);
+   CuAssertTrue(tc, clientFindFileOpen(requester, DEFINITION_ADDRESS));
+   CuAssertTrue(tc, clientFindFileInfo(requester, "ResumeRequester.in", &inDataFileInfo));
+   CuAssertIntEquals(tc, 6, inDataFileInfo.length);
+   apx_testServer_destroy(&server);
+}
+
+/**
+ * A parked node is deleted when its grace period has passed, the client that comes back later gets all values when it opens its file
+ */
+static void test_apx_testServer_parkedNodeExpires(CuTest* tc)
+{
+   apx_testServer_t server;
+   testsocket_t *requester;
+   rmf_fileInfo_t inDataFileInfo;
+   uint8_t inPortData[4];
+   int32_t dataLen;
+   requester = testsocket_new();
+   apx_testServer_create(&server);
+   apx_nodeManager_setGracePeriod(&server.nodeManager, 200);
+   apx_testServer_accept(&server, requester);
+   clientSendGreeting(requester);
+   clientAddNode(requester, m_resumeRequesterDefinition, "ResumeRequester", DEFINITION_ADDRESS, 0, 0);
+   clientOpenInPortDataFile(tc, requester, "ResumeRequester.in", &inDataFileInfo);
+   apx_testServer_closeConnection(&server, requester);
+   CuAssertIntEquals(tc, 0, apx_nodeManager_expireStaleNodes(&server.nodeManager));
+   SLEEP(250);
+   CuAssertIntEquals(tc, 1, apx_nodeManager_expireStaleNodes(&server.nodeManager));
+   CuAssertIntEquals(tc, 0, apx_nodeManager_expireStaleNodes(&server.nodeManager));
+   requester = testsocket_new();
+   apx_testServer_accept(&server, requester);
+   clientSendGreeting(requester);
+   clientAddNode(requester, m_resumeRequesterDefinition, "ResumeRequester", DEFINITION_ADDRESS, 0, 0);
+   clientOpenInPortDataFile(tc, requester, "ResumeRequester.in", &inDataFileInfo);
+   CuAssertIntEquals(tc, 1, clientApplyWrites(requester, &inDataFileInfo, &inPortData[0]));
+   CuAssertPtrNotNull(tc, clientFindWrite(requester, inDataFileInfo.address, &dataLen));
+   CuAssertIntEquals(tc, sizeof(inPortData), dataLen);
+   apx_testServer_destroy(&server);
+}
+
+/**
+ * The provider sends one small write per port packed in an RMF_CMD_MULTI_WRITE message.
+ * The requester understands multi-write, the writes routed to it are batched into one message again
+ */
+static void test_apx_testServer_batchedWrites(CuTest* tc)
+{
+   apx_testServer_t server;
+   apx_serverConnection_t *requesterConnection;
+   testsocket_t *provider;
+   testsocket_t *requester;
+   rmf_fileInfo_t inDataFileInfo;
+   rmf_msg_t msg;
+   uint8_t msgBuffer[RMF_MULTI_WRITE_CMD_LEN+BATCH_NUM_PORTS*(RMF_MULTI_WRITE_MAX_RECORD_HEADER_SIZE+2)];
+   uint8_t values[BATCH_NUM_PORTS*2];
+   uint8_t inPortData[BATCH_NUM_PORTS*2];
+   uint32_t cmdType;
+   int32_t msgLen;
+   int32_t pos = 0;
+   int32_t i;
+   provider = testsocket_new();
+   requester = testsocket_new();
+   apx_testServer_create(&server);
+   apx_testServer_accept(&server, provider);
+   apx_testServer_accept(&server, requester);
+   clientSendGreeting(provider);
+   clientAddNode(provider, m_batchProviderDefinition, "BatchProvider", DEFINITION_ADDRESS, 0, sizeof(values));
+   clientSendMultiWriteGreeting(requester);
+   clientAddNode(requester, m_batchRequesterDefinition, "BatchRequester", DEFINITION_ADDRESS, 0, 0);
+   clientOpenInPortDataFile(tc, requester, "BatchRequester.in", &inDataFileInfo);
+   CuAssertIntEquals(tc, sizeof(inPortData), inDataFileInfo.length);
+   //the messages of the requester are processed by the test instead of by its worker thread, all routed writes are waiting in the queue
+   requesterConnection = getConnection(&server, requester);
+   CuAssertPtrNotNull(tc, requesterConnection);
+   CuAssertTrue(tc, apx_fileManager_isMultiWriteEnabled(&requesterConnection->fileManager));
+   apx_fileManager_stop(&requesterConnection->fileManager);
+   apx_fileManager_startExternal(&requesterConnection->fileManager, externalWakeup, (void*) 0);
+   adt_bytearray_clear(&requester->pendingClient);
+   msgLen = rmf_serialize_cmdMultiWrite(&msgBuffer[0], sizeof(msgBuffer), 0);
+   CuAssertIntEquals(tc, RMF_MULTI_WRITE_CMD_LEN, msgLen);
+   for (i=0; i<BATCH_NUM_PORTS; i++)
+   {
+      int32_t result;
+      values[i*2] = (uint8_t) i;
+      values[i*2+1] = (uint8_t) (0x80 | i);
+      result = rmf_serialize_multiWriteRecord(&msgBuffer[msgLen], (int32_t) sizeof(msgBuffer)-msgLen, (uint32_t) i*2, &values[i*2], 2);
+      CuAssertTrue(tc, result > 0);
+      msgLen += result;
+   }
+   clientSendMessage(provider, RMF_CMD_START_ADDR, &msgBuffer[0], msgLen, false);
+   testSocket_run(provider);
+   CuAssertIntEquals(tc, BATCH_NUM_PORTS, apx_fileManager_processMessages(&requesterConnection->fileManager));
+   CuAssertTrue(tc, clientNextMessage(requester, &pos, &msg));
+   CuAssertUIntEquals(tc, RMF_CMD_START_ADDR, msg.address);
+   CuAssertTrue(tc, rmf_deserialize_cmdType(msg.data, msg.dataLen, &cmdType) > 0);
+   CuAssertUIntEquals(tc, RMF_CMD_MULTI_WRITE, cmdType);
+   CuAssertTrue(tc, clientNextMessage(requester, &pos, &msg) == false);
+   memset(&inPortData[0], 0, sizeof(inPortData));
+   CuAssertIntEquals(tc, BATCH_NUM_PORTS, clientApplyWrites(requester, &inDataFileInfo, &inPortData[0]));
+   CuAssertIntEquals(tc, 0, memcmp(&values[0], &inPortData[0], sizeof(values)));
+   apx_testServer_destroy(&server);
+}
+
+#ifndef _WIN32
+/**
+ * The queue of the requester is full and under backpressure, the provider thread routing a write to it has to wait for room.
+ * It must not do so inside an rcu read-side section, topology changes of unrelated connections would wait for it.
+ */
+static void test_apx_testServer_backpressuredRouteOutsideReadSection(CuTest* tc)
+{
+   apx_testServer_t server;
+   apx_serverConnection_t *requesterConnection;
+   apx_msgQueue_t *requesterQueue;
+   apx_msgQueueHandler_t queueHandler;
+   apx_msgQueueStats_t stats;
+   testsocket_t *provider;
+   testsocket_t *requester;
+   rmf_fileInfo_t inDataFileInfo;
+   providerWriteArg_t arg;
+   pthread_t thread;
+   const uint8_t value[2] = {0x34, 0x12};
+   const uint8_t *data;
+   int32_t dataLen = 0;
+   uint32_t startTime;
+   uint32_t elapsed;
+   apx_msg_t flushMsg = {RMF_MSG_FLUSH,0,0,0,0};
+   provider = testsocket_new();
+   requester = testsocket_new();
+   apx_testServer_create(&server);
+   apx_testServer_accept(&server, provider);
+   apx_testServer_accept(&server, requester);
+   clientSendGreeting(provider);
+   clientAddNode(provider, m_providerDefinition, "Provider", DEFINITION_ADDRESS, 0, sizeof(value));
+   clientSendGreeting(requester);
+   clientAddNode(requester, m_requesterDefinition, "Requester", DEFINITION_ADDRESS, 0, 0);
+   clientOpenInPortDataFile(tc, requester, "Requester.in", &inDataFileInfo);
+   requesterConnection = getConnection(&server, requester);
+   CuAssertPtrNotNull(tc, requesterConnection);
+   apx_fileManager_stop(&requesterConnection->fileManager);
+   apx_fileManager_startExternal(&requesterConnection->fileManager, externalWakeup, (void*) 0);
+   adt_bytearray_clear(&requester->pendingClient);
+   //fill the queue of the requester with messages that are always accepted, the routed write is the first one that must wait
+   requesterQueue = &requesterConnection->fileManager.messageQueue;
+   memcpy(&queueHandler, &requesterQueue->handler, sizeof(queueHandler));
+   apx_msgQueue_setOverflowPolicy(requesterQueue, APX_MSG_QUEUE_POLICY_BACKPRESSURE, 1, &queueHandler);
+   while (requesterQueue->overflowLen == 0)
+   {
+      CuAssertIntEquals(tc, 0, apx_msgQueue_post(requesterQueue, &flushMsg));
+   }
+   arg.provider = provider;
+   arg.value = &value[0];
+   arg.valueLen = (int32_t) sizeof(value);
+   arg.isDone = 0;
+   CuAssertIntEquals(tc, 0, pthread_create(&thread, 0, providerWriteTask, &arg));
+   apx_msgQueue_getStats(requesterQueue, &stats);
+   while (stats.numBackpressureWaits == 0)
+   {
+      SLEEP(1);
+      apx_msgQueue_getStats(requesterQueue, &stats);
+   }
+   //a grace period ends while the provider thread is still waiting
+   startTime = getTimeUs();
+   apx_rcu_synchronize();
+   elapsed = getTimeUs() - startTime;
+   CuAssertTrue(tc, elapsed < (APX_MSG_QUEUE_BACKPRESSURE_TIMEOUT_MS*1000u)/2u);
+   //draining the queue lets the provider thread post the write
+   while (apx_fileManager_processMessages(&requesterConnection->fileManager) > 0)
+   {
+      SLEEP(1);
+   }
+   pthread_join(thread, 0);
+   (void) apx_fileManager_processMessages(&requesterConnection->fileManager);
+   apx_msgQueue_getStats(requesterQueue, &stats);
+   CuAssertUIntEquals(tc, 0, stats.numDropped);
+   data = clientFindWrite(requester, inDataFileInfo.address, &dataLen);
+   CuAssertPtrNotNull(tc, data);
+   CuAssertIntEquals(tc, sizeof(value), dataLen);
+   CuAssertIntEquals(tc, 0, memcmp(data, &value[0], sizeof(value)));
+   apx_testServer_destroy(&server);
+}
+
+/**
+ * The requester doesn't read, its worker is stuck sending to it while holding the transmit buffer.
+ * With direct dispatch the provider thread must not wait for it, the routed write goes through the queue of the requester instead.
+ */
+static void test_apx_testServer_directDispatchToSlowReader(CuTest* tc)
+{
+   apx_testServer_t server;
+   apx_serverConnection_t *requesterConnection;
+   testsocket_t *provider;
+   testsocket_t *requester;
+   rmf_fileInfo_t inDataFileInfo;
+   providerWriteArg_t arg;
+   pthread_t thread;
+   const uint8_t value[2] = {0x34, 0x12};
+   const uint8_t *data;
+   int32_t dataLen = 0;
+   int32_t isDone;
+   int32_t i;
+   provider = testsocket_new();
+   requester = testsocket_new();
+   apx_testServer_create(&server);
+   apx_testServer_setDirectDispatch(&server, true);
+   apx_testServer_accept(&server, provider);
+   apx_testServer_accept(&server, requester);
+   clientSendGreeting(provider);
+   clientAddNode(provider, m_providerDefinition, "Provider", DEFINITION_ADDRESS, 0, sizeof(value));
+   clientSendGreeting(requester);
+   clientAddNode(requester, m_requesterDefinition, "Requester", DEFINITION_ADDRESS, 0, 0);
+   clientOpenInPortDataFile(tc, requester, "Requester.in", &inDataFileInfo);
+   requesterConnection = getConnection(&server, requester);
+   CuAssertPtrNotNull(tc, requesterConnection);
+   apx_fileManager_stop(&requesterConnection->fileManager);
+   apx_fileManager_startExternal(&requesterConnection->fileManager, externalWakeup, (void*) 0);
+   (void) apx_fileManager_processMessages(&requesterConnection->fileManager);
+   adt_bytearray_clear(&requester->pendingClient);
+   CuAssertIntEquals(tc, 0, apx_msgQueue_getNumPending(&requesterConnection->fileManager.messageQueue));
+   //a transmit to a socket that is not read holds the mutex of the transmit buffer until the socket accepts the data
+   MUTEX_LOCK(requesterConnection->frameAccumulator.mutex);
+   arg.provider = provider;
+   arg.value = &value[0];
+   arg.valueLen = (int32_t) sizeof(value);
+   arg.isDone = 0;
+   CuAssertIntEquals(tc, 0, pthread_create(&thread, 0, providerWriteTask, &arg));
+   for (i=0; (i<1000) && (APX_ATOMIC_LOAD_ACQUIRE(arg.isDone) == 0); i++)
+   {
+      SLEEP(1);
+   }
+   isDone = APX_ATOMIC_LOAD_ACQUIRE(arg.isDone);
+   MUTEX_UNLOCK(requesterConnection->frameAccumulator.mutex);
+   pthread_join(thread, 0);
+   CuAssertIntEquals(tc, 1, isDone);
+   CuAssertIntEquals(tc, 1, apx_msgQueue_getNumPending(&requesterConnection->fileManager.messageQueue));
+   //once the requester reads again the queued write is sent
+   CuAssertIntEquals(tc, 1, apx_fileManager_processMessages(&requesterConnection->fileManager));
+   data = clientFindWrite(requester, inDataFileInfo.address, &dataLen);
+   CuAssertPtrNotNull(tc, data);
+   CuAssertIntEquals(tc, sizeof(value), dataLen);
+   CuAssertIntEquals(tc, 0, memcmp(data, &value[0], sizeof(value)));
+   apx_testServer_destroy(&server);
+}
+
+static void *providerWriteTask(void *arg)
+{
+   providerWriteArg_t *writeArg = (providerWriteArg_t*) arg;
+   clientSendMessage(writeArg->provider, 0, writeArg->value, writeArg->valueLen, false);
+   testSocket_run(writeArg->provider);
+   APX_ATOMIC_STORE_RELEASE(writeArg->isDone, 1);
+   return 0;
+}
+#endif
+
+#if APX_SERVER_REACTOR_ENABLE
+/**
+ * The requester is served by the reactor and doesn't read. Routed writes the socket doesn't accept are kept in the output buffer
+ * of the connection instead of blocking the reactor thread. They are sent (EPOLLOUT) once the requester reads again.
+ */
+static void test_apx_testServer_reactorBuffersOutputOfSlowReader(CuTest* tc)
+{
+   apx_testServer_t server;
+   apx_serverConnection_t *requesterConnection;
+   testsocket_t *provider;
+   testsocket_t *requester;
+   rmf_fileInfo_t inDataFileInfo;
+   uint8_t valueA[4096];
+   uint8_t inPortData[4096+100];
+   int sendBufSize = 4096;
+   int sockfd;
+   int32_t i;
+   provider = testsocket_new();
+   requester = testsocket_new();
+   apx_testServer_create(&server);
+   apx_testServer_setNumReactors(&server, 1);
+   CuAssertPtrNotNull(tc, server.reactor);
+   apx_testServer_accept(&server, provider);
+   clientSendGreeting(provider);
+   clientAddNode(provider, m_bigProviderDefinition, "BigProvider", DEFINITION_ADDRESS, 0, sizeof(inPortData));
+   sockfd = reactorConnectRequester(tc, &server, requester, m_bigRequesterDefinition, "BigRequester", &inDataFileInfo);
+   CuAssertIntEquals(tc, sizeof(inPortData), inDataFileInfo.length);
+   requesterConnection = getConnection(&server, requester);
+   CuAssertPtrNotNull(tc, requesterConnection);
+   CuAssertIntEquals(tc, 0, setsockopt(requesterConnection->sockfd, SOL_SOCKET, SO_SNDBUF, &sendBufSize, sizeof(sendBufSize)));
+   adt_bytearray_clear(&requester->pendingClient);
+   //more than the socket accepts, less than APX_SERVER_REACTOR_MAX_OUTPUT_LEN
+   for (i=1; i<=8; i++)
+   {
+      memset(&valueA[0], i, sizeof(valueA));
+      clientSendMessage(provider, 0, &valueA[0], (int32_t) sizeof(valueA), false);
+      testSocket_run(provider);
+   }
+   for (i=0; (i<1000) && (reactorGetOutputLen(requesterConnection) == 0); i++)
+   {
+      SLEEP(1);
+   }
+   CuAssertTrue(tc, reactorGetOutputLen(requesterConnection) > 0);
+   CuAssertUIntEquals(tc, 1, apx_serverReactor_getNumConnections(server.reactor));
+   //the reactor writes the rest of the output buffer as the requester reads
+   memset(&inPortData[0], 0, sizeof(inPortData));
+   for (i=0; (i<1000) && ( (memcmp(&inPortData[0], &valueA[0], sizeof(valueA)) != 0) || (reactorGetOutputLen(requesterConnection) > 0) ); i++)
+   {
+      CuAssertTrue(tc, reactorClientReceive(&requester->pendingClient, sockfd) >= 0);
+      (void) clientApplyWrites(requester, &inDataFileInfo, &inPortData[0]);
+      SLEEP(1);
+   }
+   CuAssertIntEquals(tc, 0, memcmp(&inPortData[0], &valueA[0], sizeof(valueA)));
+   CuAssertUIntEquals(tc, 0, reactorGetOutputLen(requesterConnection));
+   apx_testServer_destroy(&server);
+   close(sockfd);
+}
+
+/**
+ * A requester that lets more than APX_SERVER_REACTOR_MAX_OUTPUT_LEN bytes back up is disconnected.
+ * It still receives what was written to its socket before the hangup.
+ */
+static void test_apx_testServer_reactorDisconnectsSlowReader(CuTest* tc)
+{
+   apx_testServer_t server;
+   apx_serverConnection_t *requesterConnection;
+   testsocket_t *provider;
+   testsocket_t *requester;
+   rmf_fileInfo_t inDataFileInfo;
+   adt_bytearray_t received;
+   uint8_t valueA[4096];
+   int sendBufSize = 4096;
+   int sockfd;
+   int32_t result = 0;
+   int32_t i;
+   provider = testsocket_new();
+   requester = testsocket_new();
+   apx_testServer_create(&server);
+   apx_testServer_setNumReactors(&server, 1);
+   CuAssertPtrNotNull(tc, server.reactor);
+   apx_testServer_accept(&server, provider);
+   clientSendGreeting(provider);
+   clientAddNode(provider, m_bigProviderDefinition, "BigProvider", DEFINITION_ADDRESS, 0, 4096+100);
+   sockfd = reactorConnectRequester(tc, &server, requester, m_bigRequesterDefinition, "BigRequester", &inDataFileInfo);
+   requesterConnection = getConnection(&server, requester);
+   CuAssertPtrNotNull(tc, requesterConnection);
+   CuAssertIntEquals(tc, 0, setsockopt(requesterConnection->sockfd, SOL_SOCKET, SO_SNDBUF, &sendBufSize, sizeof(sendBufSize)));
+   CuAssertUIntEquals(tc, 1, apx_serverReactor_getNumConnections(server.reactor));
+   //the requester connection (and its testsocket) is deleted by the reactor thread, neither is used after this point
+   for (i=0; (i<1000) && (apx_serverReactor_getNumConnections(server.reactor) > 0); i++)
+   {
+      memset(&valueA[0], (uint8_t) i, sizeof(valueA));
+      clientSendMessage(provider, 0, &valueA[0], (int32_t) sizeof(valueA), false);
+      testSocket_run(provider);
+      SLEEP(1);
+   }
+   CuAssertUIntEquals(tc, 0, apx_serverReactor_getNumConnections(server.reactor));
+   CuAssertIntEquals(tc, 1, adt_list_length(&server.connections));
+   CuAssertTrue(tc, i*sizeof(valueA) > APX_SERVER_REACTOR_MAX_OUTPUT_LEN);
+   adt_bytearray_create(&received, 4096);
+   for (i=0; (i<1000) && (result >= 0); i++)
+   {
+      result = reactorClientReceive(&received, sockfd);
+      SLEEP(1);
+   }
+   CuAssertIntEquals(tc, -1, result);
+   CuAssertTrue(tc, adt_bytearray_length(&received) > 0);
+   CuAssertTrue(tc, adt_bytearray_length(&received) < APX_SERVER_REACTOR_MAX_OUTPUT_LEN);
+   adt_bytearray_destroy(&received);
+   apx_testServer_destroy(&server);
+   close(sockfd);
+}
+
+/**
+ * Frames held back by the frame accumulator of a connection served by the reactor are sent by the flush timer of the reactor,
+ * nothing else happens on the connection.
+ */
+static void test_apx_testServer_reactorFlushTimer(CuTest* tc)
+{
+   apx_testServer_t server;
+   apx_serverConnection_t *requesterConnection;
+   apx_frameAccumulatorStats_t stats;
+   testsocket_t *requester;
+   rmf_fileInfo_t inDataFileInfo;
+   uint8_t header[RMF_MAX_HEADER_SIZE];
+   uint8_t frame[sizeof(uint32_t)+RMF_MAX_HEADER_SIZE+2];
+   const uint8_t value[2] = {0x34, 0x12};
+   const uint8_t *data = (const uint8_t*) 0;
+   uint32_t numTimeFlushes;
+   int32_t dataLen = 0;
+   int32_t rmfHeaderLen;
+   int32_t numHeaderLen;
+   int sockfd;
+   int32_t i;
+   requester = testsocket_new();
+   apx_testServer_create(&server);
+   apx_testServer_setNumReactors(&server, 1);
+   CuAssertPtrNotNull(tc, server.reactor);
+   sockfd = reactorConnectRequester(tc, &server, requester, m_requesterDefinition, "Requester", &inDataFileInfo);
+   CuAssertIntEquals(tc, sizeof(value), inDataFileInfo.length);
+   requesterConnection = getConnection(&server, requester);
+   CuAssertPtrNotNull(tc, requesterConnection);
+   adt_bytearray_clear(&requester->pendingClient);
+   apx_serverConnection_getSendStats(requesterConnection, &stats);
+   numTimeFlushes = stats.numTimeFlushes;
+   //a write the fileManager would send, appended without a flush
+   rmfHeaderLen = rmf_packHeader(&header[0], sizeof(header), inDataFileInfo.address, false);
+   numHeaderLen = rmf_packNumHeader(&frame[0], sizeof(uint32_t), (uint32_t) (rmfHeaderLen+sizeof(value)), (uint8_t) sizeof(uint32_t));
+   CuAssertTrue(tc, numHeaderLen > 0);
+   memcpy(&frame[numHeaderLen], &header[0], rmfHeaderLen);
+   memcpy(&frame[numHeaderLen+rmfHeaderLen], &value[0], sizeof(value));
+   CuAssertIntEquals(tc, 0, apx_frameAccumulator_append(&requesterConnection->frameAccumulator, &frame[0], (uint32_t) (numHeaderLen+rmfHeaderLen+sizeof(value))));
+   for (i=0; (i<1000) && (data == 0); i++)
+   {
+      SLEEP(1);
+      CuAssertTrue(tc, reactorClientReceive(&requester->pendingClient, sockfd) >= 0);
+      data = clientFindWrite(requester, inDataFileInfo.address, &dataLen);
+   }
+   CuAssertPtrNotNull(tc, data);
+   CuAssertIntEquals(tc, sizeof(value), dataLen);
+   CuAssertIntEquals(tc, 0, memcmp(data, &value[0], sizeof(value)));
+   apx_serverConnection_getSendStats(requesterConnection, &stats);
+   CuAssertUIntEquals(tc, numTimeFlushes+1, stats.numTimeFlushes);
+   apx_testServer_destroy(&server);
+   close(sockfd);
+}
+#endif
+
+static void clientSendMessage(testsocket_t *socket, uint32_t address, const uint8_t *data, int32_t dataLen, bool more_bit)
+{
+   uint8_t header[RMF_MAX_HEADER_SIZE];
+   uint8_t *msgBuffer;
+   int32_t rmfHeaderLen;
+   int32_t numHeaderLen;
+   rmfHeaderLen = rmf_packHeader(&header[0], sizeof(header), address, more_bit);
+   msgBuffer = (uint8_t*) malloc(sizeof(uint32_t)+rmfHeaderLen+dataLen);
+   assert(msgBuffer != 0);
+   numHeaderLen = rmf_packNumHeader(&msgBuffer[0], sizeof(uint32_t), (uint32_t) (rmfHeaderLen+dataLen), (uint8_t) sizeof(uint32_t));
+   memcpy(&msgBuffer[numHeaderLen], &header[0], rmfHeaderLen);
+   memcpy(&msgBuffer[numHeaderLen+rmfHeaderLen], data, dataLen);
+   testsocket_clientSend(socket, msgBuffer, numHeaderLen+rmfHeaderLen+dataLen);
+   free(msgBuffer);
+}
+
+static void clientSendFileInfo(testsocket_t *socket, const char *name, uint32_t address, uint32_t length, const uint8_t *digest)
+{
+   uint8_t msgBuffer[256];
+   rmf_fileInfo_t fileInfo;
+   int32_t msgLen;
+   rmf_fileInfo_create(&fileInfo, name, address, length, RMF_FILE_TYPE_FIXED);
+   if (digest != 0)
+   {
+      rmf_fileInfo_setDigestData(&fileInfo, RMF_DIGEST_TYPE_SHA256, digest, RMF_DIGEST_SIZE);
+   }
+   msgLen = rmf_serialize_cmdFileInfo(&msgBuffer[0], sizeof(msgBuffer), &fileInfo);
+   rmf_fileInfo_destroy(&fileInfo);
+   clientSendMessage(socket, RMF_CMD_START_ADDR, &msgBuffer[0], msgLen, false);
+}
+
+static void clientSendFileOpen(testsocket_t *socket, uint32_t address)
+{
+   uint8_t msgBuffer[RMF_FILE_OPEN_CMD_LEN];
+   rmf_cmdOpenFile_t cmdOpenFile;
+   int32_t msgLen;
+   cmdOpenFile.address = address;
+   msgLen = rmf_serialize_cmdOpenFile(&msgBuffer[0], sizeof(msgBuffer), &cmdOpenFile);
+   clientSendMessage(socket, RMF_CMD_START_ADDR, &msgBuffer[0], msgLen, false);
+}
+
+/**
+ * greeting without headers
+ */
+static void clientSendGreeting(testsocket_t *socket)
+{
+   uint8_t greeting[RMF_GREETING_MAX_LEN+1];
+   greeting[0] = (uint8_t) (strlen(RMF_GREETING_START)+1);
+   strcpy((char*) &greeting[1], RMF_GREETING_START "\n");
+   testsocket_clientSend(socket, greeting, 1+greeting[0]);
+}
+
+/**
+ * greeting of a client that understands RMF_CMD_MULTI_WRITE
+ */
+static void clientSendMultiWriteGreeting(testsocket_t *socket)
+{
+   uint8_t greeting[RMF_GREETING_MAX_LEN+1];
+   greeting[0] = (uint8_t) (strlen(RMF_GREETING_START)+strlen(RMF_MULTI_WRITE " 1\n")+1);
+   strcpy((char*) &greeting[1], RMF_GREETING_START RMF_MULTI_WRITE " 1\n\n");
+   testsocket_clientSend(socket, greeting, 1+greeting[0]);
+}
+
+/**
+ * uploads a definition containing a single node, the .out file of the node is announced first.
+ * The definition is announced with its digest, like the client does. It's only sent if the server opens the file
+ */
+static void clientAddNode(testsocket_t *socket, const char *definition, const char *nodeName, uint32_t definitionAddress, uint32_t outAddress, uint32_t outPortDataLen)
+{
+   char fileName[RMF_MAX_FILE_NAME+1];
+   uint8_t digest[SHA256_DIGEST_SIZE];
+   uint32_t definitionLen = (uint32_t) strlen(definition);
+   if (outPortDataLen > 0)
+   {
+      sprintf(fileName, "%s.out", nodeName);
+      clientSendFileInfo(socket, fileName, outAddress, outPortDataLen, (const uint8_t*) 0);
+   }
+   sha256_calc((const uint8_t*) definition, definitionLen, &digest[0]);
+   sprintf(fileName, "%s.apx", nodeName);
+   clientSendFileInfo(socket, fileName, definitionAddress, definitionLen, &digest[0]);
+   testSocket_run(socket);
+   SLEEP(10);
+   if (clientFindFileOpen(socket, definitionAddress) == false)
+   {
+      return;
+   }
+   clientSendMessage(socket, definitionAddress, (const uint8_t*) definition, (int32_t) definitionLen, false);
+   testSocket_run(socket);
+   SLEEP(10);
+}
+
+/**
+ * opens the .in file the server has announced, the server then sends the initial port values
+ */
+static void clientOpenInPortDataFile(CuTest* tc, testsocket_t *socket, const char *name, rmf_fileInfo_t *fileInfo)
+{
+   CuAssertTrue(tc, clientFindFileInfo(socket, name, fileInfo));
+   clientSendFileOpen(socket, fileInfo->address);
+   testSocket_run(socket);
+   SLEEP(10);
+}
+
+/**
+ * steps through the messages the server has sent to the client, returns false when there are no more complete messages
+ */
+static bool clientNextMessage(testsocket_t *socket, int32_t *pos, rmf_msg_t *msg)
+{
+   const uint8_t *data = adt_bytearray_data(&socket->pendingClient);
+   int32_t dataLen = (int32_t) adt_bytearray_length(&socket->pendingClient);
+   uint32_t msgLen;
+   int32_t headerLen;
+   if (*pos >= dataLen)
+   {
+      return false;
+   }
+   headerLen = rmf_unpackNumHeader(&data[*pos], dataLen-*pos, &msgLen, (uint8_t) sizeof(uint32_t));
+   if ( (headerLen <= 0) || ((*pos+headerLen+(int32_t) msgLen) > dataLen) )
+   {
+      return false;
+   }
+   if (rmf_unpackMsg(&data[*pos+headerLen], (int32_t) msgLen, msg) <= 0)
+   {
+      return false;
+   }
+   *pos += headerLen+(int32_t) msgLen;
+   return true;
+}
+
+static bool clientFindFileInfo(testsocket_t *socket, const char *name, rmf_fileInfo_t *fileInfo)
+{
+   int32_t pos = 0;
+   rmf_msg_t msg;
+   while (clientNextMessage(socket, &pos, &msg) == true)
+   {
+      uint32_t cmdType;
+      if ( (msg.address == RMF_CMD_START_ADDR) && (rmf_deserialize_cmdType(msg.data, msg.dataLen, &cmdType) > 0) && (cmdType == RMF_CMD_FILE_INFO) )
+      {
+         if ( (rmf_deserialize_cmdFileInfo(msg.data, msg.dataLen, fileInfo) > 0) && (strcmp(fileInfo->name, name) == 0) )
+         {
+            return true;
+         }
+      }
+   }
+   return false;
+}
+
+static bool clientFindFileOpen(testsocket_t *socket, uint32_t address)
+{
+   int32_t pos = 0;
+   rmf_msg_t msg;
+   while (clientNextMessage(socket, &pos, &msg) == true)
+   {
+      uint32_t cmdType;
+      if ( (msg.address == RMF_CMD_START_ADDR) && (rmf_deserialize_cmdType(msg.data, msg.dataLen, &cmdType) > 0) && (cmdType == RMF_CMD_FILE_OPEN) )
+      {
+         rmf_cmdOpenFile_t cmdOpenFile;
+         if ( (rmf_deserialize_cmdOpenFile(msg.data, msg.dataLen, &cmdOpenFile) > 0) && (cmdOpenFile.address == address) )
+         {
+            return true;
+         }
+      }
+   }
+   return false;
+}
+
+/**
+ * returns the data of the last write to address the server has sent to the client, 0 if there is none
+ */
+static const uint8_t *clientFindWrite(testsocket_t *socket, uint32_t address, int32_t *dataLen)
+{
+   const uint8_t *retval = (const uint8_t*) 0;
+   int32_t pos = 0;
+   rmf_msg_t msg;
+   while (clientNextMessage(socket, &pos, &msg) == true)
+   {
+      if (msg.address == address)
+      {
+         retval = msg.data;
+         *dataLen = msg.dataLen;
+      }
+   }
+   return retval;
+}
+
+/**
+ * copies the data of every write into the file that the server has sent to the client into fileData, returns the number of writes
+ */
+static int32_t clientApplyWrites(testsocket_t *socket, const rmf_fileInfo_t *fileInfo, uint8_t *fileData)
+{
+   int32_t numWrites = 0;
+   int32_t pos = 0;
+   rmf_msg_t msg;
+   while (clientNextMessage(socket, &pos, &msg) == true)
+   {
+      uint32_t cmdType;
+      uint32_t baseAddress;
+      if ( (msg.address == RMF_CMD_START_ADDR) && (rmf_deserialize_cmdType(msg.data, msg.dataLen, &cmdType) > 0) && (cmdType == RMF_CMD_MULTI_WRITE) &&
+           (rmf_deserialize_cmdMultiWrite(msg.data, msg.dataLen, &baseAddress) == RMF_MULTI_WRITE_CMD_LEN) )
+      {
+         //each record is a write of its own
+         const uint8_t *pNext = msg.data + RMF_MULTI_WRITE_CMD_LEN;
+         const uint8_t *pEnd = msg.data + msg.dataLen;
+         while (pNext < pEnd)
+         {
+            rmf_msg_t record;
+            int32_t result = rmf_deserialize_multiWriteRecord(pNext, (int32_t) (pEnd-pNext), baseAddress, &record);
+            if (result <= 0)
+            {
+               break;
+            }
+            if ( (record.address >= fileInfo->address) && ((record.address + (uint32_t) record.dataLen) <= (fileInfo->address + fileInfo->length)) )
+            {
+               memcpy(&fileData[record.address - fileInfo->address], record.data, record.dataLen);
+               numWrites++;
+            }
+            pNext += result;
+         }
+      }
+      else if ( (msg.address >= fileInfo->address) && ((msg.address + (uint32_t) msg.dataLen) <= (fileInfo->address + fileInfo->length)) )
+      {
+         memcpy(&fileData[msg.address - fileInfo->address], msg.data, msg.dataLen);
+         numWrites++;
+      }
+      else
+      {
+         //MISRA
+      }
+   }
+   return numWrites;
+}
+
+static apx_serverConnection_t *getConnection(apx_testServer_t *server, testsocket_t *socket)
+{
+   adt_list_elem_t *pIter;
+   adt_list_iter_init(&server->connections);
+   for (pIter = adt_list_iter_next(&server->connections); pIter != 0; pIter = adt_list_iter_next(&server->connections))
+   {
+      apx_serverConnection_t *connection = (apx_serverConnection_t*) pIter->pItem;
+      if (connection->testsocket == socket)
+      {
+         return connection;
+      }
+   }
+   return (apx_serverConnection_t*) 0;
+}
+
+#if APX_SERVER_REACTOR_ENABLE
+/**
+ * connects a requester served by the reactor of server, uploads its definition and opens its .in file.
+ * returns the client end of the connection
+ */
+static int reactorConnectRequester(CuTest* tc, apx_testServer_t *server, testsocket_t *socket, const char *definition, const char *nodeName, rmf_fileInfo_t *inDataFileInfo)
+{
+   char fileName[RMF_MAX_FILE_NAME+1];
+   uint8_t digest[SHA256_DIGEST_SIZE];
+   uint32_t definitionLen = (uint32_t) strlen(definition);
+   int sockfd = apx_testServer_acceptReactor(server, socket);
+   CuAssertTrue(tc, sockfd >= 0);
+   clientSendGreeting(socket);
+   sha256_calc((const uint8_t*) definition, definitionLen, &digest[0]);
+   sprintf(fileName, "%s.apx", nodeName);
+   clientSendFileInfo(socket, fileName, DEFINITION_ADDRESS, definitionLen, &digest[0]);
+   reactorClientRun(socket, sockfd);
+   CuAssertTrue(tc, clientFindFileOpen(socket, DEFINITION_ADDRESS));
+   clientSendMessage(socket, DEFINITION_ADDRESS, (const uint8_t*) definition, (int32_t) definitionLen, false);
+   reactorClientRun(socket, sockfd);
+   sprintf(fileName, "%s.in", nodeName);
+   CuAssertTrue(tc, clientFindFileInfo(socket, fileName, inDataFileInfo));
+   clientSendFileOpen(socket, inDataFileInfo->address);
+   reactorClientRun(socket, sockfd);
+   return sockfd;
+}
+
+/**
+ * writes what the client has sent to socket into sockfd, then collects the response of the server in the pendingClient buffer of socket
+ */
+static void reactorClientRun(testsocket_t *socket, int sockfd)
+{
+   const uint8_t *data = adt_bytearray_data(&socket->pendingServer);
+   uint32_t dataLen = adt_bytearray_length(&socket->pendingServer);
+   while (dataLen > 0)
+   {
+      ssize_t sendLen = send(sockfd, data, dataLen, 0);
+      if (sendLen <= 0)
+      {
+         break;
+      }
+      data += sendLen;
+      dataLen -= (uint32_t) sendLen;
+   }
+   adt_bytearray_clear(&socket->pendingServer);
+   SLEEP(10);
+   (void) reactorClientReceive(&socket->pendingClient, sockfd);
+}
+
+/**
+ * appends the data waiting in sockfd to received without blocking.
+ * returns the number of bytes received, -1 when the server has closed the connection
+ */
+static int32_t reactorClientReceive(adt_bytearray_t *received, int sockfd)
+{
+   uint8_t buf[4096];
+   int32_t totalLen = 0;
+   for(;;)
+   {
+      ssize_t recvLen = recv(sockfd, &buf[0], sizeof(buf), MSG_DONTWAIT);
+      if (recvLen > 0)
+      {
+         adt_bytearray_append(received, &buf[0], (uint32_t) recvLen);
+         totalLen += (int32_t) recvLen;
+      }
+      else if (recvLen == 0)
+      {
+         return -1;
+      }
+      else
+      {
+         break;
+      }
+   }
+   return totalLen;
+}
+
+static uint32_t reactorGetOutputLen(apx_serverConnection_t *connection)
+{
+   uint32_t retval;
+   MUTEX_LOCK(connection->outputLock);
+   retval = adt_bytearray_length(&connection->outputBuffer);
+   MUTEX_UNLOCK(connection->outputLock);
+   return retval;
+}
+#endif
+
+/**
+ * nothing to wake up, the test calls apx_fileManager_processMessages itself
+ */
+static void externalWakeup(void *arg)
+{
+   (void) arg;
+}
+
+/**
+ * connects a provider and a requester of the same port and returns the time in microseconds until a write of the provider has been sent to the requester
+ */
+static uint32_t routedWriteLatency(CuTest* tc, bool isDirectDispatchEnabled)
+{
+   apx_testServer_t server;
+   testsocket_t *provider;
+   testsocket_t *requester;
+   rmf_fileInfo_t inDataFileInfo;
+   const uint8_t value[2] = {0x34, 0x12};
+   const uint8_t *data = (const uint8_t*) 0;
+   int32_t dataLen = 0;
+   uint32_t startTime;
+   uint32_t elapsed = 0;
+   provider = testsocket_new();
+   requester = testsocket_new();
+   apx_testServer_create(&server);
+   apx_testServer_setDirectDispatch(&server, isDirectDispatchEnabled);
+   apx_testServer_accept(&server, provider);
+   apx_testServer_accept(&server, requester);
+   clientSendGreeting(provider);
+   clientAddNode(provider, m_providerDefinition, "Provider", DEFINITION_ADDRESS, 0, sizeof(value));
+   clientSendGreeting(requester);
+   clientAddNode(requester, m_requesterDefinition, "Requester", DEFINITION_ADDRESS, 0, 0);
+   clientOpenInPortDataFile(tc, requester, "Requester.in", &inDataFileInfo);
+   CuAssertIntEquals(tc, sizeof(value), inDataFileInfo.length);
+   adt_bytearray_clear(&requester->pendingClient);
+   startTime = getTimeUs();
+   clientSendMessage(provider, 0, &value[0], sizeof(value), false);
+   testSocket_run(provider);
+   while ( (data == 0) && (elapsed < 1000000u) )
+   {
+      if (adt_bytearray_length(&requester->pendingClient) > 0)
+      {
+         data = clientFindWrite(requester, inDataFileInfo.address, &dataLen);
+      }
+      elapsed = getTimeUs() - startTime;
+   }
+   CuAssertPtrNotNull(tc, data);
+   CuAssertIntEquals(tc, sizeof(value), dataLen);
+   CuAssertIntEquals(tc, 0, memcmp(data, &value[0], sizeof(value)));
+   apx_testServer_destroy(&server);
+   return elapsed;
+}
+
+static uint32_t getTimeUs(void)
+{
+#ifdef _WIN32
+   return (uint32_t) (GetTickCount()*1000u);
+#else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint32_t) ( (ts.tv_sec * 1000000u) + (ts.tv_nsec / 1000u) );
+#endif
+}
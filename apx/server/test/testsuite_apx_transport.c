@@ -0,0 +1,333 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "CuTest.h"
+#include "rmf.h"
+#include "headerutil.h"
+#ifndef _MSC_VER
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <time.h>
+#endif
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _MSC_VER
+#define APX_TEST_SOCKET_PATH "/tmp/apx_test_transport.socket"
+#define APX_TEST_FRAME_DATA_LEN 8 //a typical port write, 8 bytes of data after the RMF header
+
+/**
+ * Echoes each received frame back to the sender, stands in for the server side of a connection
+ */
+typedef struct echoServer_tag
+{
+   int listenFd;
+   int numFrames; //number of frames to echo before the thread exits
+}echoServer_t;
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _MSC_VER
+static void test_apx_transport_unixRoundTrip(CuTest* tc);
+#ifdef APX_ENABLE_BENCHMARK
+static void test_apx_transport_benchmark(CuTest* tc);
+#endif
+static int transport_listen(int addressFamily, uint16_t *port);
+static int transport_connect(int addressFamily, uint16_t port);
+static int32_t transport_packFrame(uint8_t *buf, uint32_t bufLen, uint32_t address, uint8_t value);
+static int transport_readAll(int fd, uint8_t *buf, int32_t len);
+static int transport_writeAll(int fd, const uint8_t *buf, int32_t len);
+static int32_t transport_roundTrips(int addressFamily, int numFrames, double *elapsedSec, double *cpuSec);
+static void *echoServer_task(void *arg);
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+
+CuSuite* testSuite_apx_transport(void)
+{
+   CuSuite* suite = CuSuiteNew();
+
+#ifndef _MSC_VER
+   SUITE_ADD_TEST(suite, test_apx_transport_unixRoundTrip);
+#ifdef APX_ENABLE_BENCHMARK
+   SUITE_ADD_TEST(suite, test_apx_transport_benchmark);
+#endif
+#endif
+
+   return suite;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+#ifndef _MSC_VER
+static void test_apx_transport_unixRoundTrip(CuTest* tc)
+{
+   double elapsedSec;
+   double cpuSec;
+   CuAssertIntEquals(tc, 10, transport_roundTrips(AF_LOCAL, 10, &elapsedSec, &cpuSec));
+}
+
+#ifdef APX_ENABLE_BENCHMARK
+/**
+ * compares round trip latency and CPU time of RMF framed port writes over TCP loopback and unix domain sockets.
+ * This is the path taken by a client on the same host as the server, using apx_client_connect_tcp or apx_client_connect_unix.
+ */
+static void test_apx_transport_benchmark(CuTest* tc)
+{
+   int numFrames = 50000;
+   double tcpElapsed;
+   double tcpCpu;
+   double unixElapsed;
+   double unixCpu;
+   CuAssertIntEquals(tc, numFrames, transport_roundTrips(AF_INET, numFrames, &tcpElapsed, &tcpCpu));
+   CuAssertIntEquals(tc, numFrames, transport_roundTrips(AF_LOCAL, numFrames, &unixElapsed, &unixCpu));
+   printf("[apx_transport] %d round trips, TCP loopback: %.2f us/trip (cpu %.2f us), unix socket: %.2f us/trip (cpu %.2f us)\n", numFrames,
+         tcpElapsed*1000000.0/numFrames, tcpCpu*1000000.0/numFrames, unixElapsed*1000000.0/numFrames, unixCpu*1000000.0/numFrames);
+}
+#endif
+
+/**
+ * creates a listening socket. For AF_INET an ephemeral port on the loopback interface is selected and returned in port.
+ * returns the socket or -1 on error
+ */
+static int transport_listen(int addressFamily, uint16_t *port)
+{
+   int fd = socket(addressFamily, SOCK_STREAM, 0);
+   if (fd >= 0)
+   {
+      int result;
+      if (addressFamily == AF_LOCAL)
+      {
+         struct sockaddr_un addr;
+         memset(&addr, 0, sizeof(addr));
+         addr.sun_family = AF_LOCAL;
+         strcpy(addr.sun_path, APX_TEST_SOCKET_PATH);
+         (void) unlink(APX_TEST_SOCKET_PATH);
+         result = bind(fd, (struct sockaddr*) &addr, sizeof(addr));
+      }
+      else
+      {
+         struct sockaddr_in addr;
+         socklen_t addrLen = sizeof(addr);
+         memset(&addr, 0, sizeof(addr));
+         addr.sin_family = AF_INET;
+         addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+         addr.sin_port = 0;
+         result = bind(fd, (struct sockaddr*) &addr, sizeof(addr));
+         if (result == 0)
+         {
+            result = getsockname(fd, (struct sockaddr*) &addr, &addrLen);
+            *port = ntohs(addr.sin_port);
+         }
+      }
+      if ( (result == 0) && (listen(fd, 1) == 0) )
+      {
+         return fd;
+      }
+      close(fd);
+   }
+   return -1;
+}
+
+static int transport_connect(int addressFamily, uint16_t port)
+{
+   int fd = socket(addressFamily, SOCK_STREAM, 0);
+   if (fd >= 0)
+   {
+      int result;
+      if (addressFamily == AF_LOCAL)
+      {
+         struct sockaddr_un addr;
+         memset(&addr, 0, sizeof(addr));
+         addr.sun_family = AF_LOCAL;
+         strcpy(addr.sun_path, APX_TEST_SOCKET_PATH);
+         result = connect(fd, (struct sockaddr*) &addr, sizeof(addr));
+      }
+      else
+      {
+         int flag = 1;
+         struct sockaddr_in addr;
+         memset(&addr, 0, sizeof(addr));
+         addr.sin_family = AF_INET;
+         addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+         addr.sin_port = htons(port);
+         (void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+         result = connect(fd, (struct sockaddr*) &addr, sizeof(addr));
+      }
+      if (result == 0)
+      {
+         return fd;
+      }
+      close(fd);
+   }
+   return -1;
+}
+
+/**
+ * encodes a complete data message the way the server sends it: message length, RMF header, data
+ * returns length of the frame
+ */
+static int32_t transport_packFrame(uint8_t *buf, uint32_t bufLen, uint32_t address, uint8_t value)
+{
+   uint8_t msg[RMF_MAX_HEADER_SIZE+APX_TEST_FRAME_DATA_LEN];
+   int32_t msgLen = rmf_packHeader(msg, (int32_t) sizeof(msg), address, false);
+   uint8_t *pNext;
+   memset(&msg[msgLen], value, APX_TEST_FRAME_DATA_LEN);
+   msgLen += APX_TEST_FRAME_DATA_LEN;
+   pNext = headerutil_numEncode32(buf, bufLen, (uint32_t) msgLen);
+   memcpy(pNext, msg, msgLen);
+   return (int32_t) (pNext-buf)+msgLen;
+}
+
+static int transport_readAll(int fd, uint8_t *buf, int32_t len)
+{
+   while (len > 0)
+   {
+      ssize_t result = recv(fd, buf, (size_t) len, 0);
+      if (result <= 0)
+      {
+         return -1;
+      }
+      buf += result;
+      len -= (int32_t) result;
+   }
+   return 0;
+}
+
+static int transport_writeAll(int fd, const uint8_t *buf, int32_t len)
+{
+   while (len > 0)
+   {
+      ssize_t result = send(fd, buf, (size_t) len, 0);
+      if (result <= 0)
+      {
+         return -1;
+      }
+      buf += result;
+      len -= (int32_t) result;
+   }
+   return 0;
+}
+
+/**
+ * sends numFrames frames one at a time, each one is echoed back before the next is sent.
+ * returns number of successful round trips
+ */
+static int32_t transport_roundTrips(int addressFamily, int numFrames, double *elapsedSec, double *cpuSec)
+{
+   echoServer_t echoServer;
+   pthread_t echoThread;
+   uint16_t port = 0;
+   int32_t numOk = 0;
+   echoServer.numFrames = numFrames;
+   echoServer.listenFd = transport_listen(addressFamily, &port);
+   if (echoServer.listenFd >= 0)
+   {
+      if (pthread_create(&echoThread, 0, echoServer_task, &echoServer) == 0)
+      {
+         int fd = transport_connect(addressFamily, port);
+         if (fd >= 0)
+         {
+            int i;
+            uint8_t sendBuf[32];
+            uint8_t recvBuf[32];
+            struct timespec start;
+            struct timespec stop;
+            clock_t cpuStart = clock();
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (i=0; i<numFrames; i++)
+            {
+               int32_t frameLen = transport_packFrame(sendBuf, (uint32_t) sizeof(sendBuf), 0x1000u + (uint32_t) i % 100u, (uint8_t) i);
+               if ( (transport_writeAll(fd, sendBuf, frameLen) != 0) || (transport_readAll(fd, recvBuf, frameLen) != 0) )
+               {
+                  break;
+               }
+               if (memcmp(sendBuf, recvBuf, frameLen) == 0)
+               {
+                  numOk++;
+               }
+            }
+            clock_gettime(CLOCK_MONOTONIC, &stop);
+            //clock() measures CPU time of the whole process, both sides of the connection are included
+            *cpuSec = ((double) (clock()-cpuStart)) / CLOCKS_PER_SEC;
+            *elapsedSec = (double) (stop.tv_sec - start.tv_sec) + ((double) (stop.tv_nsec - start.tv_nsec) / 1000000000.0);
+            close(fd);
+         }
+         else
+         {
+            //wake up the echo thread waiting in accept
+            shutdown(echoServer.listenFd, SHUT_RDWR);
+         }
+         pthread_join(echoThread, 0);
+      }
+      close(echoServer.listenFd);
+      if (addressFamily == AF_LOCAL)
+      {
+         (void) unlink(APX_TEST_SOCKET_PATH);
+      }
+   }
+   return numOk;
+}
+
+static void *echoServer_task(void *arg)
+{
+   echoServer_t *self = (echoServer_t*) arg;
+   int fd = accept(self->listenFd, 0, 0);
+   if (fd >= 0)
+   {
+      int i;
+      int flag = 1;
+      uint8_t buf[32];
+      (void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag)); //fails harmlessly on unix domain sockets
+      for (i=0; i<self->numFrames; i++)
+      {
+         uint32_t msgLen = 0;
+         //frames in this test are short, their length is always encoded in a single byte
+         if (transport_readAll(fd, buf, 1) != 0)
+         {
+            break;
+         }
+         if ( (headerutil_numDecode32(buf, &buf[1], &msgLen) != &buf[1]) || (msgLen > (sizeof(buf)-1)) || (transport_readAll(fd, &buf[1], (int32_t) msgLen) != 0) )
+         {
+            break;
+         }
+         if (transport_writeAll(fd, buf, 1+(int32_t) msgLen) != 0)
+         {
+            break;
+         }
+      }
+      close(fd);
+   }
+   return 0;
+}
+#endif
@@ -44,6 +44,8 @@
 #define RMF_CMD_FILE_OPEN          (uint32_t) 10  //opens a file
 #define RMF_CMD_FILE_CLOSE         (uint32_t) 11  //closes a file
 #define RMF_CMD_FILE_READ          (uint32_t) 12  //read parts of an open file (TBD)
+#define RMF_CMD_MULTI_WRITE        (uint32_t) 13  //several small writes into one file packed into one message (negotiated, see RMF_MULTI_WRITE)
+#define RMF_CMD_NUMHEADER_FORMAT   (uint32_t) 14  //server accepts the NumHeader-Format requested in the greeting, sent before the acknowledge
 #define RMF_CMD_INVALID_MSG        (uint32_t) 0xFFFFFFFF //invalid command (default value)
 
 #define RMF_DIGEST_SIZE          32u //32 bytes is suitable for storing a sha256 hash
@@ -62,7 +64,20 @@
 
 #define RMF_GREETING_MAX_LEN 127
 #define RMF_GREETING_START "RMFP/1.0\n"
-#define RMF_NUMHEADER_FORMAT "NumHeader-Format:"
+#define RMF_NUMHEADER_FORMAT "NumHeader-Format:" //greeting header line "NumHeader-Format: 16" requests 16-bit message length headers
+#define RMF_NUMHEADER_FORMAT_16 16u //message lengths are encoded with headerutil_numEncode16 (1 or 2 bytes)
+#define RMF_NUMHEADER_FORMAT_32 32u //message lengths are encoded with headerutil_numEncode32 (1 or 4 bytes), used unless 16 has been accepted
+#define RMF_NUMHEADER_FORMAT_CMD_LEN 8
+#define RMF_MULTI_WRITE "Multi-Write:" //greeting header line "Multi-Write: 1" is sent by clients that understand RMF_CMD_MULTI_WRITE
+
+/**
+ * RMF_CMD_MULTI_WRITE message: cmdType (4 bytes) and base address (4 bytes) followed by records.
+ * Each record is an offset from the base address and a data length (both encoded as 1 or 2 bytes by headerutil_numEncode16)
+ * followed by the data. A message without records tells the client that the server accepts RMF_CMD_MULTI_WRITE as well.
+ */
+#define RMF_MULTI_WRITE_CMD_LEN 8
+#define RMF_MULTI_WRITE_MAX_RECORD_HEADER_SIZE 4
+#define RMF_MULTI_WRITE_MAX_OFFSET 32767u //writes with a larger offset or length are sent as ordinary data messages
 
 #define RMF_INVALID_ADDRESS (uint32_t) (0xFFFFFFFF)
 /**
@@ -118,7 +133,17 @@ int32_t rmf_deserialize_cmdOpenFile(const uint8_t *buf, int32_t bufLen, rmf_cmdO
 int32_t rmf_serialize_cmdCloseFile(uint8_t *buf, int32_t bufLen, rmf_cmdCloseFile_t *cmdCloseFile);
 int32_t rmf_deserialize_cmdCloseFile(const uint8_t *buf, int32_t bufLen, rmf_cmdCloseFile_t *cmdCloseFile);
 int32_t rmf_deserialize_cmdType(const uint8_t *buf, int32_t bufLen, uint32_t *cmdType);
+int32_t rmf_serialize_cmdMultiWrite(uint8_t *buf, int32_t bufLen, uint32_t baseAddress);
+int32_t rmf_deserialize_cmdMultiWrite(const uint8_t *buf, int32_t bufLen, uint32_t *baseAddress);
+int32_t rmf_packMultiWriteRecordHeader(uint8_t *buf, int32_t bufLen, uint32_t offset, int32_t dataLen);
+int32_t rmf_serialize_multiWriteRecord(uint8_t *buf, int32_t bufLen, uint32_t offset, const uint8_t *data, int32_t dataLen);
+int32_t rmf_deserialize_multiWriteRecord(const uint8_t *buf, int32_t bufLen, uint32_t baseAddress, rmf_msg_t *msg);
+int32_t rmf_serialize_cmdNumHeaderFormat(uint8_t *buf, int32_t bufLen, uint32_t numHeaderFormat);
+int32_t rmf_deserialize_cmdNumHeaderFormat(const uint8_t *buf, int32_t bufLen, uint32_t *numHeaderFormat);
 int32_t rmf_serialize_acknowledge(uint8_t *buf, int32_t bufLen);
+int32_t rmf_packNumHeader(uint8_t *buf, int32_t bufLen, uint32_t msgLen, uint8_t numHeaderMaxLen);
+int32_t rmf_unpackNumHeader(const uint8_t *buf, int32_t bufLen, uint32_t *msgLen, uint8_t numHeaderMaxLen);
+int32_t rmf_getNumHeaderMaxMsgLen(uint8_t numHeaderMaxLen);
 int8_t rmf_fileInfo_create(rmf_fileInfo_t *self, const char *name, uint32_t startAddress, uint32_t length, uint16_t fileType);
 void rmf_fileInfo_destroy(rmf_fileInfo_t *info);
 #ifndef APX_EMBEDDED
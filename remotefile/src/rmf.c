@@ -11,6 +11,7 @@
 #endif
 #include "rmf.h"
 #include "pack.h"
+#include "headerutil.h"
 #ifdef MEM_LEAK_CHECK
 #include "CMemLeak.h"
 #endif
@@ -175,7 +176,8 @@ int32_t rmf_unpackMsg(const uint8_t *buf, int32_t bufLen, rmf_msg_t *msg)
          return 0; //no bytes consumed, retry later
       }
       msg->address = unpackBE(buf, addressLen);
-      msg->address &= RMF_CMD_END_ADDR; //the highest address also happens to be the bit-mask
+      //the highest address of each range also happens to be the bit-mask that removes the high_bit and more_bit
+      msg->address &= high_bit ? RMF_CMD_END_ADDR : RMF_DATA_LOW_MAX_ADDR;
       msg->dataLen=bufLen-addressLen;
       msg->data = &buf[addressLen];
       return bufLen;
@@ -393,6 +395,251 @@ int32_t rmf_deserialize_cmdType(const uint8_t *buf, int32_t bufLen, uint32_t *cm
    return unpackLen;
 }
 
+/**
+ * On failure: returns 0 if buffer is too small, -1 on any other error
+ * On success: returns number of bytes written to buffer
+ */
+int32_t rmf_serialize_cmdMultiWrite(uint8_t *buf, int32_t bufLen, uint32_t baseAddress)
+{
+   if ( (buf != 0) && (baseAddress < RMF_CMD_START_ADDR) )
+   {
+      if (bufLen < RMF_MULTI_WRITE_CMD_LEN)
+      {
+         return 0; //buffer too small
+      }
+      packLE(buf, RMF_CMD_MULTI_WRITE, (uint8_t) sizeof(uint32_t));
+      packLE(buf+sizeof(uint32_t), baseAddress, (uint8_t) sizeof(uint32_t));
+      return RMF_MULTI_WRITE_CMD_LEN;
+   }
+   return -1;
+}
+
+/**
+ * On failure: returns 0 if buffer is too small, -1 on any other error
+ * On success: returns number of bytes parsed from buffer, the records start after these bytes
+ */
+int32_t rmf_deserialize_cmdMultiWrite(const uint8_t *buf, int32_t bufLen, uint32_t *baseAddress)
+{
+   if ( (buf != 0) && (baseAddress != 0) )
+   {
+      uint32_t cmdType;
+      if (bufLen < RMF_MULTI_WRITE_CMD_LEN)
+      {
+         return 0; //buffer too small
+      }
+      cmdType = unpackLE(buf, (uint8_t) sizeof(uint32_t));
+      if (cmdType != RMF_CMD_MULTI_WRITE)
+      {
+         //this is not the right deserializer
+         return -1;
+      }
+      *baseAddress = unpackLE(buf+sizeof(uint32_t), (uint8_t) sizeof(uint32_t));
+      return RMF_MULTI_WRITE_CMD_LEN;
+   }
+   return -1;
+}
+
+/**
+ * encodes the offset and length of an RMF_CMD_MULTI_WRITE record, the caller writes dataLen bytes of data right after the header.
+ * offset and dataLen must not be larger than RMF_MULTI_WRITE_MAX_OFFSET.
+ * On failure: returns 0 if buffer is too small for both header and data, -1 on any other error
+ * On success: returns number of bytes written to buffer
+ */
+int32_t rmf_packMultiWriteRecordHeader(uint8_t *buf, int32_t bufLen, uint32_t offset, int32_t dataLen)
+{
+   if ( (buf != 0) && (bufLen >= 0) && (dataLen > 0) && (offset <= RMF_MULTI_WRITE_MAX_OFFSET) && ((uint32_t) dataLen <= RMF_MULTI_WRITE_MAX_OFFSET) )
+   {
+      uint8_t header[RMF_MULTI_WRITE_MAX_RECORD_HEADER_SIZE];
+      uint8_t *pNext;
+      int32_t headerLen;
+      pNext = headerutil_numEncode16(header, (uint32_t) sizeof(header), (uint16_t) offset);
+      pNext = headerutil_numEncode16(pNext, (uint32_t) (&header[sizeof(header)]-pNext), (uint16_t) dataLen);
+      assert(pNext != 0);
+      headerLen = (int32_t) (pNext-header);
+      if (bufLen < headerLen+dataLen)
+      {
+         return 0; //buffer too small
+      }
+      memcpy(buf, header, headerLen);
+      return headerLen;
+   }
+   return -1;
+}
+
+/**
+ * encodes one record of an RMF_CMD_MULTI_WRITE message.
+ * On failure: returns 0 if buffer is too small, -1 on any other error
+ * On success: returns number of bytes written to buffer
+ */
+int32_t rmf_serialize_multiWriteRecord(uint8_t *buf, int32_t bufLen, uint32_t offset, const uint8_t *data, int32_t dataLen)
+{
+   if (data != 0)
+   {
+      int32_t headerLen = rmf_packMultiWriteRecordHeader(buf, bufLen, offset, dataLen);
+      if (headerLen > 0)
+      {
+         memcpy(buf+headerLen, data, dataLen);
+         return headerLen+dataLen;
+      }
+      return headerLen;
+   }
+   return -1;
+}
+
+/**
+ * decodes one record of an RMF_CMD_MULTI_WRITE message into msg, msg->data points into buf.
+ * Returns number of bytes parsed from buffer or -1 when the record is incomplete or invalid
+ */
+int32_t rmf_deserialize_multiWriteRecord(const uint8_t *buf, int32_t bufLen, uint32_t baseAddress, rmf_msg_t *msg)
+{
+   if ( (buf != 0) && (bufLen > 0) && (msg != 0) )
+   {
+      const uint8_t *pNext = buf;
+      const uint8_t *pEnd = buf+bufLen;
+      uint16_t values[2];
+      int32_t i;
+      for (i=0; i<2; i++)
+      {
+         //headerutil_numDecode16 does not report a truncated 2-byte number
+         if ( (pNext >= pEnd) || ( ((*pNext & 0x80) != 0) && ((pNext+2) > pEnd) ) )
+         {
+            return -1;
+         }
+         pNext = headerutil_numDecode16(pNext, pEnd, &values[i]);
+      }
+      if ( (values[1] == 0) || ((pNext+values[1]) > pEnd) )
+      {
+         return -1;
+      }
+      msg->address = baseAddress + values[0];
+      msg->dataLen = (int32_t) values[1];
+      msg->data = pNext;
+      msg->more_bit = false;
+      return (int32_t) (pNext-buf) + msg->dataLen;
+   }
+   return -1;
+}
+
+/**
+ * On failure: returns 0 if buffer is too small, -1 on any other error
+ * On success: returns number of bytes written to buffer
+ */
+int32_t rmf_serialize_cmdNumHeaderFormat(uint8_t *buf, int32_t bufLen, uint32_t numHeaderFormat)
+{
+   if ( (buf != 0) && ( (numHeaderFormat == RMF_NUMHEADER_FORMAT_16) || (numHeaderFormat == RMF_NUMHEADER_FORMAT_32) ) )
+   {
+      if (bufLen < RMF_NUMHEADER_FORMAT_CMD_LEN)
+      {
+         return 0; //buffer too small
+      }
+      packLE(buf, RMF_CMD_NUMHEADER_FORMAT, (uint8_t) sizeof(uint32_t));
+      packLE(buf+sizeof(uint32_t), numHeaderFormat, (uint8_t) sizeof(uint32_t));
+      return RMF_NUMHEADER_FORMAT_CMD_LEN;
+   }
+   return -1;
+}
+
+/**
+ * On failure: returns 0 if buffer is too small, -1 on any other error
+ * On success: returns number of bytes parsed from buffer
+ */
+int32_t rmf_deserialize_cmdNumHeaderFormat(const uint8_t *buf, int32_t bufLen, uint32_t *numHeaderFormat)
+{
+   if ( (buf != 0) && (numHeaderFormat != 0) )
+   {
+      uint32_t cmdType;
+      if (bufLen < RMF_NUMHEADER_FORMAT_CMD_LEN)
+      {
+         return 0; //buffer too small
+      }
+      cmdType = unpackLE(buf, (uint8_t) sizeof(uint32_t));
+      if (cmdType != RMF_CMD_NUMHEADER_FORMAT)
+      {
+         //this is not the right deserializer
+         return -1;
+      }
+      *numHeaderFormat = unpackLE(buf+sizeof(uint32_t), (uint8_t) sizeof(uint32_t));
+      return RMF_NUMHEADER_FORMAT_CMD_LEN;
+   }
+   return -1;
+}
+
+/**
+ * encodes the length of a message in front of it. numHeaderMaxLen is 2 for RMF_NUMHEADER_FORMAT_16 and 4 for RMF_NUMHEADER_FORMAT_32.
+ * On failure: returns 0 if buffer is too small, -1 on any other error (including a msgLen too large for the header format)
+ * On success: returns number of bytes written to buffer
+ */
+int32_t rmf_packNumHeader(uint8_t *buf, int32_t bufLen, uint32_t msgLen, uint8_t numHeaderMaxLen)
+{
+   if ( (buf != 0) && (bufLen >= 0) )
+   {
+      int32_t maxMsgLen = rmf_getNumHeaderMaxMsgLen(numHeaderMaxLen);
+      uint8_t *pEnd;
+      if ( (maxMsgLen < 0) || (msgLen > (uint32_t) maxMsgLen) )
+      {
+         return -1;
+      }
+      if (bufLen < ( (msgLen <= HEADERUTIL32_MAX_NUM_SHORT)? 1 : (int32_t) numHeaderMaxLen) )
+      {
+         return 0; //buffer too small
+      }
+      if (numHeaderMaxLen == (uint8_t) sizeof(uint16_t))
+      {
+         pEnd = headerutil_numEncode16(buf, (uint32_t) bufLen, (uint16_t) msgLen);
+      }
+      else
+      {
+         pEnd = headerutil_numEncode32(buf, (uint32_t) bufLen, msgLen);
+      }
+      assert(pEnd > buf);
+      return (int32_t) (pEnd-buf);
+   }
+   return -1;
+}
+
+/**
+ * decodes the length of the message starting at buf.
+ * returns the number of header bytes, 0 if more bytes are needed and -1 on error
+ */
+int32_t rmf_unpackNumHeader(const uint8_t *buf, int32_t bufLen, uint32_t *msgLen, uint8_t numHeaderMaxLen)
+{
+   if ( (buf != 0) && (msgLen != 0) && (rmf_getNumHeaderMaxMsgLen(numHeaderMaxLen) >= 0) )
+   {
+      const uint8_t *pResult;
+      if ( (bufLen < 1) || ( ((buf[0] & 0x80) != 0) && (bufLen < (int32_t) numHeaderMaxLen) ) )
+      {
+         return 0;
+      }
+      if (numHeaderMaxLen == (uint8_t) sizeof(uint16_t))
+      {
+         uint16_t value;
+         pResult = headerutil_numDecode16(buf, buf+bufLen, &value);
+         *msgLen = value;
+      }
+      else
+      {
+         pResult = headerutil_numDecode32(buf, buf+bufLen, msgLen);
+      }
+      return (int32_t) (pResult-buf);
+   }
+   return -1;
+}
+
+/**
+ * returns the length of the largest message that can be sent with the header format, -1 if numHeaderMaxLen is neither 2 nor 4
+ */
+int32_t rmf_getNumHeaderMaxMsgLen(uint8_t numHeaderMaxLen)
+{
+   if (numHeaderMaxLen == (uint8_t) sizeof(uint16_t))
+   {
+      return (int32_t) HEADERUTIL16_MAX_NUM_LONG;
+   }
+   else if (numHeaderMaxLen == (uint8_t) sizeof(uint32_t))
+   {
+      return (int32_t) HEADERUTIL32_MAX_NUM_LONG;
+   }
+   return -1;
+}
 
 int8_t rmf_fileInfo_create(rmf_fileInfo_t *self, const char *name, uint32_t startAddress, uint32_t length, uint16_t fileType)
 {
@@ -459,7 +706,7 @@ void rmf_fileInfo_vdelete(void *arg)
  */
 int8_t rmf_fileInfo_setDigestData(rmf_fileInfo_t *info, uint16_t digestType, const uint8_t *digestData, uint32_t digestDataLen)
 {
-   if ( (info != 0) && (digestType <= RMF_FILE_TYPE_STREAM) && (digestData != 0) && ( (digestDataLen == 0) || (digestDataLen == RMF_DIGEST_SIZE) ) )
+   if ( (info != 0) && (digestType <= RMF_DIGEST_TYPE_SHA256) && (digestData != 0) && ( (digestDataLen == 0) || (digestDataLen == RMF_DIGEST_SIZE) ) )
    {
       info->digestType = digestType;
       memcpy(info->digestData, digestData, RMF_DIGEST_SIZE);
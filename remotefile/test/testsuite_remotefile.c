@@ -9,6 +9,7 @@
 #include "CuTest.h"
 #include "rmf.h"
 #include "pack.h"
+#include "headerutil.h"
 #ifdef MEM_LEAK_CHECK
 #include "CMemLeak.h"
 #endif
@@ -24,6 +25,9 @@
 static void test_rmf_cmdFileInfo_serialize(CuTest* tc);
 static void test_rmf_cmdOpenFile_serialize(CuTest* tc);
 static void test_rmf_cmdCloseFile_serialize(CuTest* tc);
+static void test_rmf_cmdMultiWrite_serialize(CuTest* tc);
+static void test_rmf_numHeader(CuTest* tc);
+static void test_rmf_unpackMsg_moreBit(CuTest* tc);
 
 //////////////////////////////////////////////////////////////////////////////
 // GLOBAL VARIABLES
@@ -46,6 +50,9 @@ CuSuite* testSuite_remotefile(void)
    SUITE_ADD_TEST(suite, test_rmf_cmdFileInfo_serialize);
    SUITE_ADD_TEST(suite, test_rmf_cmdOpenFile_serialize);
    SUITE_ADD_TEST(suite, test_rmf_cmdCloseFile_serialize);
+   SUITE_ADD_TEST(suite, test_rmf_cmdMultiWrite_serialize);
+   SUITE_ADD_TEST(suite, test_rmf_numHeader);
+   SUITE_ADD_TEST(suite, test_rmf_unpackMsg_moreBit);
 
    return suite;
 }
@@ -127,3 +134,104 @@ static void test_rmf_cmdCloseFile_serialize(CuTest* tc)
    result = rmf_deserialize_cmdCloseFile(buf,result,&cmd2);
    CuAssertUIntEquals(tc, cmd.address, cmd2.address);
 }
+
+static void test_rmf_cmdMultiWrite_serialize(CuTest* tc)
+{
+   uint8_t buf[64];
+   uint8_t data1[2] = {0x12, 0x34};
+   uint8_t data2[200];
+   uint8_t *p;
+   int32_t bufLen = (int32_t) sizeof(buf);
+   int32_t msgLen;
+   int32_t result;
+   uint32_t baseAddress;
+   rmf_msg_t msg;
+   memset(data2, 0xAA, sizeof(data2));
+
+   result = rmf_serialize_cmdMultiWrite(buf, bufLen, 0x10000);
+   CuAssertIntEquals(tc, RMF_MULTI_WRITE_CMD_LEN, result);
+   p=buf;
+   CuAssertUIntEquals(tc,RMF_CMD_MULTI_WRITE,unpackLE(p,4)); p+=4;
+   CuAssertUIntEquals(tc,0x10000,unpackLE(p,4)); p+=4;
+   msgLen = result;
+   //short offset and length use one byte each
+   result = rmf_serialize_multiWriteRecord(&buf[msgLen], bufLen-msgLen, 5, data1, (int32_t) sizeof(data1));
+   CuAssertIntEquals(tc, 4, result);
+   CuAssertUIntEquals(tc, 5, buf[msgLen]);
+   CuAssertUIntEquals(tc, 2, buf[msgLen+1]);
+   msgLen += result;
+   result = rmf_serialize_multiWriteRecord(&buf[msgLen], bufLen-msgLen, 1000, data1, 1);
+   CuAssertIntEquals(tc, 4, result);
+   msgLen += result;
+   CuAssertIntEquals(tc, 0, rmf_serialize_multiWriteRecord(&buf[msgLen], bufLen-msgLen, 0, data2, (int32_t) sizeof(data2)));
+   CuAssertIntEquals(tc, -1, rmf_serialize_multiWriteRecord(&buf[msgLen], bufLen-msgLen, RMF_MULTI_WRITE_MAX_OFFSET+1, data1, 1));
+
+   result = rmf_deserialize_cmdMultiWrite(buf, msgLen, &baseAddress);
+   CuAssertIntEquals(tc, RMF_MULTI_WRITE_CMD_LEN, result);
+   CuAssertUIntEquals(tc, 0x10000, baseAddress);
+   p = &buf[result];
+   result = rmf_deserialize_multiWriteRecord(p, (int32_t) (&buf[msgLen]-p), baseAddress, &msg);
+   CuAssertIntEquals(tc, 4, result);
+   CuAssertUIntEquals(tc, 0x10005, msg.address);
+   CuAssertIntEquals(tc, 2, msg.dataLen);
+   CuAssertUIntEquals(tc, 0x34, msg.data[1]);
+   p+=result;
+   result = rmf_deserialize_multiWriteRecord(p, (int32_t) (&buf[msgLen]-p), baseAddress, &msg);
+   CuAssertIntEquals(tc, 4, result);
+   CuAssertUIntEquals(tc, 0x10000+1000, msg.address);
+   CuAssertIntEquals(tc, 1, msg.dataLen);
+   CuAssertUIntEquals(tc, 0x12, msg.data[0]);
+   p+=result;
+   CuAssertPtrEquals(tc, &buf[msgLen], p);
+   //truncated records are rejected
+   CuAssertIntEquals(tc, -1, rmf_deserialize_multiWriteRecord(&buf[msgLen-4], 3, baseAddress, &msg));
+   CuAssertIntEquals(tc, -1, rmf_deserialize_multiWriteRecord(&buf[msgLen-4], 1, baseAddress, &msg));
+   //a message with another command is not a multi-write message
+   packLE(buf, RMF_CMD_FILE_OPEN, 4);
+   CuAssertIntEquals(tc, -1, rmf_deserialize_cmdMultiWrite(buf, RMF_MULTI_WRITE_CMD_LEN, &baseAddress));
+}
+
+static void test_rmf_numHeader(CuTest* tc)
+{
+   uint8_t buf[RMF_NUMHEADER_FORMAT_CMD_LEN];
+   uint32_t value;
+   //short lengths are encoded the same way in both formats
+   CuAssertIntEquals(tc, 1, rmf_packNumHeader(buf, (int32_t) sizeof(buf), 127, (uint8_t) sizeof(uint16_t)));
+   CuAssertUIntEquals(tc, 127, buf[0]);
+   CuAssertIntEquals(tc, 1, rmf_unpackNumHeader(buf, 1, &value, (uint8_t) sizeof(uint32_t)));
+   CuAssertUIntEquals(tc, 127, value);
+   CuAssertIntEquals(tc, 2, rmf_packNumHeader(buf, (int32_t) sizeof(buf), 300, (uint8_t) sizeof(uint16_t)));
+   CuAssertIntEquals(tc, 0, rmf_unpackNumHeader(buf, 1, &value, (uint8_t) sizeof(uint16_t)));
+   CuAssertIntEquals(tc, 2, rmf_unpackNumHeader(buf, 2, &value, (uint8_t) sizeof(uint16_t)));
+   CuAssertUIntEquals(tc, 300, value);
+   CuAssertIntEquals(tc, 2, rmf_packNumHeader(buf, (int32_t) sizeof(buf), HEADERUTIL16_MAX_NUM_LONG, (uint8_t) sizeof(uint16_t)));
+   CuAssertIntEquals(tc, 2, rmf_unpackNumHeader(buf, 2, &value, (uint8_t) sizeof(uint16_t)));
+   CuAssertUIntEquals(tc, HEADERUTIL16_MAX_NUM_LONG, value);
+   CuAssertIntEquals(tc, -1, rmf_packNumHeader(buf, (int32_t) sizeof(buf), HEADERUTIL16_MAX_NUM_LONG+1, (uint8_t) sizeof(uint16_t)));
+   CuAssertIntEquals(tc, 4, rmf_packNumHeader(buf, (int32_t) sizeof(buf), HEADERUTIL16_MAX_NUM_LONG+1, (uint8_t) sizeof(uint32_t)));
+   CuAssertIntEquals(tc, 0, rmf_unpackNumHeader(buf, 3, &value, (uint8_t) sizeof(uint32_t)));
+   CuAssertIntEquals(tc, 4, rmf_unpackNumHeader(buf, 4, &value, (uint8_t) sizeof(uint32_t)));
+   CuAssertUIntEquals(tc, HEADERUTIL16_MAX_NUM_LONG+1, value);
+   CuAssertIntEquals(tc, -1, rmf_packNumHeader(buf, (int32_t) sizeof(buf), 1, 3));
+
+   CuAssertIntEquals(tc, RMF_NUMHEADER_FORMAT_CMD_LEN, rmf_serialize_cmdNumHeaderFormat(buf, (int32_t) sizeof(buf), RMF_NUMHEADER_FORMAT_16));
+   CuAssertUIntEquals(tc, RMF_CMD_NUMHEADER_FORMAT, unpackLE(buf, 4));
+   CuAssertIntEquals(tc, RMF_NUMHEADER_FORMAT_CMD_LEN, rmf_deserialize_cmdNumHeaderFormat(buf, (int32_t) sizeof(buf), &value));
+   CuAssertUIntEquals(tc, RMF_NUMHEADER_FORMAT_16, value);
+   CuAssertIntEquals(tc, -1, rmf_serialize_cmdNumHeaderFormat(buf, (int32_t) sizeof(buf), 8));
+}
+
+static void test_rmf_unpackMsg_moreBit(CuTest* tc)
+{
+   uint8_t buf[RMF_MAX_HEADER_SIZE+1];
+   rmf_msg_t msg;
+   buf[RMF_MAX_HEADER_SIZE] = 0;
+   CuAssertIntEquals(tc, RMF_LOW_ADDRESS_SIZE, rmf_packHeader(buf, (int32_t) sizeof(buf), 0x1234, true));
+   CuAssertIntEquals(tc, RMF_LOW_ADDRESS_SIZE+1, rmf_unpackMsg(buf, RMF_LOW_ADDRESS_SIZE+1, &msg));
+   CuAssertUIntEquals(tc, 0x1234, msg.address);
+   CuAssertTrue(tc, msg.more_bit);
+   CuAssertIntEquals(tc, RMF_HIGH_ADDRESS_SIZE, rmf_packHeader(buf, (int32_t) sizeof(buf), 0x12345, true));
+   CuAssertIntEquals(tc, RMF_HIGH_ADDRESS_SIZE+1, rmf_unpackMsg(buf, RMF_HIGH_ADDRESS_SIZE+1, &msg));
+   CuAssertUIntEquals(tc, 0x12345, msg.address);
+   CuAssertTrue(tc, msg.more_bit);
+}
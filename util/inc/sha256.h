@@ -0,0 +1,36 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#define SHA256_DIGEST_SIZE 32u
+#define SHA256_BLOCK_SIZE  64u
+
+typedef struct sha256_ctx_tag
+{
+   uint32_t state[8];
+   uint64_t totalLen; //number of bytes given to sha256_update
+   uint32_t blockLen; //number of bytes waiting in block
+   uint8_t block[SHA256_BLOCK_SIZE];
+}sha256_ctx_t;
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+void sha256_init(sha256_ctx_t *ctx);
+void sha256_update(sha256_ctx_t *ctx, const uint8_t *data, uint32_t len);
+void sha256_final(sha256_ctx_t *ctx, uint8_t *digest);
+void sha256_calc(const uint8_t *data, uint32_t len, uint8_t *digest);
+
+#endif //SHA256_H
@@ -0,0 +1,181 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <string.h>
+#include "sha256.h"
+#include "pack.h"
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+#define ROTR(x,n) (((x) >> (n)) | ((x) << (32-(n))))
+#define CH(x,y,z) (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x,y,z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define SIGMA0(x) (ROTR(x,2) ^ ROTR(x,13) ^ ROTR(x,22))
+#define SIGMA1(x) (ROTR(x,6) ^ ROTR(x,11) ^ ROTR(x,25))
+#define GAMMA0(x) (ROTR(x,7) ^ ROTR(x,18) ^ ((x) >> 3))
+#define GAMMA1(x) (ROTR(x,17) ^ ROTR(x,19) ^ ((x) >> 10))
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static void sha256_transform(sha256_ctx_t *ctx, const uint8_t *block);
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+static const uint32_t m_k[64] =
+{
+   0x428a2f98u, 0x71374491u, 0xb5c0fbcfu, 0xe9b5dba5u, 0x3956c25bu, 0x59f111f1u, 0x923f82a4u, 0xab1c5ed5u,
+   0xd807aa98u, 0x12835b01u, 0x243185beu, 0x550c7dc3u, 0x72be5d74u, 0x80deb1feu, 0x9bdc06a7u, 0xc19bf174u,
+   0xe49b69c1u, 0xefbe4786u, 0x0fc19dc6u, 0x240ca1ccu, 0x2de92c6fu, 0x4a7484aau, 0x5cb0a9dcu, 0x76f988dau,
+   0x983e5152u, 0xa831c66du, 0xb00327c8u, 0xbf597fc7u, 0xc6e00bf3u, 0xd5a79147u, 0x06ca6351u, 0x14292967u,
+   0x27b70a85u, 0x2e1b2138u, 0x4d2c6dfcu, 0x53380d13u, 0x650a7354u, 0x766a0abbu, 0x81c2c92eu, 0x92722c85u,
+   0xa2bfe8a1u, 0xa81a664bu, 0xc24b8b70u, 0xc76c51a3u, 0xd192e819u, 0xd6990624u, 0xf40e3585u, 0x106aa070u,
+   0x19a4c116u, 0x1e376c08u, 0x2748774cu, 0x34b0bcb5u, 0x391c0cb3u, 0x4ed8aa4au, 0x5b9cca4fu, 0x682e6ff3u,
+   0x748f82eeu, 0x78a5636fu, 0x84c87814u, 0x8cc70208u, 0x90befffau, 0xa4506cebu, 0xbef9a3f7u, 0xc67178f2u
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+void sha256_init(sha256_ctx_t *ctx)
+{
+   if (ctx != 0)
+   {
+      ctx->state[0] = 0x6a09e667u;
+      ctx->state[1] = 0xbb67ae85u;
+      ctx->state[2] = 0x3c6ef372u;
+      ctx->state[3] = 0xa54ff53au;
+      ctx->state[4] = 0x510e527fu;
+      ctx->state[5] = 0x9b05688cu;
+      ctx->state[6] = 0x1f83d9abu;
+      ctx->state[7] = 0x5be0cd19u;
+      ctx->totalLen = 0;
+      ctx->blockLen = 0;
+   }
+}
+
+void sha256_update(sha256_ctx_t *ctx, const uint8_t *data, uint32_t len)
+{
+   if ( (ctx != 0) && (data != 0) )
+   {
+      ctx->totalLen += len;
+      if (ctx->blockLen > 0)
+      {
+         uint32_t numBytes = SHA256_BLOCK_SIZE - ctx->blockLen;
+         if (numBytes > len)
+         {
+            numBytes = len;
+         }
+         memcpy(&ctx->block[ctx->blockLen], data, numBytes);
+         ctx->blockLen += numBytes;
+         data += numBytes;
+         len -= numBytes;
+         if (ctx->blockLen < SHA256_BLOCK_SIZE)
+         {
+            return;
+         }
+         sha256_transform(ctx, ctx->block);
+         ctx->blockLen = 0;
+      }
+      //full blocks are hashed directly from data
+      while (len >= SHA256_BLOCK_SIZE)
+      {
+         sha256_transform(ctx, data);
+         data += SHA256_BLOCK_SIZE;
+         len -= SHA256_BLOCK_SIZE;
+      }
+      if (len > 0)
+      {
+         memcpy(ctx->block, data, len);
+         ctx->blockLen = len;
+      }
+   }
+}
+
+/**
+ * writes SHA256_DIGEST_SIZE bytes to digest. ctx must be initialized again before it can be reused
+ */
+void sha256_final(sha256_ctx_t *ctx, uint8_t *digest)
+{
+   if ( (ctx != 0) && (digest != 0) )
+   {
+      int i;
+      uint64_t bitLen = ctx->totalLen * 8u;
+      ctx->block[ctx->blockLen++] = 0x80;
+      if (ctx->blockLen > (SHA256_BLOCK_SIZE-8u))
+      {
+         memset(&ctx->block[ctx->blockLen], 0, SHA256_BLOCK_SIZE - ctx->blockLen);
+         sha256_transform(ctx, ctx->block);
+         ctx->blockLen = 0;
+      }
+      memset(&ctx->block[ctx->blockLen], 0, (SHA256_BLOCK_SIZE-8u) - ctx->blockLen);
+      packBE(&ctx->block[SHA256_BLOCK_SIZE-8u], (uint32_t) (bitLen >> 32), (uint8_t) sizeof(uint32_t));
+      packBE(&ctx->block[SHA256_BLOCK_SIZE-4u], (uint32_t) bitLen, (uint8_t) sizeof(uint32_t));
+      sha256_transform(ctx, ctx->block);
+      for (i=0; i<8; i++)
+      {
+         packBE(&digest[i*4], ctx->state[i], (uint8_t) sizeof(uint32_t));
+      }
+   }
+}
+
+/**
+ * calculates the SHA-256 digest of data in one step
+ */
+void sha256_calc(const uint8_t *data, uint32_t len, uint8_t *digest)
+{
+   sha256_ctx_t ctx;
+   sha256_init(&ctx);
+   sha256_update(&ctx, data, len);
+   sha256_final(&ctx, digest);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+static void sha256_transform(sha256_ctx_t *ctx, const uint8_t *block)
+{
+   uint32_t w[64];
+   uint32_t a, b, c, d, e, f, g, h;
+   int i;
+   for (i=0; i<16; i++)
+   {
+      w[i] = (uint32_t) unpackBE(&block[i*4], (uint8_t) sizeof(uint32_t));
+   }
+   for (i=16; i<64; i++)
+   {
+      w[i] = GAMMA1(w[i-2]) + w[i-7] + GAMMA0(w[i-15]) + w[i-16];
+   }
+   a = ctx->state[0];
+   b = ctx->state[1];
+   c = ctx->state[2];
+   d = ctx->state[3];
+   e = ctx->state[4];
+   f = ctx->state[5];
+   g = ctx->state[6];
+   h = ctx->state[7];
+   for (i=0; i<64; i++)
+   {
+      uint32_t t1 = h + SIGMA1(e) + CH(e,f,g) + m_k[i] + w[i];
+      uint32_t t2 = SIGMA0(a) + MAJ(a,b,c);
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+   }
+   ctx->state[0] += a;
+   ctx->state[1] += b;
+   ctx->state[2] += c;
+   ctx->state[3] += d;
+   ctx->state[4] += e;
+   ctx->state[5] += f;
+   ctx->state[6] += g;
+   ctx->state[7] += h;
+}
@@ -0,0 +1,99 @@
+//////////////////////////////////////////////////////////////////////////////
+// INCLUDES
+//////////////////////////////////////////////////////////////////////////////
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "CuTest.h"
+#include "sha256.h"
+#ifdef MEM_LEAK_CHECK
+#include "CMemLeak.h"
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+// CONSTANTS AND DATA TYPES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTION PROTOTYPES
+//////////////////////////////////////////////////////////////////////////////
+static void testsuite_sha256_calc(CuTest* tc);
+static void testsuite_sha256_update(CuTest* tc);
+static void digestToString(const uint8_t *digest, char *str);
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL VARIABLES
+//////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////////////////////////////
+// GLOBAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+
+CuSuite* testsuite_sha256(void)
+{
+   CuSuite* suite = CuSuiteNew();
+
+   SUITE_ADD_TEST(suite, testsuite_sha256_calc);
+   SUITE_ADD_TEST(suite, testsuite_sha256_update);
+
+   return suite;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+static void testsuite_sha256_calc(CuTest* tc)
+{
+   uint8_t digest[SHA256_DIGEST_SIZE];
+   char str[SHA256_DIGEST_SIZE*2+1];
+   const char *msg = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+   sha256_calc((const uint8_t*) "", 0, digest);
+   digestToString(digest, str);
+   CuAssertStrEquals(tc, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", str);
+   sha256_calc((const uint8_t*) "abc", 3, digest);
+   digestToString(digest, str);
+   CuAssertStrEquals(tc, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", str);
+   //56 bytes, the length does not fit in the first padding block
+   sha256_calc((const uint8_t*) msg, (uint32_t) strlen(msg), digest);
+   digestToString(digest, str);
+   CuAssertStrEquals(tc, "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1", str);
+}
+
+static void testsuite_sha256_update(CuTest* tc)
+{
+   sha256_ctx_t ctx;
+   uint8_t digest[SHA256_DIGEST_SIZE];
+   char str[SHA256_DIGEST_SIZE*2+1];
+   uint8_t data[1000];
+   int i;
+   memset(data, 'a', sizeof(data));
+   //one million 'a', given in pieces that do not line up with the block size
+   sha256_init(&ctx);
+   for (i=0; i<1000; i++)
+   {
+      sha256_update(&ctx, data, 1);
+      sha256_update(&ctx, data, 999);
+   }
+   sha256_final(&ctx, digest);
+   digestToString(digest, str);
+   CuAssertStrEquals(tc, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0", str);
+}
+
+static void digestToString(const uint8_t *digest, char *str)
+{
+   uint32_t i;
+   for (i=0; i<SHA256_DIGEST_SIZE; i++)
+   {
+      sprintf(&str[i*2], "%02x", digest[i]);
+   }
+}